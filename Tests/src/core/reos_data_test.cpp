@@ -16,12 +16,17 @@ email                : vcloarec at gmail dot com
 #include <QObject>
 
 #include "reostimeserie.h"
+#include "reosprojectcontainer.h"
+#include "reos_testutils.h"
 
 class ReosDataTesting: public QObject
 {
     Q_OBJECT
   private slots:
     void variable_time_step_time_model();
+    void constant_interval_derived_data();
+    void variable_time_step_bulk_edition();
+    void project_container();
 
 };
 
@@ -565,5 +570,158 @@ void ReosDataTesting::variable_time_step_time_model()
 
 }
 
+void ReosDataTesting::constant_interval_derived_data()
+{
+  ReosTimeSerieConstantInterval timeSerie;
+  timeSerie.setTimeStep( ReosDuration( 5, ReosDuration::minute ) );
+
+  for ( int i = 0; i < 1000; ++i )
+    timeSerie.appendValue( i % 10 );
+
+  QCOMPARE( timeSerie.valueWithMode( 0, ReosTimeSerieConstantInterval::Cumulative ), 0.0 );
+  QCOMPARE( timeSerie.valueWithMode( 10, ReosTimeSerieConstantInterval::Cumulative ), 45.0 );
+  QCOMPARE( timeSerie.valueWithMode( 1000, ReosTimeSerieConstantInterval::Cumulative ), 4500.0 );
+
+  // appended values extend the sums
+  timeSerie.appendValue( 100 );
+  QCOMPARE( timeSerie.valueWithMode( 1001, ReosTimeSerieConstantInterval::Cumulative ), 4600.0 );
+  QPair<int, int> extent = timeSerie.extentIndexes( 0, 1000 );
+  QCOMPARE( extent.first, 0 );
+  QCOMPARE( extent.second, 1000 );
+
+  // changed value updates the following sums
+  timeSerie.setValueAt( 500, -50 );
+  QCOMPARE( timeSerie.valueWithMode( 500, ReosTimeSerieConstantInterval::Cumulative ), 2250.0 );
+  QCOMPARE( timeSerie.valueWithMode( 501, ReosTimeSerieConstantInterval::Cumulative ), 2200.0 );
+  QCOMPARE( timeSerie.valueWithMode( 1001, ReosTimeSerieConstantInterval::Cumulative ), 4550.0 );
+  extent = timeSerie.extentIndexes( 0, 1000 );
+  QCOMPARE( extent.first, 500 );
+  QCOMPARE( extent.second, 1000 );
+  extent = timeSerie.extentIndexes( 3, 499 );
+  QCOMPARE( timeSerie.valueAt( extent.first ), 0.0 );
+  QCOMPARE( timeSerie.valueAt( extent.second ), 9.0 );
+
+  QPair<double, double> valueExtent = timeSerie.extentValueWithMode( ReosTimeSerieConstantInterval::Cumulative );
+  QCOMPARE( valueExtent.first, 0.0 );
+  QCOMPARE( valueExtent.second, 4450.0 );
+
+  // values modified through the pointer
+  double *data = timeSerie.data();
+  data[0] = 1000;
+  QCOMPARE( timeSerie.valueWithMode( 1, ReosTimeSerieConstantInterval::Cumulative ), 1000.0 );
+  QCOMPARE( timeSerie.valueExent().second, 1000.0 );
+
+  timeSerie.removeValues( 0, 1 );
+  QCOMPARE( timeSerie.valueCount(), 1000 );
+  QCOMPARE( timeSerie.valueWithMode( 1000, ReosTimeSerieConstantInterval::Cumulative ), 4550.0 );
+
+  // decimation keeps extrema
+  const QVector<int> indexes = timeSerie.decimatedIndexes( 0, 999, 10 );
+  QVERIFY( indexes.count() <= 22 );
+  QVERIFY( indexes.contains( 499 ) );
+  QVERIFY( indexes.contains( 999 ) );
+  for ( int i = 1; i < indexes.count(); ++i )
+    QVERIFY( indexes.at( i ) > indexes.at( i - 1 ) );
+
+  QCOMPARE( timeSerie.decimatedIndexes( 10, 19, 10 ).count(), 10 );
+}
+
+void ReosDataTesting::variable_time_step_bulk_edition()
+{
+  ReosTimeSerieVariableTimeStep timeSerie;
+  timeSerie.reserve( 10 );
+  timeSerie.appendValues( {0, 60000, 120000}, {1.0, 2.0, 3.0} );
+  QCOMPARE( timeSerie.valueCount(), 3 );
+  timeSerie.appendValues( {180000, 240000}, {4.0, 5.0} );
+  QCOMPARE( timeSerie.valueCount(), 5 );
+  QCOMPARE( timeSerie.relativeTimeAt( 4 ), ReosDuration( 4.0, ReosDuration::minute ) );
+
+  // merge with existing, one replaced, two inserted
+  timeSerie.mergeValues( {30000, 120000, 300000}, {10.0, 30.0, 6.0} );
+  QCOMPARE( timeSerie.valueCount(), 7 );
+  QCOMPARE( timeSerie.valueAt( 1 ), 10.0 );
+  QCOMPARE( timeSerie.valueAt( 3 ), 30.0 );
+  QCOMPARE( timeSerie.valueAt( 6 ), 6.0 );
+  QCOMPARE( timeSerie.relativeTimeAt( 1 ), ReosDuration( qint64( 30000 ) ) );
+
+  // cursor search gives the same result than the binary search, whatever the order of the times
+  int cursor = -1;
+  for ( int i = -10; i < 400; i += 7 )
+  {
+    const ReosDuration time( qint64( i * 1000 ) );
+    QCOMPARE( timeSerie.valueAtTime( time, cursor ), timeSerie.valueAtTime( time ) );
+  }
+  for ( int i = 400; i > -10; i -= 13 )
+  {
+    const ReosDuration time( qint64( i * 1000 ) );
+    QCOMPARE( timeSerie.valueAtTime( time, cursor ), timeSerie.valueAtTime( time ) );
+  }
+  QCOMPARE( timeSerie.valueAtTime( ReosDuration( qint64( 45000 ) ) ), 6.0 );
+}
+
+void ReosDataTesting::project_container()
+{
+  const QString fileName( tmp_file( "project_container.lkn" ).c_str() );
+  const QString otherFileName( tmp_file( "project_container_other.lkn" ).c_str() );
+  QFile::remove( fileName );
+  QFile::remove( otherFileName );
+
+  const QByteArray largeData( 100000, 'a' );
+
+  ReosProjectContainer container;
+  container.setHeader( QByteArray( "header" ) );
+  QVERIFY( container.setSection( QStringLiteral( "section-1" ), largeData ) );
+  QVERIFY( container.setSection( QStringLiteral( "section-2" ), QByteArray( "data 2" ), false ) );
+  QVERIFY( !container.setSection( QStringLiteral( "section-1" ), largeData ) );
+  QVERIFY( container.isDirty() );
+  QVERIFY( container.save( fileName ) );
+  QVERIFY( !container.isDirty() );
+  QVERIFY( QFileInfo( fileName ).size() < largeData.size() ); // compressed
+
+  QVERIFY( ReosProjectContainer::isProjectContainer( fileName ) );
+  ReosProjectContainer readContainer;
+  QVERIFY( readContainer.open( fileName ) );
+  QCOMPARE( readContainer.header(), QByteArray( "header" ) );
+  QCOMPARE( readContainer.sectionKeys(), QStringList( {QStringLiteral( "section-1" ), QStringLiteral( "section-2" )} ) );
+  QCOMPARE( readContainer.section( QStringLiteral( "section-2" ) ), QByteArray( "data 2" ) );
+  QCOMPARE( readContainer.section( QStringLiteral( "section-1" ) ), largeData );
+  QVERIFY( readContainer.section( QStringLiteral( "section-3" ) ).isEmpty() );
+
+  // only the changed section is written
+  QVERIFY( !readContainer.setSection( QStringLiteral( "section-1" ), largeData ) );
+  QVERIFY( !readContainer.isDirty() );
+  QVERIFY( readContainer.setSection( QStringLiteral( "section-2" ), QByteArray( "new data 2" ) ) );
+  QCOMPARE( readContainer.section( QStringLiteral( "section-2" ) ), QByteArray( "new data 2" ) );
+  QVERIFY( readContainer.save( fileName ) );
+  QCOMPARE( readContainer.section( QStringLiteral( "section-1" ) ), largeData );
+  QCOMPARE( readContainer.section( QStringLiteral( "section-2" ) ), QByteArray( "new data 2" ) );
+
+  ReosProjectContainer otherContainer;
+  QVERIFY( otherContainer.open( fileName ) );
+  QCOMPARE( otherContainer.section( QStringLiteral( "section-1" ) ), largeData );
+  QCOMPARE( otherContainer.section( QStringLiteral( "section-2" ) ), QByteArray( "new data 2" ) );
+
+  // saved in another file, unchanged sections are copied
+  otherContainer.removeSection( QStringLiteral( "section-2" ) );
+  QVERIFY( otherContainer.save( otherFileName ) );
+  QCOMPARE( otherContainer.filePath(), otherFileName );
+  QVERIFY( otherContainer.open( otherFileName ) );
+  QCOMPARE( otherContainer.sectionKeys(), QStringList( {QStringLiteral( "section-1" )} ) );
+  QCOMPARE( otherContainer.section( QStringLiteral( "section-1" ) ), largeData );
+  QCOMPARE( otherContainer.header(), QByteArray( "header" ) );
+
+  // many changes of the same section, the obsolete data do not make the file grow indefinitely
+  for ( int i = 0; i < 20; ++i )
+  {
+    QVERIFY( readContainer.setSection( QStringLiteral( "section-1" ), QByteArray( 100000, static_cast<char>( 'b' + i ) ) ) );
+    QVERIFY( readContainer.save( fileName ) );
+  }
+  QVERIFY( readContainer.open( fileName ) );
+  QCOMPARE( readContainer.section( QStringLiteral( "section-1" ) ), QByteArray( 100000, static_cast<char>( 'b' + 19 ) ) );
+  QVERIFY( QFileInfo( fileName ).size() < 4 * QFileInfo( otherFileName ).size() );
+
+  QVERIFY( !ReosProjectContainer::isProjectContainer( QString( test_file( "filledDemDir.tiff" ).c_str() ) ) );
+}
+
 QTEST_MAIN( ReosDataTesting )
 #include "reos_data_test.moc"
@@ -24,6 +24,7 @@ class ReosDemTesting: public QObject
     Q_OBJECT
   private slots:
     void raster_DEM();
+    void batchElevations();
 
   private:
     ReosGisEngine gisEngine;
@@ -90,5 +91,44 @@ void ReosDemTesting::raster_DEM()
   QVERIFY( equal( dem->averageElevationInPolygon( polygon, QString() ), 5.0002, 0.0001 ) );
 }
 
+void ReosDemTesting::batchElevations()
+{
+  QString layerId = gisEngine.addRasterLayer( test_file( "filledDem.tiff" ).c_str(), "raster" );
+  gisEngine.registerLayerAsDigitalElevationModel( layerId );
+  std::unique_ptr<ReosDigitalElevationModel> dem( gisEngine.getTopDigitalElevationModel() );
+  QVERIFY( dem );
+
+  // at center of pixels, interpolated value is the pixel value
+  QPolygonF centers;
+  for ( int i = 0; i < 11; ++i )
+    for ( int j = 0; j < 11; ++j )
+      centers << QPointF( i + 0.5, j + 0.5 );
+
+  QVector<double> values = dem->elevationsAt( centers );
+  QCOMPARE( values.count(), centers.count() );
+  for ( int i = 0; i < centers.count(); ++i )
+    QVERIFY( equal( values.at( i ), dem->elevationAt( centers.at( i ) ), 1e-6 ) );
+
+  // between four centers of pixels
+  QPolygonF points;
+  points << QPointF( 5, 5 ) << QPointF( 5.25, 4.75 ) << QPointF( -5, -5 ) << QPointF( 25, 5 );
+  values = dem->elevationsAt( points );
+  QCOMPARE( values.count(), 4 );
+
+  double v00 = dem->elevationAt( QPointF( 4.5, 5.5 ) );
+  double v01 = dem->elevationAt( QPointF( 5.5, 5.5 ) );
+  double v10 = dem->elevationAt( QPointF( 4.5, 4.5 ) );
+  double v11 = dem->elevationAt( QPointF( 5.5, 4.5 ) );
+  QVERIFY( equal( values.at( 0 ), ( v00 + v01 + v10 + v11 ) / 4, 1e-6 ) );
+
+  const double top = v00 * 0.25 + v01 * 0.75;
+  const double bottom = v10 * 0.25 + v11 * 0.75;
+  QVERIFY( equal( values.at( 1 ), top * 0.25 + bottom * 0.75, 1e-6 ) );
+
+  // outside the DEM
+  QVERIFY( std::isnan( values.at( 2 ) ) );
+  QVERIFY( std::isnan( values.at( 3 ) ) );
+}
+
 QTEST_MAIN( ReosDemTesting )
 #include "reos_dem_test.moc"
@@ -14,11 +14,13 @@ email                : vcloarec at gmail dot com
  ***************************************************************************/
 #include<QtTest/QtTest>
 #include <QObject>
+#include <QTemporaryDir>
 
 #include "reoshydraulicstructure2d.h"
 #include "reospolygonstructure.h"
 #include "reosgisengine.h"
 #include "reosmapextent.h"
+#include "reosprojectcontainer.h"
 
 class ReoHydraulicStructure2DTest: public QObject
 {
@@ -28,6 +30,7 @@ class ReoHydraulicStructure2DTest: public QObject
     void init();
     void createAndEditPolylineStructure();
     void createAndEditPolygonStructure();
+    void saveEditedStructure();
   private:
     ReosHydraulicNetwork *mNetwork = nullptr;
     ReosModule *mRootModule = nullptr;
@@ -379,5 +382,53 @@ void ReoHydraulicStructure2DTest::createAndEditPolygonStructure()
 
 }
 
+void ReoHydraulicStructure2DTest::saveEditedStructure()
+{
+  QTemporaryDir dir;
+  const QString projectName( QStringLiteral( "project" ) );
+  const QString fileName = dir.filePath( projectName + QStringLiteral( ".lkn" ) );
+
+  QPolygonF domain;
+  domain << QPointF( 0, 0 )
+         << QPointF( 0, 0.5 )
+         << QPointF( 0, 1 )
+         << QPointF( 1, 1 )
+         << QPointF( 1, 0 );
+
+  ReosHydraulicStructure2D *structure2D = new ReosHydraulicStructure2D( domain, QString(), mNetwork->context() );
+  mNetwork->addElement( structure2D );
+
+  ReosProjectContainer container;
+  container.setEncodedSection( QStringLiteral( "hydaulic-network" ), mNetwork->encode( dir.path(), projectName ) );
+  QVERIFY( container.save( fileName ) );
+
+  // editing the structure changes the encoded network, that is written again on save
+  ReosPolylinesStructure *geomStructure = structure2D->geometryStructure();
+  ReosGeometryStructureVertex *vert = geomStructure->searchForVertex( ReosMapExtent( -0.1, 0.4, 0.1, 0.6 ) );
+  QVERIFY( vert );
+  geomStructure->moveVertex( vert, ReosSpatialPosition( QPointF( 0.5, 0.5 ) ) );
+  const QPolygonF editedDomain = structure2D->domain();
+  const ReosPolylinesStructure::Data editedData = geomStructure->structuredLinesData();
+  QVERIFY( editedDomain != domain );
+
+  QVERIFY( container.setEncodedSection( QStringLiteral( "hydaulic-network" ), mNetwork->encode( dir.path(), projectName ) ) );
+  QVERIFY( container.save( fileName ) );
+
+  ReosProjectContainer readContainer;
+  QVERIFY( readContainer.open( fileName ) );
+  ReosHydraulicNetwork readNetwork( nullptr, nullptr, nullptr );
+  readNetwork.decode( readContainer.encodedSection( QStringLiteral( "hydaulic-network" ) ), dir.path(), projectName );
+
+  const QList<ReosHydraulicNetworkElement *> elements = readNetwork.getElements( ReosHydraulicStructure2D::staticType() );
+  QCOMPARE( elements.count(), 1 );
+  ReosHydraulicStructure2D *readStructure = qobject_cast<ReosHydraulicStructure2D *>( elements.first() );
+  QVERIFY( readStructure );
+  QCOMPARE( readStructure->domain(), editedDomain );
+  const ReosPolylinesStructure::Data readData = readStructure->geometryStructure()->structuredLinesData();
+  QCOMPARE( readData.boundaryPointCount, editedData.boundaryPointCount );
+  QCOMPARE( readData.vertices, editedData.vertices );
+  QCOMPARE( readData.internalLines.count(), editedData.internalLines.count() );
+}
+
 QTEST_MAIN( ReoHydraulicStructure2DTest )
 #include "reos_hydraulic_structure_2D_test.moc"
@@ -20,9 +20,12 @@
 #include "reoshydrographrouting.h"
 #include "reoshydrographsource.h"
 #include "reoshydrograph.h"
+#include "reoshydrographconvolution.h"
 #include "reostransferfunction.h"
 #include "reosrunoffmodel.h"
 #include "reosgisengine.h"
+#include "reoshydraulicnetworkscheduler.h"
+#include "reoshydraulicscheme.h"
 
 #define WAITING_TIME_FOR_LOOP 100
 
@@ -34,8 +37,12 @@ class ReosHydrographTransferTest: public QObject
     void initTestCase();
 
     void test_junction();
+    void test_scheduler();
+    void test_networkSchemeCalculation();
+    void test_networkResultCache();
     void test_classicMuskingumRouting();
     void test_watershed_and_routing();
+    void test_convolution();
 
   private:
     ReosHydrographSourceFixed mSource1;
@@ -181,6 +188,197 @@ void ReosHydrographTransferTest::test_junction()
   }
 }
 
+void ReosHydrographTransferTest::test_scheduler()
+{
+  ReosCalculationContext context;
+  ReosHydrographJunction junction1{ QPointF()};
+  ReosHydrographJunction junction2{ QPointF()};
+
+  ReosHydrographSourceFixed source4;
+  std::unique_ptr<ReosHydrograph> hydrograph4 = std::make_unique<ReosHydrograph>();
+  hydrograph4->copyFrom( mSource3.outputHydrograph() );
+  source4.setHydrograph( hydrograph4.release() );
+
+  ReosHydrographRoutingLink transfer1( &mSource1, &junction1 );
+  ReosHydrographRoutingLink transfer2( &mSource2, &junction1 );
+  ReosHydrographRoutingLink transfer3( &source4, &junction2 );
+  ReosHydrographRoutingLink transfer4( &junction1, &junction2 );
+
+  // only the most downstream junction is given, upstream elements are added by the scheduler
+  ReosHydraulicNetworkScheduler scheduler( {&junction2}, context );
+  QVERIFY( !scheduler.hasCycle() );
+  QCOMPARE( scheduler.maxProgression(), 9 );
+
+  const QStringList order = scheduler.calculationOrder();
+  QCOMPARE( order.count(), 9 );
+  QVERIFY( order.indexOf( mSource1.id() ) < order.indexOf( transfer1.id() ) );
+  QVERIFY( order.indexOf( transfer1.id() ) < order.indexOf( junction1.id() ) );
+  QVERIFY( order.indexOf( transfer2.id() ) < order.indexOf( junction1.id() ) );
+  QVERIFY( order.indexOf( junction1.id() ) < order.indexOf( transfer4.id() ) );
+  QVERIFY( order.indexOf( transfer4.id() ) < order.indexOf( junction2.id() ) );
+  QVERIFY( order.indexOf( transfer3.id() ) < order.indexOf( junction2.id() ) );
+
+  scheduler.start();
+  QVERIFY( scheduler.isSuccessful() );
+  QCOMPARE( scheduler.currentProgression(), 9 );
+
+  ReosHydrograph *inputHydrograph_1 = mSource1.outputHydrograph( );
+  ReosHydrograph *inputHydrograph_2 = mSource2.outputHydrograph( );
+  ReosHydrograph *inputHydrograph_3 = source4.outputHydrograph( );
+
+  ReosHydrograph *calculatedHydrograph = scheduler.outputHydrograph( junction2.id() );
+  QVERIFY( calculatedHydrograph );
+
+  const QList<ReosHydrograph *> inputs( {inputHydrograph_1, inputHydrograph_2, inputHydrograph_3} );
+  for ( ReosHydrograph *input : inputs )
+  {
+    for ( int i = 0; i < input->valueCount(); ++i )
+    {
+      QDateTime time = input->timeAt( i );
+      QCOMPARE( calculatedHydrograph->valueAtTime( time ),
+                inputHydrograph_1->valueAtTime( time ) +
+                inputHydrograph_2->valueAtTime( time ) +
+                inputHydrograph_3->valueAtTime( time ) );
+    }
+  }
+
+  // results are copied in the elements without triggering the calculation through signals
+  scheduler.applyResults();
+  QVERIFY( *junction2.outputHydrograph() == *calculatedHydrograph );
+  QVERIFY( *transfer4.outputHydrograph() == *scheduler.outputHydrograph( junction1.id() ) );
+  QVERIFY( !junction2.calculationInProgress() );
+
+  // with a cache, products already calculated are restored
+  ReosHydrographResultCache cache;
+  ReosHydraulicNetworkScheduler firstScheduler( {&junction2}, context, &cache );
+  QCOMPARE( firstScheduler.restoredFromCacheCount(), 0 );
+  firstScheduler.start();
+  QVERIFY( firstScheduler.isSuccessful() );
+  QCOMPARE( cache.count(), 6 ); //4 routings and 2 junctions
+
+  ReosHydraulicNetworkScheduler secondScheduler( {&junction2}, context, &cache );
+  QCOMPARE( secondScheduler.restoredFromCacheCount(), 6 );
+  secondScheduler.start();
+  QVERIFY( secondScheduler.isSuccessful() );
+  QVERIFY( *secondScheduler.outputHydrograph( junction2.id() ) == *calculatedHydrograph );
+
+  // only the products downstream a modified source are calculated again
+  source4.outputHydrograph()->setValue( ReosDuration( 5, ReosDuration::minute ), 10 );
+  ReosHydraulicNetworkScheduler thirdScheduler( {&junction2}, context, &cache );
+  QCOMPARE( thirdScheduler.restoredFromCacheCount(), 4 ); //transfer1, transfer2, junction1 and transfer4
+  thirdScheduler.start();
+  QVERIFY( thirdScheduler.isSuccessful() );
+  QCOMPARE( thirdScheduler.outputHydrograph( junction2.id() )->valueAtTime( inputHydrograph_3->timeAt( 1 ) ),
+            inputHydrograph_1->valueAtTime( inputHydrograph_3->timeAt( 1 ) ) +
+            inputHydrograph_2->valueAtTime( inputHydrograph_3->timeAt( 1 ) ) + 10 );
+  QCOMPARE( cache.count(), 8 );
+
+  // a loop can't be calculated
+  ReosHydrographRoutingLink loopTransfer( &junction2, &junction1 );
+  ReosHydraulicNetworkScheduler loopScheduler( {&junction2}, context );
+  QVERIFY( loopScheduler.hasCycle() );
+  loopScheduler.start();
+  QVERIFY( !loopScheduler.isSuccessful() );
+}
+
+void ReosHydrographTransferTest::test_networkSchemeCalculation()
+{
+  ReosHydraulicNetwork network( nullptr, &gisEngine, nullptr );
+  network.hydraulicSchemeCollection()->addScheme( new ReosHydraulicScheme );
+  network.setCurrentScheme( 0 );
+
+  ReosHydrographSourceFixed *source = new ReosHydrographSourceFixed( &network );
+  std::unique_ptr<ReosHydrograph> hydrograph = std::make_unique<ReosHydrograph>();
+  hydrograph->copyFrom( mSource1.outputHydrograph() );
+  source->setHydrograph( hydrograph.release() );
+  ReosHydrographJunction *junction = new ReosHydrographJunction( QPointF(), &network );
+  ReosHydrographRoutingLink *routing = new ReosHydrographRoutingLink( source, junction, &network );
+  network.addElement( source, false );
+  network.addElement( junction, false );
+  network.addElement( routing, false );
+
+  timer.start( WAITING_TIME_FOR_LOOP );
+  loop.exec();
+
+  QSignalSpy schemeChangedSpy( &network, &ReosHydraulicNetwork::schemeChanged );
+  QSignalSpy routingStartSpy( routing, &ReosHydraulicNetworkElement::calculationStart );
+
+  // the scheme is switched and calculated by the scheduler only, not by the elements through the signals
+  QVERIFY( network.calculateScheme( 1 ) );
+  QCOMPARE( network.currentSchemeIndex(), 1 );
+  QCOMPARE( schemeChangedSpy.count(), 1 );
+  QVERIFY( *junction->outputHydrograph() == *source->outputHydrograph() );
+  QVERIFY( !junction->calculationInProgress() );
+
+  timer.start( WAITING_TIME_FOR_LOOP );
+  loop.exec();
+
+  QCOMPARE( routingStartSpy.count(), 0 );
+  QVERIFY( !network.calculationIsSuspended() );
+}
+
+void ReosHydrographTransferTest::test_networkResultCache()
+{
+  ReosHydraulicNetwork network( nullptr, &gisEngine, nullptr );
+  network.hydraulicSchemeCollection()->addScheme( new ReosHydraulicScheme );
+  network.setCurrentScheme( 0 );
+
+  ReosHydrographSourceFixed *source = new ReosHydrographSourceFixed( &network );
+  std::unique_ptr<ReosHydrograph> hydrograph = std::make_unique<ReosHydrograph>();
+  hydrograph->copyFrom( mSource1.outputHydrograph() );
+  source->setHydrograph( hydrograph.release() );
+  ReosHydrographJunction *junction = new ReosHydrographJunction( QPointF(), &network );
+  ReosHydrographRoutingLink *routing = new ReosHydrographRoutingLink( source, junction, &network );
+  network.addElement( source, false );
+  network.addElement( junction, false );
+  network.addElement( routing, false );
+
+  QVERIFY( routing->setCurrentRoutingMethod( ReosHydrographRoutingMethodLag::staticType() ) );
+  ReosHydrographRoutingMethodLag *lag = qobject_cast<ReosHydrographRoutingMethodLag *>( routing->currentRoutingMethod() );
+  QVERIFY( lag );
+  lag->lagParameter()->setValue( ReosDuration( 30, ReosDuration::minute ) );
+  junction->updateCalculationContext( network.calculationContext() );
+
+  timer.start( WAITING_TIME_FOR_LOOP );
+  loop.exec();
+
+  ReosHydrograph firstSchemeOutput;
+  firstSchemeOutput.copyFrom( junction->outputHydrograph() );
+  QCOMPARE( firstSchemeOutput.valueAtTime( source->outputHydrograph()->timeAt( 2 ).addSecs( 1800 ) ), source->outputHydrograph()->valueAt( 2 ) );
+  QVERIFY( !routing->currentOutputKey().isEmpty() );
+  QVERIFY( routing->currentOutputKey() == routing->outputKey() );
+  QVERIFY( junction->currentOutputKey() == junction->outputKey() );
+
+  // another scheme with another lag, calculated through the signals of the elements
+  network.changeScheme( 1 );
+  lag->lagParameter()->setValue( ReosDuration( 1, ReosDuration::hour ) );
+  junction->updateCalculationContext( network.calculationContext() );
+
+  timer.start( WAITING_TIME_FOR_LOOP );
+  loop.exec();
+
+  QCOMPARE( junction->outputHydrograph()->valueAtTime( source->outputHydrograph()->timeAt( 2 ).addSecs( 3600 ) ), source->outputHydrograph()->valueAt( 2 ) );
+  QVERIFY( !( *junction->outputHydrograph() == firstSchemeOutput ) );
+
+  // coming back to the first scheme, the hydrographs are restored from the cache, without any calculation
+  QSignalSpy routingStartSpy( routing, &ReosHydraulicNetworkElement::calculationStart );
+  network.changeScheme( 0 );
+  junction->updateCalculationContext( network.calculationContext() );
+  QVERIFY( !routing->calculationInProgress() );
+  QVERIFY( !junction->calculationInProgress() );
+  QVERIFY( *junction->outputHydrograph() == firstSchemeOutput );
+
+  timer.start( WAITING_TIME_FOR_LOOP );
+  loop.exec();
+
+  QCOMPARE( routingStartSpy.count(), 0 );
+  QVERIFY( *junction->outputHydrograph() == firstSchemeOutput );
+
+  // the hydrographs calculated through the signals are used by the scheduler
+  ReosHydraulicNetworkScheduler scheduler( {junction}, network.calculationContext(), network.resultCache() );
+  QCOMPARE( scheduler.restoredFromCacheCount(), 2 );
+}
+
 void ReosHydrographTransferTest::test_classicMuskingumRouting()
 {
   ReosModule rootModule;
@@ -572,5 +770,44 @@ void ReosHydrographTransferTest::test_watershed_and_routing()
   QCOMPARE( junction3.outputHydrograph()->valueCount(), 0 );
 }
 
+void ReosHydrographTransferTest::test_convolution()
+{
+  QVector<double> input( 500 );
+  QVector<double> kernel( 300 );
+  for ( int i = 0; i < input.count(); ++i )
+    input[i] = ( i % 7 ) * 0.5;
+  for ( int i = 0; i < kernel.count(); ++i )
+    kernel[i] = std::exp( -i / 50.0 ) * i;
+
+  QVector<double> direct = ReosHydrographConvolution::convolve( input, kernel, ReosHydrographConvolution::Direct );
+  QVector<double> fft = ReosHydrographConvolution::convolve( input, kernel, ReosHydrographConvolution::FFT );
+  QCOMPARE( direct.count(), input.count() + kernel.count() - 1 );
+  QCOMPARE( fft.count(), direct.count() );
+
+  for ( int i = 0; i < direct.count(); ++i )
+  {
+    double expected = 0;
+    for ( int j = std::max( 0, i - kernel.count() + 1 ); j <= std::min( i, input.count() - 1 ); ++j )
+      expected += input.at( j ) * kernel.at( i - j );
+    QVERIFY( equal( direct.at( i ), expected, 1e-6 ) );
+    QVERIFY( equal( fft.at( i ), expected, 1e-6 ) );
+  }
+
+  QCOMPARE( ReosHydrographConvolution::automaticMethod( 10, 10 ), ReosHydrographConvolution::Direct );
+  QCOMPARE( ReosHydrographConvolution::automaticMethod( 100000, 10000 ), ReosHydrographConvolution::FFT );
+
+  // resampling of a piecewise linear hydrograph
+  ReosHydrograph *hydrograph1 = mSource1.outputHydrograph();
+  QVector<double> resampled = ReosHydrographConvolution::resample( hydrograph1, ReosDuration( 10, ReosDuration::minute ) );
+  QCOMPARE( resampled.count(), 10 );
+  for ( int i = 0; i < resampled.count(); ++i )
+    QCOMPARE( resampled.at( i ), hydrograph1->valueAtTime( ReosDuration( 10.0 * i, ReosDuration::minute ) ) );
+
+  resampled = ReosHydrographConvolution::resample( hydrograph1, ReosDuration( 10, ReosDuration::minute ), ReosDuration( 5, ReosDuration::minute ) );
+  QCOMPARE( resampled.count(), 10 );
+  for ( int i = 0; i < resampled.count(); ++i )
+    QCOMPARE( resampled.at( i ), hydrograph1->valueAtTime( ReosDuration( 5 + 10.0 * i, ReosDuration::minute ) ) );
+}
+
 QTEST_MAIN( ReosHydrographTransferTest )
 #include "reos_hydrograph_transfer_test.moc"
@@ -20,13 +20,64 @@ email                : vcloarec at gmail dot com
 #include "reosmeshgenerator.h"
 #include "reospolylinesstructure.h"
 #include "reosgmshgenerator.h"
+#include "reosmeshsizefield.h"
+#include "reosmeshdatasetsource.h"
+#include "reosmeshqualitykernel.h"
+#include "reoscoordinatetransform.h"
+#include "reosmapextent.h"
+#include "reosduration.h"
+#include "reos_testutils.h"
+
+//! Dataset source with linear values on the vertices of a mesh, scalar group is x+y, vector group is (x,y), multiplied by (dataset index + 1)
+class ReosLinearDatasetSource : public ReosMeshDatasetSource
+{
+  public:
+    ReosLinearDatasetSource( ReosMesh *mesh )
+    {
+      for ( int i = 0; i < mesh->vertexCount(); ++i )
+        mVertices.append( mesh->vertexPosition( i ) );
+    }
+
+    int groupCount() const override {return 2;}
+    int datasetCount( int ) const override {return 3;}
+    QString groupName( int ) const override {return QString();}
+    bool groupIsScalar( int groupIndex ) const override {return groupIndex == 0;}
+    void groupMinMax( int, double &, double & ) const override {}
+    QDateTime groupReferenceTime( int ) const override {return QDateTime();}
+    ReosDuration datasetRelativeTime( int, int datasetIndex ) const override {return ReosDuration( datasetIndex, ReosDuration::hour );}
+    bool datasetIsValid( int, int ) const override {return true;}
+    void datasetMinMax( int, int, double &, double & ) const override {}
+    QVector<double> datasetValues( int groupIndex, int index ) const override
+    {
+      QVector<double> values;
+      for ( const QPointF &pt : mVertices )
+      {
+        if ( groupIndex == 0 )
+          values << ( pt.x() + pt.y() ) * ( index + 1 );
+        else
+          values << pt.x() * ( index + 1 ) << pt.y() * ( index + 1 );
+      }
+      return values;
+    }
+    QVector<int> activeFaces( int index ) const override {return QVector<int>( 2, index == 2 ? 0 : 1 );}
+    int datasetIndexClosestBeforeTime( int, const QDateTime & ) const override {return 0;}
+
+  private:
+    QVector<QPointF> mVertices;
+};
 
 class ReosMeshTest: public QObject
 {
     Q_OBJECT
   private slots:
     void GmshGenerator();
+    void sizeField();
+    void sizeFieldSmallPolygon();
+    void frameDataFaces();
     void memoryMesh();
+    void pointProbe();
+    void qualityKernel();
+    void vertexPositions();
 
   private:
 
@@ -55,14 +106,114 @@ void ReosMeshTest::GmshGenerator()
   process->start();
   QVERIFY( process->isSuccessful() );
   frameData = process->meshResult();
-  QCOMPARE( frameData.facesIndexes.count(), 1026 );
+  QCOMPARE( frameData.faceCount(), 1026 );
 
   controler.defaultSize()->setValue( 10 );
   process.reset( generator.getGenerateMeshProcess( structure.get(), &controler ) );
   process->start();
   QVERIFY( process->isSuccessful() );
   frameData = process->meshResult();
-  QCOMPARE( frameData.facesIndexes.count(), 16 );
+  QCOMPARE( frameData.faceCount(), 16 );
+}
+
+void ReosMeshTest::sizeField()
+{
+  ReosGisEngine engine;
+  ReosMeshResolutionController controler;
+  controler.defaultSize()->setValue( 5 );
+
+  ReosMeshSizeField field = ReosMeshSizeField::create( &controler, QRectF( 0, 0, 20, 20 ), QString() );
+  QVERIFY( field.isValid() );
+  QCOMPARE( field.columnCount(), 1 );
+  QCOMPARE( field.value( 10, 10 ), 5.0 );
+  QCOMPARE( field.value( 100, -100, true ), 5.0 );
+
+  controler.resolutionPolygons()->addClass( "fine", 1 );
+  QPolygonF polygon;
+  polygon << QPointF( 5, 5 ) << QPointF( 5, 10 ) << QPointF( 10, 10 ) << QPointF( 10, 5 );
+  controler.resolutionPolygons()->addPolygon( polygon, "fine" );
+
+  field = ReosMeshSizeField::create( &controler, QRectF( 0, 0, 20, 20 ), QString() );
+  QCOMPARE( field.cellSize(), 0.5 );
+  QCOMPARE( field.columnCount(), 42 );
+  QCOMPARE( field.value( 7, 7 ), 1.0 );
+  QCOMPARE( field.value( 15, 15 ), 5.0 );
+  QCOMPARE( field.value( 10.2, 7 ), 5.0 );
+  QCOMPARE( field.value( 10.2, 7, true ), 1.0 );
+  QCOMPARE( field.value( 12, 7, true ), 5.0 );
+
+  // large domain, the count of cells is limited
+  field = ReosMeshSizeField::create( &controler, QRectF( 0, 0, 10000, 10000 ), QString() );
+  QVERIFY( field.columnCount() * field.rowCount() <= ReosMeshSizeField::MAX_CELL_COUNT );
+  QCOMPARE( field.value( 5000, 5000 ), 5.0 );
+
+  ReosGmshGenerator generator;
+  QPolygonF domain;
+  domain << QPointF( 0, 0 ) << QPointF( 0, 20 ) << QPointF( 20, 20 ) << QPointF( 20, 0 );
+  std::unique_ptr<ReosPolylinesStructure> structure = ReosPolylinesStructure::createPolylineStructure( domain, QString() );
+  std::unique_ptr<ReosMeshGeneratorProcess> process( generator.getGenerateMeshProcess( structure.get(), &controler ) );
+  process->start();
+  QVERIFY( process->isSuccessful() );
+  QVERIFY( process->meshResult().faceCount() > 16 );
+}
+
+void ReosMeshTest::sizeFieldSmallPolygon()
+{
+  ReosGisEngine engine;
+  ReosMeshResolutionController controler;
+  controler.defaultSize()->setValue( 50 );
+
+  // small refinement polygon in a large domain, the cells are a lot larger than the polygon
+  controler.resolutionPolygons()->addClass( "fine", 0.1 );
+  QPolygonF polygon;
+  polygon << QPointF( 5000.2, 5000.2 ) << QPointF( 5000.2, 5000.7 ) << QPointF( 5000.7, 5000.7 ) << QPointF( 5000.7, 5000.2 );
+  controler.resolutionPolygons()->addPolygon( polygon, "fine" );
+
+  ReosMeshSizeField field = ReosMeshSizeField::create( &controler, QRectF( 0, 0, 10000, 10000 ), QString() );
+  QVERIFY( field.columnCount() * field.rowCount() <= ReosMeshSizeField::MAX_CELL_COUNT );
+  QVERIFY( field.cellSize() > 1 );
+
+  // the polygon is not lost, even if it does not contain the center of any cell
+  QCOMPARE( field.value( 5000.5, 5000.5 ), 0.1 );
+  QCOMPARE( field.value( 5000.5, 5000.5, true ), 0.1 );
+  QCOMPARE( field.value( 5000.5 + field.cellSize(), 5000.5, true ), 0.1 );
+  QCOMPARE( field.value( 5000.5 + field.cellSize() * 3, 5000.5 ), 50.0 );
+  QCOMPARE( field.value( 100, 100 ), 50.0 );
+
+  // thin polygon crossing the domain, narrower than the cells, refines all the cells it goes through
+  controler.resolutionPolygons()->addClass( "thin", 1 );
+  QPolygonF thinPolygon;
+  thinPolygon << QPointF( 1000, 2000.1 ) << QPointF( 1000, 2000.3 ) << QPointF( 9000, 2000.3 ) << QPointF( 9000, 2000.1 );
+  controler.resolutionPolygons()->addPolygon( thinPolygon, "thin" );
+
+  field = ReosMeshSizeField::create( &controler, QRectF( 0, 0, 10000, 10000 ), QString() );
+  QCOMPARE( field.value( 5000.5, 5000.5 ), 0.1 );
+  for ( double x = 1000.5; x < 9000; x += 500 )
+    QCOMPARE( field.value( x, 2000.2 ), 1.0 );
+  QCOMPARE( field.value( 5000, 2000.2 + field.cellSize() * 3 ), 50.0 );
+}
+
+void ReosMeshTest::frameDataFaces()
+{
+  ReosMeshFrameData data;
+  const int triangle1[3] = {0, 1, 2};
+  const int triangle2[3] = {2, 1, 3};
+  const int quad[4] = {3, 1, 4, 5};
+
+  data.appendFace( triangle1, 3 );
+  data.appendFace( triangle2, 3 );
+  QVERIFY( data.onlyTriangles() );
+  QCOMPARE( data.faceCount(), 2 );
+  QCOMPARE( data.faceVertices( 1 )[2], 3 );
+
+  data.appendFace( quad, 4 );
+  QVERIFY( !data.onlyTriangles() );
+  QCOMPARE( data.faceCount(), 3 );
+  QCOMPARE( data.faceSize( 1 ), 3 );
+  QCOMPARE( data.faceSize( 2 ), 4 );
+  QCOMPARE( data.faceVertices( 1 )[0], 2 );
+  QCOMPARE( data.faceVertices( 2 )[3], 5 );
+  QCOMPARE( data.facesIndexes.count(), 10 );
 }
 
 void ReosMeshTest::memoryMesh()
@@ -92,5 +243,197 @@ void ReosMeshTest::memoryMesh()
   QCOMPARE( mesh->faceCount(), 2 );
 }
 
+void ReosMeshTest::pointProbe()
+{
+  ReosGisEngine engine;
+  std::unique_ptr<ReosMesh> mesh( ReosMesh::createMeshFrame() );
+
+  ReosMeshGeneratorPoly2Tri generator;
+  QPolygonF domain;
+  domain << QPointF( 0, 0 ) << QPointF( 0, 20 ) << QPointF( 20, 20 ) << QPointF( 20, 0 );
+  generator.setDomain( domain );
+  std::unique_ptr<ReosPolylinesStructure> structure = ReosPolylinesStructure::createPolylineStructure( domain, QString() );
+  std::unique_ptr<ReosMeshGeneratorProcess> process;
+  process.reset( generator.getGenerateMeshProcess( structure.get(), nullptr ) );
+  process->start();
+  QVERIFY( process->isSuccessful() );
+  mesh->generateMesh( process->meshResult() );
+  QCOMPARE( mesh->faceCount(), 2 );
+
+  ReosLinearDatasetSource source( mesh.get() );
+  std::unique_ptr<ReosMeshPointProbe> probe( mesh->createPointProbe() );
+
+  QVERIFY( equal( probe->value( &source, ReosSpatialPosition( 5, 7 ), 0, 0 ), 12, 1e-9 ) );
+  QVERIFY( equal( probe->value( &source, ReosSpatialPosition( 15, 3 ), 0, 1 ), 36, 1e-9 ) );
+  QVERIFY( equal( probe->value( &source, ReosSpatialPosition( 6, 8 ), 1, 0 ), 10, 1e-9 ) );
+  QVERIFY( std::isnan( probe->value( &source, ReosSpatialPosition( 25, 8 ), 0, 0 ) ) );
+
+  // inactive faces
+  QVERIFY( std::isnan( probe->value( &source, ReosSpatialPosition( 5, 7 ), 0, 2 ) ) );
+
+  QPolygonF points;
+  points << QPointF( 0, 0 ) << QPointF( 20, 20 ) << QPointF( 10, 10 ) << QPointF( -1, 10 );
+  QVector<double> values = probe->values( &source, points, QString(), 0, 0 );
+  QCOMPARE( values.count(), 4 );
+  QVERIFY( equal( values.at( 0 ), 0, 1e-9 ) );
+  QVERIFY( equal( values.at( 1 ), 40, 1e-9 ) );
+  QVERIFY( equal( values.at( 2 ), 20, 1e-9 ) );
+  QVERIFY( std::isnan( values.at( 3 ) ) );
+
+  values = probe->timeSerie( &source, ReosSpatialPosition( 2, 3 ), 0 );
+  QCOMPARE( values.count(), 3 );
+  QVERIFY( equal( values.at( 0 ), 5, 1e-9 ) );
+  QVERIFY( equal( values.at( 1 ), 10, 1e-9 ) );
+  QVERIFY( std::isnan( values.at( 2 ) ) );
+
+  // same results with the mesh interpolation
+  QVERIFY( equal( mesh->interpolateDatasetValueOnPoint( &source, ReosSpatialPosition( 5, 7 ), 0, 1 ), 24, 1e-9 ) );
+}
+
+void ReosMeshTest::qualityKernel()
+{
+  // square with four triangles around the center, the last one is clockwise
+  QVector<double> x( {0, 10, 10, 0, 5} );
+  QVector<double> y( {0, 0, 10, 10, 5} );
+  QVector<double> z( {0, 0, 0, 10, 0} );
+  QVector<int> faces( {0, 1, 4, 1, 2, 4, 2, 3, 4, 4, 0, 3} );
+  QVector<int> faceStarts( {0, 3, 6, 9, 12} );
+
+  ReosMeshQualityKernel kernel;
+  QCOMPARE( kernel.update( x, y, z, faces, faceStarts ), 4 );
+  QVERIFY( kernel.error() == ReosMeshQualityKernel::Error::NoError );
+  QVERIFY( kernel.topologyRebuilt() );
+  QCOMPARE( kernel.faceCount(), 4 );
+  QCOMPARE( kernel.face( 3 ), QVector<int>( {3, 0, 4} ) );
+
+  for ( int f = 0; f < 4; ++f )
+  {
+    QVERIFY( equal( kernel.area( f ), 25, 1e-9 ) );
+    QVERIFY( equal( kernel.minimumAngle( f ), 45, 1e-9 ) );
+    QVERIFY( equal( kernel.maximumAngle( f ), 90, 1e-9 ) );
+    QVERIFY( equal( kernel.aspectRatio( f ), std::sqrt( 3.0 ), 1e-9 ) );
+  }
+
+  QCOMPARE( kernel.connectionCount( 4 ), 4 );
+  QCOMPARE( kernel.connectionCount( 0 ), 3 );
+  QVERIFY( !kernel.isVertexOnBoundary( 4 ) );
+  QVERIFY( kernel.isVertexOnBoundary( 2 ) );
+
+  ReosMeshQualityKernel::Thresholds thresholds;
+  thresholds.minimumAngle = 50;
+  thresholds.maximumAngle = 120;
+  thresholds.connectionCount = 3;
+  thresholds.connectionCountBoundary = 2;
+  thresholds.maximumSlope = 1.2;
+  thresholds.minimumArea = 10;
+  thresholds.maximumArea = 100;
+  thresholds.maximumAreaChange = 0.22;
+
+  ReosMesh::QualityMeshChecks checks = ReosMesh::MinimumAngle | ReosMesh::MaximumAngle | ReosMesh::ConnectionCount |
+                                       ReosMesh::ConnectionCountBoundary | ReosMesh::MaximumSlope | ReosMesh::MinimumArea |
+                                       ReosMesh::MaximumArea | ReosMesh::MaximumAreaChange;
+
+  ReosMeshQualityKernel::Results results = kernel.check( checks, thresholds );
+  QCOMPARE( results.minimumAngle, QVector<int>( {0, 1, 2, 3} ) );
+  QVERIFY( results.maximumAngle.isEmpty() );
+  QCOMPARE( results.connectionCount, QVector<int>( {4} ) );
+  QCOMPARE( results.connectionCountBoundary, QVector<int>( {0, 1, 2, 3} ) );
+  QCOMPARE( results.maximumSlope.count(), 1 );
+  QVERIFY( results.maximumSlope.at( 0 ) == qMakePair( 3, 4 ) || results.maximumSlope.at( 0 ) == qMakePair( 4, 3 ) );
+  QVERIFY( results.minimumArea.isEmpty() );
+  QVERIFY( results.maximumArea.isEmpty() );
+  QVERIFY( results.maximumAreaChange.isEmpty() );
+
+  // nothing changed, nothing calculated
+  QCOMPARE( kernel.update( x, y, z, faces, faceStarts ), 0 );
+  QVERIFY( !kernel.topologyRebuilt() );
+
+  // only the faces of the moved vertex are calculated, the topology is kept
+  z[2] = 1;
+  QCOMPARE( kernel.update( x, y, z, faces, faceStarts ), 2 );
+  QVERIFY( !kernel.topologyRebuilt() );
+
+  x[4] = 6;
+  QCOMPARE( kernel.update( x, y, z, faces, faceStarts ), 4 );
+  QVERIFY( !kernel.topologyRebuilt() );
+  QCOMPARE( kernel.connectionCount( 4 ), 4 );
+  QVERIFY( equal( kernel.area( 1 ), 20, 1e-9 ) );
+  QVERIFY( equal( kernel.area( 3 ), 30, 1e-9 ) );
+  results = kernel.check( ReosMesh::MaximumAreaChange, thresholds );
+  QCOMPARE( results.maximumAreaChange, QVector<int>( {1, 2} ) );
+
+  // unit factors
+  kernel.setUnitFactors( 1, 0.5 );
+  QCOMPARE( kernel.update( x, y, z, faces, faceStarts ), 4 );
+  QVERIFY( equal( kernel.area( 0 ), 12.5, 1e-9 ) );
+
+  // errors
+  QVector<int> errorFaces = faces;
+  errorFaces << 0 << 1 << 4;
+  QVector<int> errorFaceStarts = faceStarts;
+  errorFaceStarts << 15;
+  kernel.update( x, y, z, errorFaces, errorFaceStarts );
+  QVERIFY( kernel.error() == ReosMeshQualityKernel::Error::ManifoldFace );
+  QVERIFY( kernel.check( checks, thresholds ).minimumAngle.isEmpty() );
+
+  errorFaces[14] = 10;
+  kernel.update( x, y, z, errorFaces, errorFaceStarts );
+  QVERIFY( kernel.error() == ReosMeshQualityKernel::Error::InvalidVertex );
+  QCOMPARE( kernel.errorElement(), 4 );
+
+  QCOMPARE( kernel.update( x, y, z, faces, faceStarts ), 0 );
+  QVERIFY( kernel.error() == ReosMeshQualityKernel::Error::NoError );
+  QVERIFY( kernel.topologyRebuilt() );
+  QCOMPARE( kernel.connectionCount( 4 ), 4 );
+}
+
+void ReosMeshTest::vertexPositions()
+{
+  ReosGisEngine engine;
+  const QString wgs84 = ReosGisEngine::wktEPSGCrs( 4326 );
+  const QString pseudoMercator = ReosGisEngine::wktEPSGCrs( 3857 );
+  std::unique_ptr<ReosMesh> mesh( ReosMesh::createMeshFrame( wgs84 ) );
+
+  ReosMeshGeneratorPoly2Tri generator;
+  QPolygonF domain;
+  domain << QPointF( 0, 0 ) << QPointF( 0, 20 ) << QPointF( 20, 20 ) << QPointF( 20, 0 );
+  generator.setDomain( domain );
+  std::unique_ptr<ReosPolylinesStructure> structure = ReosPolylinesStructure::createPolylineStructure( domain, QString() );
+  std::unique_ptr<ReosMeshGeneratorProcess> process;
+  process.reset( generator.getGenerateMeshProcess( structure.get(), nullptr ) );
+  process->start();
+  QVERIFY( process->isSuccessful() );
+  mesh->generateMesh( process->meshResult() );
+
+  ReosCoordinateTransform transform( wgs84, pseudoMercator );
+  QVERIFY( transform.isValid() );
+
+  const QPolygonF nativePositions = mesh->vertexPositions();
+  const QPolygonF transformedPositions = mesh->vertexPositions( pseudoMercator );
+  QCOMPARE( nativePositions.count(), 4 );
+  QCOMPARE( transformedPositions.count(), 4 );
+  for ( int i = 0; i < nativePositions.count(); ++i )
+  {
+    QCOMPARE( nativePositions.at( i ), mesh->vertexPosition( i ) );
+    const QPointF expected = transform.transform( nativePositions.at( i ) );
+    QVERIFY( equal( transformedPositions.at( i ).x(), expected.x(), 1e-6 ) );
+    QVERIFY( equal( transformedPositions.at( i ).y(), expected.y(), 1e-6 ) );
+    QVERIFY( equal( mesh->vertexPosition( i, pseudoMercator ).x(), expected.x(), 1e-6 ) );
+    QVERIFY( equal( mesh->vertexPosition( i, pseudoMercator ).y(), expected.y(), 1e-6 ) );
+  }
+
+  QVector<double> x( {20, 0} );
+  QVector<double> y( {0, 0} );
+  QVERIFY( transform.transformInPlace( x, y ) );
+  QVERIFY( equal( x.at( 0 ), 2226389.816, 1e-3 ) );
+  QVERIFY( equal( y.at( 0 ), 0, 1e-6 ) );
+  QVERIFY( equal( x.at( 1 ), 0, 1e-6 ) );
+
+  // invalid transform keeps the points unchanged
+  ReosCoordinateTransform invalidTransform( QString(), pseudoMercator );
+  QVERIFY( !invalidTransform.isValid() );
+  QCOMPARE( invalidTransform.transform( QPointF( 1, 2 ) ), QPointF( 1, 2 ) );
+}
+
 QTEST_MAIN( ReosMeshTest )
 #include "reos_mesh_test.moc"
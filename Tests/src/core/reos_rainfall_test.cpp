@@ -21,6 +21,10 @@ email                : vcloarec at gmail dot com
 #include "reosrainfallitem.h"
 #include "reosidfcurves.h"
 #include "reosrainfallregistery.h"
+#include "reosgriddedrainfall.h"
+#include "reosmeteorologicmodel.h"
+#include "reosgisengine.h"
+#include "reoscoordinatetransform.h"
 
 class ReosRainfallTest: public QObject
 {
@@ -33,6 +37,8 @@ class ReosRainfallTest: public QObject
     void loadRainfallData();
 
     void syntheticRainfall();
+    void griddedRainfall();
+    void griddedRainfallCrs();
 
   private:
     ReosModule mRootModule;
@@ -593,5 +599,137 @@ void ReosRainfallTest::syntheticRainfall()
   QVERIFY( !doubleTriangleRainfall.isObsolete() );
 }
 
+void ReosRainfallTest::griddedRainfall()
+{
+  // grid of 4x4 cells of 1x1 with origin at the top left corner (0,4)
+  ReosRasterExtent extent( 0, 4, 4, 4, 1, -1 );
+  const QDateTime referenceTime( QDate( 2022, 5, 23 ), QTime( 10, 0, 0 ), Qt::UTC );
+  std::unique_ptr<ReosGriddedRainfall> griddedRainfall = std::make_unique<ReosGriddedRainfall>( extent, referenceTime, ReosDuration( 5, ReosDuration::minute ) );
+  QCOMPARE( griddedRainfall->cellCount(), 16 );
+  QCOMPARE( griddedRainfall->frameCount(), 0 );
+
+  QVERIFY( !griddedRainfall->appendFrame( QVector<double>( 15, 1.0 ) ) );
+
+  // first frame, each cell has its index as value
+  QVector<double> frame( 16 );
+  for ( int i = 0; i < 16; ++i )
+    frame[i] = i;
+  QVERIFY( griddedRainfall->appendFrame( frame ) );
+
+  // second frame, 1 everywhere except cell at row 3 and column 0 that has no data
+  frame.fill( 1.0 );
+  frame[12] = std::numeric_limits<double>::quiet_NaN();
+  QVERIFY( griddedRainfall->appendFrame( frame ) );
+  QCOMPARE( griddedRainfall->frameCount(), 2 );
+
+  QPolygonF insidePolygon;
+  insidePolygon << QPointF( 0.5, 0.5 ) << QPointF( 0.5, 2.5 ) << QPointF( 2.5, 2.5 ) << QPointF( 2.5, 0.5 );
+  QPolygonF partiallyOutsidePolygon;
+  partiallyOutsidePolygon << QPointF( -1, -1 ) << QPointF( -1, 1 ) << QPointF( 1, 1 ) << QPointF( 1, -1 );
+  QPolygonF outsidePolygon;
+  outsidePolygon << QPointF( 10, 10 ) << QPointF( 10, 11 ) << QPointF( 11, 11 ) << QPointF( 11, 10 );
+
+  const ReosGriddedRainfallWeights weights = ReosGriddedRainfallWeights::calculate( extent, {insidePolygon, partiallyOutsidePolygon, outsidePolygon} );
+  QCOMPARE( weights.polygonCount(), 3 );
+  QCOMPARE( weights.weightCount(), 9 + 1 );
+  QVERIFY( equal( weights.coverage( 0 ), 1.0, 1e-9 ) );
+  QVERIFY( equal( weights.coverage( 1 ), 0.25, 1e-9 ) );
+  QVERIFY( equal( weights.coverage( 2 ), 0.0, 1e-9 ) );
+
+  const QVector<double> averages = weights.arealAverages( griddedRainfall.get() );
+  QCOMPARE( averages.count(), 3 * 2 );
+  QVERIFY( equal( averages.at( 0 ), 9.0, 1e-9 ) );
+  QVERIFY( equal( averages.at( 1 ), 1.0, 1e-9 ) );
+  QVERIFY( equal( averages.at( 2 ), 12.0, 1e-9 ) );
+  // no cell with data under the polygon, the average is unknown
+  QVERIFY( std::isnan( averages.at( 3 ) ) );
+  QVERIFY( std::isnan( averages.at( 4 ) ) );
+  QVERIFY( std::isnan( averages.at( 5 ) ) );
+
+  const ReosGriddedRainfallWeights weights1 = weights.polygonWeights( 1 );
+  QCOMPARE( weights1.polygonCount(), 1 );
+  QCOMPARE( weights1.weightCount(), 1 );
+  const QVector<double> averages1 = weights1.arealAverages( griddedRainfall.get() );
+  QCOMPARE( averages1.count(), 2 );
+  QVERIFY( equal( averages1.at( 0 ), 12.0, 1e-9 ) );
+  QVERIFY( std::isnan( averages1.at( 1 ) ) );
+
+  std::unique_ptr<ReosGriddedRainfall> decoded( ReosGriddedRainfall::decode( griddedRainfall->encode() ) );
+  QVERIFY( decoded );
+  QCOMPARE( decoded->frameCount(), 2 );
+  QCOMPARE( decoded->referenceTime(), referenceTime );
+  QCOMPARE( weights.arealAverages( decoded.get() ).count(), 6 );
+
+  // gridded rainfall used by the meteorologic model for watersheds without associated rainfall
+  ReosWatershed insideWatershed( insidePolygon, QPointF( 0.5, 0.5 ), ReosWatershed::Manual );
+  ReosWatershed outsideWatershed( outsidePolygon, QPointF( 10, 10 ), ReosWatershed::Manual );
+
+  ReosMeteorologicModel meteoModel( QStringLiteral( "radar" ) );
+  QVERIFY( !meteoModel.hasRainfall( &insideWatershed ) );
+  meteoModel.setGriddedRainfall( griddedRainfall.release() );
+  QVERIFY( meteoModel.hasRainfall( &insideWatershed ) );
+  QVERIFY( !meteoModel.hasRainfall( &outsideWatershed ) );
+  QVERIFY( !meteoModel.associatedRainfall( &outsideWatershed ) );
+
+  ReosSerieRainfall *watershedRainfall = meteoModel.associatedRainfall( &insideWatershed );
+  QVERIFY( watershedRainfall );
+  QCOMPARE( watershedRainfall->valueCount(), 2 );
+  QCOMPARE( watershedRainfall->referenceTime(), referenceTime );
+  QVERIFY( equal( watershedRainfall->valueAt( 0 ), 9.0, 1e-9 ) );
+  QVERIFY( equal( watershedRainfall->valueAt( 1 ), 1.0, 1e-9 ) );
+
+  // a new frame updates the same serie
+  QVERIFY( meteoModel.griddedRainfall()->appendFrame( QVector<double>( 16, 2.0 ) ) );
+  QCOMPARE( meteoModel.associatedRainfall( &insideWatershed ), watershedRainfall );
+  QCOMPARE( watershedRainfall->valueCount(), 3 );
+  QVERIFY( equal( watershedRainfall->valueAt( 2 ), 2.0, 1e-9 ) );
+
+  // only the new frame is calculated, previous values are kept
+  for ( int i = 0; i < 16; ++i )
+    frame[i] = i * 10;
+  QVERIFY( meteoModel.griddedRainfall()->appendFrame( frame ) );
+  QCOMPARE( watershedRainfall->valueCount(), 4 );
+  QVERIFY( equal( watershedRainfall->valueAt( 0 ), 9.0, 1e-9 ) );
+  QVERIFY( equal( watershedRainfall->valueAt( 1 ), 1.0, 1e-9 ) );
+  QVERIFY( equal( watershedRainfall->valueAt( 2 ), 2.0, 1e-9 ) );
+  QVERIFY( equal( watershedRainfall->valueAt( 3 ), 90.0, 1e-9 ) );
+
+  // clearing the frames calculates all the values again
+  meteoModel.griddedRainfall()->clearFrames();
+  QCOMPARE( watershedRainfall->valueCount(), 0 );
+}
+
+void ReosRainfallTest::griddedRainfallCrs()
+{
+  ReosGisEngine engine;
+  const QString wgs84 = ReosGisEngine::wktEPSGCrs( 4326 );
+  const QString pseudoMercator = ReosGisEngine::wktEPSGCrs( 3857 );
+
+  // grid of 4x4 cells of 1000 m in pseudo Mercator with origin at the top left corner (0,4000)
+  ReosRasterExtent extent( 0, 4000, 4, 4, 1000, -1000 );
+  ReosGriddedRainfall griddedRainfall( extent, QDateTime( QDate( 2022, 5, 23 ), QTime( 10, 0, 0 ), Qt::UTC ), ReosDuration( 5, ReosDuration::minute ) );
+  griddedRainfall.setCrs( pseudoMercator );
+  QVector<double> frame( 16 );
+  for ( int i = 0; i < 16; ++i )
+    frame[i] = i;
+  QVERIFY( griddedRainfall.appendFrame( frame ) );
+
+  std::unique_ptr<ReosGriddedRainfall> decoded( ReosGriddedRainfall::decode( griddedRainfall.encode() ) );
+  QCOMPARE( decoded->crs(), pseudoMercator );
+
+  // polygon covering partially 9 cells, defined in WGS84
+  QPolygonF polygon;
+  polygon << QPointF( 500, 500 ) << QPointF( 500, 2500 ) << QPointF( 2500, 2500 ) << QPointF( 2500, 500 );
+  const QPolygonF wgs84Polygon = ReosCoordinateTransform( pseudoMercator, wgs84 ).transform( polygon );
+
+  ReosGriddedRainfallWeights weights = ReosGriddedRainfallWeights::calculate( extent, {wgs84Polygon}, griddedRainfall.crs(), wgs84 );
+  QVERIFY( equal( weights.coverage( 0 ), 1.0, 1e-6 ) );
+  QVERIFY( equal( weights.arealAverages( &griddedRainfall ).at( 0 ), 9.0, 1e-6 ) );
+
+  // without CRS, the polygon in degrees is considered in the cell 12 near the origin of the map
+  weights = ReosGriddedRainfallWeights::calculate( extent, {wgs84Polygon} );
+  QVERIFY( equal( weights.arealAverages( &griddedRainfall ).at( 0 ), 12.0, 1e-9 ) );
+}
+
 QTEST_MAIN( ReosRainfallTest )
 #include "reos_rainfall_test.moc"
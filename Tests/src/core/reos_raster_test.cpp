@@ -300,6 +300,85 @@ TEST_F( ReosRasterTesting, ReosRasterByteCompressed )
   ASSERT_TRUE( uncompressed == memoryRaster );
 }
 
+TEST_F( ReosRasterTesting, ReosRasterByteTiledCompressed )
+{
+  GDALAllRegister();
+  ReosRasterMemory<unsigned char> memoryRaster;
+  memoryRaster.loadDataFromTiffFile( test_file( "filledDemDir.tiff" ).c_str(), GDALDataType::GDT_Byte );
+
+  ReosRasterByteTiledCompressed compressed( memoryRaster );
+  ASSERT_TRUE( compressed.hasData() );
+  EXPECT_EQ( compressed.rowCount(), memoryRaster.rowCount() );
+  EXPECT_EQ( compressed.columnCount(), memoryRaster.columnCount() );
+  EXPECT_TRUE( compressed.uncompressRaster() == memoryRaster );
+
+  // random access
+  for ( int row = 0; row < memoryRaster.rowCount(); row += 7 )
+    for ( int col = 0; col < memoryRaster.columnCount(); col += 11 )
+      EXPECT_EQ( compressed.value( row, col ), memoryRaster.value( row, col ) );
+
+  // block partially outside the raster
+  ReosRasterMemory<unsigned char> block = compressed.uncompressBlock( -5, 60, 80, 100, 9 );
+  ASSERT_EQ( block.rowCount(), 80 );
+  ASSERT_EQ( block.columnCount(), 100 );
+  for ( int row = 0; row < 80; ++row )
+    for ( int col = 0; col < 100; ++col )
+    {
+      const int rasterRow = row - 5;
+      const int rasterCol = col + 60;
+      if ( rasterRow < 0 || rasterRow >= memoryRaster.rowCount() || rasterCol >= memoryRaster.columnCount() )
+        EXPECT_EQ( block.value( row, col ), 9 );
+      else
+        EXPECT_EQ( block.value( row, col ), memoryRaster.value( rasterRow, rasterCol ) );
+    }
+
+  ReosRasterByteTiledCompressed decoded = ReosRasterByteTiledCompressed::decode( compressed.encode() );
+  EXPECT_TRUE( decoded == compressed );
+
+  // large raster with long runs
+  ReosRasterMemory<unsigned char> largeRaster( 1000, 1500 );
+  largeRaster.reserveMemory();
+  for ( int row = 0; row < 1000; ++row )
+    for ( int col = 0; col < 1500; ++col )
+      largeRaster.setValue( row, col, static_cast<unsigned char>( col < 700 ? 2 : ( ( row / 100 + col / 300 ) % 9 ) ) );
+
+  ReosRasterByteTiledCompressed largeCompressed( largeRaster );
+  EXPECT_TRUE( largeCompressed.uncompressRaster() == largeRaster );
+  EXPECT_LT( largeCompressed.compressedSize(), 1000 * 1500 / 20 );
+  EXPECT_EQ( largeCompressed.value( 999, 1499 ), largeRaster.value( 999, 1499 ) );
+
+  // corrupted first tile, its cells in a block have the no data value
+  const ReosEncodedElement encoded = largeCompressed.encode();
+  QVector<int> tileOffsets;
+  QByteArray data;
+  ASSERT_TRUE( encoded.getData( QStringLiteral( "tile-offsets" ), tileOffsets ) );
+  ASSERT_TRUE( encoded.getData( QStringLiteral( "data" ), data ) );
+  const QByteArray corruptedTile( "\x00\x05\x01", 3 ); // run length tile with only one value
+  const int sizeDifference = corruptedTile.size() - tileOffsets.at( 1 );
+  data = corruptedTile + data.mid( tileOffsets.at( 1 ) );
+  for ( int i = 1; i < tileOffsets.count(); ++i )
+    tileOffsets[i] += sizeDifference;
+
+  ReosEncodedElement corruptedElement( QStringLiteral( "tiled-compress-byte-raster" ) );
+  corruptedElement.addData( QStringLiteral( "row-count" ), largeCompressed.rowCount() );
+  corruptedElement.addData( QStringLiteral( "column-count" ), largeCompressed.columnCount() );
+  corruptedElement.addData( QStringLiteral( "tile-offsets" ), tileOffsets );
+  corruptedElement.addData( QStringLiteral( "data" ), data );
+  ReosRasterByteTiledCompressed corrupted = ReosRasterByteTiledCompressed::decode( corruptedElement );
+  ASSERT_TRUE( corrupted.hasData() );
+
+  const int tileSize = ReosRasterByteTiledCompressed::TILE_SIZE;
+  ReosRasterMemory<unsigned char> corruptedBlock = corrupted.uncompressBlock( 0, 0, tileSize + 10, tileSize + 10, 9 );
+  for ( int row = 0; row < tileSize + 10; ++row )
+    for ( int col = 0; col < tileSize + 10; ++col )
+    {
+      if ( row < tileSize && col < tileSize )
+        EXPECT_EQ( corruptedBlock.value( row, col ), 9 );
+      else
+        EXPECT_EQ( corruptedBlock.value( row, col ), largeRaster.value( row, col ) );
+    }
+}
+
 int main( int argc, char **argv )
 {
   testing::InitGoogleTest( &argc, argv );
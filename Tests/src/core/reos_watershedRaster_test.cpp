@@ -19,7 +19,11 @@ email                : vcloarec at gmail dot com
 #include "reosmemoryraster.h"
 #include "reosrasterfilling.h"
 #include "reosrasterwatershed.h"
+#include "reosrasterflowaccumulation.h"
 #include "reos_testutils.h"
+#include <atomic>
+#include <cmath>
+#include <thread>
 #include <fstream>
 
 using namespace testing;
@@ -81,6 +85,254 @@ TEST_F( ReosRasterWatershedTest, RasterFilling )
   EXPECT_TRUE( testFilledDemDir == filledDemDir );
 }
 
+TEST_F( ReosRasterWatershedTest, RasterFillingPriorityFlood )
+{
+  ReosRasterMemory<float> dem;
+
+  std::unique_ptr<ReosRasterFillingPriorityFlood> rasterFilling;
+  rasterFilling.reset( new ReosRasterFillingPriorityFlood( dem, 1.0, 1.0, 100 ) );
+  rasterFilling->start();
+  EXPECT_FALSE( rasterFilling->isSuccessful() );
+
+  dem = ReosRasterMemory<float>( 11, 11 );
+  dem.reserveMemory();
+  dem.fill( 5 );
+  dem.setValue( 0, 5, 3.0 );
+  rasterFilling.reset( new ReosRasterFillingPriorityFlood( dem, 1.0, 1.0, 100 ) );
+  rasterFilling->start();
+  EXPECT_TRUE( rasterFilling->isSuccessful() );
+
+  ReosRasterMemory<float> testFilledDem;
+  testFilledDem.loadDataFromTiffFile( test_file( "filledDem.tiff" ).c_str(), GDALDataType::GDT_Float32 );
+  EXPECT_TRUE( testFilledDem == rasterFilling->filledDEM() );
+
+  // same result than Wang-Liu on real DEMs, with no data cells
+  for ( const std::string &fileName : {std::string( "DEM_for_watershed.tif" ), std::string( "DEM_for_multi_watershed.tif" )} )
+  {
+    ReosRasterMemory<float> realDem;
+    realDem.loadDataFromTiffFile( test_file( fileName ).c_str(), GDALDataType::GDT_Float32 );
+    realDem.setValue( 10, 10, realDem.noData() );
+    realDem.setValue( 10, 11, realDem.noData() );
+
+    ReosRasterFillingWangLiu wangLiu( realDem, 5.0, 5.0, 1000 );
+    wangLiu.start();
+    EXPECT_TRUE( wangLiu.isSuccessful() );
+
+    ReosRasterFillingPriorityFlood priorityFlood( realDem, 5.0, 5.0, 1000 );
+    priorityFlood.start();
+    EXPECT_TRUE( priorityFlood.isSuccessful() );
+    EXPECT_TRUE( wangLiu.filledDEM() == priorityFlood.filledDEM() );
+
+    // other modes have to give drainable DEM
+    ReosRasterFillingPriorityFlood withQueue( realDem, 5.0, 5.0, 1000 );
+    withQueue.setUseQueueForRaisedCells( true );
+    withQueue.start();
+    EXPECT_TRUE( withQueue.isSuccessful() );
+
+    ReosRasterFillingPriorityFlood tiled( realDem, 5.0, 5.0, 1000, ReosRasterFillingPriorityFlood::Tiled );
+    tiled.setTileSize( 17 );
+    tiled.start();
+    EXPECT_TRUE( tiled.isSuccessful() );
+
+    for ( const ReosRasterMemory<float> *filled : {&withQueue.filledDEM(), &tiled.filledDEM()} )
+    {
+      for ( int r = 1; r < filled->rowCount() - 1; ++r )
+        for ( int c = 1; c < filled->columnCount() - 1; ++c )
+        {
+          const float value = filled->value( r, c );
+          if ( value == filled->noData() )
+            continue;
+          EXPECT_TRUE( value >= realDem.value( r, c ) );
+          bool hasLowerNeighbor = false;
+          for ( int i = -1; i <= 1; ++i )
+            for ( int j = -1; j <= 1; ++j )
+            {
+              const float neighborValue = filled->value( r + i, c + j );
+              hasLowerNeighbor |= ( neighborValue == filled->noData() || neighborValue < value );
+            }
+          EXPECT_TRUE( hasLowerNeighbor );
+        }
+    }
+  }
+}
+
+TEST_F( ReosRasterWatershedTest, TiledRaster )
+{
+  ReosRasterMemory<float> tiled( 100, 70 );
+  ASSERT_TRUE( tiled.reserveTiledMemory( 16, 3 ) );
+  EXPECT_TRUE( tiled.isTiled() );
+  EXPECT_TRUE( tiled.isValid() );
+  EXPECT_EQ( tiled.data(), nullptr );
+
+  tiled.fill( 2.5 );
+  for ( int r = 0; r < 100; ++r )
+    tiled.setValue( r, ( r * 7 ) % 70, float( r ) );
+
+  ReosRasterMemory<float> copy = tiled;
+  copy.setValue( 0, 1, -1 );
+  EXPECT_EQ( tiled.value( 0, 1 ), 2.5f );
+  EXPECT_EQ( copy.value( 0, 1 ), -1.0f );
+  EXPECT_EQ( tiled.value( 99, ( 99 * 7 ) % 70 ), 99.0f );
+  EXPECT_EQ( tiled.value( 98, 69 ), 2.5f );
+  EXPECT_TRUE( std::isnan( tiled.value( 100, 0 ) ) );
+
+  // the copy has made its own store, the original one is modified in place without modifying the copy
+  tiled.setValue( 0, 2, -2 );
+  EXPECT_EQ( tiled.value( 0, 2 ), -2.0f );
+  EXPECT_EQ( copy.value( 0, 2 ), 2.5f );
+  EXPECT_EQ( copy.value( 0, 1 ), -1.0f );
+
+  // a copy that has been destroyed does not prevent the modification of the store in place
+  {
+    ReosRasterMemory<float> temporaryCopy = tiled;
+    EXPECT_EQ( temporaryCopy.value( 0, 2 ), -2.0f );
+  }
+  tiled.setValue( 0, 3, -3 );
+  EXPECT_EQ( tiled.value( 0, 3 ), -3.0f );
+  EXPECT_EQ( copy.value( 0, 3 ), 2.5f );
+
+  // concurrent reads on more tiles than the resident ones
+  std::vector<std::thread> threads;
+  std::atomic<int> errorCount( 0 );
+  for ( int t = 0; t < 4; ++t )
+    threads.emplace_back( [&tiled, &errorCount, t]
+  {
+    for ( int i = 0; i < 20; ++i )
+      for ( int r = ( t * 13 ) % 100; r < 100; ++r )
+      {
+        if ( tiled.value( r, ( r * 7 ) % 70 ) != float( r ) )
+          errorCount++;
+      }
+  } );
+  for ( std::thread &thread : threads )
+    thread.join();
+  EXPECT_EQ( errorCount, 0 );
+
+  // Filling, direction and watershed on tiled raster
+  ReosRasterMemory<float> dem;
+  dem.loadDataFromTiffFile( test_file( "DEM_for_watershed.tif" ).c_str(), GDALDataType::GDT_Float32 );
+  ReosRasterMemory<float> tiledDem( dem.rowCount(), dem.columnCount() );
+  ASSERT_TRUE( tiledDem.reserveTiledMemory( 32, 4 ) );
+  tiledDem.setNodata( dem.noData() );
+  tiledDem.writeBlock( 0, 0, dem.rowCount(), dem.columnCount(), static_cast<float *>( dem.data() ) );
+  EXPECT_TRUE( tiledDem == dem );
+
+  ReosRasterFillingWangLiu filling( dem, 5.0, 5.0, 1000 );
+  filling.start();
+  ReosRasterFillingWangLiu tiledFilling( tiledDem, 5.0, 5.0, 1000 );
+  tiledFilling.start();
+  EXPECT_TRUE( tiledFilling.isSuccessful() );
+  EXPECT_TRUE( tiledFilling.filledDEM().isTiled() );
+  EXPECT_TRUE( tiledFilling.filledDEM() == filling.filledDEM() );
+  // original tiled DEM is not modified
+  EXPECT_TRUE( tiledDem == dem );
+
+  ReosRasterWatershedDirectionCalculation directionCalculation( filling.filledDEM() );
+  directionCalculation.start();
+  ReosRasterWatershedDirectionCalculation tiledDirectionCalculation( tiledFilling.filledDEM() );
+  tiledDirectionCalculation.start();
+  EXPECT_TRUE( tiledDirectionCalculation.directions().isTiled() );
+  EXPECT_TRUE( tiledDirectionCalculation.directions() == directionCalculation.directions() );
+
+  ReosRasterWatershed::Directions directions;
+  directions.loadDataFromTiffFile( test_file( "filledDemDir.tiff" ).c_str(), GDALDataType::GDT_Byte );
+  ReosRasterWatershed::Directions tiledDirections( directions.rowCount(), directions.columnCount() );
+  ASSERT_TRUE( tiledDirections.reserveTiledMemory( 4, 2 ) );
+  tiledDirections.writeBlock( 0, 0, directions.rowCount(), directions.columnCount(), static_cast<unsigned char *>( directions.data() ) );
+
+  ReosRasterLine downStreamLine;
+  downStreamLine.addPoint( 2, 4 );
+  downStreamLine.addPoint( 2, 9 );
+  ReosRasterWatershedFromDirectionAndDownStreamLine watershedDelineate( tiledDirections, downStreamLine );
+  watershedDelineate.start();
+
+  ReosRasterWatershed::Watershed testWatershed;
+  testWatershed.loadDataFromTiffFile( test_file( "watershed.tiff" ).c_str(), GDALDataType::GDT_Byte );
+  EXPECT_TRUE( watershedDelineate.watershed().isTiled() );
+  EXPECT_TRUE( testWatershed == watershedDelineate.watershed() );
+}
+
+//! Cell by cell calculation of the directions, used as reference
+static ReosRasterWatershed::Directions referenceDirections( const ReosRasterWatershed::Dem &dem )
+{
+  ReosRasterWatershed::Directions directions( dem.rowCount(), dem.columnCount() );
+  directions.reserveMemory();
+  for ( int row = 0; row < dem.rowCount(); ++row )
+    for ( int column = 0; column < dem.columnCount(); ++column )
+    {
+      float centralValue = dem.value( row, column );
+      unsigned char retDir = 4;
+      if ( centralValue == dem.noData() )
+        retDir = 9;
+      else
+      {
+        float dzmin = 0;
+        for ( unsigned char i = 0; i < 3; ++i )
+          for ( unsigned char j = 0; j < 3; ++j )
+          {
+            if ( i == 1 && j == 1 )
+              continue;
+            float z = dem.value( row - 1 + i, column - 1 + j );
+            if ( z == dem.noData() )
+              continue;
+            float dz = ( z - centralValue );
+            unsigned char dir = i + 3 * j;
+            if ( dir % 2 == 0 )
+              dz = dz / sqrt( 2 );
+            if ( dz < dzmin )
+            {
+              retDir = dir;
+              dzmin = dz;
+            }
+          }
+      }
+      directions.setValue( row, column, retDir );
+    }
+
+  return directions;
+}
+
+TEST_F( ReosRasterWatershedTest, DirectionByBands )
+{
+  // large DEM built from the test DEM with noise, flat areas and no data cells
+  ReosRasterMemory<float> sourceDem;
+  sourceDem.loadDataFromTiffFile( test_file( "DEM_for_watershed.tif" ).c_str(), GDALDataType::GDT_Float32 );
+  const int rowCount = 2000;
+  const int columnCount = 1500;
+  ReosRasterWatershed::Dem dem( rowCount, columnCount );
+  ASSERT_TRUE( dem.reserveMemory() );
+  dem.setNodata( -9999 );
+  for ( int r = 0; r < rowCount; ++r )
+    for ( int c = 0; c < columnCount; ++c )
+    {
+      float value = sourceDem.value( r % sourceDem.rowCount(), c % sourceDem.columnCount() );
+      if ( value == sourceDem.noData() || ( r * 31 + c * 17 ) % 997 == 0 )
+        value = -9999;
+      else if ( ( r / 50 ) % 7 != 0 )
+        value += float( ( r * 13 + c * 7 ) % 11 ) * 0.25f;
+      dem.setValue( r, c, value );
+    }
+
+  // directions calculated by bands are the same as the ones calculated cell by cell
+  ReosRasterWatershedDirectionCalculation directionCalculation( dem );
+  directionCalculation.start();
+  EXPECT_TRUE( directionCalculation.isSuccessful() );
+  EXPECT_TRUE( directionCalculation.directions() == referenceDirections( dem ) );
+
+  // no data as NaN
+  ReosRasterWatershed::Dem nanDem( 300, 200 );
+  ASSERT_TRUE( nanDem.reserveMemory() );
+  for ( int r = 0; r < 300; ++r )
+    for ( int c = 0; c < 200; ++c )
+    {
+      const float value = dem.value( r, c );
+      nanDem.setValue( r, c, value == dem.noData() ? std::numeric_limits<float>::quiet_NaN() : value );
+    }
+  ReosRasterWatershedDirectionCalculation nanDirectionCalculation( nanDem );
+  nanDirectionCalculation.start();
+  EXPECT_TRUE( nanDirectionCalculation.directions() == referenceDirections( nanDem ) );
+}
+
 TEST_F( ReosRasterWatershedTest, PlanDEM_1 )
 {
   ReosRasterMemory<float> dem( 10, 10 );
@@ -152,6 +404,119 @@ TEST_F( ReosRasterWatershedTest, Delineate )
   EXPECT_TRUE( traceDownstreamPolyline == testTraceDownstream );
 }
 
+//! Returns the length of the flow path from \a cell to the first cell of \a line met
+static double flowPathLength( const ReosRasterWatershed::Directions &directions, ReosRasterCellPos cell, const ReosRasterLine &line )
+{
+  double length = 0;
+  while ( true )
+  {
+    for ( unsigned i = 0; i < line.cellCount(); ++i )
+      if ( line.cellPosition( i ) == cell )
+        return length;
+    const unsigned char direction = directions.value( cell );
+    if ( direction > 8 || direction == 4 )
+      return -1;
+    length += direction % 2 == 0 ? std::sqrt( 2.0 ) : 1.0;
+    cell = ReosRasterCellPos( cell.row() + direction % 3 - 1, cell.column() + direction / 3 - 1 );
+  }
+}
+
+TEST_F( ReosRasterWatershedTest, FlowAccumulation )
+{
+  ReosRasterWatershed::Directions directions;
+  directions.loadDataFromTiffFile( test_file( "filledDemDir.tiff" ).c_str(), GDALDataType::GDT_Byte );
+
+  ReosRasterFlowAccumulation flowAccumulation( directions );
+  flowAccumulation.start();
+  ASSERT_TRUE( flowAccumulation.isSuccessful() );
+
+  // accumulation of each cell is the sum of the accumulation of the upstream cells plus one
+  const ReosRasterWatershed::Accumulation accumulation = flowAccumulation.accumulation();
+  for ( int r = 0; r < directions.rowCount(); ++r )
+    for ( int c = 0; c < directions.columnCount(); ++c )
+    {
+      if ( directions.value( r, c ) == 9 )
+      {
+        EXPECT_EQ( accumulation.value( r, c ), 0 );
+        continue;
+      }
+      int expected = 1;
+      for ( int i = 0; i < 3; ++i )
+        for ( int j = 0; j < 3; ++j )
+        {
+          ReosRasterCellPos neighbor( r + i - 1, c + j - 1 );
+          if ( ( i != 1 || j != 1 ) && neighbor.row() >= 0 && neighbor.row() < directions.rowCount() &&
+               neighbor.column() >= 0 && neighbor.column() < directions.columnCount() &&
+               directions.value( neighbor ) == 8 - ( i + 3 * j ) )
+            expected += accumulation.value( neighbor );
+        }
+      EXPECT_EQ( accumulation.value( r, c ), expected );
+    }
+
+  // delineation by label propagation gives the same watershed than the climbing
+  ReosRasterLine downStreamLine;
+  downStreamLine.addPoint( 2, 4 );
+  downStreamLine.addPoint( 2, 9 );
+  ReosRasterWatershed::Watershed testWatershed;
+  testWatershed.loadDataFromTiffFile( test_file( "watershed.tiff" ).c_str(), GDALDataType::GDT_Byte );
+  EXPECT_TRUE( flowAccumulation.watershed( downStreamLine ) == testWatershed );
+
+  // nested outlets, the cells upstream the inner outlet have its label
+  ReosRasterLine innerOutlet;
+  innerOutlet.addPoint( 6, 5 );
+  const ReosRasterWatershed::Watershed innerWatershed = flowAccumulation.watershed( innerOutlet );
+  const ReosRasterMemory<int> labels = flowAccumulation.upstreamLabels( QVector<ReosRasterLine>() << downStreamLine << innerOutlet );
+  int innerCount = 0;
+  for ( int r = 0; r < directions.rowCount(); ++r )
+    for ( int c = 0; c < directions.columnCount(); ++c )
+    {
+      if ( innerWatershed.value( r, c ) == 1 )
+      {
+        EXPECT_EQ( labels.value( r, c ), 2 );
+        innerCount++;
+      }
+      else if ( testWatershed.value( r, c ) == 1 )
+        EXPECT_EQ( labels.value( r, c ), 1 );
+      else
+        EXPECT_EQ( labels.value( r, c ), 0 );
+    }
+  EXPECT_TRUE( innerCount > 0 );
+
+  // the longer paths of nested outlets are the ones of the outlets delineated alone
+  QVector<ReosRasterCellPos> endsOfLongerPath;
+  flowAccumulation.upstreamLabels( QVector<ReosRasterLine>() << downStreamLine << innerOutlet, &endsOfLongerPath );
+  ASSERT_EQ( endsOfLongerPath.count(), 2 );
+  ReosRasterWatershedFromDirectionAndDownStreamLine outerDelineate( directions, downStreamLine );
+  outerDelineate.start();
+  ReosRasterWatershedFromDirectionAndDownStreamLine innerDelineate( directions, innerOutlet );
+  innerDelineate.start();
+  const double outerLength = flowPathLength( directions, outerDelineate.endOfLongerPath(), downStreamLine );
+  const double innerLength = flowPathLength( directions, innerDelineate.endOfLongerPath(), innerOutlet );
+  EXPECT_TRUE( outerLength > 0 );
+  EXPECT_TRUE( equal( flowPathLength( directions, endsOfLongerPath.at( 0 ), downStreamLine ), outerLength, 0.000001 ) );
+  EXPECT_TRUE( equal( flowPathLength( directions, endsOfLongerPath.at( 1 ), innerOutlet ), innerLength, 0.000001 ) );
+
+  // snapped outlet has the greatest accumulation around
+  const ReosRasterCellPos snapped = flowAccumulation.snapOutlet( ReosRasterCellPos( 5, 5 ), 2 );
+  for ( int r = 3; r <= 7; ++r )
+    for ( int c = 3; c <= 7; ++c )
+      EXPECT_TRUE( flowAccumulation.accumulation( r, c ) <= flowAccumulation.accumulation( snapped.row(), snapped.column() ) );
+
+  // each segment of the stream network ends on the first point of its downstream segment
+  ReosRasterExtent extent( ReosMapExtent( 0, 0, 11, 11 ), 11, 11 );
+  const QVector<ReosRasterFlowAccumulation::StreamSegment> streams = flowAccumulation.streamNetwork( 3, extent );
+  EXPECT_FALSE( streams.isEmpty() );
+  for ( const ReosRasterFlowAccumulation::StreamSegment &segment : streams )
+  {
+    EXPECT_TRUE( segment.accumulation >= 3 );
+    if ( segment.downstreamSegment >= 0 )
+    {
+      EXPECT_TRUE( segment.polyline.count() > 1 );
+      EXPECT_EQ( segment.polyline.last(), streams.at( segment.downstreamSegment ).polyline.first() );
+    }
+  }
+}
+
 int main( int argc, char **argv )
 {
   testing::InitGoogleTest( &argc, argv );
@@ -19,6 +19,7 @@ email                : vcloarec at gmail dot com
 
 #include "reoswatersheddelineating.h"
 #include "reosrunoffmodel.h"
+#include "reosrunoffbatch.h"
 #include "reossyntheticrainfall.h"
 #include "reostransferfunction.h"
 #include "reoswatershedtree.h"
@@ -37,8 +38,11 @@ class ReosWatersehdTest: public QObject
     void watershedDelineating();
     void watershedDelineatingWithBurningLine();
     void watershdDelineatingMultiWatershed();
+    void watershedBatchDelineating();
     void concentrationTime();
     void runoffConstantCoefficient();
+    void runoffBatch();
+    void runoffCurveNumber();
 
     void runoffhydrograph();
 
@@ -677,6 +681,25 @@ void ReosWatersehdTest::watershdDelineatingMultiWatershed()
   QCOMPARE( newTree.watershedCount(), 6 );
   QVERIFY( *newTree.masterWatershed( 0 ) == *watershedStore.masterWatershed( 0 ) );
   QVERIFY( newTree.masterWatershed( 0 )->hasDirectiondata( layerId ) );
+  QCOMPARE( watershedStore.directionRasterStore().entryCount(), 1 );
+  QCOMPARE( newTree.directionRasterStore().entryCount(), 1 );
+  QVERIFY( newTree.masterWatershed( 0 )->directions( layerId ) == watershedStore.masterWatershed( 0 )->directions( layerId ) );
+
+  // Test encoding with direction rasters loaded on demand
+  int loadCount = 0;
+  const ReosEncodedElement encodedDirections = watershedStore.encodeDirectionRasters();
+  ReosWatershedTree lazyTree( &gisEngine );
+  lazyTree.decode( watershedStore.encode( false ), [&loadCount, encodedDirections]
+  {
+    loadCount++;
+    return encodedDirections;
+  } );
+  QCOMPARE( lazyTree.watershedCount(), 6 );
+  QVERIFY( lazyTree.masterWatershed( 0 )->hasDirectiondata( layerId ) );
+  QCOMPARE( loadCount, 0 );
+  QVERIFY( lazyTree.masterWatershed( 0 )->directions( layerId ) == watershedStore.masterWatershed( 0 )->directions( layerId ) );
+  QCOMPARE( loadCount, 1 );
+  QVERIFY( !lazyTree.directionRasterStore().hasChanged() );
 
   // Test extraction
   std::unique_ptr<ReosWatershed> removedWs( watershedStore.extractWatershed( watershed2 ) );
@@ -686,6 +709,57 @@ void ReosWatersehdTest::watershdDelineatingMultiWatershed()
 
 
 
+void ReosWatersehdTest::watershedBatchDelineating()
+{
+  ReosWatershedTree watershedStore( &gisEngine );
+  ReosWatershedDelineating watershedDelineating( &rootModule, &watershedStore, &gisEngine );
+  ReosWatershedItemModel itemModel( &watershedStore );
+  std::unique_ptr<ModuleProcessControler> controler;
+
+  QString layerId = gisEngine.addRasterLayer( test_file( "DEM_for_multi_watershed.tif" ).c_str(), QStringLiteral( "raster_DEM" ) );
+  QVERIFY( gisEngine.registerLayerAsDigitalElevationModel( layerId ) );
+  QVERIFY( watershedDelineating.setDigitalElevationModelDEM( layerId ) );
+
+  // same downstream lines as in watershdDelineatingMultiWatershed(), delineated at once
+  QList<QPolygonF> downstreamLines;
+  downstreamLines << QPolygonF( {QPointF( 666701.724, 1799132.754 ), QPointF( 666692.005, 1799212.636 )} )
+                  << QPolygonF( {QPointF( 666526.94, 1799174.90 ), QPointF( 666664.30, 1799227.25 )} )
+                  << QPolygonF( {QPointF( 666506.3, 1799336.8 ), QPointF( 666599.38, 1799355.69 )} )
+                  << QPolygonF( {QPointF( 666453.28, 1799229.84 ), QPointF( 666495.14, 1799321.72 )} );
+
+  ReosMapExtent predifinedExtent( 666407.06, 1798920, 667146.31, 1799678.08 );
+  QVERIFY( !watershedDelineating.prepareBatchDelineating( downstreamLines, ReosMapExtent( 666503.15, 1798940.06, 666600, 1799000 ) ) );
+  QVERIFY( watershedDelineating.prepareBatchDelineating( downstreamLines, predifinedExtent ) );
+  QVERIFY( watershedDelineating.currentState() == ReosWatershedDelineating::WaitingForDownstream );
+  controler.reset( new ModuleProcessControler( watershedDelineating.batchDelineatingProcess() ) );
+  controler->waitForFinished();
+
+  const QList<ReosWatershed *> watersheds = watershedDelineating.storeBatchWatersheds( true );
+  QCOMPARE( watersheds.count(), 4 );
+  QVERIFY( !watersheds.contains( nullptr ) );
+
+  QCOMPARE( watershedStore.masterWatershedCount(), 1 );
+  QCOMPARE( watershedStore.watershedCount(), 6 ); //including residual watershed
+  QVERIFY( watersheds.at( 3 )->downstreamWatershed() == nullptr );
+  QVERIFY( watersheds.at( 3 )->hasDirectiondata( layerId ) );
+  QCOMPARE( watersheds.at( 3 )->directUpstreamWatershedCount(), 3 ); //including residual watershed
+  QVERIFY( watersheds.at( 1 )->downstreamWatershed() == watersheds.at( 3 ) );
+  QVERIFY( watersheds.at( 2 )->downstreamWatershed() == watersheds.at( 3 ) );
+  QVERIFY( watersheds.at( 0 )->downstreamWatershed() == watersheds.at( 1 ) );
+  QCOMPARE( watersheds.at( 1 )->directUpstreamWatershedCount(), 2 ); //including residual watershed
+  QCOMPARE( itemModel.rowCount( QModelIndex() ), 1 );
+  QCOMPARE( itemModel.rowCount( itemModel.index( 0, 0, QModelIndex() ) ), 3 );
+
+  for ( ReosWatershed *watershed : watersheds )
+  {
+    QVERIFY( watershed->delineating().count() > 3 );
+    QVERIFY( watersheds.at( 3 )->contain( watershed->outletPoint() ) );
+  }
+
+  // the process is consumed
+  QVERIFY( watershedDelineating.storeBatchWatersheds( true ).isEmpty() );
+}
+
 void ReosWatersehdTest::concentrationTime()
 {
   ReosConcentrationTimeCalculation calculation;
@@ -787,6 +861,13 @@ void ReosWatersehdTest::runoffConstantCoefficient()
 
   ReosRunoff runoff( &modelsGroup, &chicagoRainfall );
   QVERIFY( runoff.isObsolete() );
+
+  // the hash of the data the runoff is calculated from is obtained without calculating the runoff
+  QByteArray inputHash = runoff.inputHash();
+  QVERIFY( !inputHash.isEmpty() );
+  QVERIFY( runoff.isObsolete() );
+  QVERIFY( inputHash == runoff.inputHash() );
+
   runoff.updateValues();
   QVERIFY( !runoff.isObsolete() );
 
@@ -800,6 +881,8 @@ void ReosWatersehdTest::runoffConstantCoefficient()
   chicagoRainfall.setValueAt( 5, 10 );
   QVERIFY( equal( chicagoRainfall.valueAt( 5 ), 10, 0.001 ) );
   QVERIFY( runoff.isObsolete() );
+  QVERIFY( runoff.inputHash() != inputHash );
+  inputHash = runoff.inputHash();
 
   QVERIFY( equal( runoff.value( 5 ), 5, 0.001 ) );
   QVERIFY( !runoff.isObsolete() );
@@ -811,6 +894,7 @@ void ReosWatersehdTest::runoffConstantCoefficient()
 
   runoffConstantCoefficientModel_1.coefficient()->setValue( 0.1 );
   QVERIFY( runoff.isObsolete() );
+  QVERIFY( runoff.inputHash() != inputHash );
   QVERIFY( equal( runoff.value( 5 ), 1, 0.001 ) );
   QVERIFY( !runoff.isObsolete() );
 
@@ -897,6 +981,14 @@ void ReosWatersehdTest::runoffConstantCoefficient()
     QCOMPARE( values.at( i ).second,  hydrograph->valueAt( i ) );
   }
 
+  // the calculation can be created before the runoff is known, runoff values being set just before it is started
+  std::unique_ptr<ReosTransferFunctionCalculation> calculation( linearReservoir->createCalculation( chicagoRainfall.timeStep(), chicagoRainfall.referenceTime() ) );
+  QVERIFY( calculation );
+  calculation->setRunoffData( runoff.data()->constData() );
+  calculation->start();
+  QVERIFY( calculation->isSuccessful() );
+  QVERIFY( *calculation->hydrograph() == *hydrograph );
+
   watershed.concentrationTime()->setValue( ReosDuration( 32, ReosDuration::minute ) );
   ReosTransferFunctionGeneralizedRationalMethod *rationalUH = new ReosTransferFunctionGeneralizedRationalMethod( &watershed );
   hydrograph.reset( rationalUH->applyFunction( &runoff ) );
@@ -944,89 +1036,39 @@ void ReosWatersehdTest::runoffConstantCoefficient()
 
   values.clear();
   values << QPair<int, double>( {0, 0} ) <<
-         QPair<int, double>( {130200,  0.319926055137039} ) <<
-         QPair<int, double>( {260400,  1.06642018379013} ) <<
-         QPair<int, double>( {390600,  2.26550057491395} ) <<
-         QPair<int, double>( {520800,  4.20817233027324} ) <<
-         QPair<int, double>( {651000,  7.02431845458297} ) <<
-         QPair<int, double>( {781200,  10.8963338421879} ) <<
-         QPair<int, double>( {911400,  15.3147268596325} ) <<
-         QPair<int, double>( {1041600, 20.3236707781381} ) <<
-         QPair<int, double>( {1171800, 25.6415843472443} ) <<
-         QPair<int, double>( {1302000, 31.1060218206529} ) <<
-         QPair<int, double>( {1432200, 37.0000812405754} ) <<
-         QPair<int, double>( {1562400, 42.6513188920306} ) <<
-         QPair<int, double>( {1692600, 48.9027953353517} ) <<
-         QPair<int, double>( {1822800, 54.984280391843} ) <<
-         QPair<int, double>( {1953000, 61.1388720401515} ) <<
-         QPair<int, double>( {2083200, 67.0090218394755} ) <<
-         QPair<int, double>( {2213400, 72.540068314109} ) <<
-         QPair<int, double>( {  2343600, 77.9630280130392} ) <<
-         QPair<int, double>( {2473800, 82.1455099278323} ) <<
-         QPair<int, double>( {2604000, 85.9232406016311} ) <<
-         QPair<int, double>( {2734200, 88.2622236031578} ) <<
-         QPair<int, double>( {2864400, 89.7978491906397} ) <<
-         QPair<int, double>( {2994600, 90.2227890881551} ) <<
-         QPair<int, double>( {3124800, 89.5807645375469} ) <<
-         QPair<int, double>( {3255000, 88.6158159488254} ) <<
-         QPair<int, double>( {3385200, 86.6115087005479} ) <<
-         QPair<int, double>( {3515400, 84.6608918268563} ) <<
-         QPair<int, double>( {3645600, 81.9994960778087} ) <<
-         QPair<int, double>( {3775800, 79.2586173949161} ) <<
-         QPair<int, double>( {3906000, 76.0617789004734} ) <<
-         QPair<int, double>( {4036200, 72.3741138246314} ) <<
-         QPair<int, double>( {4166400, 68.3562871127761} ) <<
-         QPair<int, double>( {4296600, 63.376007017574} ) <<
-         QPair<int, double>( {4426800, 58.2233822770845} ) <<
-         QPair<int, double>( {4557000, 52.4865587235491} ) <<
-         QPair<int, double>( {4687200, 46.8431506867218} ) <<
-         QPair<int, double>( {4817400, 41.2781916489604} ) <<
-         QPair<int, double>( {4947600, 35.8830422786034} ) <<
-         QPair<int, double>( {5077800, 30.9438555299734} ) <<
-         QPair<int, double>( {5208000, 26.3836442394093} ) <<
-         QPair<int, double>( {5338200, 22.3926271082785} ) <<
-         QPair<int, double>( {5468400, 18.8591844830841} ) <<
-         QPair<int, double>( {5598600, 15.9792947744262} ) <<
-         QPair<int, double>( {5728800, 13.6112908557051} ) <<
-         QPair<int, double>( {5859000, 11.5549737768769} ) <<
-         QPair<int, double>( {5989200, 9.86825507416119} ) <<
-         QPair<int, double>( {6119400, 8.37254301421143} ) <<
-         QPair<int, double>( {6249600, 7.13523894666032} ) <<
-         QPair<int, double>( {6379800, 6.02660504843071} ) <<
-         QPair<int, double>( {6510000, 5.11908274748348} ) <<
-         QPair<int, double>( {6549600, 4.87114175434491} ) <<
-         QPair<int, double>( {6679800, 4.12096400845863} ) <<
-         QPair<int, double>( {6810000, 3.49861339699591} ) <<
-         QPair<int, double>( {6849600, 3.32501324254422} ) <<
-         QPair<int, double>( {6979800, 2.8140770102472} ) <<
-         QPair<int, double>( {7110000, 2.37427815557269} ) <<
-         QPair<int, double>( {7149600, 2.25442576158561} ) <<
-         QPair<int, double>( {7279800, 1.90645048894117} ) <<
-         QPair<int, double>( {7410000, 1.59554234372908} ) <<
-         QPair<int, double>( {7449600, 1.51463979805148} ) <<
-         QPair<int, double>( {7579800, 1.27317697289775} ) <<
-         QPair<int, double>( {7710000, 1.05102293897201} ) <<
-         QPair<int, double>( {7749600, 0.997510805043472} ) <<
-         QPair<int, double>( {7879800, 0.828053321544088} ) <<
-         QPair<int, double>( {8010000, 0.673801851328885} ) <<
-         QPair<int, double>( {8049600, 0.639317391544571} ) <<
-         QPair<int, double>( {8179800, 0.525936667708267} ) <<
-         QPair<int, double>( {8310000, 0.425108789977906} ) <<
-         QPair<int, double>( {8349600, 0.402633266276684} ) <<
-         QPair<int, double>( {8479800, 0.32873646865297} ) <<
-         QPair<int, double>( {8610000, 0.262123464604087} ) <<
-         QPair<int, double>( {8649600, 0.247197720123718} ) <<
-         QPair<int, double>( {8779800, 0.198123681453414} ) <<
-         QPair<int, double>( {8910000, 0.149885087166725} ) <<
-         QPair<int, double>( {8949600, 0.139436314475832} ) <<
-         QPair<int, double>( {9079800, 0.105082016386076} ) <<
-         QPair<int, double>( {9210000, 0.071525937034092} ) <<
-         QPair<int, double>( {9249600, 0.065183480209885} ) <<
-         QPair<int, double>( {9379800, 0.044330250954536} ) <<
-         QPair<int, double>( {9510000, 0.023477021699188} ) <<
-         QPair<int, double>( {9549600, 0.020378054834895} ) <<
-         QPair<int, double>( {9679800, 0.010189027417447} ) <<
-         QPair<int, double>( {9810000, 0} );
+         QPair<int, double>( {300000,  1.35833428018245} ) <<
+         QPair<int, double>( {600000,  5.80393271645834} ) <<
+         QPair<int, double>( {900000,  14.8677818936543} ) <<
+         QPair<int, double>( {1200000,  26.778414235086} ) <<
+         QPair<int, double>( {1500000,  39.9237327833578} ) <<
+         QPair<int, double>( {1800000,  53.9197902125136} ) <<
+         QPair<int, double>( {2100000,  67.7412767758046} ) <<
+         QPair<int, double>( {2400000,  79.9807551978083} ) <<
+         QPair<int, double>( {2700000,  87.8304884865413} ) <<
+         QPair<int, double>( {3000000,  90.2122927670346} ) <<
+         QPair<int, double>( {3300000,  88.0326914032796} ) <<
+         QPair<int, double>( {3600000,  83.0696713385472} ) <<
+         QPair<int, double>( {3900000,  76.2142196466497} ) <<
+         QPair<int, double>( {4200000,  67.1683918149383} ) <<
+         QPair<int, double>( {4500000,  55.0472470644769} ) <<
+         QPair<int, double>( {4800000,  42.0062301569946} ) <<
+         QPair<int, double>( {5100000,  30.1577429339181} ) <<
+         QPair<int, double>( {5400000,  20.6474666755913} ) <<
+         QPair<int, double>( {5700000,  14.1106185264151} ) <<
+         QPair<int, double>( {6000000,  9.73685133073609} ) <<
+         QPair<int, double>( {6300000,  6.68948761338162} ) <<
+         QPair<int, double>( {6600000,  4.56561896754339} ) <<
+         QPair<int, double>( {6900000,  3.11308469983342} ) <<
+         QPair<int, double>( {7200000,  2.11021425030864} ) <<
+         QPair<int, double>( {7500000,  1.41955873340565} ) <<
+         QPair<int, double>( {7800000,  0.931914359817905} ) <<
+         QPair<int, double>( {8100000,  0.595428079091809} ) <<
+         QPair<int, double>( {8400000,  0.374028054293311} ) <<
+         QPair<int, double>( {8700000,  0.228201318057795} ) <<
+         QPair<int, double>( {9000000,  0.126137876505604} ) <<
+         QPair<int, double>( {9300000,  0.0571112624336212} ) <<
+         QPair<int, double>( {9600000,  0.0164339151894314} ) <<
+         QPair<int, double>( {9900000,  0} );
 
   QCOMPARE( hydrograph->valueCount(), values.count() );
   for ( int i = 0; i < hydrograph->valueCount(); ++i )
@@ -1123,6 +1165,152 @@ void ReosWatersehdTest::runoffConstantCoefficient()
 
 }
 
+void ReosWatersehdTest::runoffBatch()
+{
+  ReosModule root;
+  ReosIdfFormulaRegistery::instantiate( &root );
+  ReosIdfFormulaRegistery *idfRegistery = ReosIdfFormulaRegistery::instance();
+  idfRegistery->registerFormula( new ReosIdfFormulaMontana );
+
+  ReosIntensityDurationCurve idCurve;
+  idCurve.addInterval( ReosDuration( 5, ReosDuration::minute ), ReosDuration( 1, ReosDuration::hour ) );
+  idCurve.createParameters( 0, idfRegistery->formula( QStringLiteral( "Montana" ) ), ReosDuration::minute, ReosDuration::minute );
+  idCurve.setCurrentFormula( QStringLiteral( "Montana" ) );
+  idCurve.setupFormula( idfRegistery );
+  idCurve.currentParameters( 0 )->parameter( 0 )->setValue( 4.78 );
+  idCurve.currentParameters( 0 )->parameter( 1 )->setValue( 0.322 );
+  ReosChicagoRainfall chicagoRainfall;
+  chicagoRainfall.timeStepParameter()->setValue( ReosDuration( 5, ReosDuration::minute ) );
+  chicagoRainfall.totalDuration()->setValue( ReosDuration( 1, ReosDuration::hour ) );
+  chicagoRainfall.setIntensityDurationCurve( &idCurve );
+  QCOMPARE( chicagoRainfall.valueCount(), 12 );
+
+  // second rainfall, twice the first one
+  ReosTimeSerieConstantInterval strongerRainfall;
+  strongerRainfall.setTimeStep( ReosDuration( 5, ReosDuration::minute ) );
+  for ( int i = 0; i < chicagoRainfall.valueCount(); ++i )
+    strongerRainfall.appendValue( chicagoRainfall.valueAt( i ) * 2 );
+
+  QVector<double> rainfalls;
+  for ( int i = 0; i < chicagoRainfall.valueCount(); ++i )
+    rainfalls.append( chicagoRainfall.valueAt( i ) );
+  for ( int i = 0; i < strongerRainfall.valueCount(); ++i )
+    rainfalls.append( strongerRainfall.valueAt( i ) );
+
+  ReosRunoffConstantCoefficientModel constantCoefficientModel( "constant" );
+  constantCoefficientModel.coefficient()->setValue( 0.5 );
+  ReosRunoffGreenAmptModel greenAmptModel( "green-ampt" );
+  ReosRunoffCurveNumberModel curveNumberModel( "curve-number" );
+  curveNumberModel.curveNumber()->setValue( 85 );
+
+  ReosRunoffModelsGroup group1;
+  group1.addRunoffModel( &constantCoefficientModel );
+  group1.addRunoffModel( &greenAmptModel );
+  group1.coefficient( 0 )->setValue( 0.3 );
+  group1.coefficient( 1 )->setValue( 0.7 );
+
+  ReosRunoffModelsGroup group2;
+  group2.addRunoffModel( &curveNumberModel );
+
+  ReosRunoffBatch batch;
+  QVERIFY( !batch.calculate() );
+  batch.setRainfalls( rainfalls, chicagoRainfall.valueCount(), chicagoRainfall.timeStep() );
+  QCOMPARE( batch.rainfallCount(), 2 );
+  QCOMPARE( batch.valueCount(), 12 );
+
+  const int watershed1 = batch.addWatershed();
+  const int watershed2 = batch.addWatershed();
+  QVERIFY( batch.addRunoffModelsGroup( watershed1, &group1 ) );
+  QVERIFY( batch.addRunoffModelsGroup( watershed2, &group2 ) );
+  QCOMPARE( batch.watershedCount(), 2 );
+
+  QVERIFY( batch.calculate() );
+  QVERIFY( batch.hasResults() );
+  QCOMPARE( batch.results().count(), 2 * 2 * 12 );
+  QVERIFY( batch.runoff( 2, 0 ) == nullptr );
+
+  // results must be the same as the ones of the runoff applied on each watershed and each rainfall
+  QList<ReosRunoffModelsGroup *> groups( {&group1, &group2} );
+  QList<ReosTimeSerieConstantInterval *> rainfallSeries( {&chicagoRainfall, &strongerRainfall} );
+  double totalRunoff = 0;
+  for ( int w = 0; w < groups.count(); ++w )
+  {
+    for ( int r = 0; r < rainfallSeries.count(); ++r )
+    {
+      ReosRunoff runoff( groups.at( w ), rainfallSeries.at( r ) );
+      runoff.updateValues();
+      const double *batchRunoff = batch.runoff( w, r );
+      QVERIFY( batchRunoff );
+      QCOMPARE( runoff.valueCount(), batch.valueCount() );
+      for ( int i = 0; i < runoff.valueCount(); ++i )
+      {
+        QVERIFY( equal( batchRunoff[i], runoff.value( i ), 0.000001 ) );
+        totalRunoff += batchRunoff[i];
+      }
+    }
+  }
+  QVERIFY( totalRunoff > 0 );
+
+  // hand computed values, rainfalls of 10 mm and 20 mm per hour during 4 hours on one watershed,
+  // half with a constant coefficient of 0.4, half with CN = 80 (S = 25400 / 80 - 254 = 63.5 mm) and Ia = 10 mm
+  ReosRunoffBatch simpleBatch;
+  simpleBatch.setRainfalls( {10, 10, 10, 10, 20, 20, 20, 20}, 4, ReosDuration( 1, ReosDuration::hour ) );
+  const int watershed = simpleBatch.addWatershed();
+  simpleBatch.addConstantCoefficient( watershed, 0.4, 0.5 );
+  simpleBatch.addCurveNumber( watershed, 80, 10, 0.5 );
+  QVERIFY( simpleBatch.calculate() );
+
+  // runoff = 0.5 x 0.4 x rainfall + 0.5 x ( R(t) - R(t-1) ), with R = ( P - Ia )^2 / ( P - Ia + S ) and P the cumulative rainfall
+  const double *runoff10 = simpleBatch.runoff( watershed, 0 );
+  QVERIFY( equal( runoff10[0], 2, 0.000001 ) );
+  QVERIFY( equal( runoff10[1], 2.680272, 0.000001 ) ); // 2 + 0.5 x 10^2 / 73.5
+  QVERIFY( equal( runoff10[2], 3.714937, 0.000001 ) ); // 2 + 0.5 x ( 20^2 / 83.5 - 10^2 / 73.5 )
+  QVERIFY( equal( runoff10[3], 4.417625, 0.000001 ) ); // 2 + 0.5 x ( 30^2 / 93.5 - 20^2 / 83.5 )
+
+  const double *runoff20 = simpleBatch.runoff( watershed, 1 );
+  QVERIFY( equal( runoff20[0], 4.680272, 0.000001 ) ); // 4 + 0.5 x 10^2 / 73.5
+  QVERIFY( equal( runoff20[1], 8.132562, 0.000001 ) ); // 4 + 0.5 x ( 30^2 / 93.5 - 10^2 / 73.5 )
+  QVERIFY( equal( runoff20[2], 10.200382, 0.000001 ) ); // 4 + 0.5 x ( 50^2 / 113.5 - 30^2 / 93.5 )
+  QVERIFY( equal( runoff20[3], 11.338844, 0.000001 ) ); // 4 + 0.5 x ( 70^2 / 133.5 - 50^2 / 113.5 )
+}
+
+void ReosWatersehdTest::runoffCurveNumber()
+{
+  // 10 mm per hour during 4 hours
+  ReosTimeSerieConstantInterval rainfall;
+  rainfall.setTimeStep( ReosDuration( 1, ReosDuration::hour ) );
+  for ( int i = 0; i < 4; ++i )
+    rainfall.appendValue( 10 );
+
+  // CN = 80 --> S = 25400 / 80 - 254 = 63.5 mm
+  // cumulative runoff R = ( P - Ia )^2 / ( P - Ia + S ) if P > Ia, with P the cumulative rainfall
+  ReosRunoffCurveNumberModel curveNumberModel( "curve-number" );
+  curveNumberModel.curveNumber()->setValue( 80 );
+  ReosRunoffModelsGroup group;
+  group.addRunoffModel( &curveNumberModel );
+  ReosRunoff runoff( &group, &rainfall );
+
+  // Ia = 0.2 x S = 12.7 mm
+  QVERIFY( curveNumberModel.initialRetentionFromS()->value() );
+  QVERIFY( equal( curveNumberModel.initialRetentionValue(), 12.7, 0.000001 ) );
+  runoff.updateValues();
+  QCOMPARE( runoff.valueCount(), 4 );
+  QVERIFY( equal( runoff.value( 0 ), 0, 0.000001 ) );
+  QVERIFY( equal( runoff.value( 1 ), 0.752684, 0.000001 ) ); // 7.3^2 / 70.8
+  QVERIFY( equal( runoff.value( 2 ), 2.951401, 0.000001 ) ); // 17.3^2 / 80.8 - 7.3^2 / 70.8
+  QVERIFY( equal( runoff.value( 3 ), 4.503955, 0.000001 ) ); // 27.3^2 / 90.8 - 17.3^2 / 80.8
+
+  // Ia set by the user, the option has to be read from its value
+  curveNumberModel.initialRetentionFromS()->setValue( false );
+  curveNumberModel.initialRetention()->setValue( 10 );
+  QVERIFY( equal( curveNumberModel.initialRetentionValue(), 10, 0.000001 ) );
+  QVERIFY( runoff.isObsolete() );
+  QVERIFY( equal( runoff.value( 0 ), 0, 0.000001 ) );
+  QVERIFY( equal( runoff.value( 1 ), 1.360544, 0.000001 ) ); // 10^2 / 73.5
+  QVERIFY( equal( runoff.value( 2 ), 3.429875, 0.000001 ) ); // 20^2 / 83.5 - 10^2 / 73.5
+  QVERIFY( equal( runoff.value( 3 ), 4.835249, 0.000001 ) ); // 30^2 / 93.5 - 20^2 / 83.5
+}
+
 void ReosWatersehdTest::runoffhydrograph()
 {
   // build rainfalls
@@ -0,0 +1,169 @@
+/***************************************************************************
+                      reos_delftfews_test.cpp
+                     --------------------------------------
+Date                 : October-2026
+Copyright            : (C) 2026 by Vincent Cloarec
+email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include<QtTest/QtTest>
+#include <QObject>
+#include <QTemporaryDir>
+
+#include "reosdelftfewsxmlindex.h"
+#include "reos_testutils.h"
+
+class ReosDelftFewsTest: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void streamflow();
+    void rainfall();
+    void severalSeries();
+    void encoding();
+};
+
+static QString delftFewsFile( const QString &fileName )
+{
+  return QString( test_file( "deflt-fews-xml_data/" ).c_str() ) + fileName;
+}
+
+static QVector<QPair<qint64, double>> events( const ReosDelftFewsXMLIndex &index, const ReosDelftFewsXMLIndex::Series &series )
+{
+  QVector<QPair<qint64, double>> ret;
+  index.readEvents( series, [&ret]( qint64 time, double value )
+  {
+    ret.append( {time, value} );
+  } );
+  return ret;
+}
+
+void ReosDelftFewsTest::streamflow()
+{
+  std::shared_ptr<const ReosDelftFewsXMLIndex> index = ReosDelftFewsXMLIndex::indexForFile( delftFewsFile( QStringLiteral( "streamflow.xml" ) ) );
+  QVERIFY( index->isValid() );
+  QCOMPARE( index->series().count(), 1 );
+
+  const ReosDelftFewsXMLIndex::Series &series = index->series().at( 0 );
+  QCOMPARE( series.locationId, QStringLiteral( "Grid_WFlow_Toucian_100M" ) );
+  QCOMPARE( series.stationName, QStringLiteral( "Grid_WFlow_Toucian_100M" ) );
+  QCOMPARE( series.parameterId, QStringLiteral( "Q.simulated" ) );
+  QCOMPARE( series.type, QStringLiteral( "instantaneous" ) );
+  QCOMPARE( series.missVal, QStringLiteral( "NaN" ) );
+  QCOMPARE( series.timeStepUnit, QStringLiteral( "second" ) );
+  QCOMPARE( series.timeStepMultiplier, QStringLiteral( "3600" ) );
+  QCOMPARE( series.latitude, QStringLiteral( "24.8475" ) );
+  QCOMPARE( series.longitude, QStringLiteral( "120.9325" ) );
+  QCOMPARE( series.startTime, QDateTime( QDate( 2020, 6, 12 ), QTime( 7, 0, 0 ), Qt::UTC ) );
+  QCOMPARE( series.endTime, QDateTime( QDate( 2020, 6, 15 ), QTime( 19, 0, 0 ), Qt::UTC ) );
+
+  QVERIFY( index->findSeries( series.locationId, series.startTime, series.endTime ) );
+  QVERIFY( !index->findSeries( series.locationId, series.startTime, series.startTime ) );
+
+  const QVector<QPair<qint64, double>> values = events( *index, series );
+  QCOMPARE( values.count(), 85 );
+  QCOMPARE( values.first().first, series.startTime.toMSecsSinceEpoch() );
+  QCOMPARE( values.first().second, 9.703 );
+  QCOMPARE( values.at( 1 ).first, series.startTime.addSecs( 3600 ).toMSecsSinceEpoch() );
+  QCOMPARE( values.at( 1 ).second, 9.594 );
+  QCOMPARE( values.last().first, series.endTime.toMSecsSinceEpoch() );
+  QCOMPARE( values.last().second, 43.656 );
+
+  // the index is kept in memory as long as the file is not modified
+  QVERIFY( ReosDelftFewsXMLIndex::indexForFile( delftFewsFile( QStringLiteral( "streamflow.xml" ) ) ) == index );
+}
+
+void ReosDelftFewsTest::rainfall()
+{
+  std::shared_ptr<const ReosDelftFewsXMLIndex> index = ReosDelftFewsXMLIndex::indexForFile( delftFewsFile( QStringLiteral( "rainfall.xml" ) ) );
+  QVERIFY( index->isValid() );
+  QCOMPARE( index->series().count(), 1 );
+
+  const ReosDelftFewsXMLIndex::Series &series = index->series().at( 0 );
+  QCOMPARE( series.locationId, QStringLiteral( "Grid_WFlow_Toucian_100M" ) );
+  QCOMPARE( series.parameterId, QStringLiteral( "P.radar" ) );
+
+  const QVector<QPair<qint64, double>> values = events( *index, series );
+  QCOMPARE( values.count(), 138 );
+  QCOMPARE( values.first().first, QDateTime( QDate( 2020, 6, 10 ), QTime( 12, 0, 0 ), Qt::UTC ).toMSecsSinceEpoch() );
+  QCOMPARE( values.last().first, QDateTime( QDate( 2020, 6, 16 ), QTime( 5, 0, 0 ), Qt::UTC ).toMSecsSinceEpoch() );
+  QCOMPARE( values.last().second, 0.0 );
+}
+
+void ReosDelftFewsTest::severalSeries()
+{
+  std::shared_ptr<const ReosDelftFewsXMLIndex> index = ReosDelftFewsXMLIndex::indexForFile( delftFewsFile( QStringLiteral( "rainfall_s.xml" ) ) );
+  QVERIFY( index->isValid() );
+
+  const QVector<ReosDelftFewsXMLIndex::Series> &allSeries = index->series();
+  QCOMPARE( allSeries.count(), 7 );
+
+  const QStringList locations( {"01A190", "01A200", "01A210", "01A220", "01A350", "01A380", "01A410"} );
+  const QList<int> eventCounts( {36, 39, 20, 25, 30, 38, 24} );
+  for ( int i = 0; i < allSeries.count(); ++i )
+  {
+    QCOMPARE( allSeries.at( i ).locationId, locations.at( i ) );
+    QCOMPARE( events( *index, allSeries.at( i ) ).count(), eventCounts.at( i ) );
+    if ( i > 0 )
+      QVERIFY( allSeries.at( i ).offset >= allSeries.at( i - 1 ).offset + allSeries.at( i - 1 ).size );
+  }
+
+  const ReosDelftFewsXMLIndex::Series *series = index->findSeries( QStringLiteral( "01A220" ),
+      QDateTime( QDate( 2020, 11, 27 ), QTime( 0, 0, 0 ), Qt::UTC ),
+      QDateTime( QDate( 2020, 12, 28 ), QTime( 0, 0, 0 ), Qt::UTC ) );
+  QVERIFY( series );
+  QCOMPARE( series->locationId, QStringLiteral( "01A220" ) );
+
+  const QVector<QPair<qint64, double>> values = events( *index, allSeries.at( 0 ) );
+  QCOMPARE( values.at( 0 ).second, 2.0 );
+  QCOMPARE( values.at( 1 ).second, 17.0 );
+  QCOMPARE( values.at( 1 ).first - values.at( 0 ).first, qint64( 86400000 ) );
+}
+
+void ReosDelftFewsTest::encoding()
+{
+  QTemporaryDir dir;
+  QVERIFY( dir.isValid() );
+  const QString filePath = dir.filePath( QStringLiteral( "latin1.xml" ) );
+
+  const QString stationName = QStringLiteral( "Rivière à Périgueux" );
+  const QString content = QStringLiteral(
+                            "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\n"
+                            "<TimeSeries xmlns=\"http://www.wldelft.nl/fews/PI\" version=\"1.23\">\n"
+                            "  <series>\n"
+                            "    <header>\n"
+                            "      <locationId>loc</locationId>\n"
+                            "      <stationName>%1</stationName>\n"
+                            "      <startDate date=\"2020-01-01\" time=\"00:00:00\"/>\n"
+                            "      <endDate date=\"2020-01-01\" time=\"01:00:00\"/>\n"
+                            "      <missVal>-999</missVal>\n"
+                            "    </header>\n"
+                            "    <event date=\"2020-01-01\" time=\"00:00:00\" value=\"1.5\" flag=\"0\"/>\n"
+                            "    <event date=\"2020-01-01\" time=\"01:00:00\" value=\"-999\" flag=\"0\"/>\n"
+                            "  </series>\n"
+                            "</TimeSeries>\n" ).arg( stationName );
+
+  QFile file( filePath );
+  QVERIFY( file.open( QIODevice::WriteOnly ) );
+  file.write( content.toLatin1() );
+  file.close();
+
+  std::shared_ptr<const ReosDelftFewsXMLIndex> index = ReosDelftFewsXMLIndex::indexForFile( filePath );
+  QVERIFY( index->isValid() );
+  QCOMPARE( index->series().count(), 1 );
+  QCOMPARE( index->series().at( 0 ).stationName, stationName );
+
+  const QVector<QPair<qint64, double>> values = events( *index, index->series().at( 0 ) );
+  QCOMPARE( values.count(), 2 );
+  QCOMPARE( values.at( 0 ).second, 1.5 );
+  QVERIFY( std::isnan( values.at( 1 ).second ) );
+}
+
+QTEST_MAIN( ReosDelftFewsTest )
+#include "reos_delftfews_test.moc"
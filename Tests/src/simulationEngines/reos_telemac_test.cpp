@@ -0,0 +1,142 @@
+/***************************************************************************
+                      reos_telemac_test.cpp
+                     --------------------------------------
+Date                 : October-2026
+Copyright            : (C) 2026 by Vincent Cloarec
+email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include<QtTest/QtTest>
+#include <QObject>
+#include <QTemporaryDir>
+
+#include "reostelemacselafinreader.h"
+#include "reostelemacselafinwriter.h"
+#include "reos_testutils.h"
+
+class ReosTelemacTest: public QObject
+{
+    Q_OBJECT
+  private slots:
+    void envelopes();
+    void envelopesCache();
+};
+
+// values by frame of 4 vertices, the last vertex is never wet
+static const double FRAME_TIMES[4] = {0, 600, 1800, 3600};
+static const QVector<double> DEPTHS[4] = {{0, 0, 0, 0}, {0.5, 0.01, 0, 0}, {1.2, 0.3, 0.02, 0}, {0.8, 0.6, 0.01, 0}};
+static const QVector<double> VELOCITIES_U[4] = {{0, 0, 0, 0}, {0.3, 0, 0, 0}, {1.2, 0.6, 0, 0}, {0.6, 0.6, 0, 0}};
+static const QVector<double> VELOCITIES_V[4] = {{0, 0, 0, 0}, {0.4, 0, 0, 0}, {0.9, 0.8, 0, 0}, {0.8, 0.8, 0, 0}};
+
+static bool writeResults( const QString &fileName, int frameCount )
+{
+  ReosTelemacSelafinWriter writer( fileName );
+  const QStringList names = {QStringLiteral( "VELOCITY U" ), QStringLiteral( "VELOCITY V" ), QStringLiteral( "WATER DEPTH" )};
+  const QStringList units = {QStringLiteral( "M/S" ), QStringLiteral( "M/S" ), QStringLiteral( "M" )};
+  if ( !writer.writeHeader( QStringLiteral( "envelopes" ), names, units, {0, 1, 2, 1, 3, 2}, {1, 2, 3, 4}, {0, 10, 0, 10}, {0, 0, 10, 10} ) )
+    return false;
+
+  for ( int f = 0; f < frameCount; ++f )
+  {
+    if ( !writer.writeFrameTime( FRAME_TIMES[f] ) ||
+         !writer.writeVariableValues( VELOCITIES_U[f] ) ||
+         !writer.writeVariableValues( VELOCITIES_V[f] ) ||
+         !writer.writeVariableValues( DEPTHS[f] ) )
+      return false;
+  }
+
+  return writer.close();
+}
+
+static bool sameValues( const QVector<double> &values, const QVector<double> &expected )
+{
+  if ( values.count() != expected.count() )
+    return false;
+
+  for ( int i = 0; i < values.count(); ++i )
+  {
+    if ( std::isnan( values.at( i ) ) != std::isnan( expected.at( i ) ) )
+      return false;
+    if ( !std::isnan( expected.at( i ) ) && !equal( values.at( i ), expected.at( i ), 0.000001 ) )
+      return false;
+  }
+
+  return true;
+}
+
+void ReosTelemacTest::envelopes()
+{
+  QTemporaryDir dir;
+  const QString fileName = dir.filePath( QStringLiteral( "results.slf" ) );
+  QVERIFY( writeResults( fileName, 4 ) );
+
+  ReosTelemacSelafinReader reader( fileName );
+  QVERIFY( reader.isValid() );
+  QCOMPARE( reader.vertexCount(), 4 );
+  QCOMPARE( reader.frameCount(), 4 );
+
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  ReosTelemacSelafinReader::Envelopes envelopes = reader.calculateEnvelopes( 2, 0, 1, 0.015 );
+  QVERIFY( sameValues( envelopes.maximumDepth, {1.2, 0.6, 0.02, 0} ) );
+  QVERIFY( sameValues( envelopes.maximumVelocity, {1.5, 1.0, 0, 0} ) );
+  QVERIFY( sameValues( envelopes.maximumHazard, {1.8, 0.6, 0, 0} ) );
+  // a depth of 0.01 is under the wet depth, each wet frame lasts until the next one and the last one has no duration
+  QVERIFY( sameValues( envelopes.arrivalTime, {600, 1800, 1800, nan} ) );
+  QVERIFY( sameValues( envelopes.inundationDuration, {3000, 1800, 1800, 0} ) );
+
+  envelopes = reader.calculateEnvelopes( 2, -1, -1, 0.4 );
+  QVERIFY( sameValues( envelopes.maximumDepth, {1.2, 0.6, 0.02, 0} ) );
+  QVERIFY( envelopes.maximumVelocity.isEmpty() );
+  QVERIFY( envelopes.maximumHazard.isEmpty() );
+  QVERIFY( sameValues( envelopes.arrivalTime, {600, 3600, nan, nan} ) );
+  QVERIFY( sameValues( envelopes.inundationDuration, {3000, 0, 0, 0} ) );
+}
+
+void ReosTelemacTest::envelopesCache()
+{
+  QTemporaryDir dir;
+  const QString fileName = dir.filePath( QStringLiteral( "results.slf" ) );
+  const QString envelopesFileName = dir.filePath( QStringLiteral( "results.envelopes" ) );
+  QVERIFY( writeResults( fileName, 4 ) );
+
+  {
+    ReosTelemacSelafinReader reader( fileName );
+    ReosTelemacSelafinReader::Envelopes envelopes;
+    QVERIFY( !reader.readEnvelopes( envelopesFileName, 0.015, envelopes ) );
+
+    const ReosTelemacSelafinReader::Envelopes calculated = reader.calculateEnvelopes( 2, 0, 1, 0.015 );
+    QVERIFY( reader.writeEnvelopes( envelopesFileName, calculated, 0.015 ) );
+  }
+
+  {
+    // the envelopes are read back by another reader of the same results
+    ReosTelemacSelafinReader reader( fileName );
+    const ReosTelemacSelafinReader::Envelopes calculated = reader.calculateEnvelopes( 2, 0, 1, 0.015 );
+    ReosTelemacSelafinReader::Envelopes envelopes;
+    QVERIFY( reader.readEnvelopes( envelopesFileName, 0.015, envelopes ) );
+    QVERIFY( sameValues( envelopes.maximumDepth, calculated.maximumDepth ) );
+    QVERIFY( sameValues( envelopes.maximumVelocity, calculated.maximumVelocity ) );
+    QVERIFY( sameValues( envelopes.maximumHazard, calculated.maximumHazard ) );
+    QVERIFY( sameValues( envelopes.arrivalTime, calculated.arrivalTime ) );
+    QVERIFY( sameValues( envelopes.inundationDuration, calculated.inundationDuration ) );
+
+    // envelopes calculated with another wet depth are not used
+    QVERIFY( !reader.readEnvelopes( envelopesFileName, 0.02, envelopes ) );
+  }
+
+  // neither are envelopes of previous results
+  QVERIFY( writeResults( fileName, 3 ) );
+  ReosTelemacSelafinReader reader( fileName );
+  QCOMPARE( reader.frameCount(), 3 );
+  ReosTelemacSelafinReader::Envelopes envelopes;
+  QVERIFY( !reader.readEnvelopes( envelopesFileName, 0.015, envelopes ) );
+}
+
+QTEST_MAIN( ReosTelemacTest )
+#include "reos_telemac_test.moc"
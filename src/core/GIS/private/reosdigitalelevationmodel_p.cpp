@@ -14,6 +14,8 @@ email                : vcloarec at gmail dot com
  ***************************************************************************/
 
 #include <QMutexLocker>
+#include <QtConcurrent>
+#include <atomic>
 
 #include "reosprocess.h"
 #include "reosdigitalelevationmodel_p.h"
@@ -82,6 +84,218 @@ double ReosDigitalElevationModelRaster::elevationAt( const QPointF &point, const
   return elevationAt( QgsPointXY( point ), transform );
 }
 
+QVector<double> ReosDigitalElevationModelRaster::elevationsAt( const QPolygonF &points, const QString &pointsCrs, ReosProcess *process ) const
+{
+  QVector<double> x( points.count() );
+  QVector<double> y( points.count() );
+  for ( int i = 0; i < points.count(); ++i )
+  {
+    x[i] = points.at( i ).x();
+    y[i] = points.at( i ).y();
+  }
+
+  QgsCoordinateReferenceSystem ptCrs = QgsCoordinateReferenceSystem::fromWkt( pointsCrs );
+  transformCoordinates( x, y, QgsCoordinateTransform( ptCrs, mCrs, mTransformContext ) );
+
+  if ( process )
+  {
+    process->setMaxProgression( points.count() );
+    process->setCurrentProgression( 0 );
+  }
+
+  return elevationsAt( x, y, process );
+}
+
+// count of rows and columns of DEM tiles used to bucket points
+#define DEM_SAMPLING_TILE_SIZE 512
+
+struct ElevationSamplingJob
+{
+  std::shared_ptr<QgsRasterDataProvider> provider;
+  QVector<qint64> tiles;
+  const QHash<qint64, QVector<int>> *pointsByTile;
+  const QVector<double> *x;
+  const QVector<double> *y;
+  QVector<double> *values;
+  int tileColumnCount;
+  int rowCount;
+  int columnCount;
+  QgsRectangle demExtent;
+  ReosProcess *process;
+  int progressionOffset;
+  std::atomic<int> *treatedPointCount;
+};
+
+static void sampleElevationOnTiles( const ElevationSamplingJob &job )
+{
+  const double xMin = job.demExtent.xMinimum();
+  const double yMax = job.demExtent.yMaximum();
+  const double cellWidth = job.demExtent.width() / job.columnCount;
+  const double cellHeight = job.demExtent.height() / job.rowCount;
+
+  for ( qint64 tile : job.tiles )
+  {
+    if ( job.process && job.process->isStop() )
+      return;
+
+    const int tileRow = static_cast<int>( tile / job.tileColumnCount );
+    const int tileColumn = static_cast<int>( tile % job.tileColumnCount );
+
+    // block is read with one more pixel around the tile to interpolate points near the tile border
+    const int rowMin = std::max( 0, tileRow * DEM_SAMPLING_TILE_SIZE - 1 );
+    const int rowMax = std::min( job.rowCount, ( tileRow + 1 ) * DEM_SAMPLING_TILE_SIZE + 1 );
+    const int columnMin = std::max( 0, tileColumn * DEM_SAMPLING_TILE_SIZE - 1 );
+    const int columnMax = std::min( job.columnCount, ( tileColumn + 1 ) * DEM_SAMPLING_TILE_SIZE + 1 );
+
+    const QgsRectangle blockExtent( xMin + columnMin * cellWidth, yMax - rowMax * cellHeight,
+                                    xMin + columnMax * cellWidth, yMax - rowMin * cellHeight );
+    std::unique_ptr<QgsRasterBlock> block( job.provider->block( 1, blockExtent, columnMax - columnMin, rowMax - rowMin ) );
+
+    const QVector<int> &pointIndexes = job.pointsByTile->value( tile );
+    if ( block && block->isValid() )
+    {
+      for ( int pointIndex : pointIndexes )
+      {
+        const double px = ( job.x->at( pointIndex ) - xMin ) / cellWidth;
+        const double py = ( yMax - job.y->at( pointIndex ) ) / cellHeight;
+        const int row = std::min( static_cast<int>( py ), job.rowCount - 1 ) - rowMin;
+        const int column = std::min( static_cast<int>( px ), job.columnCount - 1 ) - columnMin;
+
+        // position relative to the centers of the pixels
+        const double cx = px - 0.5;
+        const double cy = py - 0.5;
+        const int c0 = static_cast<int>( std::floor( cx ) );
+        const int r0 = static_cast<int>( std::floor( cy ) );
+
+        double value = std::numeric_limits<double>::quiet_NaN();
+        if ( c0 >= 0 && r0 >= 0 && c0 + 1 < job.columnCount && r0 + 1 < job.rowCount )
+        {
+          const int bc = c0 - columnMin;
+          const int br = r0 - rowMin;
+          if ( !block->isNoData( br, bc ) && !block->isNoData( br, bc + 1 ) &&
+               !block->isNoData( br + 1, bc ) && !block->isNoData( br + 1, bc + 1 ) )
+          {
+            const double fx = cx - c0;
+            const double fy = cy - r0;
+            const double top = block->value( br, bc ) * ( 1 - fx ) + block->value( br, bc + 1 ) * fx;
+            const double bottom = block->value( br + 1, bc ) * ( 1 - fx ) + block->value( br + 1, bc + 1 ) * fx;
+            value = top * ( 1 - fy ) + bottom * fy;
+          }
+        }
+
+        if ( std::isnan( value ) && !block->isNoData( row, column ) )
+          value = block->value( row, column );
+
+        ( *job.values )[pointIndex] = value;
+      }
+    }
+
+    const int treatedCount = job.treatedPointCount->fetch_add( pointIndexes.count() ) + pointIndexes.count();
+    if ( job.process )
+      job.process->setCurrentProgression( job.progressionOffset + treatedCount );
+  }
+}
+
+QVector<double> ReosDigitalElevationModelRaster::elevationsAt( const QVector<double> &x, const QVector<double> &y, ReosProcess *process, int progressionOffset ) const
+{
+  QVector<double> values( x.count(), std::numeric_limits<double>::quiet_NaN() );
+
+  if ( !mDataProvider || x.isEmpty() )
+    return values;
+
+  const QgsRectangle demExtent = mDataProvider->extent();
+  const int columnCount = mDataProvider->xSize();
+  const int rowCount = mDataProvider->ySize();
+  if ( columnCount <= 0 || rowCount <= 0 )
+    return values;
+
+  const double cellWidth = demExtent.width() / columnCount;
+  const double cellHeight = demExtent.height() / rowCount;
+  const int tileColumnCount = ( columnCount + DEM_SAMPLING_TILE_SIZE - 1 ) / DEM_SAMPLING_TILE_SIZE;
+
+  QHash<qint64, QVector<int>> pointsByTile;
+  for ( int i = 0; i < x.count(); ++i )
+  {
+    const double px = ( x.at( i ) - demExtent.xMinimum() ) / cellWidth;
+    const double py = ( demExtent.yMaximum() - y.at( i ) ) / cellHeight;
+    if ( !( px >= 0 && py >= 0 && px <= columnCount && py <= rowCount ) )
+      continue;
+
+    const int row = std::min( static_cast<int>( py ), rowCount - 1 );
+    const int column = std::min( static_cast<int>( px ), columnCount - 1 );
+    const qint64 tile = qint64( row / DEM_SAMPLING_TILE_SIZE ) * tileColumnCount + column / DEM_SAMPLING_TILE_SIZE;
+    pointsByTile[tile].append( i );
+  }
+
+  // points outside the DEM are already treated
+  int pointsInTiles = 0;
+  for ( const QVector<int> &pointIndexes : std::as_const( pointsByTile ) )
+    pointsInTiles += pointIndexes.count();
+  std::atomic<int> treatedPointCount( x.count() - pointsInTiles );
+
+  QList<qint64> tiles = pointsByTile.keys();
+  std::sort( tiles.begin(), tiles.end() );
+
+  // each job has its own provider because providers are not thread safe
+  const int jobCount = std::min( static_cast<int>( ReosProcess::maximumThreads() ), tiles.count() );
+  QVector<ElevationSamplingJob> jobs;
+  for ( int j = 0; j < jobCount; ++j )
+  {
+    ElevationSamplingJob job;
+    job.provider.reset( mDataProvider->clone() );
+    job.pointsByTile = &pointsByTile;
+    job.x = &x;
+    job.y = &y;
+    job.values = &values;
+    job.tileColumnCount = tileColumnCount;
+    job.rowCount = rowCount;
+    job.columnCount = columnCount;
+    job.demExtent = demExtent;
+    job.process = process;
+    job.progressionOffset = progressionOffset;
+    job.treatedPointCount = &treatedPointCount;
+    jobs.append( job );
+  }
+
+  for ( int t = 0; t < tiles.count(); ++t )
+    jobs[t % jobCount].tiles.append( tiles.at( t ) );
+
+  QtConcurrent::blockingMap( jobs, sampleElevationOnTiles );
+
+  return values;
+}
+
+void ReosDigitalElevationModelRaster::transformCoordinates( QVector<double> &x, QVector<double> &y, const QgsCoordinateTransform &transform )
+{
+  if ( !transform.isValid() )
+    return;
+
+  QVector<double> z( x.count(), 0.0 );
+  QVector<double> xTransformed = x;
+  QVector<double> yTransformed = y;
+  try
+  {
+    transform.transformInPlace( xTransformed, yTransformed, z );
+    x = xTransformed;
+    y = yTransformed;
+  }
+  catch ( QgsCsException & )
+  {
+    // at least one point fails, transforms point by point
+    for ( int i = 0; i < x.count(); ++i )
+    {
+      try
+      {
+        const QgsPointXY point = transform.transform( QgsPointXY( x.at( i ), y.at( i ) ) );
+        x[i] = point.x();
+        y[i] = point.y();
+      }
+      catch ( QgsCsException & )
+      {}
+    }
+  }
+}
+
 QPolygonF ReosDigitalElevationModelRaster::elevationOnPolyline( const QPolygonF &polyline, const QString &polylineCrs, ReosProcess *process ) const
 {
   assert( mDataProvider );
@@ -432,12 +646,15 @@ ReosRasterMemory<float> ReosDigitalElevationModelRaster::extractMemoryRasterSimp
 
   ReosRasterMemory<float> ret = ReosRasterMemory<float>( yPixCount, xPixCount ); //(row, col)
 
-  std::unique_ptr<QgsRasterBlock> block;
-  block.reset( mDataProvider->block( 1, adjustedExtent, xPixCount, yPixCount ) );
-
   if ( mDataProvider->sourceHasNoDataValue( 1 ) )
     ret.setNodata( mDataProvider->sourceNoDataValue( 1 ) );
 
+  if ( qint64( xPixCount ) * yPixCount > ReosRasterTileStore::contiguousCellCountLimit() )
+    return extractTiledMemoryRaster( ret, adjustedExtent, maxValue, process );
+
+  std::unique_ptr<QgsRasterBlock> block;
+  block.reset( mDataProvider->block( 1, adjustedExtent, xPixCount, yPixCount ) );
+
   if ( !block->isValid() )
   {
     if ( process )
@@ -483,6 +700,68 @@ ReosRasterMemory<float> ReosDigitalElevationModelRaster::extractMemoryRasterSimp
 
 }
 
+ReosRasterMemory<float> ReosDigitalElevationModelRaster::extractTiledMemoryRaster( ReosRasterMemory<float> &raster, const QgsRectangle &extent, float &maxValue, ReosProcess *process ) const
+{
+  const int rowCount = raster.rowCount();
+  const int columnCount = raster.columnCount();
+
+  if ( !raster.reserveTiledMemory() )
+  {
+    if ( process )
+      process->setSuccesful( false );
+    return raster;
+  }
+
+  if ( process )
+  {
+    process->setCurrentProgression( 0 );
+    process->setMaxProgression( rowCount );
+  }
+
+  // the DEM is read by bands with the height of a tile to never have all the values in memory
+  const int bandSize = ReosRasterTileStore::defaultTileSize();
+  const double cellHeight = extent.height() / rowCount;
+  std::vector<float> bandValues;
+  maxValue = 0;
+  for ( int bandRow = 0; bandRow < rowCount; bandRow += bandSize )
+  {
+    const int bandRowCount = std::min( bandSize, rowCount - bandRow );
+    const QgsRectangle bandExtent( extent.xMinimum(),
+                                   extent.yMaximum() - ( bandRow + bandRowCount ) * cellHeight,
+                                   extent.xMaximum(),
+                                   extent.yMaximum() - bandRow * cellHeight );
+
+    std::unique_ptr<QgsRasterBlock> block( mDataProvider->block( 1, bandExtent, columnCount, bandRowCount ) );
+    if ( !block->isValid() || ( process && process->isStop() ) )
+    {
+      raster.freeMemory();
+      if ( process )
+        process->setSuccesful( false );
+      return raster;
+    }
+
+    bandValues.resize( static_cast<size_t>( bandRowCount ) * columnCount );
+    for ( int i = 0; i < bandRowCount; ++i )
+      for ( int j = 0; j < columnCount; ++j )
+      {
+        float value = float( block->value( i, j ) );
+        if ( value != raster.noData() && std::fabs( value ) > maxValue )
+          maxValue = std::fabs( value );
+        bandValues[static_cast<size_t>( i ) * columnCount + j] = value;
+      }
+
+    raster.writeBlock( bandRow, 0, bandRowCount, columnCount, bandValues.data() );
+
+    if ( process )
+      process->setCurrentProgression( bandRow + bandRowCount );
+  }
+
+  if ( process )
+    process->setSuccesful( true );
+
+  return raster;
+}
+
 ReosRasterMemory<float> ReosDigitalElevationModelRaster::extractMemoryRasterSimplePrecision( const ReosRasterExtent &destinationRasterExtent, ReosProcess *process ) const
 {
   QgsCoordinateReferenceSystem destCrs = QgsCoordinateReferenceSystem::fromWkt( destinationRasterExtent.crs() );
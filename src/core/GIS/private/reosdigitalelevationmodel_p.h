@@ -32,6 +32,23 @@ class ReosDigitalElevationModelRaster: public ReosDigitalElevationModel
     double elevationAt( const QgsPointXY &point, const QgsCoordinateTransform &transformToDem ) const;
 
     double elevationAt(const QPointF& point, const QString& pointCrs = QString()) const override;
+    QVector<double> elevationsAt( const QPolygonF &points, const QString &pointsCrs = QString(), ReosProcess *process = nullptr ) const override;
+
+    /**
+     * Returns the elevations at the points with coordinates \a x and \a y in the DEM coordinate system, bilinearly interpolated between the centers of pixels.
+     * Points are bucketed by tiles of the DEM, each tile is read once and tiles are processed in parallel.
+     * If a pixel used for the interpolation has no value, the value of the pixel containing the point is used.
+     * Returned value is NaN if this pixel has no value or if the point is outside the DEM.
+     * The progression of \a process is set from \a progressionOffset plus the count of treated points.
+     */
+    QVector<double> elevationsAt( const QVector<double> &x, const QVector<double> &y, ReosProcess *process = nullptr, int progressionOffset = 0 ) const;
+
+    /**
+     * Transforms in place the coordinates \a x and \a y with \a transform in one pass,
+     * if a point fails to be transformed, its coordinates are not changed.
+     */
+    static void transformCoordinates( QVector<double> &x, QVector<double> &y, const QgsCoordinateTransform &transform );
+
     QgsCoordinateTransform transformToDem( const QgsCoordinateReferenceSystem &sourceCrs ) const;
 
 
@@ -58,6 +75,9 @@ class ReosDigitalElevationModelRaster: public ReosDigitalElevationModel
     //! Adjust the extent to the border of pixel of the raster (extent increase)
     ReosRasterExtent rasterExtent( const QgsRectangle &originalExtent ) const;
 
+    //! Fills the \a raster with values in \a extent, values are read by bands of rows and stored in tiles
+    ReosRasterMemory<float> extractTiledMemoryRaster( ReosRasterMemory<float> &raster, const QgsRectangle &extent, float &maxValue, ReosProcess *process ) const;
+
 };
 
 
@@ -28,6 +28,7 @@
 #include "reosparameter.h"
 #include "reosencodedelement.h"
 #include "reosmapextent.h"
+#include "reoscoordinatetransform.h"
 
 ReosMeshFrame_p::ReosMeshFrame_p( const QString &crs, QObject *parent ): ReosMesh( parent )
 {
@@ -82,6 +83,11 @@ void ReosMeshFrame_p::init()
 
   connect( mMeshLayer.get(), &QgsMapLayer::repaintRequested, this, &ReosMesh::repaintRequested );
   connect( mMeshLayer.get(), &QgsMeshLayer::layerModified, this, &ReosDataObject::dataChanged );
+  connect( this, &ReosDataObject::dataChanged, this, [this]
+  {
+    mPointProbe.reset();
+    mTransformedVerticesValid = false;
+  } );
 }
 
 void ReosMeshFrame_p::stopFrameEditing( bool commit, bool continueEditing )
@@ -212,7 +218,7 @@ ReosMeshQualityChecker *ReosMeshFrame_p::getQualityChecker( ReosMesh::QualityMes
   QgsCoordinateReferenceSystem destCrs;
   destCrs.createFromWkt( destinatonCrs );
   QgsCoordinateTransform transform( mMeshLayer->crs(), destCrs, QgsProject::instance() );
-  return new ReosMeshQualityChecker_p( *mMeshLayer->nativeMesh(), mQualityMeshParameters, distanceArea, qualitiChecks, transform );
+  return new ReosMeshQualityChecker_p( *mMeshLayer->nativeMesh(), mQualityMeshParameters, distanceArea, qualitiChecks, transform, mQualityKernel );
 }
 
 bool ReosMeshFrame_p::isValid() const
@@ -233,23 +239,46 @@ QPointF ReosMeshFrame_p::vertexPosition( int vertexIndex, const QString &destina
   if ( destinationCrs.isEmpty() )
     return mMeshLayer->nativeMesh()->vertices.at( vertexIndex ).toQPointF();
 
-  QgsCoordinateReferenceSystem crs;
-  crs.fromWkt( destinationCrs );
-  QgsCoordinateTransform transform( mMeshLayer->crs(), crs, QgsProject::instance() );
-  QgsPointXY vert = mMeshLayer->nativeMesh()->vertices.at( vertexIndex );
-  if ( transform.isValid() )
+  updateTransformedVertices( destinationCrs );
+  return QPointF( mTransformedVerticesX.at( vertexIndex ), mTransformedVerticesY.at( vertexIndex ) );
+}
+
+QPolygonF ReosMeshFrame_p::vertexPositions( const QString &destinationCrs )
+{
+  const QVector<QgsMeshVertex> &vertices = mMeshLayer->nativeMesh()->vertices;
+  QPolygonF ret( vertices.count() );
+  if ( destinationCrs.isEmpty() )
   {
-    try
-    {
-      return transform.transform( vert ).toQPointF();
-    }
-    catch ( QgsCsException &e )
-    {
-      return vert.toQPointF();
-    }
+    for ( int i = 0; i < vertices.count(); ++i )
+      ret[i] = vertices.at( i ).toQPointF();
+    return ret;
+  }
+
+  updateTransformedVertices( destinationCrs );
+  for ( int i = 0; i < vertices.count(); ++i )
+    ret[i] = QPointF( mTransformedVerticesX.at( i ), mTransformedVerticesY.at( i ) );
+
+  return ret;
+}
+
+void ReosMeshFrame_p::updateTransformedVertices( const QString &destinationCrs )
+{
+  if ( mTransformedVerticesValid && destinationCrs == mTransformedVerticesCrs )
+    return;
+
+  // all the vertices are transformed in one batch on the first request and kept until the frame changes
+  const QVector<QgsMeshVertex> &vertices = mMeshLayer->nativeMesh()->vertices;
+  mTransformedVerticesX.resize( vertices.count() );
+  mTransformedVerticesY.resize( vertices.count() );
+  for ( int i = 0; i < vertices.count(); ++i )
+  {
+    mTransformedVerticesX[i] = vertices.at( i ).x();
+    mTransformedVerticesY[i] = vertices.at( i ).y();
   }
 
-  return vert.toQPointF();
+  ReosCoordinateTransform( crs(), destinationCrs ).transformInPlace( mTransformedVerticesX, mTransformedVerticesY );
+  mTransformedVerticesCrs = destinationCrs;
+  mTransformedVerticesValid = true;
 }
 
 QVector<int> ReosMeshFrame_p::face( int faceIndex ) const
@@ -287,32 +316,6 @@ void ReosMeshFrame_p::updateWireFrameSettings()
   update3DRenderer();
 }
 
-QPointF ReosMeshFrame_p::tolayerCoordinates( const ReosSpatialPosition &position ) const
-{
-  QgsCoordinateReferenceSystem sourceCrs;
-  sourceCrs.fromWkt( position.crs() );
-
-  const QgsCoordinateTransform transform( sourceCrs, mMeshLayer->crs(), QgsProject::instance() );
-  QgsPointXY ret;
-  if ( transform.isValid() )
-  {
-    try
-    {
-      ret = transform.transform( position.position() );
-    }
-    catch ( const QgsCsException & )
-    {
-      ret = position.position();
-    }
-  }
-  else
-  {
-    ret = position.position();
-  }
-
-  return ret.toQPointF();
-}
-
 void ReosMeshFrame_p::update3DRenderer()
 {
   if ( !mMeshLayer )
@@ -388,125 +391,21 @@ static void lamTol( double &lam )
   }
 }
 
-//from QGIS src/core/mesh/qgsmeshlayerutils.cpp
-static double interpolate( const QgsPointXY &pA, const QgsPointXY &pB, const QgsPointXY &pC, const QgsPointXY &pP, double vA, double vB, double vC, bool &ok )
-{
-  // Compute vectors
-  const double xa = pA.x();
-  const double ya = pA.y();
-  const double v0x = pC.x() - xa ;
-  const double v0y = pC.y() - ya ;
-  const double v1x = pB.x() - xa ;
-  const double v1y = pB.y() - ya ;
-  const double v2x = pP.x() - xa ;
-  const double v2y = pP.y() - ya ;
-
-  // Compute dot products
-  const double dot00 = v0x * v0x + v0y * v0y;
-  const double dot01 = v0x * v1x + v0y * v1y;
-  const double dot02 = v0x * v2x + v0y * v2y;
-  const double dot11 = v1x * v1x + v1y * v1y;
-  const double dot12 = v1x * v2x + v1y * v2y;
-
-  // Compute barycentric coordinates
-  double invDenom =  dot00 * dot11 - dot01 * dot01;
-  if ( invDenom == 0 )
-  {
-    ok = false;
-    return std::numeric_limits<double>::quiet_NaN();
-  }
-  invDenom = 1.0 / invDenom;
-  double lam1 = ( dot11 * dot02 - dot01 * dot12 ) * invDenom;
-  double lam2 = ( dot00 * dot12 - dot01 * dot02 ) * invDenom;
-  double lam3 = 1.0 - lam1 - lam2;
-
-  // Apply some tolerance to lam so we can detect correctly border points
-  lamTol( lam1 );
-  lamTol( lam2 );
-  lamTol( lam3 );
-
-  // Return if POI is outside triangle
-  if ( ( lam1 < 0 ) || ( lam2 < 0 ) || ( lam3 < 0 ) )
-  {
-    ok = false;
-    return std::numeric_limits<double>::quiet_NaN();
-  }
-
-  ok = true;
-  return lam1 * vC + lam2 * vB + lam3 * vA;
-}
-
-
 double ReosMeshFrame_p::interpolateDatasetValueOnPoint(
   const ReosMeshDatasetSource *datasetSource,
   const ReosSpatialPosition &position,
   int sourceGroupindex,
   int datasetIndex ) const
 {
-  const QVector<double> datasetValues = datasetSource->datasetValues( sourceGroupindex, datasetIndex );
-  const QVector<int> facesActive = datasetSource->activeFaces( datasetIndex );
-
-  bool isScalar = datasetSource->groupIsScalar( sourceGroupindex );
-
-  Q_ASSERT( datasetValues.count() == mMeshLayer->meshVertexCount() * ( isScalar ? 1 : 2 ) );
-
-  QgsPointXY positionInLayer = QgsMeshVertex( tolayerCoordinates( position ) );
-
-  QgsTriangularMesh *triangularMesh = mMeshLayer->triangularMesh();
-  const QgsMeshVertex triVert = triangularMesh->nativeToTriangularCoordinates( QgsMeshVertex( positionInLayer ) );
-  int faceIndex = triangularMesh->faceIndexForPoint_v2( triVert );
-
-  if ( faceIndex < 0 || faceIndex >= triangularMesh->triangles().count() )
-    return std::numeric_limits<double>::quiet_NaN();
-
-  if ( facesActive.at( faceIndex ) == 0 )
-    return std::numeric_limits<double>::quiet_NaN();
-
-  const QgsMeshFace &face = triangularMesh->triangles().at( faceIndex );
-  const QgsMesh nativeMesh = *mMeshLayer->nativeMesh();
+  if ( !mPointProbe )
+    mPointProbe.reset( new ReosMeshPointProbe_p( *mMeshLayer->nativeMesh(), mMeshLayer->crs() ) );
 
-  double i0 = face.at( 0 );
-  double i1 = face.at( 1 );
-  double i2 = face.at( 2 );
-  qDebug() << i0 << i1 << i2;
-
-  bool ok = false;
-  double result;
-
-  if ( isScalar )
-    result = interpolate( nativeMesh.vertices.at( i0 ), nativeMesh.vertices.at( i1 ), nativeMesh.vertices.at( i2 ),
-                          positionInLayer,
-                          datasetValues.at( i0 ), datasetValues.at( i1 ), datasetValues.at( i2 ), ok );
-  else
-  {
-    double v0x = datasetValues.at( 2 * i0 );
-    double v0y = datasetValues.at( 2 * i0 + 1 );
-    double v1x = datasetValues.at( 2 * i1 );
-    double v1y = datasetValues.at( 2 * i1 + 1 );
-    double v2x = datasetValues.at( 2 * i2 );
-    double v2y = datasetValues.at( 2 * i2 + 1 );
-
-    double resultX = interpolate( nativeMesh.vertices.at( i0 ), nativeMesh.vertices.at( i1 ), nativeMesh.vertices.at( i2 ),
-                                  positionInLayer,
-                                  v0x, v1x, v2x, ok );
-
-    if ( !ok )
-      return std::numeric_limits<double>::quiet_NaN();
-
-    double resultY = interpolate( nativeMesh.vertices.at( i0 ), nativeMesh.vertices.at( i1 ), nativeMesh.vertices.at( i2 ),
-                                  positionInLayer,
-                                  v0y, v1y, v2y, ok );
-
-    if ( !ok )
-      return std::numeric_limits<double>::quiet_NaN();
-
-    result = std::sqrt( std::pow( resultX, 2 ) + std::pow( resultY, 2 ) );
-  }
-
-  if ( ok )
-    return result;
+  return mPointProbe->value( datasetSource, position, sourceGroupindex, datasetIndex );
+}
 
-  return std::numeric_limits<double>::quiet_NaN();
+ReosMeshPointProbe *ReosMeshFrame_p::createPointProbe() const
+{
+  return new ReosMeshPointProbe_p( *mMeshLayer->nativeMesh(), mMeshLayer->crs() );
 }
 
 QString ReosMeshFrame_p::enableVertexElevationDataset( const QString &name )
@@ -739,6 +638,10 @@ QString ReosMeshFrame_p::verticesElevationDatasetId() const
 
 void ReosMeshFrame_p::setSimulationResults( ReosHydraulicSimulationResults *result )
 {
+  if ( mSimulationResults )
+    disconnect( mSimulationResults, &ReosMeshDatasetSource::minimumMaximumChanged, this, nullptr );
+  mSimulationResults = result;
+
   meshProvider()->setDatasetSource( result );
   mMeshLayer->temporalProperties()->setDefaultsFromDataProviderTemporalCapabilities( meshProvider()->temporalCapabilities() );
 
@@ -767,11 +670,51 @@ void ReosMeshFrame_p::setSimulationResults( ReosHydraulicSimulationResults *resu
       }
       mDatasetGroupsIndex[result->groupId( i )] = index;
     }
+
+    // minimum and maximum can be calculated after the results are loaded, the color ramps are classified when they are known
+    connect( result, &ReosMeshDatasetSource::minimumMaximumChanged, this, [this]
+    {
+      updateResultsScalarSettings();
+      emit repaintRequested();
+    } );
   }
 
   meshProvider()->reloadData();
 }
 
+void ReosMeshFrame_p::updateResultsScalarSettings()
+{
+  QgsMeshRendererSettings settings = mMeshLayer->rendererSettings();
+  bool changed = false;
+  for ( auto it = mDatasetGroupsIndex.constBegin(); it != mDatasetGroupsIndex.constEnd(); ++it )
+  {
+    if ( it.key() == mVerticesElevationDatasetId || it.value() < 0 )
+      continue;
+
+    QgsMeshRendererScalarSettings scalarSettings = settings.scalarSettings( it.value() );
+    if ( scalarSettings.classificationMinimum() < scalarSettings.classificationMaximum() )
+      continue;
+
+    const QgsMeshDatasetGroupMetadata meta = mMeshLayer->datasetGroupMetadata( QgsMeshDatasetIndex( it.value() ) );
+    const double min = meta.minimum();
+    const double max = meta.maximum();
+    if ( !( min < max ) )
+      continue;
+
+    QgsColorRampShader colorRamp = scalarSettings.colorRampShader();
+    colorRamp.setMinimumValue( min );
+    colorRamp.setMaximumValue( max );
+    colorRamp.classifyColorRamp( 10, -1 );
+    scalarSettings.setClassificationMinimumMaximum( min, max );
+    scalarSettings.setColorRampShader( colorRamp );
+    settings.setScalarSettings( it.value(), scalarSettings );
+    changed = true;
+  }
+
+  if ( changed )
+    mMeshLayer->setRendererSettings( settings );
+}
+
 ReosMeshRenderer_p::ReosMeshRenderer_p( QGraphicsView *canvas, QgsMeshLayer *layer )
 {
   QgsMapCanvas *mapCanvas = qobject_cast<QgsMapCanvas *>( canvas );
@@ -804,288 +747,399 @@ void ReosMeshRenderer_p::stopRendering()
 ReosMeshQualityChecker_p::ReosMeshQualityChecker_p( const QgsMesh &mesh,
     ReosMesh::QualityMeshParameters params,
     const QgsDistanceArea &distanceArea,
-    ReosMesh::QualityMeshChecks checks, const QgsCoordinateTransform &transform )
+    ReosMesh::QualityMeshChecks checks, const QgsCoordinateTransform &transform,
+    std::shared_ptr<ReosMeshQualityKernel_p> kernel )
   : mMesh( mesh )
-  , mMinimumAngle( params.minimumAngle->value() )
-  , mMaximumAngle( params.maximumAngle->value() )
-  , mConnectionCount( params.connectionCount->value() )
-  , mConnectionCountBoundary( params.connectionCountBoundary->value() )
-  , mMaximumSlope( params.maximumSlope->value() )
-  , mMinimumArea( params.minimumArea->value().valueM2() )
-  , mMaximumArea( params.maximumArea->value().valueM2() )
-  , mMaximumAreaChange( params.maximumAreaChange->value() )
   , mDistanceArea( distanceArea )
   , mChecks( checks )
   , mTransform( transform )
+  , mKernel( kernel )
 {
-}
-
-static double ccwAngle( const QgsVector &v1, const QgsVector &v2 )
-{
-  return  std::fmod( v1.angle() / M_PI * 180 + 360.0 - v2.angle() / M_PI * 180, 360.0 );
+  mThresholds.minimumAngle = params.minimumAngle->value();
+  mThresholds.maximumAngle = params.maximumAngle->value();
+  mThresholds.connectionCount = params.connectionCount->value();
+  mThresholds.connectionCountBoundary = params.connectionCountBoundary->value();
+  mThresholds.maximumSlope = params.maximumSlope->value();
+  mThresholds.minimumArea = params.minimumArea->value().valueM2();
+  mThresholds.maximumArea = params.maximumArea->value().valueM2();
+  mThresholds.maximumAreaChange = params.maximumAreaChange->value();
 }
 
 void ReosMeshQualityChecker_p::start()
 {
   mIsSuccessful = false;
-  QgsTopologicalMesh topologicalMesh = QgsTopologicalMesh::createTopologicalMesh( &mMesh, 3, mError );
-  if ( mError != QgsMeshEditingError() )
-    return;
-
-  double areaFactor = QgsUnitTypes::fromUnitToUnitFactor( mDistanceArea.areaUnits(), QgsUnitTypes::AreaSquareMeters );
-  double lenghtFactor = QgsUnitTypes::fromUnitToUnitFactor( mDistanceArea.lengthUnits(), QgsUnitTypes::DistanceMeters );
-  QSet<int> maxAreaChange;
-  QSet<QPair<int, int>> maxSlope;
-  QVector<char> facesChecked;
-  if ( mChecks & ReosMesh::MaximumAreaChange )
-    facesChecked.fill( 0, mMesh.faceCount() );
 
-  setMaxProgression( mMesh.faceCount() );
+  setMaxProgression( 3 );
   setCurrentProgression( 0 );
   setInformation( tr( "Check faces" ) );
-  for ( int i = 0; i < mMesh.faceCount(); ++i )
-  {
-    const QgsMeshFace &face =  mMesh.face( i );
-    int size = face.size();
-    const QgsGeometry geom = QgsMeshUtils::toGeometry( face, mMesh.vertices );
-    bool minAreaCheck = false;
-    bool maxAreaCheck = false;
-    bool minAngleCheck = false;
-    bool maxAngleCheck = false;
-    // area check
-    if ( mChecks & ( ReosMesh::MinimumArea | ReosMesh::MaximumArea | ReosMesh::MaximumAreaChange ) )
-    {
-      double area = areaFactor * geom.area();
-      if ( mChecks & ReosMesh::MinimumArea && area < mMinimumArea )
-        minAreaCheck |= true;
 
-      if ( mChecks & ReosMesh::MaximumArea && area > mMaximumArea )
-        maxAreaCheck |= true;
-
-      if ( mChecks & ReosMesh::MaximumAreaChange )
-      {
-        bool change = false;
-        facesChecked[i] = 1;
-        const QVector<int> &neighbors = topologicalMesh.neighborsOfFace( i );
-        for ( int j = 0; j < neighbors.size(); ++j )
-        {
-          if ( neighbors.at( j ) == -1 ||
-               ( facesChecked.at( i ) == 1 && facesChecked.at( neighbors.at( j ) ) == 1 ) )
-            continue;
-
-          const QgsGeometry neighborGeom = QgsMeshUtils::toGeometry( mMesh.face( neighbors.at( j ) ), mMesh.vertices );
-          double neighborArea = areaFactor * neighborGeom.area();
-          if ( fabs( neighborArea - area ) / area > mMaximumAreaChange )
-          {
-            change |= true;
-            maxAreaChange.insert( neighbors.at( j ) );
-          }
-          facesChecked[neighbors.at( j )] = 1;
-        }
-        if ( change )
-          maxAreaChange.insert( i );
-      }
-    }
-
-    // angle and slope checks
-    if ( mChecks & ( ReosMesh::MinimumAngle | ReosMesh::MaximumAngle | ReosMesh::MaximumSlope ) )
-    {
-      for ( int j = 0; j < size; ++j )
-      {
-        int iv1 = face.at( j );
-        int iv2 = face.at( ( j + 1 ) % size );
-        int iv3 =  face.at( ( j + 2 ) % size );
-        const QgsPointXY p1 = mMesh.vertices.at( iv1 );
-        const QgsPointXY p2 = mMesh.vertices.at( iv2 );
-        const QgsPointXY p3 = mMesh.vertices.at( iv3 );
-        const QgsVector v1 = p1 - p2;
-        const QgsVector v2 = p3 - p2;
-
-        double angle = ccwAngle( v1, v2 );
-        if ( mChecks & ReosMesh::MinimumAngle )
-          minAngleCheck |= angle < mMinimumAngle;
-        if ( mChecks & ReosMesh::MaximumAngle )
-          maxAngleCheck |= angle > mMaximumAngle;
-
-        if ( mChecks & ReosMesh::MaximumSlope )
-        {
-          if ( maxSlope.contains( {iv1, iv2} ) || maxSlope.contains( {iv2, iv1} ) )
-            continue;
-
-          double dist = mDistanceArea.measureLine( {p1, p2} )*lenghtFactor;
-          double slope = std::fabs( ( mMesh.vertices.at( iv1 ).z() - mMesh.vertices.at( iv2 ).z() ) / dist );
-          if ( slope > mMaximumSlope )
-          {
-            QPointF pt1;
-            QPointF pt2;
-            if ( mTransform.isValid() )
-            {
-              try
-              {
-                pt1 = mTransform.transform( p1 ).toQPointF();
-                pt2 = mTransform.transform( p2 ).toQPointF();
-              }
-              catch ( QgsCsException &e )
-              {
-                pt1 = p1.toQPointF();
-                pt2 = p2.toQPointF();
-              }
-            }
-            else
-            {
-              pt1 = p1.toQPointF();
-              pt2 = p2.toQPointF();
-            }
-            mResult.maximumSlope.append( QLineF( pt1, pt2 ) );
-            maxSlope.insert( {iv1, iv2} );
-          }
-        }
-      }
-    }
+  const int vertexCount = mMesh.vertexCount();
+  QVector<double> verticesX( vertexCount );
+  QVector<double> verticesY( vertexCount );
+  QVector<double> verticesZ( vertexCount );
+  for ( int i = 0; i < vertexCount; ++i )
+  {
+    const QgsMeshVertex &vertex = mMesh.vertices.at( i );
+    verticesX[i] = vertex.x();
+    verticesY[i] = vertex.y();
+    verticesZ[i] = vertex.z();
+  }
 
-    if ( minAreaCheck || maxAreaCheck || minAngleCheck || maxAngleCheck )
-    {
-      QgsGeometry geomT = geom;
-      if ( mTransform.isValid() )
-      {
-        try
-        {
-          geomT.transform( mTransform );
-        }
-        catch ( QgsCsException &e )
-        {
-          geomT = geom;
-        }
-      }
+  QVector<int> faces;
+  QVector<int> faceStarts;
+  faceStarts.reserve( mMesh.faceCount() + 1 );
+  faceStarts.append( 0 );
+  for ( const QgsMeshFace &face : std::as_const( mMesh.faces ) )
+  {
+    faces.append( face );
+    faceStarts.append( faces.count() );
+  }
 
-      QPolygonF poly = geomT.asQPolygonF();
+  if ( isStop() )
+    return;
 
-      if ( minAreaCheck )
-        mResult.minimumArea.append( poly );
-      if ( maxAreaCheck )
-        mResult.maximumArea.append( poly );
-      if ( minAngleCheck )
-        mResult.minimumAngle.append( poly );
-      if ( maxAngleCheck )
-        mResult.maximumAngle.append( poly );
-    }
+  ReosMeshQualityKernel::Results results;
+  {
+    // the mesh is flattened again on each check, but the kernel keeps the state of the last check,
+    // so only the metrics of the faces changed since are calculated again
+    QMutexLocker locker( &mKernel->mutex );
+    ReosMeshQualityKernel &kernel = mKernel->kernel;
+    kernel.setUnitFactors( QgsUnitTypes::fromUnitToUnitFactor( mDistanceArea.lengthUnits(), QgsUnitTypes::DistanceMeters ),
+                           QgsUnitTypes::fromUnitToUnitFactor( mDistanceArea.areaUnits(), QgsUnitTypes::AreaSquareMeters ) );
+    kernel.update( verticesX, verticesY, verticesZ, faces, faceStarts );
+    mError = kernel.error();
+    mErrorElement = kernel.errorElement();
+    if ( mError != ReosMeshQualityKernel::Error::NoError )
+      return;
 
+    setCurrentProgression( 1 );
     if ( isStop() )
       return;
-    setCurrentProgression( i );
+
+    results = kernel.check( mChecks, mThresholds );
   }
 
-  for ( int i : maxAreaChange )
+  setCurrentProgression( 2 );
+  if ( isStop() )
+    return;
+
+  // only the elements that do not satisfy the checks are transformed in the destination crs
+  auto facePolygons = [this, &faces, &faceStarts]( const QVector<int> &faceIndexes )
   {
-    const QgsMeshFace &face =  mMesh.face( i );
-    QgsGeometry geom = QgsMeshUtils::toGeometry( face, mMesh.vertices );
-    if ( mTransform.isValid() )
+    QList<QPolygonF> polygons;
+    polygons.reserve( faceIndexes.count() );
+    for ( int f : faceIndexes )
     {
-      try
-      {
-        geom.transform( mTransform );
-      }
-      catch ( QgsCsException &e )
-      {
-        geom = QgsMeshUtils::toGeometry( face, mMesh.vertices );
-      }
+      QPolygonF polygon;
+      for ( int i = faceStarts.at( f ); i < faceStarts.at( f + 1 ); ++i )
+        polygon.append( toDestination( mMesh.vertices.at( faces.at( i ) ) ) );
+      polygon.append( polygon.first() );
+      polygons.append( polygon );
     }
-    mResult.maximumAreaChange.append( geom.asQPolygonF() );
+    return polygons;
+  };
 
-    if ( isStop() )
-      return;
-  }
+  auto vertexPoints = [this]( const QVector<int> &vertexIndexes )
+  {
+    QList<QPointF> points;
+    points.reserve( vertexIndexes.count() );
+    for ( int v : vertexIndexes )
+      points.append( toDestination( mMesh.vertices.at( v ) ) );
+    return points;
+  };
+
+  mResult.minimumAngle = facePolygons( results.minimumAngle );
+  mResult.maximumAngle = facePolygons( results.maximumAngle );
+  mResult.minimumArea = facePolygons( results.minimumArea );
+  mResult.maximumArea = facePolygons( results.maximumArea );
+  mResult.maximumAreaChange = facePolygons( results.maximumAreaChange );
 
   setInformation( tr( "Check vertices" ) );
-  setMaxProgression( mMesh.vertices.count() );
-  setCurrentProgression( 0 );
-  if ( mChecks & ( ReosMesh::ConnectionCount | ReosMesh::ConnectionCountBoundary ) )
+  mResult.connectionCount = vertexPoints( results.connectionCount );
+  mResult.connectionCountBoundary = vertexPoints( results.connectionCountBoundary );
+  for ( const QPair<int, int> &edge : std::as_const( results.maximumSlope ) )
+    mResult.maximumSlope.append( QLineF( toDestination( mMesh.vertices.at( edge.first ) ), toDestination( mMesh.vertices.at( edge.second ) ) ) );
+
+  setCurrentProgression( 3 );
+  mIsSuccessful = true;
+}
+
+QPointF ReosMeshQualityChecker_p::toDestination( const QgsPointXY &point ) const
+{
+  if ( mTransform.isValid() )
   {
-    for ( int i = 0; i < mMesh.vertexCount(); ++i )
+    try
     {
-      bool connCheck = false;
-      bool connBoundCheck = false;
-      QgsMeshVertexCirculator circulator = topologicalMesh.vertexCirculator( i );
+      return mTransform.transform( point ).toQPointF();
+    }
+    catch ( QgsCsException &e )
+    {
+      return point.toQPointF();
+    }
+  }
 
-      if ( ( mChecks & ( ReosMesh::ConnectionCount ) ) &&
-           circulator.degree() > mConnectionCount )
-        connCheck = true;
+  return point.toQPointF();
+}
 
-      if ( ( mChecks & ( ReosMesh::ConnectionCountBoundary ) ) &&
-           topologicalMesh.isVertexOnBoundary( i ) )
-      {
-        if ( circulator.degree() > mConnectionCountBoundary )
-          connBoundCheck = true;
-      }
+ReosMeshQualityChecker::QualityMeshResults ReosMeshQualityChecker_p::result() const
+{
+  switch ( mError )
+  {
+    case ReosMeshQualityKernel::Error::NoError:
+      break;
+    case ReosMeshQualityKernel::Error::InvalidFace:
+      mResult.error = QObject::tr( "Invalid face" );
+      mResult.errorFace = mErrorElement;
+      break;
+    case ReosMeshQualityKernel::Error::TooManyVerticesInFace:
+      mResult.error = QObject::tr( "Too many vertices" );
+      mResult.errorFace = mErrorElement;
+      break;
+    case ReosMeshQualityKernel::Error::FlatFace:
+      mResult.error = QObject::tr( "Flat face" );
+      mResult.errorFace = mErrorElement;
+      break;
+    case ReosMeshQualityKernel::Error::UniqueSharedVertex:
+      mResult.error = QObject::tr( "Unique shared vertex" );
+      mResult.errorVertex = mErrorElement;
+      break;
+    case ReosMeshQualityKernel::Error::InvalidVertex:
+      mResult.error = QObject::tr( "Invalid vertex" );
+      mResult.errorFace = mErrorElement;
+      break;
+    case ReosMeshQualityKernel::Error::ManifoldFace:
+      mResult.error = QObject::tr( "Manifold face" );
+      mResult.errorFace = mErrorElement;
+      break;
+  }
 
-      if ( connCheck || connBoundCheck )
-      {
-        QPointF pt;
-        if ( mTransform.isValid() )
-        {
-          try
-          {
-            pt = mTransform.transform( QgsPointXY( mMesh.vertex( i ) ) ).toQPointF();
-          }
-          catch ( QgsCsException &e )
-          {
-            pt = mMesh.vertex( i ).toQPointF();
-          }
-        }
-        else
-        {
-          pt = mMesh.vertex( i ).toQPointF();
-        }
+  return mResult;
+}
 
-        if ( connCheck )
-          mResult.connectionCount.append( pt );
-        if ( connBoundCheck )
-          mResult.connectionCountBoundary.append( pt );
-      }
+ReosMeshPointProbe_p::ReosMeshPointProbe_p( const QgsMesh &mesh, const QgsCoordinateReferenceSystem &crs )
+  : mCrs( crs )
+  , mCrsWkt( crs.isValid() ? crs.toWkt( QgsCoordinateReferenceSystem::WKT_PREFERRED_SIMPLIFIED ) : QString() )
+{
+  const int vertexCount = mesh.vertexCount();
+  mVerticesX.resize( vertexCount );
+  mVerticesY.resize( vertexCount );
+  for ( int i = 0; i < vertexCount; ++i )
+  {
+    mVerticesX[i] = mesh.vertices.at( i ).x();
+    mVerticesY[i] = mesh.vertices.at( i ).y();
+  }
 
-      setCurrentProgression( i );
+  // faces are split in fan of triangles
+  for ( int f = 0; f < mesh.faceCount(); ++f )
+  {
+    const QgsMeshFace &face = mesh.face( f );
+    for ( int i = 1; i < face.count() - 1; ++i )
+    {
+      mTriangles << face.at( 0 ) << face.at( i ) << face.at( i + 1 );
+      mTriangleFaces.append( f );
     }
   }
 
-  mIsSuccessful = true;
-
+  buildIndex();
 }
 
-ReosMeshQualityChecker::QualityMeshResults ReosMeshQualityChecker_p::result() const
+void ReosMeshPointProbe_p::buildIndex()
 {
-  if ( mError != QgsMeshEditingError() )
+  const int triangleCount = mTriangleFaces.count();
+  if ( triangleCount == 0 )
+    return;
+
+  const double xMin = *std::min_element( mVerticesX.constBegin(), mVerticesX.constEnd() );
+  const double xMax = *std::max_element( mVerticesX.constBegin(), mVerticesX.constEnd() );
+  const double yMin = *std::min_element( mVerticesY.constBegin(), mVerticesY.constEnd() );
+  const double yMax = *std::max_element( mVerticesY.constBegin(), mVerticesY.constEnd() );
+
+  // about one triangle per cell
+  const double width = std::max( xMax - xMin, std::numeric_limits<double>::epsilon() );
+  const double height = std::max( yMax - yMin, std::numeric_limits<double>::epsilon() );
+  mCellSize = std::max( std::sqrt( width * height / triangleCount ), std::max( width, height ) / 4096 );
+  mGridXMin = xMin;
+  mGridYMin = yMin;
+  mGridColumnCount = static_cast<int>( width / mCellSize ) + 1;
+  mGridRowCount = static_cast<int>( height / mCellSize ) + 1;
+
+  auto triangleCellRange = [this]( int triangle, int & c0, int & c1, int & r0, int & r1 )
   {
-    switch ( mError.errorType )
+    double txMin = std::numeric_limits<double>::max();
+    double txMax = -std::numeric_limits<double>::max();
+    double tyMin = std::numeric_limits<double>::max();
+    double tyMax = -std::numeric_limits<double>::max();
+    for ( int i = 0; i < 3; ++i )
     {
-      case Qgis::MeshEditingErrorType::NoError:
-        break;
-      case Qgis::MeshEditingErrorType::InvalidFace:
-        mResult.error = QObject::tr( "Invalid face" );
-        mResult.errorFace = mError.elementIndex;
-        break;
-      case Qgis::MeshEditingErrorType::TooManyVerticesInFace:
-        mResult.error = QObject::tr( "Too many vertices" );
-        mResult.errorFace = mError.elementIndex;
-        break;
-      case Qgis::MeshEditingErrorType::FlatFace:
-        mResult.error = QObject::tr( "Flat face" );
-        mResult.errorFace = mError.elementIndex;
-        break;
-      case Qgis::MeshEditingErrorType::UniqueSharedVertex:
-        mResult.error = QObject::tr( "Unique shared vertex" );
-        mResult.errorVertex = mError.elementIndex;
-        break;
-      case Qgis::MeshEditingErrorType::InvalidVertex:
-        mResult.error = QObject::tr( "Invalid vertex" );
-        mResult.errorVertex = mError.elementIndex;
-        break;
-      case Qgis::MeshEditingErrorType::ManifoldFace:
-        mResult.error = QObject::tr( "Manifold face" );
-        mResult.errorFace = mError.elementIndex;
-        break;
+      const int v = mTriangles.at( 3 * triangle + i );
+      txMin = std::min( txMin, mVerticesX.at( v ) );
+      txMax = std::max( txMax, mVerticesX.at( v ) );
+      tyMin = std::min( tyMin, mVerticesY.at( v ) );
+      tyMax = std::max( tyMax, mVerticesY.at( v ) );
     }
+    c0 = std::min( static_cast<int>( ( txMin - mGridXMin ) / mCellSize ), mGridColumnCount - 1 );
+    c1 = std::min( static_cast<int>( ( txMax - mGridXMin ) / mCellSize ), mGridColumnCount - 1 );
+    r0 = std::min( static_cast<int>( ( tyMin - mGridYMin ) / mCellSize ), mGridRowCount - 1 );
+    r1 = std::min( static_cast<int>( ( tyMax - mGridYMin ) / mCellSize ), mGridRowCount - 1 );
+  };
+
+  // first pass counts the triangles in each cell, second pass fills the cells
+  mCellStarts.fill( 0, mGridColumnCount * mGridRowCount + 1 );
+  int c0, c1, r0, r1;
+  for ( int t = 0; t < triangleCount; ++t )
+  {
+    triangleCellRange( t, c0, c1, r0, r1 );
+    for ( int r = r0; r <= r1; ++r )
+      for ( int c = c0; c <= c1; ++c )
+        mCellStarts[r * mGridColumnCount + c + 1]++;
   }
 
-  return mResult;
+  for ( int i = 1; i < mCellStarts.count(); ++i )
+    mCellStarts[i] += mCellStarts.at( i - 1 );
+
+  mCellTriangles.resize( mCellStarts.last() );
+  QVector<int> cellFilling = mCellStarts;
+  for ( int t = 0; t < triangleCount; ++t )
+  {
+    triangleCellRange( t, c0, c1, r0, r1 );
+    for ( int r = r0; r <= r1; ++r )
+      for ( int c = c0; c <= c1; ++c )
+        mCellTriangles[cellFilling[r * mGridColumnCount + c]++] = t;
+  }
+}
+
+QgsPointXY ReosMeshPointProbe_p::toMeshCoordinates( const QPointF &point, const QString &crs ) const
+{
+  return QgsPointXY( ReosCoordinateTransform( crs, mCrsWkt ).transform( point ) );
+}
+
+ReosMeshPointProbe_p::Location ReosMeshPointProbe_p::locate( const QgsPointXY &point ) const
+{
+  Location location;
+  if ( mCellStarts.isEmpty() )
+    return location;
+
+  const double px = ( point.x() - mGridXMin ) / mCellSize;
+  const double py = ( point.y() - mGridYMin ) / mCellSize;
+  if ( !( px >= 0 && py >= 0 && px < mGridColumnCount && py < mGridRowCount ) )
+    return location;
+
+  const int cell = static_cast<int>( py ) * mGridColumnCount + static_cast<int>( px );
+  for ( int i = mCellStarts.at( cell ); i < mCellStarts.at( cell + 1 ); ++i )
+  {
+    const int triangle = mCellTriangles.at( i );
+    const int iA = mTriangles.at( 3 * triangle );
+    const int iB = mTriangles.at( 3 * triangle + 1 );
+    const int iC = mTriangles.at( 3 * triangle + 2 );
+
+    // same barycentric coordinates calculation as in QGIS src/core/mesh/qgsmeshlayerutils.cpp
+    const double xa = mVerticesX.at( iA );
+    const double ya = mVerticesY.at( iA );
+    const double v0x = mVerticesX.at( iC ) - xa ;
+    const double v0y = mVerticesY.at( iC ) - ya ;
+    const double v1x = mVerticesX.at( iB ) - xa ;
+    const double v1y = mVerticesY.at( iB ) - ya ;
+    const double v2x = point.x() - xa ;
+    const double v2y = point.y() - ya ;
+
+    const double dot00 = v0x * v0x + v0y * v0y;
+    const double dot01 = v0x * v1x + v0y * v1y;
+    const double dot02 = v0x * v2x + v0y * v2y;
+    const double dot11 = v1x * v1x + v1y * v1y;
+    const double dot12 = v1x * v2x + v1y * v2y;
+
+    double invDenom =  dot00 * dot11 - dot01 * dot01;
+    if ( invDenom == 0 )
+      continue;
+    invDenom = 1.0 / invDenom;
+    double lam1 = ( dot11 * dot02 - dot01 * dot12 ) * invDenom;
+    double lam2 = ( dot00 * dot12 - dot01 * dot02 ) * invDenom;
+    double lam3 = 1.0 - lam1 - lam2;
+
+    lamTol( lam1 );
+    lamTol( lam2 );
+    lamTol( lam3 );
+
+    if ( ( lam1 < 0 ) || ( lam2 < 0 ) || ( lam3 < 0 ) )
+      continue;
+
+    location.face = mTriangleFaces.at( triangle );
+    location.vertices[0] = iA;
+    location.vertices[1] = iB;
+    location.vertices[2] = iC;
+    location.lambdas[0] = lam3;
+    location.lambdas[1] = lam2;
+    location.lambdas[2] = lam1;
+    return location;
+  }
+
+  return location;
 }
 
+double ReosMeshPointProbe_p::interpolate( const ReosMeshDatasetSource *datasetSource, const Location &location, int groupIndex, int datasetIndex, bool isScalar ) const
+{
+  if ( location.face < 0 || !datasetSource->groupFaceIsActive( groupIndex, datasetIndex, location.face ) )
+    return std::numeric_limits<double>::quiet_NaN();
+
+  double values[2];
+  double result[2] = {0, 0};
+  const int valuesPerVertex = isScalar ? 1 : 2;
+  for ( int i = 0; i < 3; ++i )
+  {
+    if ( !datasetSource->datasetValuesOnVertices( groupIndex, datasetIndex, location.vertices[i], 1, values ) )
+      return std::numeric_limits<double>::quiet_NaN();
+
+    for ( int j = 0; j < valuesPerVertex; ++j )
+      result[j] += location.lambdas[i] * values[j];
+  }
+
+  if ( isScalar )
+    return result[0];
+
+  return std::sqrt( std::pow( result[0], 2 ) + std::pow( result[1], 2 ) );
+}
+
+double ReosMeshPointProbe_p::value( const ReosMeshDatasetSource *datasetSource, const ReosSpatialPosition &position, int groupIndex, int datasetIndex ) const
+{
+  if ( !datasetSource )
+    return std::numeric_limits<double>::quiet_NaN();
+
+  const Location location = locate( toMeshCoordinates( position.position(), position.crs() ) );
+  return interpolate( datasetSource, location, groupIndex, datasetIndex, datasetSource->groupIsScalar( groupIndex ) );
+}
+
+QVector<double> ReosMeshPointProbe_p::values( const ReosMeshDatasetSource *datasetSource, const QPolygonF &points, const QString &crs, int groupIndex, int datasetIndex ) const
+{
+  QVector<double> ret( points.count(), std::numeric_limits<double>::quiet_NaN() );
+  if ( !datasetSource )
+    return ret;
+
+  // all the points are transformed in one batch
+  const QPolygonF meshPoints = ReosCoordinateTransform( crs, mCrsWkt ).transform( points );
+  const bool isScalar = datasetSource->groupIsScalar( groupIndex );
+
+  for ( int i = 0; i < meshPoints.count(); ++i )
+    ret[i] = interpolate( datasetSource, locate( QgsPointXY( meshPoints.at( i ) ) ), groupIndex, datasetIndex, isScalar );
+
+  return ret;
+}
+
+QVector<double> ReosMeshPointProbe_p::timeSerie( const ReosMeshDatasetSource *datasetSource, const ReosSpatialPosition &position, int groupIndex ) const
+{
+  if ( !datasetSource )
+    return QVector<double>();
+
+  const int datasetCount = datasetSource->datasetCount( groupIndex );
+  QVector<double> ret( datasetCount, std::numeric_limits<double>::quiet_NaN() );
+
+  // the point is located once for all the datasets
+  const Location location = locate( toMeshCoordinates( position.position(), position.crs() ) );
+  if ( location.face < 0 )
+    return ret;
+
+  const bool isScalar = datasetSource->groupIsScalar( groupIndex );
+  for ( int i = 0; i < datasetCount; ++i )
+    ret[i] = interpolate( datasetSource, location, groupIndex, i, isScalar );
+
+  return ret;
+}
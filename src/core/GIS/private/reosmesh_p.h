@@ -16,15 +16,20 @@
 #ifndef REOSMESH_P_H
 #define REOSMESH_P_H
 
+#include <QMutex>
+#include <QPointer>
+
 #include <qgsmeshlayer.h>
 #include <qgsrendercontext.h>
 #include <qgsmesheditor.h>
 #include <qgsmeshdataset.h>
 
 #include "reosmesh.h"
+#include "reosmeshqualitykernel.h"
 #include "reoshydraulicsimulationresults.h"
 
 class ReosMeshDataProvider_p;
+class ReosMeshPointProbe_p;
 class ReosMeshFrameData;
 class QgsMeshDatasetGroup;
 class ReosDigitalElevationModel;
@@ -32,6 +37,13 @@ class ReosDigitalElevationModel;
 class QGraphicsView;
 class QgsMapLayerRenderer;
 
+//! Quality kernel of a mesh frame shared with its quality checkers, keeps the state of the last check for incremental checks
+struct ReosMeshQualityKernel_p
+{
+  QMutex mutex;
+  ReosMeshQualityKernel kernel;
+};
+
 /**
  * Implementation of a mesh in Reos environment.
  * This class contains a QgsMeshLayer that can be independant from the QgsProject.
@@ -47,6 +59,7 @@ class ReosMeshFrame_p : public ReosMesh
     bool isValid() const override;
     int vertexCount() const override;
     QPointF vertexPosition( int vertexIndex, const QString &destinationCrs = QString() ) override;
+    QPolygonF vertexPositions( const QString &destinationCrs = QString() ) override;
     QVector<int> face( int faceIndex ) const override;
     int faceCount() const override;
     QString enableVertexElevationDataset( const QString &name ) override;
@@ -87,6 +100,7 @@ class ReosMeshFrame_p : public ReosMesh
     void setWireFrameSettings( const WireFrameSettings &wireFrameSettings ) override;
 
     double interpolateDatasetValueOnPoint( const ReosMeshDatasetSource *datasetSource, const ReosSpatialPosition &position, int sourceGroupindex, int datasetIndex ) const override;
+    ReosMeshPointProbe *createPointProbe() const override;
 
   private:
     std::unique_ptr<QgsMeshLayer> mMeshLayer;
@@ -98,17 +112,29 @@ class ReosMeshFrame_p : public ReosMesh
     QString mCurrentdScalarDatasetId;
     QString mVerticalDataset3DId;
     WireFrameSettings mWireFrameSettings;
+    QPointer<ReosHydraulicSimulationResults> mSimulationResults;
 
     void init();
     void activateVertexZValueDatasetGroup();
     QString addDatasetGroup( QgsMeshDatasetGroup *group, const QString &id = QString() );
     void firstUpdateOfTerrainScalarSetting();
+    void updateResultsScalarSettings();
     void restoreVertexElevationDataset();
     void updateWireFrameSettings();
-
-    QPointF tolayerCoordinates( const ReosSpatialPosition &position ) const;
+    void updateTransformedVertices( const QString &destinationCrs );
 
     std::map <QGraphicsView *, std::unique_ptr<QgsMapLayerRenderer>> mRenders;
+
+    //! Probe used for single interpolation, reset when the frame changes
+    mutable std::unique_ptr<ReosMeshPointProbe_p> mPointProbe;
+
+    std::shared_ptr<ReosMeshQualityKernel_p> mQualityKernel = std::make_shared<ReosMeshQualityKernel_p>();
+
+    //! Coordinates of the vertices in the last destination crs requested, invalidated when the frame changes
+    QString mTransformedVerticesCrs;
+    QVector<double> mTransformedVerticesX;
+    QVector<double> mTransformedVerticesY;
+    bool mTransformedVerticesValid = false;
 };
 
 class ReosMeshRenderer_p : public ReosObjectRenderer
@@ -136,25 +162,68 @@ class ReosMeshQualityChecker_p : public ReosMeshQualityChecker
                               ReosMesh::QualityMeshParameters params,
                               const QgsDistanceArea &distanceArea,
                               ReosMesh::QualityMeshChecks checks,
-                              const QgsCoordinateTransform &transform );
+                              const QgsCoordinateTransform &transform,
+                              std::shared_ptr<ReosMeshQualityKernel_p> kernel );
 
     void start() override;
     QualityMeshResults result() const override;
 
   private:
     QgsMesh mMesh;
-    double mMinimumAngle = 0;
-    double mMaximumAngle = 0;
-    int mConnectionCount = 0;
-    int mConnectionCountBoundary = 0;
-    double mMaximumSlope = 0;
-    double mMinimumArea = 0; //in m2
-    double mMaximumArea = 0; //in m2
-    double mMaximumAreaChange = 0;
+    ReosMeshQualityKernel::Thresholds mThresholds;
     QgsDistanceArea mDistanceArea;
     ReosMesh::QualityMeshChecks mChecks;
-    QgsMeshEditingError mError;
+    ReosMeshQualityKernel::Error mError = ReosMeshQualityKernel::Error::NoError;
+    int mErrorElement = -1;
     QgsCoordinateTransform mTransform;
+    std::shared_ptr<ReosMeshQualityKernel_p> mKernel;
+
+    QPointF toDestination( const QgsPointXY &point ) const;
+};
+
+
+class ReosMeshPointProbe_p : public ReosMeshPointProbe
+{
+  public:
+
+    //! Constructor with the \a mesh in the coordinates system \a crs, faces are split in triangles and indexed in a regular grid
+    ReosMeshPointProbe_p( const QgsMesh &mesh, const QgsCoordinateReferenceSystem &crs );
+
+    double value( const ReosMeshDatasetSource *datasetSource, const ReosSpatialPosition &position, int groupIndex, int datasetIndex ) const override;
+    QVector<double> values( const ReosMeshDatasetSource *datasetSource, const QPolygonF &points, const QString &crs, int groupIndex, int datasetIndex ) const override;
+    QVector<double> timeSerie( const ReosMeshDatasetSource *datasetSource, const ReosSpatialPosition &position, int groupIndex ) const override;
+
+  private:
+    //! Triangle containing a point with the barycentric coordinates of the point
+    struct Location
+    {
+      int face = -1;
+      int vertices[3] = {-1, -1, -1};
+      double lambdas[3] = {0, 0, 0};
+    };
+
+    QgsCoordinateReferenceSystem mCrs;
+    QString mCrsWkt;
+    QVector<double> mVerticesX;
+    QVector<double> mVerticesY;
+
+    // three vertices per triangle and the native face of each triangle
+    QVector<int> mTriangles;
+    QVector<int> mTriangleFaces;
+
+    // regular grid, triangles of the cell i are mCellTriangles[mCellStarts[i]] to mCellTriangles[mCellStarts[i+1]-1]
+    double mGridXMin = 0;
+    double mGridYMin = 0;
+    double mCellSize = 1;
+    int mGridColumnCount = 0;
+    int mGridRowCount = 0;
+    QVector<int> mCellStarts;
+    QVector<int> mCellTriangles;
+
+    void buildIndex();
+    QgsPointXY toMeshCoordinates( const QPointF &point, const QString &crs ) const;
+    Location locate( const QgsPointXY &point ) const;
+    double interpolate( const ReosMeshDatasetSource *datasetSource, const Location &location, int groupIndex, int datasetIndex, bool isScalar ) const;
 };
 
 #endif // REOSMESH_P_H
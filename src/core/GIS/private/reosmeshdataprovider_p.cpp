@@ -174,7 +174,7 @@ QgsMeshDataBlock ReosMeshDataProvider_p::areFacesActive( QgsMeshDatasetIndex ind
   if ( !mDatasetSource )
     return QgsMeshDataBlock();
 
-  QVector<int> values = mDatasetSource->activeFaces( index.dataset() );
+  QVector<int> values = mDatasetSource->groupActiveFaces( index.group(), index.dataset() );
 
   if ( values.isEmpty() )
     return ret;
@@ -254,18 +254,16 @@ void ReosMeshDataProvider_p::generateMesh( const ReosMeshFrameData &data )
 
 void ReosMeshDataProvider_p::applyDemOnVertices( ReosDigitalElevationModel *dem )
 {
-  double noDataValue = dem->noDataValue();
   QString wktCrs = mCrs.toWkt( QgsCoordinateReferenceSystem::WKT2_2019_SIMPLIFIED );
 
+  QPolygonF points( mMesh.vertexCount() );
   for ( int i = 0; i < mMesh.vertexCount(); ++i )
-  {
-    QPointF pt( mMesh.vertices.at( i ).toQPointF() );
-    double value = dem->elevationAt( pt, wktCrs );
-    if ( value != noDataValue )
-      mMesh.vertices[i].setZ( value );
-    else
-      mMesh.vertices[i].setZ( std::numeric_limits<double>::quiet_NaN() );
-  }
+    points[i] = mMesh.vertices.at( i ).toQPointF();
+
+  const QVector<double> values = dem->elevationsAt( points, wktCrs );
+  for ( int i = 0; i < mMesh.vertexCount(); ++i )
+    mMesh.vertices[i].setZ( values.at( i ) );
+
   emit dataChanged();
 }
 
@@ -276,8 +274,6 @@ void ReosMeshDataProvider_p::applyTopographyOnVertices( ReosTopographyCollection
   if ( !topoCollection )
     return;
 
-  int processStep = mMesh.vertexCount() / 100;
-
   if ( process )
   {
     process->setInformation( tr( "Prepare topography collection" ) );
@@ -290,24 +286,20 @@ void ReosMeshDataProvider_p::applyTopographyOnVertices( ReosTopographyCollection
   if ( process )
     process->setInformation( tr( "Apply topography on Mesh" ) );
 
+  QVector<QgsPointXY> points( mMesh.vertexCount() );
   for ( int i = 0; i < mMesh.vertexCount(); ++i )
-  {
-    double value = topoCollection->elevationAt_p( mMesh.vertices.at( i ) );
-    if ( !std::isnan( value ) )
-      mMesh.vertices[i].setZ( value );
-    else
-      mMesh.vertices[i].setZ( std::numeric_limits<double>::quiet_NaN() );
-
-    if ( process && i % processStep == 0 )
-    {
-      process->setCurrentProgression( i );
-      if ( process->isStop() )
-        break;
-    }
-  }
+    points[i] = mMesh.vertices.at( i );
 
+  // all the vertices are sampled in one batch, DEM tiles are read once
+  const QVector<double> values = topoCollection->elevationsAt_p( points, process );
   topoCollection->clean_p();
 
+  if ( process && process->isStop() )
+    return;
+
+  for ( int i = 0; i < mMesh.vertexCount(); ++i )
+    mMesh.vertices[i].setZ( values.at( i ) );
+
   emit dataChanged();
 }
 
@@ -332,8 +324,15 @@ QgsMesh ReosMeshDataProvider_p::convertFrameFromReos( const ReosMeshFrameData &r
       ret.vertices[i].setZ( std::numeric_limits<double>::quiet_NaN() );
   }
 
-  ret.faces.resize( reosMesh.facesIndexes.size() );
+  const int faceCount = reosMesh.faceCount();
+  ret.faces.resize( faceCount );
+  for ( int i = 0; i < faceCount; ++i )
+  {
+    const int faceSize = reosMesh.faceSize( i );
+    QgsMeshFace &face = ret.faces[i];
+    face.resize( faceSize );
+    memcpy( face.data(), reosMesh.faceVertices( i ), faceSize * sizeof( int ) );
+  }
 
-  ret.faces = reosMesh.facesIndexes;
   return ret;
 }
@@ -300,6 +300,57 @@ ReosPolygonStructureValues *ReosPolygonStructure_p::values( const QString &desti
   return ret.release();
 }
 
+QList<QList<QPolygonF>> ReosPolygonStructure_p::polygons( const QString &classId, const QString &destinationCrs ) const
+{
+  QList<QList<QPolygonF>> ret;
+  const QgsCoordinateTransform transform = toDestinationTransform( destinationCrs );
+
+  QgsFeatureIterator it = mVectorLayer->getFeatures();
+  QgsFeature feat;
+  while ( it.nextFeature( feat ) )
+  {
+    if ( feat.attribute( 0 ).toString() != classId )
+      continue;
+
+    QgsGeometry geom = feat.geometry();
+    if ( transform.isValid() )
+    {
+      try
+      {
+        geom.transform( transform );
+      }
+      catch ( QgsCsException & )
+      {
+        geom = feat.geometry();
+      }
+    }
+
+    QgsMultiPolygonXY multiPolygon;
+    if ( geom.isMultipart() )
+      multiPolygon = geom.asMultiPolygon();
+    else
+      multiPolygon.append( geom.asPolygon() );
+
+    for ( const QgsPolygonXY &polygon : qAsConst( multiPolygon ) )
+    {
+      QList<QPolygonF> rings;
+      for ( const QgsPolylineXY &ring : polygon )
+      {
+        QPolygonF qRing;
+        qRing.reserve( ring.count() );
+        for ( const QgsPointXY &point : ring )
+          qRing.append( point.toQPointF() );
+        rings.append( qRing );
+      }
+
+      if ( !rings.isEmpty() )
+        ret.append( rings );
+    }
+  }
+
+  return ret;
+}
+
 QUndoStack *ReosPolygonStructure_p::undoStack() const
 {
   return mVectorLayer->undoStack();
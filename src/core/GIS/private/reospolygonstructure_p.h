@@ -66,6 +66,7 @@ class ReosPolygonStructure_p : public ReosPolygonStructure, private ReosGeometry
     int polygonsCount() const override;
 
     ReosPolygonStructureValues *values( const QString &destinationCrs ) const override;
+    QList<QList<QPolygonF>> polygons( const QString &classId, const QString &destinationCrs ) const override;
 
     QUndoStack *undoStack() const override;
 
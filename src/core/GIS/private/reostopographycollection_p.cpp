@@ -17,6 +17,7 @@
 
 #include "reosdigitalelevationmodel_p.h"
 #include "reosgisengine.h"
+#include "reosprocess.h"
 
 ReosTopographyCollection_p::ReosTopographyCollection_p( ReosGisEngine *gisEngine, QObject *parent )
   : ReosTopographyCollection( gisEngine, parent )
@@ -56,6 +57,55 @@ double ReosTopographyCollection_p::elevationAt_p( const QgsPointXY &point ) cons
   return std::numeric_limits<double>::quiet_NaN();
 }
 
+QVector<double> ReosTopographyCollection_p::elevationsAt_p( const QVector<QgsPointXY> &points, ReosProcess *process ) const
+{
+  QVector<double> values( points.count(), std::numeric_limits<double>::quiet_NaN() );
+  QVector<int> missingPoints( points.count() );
+  for ( int i = 0; i < points.count(); ++i )
+    missingPoints[i] = i;
+
+  if ( process )
+  {
+    process->setMaxProgression( points.count() * std::max( 1, static_cast<int>( mDem.size() ) ) );
+    process->setCurrentProgression( 0 );
+  }
+
+  int progressionOffset = 0;
+  for ( size_t i = 0; i < mDem.size() && !missingPoints.isEmpty(); ++i )
+  {
+    QVector<double> x( missingPoints.count() );
+    QVector<double> y( missingPoints.count() );
+    for ( int p = 0; p < missingPoints.count(); ++p )
+    {
+      const QgsPointXY &point = points.at( missingPoints.at( p ) );
+      x[p] = point.x();
+      y[p] = point.y();
+    }
+
+    ReosDigitalElevationModelRaster::transformCoordinates( x, y, mTransforms.at( int( i ) ) );
+    const QVector<double> demValues = mDem.at( i )->elevationsAt( x, y, process, progressionOffset );
+    progressionOffset += points.count();
+
+    if ( process && process->isStop() )
+      return values;
+
+    QVector<int> stillMissingPoints;
+    for ( int p = 0; p < missingPoints.count(); ++p )
+    {
+      if ( std::isnan( demValues.at( p ) ) )
+        stillMissingPoints.append( missingPoints.at( p ) );
+      else
+        values[missingPoints.at( p )] = demValues.at( p );
+    }
+    missingPoints = stillMissingPoints;
+  }
+
+  if ( process )
+    process->setCurrentProgression( process->maxProgression() );
+
+  return values;
+}
+
 void ReosTopographyCollection_p::clean_p() const
 {
   mDem.clear();
@@ -31,6 +31,12 @@ class ReosTopographyCollection_p : public ReosTopographyCollection
 
     void prepare_p( const QgsCoordinateReferenceSystem &sourceCrs ) const;
     double elevationAt_p( const QgsPointXY &point ) const;
+
+    /**
+     * Returns the elevations at \a points, each DEM is sampled in one batch for the points that have not yet a value from DEM with higher priority.
+     * Returned value is NaN where no DEM has value. prepare_p() has to be called before.
+     */
+    QVector<double> elevationsAt_p( const QVector<QgsPointXY> &points, ReosProcess *process = nullptr ) const;
     void clean_p() const;
 
   private:
@@ -0,0 +1,165 @@
+/***************************************************************************
+  reoscoordinatetransform.cpp - ReosCoordinateTransform
+
+ ---------------------
+ begin                : 26.5.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "reoscoordinatetransform.h"
+
+#include <cmath>
+
+#include <QHash>
+#include <QMutex>
+
+#include <qgscoordinatetransform.h>
+#include <qgscsexception.h>
+#include <qgsproject.h>
+
+// over this count of cached transforms, the cache is cleared before adding a new one
+#define MAX_CACHED_TRANSFORM_COUNT 32
+
+typedef QHash<QPair<QString, QString>, std::shared_ptr<const QgsCoordinateTransform>> TransformCache;
+
+static QMutex *cacheMutex()
+{
+  static QMutex mutex;
+  return &mutex;
+}
+
+static TransformCache *transformCache()
+{
+  static TransformCache cache;
+  return &cache;
+}
+
+ReosCoordinateTransform::ReosCoordinateTransform( const QString &sourceCrs, const QString &destinationCrs )
+{
+  if ( sourceCrs.isEmpty() || destinationCrs.isEmpty() )
+    return;
+
+  const QPair<QString, QString> key( sourceCrs, destinationCrs );
+  QMutexLocker locker( cacheMutex() );
+  TransformCache *cache = transformCache();
+  auto it = cache->constFind( key );
+  if ( it != cache->constEnd() )
+  {
+    mTransform = it.value();
+    return;
+  }
+
+  mTransform = std::make_shared<QgsCoordinateTransform>( QgsCoordinateReferenceSystem::fromWkt( sourceCrs ),
+               QgsCoordinateReferenceSystem::fromWkt( destinationCrs ),
+               QgsProject::instance()->transformContext() );
+
+  if ( cache->count() >= MAX_CACHED_TRANSFORM_COUNT )
+    cache->clear();
+  cache->insert( key, mTransform );
+}
+
+bool ReosCoordinateTransform::isValid() const
+{
+  return mTransform && mTransform->isValid();
+}
+
+QPointF ReosCoordinateTransform::transform( const QPointF &point ) const
+{
+  if ( !isValid() )
+    return point;
+
+  try
+  {
+    return mTransform->transform( QgsPointXY( point ) ).toQPointF();
+  }
+  catch ( QgsCsException & )
+  {
+    return point;
+  }
+}
+
+QPolygonF ReosCoordinateTransform::transform( const QPolygonF &points ) const
+{
+  if ( !isValid() )
+    return points;
+
+  QVector<double> x( points.count() );
+  QVector<double> y( points.count() );
+  for ( int i = 0; i < points.count(); ++i )
+  {
+    x[i] = points.at( i ).x();
+    y[i] = points.at( i ).y();
+  }
+
+  transformInPlace( x, y );
+
+  QPolygonF ret( points.count() );
+  for ( int i = 0; i < points.count(); ++i )
+    ret[i] = QPointF( x.at( i ), y.at( i ) );
+
+  return ret;
+}
+
+bool ReosCoordinateTransform::transformInPlace( QVector<double> &x, QVector<double> &y ) const
+{
+  if ( !isValid() || x.count() != y.count() )
+    return false;
+
+  // all the points are transformed in one batch, the arrays are copied to keep the original points if the batch fails
+  QVector<double> z( x.count(), 0.0 );
+  QVector<double> xTransformed = x;
+  QVector<double> yTransformed = y;
+  try
+  {
+    mTransform->transformInPlace( xTransformed, yTransformed, z );
+  }
+  catch ( QgsCsException & )
+  {
+    // at least one point fails, transforms point by point
+    bool success = true;
+    for ( int i = 0; i < x.count(); ++i )
+    {
+      try
+      {
+        const QgsPointXY point = mTransform->transform( QgsPointXY( x.at( i ), y.at( i ) ) );
+        x[i] = point.x();
+        y[i] = point.y();
+      }
+      catch ( QgsCsException & )
+      {
+        success = false;
+      }
+    }
+    return success;
+  }
+
+  // points that can't be transformed by the batch have infinite coordinates
+  bool success = true;
+  for ( int i = 0; i < x.count(); ++i )
+  {
+    if ( std::isfinite( xTransformed.at( i ) ) && std::isfinite( yTransformed.at( i ) ) )
+    {
+      x[i] = xTransformed.at( i );
+      y[i] = yTransformed.at( i );
+    }
+    else
+    {
+      success = false;
+    }
+  }
+
+  return success;
+}
+
+void ReosCoordinateTransform::clearCache()
+{
+  QMutexLocker locker( cacheMutex() );
+  transformCache()->clear();
+}
@@ -0,0 +1,68 @@
+/***************************************************************************
+  reoscoordinatetransform.h - ReosCoordinateTransform
+
+ ---------------------
+ begin                : 26.5.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef REOSCOORDINATETRANSFORM_H
+#define REOSCOORDINATETRANSFORM_H
+
+#include <memory>
+
+#include <QString>
+#include <QPointF>
+#include <QPolygonF>
+#include <QVector>
+
+#include "reoscore.h"
+
+class QgsCoordinateTransform;
+
+/**
+ * Class that transforms coordinates from a source coordinates reference system to a destination one, both defined by WKT strings.
+ *
+ * The underlying transforms are cached by pair of coordinates reference systems and shared between all the instances,
+ * so creating an instance for a pair of coordinates reference systems already used does not set up the transformation again.
+ * The cache is cleared when the transform context of the project changes.
+ *
+ * Arrays of points are transformed in one call. If the transformation of a point fails, the point is unchanged.
+ * If one of the coordinates reference systems is not valid, the transform is not valid and the points are unchanged.
+ */
+class REOSCORE_EXPORT ReosCoordinateTransform
+{
+  public:
+    //! Constructor of an invalid transform
+    ReosCoordinateTransform() = default;
+
+    //! Constructor of a transform from \a sourceCrs to \a destinationCrs
+    ReosCoordinateTransform( const QString &sourceCrs, const QString &destinationCrs );
+
+    //! Returns whether the transform is valid
+    bool isValid() const;
+
+    //! Returns the transformed \a point
+    QPointF transform( const QPointF &point ) const;
+
+    //! Returns the transformed \a points
+    QPolygonF transform( const QPolygonF &points ) const;
+
+    //! Transforms the points with coordinates \a x and \a y, returns false if the transform is not valid or if at least one point fails
+    bool transformInPlace( QVector<double> &x, QVector<double> &y ) const;
+
+    //! Removes all the transforms from the cache
+    static void clearCache();
+
+  private:
+    std::shared_ptr<const QgsCoordinateTransform> mTransform;
+};
+
+#endif // REOSCOORDINATETRANSFORM_H
@@ -34,6 +34,13 @@ class REOSCORE_EXPORT ReosDigitalElevationModel
     //! Returns elevation value at \a point in DEM coordinate
     virtual double elevationAt( const QPointF &point, const QString &pointCrs = QString() ) const = 0;
 
+    /**
+     * Returns the elevations at \a points with coordinates in \a pointsCrs, bilinearly interpolated between the centers of pixels.
+     * All the points are treated in one pass, that is a lot faster than calling elevationAt() for each point.
+     * Returned values are NaN where the DEM has no value.
+     */
+    virtual QVector<double> elevationsAt( const QPolygonF &points, const QString &pointsCrs = QString(), ReosProcess *process = nullptr ) const = 0;
+
     /**
      *  Returns a profile corresponding on the elevation on the DEM, resolution depends on the DEM type
      *
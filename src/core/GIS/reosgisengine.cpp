@@ -17,6 +17,7 @@ email                : vcloarec at gmail dot com
 #include "reosdigitalelevationmodel.h"
 #include "reosdigitalelevationmodel_p.h"
 #include "reosmeshdataprovider_p.h"
+#include "reoscoordinatetransform.h"
 
 #include <QStandardPaths>
 #include <qmath.h>
@@ -70,6 +71,7 @@ ReosGisEngine::ReosGisEngine( QObject *parent ): ReosModule( parent )
   } );
 
   connect( QgsProject::instance(), &QgsProject::dirtySet, this, &ReosModule::dirtied );
+  connect( QgsProject::instance(), &QgsProject::transformContextChanged, this, [] {ReosCoordinateTransform::clearCache();} );
 }
 
 ReosGisEngine::~ReosGisEngine()
@@ -503,19 +505,7 @@ ReosMapExtent ReosGisEngine::transformFromProjectExtent( const ReosMapExtent &ex
 
 QPointF ReosGisEngine::transformToProjectCoordinates( const QString &sourceCRS, const QPointF &sourcePoint ) const
 {
-  QgsCoordinateTransform transform( QgsCoordinateReferenceSystem::fromWkt( sourceCRS ),
-                                    QgsProject::instance()->crs(),
-                                    QgsProject::instance()->transformContext() );
-
-  try
-  {
-    QgsPointXY transformPoint = transform.transform( QgsPointXY( sourcePoint ) );
-    return transformPoint.toQPointF();
-  }
-  catch ( ... )
-  {
-    return sourcePoint;
-  }
+  return ReosCoordinateTransform( sourceCRS, crs() ).transform( sourcePoint );
 }
 
 QPointF ReosGisEngine::transformToProjectCoordinates( const ReosSpatialPosition &position ) const
@@ -525,19 +515,7 @@ QPointF ReosGisEngine::transformToProjectCoordinates( const ReosSpatialPosition
 
 QPointF ReosGisEngine::transformToCoordinates( const ReosSpatialPosition &position, const QString &destinationCrs ) const
 {
-  QgsCoordinateTransform transform( QgsCoordinateReferenceSystem::fromWkt( position.crs() ),
-                                    QgsCoordinateReferenceSystem::fromWkt( destinationCrs ),
-                                    QgsProject::instance()->transformContext() );
-
-  try
-  {
-    QgsPointXY transformPoint = transform.transform( QgsPointXY( position.position() ) );
-    return transformPoint.toQPointF();
-  }
-  catch ( ... )
-  {
-    return position.position();
-  }
+  return ReosCoordinateTransform( position.crs(), destinationCrs ).transform( position.position() );
 }
 
 void ReosGisEngine::setTemporalRange( const QDateTime &startTime, const QDateTime &endTime )
@@ -65,6 +65,30 @@ class ReosMeshQualityChecker : public ReosProcess
 };
 
 
+/**
+ * Abstract class used to probe values of datasets on points of a mesh.
+ * The probe keeps its own spatial index of the faces, so the mesh is not walked for each query,
+ * and only the values of the vertices of the face containing the point are read from the dataset source.
+ * The probe is created from the current mesh frame and has to be recreated if the frame changes.
+ */
+class REOSCORE_EXPORT ReosMeshPointProbe
+{
+  public:
+    virtual ~ReosMeshPointProbe() {}
+
+    /**
+     * Returns the value at \a position of the dataset \a datasetIndex of the group \a groupIndex of \a datasetSource.
+     * For vector group, the magnitude is returned. Returns NaN if the point is not on an active face.
+     */
+    virtual double value( const ReosMeshDatasetSource *datasetSource, const ReosSpatialPosition &position, int groupIndex, int datasetIndex ) const = 0;
+
+    //! Returns the values at \a points with coordinates in \a crs, see value()
+    virtual QVector<double> values( const ReosMeshDatasetSource *datasetSource, const QPolygonF &points, const QString &crs, int groupIndex, int datasetIndex ) const = 0;
+
+    //! Returns the values at \a position for all the datasets of the group \a groupIndex, see value()
+    virtual QVector<double> timeSerie( const ReosMeshDatasetSource *datasetSource, const ReosSpatialPosition &position, int groupIndex ) const = 0;
+};
+
 class REOSCORE_EXPORT ReosMesh: public ReosRenderedObject
 {
     Q_OBJECT
@@ -133,6 +157,9 @@ class REOSCORE_EXPORT ReosMesh: public ReosRenderedObject
 
     virtual QPointF vertexPosition( int vertexIndex, const QString &destinationCrs = QString() ) = 0;
 
+    //! Returns the positions of all the vertices in \a destinationCrs, transformed in one batch, in the mesh crs if \a destinationCrs is empty
+    virtual QPolygonF vertexPositions( const QString &destinationCrs = QString() ) = 0;
+
     virtual QObject *data() const = 0;
 
     /**
@@ -196,6 +223,9 @@ class REOSCORE_EXPORT ReosMesh: public ReosRenderedObject
 
     virtual double interpolateDatasetValueOnPoint( const ReosMeshDatasetSource *datasetSource, const ReosSpatialPosition &position, int sourceGroupindex, int datasetIndex ) const = 0;
 
+    //! Returns a probe to obtain values of datasets on points of the current mesh frame, caller take ownership
+    virtual ReosMeshPointProbe *createPointProbe() const = 0;
+
     QualityMeshParameters qualityMeshParameters() const;
     void setQualityMeshParameter( const ReosEncodedElement &element );
 
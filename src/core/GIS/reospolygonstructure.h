@@ -61,6 +61,12 @@ class REOSCORE_EXPORT ReosPolygonStructure : public ReosGeometryStructure
 
     virtual ReosPolygonStructureValues *values( const QString &destinationCrs ) const = 0;
 
+    /**
+     * Returns the polygons of the class \a classId in \a destinationCrs. Each polygon is returned as its rings,
+     * the first one is the exterior ring and the following ones are the holes.
+     */
+    virtual QList<QList<QPolygonF>> polygons( const QString &classId, const QString &destinationCrs = QString() ) const = 0;
+
     QPolygonF searchPolygon( const ReosSpatialPosition &, bool  = true ) const override {return QPolygonF();}
 
   signals:
@@ -15,7 +15,10 @@
  ***************************************************************************/
 #include "reostimeserie.h"
 
+#include <algorithm>
+
 #include <QLocale>
+#include <QCryptographicHash>
 
 #include "reostimeserieprovider.h"
 
@@ -361,6 +364,8 @@ void ReosTimeSerieConstantInterval::appendValue( double value )
   if ( !dataValues || !dataValues->isEditable() )
     return;
 
+  const int previousCount = dataValues->valueCount();
+
   switch ( mValueMode )
   {
     case ReosTimeSerieConstantInterval::Value:
@@ -384,7 +389,7 @@ void ReosTimeSerieConstantInterval::appendValue( double value )
     break;
   }
 
-  emit dataChanged();
+  emitDataChangedFrom( previousCount );
 }
 
 void ReosTimeSerieConstantInterval::insertValues( int fromPos, int count, double value )
@@ -394,6 +399,8 @@ void ReosTimeSerieConstantInterval::insertValues( int fromPos, int count, double
   if ( !dataValues || !dataValues->isEditable() )
     return;
 
+  invalidateDerivedData( fromPos );
+
   switch ( mValueMode )
   {
     case ReosTimeSerieConstantInterval::Value:
@@ -432,13 +439,9 @@ double ReosTimeSerieConstantInterval::valueWithMode( int i, ReosTimeSerieConstan
       return mProvider->value( i ) / timeStep().valueUnit( mIntensityTimeUnit );
       break;
     case ReosTimeSerieConstantInterval::Cumulative:
-    {
-      double sum = 0;
-      for ( int v = 0; v < i; ++v )
-        sum += mProvider->value( v );
-      return sum;
-    }
-    break;
+      updateDerivedData();
+      return mCumulativeValues.at( i );
+      break;
   }
 
   return 0;
@@ -452,18 +455,55 @@ QPair<double, double> ReosTimeSerieConstantInterval::extentValueWithMode( ReosTi
   double min = 0;
   double max = 0;
 
-  for ( int i = 0; i < valueCount(); ++i )
+  const QPair<int, int> extent = extentIndexesWithMode( 0, mProvider->valueCount() - 1, mode );
+  if ( extent.first >= 0 )
   {
-    double v = valueWithMode( i, mode );
-    if ( v <= min )
-      min = v;
-    if ( v >= max )
-      max = v;
+    min = std::min( min, valueWithMode( extent.first, mode ) );
+    max = std::max( max, valueWithMode( extent.second, mode ) );
   }
 
   return QPair<double, double>( min, max );
 }
 
+QPair<int, int> ReosTimeSerieConstantInterval::extentIndexes( int from, int to ) const
+{
+  return extentIndexesWithMode( from, to, mValueMode );
+}
+
+QPair<int, int> ReosTimeSerieConstantInterval::extentIndexesWithMode( int from, int to, ReosTimeSerieConstantInterval::ValueMode mode ) const
+{
+  switch ( mode )
+  {
+    case ReosTimeSerieConstantInterval::Value:
+    case ReosTimeSerieConstantInterval::Intensity:
+      // intensity is proportional to the value, so extrema are at the same positions
+      return ReosTimeSerie::extentIndexes( from, to );
+      break;
+    case ReosTimeSerieConstantInterval::Cumulative:
+      updateDerivedData();
+      return mCumulativeLevelOfDetail.extentIndexes( mCumulativeValues.constData(), from, to );
+      break;
+  }
+
+  return {-1, -1};
+}
+
+void ReosTimeSerieConstantInterval::updateDerivedDataFrom( int validCount ) const
+{
+  ReosTimeSerie::updateDerivedDataFrom( validCount );
+
+  const QVector<double> &values = mProvider->constData();
+  const int count = values.count();
+
+  // sums before the first changed value do not change
+  mCumulativeValues.resize( count + 1 );
+  mCumulativeValues[0] = 0;
+  for ( int i = validCount; i < count; ++i )
+    mCumulativeValues[i + 1] = mCumulativeValues.at( i ) + values.at( i );
+
+  mCumulativeLevelOfDetail.update( mCumulativeValues.constData(), count + 1, validCount + 1 );
+}
+
 void ReosTimeSerie::setValueAt( int i, double value )
 {
   if ( !mProvider || !mProvider->isEditable() )
@@ -472,7 +512,7 @@ void ReosTimeSerie::setValueAt( int i, double value )
   if ( i < mProvider->valueCount() )
   {
     mProvider->setValue( i, value );
-    emit dataChanged();
+    emitDataChangedFrom( i );
   }
 }
 
@@ -629,6 +669,8 @@ void ReosTimeSerie::setValueUnit( const QString &valueUnit )
 double *ReosTimeSerie::data()
 {
   updateData();
+  // values can be modified through the pointer without any notification
+  invalidateDerivedData();
   return mProvider->data();
 }
 
@@ -638,6 +680,66 @@ const QVector<double> &ReosTimeSerie::constData() const
   return  mProvider->constData();
 }
 
+QByteArray ReosTimeSerie::contentHash() const
+{
+  const QVector<double> &values = constData();
+
+  QCryptographicHash hash( QCryptographicHash::Sha1 );
+  hash.addData( referenceTime().toString( Qt::ISODateWithMs ).toLatin1() );
+
+  QVector<qint64> times( values.count() );
+  for ( int i = 0; i < values.count(); ++i )
+    times[i] = relativeTimeAt( i ).valueMilliSecond();
+
+  hash.addData( reinterpret_cast<const char *>( times.constData() ), times.count() * static_cast<int>( sizeof( qint64 ) ) );
+  hash.addData( reinterpret_cast<const char *>( values.constData() ), values.count() * static_cast<int>( sizeof( double ) ) );
+
+  return hash.result();
+}
+
+QPair<int, int> ReosTimeSerie::extentIndexes( int from, int to ) const
+{
+  updateDerivedData();
+  return mLevelOfDetail.extentIndexes( mProvider->constData().constData(), from, to );
+}
+
+QVector<int> ReosTimeSerie::decimatedIndexes( int from, int to, int bucketCount ) const
+{
+  updateDerivedData();
+  return mLevelOfDetail.decimatedIndexes( mProvider->constData().constData(), from, to, bucketCount );
+}
+
+void ReosTimeSerie::updateDerivedData() const
+{
+  const int count = valueCount();
+  if ( mDerivedDataValidCount > count )
+    mDerivedDataValidCount = count;
+
+  if ( mDerivedDataValidCount == count && mLevelOfDetail.count() == count )
+    return;
+
+  updateDerivedDataFrom( mDerivedDataValidCount );
+  mDerivedDataValidCount = count;
+}
+
+void ReosTimeSerie::updateDerivedDataFrom( int validCount ) const
+{
+  const QVector<double> &values = mProvider->constData();
+  mLevelOfDetail.update( values.constData(), values.count(), validCount );
+}
+
+void ReosTimeSerie::invalidateDerivedData( int fromPos ) const
+{
+  mDerivedDataValidCount = std::max( 0, std::min( mDerivedDataValidCount, fromPos ) );
+}
+
+void ReosTimeSerie::emitDataChangedFrom( int fromPos )
+{
+  mChangedFromPosition = fromPos;
+  emit dataChanged();
+  mChangedFromPosition = 0;
+}
+
 ReosTimeSerieProvider *ReosTimeSerie::dataProvider() const
 {
   return mProvider.get();
@@ -706,6 +808,12 @@ ReosTimeSerie::ReosTimeSerie( QObject *parent, const QString &providerKey, const
   if ( !providerKey.isEmpty() )
     mProvider.reset( static_cast<ReosTimeSerieProvider *>( ReosDataProviderRegistery::instance()->createProvider( providerKey ) ) );
 
+  // data derived from the values are updated only from the first changed value, all of them if not known
+  connect( this, &ReosDataObject::dataChanged, this, [this]
+  {
+    invalidateDerivedData( mChangedFromPosition );
+  }, Qt::DirectConnection );
+
   if ( mProvider )
   {
     //mProvider->setReferenceTime( QDateTime( QDate( QDate::currentDate().year(), 1, 1 ), QTime( 0, 0, 0 ), Qt::UTC ) );
@@ -749,7 +857,7 @@ double ReosTimeSerie::valueAt( int i ) const
 void ReosTimeSerie::removeValues( int fromPos, int count )
 {
   mProvider->removeValues( fromPos, count );
-  emit dataChanged();
+  emitDataChangedFrom( fromPos );
 }
 
 void ReosTimeSerie::clear()
@@ -776,13 +884,11 @@ QPair<double, double> ReosTimeSerie::valueExent( bool withZero ) const
     max = -std::numeric_limits<double>::max();
   }
 
-  for ( int i = 0; i < valueCount(); ++i )
+  const QPair<int, int> extent = extentIndexes( 0, mProvider->valueCount() - 1 );
+  if ( extent.first >= 0 )
   {
-    double v = valueAt( i );
-    if ( v <= min )
-      min = v;
-    if ( v >= max )
-      max = v;
+    min = std::min( min, valueAt( extent.first ) );
+    max = std::max( max, valueAt( extent.second ) );
   }
 
   return QPair<double, double>( min, max );
@@ -981,24 +1087,110 @@ void ReosTimeSerieVariableTimeStep::setValue( const QDateTime &time, double valu
   setValue( relativeTime, value );
 }
 
-double ReosTimeSerieVariableTimeStep::valueAtTime( const ReosDuration &relativeTime ) const
+void ReosTimeSerieVariableTimeStep::setValues( const QVector<ReosDuration> &relativeTimes, const QVector<double> &values )
 {
   ReosTimeSerieVariableTimeStepProvider *dataProv = variableTimeStepdataProvider();
 
-  if ( !dataProv )
+  if ( !dataProv || !dataProv->isEditable() || relativeTimes.count() != values.count() )
+    return;
+
+  dataProv->setValues( relativeTimes, values );
+}
+
+void ReosTimeSerieVariableTimeStep::setValues( const QVector<qint64> &relativeTimes, const QVector<double> &values )
+{
+  ReosTimeSerieVariableTimeStepProvider *dataProv = variableTimeStepdataProvider();
+
+  if ( !dataProv || !dataProv->isEditable() || relativeTimes.count() != values.count() )
+    return;
+
+  dataProv->setValues( relativeTimes, values );
+}
+
+void ReosTimeSerieVariableTimeStep::reserve( int size )
+{
+  ReosTimeSerieVariableTimeStepProvider *dataProv = variableTimeStepdataProvider();
+
+  if ( !dataProv || !dataProv->isEditable() )
+    return;
+
+  dataProv->reserve( size );
+}
+
+void ReosTimeSerieVariableTimeStep::appendValues( const QVector<qint64> &relativeTimes, const QVector<double> &values )
+{
+  ReosTimeSerieVariableTimeStepProvider *dataProv = variableTimeStepdataProvider();
+
+  if ( !dataProv || !dataProv->isEditable() || relativeTimes.count() != values.count() || relativeTimes.isEmpty() )
+    return;
+
+  if ( dataProv->valueCount() > 0 && relativeTimes.first() <= dataProv->constTimeData().last() )
+  {
+    dataProv->mergeValues( relativeTimes, values );
+    return;
+  }
+
+  dataProv->appendValues( relativeTimes, values );
+}
+
+void ReosTimeSerieVariableTimeStep::mergeValues( const QVector<qint64> &relativeTimes, const QVector<double> &values )
+{
+  ReosTimeSerieVariableTimeStepProvider *dataProv = variableTimeStepdataProvider();
+
+  if ( !dataProv || !dataProv->isEditable() || relativeTimes.count() != values.count() )
+    return;
+
+  dataProv->mergeValues( relativeTimes, values );
+}
+
+double ReosTimeSerieVariableTimeStep::valueAtTime( const ReosDuration &relativeTime ) const
+{
+  if ( !variableTimeStepdataProvider() )
     return 0;
 
   bool exact = false;
   int index = timeValueIndex( relativeTime, exact );
 
-  if ( exact )
+  return interpolatedValue( index, relativeTime );
+}
+
+double ReosTimeSerieVariableTimeStep::valueAtTime( const ReosDuration &relativeTime, int &cursor ) const
+{
+  ReosTimeSerieVariableTimeStepProvider *dataProv = variableTimeStepdataProvider();
+
+  if ( !dataProv )
+    return 0;
+
+  const QVector<qint64> &times = dataProv->constTimeData();
+  const qint64 time = relativeTime.valueMilliSecond();
+
+  if ( cursor < 0 || cursor >= times.count() || times.at( cursor ) > time )
+  {
+    bool exact = false;
+    cursor = timeValueIndex( relativeTime, exact );
+  }
+  else
+  {
+    while ( cursor + 1 < times.count() && times.at( cursor + 1 ) <= time )
+      ++cursor;
+  }
+
+  return interpolatedValue( cursor, relativeTime );
+}
+
+double ReosTimeSerieVariableTimeStep::interpolatedValue( int index, const ReosDuration &relativeTime ) const
+{
+  ReosTimeSerieVariableTimeStepProvider *dataProv = variableTimeStepdataProvider();
+  const QVector<qint64> &times = dataProv->constTimeData();
+
+  if ( index >= 0 && index < times.count() && times.at( index ) == relativeTime.valueMilliSecond() )
     return dataProv->value( index );
 
   if ( index < 0 || index >= dataProv->valueCount() - 1 )
     return 0;
 
-  const ReosDuration time1 = dataProv->relativeTimeAt( index );
-  const ReosDuration time2 = dataProv->relativeTimeAt( index + 1 );
+  const ReosDuration time1( times.at( index ) );
+  const ReosDuration time2( times.at( index + 1 ) );
 
   double ratio = ( relativeTime - time1 ) / ( time2 - time1 );
 
@@ -1024,10 +1216,11 @@ void ReosTimeSerieVariableTimeStep::addOther( const ReosTimeSerieVariableTimeSte
 
   //need to store apart and then apply, if not changed value will disturb the addiion for following
   QVector<double> newValue_1( dataProv->valueCount() );
+  int otherCursor = -1;
   for ( int i = 0; i < dataProv->valueCount(); ++i )
   {
     ReosDuration thisTimeValue = dataProv->relativeTimeAt( i );
-    newValue_1[i] = mProvider->value( i ) + factor * other->valueAtTime( thisTimeValue - offset );
+    newValue_1[i] = mProvider->value( i ) + factor * other->valueAtTime( thisTimeValue - offset, otherCursor );
   }
 
   // now add time steps not existing in this instance,
@@ -1048,11 +1241,16 @@ void ReosTimeSerieVariableTimeStep::addOther( const ReosTimeSerieVariableTimeSte
   for ( int i = 0; i < dataProv->valueCount(); ++i )
     setValueAt( i, newValue_1.at( i ) );
 
-  const QList<ReosDuration> &keys = newValue_2.keys();
-  for ( const ReosDuration &key : keys )
+  QVector<qint64> newTimes;
+  QVector<double> newValues;
+  newTimes.reserve( newValue_2.count() );
+  newValues.reserve( newValue_2.count() );
+  for ( auto it = newValue_2.constBegin(); it != newValue_2.constEnd(); ++it )
   {
-    setValue( key, newValue_2.value( key ) );
+    newTimes.append( it.key().valueMilliSecond() );
+    newValues.append( it.value() );
   }
+  mergeValues( newTimes, newValues );
 
   blockSignals( false );
 
@@ -1067,45 +1265,14 @@ int ReosTimeSerieVariableTimeStep::timeValueIndex( const ReosDuration &time, boo
   if ( !dataProv )
     return 0;
 
-  if ( dataProv->valueCount() == 0 || time < dataProv->relativeTimeAt( 0 ) )
-  {
-    exact = false;
-    return -1;
-  }
-
-  if ( time > dataProv->lastRelativeTime() )
-  {
-    exact = false;
-    return dataProv->valueCount() - 1;
-  }
-
-  int i1 = 0;
-  int i2 = dataProv->valueCount() - 1;
-  while ( true )
-  {
-    if ( dataProv->relativeTimeAt( i1 ) == time )
-    {
-      exact = true;
-      return i1;
-    }
-    if ( dataProv->relativeTimeAt( i2 ) == time )
-    {
-      exact = true;
-      return i2;
-    }
+  const QVector<qint64> &times = dataProv->constTimeData();
+  const qint64 msecs = time.valueMilliSecond();
 
-    if ( i1 == i2 || i1 + 1 == i2 )
-    {
-      exact = false;
-      return i1;
-    }
+  // index of the last time value less or equal than time, -1 if before the first one
+  const int index = static_cast<int>( std::upper_bound( times.constBegin(), times.constEnd(), msecs ) - times.constBegin() ) - 1;
+  exact = index >= 0 && times.at( index ) == msecs;
 
-    int inter = ( i1 + i2 ) / 2;
-    if ( time < dataProv->relativeTimeAt( inter ) )
-      i2 = inter;
-    else
-      i1 = inter;
-  }
+  return index;
 }
 
 QString ReosTimeSerieVariableTimeStep::unitString() const
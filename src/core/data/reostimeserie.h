@@ -28,6 +28,7 @@
 #include "reosparameter.h"
 #include "reosdataobject.h"
 #include "reostimeserieprovider.h"
+#include "reostimeserielevelofdetail.h"
 
 //! Class that handle time serie data
 class REOSCORE_EXPORT ReosTimeSerie : public ReosDataObject
@@ -91,6 +92,21 @@ class REOSCORE_EXPORT ReosTimeSerie : public ReosDataObject
 
     const QVector<double> &constData() const;
 
+    //! Returns a hash of the reference time, the times and the values, that changes if any of them changes
+    QByteArray contentHash() const;
+
+    /**
+     * Returns the positions of the minimum and of the maximum of the values returned by valueAt() between position \a from and \a to included,
+     * -1 if there is no value. The positions are found in logarithmic time.
+     */
+    virtual QPair<int, int> extentIndexes( int from, int to ) const;
+
+    /**
+     * Returns increasing positions of values that represent the values between position \a from and \a to included, keeping the minimum
+     * and the maximum of each of the \a bucketCount parts of the range. Used to render large series with a cost related to the \a bucketCount.
+     */
+    QVector<int> decimatedIndexes( int from, int to, int bucketCount ) const;
+
     ReosTimeSerieProvider *dataProvider() const;
 
     static QString staticType() {return ReosDataObject::staticType() + ':' + QStringLiteral( "time-serie" );}
@@ -106,12 +122,28 @@ class REOSCORE_EXPORT ReosTimeSerie : public ReosDataObject
     virtual void baseEncode( ReosEncodedElement &element ) const;
     virtual bool decodeBase( const ReosEncodedElement &element );
 
+    //! Updates the data derived from the values if values have changed, has to be called before using derived data
+    void updateDerivedData() const;
+
+    //! Updates the derived data, the \a validCount first values have not changed since the last update
+    virtual void updateDerivedDataFrom( int validCount ) const;
+
+    //! Declares that values from position \a fromPos have changed or will be changed
+    void invalidateDerivedData( int fromPos = 0 ) const;
+
+    //! Emits dataChanged() declaring that only the values from position \a fromPos have changed
+    void emitDataChangedFrom( int fromPos );
+
     std::unique_ptr<ReosTimeSerieProvider> mProvider;
 
   private:
     ReosParameterDateTime *mReferenceTimeParameter = nullptr;
     QString mValueUnit;
 
+    mutable ReosTimeSerieLevelOfDetail mLevelOfDetail;
+    mutable int mDerivedDataValidCount = 0;
+    int mChangedFromPosition = 0;
+
     double mMaximum = -std::numeric_limits<double>::max();
     double mMinimum = std::numeric_limits<double>::max();
 
@@ -175,6 +207,11 @@ class REOSCORE_EXPORT ReosTimeSerieConstantInterval: public ReosTimeSerie
     //! Returns the value extent considering the \a mode
     QPair<double, double> extentValueWithMode( ValueMode mode = Value ) const;
 
+    QPair<int, int> extentIndexes( int from, int to ) const override;
+
+    //! Returns the positions of the minimum and of the maximum between position \a from and \a to included considering the \a mode
+    QPair<int, int> extentIndexesWithMode( int from, int to, ValueMode mode ) const;
+
     //! Returns the name of the data considering the \a mode
     QString valueModeName( ValueMode mode ) const;
 
@@ -220,10 +257,15 @@ class REOSCORE_EXPORT ReosTimeSerieConstantInterval: public ReosTimeSerie
   protected:
     void connectParameters();
     ReosTimeSerieConstantInterval( const ReosEncodedElement &element, QObject *parent = nullptr );
+    void updateDerivedDataFrom( int validCount ) const override;
 
   private:
     ReosParameterDuration *mTimeStepParameter = nullptr;
 
+    //! Sums of the values before each position, maintained incrementally with the values
+    mutable QVector<double> mCumulativeValues;
+    mutable ReosTimeSerieLevelOfDetail mCumulativeLevelOfDetail;
+
     //! Attribute that are defined during runtime
     ValueMode mValueMode = Value;
     ReosDuration::Unit mIntensityTimeUnit = ReosDuration::hour;
@@ -262,9 +304,41 @@ class REOSCORE_EXPORT ReosTimeSerieVariableTimeStep: public ReosTimeSerie
     //! Sets the value at \a time with \a value, if the \a relative time is not present insert a new couple (time, value)
     void setValue( const QDateTime &time, double value );
 
+    /**
+     * Replaces all the couples (time, value) of the serie by \a values associated with \a relativeTimes in one operation.
+     * Both arrays must have the same count and times must be increasing. Prefer this method to successive calls of setValue()
+     * when the whole serie is calculated.
+     */
+    void setValues( const QVector<ReosDuration> &relativeTimes, const QVector<double> &values );
+
+    //! Replaces all the couples (time, value) of the serie by \a values associated with \a relativeTimes in milliseconds, see setValues()
+    void setValues( const QVector<qint64> &relativeTimes, const QVector<double> &values );
+
+    //! Reserves memory for \a size couples (time, value), to use before successive appends
+    void reserve( int size );
+
+    /**
+     * Appends \a values associated with \a relativeTimes in milliseconds in one operation.
+     * Both arrays must have the same count and times must be increasing and after the last relative time of the serie.
+     */
+    void appendValues( const QVector<qint64> &relativeTimes, const QVector<double> &values );
+
+    /**
+     * Merges \a values associated with increasing \a relativeTimes in milliseconds in one pass. Values with a time already present
+     * replace the existing ones, others are inserted. Prefer this method to successive calls of setValue() with times not increasing.
+     */
+    void mergeValues( const QVector<qint64> &relativeTimes, const QVector<double> &values );
+
     //! Returns the value at relative time \a relative time, interpolate if relative time is between two time values, return 0 if before first one or after last one
     double valueAtTime( const ReosDuration &relativeTime ) const;
 
+    /**
+     * Returns the value at relative time \a relative time as valueAtTime(), using \a cursor as starting position of the search.
+     * \a cursor is updated with the position found, so successive calls with increasing times and the same cursor are done in constant time.
+     * The cursor has to be initialized with -1.
+     */
+    double valueAtTime( const ReosDuration &relativeTime, int &cursor ) const;
+
     //! Returns the value at time \a time, interpolate if time is between two time values, return 0 if before first one or after last one
     double valueAtTime( const QDateTime &time ) const;
 
@@ -320,6 +394,9 @@ class REOSCORE_EXPORT ReosTimeSerieVariableTimeStep: public ReosTimeSerie
      *  If \a time exactly corresponds to an existing index, return true in \a exact
      */
     int timeValueIndex( const ReosDuration &time, bool &exact ) const;
+
+    //! Returns the value at \a relativeTime knowing the \a index of the time value just before, as returned by timeValueIndex()
+    double interpolatedValue( int index, const ReosDuration &relativeTime ) const;
 };
 
 class REOSCORE_EXPORT ReosTimeSerieModel : public QAbstractTableModel
@@ -0,0 +1,185 @@
+/***************************************************************************
+  reostimeserielevelofdetail.cpp - ReosTimeSerieLevelOfDetail
+
+ ---------------------
+ begin                : 24.4.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "reostimeserielevelofdetail.h"
+
+#include <cmath>
+
+// Returns the index of the lowest value between index a and b, an index equal to -1 or pointing to NaN is ignored
+static int lowerIndex( const double *values, int a, int b )
+{
+  if ( a < 0 || std::isnan( values[a] ) )
+    return b < 0 ? a : b;
+  if ( b < 0 || std::isnan( values[b] ) )
+    return a;
+
+  return values[b] < values[a] ? b : a;
+}
+
+// Returns the index of the greatest value between index a and b, an index equal to -1 or pointing to NaN is ignored
+static int upperIndex( const double *values, int a, int b )
+{
+  if ( a < 0 || std::isnan( values[a] ) )
+    return b < 0 ? a : b;
+  if ( b < 0 || std::isnan( values[b] ) )
+    return a;
+
+  return values[b] > values[a] ? b : a;
+}
+
+void ReosTimeSerieLevelOfDetail::update( const double *values, int count, int validCount )
+{
+  mCount = count;
+  validCount = std::max( 0, std::min( validCount, count ) );
+
+  int level = 0;
+  int childCount = count;
+  int firstChangedChild = validCount;
+  while ( childCount > 1 )
+  {
+    const int blockCount = ( childCount + 1 ) / 2;
+    if ( mMinIndexes.count() <= level )
+    {
+      mMinIndexes.append( QVector<int>() );
+      mMaxIndexes.append( QVector<int>() );
+    }
+
+    QVector<int> &minIndexes = mMinIndexes[level];
+    QVector<int> &maxIndexes = mMaxIndexes[level];
+
+    // blocks before the one that contains the first changed child are still valid
+    const int firstBlock = std::min( firstChangedChild / 2, static_cast<int>( minIndexes.count() ) );
+    minIndexes.resize( blockCount );
+    maxIndexes.resize( blockCount );
+
+    for ( int b = firstBlock; b < blockCount; ++b )
+    {
+      const int child1 = 2 * b;
+      const int child2 = child1 + 1 < childCount ? child1 + 1 : -1;
+
+      if ( level == 0 )
+      {
+        minIndexes[b] = lowerIndex( values, child1, child2 );
+        maxIndexes[b] = upperIndex( values, child1, child2 );
+      }
+      else
+      {
+        const QVector<int> &childMinIndexes = mMinIndexes.at( level - 1 );
+        const QVector<int> &childMaxIndexes = mMaxIndexes.at( level - 1 );
+        minIndexes[b] = lowerIndex( values, childMinIndexes.at( child1 ), child2 < 0 ? -1 : childMinIndexes.at( child2 ) );
+        maxIndexes[b] = upperIndex( values, childMaxIndexes.at( child1 ), child2 < 0 ? -1 : childMaxIndexes.at( child2 ) );
+      }
+    }
+
+    firstChangedChild = firstBlock;
+    childCount = blockCount;
+    ++level;
+  }
+
+  mMinIndexes.resize( level );
+  mMaxIndexes.resize( level );
+}
+
+void ReosTimeSerieLevelOfDetail::clear()
+{
+  mMinIndexes.clear();
+  mMaxIndexes.clear();
+  mCount = 0;
+}
+
+int ReosTimeSerieLevelOfDetail::count() const
+{
+  return mCount;
+}
+
+QPair<int, int> ReosTimeSerieLevelOfDetail::extentIndexes( const double *values, int from, int to ) const
+{
+  from = std::max( from, 0 );
+  to = std::min( to, mCount - 1 );
+
+  int minIndex = -1;
+  int maxIndex = -1;
+  int i = from;
+  while ( i <= to )
+  {
+    // we take the greatest block that starts at i and that is contained in the range
+    int level = -1;
+    int blockSize = 1;
+    while ( level + 1 < mMinIndexes.count() && i % ( blockSize * 2 ) == 0 && i + blockSize * 2 - 1 <= to )
+    {
+      ++level;
+      blockSize *= 2;
+    }
+
+    if ( level < 0 )
+    {
+      minIndex = lowerIndex( values, minIndex, i );
+      maxIndex = upperIndex( values, maxIndex, i );
+    }
+    else
+    {
+      const int block = i / blockSize;
+      minIndex = lowerIndex( values, minIndex, mMinIndexes.at( level ).at( block ) );
+      maxIndex = upperIndex( values, maxIndex, mMaxIndexes.at( level ).at( block ) );
+    }
+
+    i += blockSize;
+  }
+
+  if ( minIndex < 0 || std::isnan( values[minIndex] ) )
+    return {-1, -1};
+
+  return {minIndex, maxIndex};
+}
+
+QVector<int> ReosTimeSerieLevelOfDetail::decimatedIndexes( const double *values, int from, int to, int bucketCount ) const
+{
+  from = std::max( from, 0 );
+  to = std::min( to, mCount - 1 );
+  bucketCount = std::max( bucketCount, 1 );
+
+  QVector<int> indexes;
+  if ( from > to )
+    return indexes;
+
+  const int rangeCount = to - from + 1;
+  if ( rangeCount <= 2 * bucketCount )
+  {
+    indexes.resize( rangeCount );
+    for ( int i = 0; i < rangeCount; ++i )
+      indexes[i] = from + i;
+    return indexes;
+  }
+
+  indexes.reserve( 2 * bucketCount + 2 );
+  auto append = [&indexes]( int index )
+  {
+    if ( index >= 0 && ( indexes.isEmpty() || indexes.last() < index ) )
+      indexes.append( index );
+  };
+
+  append( from );
+  for ( int b = 0; b < bucketCount; ++b )
+  {
+    const int bucketFrom = from + static_cast<int>( qint64( rangeCount ) * b / bucketCount );
+    const int bucketTo = from + static_cast<int>( qint64( rangeCount ) * ( b + 1 ) / bucketCount ) - 1;
+    const QPair<int, int> extent = extentIndexes( values, bucketFrom, bucketTo );
+    append( std::min( extent.first, extent.second ) );
+    append( std::max( extent.first, extent.second ) );
+  }
+  append( to );
+
+  return indexes;
+}
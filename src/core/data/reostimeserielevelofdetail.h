@@ -0,0 +1,67 @@
+/***************************************************************************
+  reostimeserielevelofdetail.h - ReosTimeSerieLevelOfDetail
+
+ ---------------------
+ begin                : 24.4.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef REOSTIMESERIELEVELOFDETAIL_H
+#define REOSTIMESERIELEVELOFDETAIL_H
+
+#include <QVector>
+#include <QPair>
+
+#include "reoscore.h"
+
+/**
+ * Class that stores a pyramid of the positions of the minimum and the maximum of an array of values.
+ *
+ * The level n of the pyramid contains, for each block of 2^(n+1) values, the index of the minimum and of the maximum.
+ * This allows to find the extent of any range of values in logarithmic time and to decimate the values for rendering,
+ * keeping the peaks. NaN values are ignored.
+ *
+ * The values are not stored in this class, they have to be given for each query and have to be the ones of the last update.
+ */
+class REOSCORE_EXPORT ReosTimeSerieLevelOfDetail
+{
+  public:
+    /**
+     * Updates the pyramid with the \a count \a values, the \a validCount first values are considered
+     * as not changed since the last update, so only the blocks containing the following values are updated.
+     */
+    void update( const double *values, int count, int validCount = 0 );
+
+    //! Clears the pyramid
+    void clear();
+
+    //! Returns the count of values used for the last update
+    int count() const;
+
+    /**
+     * Returns the indexes of the minimum and of the maximum of the \a values between \a from and \a to included,
+     * -1 if all values are NaN or if the range is empty
+     */
+    QPair<int, int> extentIndexes( const double *values, int from, int to ) const;
+
+    /**
+     * Returns increasing indexes of the \a values that represent the values between \a from and \a to included.
+     * The range is split in \a bucketCount parts, and for each part, the indexes of the minimum and of the maximum are kept,
+     * so the result contains around 2 * \a bucketCount indexes. If there are less values than that, all the indexes are returned.
+     */
+    QVector<int> decimatedIndexes( const double *values, int from, int to, int bucketCount ) const;
+
+  private:
+    QVector<QVector<int>> mMinIndexes;
+    QVector<QVector<int>> mMaxIndexes;
+    int mCount = 0;
+};
+
+#endif // REOSTIMESERIELEVELOFDETAIL_H
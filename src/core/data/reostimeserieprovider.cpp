@@ -201,10 +201,20 @@ void ReosTimeSerieVariableTimeStepProvider::prependValue( const ReosDuration &,
 
 void ReosTimeSerieVariableTimeStepProvider::insertValue( int, const ReosDuration &, double ) {}
 
+void ReosTimeSerieVariableTimeStepProvider::setValues( const QVector<ReosDuration> &, const QVector<double> & ) {}
+
+void ReosTimeSerieVariableTimeStepProvider::setValues( const QVector<qint64> &, const QVector<double> & ) {}
+
+void ReosTimeSerieVariableTimeStepProvider::reserve( int ) {}
+
+void ReosTimeSerieVariableTimeStepProvider::appendValues( const QVector<qint64> &, const QVector<double> & ) {}
+
+void ReosTimeSerieVariableTimeStepProvider::mergeValues( const QVector<qint64> &, const QVector<double> & ) {}
+
 void ReosTimeSerieVariableTimeStepProvider::copy( ReosTimeSerieVariableTimeStepProvider * ) {}
 
 
-ReosTimeSerieVariableTimeStepMemoryProvider::ReosTimeSerieVariableTimeStepMemoryProvider( const QVector<double> &values, const QVector<ReosDuration> &timeValues )
+ReosTimeSerieVariableTimeStepMemoryProvider::ReosTimeSerieVariableTimeStepMemoryProvider( const QVector<double> &values, const QVector<qint64> &timeValues )
   : mValues( values )
   , mTimeValues( timeValues )
 {}
@@ -245,17 +255,17 @@ void ReosTimeSerieVariableTimeStepMemoryProvider::setValue( int i, double v )
 
 ReosDuration ReosTimeSerieVariableTimeStepMemoryProvider::relativeTimeAt( int i ) const
 {
-  return mTimeValues.at( i );
+  return ReosDuration( mTimeValues.at( i ) );
 }
 
-ReosDuration ReosTimeSerieVariableTimeStepMemoryProvider::lastRelativeTime() const {return mTimeValues.last();}
+ReosDuration ReosTimeSerieVariableTimeStepMemoryProvider::lastRelativeTime() const {return ReosDuration( mTimeValues.last() );}
 
 void ReosTimeSerieVariableTimeStepMemoryProvider::setRelativeTimeAt( int i, const ReosDuration &relativeTime )
 {
-  mTimeValues[i] = relativeTime;
+  mTimeValues[i] = relativeTime.valueMilliSecond();
 }
 
-const QVector<ReosDuration> &ReosTimeSerieVariableTimeStepMemoryProvider::constTimeData() const
+const QVector<qint64> &ReosTimeSerieVariableTimeStepMemoryProvider::constTimeData() const
 {
   return mTimeValues;
 }
@@ -263,19 +273,98 @@ const QVector<ReosDuration> &ReosTimeSerieVariableTimeStepMemoryProvider::constT
 void ReosTimeSerieVariableTimeStepMemoryProvider::appendValue( const ReosDuration &relativeTime, double v )
 {
   mValues.append( v );
-  mTimeValues.append( relativeTime );
+  mTimeValues.append( relativeTime.valueMilliSecond() );
 }
 
 void ReosTimeSerieVariableTimeStepMemoryProvider::prependValue( const ReosDuration &relativeTime, double v )
 {
   mValues.prepend( v );
-  mTimeValues.prepend( relativeTime );
+  mTimeValues.prepend( relativeTime.valueMilliSecond() );
 }
 
 void ReosTimeSerieVariableTimeStepMemoryProvider::insertValue( int fromPos, const ReosDuration &relativeTime, double v )
 {
   mValues.insert( fromPos, v );
-  mTimeValues.insert( fromPos, relativeTime );
+  mTimeValues.insert( fromPos, relativeTime.valueMilliSecond() );
+}
+
+void ReosTimeSerieVariableTimeStepMemoryProvider::setValues( const QVector<ReosDuration> &relativeTimes, const QVector<double> &values )
+{
+  Q_ASSERT( relativeTimes.count() == values.count() );
+  mTimeValues.resize( relativeTimes.count() );
+  for ( int i = 0; i < relativeTimes.count(); ++i )
+    mTimeValues[i] = relativeTimes.at( i ).valueMilliSecond();
+  mValues = values;
+
+  emit dataChanged();
+}
+
+void ReosTimeSerieVariableTimeStepMemoryProvider::setValues( const QVector<qint64> &relativeTimes, const QVector<double> &values )
+{
+  Q_ASSERT( relativeTimes.count() == values.count() );
+  mTimeValues = relativeTimes;
+  mValues = values;
+
+  emit dataChanged();
+}
+
+void ReosTimeSerieVariableTimeStepMemoryProvider::reserve( int size )
+{
+  mTimeValues.reserve( size );
+  mValues.reserve( size );
+}
+
+void ReosTimeSerieVariableTimeStepMemoryProvider::appendValues( const QVector<qint64> &relativeTimes, const QVector<double> &values )
+{
+  Q_ASSERT( relativeTimes.count() == values.count() );
+  Q_ASSERT( relativeTimes.isEmpty() || mTimeValues.isEmpty() || relativeTimes.first() > mTimeValues.last() );
+  mTimeValues.append( relativeTimes );
+  mValues.append( values );
+
+  emit dataChanged();
+}
+
+void ReosTimeSerieVariableTimeStepMemoryProvider::mergeValues( const QVector<qint64> &relativeTimes, const QVector<double> &values )
+{
+  Q_ASSERT( relativeTimes.count() == values.count() );
+  if ( relativeTimes.isEmpty() )
+    return;
+
+  if ( mTimeValues.isEmpty() || relativeTimes.first() > mTimeValues.last() )
+  {
+    appendValues( relativeTimes, values );
+    return;
+  }
+
+  QVector<qint64> mergedTimes;
+  QVector<double> mergedValues;
+  mergedTimes.reserve( mTimeValues.count() + relativeTimes.count() );
+  mergedValues.reserve( mTimeValues.count() + relativeTimes.count() );
+
+  int i = 0;
+  int j = 0;
+  while ( i < mTimeValues.count() || j < relativeTimes.count() )
+  {
+    if ( j == relativeTimes.count() || ( i < mTimeValues.count() && mTimeValues.at( i ) < relativeTimes.at( j ) ) )
+    {
+      mergedTimes.append( mTimeValues.at( i ) );
+      mergedValues.append( mValues.at( i ) );
+      ++i;
+    }
+    else
+    {
+      if ( i < mTimeValues.count() && mTimeValues.at( i ) == relativeTimes.at( j ) )
+        ++i;
+      mergedTimes.append( relativeTimes.at( j ) );
+      mergedValues.append( values.at( j ) );
+      ++j;
+    }
+  }
+
+  mTimeValues = mergedTimes;
+  mValues = mergedValues;
+
+  emit dataChanged();
 }
 
 void ReosTimeSerieVariableTimeStepMemoryProvider::removeValues( int fromPos, int count )
@@ -310,8 +399,8 @@ ReosEncodedElement ReosTimeSerieVariableTimeStepMemoryProvider::encode() const
   QList<ReosEncodedElement> encodedTimeValues;
   encodedTimeValues.reserve( mTimeValues.count() );
 
-  for ( const ReosDuration &time : mTimeValues )
-    encodedTimeValues.append( time.encode() );
+  for ( qint64 time : mTimeValues )
+    encodedTimeValues.append( ReosDuration( time ).encode() );
 
   element.addListEncodedData( QStringLiteral( "timeValues" ), encodedTimeValues );
 
@@ -332,5 +421,5 @@ void ReosTimeSerieVariableTimeStepMemoryProvider::decode( const ReosEncodedEleme
   mTimeValues.clear();
   mTimeValues.reserve( encodedTimeValues.size() );
   for ( const ReosEncodedElement &elem : std::as_const( encodedTimeValues ) )
-    mTimeValues.append( ReosDuration::decode( elem ) );
+    mTimeValues.append( ReosDuration::decode( elem ).valueMilliSecond() );
 }
@@ -96,13 +96,36 @@ class REOSCORE_EXPORT ReosTimeSerieVariableTimeStepProvider : public ReosTimeSer
 
     virtual ReosDuration relativeTimeAt( int i ) const  = 0;
     virtual ReosDuration lastRelativeTime() const = 0;
-    virtual const QVector<ReosDuration> &constTimeData() const = 0;
+
+    //! Returns the relative times of all the values in milliseconds
+    virtual const QVector<qint64> &constTimeData() const = 0;
 
     virtual void setRelativeTimeAt( int i, const ReosDuration &relativeTime );;
     virtual void appendValue( const ReosDuration &relativeTime, double v );;
     virtual void prependValue( const ReosDuration &relativeTime, double v );;
     virtual void insertValue( int fromPos, const ReosDuration &relativeTime, double v );;
 
+    //! Replaces all the values by \a values associated with \a relativeTimes, both must have the same count and times must be increasing
+    virtual void setValues( const QVector<ReosDuration> &relativeTimes, const QVector<double> &values );
+
+    //! Replaces all the values by \a values associated with \a relativeTimes in milliseconds, both must have the same count and times must be increasing
+    virtual void setValues( const QVector<qint64> &relativeTimes, const QVector<double> &values );
+
+    //! Reserves memory for \a size values
+    virtual void reserve( int size );
+
+    /**
+     * Appends \a values associated with \a relativeTimes in milliseconds, both must have the same count,
+     * times must be increasing and greater than the last relative time
+     */
+    virtual void appendValues( const QVector<qint64> &relativeTimes, const QVector<double> &values );
+
+    /**
+     * Merges \a values associated with increasing \a relativeTimes in milliseconds with the existing values in one pass.
+     * Values with a time already present replace the existing ones, others are inserted.
+     */
+    virtual void mergeValues( const QVector<qint64> &relativeTimes, const QVector<double> &values );
+
     virtual void copy( ReosTimeSerieVariableTimeStepProvider *other );
 };
 
@@ -159,7 +182,7 @@ class ReosTimeSerieVariableTimeStepMemoryProvider : public ReosTimeSerieVariable
 {
   public:
     ReosTimeSerieVariableTimeStepMemoryProvider() = default;
-    ReosTimeSerieVariableTimeStepMemoryProvider( const QVector<double> &values, const QVector<ReosDuration> &timeValues );
+    ReosTimeSerieVariableTimeStepMemoryProvider( const QVector<double> &values, const QVector<qint64> &timeValues );
 
     QString key() const override;
 
@@ -174,10 +197,15 @@ class ReosTimeSerieVariableTimeStepMemoryProvider : public ReosTimeSerieVariable
     ReosDuration relativeTimeAt( int i ) const override;
     ReosDuration lastRelativeTime() const override;
     void setRelativeTimeAt( int i, const ReosDuration &relativeTime ) override;
-    const QVector<ReosDuration> &constTimeData() const override;
+    const QVector<qint64> &constTimeData() const override;
     void appendValue( const ReosDuration &relativeTime, double v ) override;
     void prependValue( const ReosDuration &relativeTime, double v ) override;
     void insertValue( int fromPos, const ReosDuration &relativeTime, double v ) override;
+    void setValues( const QVector<ReosDuration> &relativeTimes, const QVector<double> &values ) override;
+    void setValues( const QVector<qint64> &relativeTimes, const QVector<double> &values ) override;
+    void reserve( int size ) override;
+    void appendValues( const QVector<qint64> &relativeTimes, const QVector<double> &values ) override;
+    void mergeValues( const QVector<qint64> &relativeTimes, const QVector<double> &values ) override;
     bool isEditable() const override {return true;}
     double *data() override {return mValues.data();}
     const QVector<double> &constData() const override {return mValues;}
@@ -191,7 +219,7 @@ class ReosTimeSerieVariableTimeStepMemoryProvider : public ReosTimeSerieVariable
   private:
     QDateTime mReferenceTime;
     QVector<double> mValues;
-    QVector<ReosDuration> mTimeValues;
+    QVector<qint64> mTimeValues; //! relative times in milliseconds
 
 };
 
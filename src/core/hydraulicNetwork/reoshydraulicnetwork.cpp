@@ -20,8 +20,10 @@
 #include "reoshydrographrouting.h"
 #include "reoshydraulicstructureboundarycondition.h"
 #include "reoshydraulicscheme.h"
+#include "reoshydraulicnetworkscheduler.h"
 #include "reosgisengine.h"
 #include <QUuid>
+#include <QSignalBlocker>
 
 ReosHydraulicNetworkElement::ReosHydraulicNetworkElement( ReosHydraulicNetwork *parent ):
   ReosDataObject( parent )
@@ -139,6 +141,7 @@ ReosHydraulicNetwork::ReosHydraulicNetwork( ReosModule *parent, ReosGisEngine *g
   , mGisEngine( gisEngine )
   , mWatershedModule( watershedModule )
   , mHydraulicSchemeCollection( new ReosHydraulicSchemeCollection( this ) )
+  , mResultCache( new ReosHydrographResultCache )
 {
   ReosHydrographRoutingMethodFactories::instantiate( this );
   ReosGmshEngine::instantiate( this );
@@ -161,6 +164,8 @@ ReosHydraulicNetwork::ReosHydraulicNetwork( ReosModule *parent, ReosGisEngine *g
   connect( mHydraulicSchemeCollection, &ReosHydraulicSchemeCollection::dirtied, this, &ReosModule::dirtied );
 }
 
+ReosHydraulicNetwork::~ReosHydraulicNetwork() = default;
+
 QList<ReosHydraulicNetworkElement *> ReosHydraulicNetwork::getElements( const QString &type ) const
 {
   QList<ReosHydraulicNetworkElement *> elems;
@@ -319,6 +324,7 @@ void ReosHydraulicNetwork::clear()
   mHydraulicSchemeCollection->clear();
   mElementIndexesCounter.clear();
   mCurrentSchemeIndex = -1;
+  mResultCache->clear();
   emit hasBeenReset();
 }
 
@@ -334,6 +340,7 @@ void ReosHydraulicNetwork::reset()
 
   mElementIndexesCounter.clear();
   mCurrentSchemeIndex = -1;
+  mResultCache->clear();
   emit hasBeenReset();
 }
 
@@ -419,6 +426,43 @@ void ReosHydraulicNetwork::setCurrentScheme( int newSchemeIndex )
   emit dirtied();
 }
 
+bool ReosHydraulicNetwork::calculateScheme( int schemeIndex )
+{
+  if ( !mHydraulicSchemeCollection->scheme( schemeIndex ) )
+    return false;
+
+  // the elements do not launch their own calculation while the scheme is switched and the results applied,
+  // and schemeChanged() is emitted only once the results are applied, so the network is calculated only once
+  mCalculationIsSuspended = true;
+  {
+    QSignalBlocker blocker( this );
+    changeScheme( schemeIndex );
+  }
+
+  ReosHydraulicNetworkScheduler scheduler( mElements.values(), calculationContext(), mResultCache.get() );
+  scheduler.start();
+  const bool success = scheduler.isSuccessful();
+  if ( success )
+    scheduler.applyResults();
+
+  mCalculationIsSuspended = false;
+
+  emit schemeChanged();
+  emit dirtied();
+
+  return success;
+}
+
+bool ReosHydraulicNetwork::calculationIsSuspended() const
+{
+  return mCalculationIsSuspended;
+}
+
+ReosHydrographResultCache *ReosHydraulicNetwork::resultCache() const
+{
+  return mResultCache.get();
+}
+
 void ReosHydraulicNetwork::addEncodedElement( const ReosEncodedElement &element )
 {
   auto it = mElementFactories.find( element.description() );
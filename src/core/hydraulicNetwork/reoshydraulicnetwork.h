@@ -34,6 +34,7 @@ class ReosWatershedModule;
 class ReosGisEngine;
 class ReosHydraulicSchemeCollection;
 class ReosHydraulicScheme;
+class ReosHydrographResultCache;
 
 class REOSCORE_EXPORT ReosHydraulicNetworkElement : public ReosDataObject
 {
@@ -148,6 +149,7 @@ class REOSCORE_EXPORT ReosHydraulicNetwork : public ReosModule
     Q_OBJECT
   public:
     ReosHydraulicNetwork( ReosModule *parent, ReosGisEngine *gisEngine, ReosWatershedModule *watershedModule );
+    ~ReosHydraulicNetwork();
     QList<ReosHydraulicNetworkElement *> getElements( const QString &type ) const;
     ReosHydraulicNetworkElement *getElement( const QString &elemId ) const;
 
@@ -176,6 +178,28 @@ class REOSCORE_EXPORT ReosHydraulicNetwork : public ReosModule
 
     void setCurrentScheme( int newSchemeIndex );
 
+    /**
+     * Changes the current scheme to \a schemeIndex and calculates all the hydrographs of the network for this scheme,
+     * without waiting for the event loop. Returns false if the calculation failed.
+     *
+     * Calculated hydrographs are kept in a cache with a key depending on the data they are calculated from,
+     * so only the elements affected by changes since a previous calculation are calculated again, whatever the scheme.
+     */
+    bool calculateScheme( int schemeIndex );
+
+    /**
+     * Returns whether the calculation triggered by the signals of the elements is suspended,
+     * that is the case while calculateScheme() is switching the scheme and applying the results.
+     */
+    bool calculationIsSuspended() const;
+
+    /**
+     * Returns the cache of the hydrographs calculated by calculateScheme() or by the elements when their calculation context is updated.
+     * The elements look for their output in this cache before calculating it, so switching to a scheme already calculated or changing
+     * an element leads to calculate only the hydrographs that depend on changed data.
+     */
+    ReosHydrographResultCache *resultCache() const;
+
   signals:
     void elementAdded( ReosHydraulicNetworkElement *elem, bool select );
     void elementRemoved( ReosHydraulicNetworkElement *elem );
@@ -200,6 +224,9 @@ class REOSCORE_EXPORT ReosHydraulicNetwork : public ReosModule
 
     QHash<QString, int> mElementIndexesCounter;
 
+    std::unique_ptr<ReosHydrographResultCache> mResultCache;
+    bool mCalculationIsSuspended = false;
+
     friend class ReosHydraulicNetworkElement;
 
     std::map<QString, std::unique_ptr<ReosHydraulicNetworkElementFactory>> mElementFactories;
@@ -0,0 +1,513 @@
+/***************************************************************************
+  reoshydraulicnetworkscheduler.cpp - ReosHydraulicNetworkScheduler
+
+ ---------------------
+ begin                : 22.4.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "reoshydraulicnetworkscheduler.h"
+
+#include <functional>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QCryptographicHash>
+
+#include "reoshydraulicnetwork.h"
+#include "reoshydrographsource.h"
+#include "reoshydrographrouting.h"
+#include "reoshydrograph.h"
+
+//! Runnable that calls a function, used to push the tasks in the thread pool
+class ReosSchedulerRunnable : public QRunnable
+{
+  public:
+    explicit ReosSchedulerRunnable( const std::function<void()> &function )
+      : mFunction( function )
+    {}
+
+    void run() override
+    {
+      mFunction();
+    }
+
+  private:
+    std::function<void()> mFunction;
+};
+
+ReosHydrographResultCache::ReosHydrographResultCache( int maximumValueCount )
+  : mCache( maximumValueCount )
+{}
+
+bool ReosHydrographResultCache::restore( const QByteArray &key, ReosHydrograph *hydrograph ) const
+{
+  QMutexLocker locker( &mMutex );
+  const Entry *entry = mCache.object( key );
+  if ( !entry || !hydrograph )
+    return false;
+
+  hydrograph->setReferenceTime( entry->referenceTime );
+  hydrograph->setValues( entry->times, entry->values );
+  return true;
+}
+
+bool ReosHydrographResultCache::contains( const QByteArray &key ) const
+{
+  QMutexLocker locker( &mMutex );
+  return mCache.contains( key );
+}
+
+void ReosHydrographResultCache::store( const QByteArray &key, ReosHydrograph *hydrograph )
+{
+  if ( !hydrograph || key.isEmpty() )
+    return;
+
+  std::unique_ptr<Entry> entry = std::make_unique<Entry>();
+  entry->referenceTime = hydrograph->referenceTime();
+  entry->values = hydrograph->constData();
+  entry->times.resize( entry->values.count() );
+  for ( int i = 0; i < entry->values.count(); ++i )
+    entry->times[i] = hydrograph->relativeTimeAt( i );
+
+  // an empty hydrograph has also a cost, to limit the count of entries
+  const int cost = std::max( 1, entry->values.count() );
+
+  QMutexLocker locker( &mMutex );
+  mCache.insert( key, entry.release(), cost );
+}
+
+int ReosHydrographResultCache::count() const
+{
+  QMutexLocker locker( &mMutex );
+  return mCache.count();
+}
+
+void ReosHydrographResultCache::clear()
+{
+  QMutexLocker locker( &mMutex );
+  mCache.clear();
+}
+
+QByteArray ReosHydrographResultCache::productKey( const QByteArray &prefix, const QList<QByteArray> &upstreamKeys )
+{
+  if ( prefix.isEmpty() )
+    return QByteArray();
+
+  QCryptographicHash hash( QCryptographicHash::Sha1 );
+  hash.addData( prefix );
+  for ( const QByteArray &key : upstreamKeys )
+  {
+    if ( key.isEmpty() )
+      return QByteArray();
+    hash.addData( key );
+  }
+
+  return hash.result();
+}
+
+QByteArray ReosHydrographResultCache::routingPrefix( ReosHydrographRoutingMethod *method )
+{
+  if ( !method )
+    return QByteArray();
+
+  return QByteArrayLiteral( "routing:" ) + method->encode().bytes();
+}
+
+QByteArray ReosHydrographResultCache::junctionPrefix( const QByteArray &internalKey, bool forceOutputTimeStep, const ReosDuration &outputTimeStep )
+{
+  if ( internalKey.isEmpty() )
+    return QByteArray();
+
+  QByteArray prefix = QByteArrayLiteral( "junction:" ) + internalKey;
+  if ( forceOutputTimeStep )
+    prefix.append( QByteArray::number( outputTimeStep.valueMilliSecond() ) );
+
+  return prefix;
+}
+
+QByteArray ReosHydrographResultCache::sourceKey( ReosHydrograph *hydrograph )
+{
+  if ( !hydrograph )
+    return QByteArrayLiteral( "source:empty" );
+
+  return QByteArrayLiteral( "source:" ) + hydrograph->contentHash();
+}
+
+ReosHydraulicNetworkScheduler::ReosHydraulicNetworkScheduler( const QList<ReosHydraulicNetworkElement *> &elements,
+    const ReosCalculationContext &context,
+    ReosHydrographResultCache *cache )
+  : mContext( context )
+  , mCache( cache )
+{
+  for ( ReosHydraulicNetworkElement *element : elements )
+    addElement( element );
+
+  sortTasks();
+  setMaxProgression( static_cast<int>( mTasks.size() ) );
+  setCurrentProgression( 0 );
+}
+
+ReosHydraulicNetworkScheduler::~ReosHydraulicNetworkScheduler() = default;
+
+int ReosHydraulicNetworkScheduler::addElement( ReosHydraulicNetworkElement *element )
+{
+  if ( !element )
+    return -1;
+
+  auto it = mElementIdToTask.constFind( element->id() );
+  if ( it != mElementIdToTask.constEnd() )
+    return it.value();
+
+  ReosHydrographRoutingLink *routing = qobject_cast<ReosHydrographRoutingLink *>( element );
+  ReosHydrographSource *source = qobject_cast<ReosHydrographSource *>( element );
+
+  // other elements (hydraulic structures...) are not part of the hydrograph calculation graph
+  if ( !routing && !source )
+    return -1;
+
+  const int taskIndex = static_cast<int>( mTasks.size() );
+  mTasks.emplace_back( std::make_unique<Task>() );
+  Task *task = mTasks.back().get();
+  task->element = element;
+  task->elementId = element->id();
+  mElementIdToTask.insert( task->elementId, taskIndex );
+
+  if ( routing )
+  {
+    task->type = TaskType::Routing;
+    task->routingMethod = routing->currentRoutingMethod();
+    const int upstreamTask = addElement( routing->inputHydrographSource() );
+    if ( upstreamTask >= 0 )
+      task->upstreamTasks.append( upstreamTask );
+
+    task->key = upstreamKey( ReosHydrographResultCache::routingPrefix( task->routingMethod ), task );
+  }
+
+  ReosHydrographJunction *junction = qobject_cast<ReosHydrographJunction *>( source );
+  if ( junction && junction->outputIsCalculatedFromUpstream() )
+  {
+    task->type = TaskType::Junction;
+    task->forceOutputTimeStep = junction->useForceOutputTimeStep()->value();
+    task->outputTimeStep = junction->forceOutputTimeStep()->value();
+    task->internalKey = junction->internalHydrographHash( mContext );
+
+    const QList<ReosHydrographRoutingLink *> upstreamLinks = ReosHydraulicNetworkUtils::upstreamLinkOfType<ReosHydrographRoutingLink>( junction );
+    for ( ReosHydrographRoutingLink *link : upstreamLinks )
+    {
+      const int upstreamTask = addElement( link );
+      if ( upstreamTask >= 0 )
+        task->upstreamTasks.append( upstreamTask );
+    }
+
+    task->key = upstreamKey( ReosHydrographResultCache::junctionPrefix( task->internalKey, task->forceOutputTimeStep, task->outputTimeStep ), task );
+  }
+  else if ( source )
+  {
+    // the output hydrograph is used as it is
+    task->type = TaskType::Source;
+    if ( source->outputHydrograph() )
+    {
+      task->inputHydrograph = std::make_unique<ReosHydrograph>();
+      task->inputHydrograph->copyFrom( source->outputHydrograph() );
+    }
+    task->key = ReosHydrographResultCache::sourceKey( task->inputHydrograph.get() );
+    return taskIndex;
+  }
+
+  // the output is restored from the cache if present, else what is needed to calculate it is prepared
+  if ( mCache && !task->key.isEmpty() )
+  {
+    std::unique_ptr<ReosHydrograph> cachedHydrograph = std::make_unique<ReosHydrograph>();
+    if ( mCache->restore( task->key, cachedHydrograph.get() ) )
+    {
+      task->inputHydrograph = std::move( cachedHydrograph );
+      task->outputIsInCache = true;
+      ++mRestoredFromCacheCount;
+      return taskIndex;
+    }
+  }
+
+  if ( task->type == TaskType::Junction )
+  {
+    std::unique_ptr<ReosHydrograph> internalHydrograph = std::make_unique<ReosHydrograph>();
+    if ( mCache && !task->internalKey.isEmpty() && mCache->restore( task->internalKey, internalHydrograph.get() ) )
+    {
+      task->inputHydrograph = std::move( internalHydrograph );
+    }
+    else
+    {
+      task->internalCalculation.reset( junction->createInternalHydrographCalculation( mContext ) );
+      if ( !task->internalCalculation && junction->internalHydrograph() )
+      {
+        task->inputHydrograph = std::move( internalHydrograph );
+        task->inputHydrograph->copyFrom( junction->internalHydrograph() );
+      }
+    }
+  }
+
+  return taskIndex;
+}
+
+QByteArray ReosHydraulicNetworkScheduler::upstreamKey( const QByteArray &prefix, const Task *task ) const
+{
+  // the key of an upstream task is empty if it can't be identified or if it is not yet prepared because of a loop
+  QList<QByteArray> upstreamKeys;
+  for ( int upstream : task->upstreamTasks )
+    upstreamKeys.append( mTasks.at( upstream )->key );
+
+  return ReosHydrographResultCache::productKey( prefix, upstreamKeys );
+}
+
+void ReosHydraulicNetworkScheduler::sortTasks()
+{
+  const int taskCount = static_cast<int>( mTasks.size() );
+  QVector<int> inDegree( taskCount, 0 );
+  for ( int i = 0; i < taskCount; ++i )
+  {
+    Task *task = mTasks.at( i ).get();
+    inDegree[i] = task->upstreamTasks.count();
+    for ( int upstream : std::as_const( task->upstreamTasks ) )
+      mTasks.at( upstream )->downstreamTasks.append( i );
+  }
+
+  mOrder.clear();
+  mOrder.reserve( taskCount );
+  for ( int i = 0; i < taskCount; ++i )
+    if ( inDegree.at( i ) == 0 )
+      mOrder.append( i );
+
+  // mOrder is used as the queue of Kahn's algorithm
+  for ( int pos = 0; pos < mOrder.count(); ++pos )
+  {
+    for ( int downstream : std::as_const( mTasks.at( mOrder.at( pos ) )->downstreamTasks ) )
+    {
+      if ( --inDegree[downstream] == 0 )
+        mOrder.append( downstream );
+    }
+  }
+
+  mHasCycle = mOrder.count() != taskCount;
+}
+
+void ReosHydraulicNetworkScheduler::start()
+{
+  mIsSuccessful = false;
+  if ( mHasCycle )
+    return;
+
+  mCalculatedCount.storeRelease( 0 );
+  mFailedCount.storeRelease( 0 );
+  setCurrentProgression( 0 );
+
+  for ( const std::unique_ptr<Task> &task : mTasks )
+  {
+    task->remainingUpstreamCount.storeRelease( task->upstreamTasks.count() );
+    task->result.reset();
+    task->isSuccessful = false;
+  }
+
+  // a dedicated pool is used to not wait for tasks queued behind this process in the global pool
+  QThreadPool pool;
+  pool.setMaxThreadCount( static_cast<int>( maximumThreads() ) );
+
+  for ( int i = 0; i < static_cast<int>( mTasks.size() ); ++i )
+  {
+    if ( mTasks.at( i )->upstreamTasks.isEmpty() )
+      pool.start( new ReosSchedulerRunnable( [this, i, &pool] {runTask( i, &pool );} ) );
+  }
+
+  // tasks are pushed in the pool by their last upstream task before it ends, so the pool is never empty until all is done
+  pool.waitForDone();
+
+  mIsSuccessful = !isStop() && mFailedCount.loadAcquire() == 0;
+}
+
+void ReosHydraulicNetworkScheduler::runTask( int taskIndex, QThreadPool *pool )
+{
+  Task *task = mTasks.at( taskIndex ).get();
+
+  if ( !isStop() )
+    calculateTask( task );
+
+  // downstream tasks always need an input hydrograph
+  if ( !task->result )
+    task->result = std::make_unique<ReosHydrograph>();
+
+  if ( !task->isSuccessful )
+    mFailedCount.fetchAndAddOrdered( 1 );
+
+  setCurrentProgression( mCalculatedCount.fetchAndAddOrdered( 1 ) + 1 );
+
+  for ( int downstream : std::as_const( task->downstreamTasks ) )
+  {
+    if ( mTasks.at( downstream )->remainingUpstreamCount.fetchAndAddOrdered( -1 ) == 1 )
+      pool->start( new ReosSchedulerRunnable( [this, downstream, pool] {runTask( downstream, pool );} ) );
+  }
+}
+
+void ReosHydraulicNetworkScheduler::calculateTask( Task *task )
+{
+  if ( task->outputIsInCache )
+  {
+    task->result = std::make_unique<ReosHydrograph>();
+    task->result->copyFrom( task->inputHydrograph.get() );
+    task->isSuccessful = true;
+    return;
+  }
+
+  switch ( task->type )
+  {
+    case TaskType::Source:
+    {
+      task->result = std::make_unique<ReosHydrograph>();
+      if ( task->inputHydrograph )
+        task->result->copyFrom( task->inputHydrograph.get() );
+      task->isSuccessful = true;
+    }
+    break;
+    case TaskType::Routing:
+    {
+      ReosHydrograph *input = nullptr;
+      if ( !task->upstreamTasks.isEmpty() )
+        input = mTasks.at( task->upstreamTasks.first() )->result.get();
+
+      if ( !input )
+      {
+        // nothing to route
+        task->isSuccessful = true;
+        break;
+      }
+
+      if ( !task->routingMethod )
+        break;
+
+      std::unique_ptr<ReosHydrographCalculation> calculation( task->routingMethod->calculationProcess( input, mContext ) );
+      if ( !calculation )
+        break;
+
+      calculation->start();
+      if ( calculation->isSuccessful() )
+      {
+        task->result.reset( calculation->getHydrograph() );
+        task->isSuccessful = true;
+        if ( mCache )
+          mCache->store( task->key, task->result.get() );
+      }
+    }
+    break;
+    case TaskType::Junction:
+    {
+      ReosHydrographJunction::HydrographSumCalculation sum;
+      bool internalIsCalculated = true;
+
+      if ( task->internalCalculation )
+      {
+        task->internalCalculation->start();
+        internalIsCalculated = task->internalCalculation->isSuccessful();
+        if ( internalIsCalculated )
+        {
+          sum.addHydrograph( task->internalCalculation->hydrograph() );
+          if ( mCache )
+            mCache->store( task->internalKey, task->internalCalculation->hydrograph() );
+        }
+      }
+      else if ( task->inputHydrograph )
+      {
+        sum.addHydrograph( task->inputHydrograph.get() );
+      }
+
+      for ( int upstream : std::as_const( task->upstreamTasks ) )
+        sum.addHydrograph( mTasks.at( upstream )->result.get() );
+
+      if ( task->forceOutputTimeStep )
+        sum.forceOutputTimeStep( task->outputTimeStep );
+
+      sum.start();
+      if ( sum.isSuccessful() )
+      {
+        task->result.reset( sum.getHydrograph() );
+        task->isSuccessful = internalIsCalculated;
+        if ( mCache && task->isSuccessful )
+          mCache->store( task->key, task->result.get() );
+      }
+    }
+    break;
+  }
+}
+
+int ReosHydraulicNetworkScheduler::restoredFromCacheCount() const
+{
+  return mRestoredFromCacheCount;
+}
+
+bool ReosHydraulicNetworkScheduler::hasCycle() const
+{
+  return mHasCycle;
+}
+
+QStringList ReosHydraulicNetworkScheduler::calculationOrder() const
+{
+  QStringList ret;
+  for ( int taskIndex : std::as_const( mOrder ) )
+    ret.append( mTasks.at( taskIndex )->elementId );
+
+  return ret;
+}
+
+ReosHydrograph *ReosHydraulicNetworkScheduler::outputHydrograph( const QString &elementId ) const
+{
+  auto it = mElementIdToTask.constFind( elementId );
+  if ( it == mElementIdToTask.constEnd() )
+    return nullptr;
+
+  return mTasks.at( it.value() )->result.get();
+}
+
+void ReosHydraulicNetworkScheduler::applyResults()
+{
+  for ( int taskIndex : std::as_const( mOrder ) )
+  {
+    Task *task = mTasks.at( taskIndex ).get();
+    if ( task->element.isNull() || !task->result || !task->isSuccessful )
+      continue;
+
+    switch ( task->type )
+    {
+      case TaskType::Source:
+        break;
+      case TaskType::Junction:
+      {
+        // the internal hydrograph is also applied, else the junction would calculate it again when asked for
+        ReosHydrograph *internalHydrograph = nullptr;
+        std::unique_ptr<ReosHydrograph> cachedInternalHydrograph;
+        if ( task->internalCalculation && task->internalCalculation->isSuccessful() )
+        {
+          internalHydrograph = task->internalCalculation->hydrograph();
+        }
+        else if ( task->outputIsInCache )
+        {
+          cachedInternalHydrograph = std::make_unique<ReosHydrograph>();
+          if ( mCache && !task->internalKey.isEmpty() && mCache->restore( task->internalKey, cachedInternalHydrograph.get() ) )
+            internalHydrograph = cachedInternalHydrograph.get();
+        }
+        else
+        {
+          internalHydrograph = task->inputHydrograph.get();
+        }
+
+        qobject_cast<ReosHydrographJunction *>( task->element )->setCalculatedOutputHydrograph( task->result.get(), task->key, internalHydrograph, mContext );
+      }
+      break;
+      case TaskType::Routing:
+        qobject_cast<ReosHydrographRoutingLink *>( task->element )->setCalculatedOutputHydrograph( task->result.get(), task->key );
+        break;
+    }
+  }
+}
@@ -0,0 +1,196 @@
+/***************************************************************************
+  reoshydraulicnetworkscheduler.h - ReosHydraulicNetworkScheduler
+
+ ---------------------
+ begin                : 22.4.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef REOSHYDRAULICNETWORKSCHEDULER_H
+#define REOSHYDRAULICNETWORKSCHEDULER_H
+
+#include <memory>
+#include <vector>
+
+#include <QPointer>
+#include <QHash>
+#include <QAtomicInt>
+#include <QCache>
+#include <QMutex>
+#include <QDateTime>
+
+#include "reoscore.h"
+#include "reosprocess.h"
+#include "reoscalculationcontext.h"
+#include "reosduration.h"
+
+class QThreadPool;
+class ReosHydraulicNetworkElement;
+class ReosHydrograph;
+class ReosHydrographCalculation;
+class ReosHydrographRoutingMethod;
+
+/**
+ * Class that stores calculated hydrographs with a key that identifies the data they are calculated from.
+ *
+ * As the key depends only on the content of the data, a hydrograph can be reused as long as the key is the same,
+ * whatever the scheme or the element it has been calculated for. Hydrographs are stored in a LRU cache limited
+ * by the count of values. Hydrographs can be stored and restored from several threads.
+ */
+class REOSCORE_EXPORT ReosHydrographResultCache
+{
+  public:
+    //! Constructor, hydrographs are kept until \a maximumValueCount values are stored
+    explicit ReosHydrographResultCache( int maximumValueCount = defaultMaximumValueCount() );
+
+    //! Copies in \a hydrograph the hydrograph stored with \a key, returns false if there is no hydrograph for this key
+    bool restore( const QByteArray &key, ReosHydrograph *hydrograph ) const;
+
+    //! Returns whether a hydrograph is stored with \a key
+    bool contains( const QByteArray &key ) const;
+
+    //! Stores a copy of \a hydrograph with \a key
+    void store( const QByteArray &key, ReosHydrograph *hydrograph );
+
+    //! Returns the count of stored hydrographs
+    int count() const;
+
+    //! Removes all the stored hydrographs
+    void clear();
+
+    static int defaultMaximumValueCount() {return 4000000;}
+
+    /**
+     * Returns the key of a product calculated with the data identified by \a prefix from the upstream products with \a upstreamKeys.
+     * Returns an empty array if one of the upstream keys is empty, that is if one of the upstream products can't be identified.
+     */
+    static QByteArray productKey( const QByteArray &prefix, const QList<QByteArray> &upstreamKeys );
+
+    //! Returns the prefix of the key of a hydrograph routed with \a method
+    static QByteArray routingPrefix( ReosHydrographRoutingMethod *method );
+
+    //! Returns the prefix of the key of the sum of a junction with the internal hydrograph identified by \a internalKey
+    static QByteArray junctionPrefix( const QByteArray &internalKey, bool forceOutputTimeStep, const ReosDuration &outputTimeStep );
+
+    //! Returns the key of a hydrograph that is used as it is, identified by its content
+    static QByteArray sourceKey( ReosHydrograph *hydrograph );
+
+  private:
+    struct Entry
+    {
+      QDateTime referenceTime;
+      QVector<ReosDuration> times;
+      QVector<double> values;
+    };
+
+    mutable QMutex mMutex;
+    mutable QCache<QByteArray, Entry> mCache;
+};
+
+/**
+ * Process that calculates all the hydrographs of a part of a hydraulic network without going through the signals of the elements.
+ *
+ * When constructed, the calculation graph is built from the hydrograph sources, the junctions and the routing links,
+ * completed with all the elements upstream, and ordered topologically. Everything that needs the elements (internal hydrographs,
+ * rainfalls and runoff models, parameters) is read at this time, so the constructor and applyResults() have to be called from the thread
+ * of the elements. The runoff of the watersheds is calculated with their hydrograph when the elements are calculated.
+ *
+ * When started, each element is calculated as soon as all its upstream elements are calculated, on a pool of threads,
+ * so independent branches of the network are calculated at the same time. The progression is the count of calculated elements.
+ *
+ * If a result cache is used, each product (internal hydrograph, routed hydrograph and sum of junctions) has a key that is
+ * a hash of the data it is calculated from and of the keys of its upstream products. Products already in the cache are not calculated.
+ */
+class REOSCORE_EXPORT ReosHydraulicNetworkScheduler : public ReosProcess
+{
+    Q_OBJECT
+  public:
+    /**
+     * Constructor with the \a elements to calculate for the \a context.
+     * If \a cache is not nullptr, products are restored from or stored in the \a cache, that has to live longer than this process.
+     */
+    ReosHydraulicNetworkScheduler( const QList<ReosHydraulicNetworkElement *> &elements,
+                                   const ReosCalculationContext &context,
+                                   ReosHydrographResultCache *cache = nullptr );
+    ~ReosHydraulicNetworkScheduler();
+
+    void start() override;
+
+    //! Returns whether the elements contain a loop, if so, nothing can be calculated
+    bool hasCycle() const;
+
+    //! Returns the ids of the elements in the calculation order, each element being after all its upstream elements
+    QStringList calculationOrder() const;
+
+    //! Returns the hydrograph calculated for the element with \a elementId, nullptr if this element has not been calculated
+    ReosHydrograph *outputHydrograph( const QString &elementId ) const;
+
+    //! Returns the count of elements that have been restored from the cache instead of being calculated
+    int restoredFromCacheCount() const;
+
+    /**
+     * Copies the calculated hydrographs in the output hydrographs of the junctions and routing links,
+     * has to be called once the process is finished.
+     */
+    void applyResults();
+
+  private:
+    enum class TaskType
+    {
+      Source,
+      Junction,
+      Routing
+    };
+
+    struct Task
+    {
+      QPointer<ReosHydraulicNetworkElement> element;
+      QString elementId;
+      TaskType type = TaskType::Source;
+
+      QVector<int> upstreamTasks;
+      QVector<int> downstreamTasks;
+      QAtomicInt remainingUpstreamCount;
+
+      // data read from the element before the calculation
+      std::unique_ptr<ReosHydrograph> inputHydrograph;
+      std::unique_ptr<ReosHydrographCalculation> internalCalculation;
+      ReosHydrographRoutingMethod *routingMethod = nullptr;
+      bool forceOutputTimeStep = false;
+      ReosDuration outputTimeStep;
+
+      // keys of the output and of the internal hydrograph in the cache, empty if the product can't be identified
+      QByteArray key;
+      QByteArray internalKey;
+      bool outputIsInCache = false;
+
+      std::unique_ptr<ReosHydrograph> result;
+      bool isSuccessful = false;
+    };
+
+    ReosCalculationContext mContext;
+    ReosHydrographResultCache *mCache = nullptr;
+    std::vector<std::unique_ptr<Task>> mTasks;
+    QHash<QString, int> mElementIdToTask;
+    QVector<int> mOrder;
+    bool mHasCycle = false;
+    QAtomicInt mCalculatedCount;
+    QAtomicInt mFailedCount;
+
+    int mRestoredFromCacheCount = 0;
+
+    int addElement( ReosHydraulicNetworkElement *element );
+    QByteArray upstreamKey( const QByteArray &prefix, const Task *task ) const;
+    void sortTasks();
+    void runTask( int taskIndex, QThreadPool *pool );
+    void calculateTask( Task *task );
+};
+
+#endif // REOSHYDRAULICNETWORKSCHEDULER_H
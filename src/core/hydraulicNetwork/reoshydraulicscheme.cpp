@@ -149,13 +149,20 @@ ReosHydraulicSchemeCollection::ReosHydraulicSchemeCollection( QObject *parent )
 }
 
 
+ReosHydraulicSchemeCollection::~ReosHydraulicSchemeCollection() = default;
+
 ReosEncodedElement ReosHydraulicSchemeCollection::encode() const
 {
   ReosEncodedElement element( QStringLiteral( "hydraulic-scheme-collection" ) );
   QList<ReosEncodedElement> encodedList;
 
-  for ( ReosHydraulicScheme *scheme : mHydraulicSchemes )
-    encodedList.append( scheme->encode() );
+  for ( int i = 0; i < mHydraulicSchemes.count(); ++i )
+  {
+    if ( mHydraulicSchemes.at( i ) )
+      encodedList.append( mHydraulicSchemes.at( i )->encode() );
+    else
+      encodedList.append( mEncodedSchemes.at( i ) );
+  }
 
   element.addListEncodedData( QStringLiteral( "schemes" ), encodedList );
   return element;
@@ -166,16 +173,20 @@ void ReosHydraulicSchemeCollection::decode( const ReosEncodedElement &encodedEle
   if ( encodedElement.description() != QStringLiteral( "hydraulic-scheme-collection" ) )
     return;
 
+  mContext = std::make_unique<ReosHydraulicNetworkContext>( context );
+
   const QList<ReosEncodedElement> encodedList = encodedElement.getListEncodedData( QStringLiteral( "schemes" ) );
 
+  // schemes are decoded when accessed for the first time, see scheme(), only the names are decoded now
   for ( const ReosEncodedElement &elem : encodedList )
   {
-    ReosHydraulicScheme *scheme = ReosHydraulicScheme::decode( elem, this, context );
-    if ( scheme )
-    {
-      mHydraulicSchemes.append( scheme );
-      connect( scheme, &ReosHydraulicScheme::dirtied, this, &ReosHydraulicSchemeCollection::dirtied );
-    }
+    if ( elem.description() != QStringLiteral( "hydraulic-scheme" ) )
+      continue;
+
+    std::unique_ptr<ReosParameterString> name( ReosParameterString::decode( elem.getEncodedData( QStringLiteral( "name" ) ), false, QString(), nullptr ) );
+    mHydraulicSchemes.append( nullptr );
+    mEncodedSchemes.append( elem );
+    mSchemeNames.append( name ? name->value() : QString() );
   }
 }
 
@@ -205,7 +216,12 @@ QVariant ReosHydraulicSchemeCollection::data( const QModelIndex &index, int role
     return QVariant();
 
   if ( role == Qt::DisplayRole && index.row() < mHydraulicSchemes.count() )
-    return mHydraulicSchemes.at( index.row() )->schemeName()->value();
+  {
+    if ( mHydraulicSchemes.at( index.row() ) )
+      return mHydraulicSchemes.at( index.row() )->schemeName()->value();
+    else
+      return mSchemeNames.at( index.row() );
+  }
 
   return QVariant();
 }
@@ -215,6 +231,8 @@ void ReosHydraulicSchemeCollection::addScheme( ReosHydraulicScheme *scheme )
   beginResetModel();
   scheme->setParent( this );
   mHydraulicSchemes.append( scheme );
+  mEncodedSchemes.append( ReosEncodedElement() );
+  mSchemeNames.append( QString() );
   endResetModel();
 
   connect( scheme, &ReosHydraulicScheme::dirtied, this, &ReosHydraulicSchemeCollection::dirtied );
@@ -225,8 +243,11 @@ void ReosHydraulicSchemeCollection::addScheme( ReosHydraulicScheme *scheme )
 void ReosHydraulicSchemeCollection::removeScheme( int index )
 {
   beginResetModel();
-  mHydraulicSchemes.at( index )->deleteLater();
+  if ( mHydraulicSchemes.at( index ) )
+    mHydraulicSchemes.at( index )->deleteLater();
   mHydraulicSchemes.removeAt( index );
+  mEncodedSchemes.removeAt( index );
+  mSchemeNames.removeAt( index );
   endResetModel();
 
   emit dirtied();
@@ -235,10 +256,10 @@ void ReosHydraulicSchemeCollection::removeScheme( int index )
 void ReosHydraulicSchemeCollection::reset( ReosMeteorologicModel *meteoModel )
 {
   beginResetModel();
-  for ( ReosHydraulicScheme *scheme : std::as_const( mHydraulicSchemes ) )
-    scheme->deleteLater();
-  mHydraulicSchemes.clear();
+  clearSchemes();
   mHydraulicSchemes.append( new ReosHydraulicScheme( this ) );
+  mEncodedSchemes.append( ReosEncodedElement() );
+  mSchemeNames.append( QString() );
   mHydraulicSchemes.last()->setMeteoModel( meteoModel );
   mHydraulicSchemes.last()->schemeName()->setValue( tr( "Hydraulic scheme" ) );
   endResetModel();
@@ -247,9 +268,7 @@ void ReosHydraulicSchemeCollection::reset( ReosMeteorologicModel *meteoModel )
 void ReosHydraulicSchemeCollection::clear()
 {
   beginResetModel();
-  for ( ReosHydraulicScheme *scheme : std::as_const( mHydraulicSchemes ) )
-    scheme->deleteLater();
-  mHydraulicSchemes.clear();
+  clearSchemes();
   endResetModel();
 }
 
@@ -263,6 +282,26 @@ ReosHydraulicScheme *ReosHydraulicSchemeCollection::scheme( int index )
   if ( index < 0 || index >= mHydraulicSchemes.count() )
     return nullptr;
 
+  if ( !mHydraulicSchemes.at( index ) && mContext )
+  {
+    ReosHydraulicScheme *scheme = ReosHydraulicScheme::decode( mEncodedSchemes.at( index ), this, *mContext );
+    connect( scheme, &ReosHydraulicScheme::dirtied, this, &ReosHydraulicSchemeCollection::dirtied );
+    mHydraulicSchemes[index] = scheme;
+    mEncodedSchemes[index] = ReosEncodedElement();
+    mSchemeNames[index].clear();
+  }
+
   return mHydraulicSchemes.at( index );
 }
 
+void ReosHydraulicSchemeCollection::clearSchemes()
+{
+  for ( ReosHydraulicScheme *scheme : std::as_const( mHydraulicSchemes ) )
+  {
+    if ( scheme )
+      scheme->deleteLater();
+  }
+  mHydraulicSchemes.clear();
+  mEncodedSchemes.clear();
+  mSchemeNames.clear();
+}
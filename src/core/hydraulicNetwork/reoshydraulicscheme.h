@@ -18,6 +18,7 @@
 
 #include <QAbstractListModel>
 #include <QPointer>
+#include <memory>
 
 #include "reosdataobject.h"
 #include "reosparameter.h"
@@ -85,6 +86,7 @@ class REOSCORE_EXPORT ReosHydraulicSchemeCollection : public QAbstractListModel
     Q_OBJECT
   public:
     ReosHydraulicSchemeCollection( QObject *parent = nullptr );
+    ~ReosHydraulicSchemeCollection();
 
     QModelIndex index( int row, int column, const QModelIndex &parent ) const;
     QModelIndex parent( const QModelIndex &child ) const;
@@ -103,6 +105,7 @@ class REOSCORE_EXPORT ReosHydraulicSchemeCollection : public QAbstractListModel
 
     int schemeCount() const;
 
+    //! Returns the scheme at \a index, decodes it if it is accessed for the first time since the collection has been decoded
     ReosHydraulicScheme *scheme( int index );
 
     ReosEncodedElement encode() const;
@@ -112,7 +115,15 @@ class REOSCORE_EXPORT ReosHydraulicSchemeCollection : public QAbstractListModel
     void dirtied();
 
   private:
+    //! Schemes of the collection, nullptr for the schemes not decoded yet
     QList<ReosHydraulicScheme *> mHydraulicSchemes;
+
+    //! Encoded schemes not decoded yet and their names, empty for the decoded schemes
+    QList<ReosEncodedElement> mEncodedSchemes;
+    QStringList mSchemeNames;
+    std::unique_ptr<ReosHydraulicNetworkContext> mContext;
+
+    void clearSchemes();
 };
 
 
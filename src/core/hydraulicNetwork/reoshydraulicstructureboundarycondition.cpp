@@ -197,6 +197,12 @@ QString ReosHydraulicStructureBoundaryCondition::outputPrefixName() const
   return QString();
 }
 
+bool ReosHydraulicStructureBoundaryCondition::outputIsCalculatedFromUpstream() const
+{
+  // with output level, the output hydrograph comes from the results of the hydraulic structure
+  return conditionType() != Type::OutputLevel;
+}
+
 QString ReosHydraulicStructureBoundaryCondition::boundaryConditionId() const
 {
   return mBoundaryConditionId;
@@ -165,7 +165,13 @@ void ReosSimulationPreparationProcess::start()
   emit sendInformation( tr( "Get boundary counditions", nullptr, mWaitedBoundaryId.count() ) );
 
   if ( mStructure.isNull() || mSimulation.isNull() || mStructure->mesh()->faceCount() == 0 )
+  {
+    ReosModule::Message message;
+    message.type = ReosModule::Error;
+    message.text = tr( "The simulation can't be prepared without mesh." );
+    notify( message );
     return;
+  }
 
   QList<ReosHydraulicStructureBoundaryCondition *> boundaries = mStructure->boundaryConditions();
   mBoundaryCount = boundaries.count();
@@ -207,12 +213,20 @@ void ReosSimulationPreparationProcess::start()
   eventLoop->deleteLater();
 
   if ( mDestinationPath.isEmpty() )
-    mSimulation->prepareInput( mStructure, mContext );
+    mIsSuccessful = mSimulation->prepareInput( mStructure, mContext );
   else
   {
     const QDir dir( mDestinationPath );
     if ( dir.exists() )
-      mSimulation->prepareInput( mStructure, mContext, dir );
+      mIsSuccessful = mSimulation->prepareInput( mStructure, mContext, dir );
+  }
+
+  if ( !mIsSuccessful )
+  {
+    ReosModule::Message message;
+    message.type = ReosModule::Error;
+    message.text = tr( "Unable to write the input files of the simulation." );
+    notify( message );
   }
 
 }
@@ -231,6 +245,7 @@ void ReosSimulationPreparationProcess::onBoundaryUpdated( const QString &id )
 }
 
 ReosSimulationProcess::ReosSimulationProcess( const ReosCalculationContext &context, const QList<ReosHydraulicStructureBoundaryCondition *> boundaries )
+  : mSimulationStartTime( context.simulationStartTime() )
 {
   for ( ReosHydraulicStructureBoundaryCondition *bc : boundaries )
   {
@@ -251,6 +266,7 @@ ReosSimulationProcess::ReosSimulationProcess( const ReosCalculationContext &cont
   }
 
   connect( this, &ReosSimulationProcess::sendBoundaryFlow, this, &ReosSimulationProcess::onReceiveFlow );
+  connect( this, &ReosSimulationProcess::sendBoundaryFlows, this, &ReosSimulationProcess::onReceiveFlows );
 }
 
 void ReosSimulationProcess::onReceiveFlow( const QDateTime &time, const QStringList &boundaryIds, const QList<double> &values )
@@ -258,13 +274,35 @@ void ReosSimulationProcess::onReceiveFlow( const QDateTime &time, const QStringL
   for ( int i = 0; i < boundaryIds.count(); ++i )
   {
     const QString &bId = boundaryIds.at( i );
-    qDebug() << bId << mOutputHydrographs.keys();
     ReosHydrograph *hyd = mOutputHydrographs.value( bId );
     if ( hyd )
       hyd->setValue( time, values.at( i ) );
   }
 }
 
+void ReosSimulationProcess::onReceiveFlows( const QStringList &boundaryIds, const QList<QVector<qint64>> &relativeTimes, const QList<QVector<double>> &values )
+{
+  for ( int i = 0; i < boundaryIds.count() && i < relativeTimes.count() && i < values.count(); ++i )
+  {
+    ReosHydrograph *hyd = mOutputHydrographs.value( boundaryIds.at( i ) );
+    if ( !hyd )
+      continue;
+
+    const qint64 shift = hyd->referenceTime().msecsTo( mSimulationStartTime );
+    if ( shift == 0 )
+    {
+      hyd->mergeValues( relativeTimes.at( i ), values.at( i ) );
+    }
+    else
+    {
+      QVector<qint64> times = relativeTimes.at( i );
+      for ( qint64 &time : times )
+        time += shift;
+      hyd->mergeValues( times, values.at( i ) );
+    }
+  }
+}
+
 QMap<QString, ReosHydrograph *> ReosSimulationProcess::outputHydrographs() const
 {
   return mOutputHydrographs;
@@ -79,11 +79,20 @@ class REOSCORE_EXPORT ReosSimulationProcess : public ReosProcess
   signals:
     void sendBoundaryFlow( const QDateTime &time, const QStringList &boundaryIds, const QList<double> &values ) const;
 
+    /**
+     * Sends flows at several times for the boundaries with \a boundaryIds. For each boundary, \a relativeTimes contains increasing times
+     * in milliseconds from the simulation start time and \a values contains the corresponding flows.
+     * Prefer this signal to sendBoundaryFlow() when the engine produces many time steps.
+     */
+    void sendBoundaryFlows( const QStringList &boundaryIds, const QList<QVector<qint64>> &relativeTimes, const QList<QVector<double>> &values ) const;
+
   private slots:
     void onReceiveFlow( const QDateTime &time, const QStringList &boundaryIds, const QList<double> &values );
+    void onReceiveFlows( const QStringList &boundaryIds, const QList<QVector<qint64>> &relativeTimes, const QList<QVector<double>> &values );
 
   private:
     QMap<QString, ReosHydrograph *> mOutputHydrographs;
+    QDateTime mSimulationStartTime;
 
 };
 
@@ -95,9 +104,11 @@ class REOSCORE_EXPORT ReosHydraulicSimulation : public ReosDataObject
 
     virtual QString directoryName() const = 0;
 
-    virtual void prepareInput( ReosHydraulicStructure2D *hydraulicStructure, const ReosCalculationContext &calculationContext ) = 0;
+    //! Writes the input files of the simulation in the simulation directory, returns false if an input file can't be written
+    virtual bool prepareInput( ReosHydraulicStructure2D *hydraulicStructure, const ReosCalculationContext &calculationContext ) = 0;
 
-    virtual void prepareInput( ReosHydraulicStructure2D *hydraulicStructure, const ReosCalculationContext &calculationContext, const QDir &directory ) = 0;
+    //! Writes the input files of the simulation in \a directory, returns false if an input file can't be written
+    virtual bool prepareInput( ReosHydraulicStructure2D *hydraulicStructure, const ReosCalculationContext &calculationContext, const QDir &directory ) = 0;
 
     virtual ReosSimulationProcess *getProcess( ReosHydraulicStructure2D *hydraulicStructure, const ReosCalculationContext &calculationContext ) const = 0;
 
@@ -56,7 +56,24 @@ QString ReosHydraulicSimulationResults::groupName( int groupIndex ) const
     case ReosHydraulicSimulationResults::DatasetType::Velocity:
       return tr( "Velocity" );
       break;
+    case ReosHydraulicSimulationResults::DatasetType::MaximumWaterDepth:
+      return tr( "Maximum water depth" );
+      break;
+    case ReosHydraulicSimulationResults::DatasetType::MaximumVelocity:
+      return tr( "Maximum velocity" );
+      break;
+    case ReosHydraulicSimulationResults::DatasetType::MaximumHazard:
+      return tr( "Maximum hazard" );
+      break;
+    case ReosHydraulicSimulationResults::DatasetType::TimeOfArrival:
+      return tr( "Time of arrival" );
+      break;
+    case ReosHydraulicSimulationResults::DatasetType::InundationDuration:
+      return tr( "Inundation duration" );
+      break;
   }
+
+  return QString();
 }
 
 bool ReosHydraulicSimulationResults::groupIsScalar( int groupIndex ) const
@@ -77,6 +94,13 @@ bool ReosHydraulicSimulationResults::groupIsScalar( int groupIndex ) const
     case ReosHydraulicSimulationResults::DatasetType::Velocity:
       return false;
       break;
+    case ReosHydraulicSimulationResults::DatasetType::MaximumWaterDepth:
+    case ReosHydraulicSimulationResults::DatasetType::MaximumVelocity:
+    case ReosHydraulicSimulationResults::DatasetType::MaximumHazard:
+    case ReosHydraulicSimulationResults::DatasetType::TimeOfArrival:
+    case ReosHydraulicSimulationResults::DatasetType::InundationDuration:
+      return true;
+      break;
   }
 
   return false;
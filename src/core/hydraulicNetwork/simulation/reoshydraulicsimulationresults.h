@@ -37,6 +37,11 @@ class REOSCORE_EXPORT ReosHydraulicSimulationResults : public ReosMeshDatasetSou
       WaterLevel,
       WaterDepth,
       Velocity,
+      MaximumWaterDepth,
+      MaximumVelocity,
+      MaximumHazard,
+      TimeOfArrival,
+      InundationDuration,
     };
 
     ReosHydraulicSimulationResults( const ReosHydraulicSimulation *simulation, QObject *parent = nullptr );
@@ -64,6 +64,7 @@ ReosHydrographsStore::ReosHydrographsStore( QObject *parent ): ReosHydrographGro
 
 void ReosHydrographsStore::addHydrograph( ReosHydrograph *hydrograph )
 {
+  load();
   hydrograph->setParent( this );
   mHydrographs.append( hydrograph );
 
@@ -74,6 +75,7 @@ void ReosHydrographsStore::addHydrograph( ReosHydrograph *hydrograph )
 
 void ReosHydrographsStore::removeHydrograph( int index )
 {
+  load();
   mHydrographs.takeAt( index )->deleteLater();
   emit hydrographRemoved( index );
   emit dataChanged();
@@ -81,11 +83,15 @@ void ReosHydrographsStore::removeHydrograph( int index )
 
 int ReosHydrographsStore::hydrographCount() const
 {
+  if ( !mIsLoaded )
+    return mEncodedHydrographs.count();
+
   return mHydrographs.count();
 }
 
 QStringList ReosHydrographsStore::hydrographNames() const
 {
+  load();
   QStringList ret;
   for ( const ReosHydrograph *hyd : mHydrographs )
     ret.append( hyd->name() );
@@ -95,6 +101,7 @@ QStringList ReosHydrographsStore::hydrographNames() const
 
 QList<ReosHydrograph *> ReosHydrographsStore::hydrographsForTimeRange( const QDateTime &startTime, const QDateTime &endTime ) const
 {
+  load();
   QList<ReosHydrograph *> ret;
 
   for ( ReosHydrograph *hyd : std::as_const( mHydrographs ) )
@@ -110,11 +117,13 @@ QList<ReosHydrograph *> ReosHydrographsStore::hydrographsForTimeRange( const QDa
 
 QList<ReosHydrograph *> ReosHydrographsStore::allHydrographs() const
 {
+  load();
   return mHydrographs;
 }
 
 ReosHydrograph *ReosHydrographsStore::hydrograph( int index ) const
 {
+  load();
   if ( index >= 0 && index < mHydrographs.count() )
     return mHydrographs.at( index );
 
@@ -125,6 +134,13 @@ ReosEncodedElement ReosHydrographsStore::encode() const
 {
   ReosEncodedElement element( QStringLiteral( "hydrograph-store" ) );
 
+  if ( !mIsLoaded )
+  {
+    // hydrographs not accessed since decoding, they are encoded as they were decoded
+    element.addData( "hydrographs", mEncodedHydrographs );
+    return element;
+  }
+
   QList<QByteArray> encodedHydrographs;
   encodedHydrographs.reserve( mHydrographs.count() );
   for ( const ReosHydrograph *hyd : mHydrographs )
@@ -139,6 +155,8 @@ void ReosHydrographsStore::decode( const ReosEncodedElement &element )
 {
   qDeleteAll( mHydrographs );
   mHydrographs.clear();
+  mEncodedHydrographs.clear();
+  mIsLoaded = true;
 
   if ( element.description() != QStringLiteral( "hydrograph-store" ) )
     return;
@@ -147,12 +165,25 @@ void ReosHydrographsStore::decode( const ReosEncodedElement &element )
   if ( !element.getData( "hydrographs", encodedHydrographs ) )
     return;
 
-  mHydrographs.reserve( encodedHydrographs.count() );
-  for ( const QByteArray &bytes : std::as_const( encodedHydrographs ) )
+  // hydrographs are decoded when accessed for the first time, see load()
+  mEncodedHydrographs = encodedHydrographs;
+  mIsLoaded = mEncodedHydrographs.isEmpty();
+}
+
+void ReosHydrographsStore::load() const
+{
+  if ( mIsLoaded )
+    return;
+
+  mIsLoaded = true;
+  ReosHydrographsStore *store = const_cast<ReosHydrographsStore *>( this );
+
+  mHydrographs.reserve( mEncodedHydrographs.count() );
+  for ( const QByteArray &bytes : std::as_const( mEncodedHydrographs ) )
   {
-    mHydrographs.append( ReosHydrograph::decode( ReosEncodedElement( bytes ), this ) );
+    mHydrographs.append( ReosHydrograph::decode( ReosEncodedElement( bytes ), store ) );
 
-    connect( mHydrographs.last(), &ReosDataObject::dataChanged, this, &ReosHydrographsStore::hydrographChanged );
+    connect( mHydrographs.last(), &ReosDataObject::dataChanged, store, &ReosHydrographsStore::hydrographChanged );
 
     if ( mHydrographs.last()->dataProvider()->key() == QStringLiteral( "variable-time-step-memory" ) )
     {
@@ -167,6 +198,7 @@ void ReosHydrographsStore::decode( const ReosEncodedElement &element )
     }
   }
 
+  mEncodedHydrographs.clear();
 }
 
 ReosRunoffHydrographsStore::ReosRunoffHydrographsStore( ReosMeteorologicModelsCollection *meteoModelsCollection,
@@ -129,7 +129,14 @@ class REOSCORE_EXPORT ReosHydrographsStore : public ReosHydrographGroup
     void hydrographChanged();
 
   private:
-    QList<ReosHydrograph *>  mHydrographs;
+    mutable QList<ReosHydrograph *>  mHydrographs;
+
+    //! Encoded hydrographs not decoded yet, they are decoded when accessed for the first time
+    mutable QList<QByteArray> mEncodedHydrographs;
+    mutable bool mIsLoaded = true;
+
+    //! Decodes the hydrographs if not already loaded
+    void load() const;
 };
 
 
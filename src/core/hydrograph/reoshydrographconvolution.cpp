@@ -0,0 +1,259 @@
+/***************************************************************************
+  reoshydrographconvolution.cpp - ReosHydrographConvolution
+
+ ---------------------
+ begin                : 15.4.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "reoshydrographconvolution.h"
+
+#include <complex>
+#include <vector>
+#include <cmath>
+
+#include "reosprocess.h"
+#include "reostimeserie.h"
+
+// under this kernel size, direct convolution is always faster
+#define MIN_KERNEL_SIZE_FOR_FFT 64
+// count of input values processed between two progression report in direct convolution
+#define DIRECT_CONVOLUTION_BLOCK_SIZE 4096
+
+typedef std::complex<double> Complex;
+
+// In place iterative radix-2 FFT, size of data has to be a power of 2
+static void fft( std::vector<Complex> &data, bool inverse )
+{
+  const size_t n = data.size();
+
+  for ( size_t i = 1, j = 0; i < n; ++i )
+  {
+    size_t bit = n >> 1;
+    for ( ; j & bit; bit >>= 1 )
+      j ^= bit;
+    j ^= bit;
+    if ( i < j )
+      std::swap( data[i], data[j] );
+  }
+
+  for ( size_t len = 2; len <= n; len <<= 1 )
+  {
+    const double angle = 2 * M_PI / len * ( inverse ? 1 : -1 );
+    const size_t halfLen = len / 2;
+
+    // twiddle factors are not obtained by recurrence to avoid accumulation of rounding errors
+    std::vector<Complex> twiddles( halfLen );
+    for ( size_t k = 0; k < halfLen; ++k )
+      twiddles[k] = Complex( std::cos( angle * k ), std::sin( angle * k ) );
+
+    for ( size_t i = 0; i < n; i += len )
+    {
+      Complex *first = &data[i];
+      Complex *second = &data[i + halfLen];
+      for ( size_t k = 0; k < halfLen; ++k )
+      {
+        const Complex u = first[k];
+        const Complex v = second[k] * twiddles[k];
+        first[k] = u + v;
+        second[k] = u - v;
+      }
+    }
+  }
+}
+
+QVector<double> ReosHydrographConvolution::convolve( const QVector<double> &input, const QVector<double> &kernel, Method method, ReosProcess *process )
+{
+  if ( input.isEmpty() || kernel.isEmpty() )
+    return QVector<double>();
+
+  QVector<double> output( input.count() + kernel.count() - 1, 0.0 );
+
+  if ( method == Automatic )
+    method = automaticMethod( input.count(), kernel.count() );
+
+  bool success = false;
+  switch ( method )
+  {
+    case Automatic:
+    case Direct:
+      success = convolveDirect( input.constData(), input.count(), kernel.constData(), kernel.count(), output.data(), process );
+      break;
+    case FFT:
+      success = convolveFFT( input.constData(), input.count(), kernel.constData(), kernel.count(), output.data(), process );
+      break;
+  }
+
+  if ( !success )
+    return QVector<double>();
+
+  return output;
+}
+
+ReosHydrographConvolution::Method ReosHydrographConvolution::automaticMethod( int inputCount, int kernelCount )
+{
+  if ( std::min( inputCount, kernelCount ) < MIN_KERNEL_SIZE_FOR_FFT )
+    return Direct;
+
+  const int outputCount = inputCount + kernelCount - 1;
+  double fftSize = 1;
+  while ( fftSize < outputCount )
+    fftSize *= 2;
+
+  // rough estimation of the operation count, FFT way needs 2 transforms and has a higher constant cost
+  const double directCost = static_cast<double>( inputCount ) * kernelCount;
+  const double fftCost = 8 * fftSize * std::log2( fftSize );
+
+  return directCost > fftCost ? FFT : Direct;
+}
+
+bool ReosHydrographConvolution::convolveDirect( const double *input, int inputCount, const double *kernel, int kernelCount, double *output, ReosProcess *process )
+{
+  if ( process )
+    process->setMaxProgression( inputCount );
+
+  for ( int blockStart = 0; blockStart < inputCount; blockStart += DIRECT_CONVOLUTION_BLOCK_SIZE )
+  {
+    const int blockEnd = std::min( inputCount, blockStart + DIRECT_CONVOLUTION_BLOCK_SIZE );
+    for ( int i = blockStart; i < blockEnd; ++i )
+    {
+      const double factor = input[i];
+      if ( factor == 0 )
+        continue;
+
+      // contiguous multiply-add, vectorized by the compiler
+      double *out = output + i;
+      for ( int k = 0; k < kernelCount; ++k )
+        out[k] += factor * kernel[k];
+    }
+
+    if ( process )
+    {
+      if ( process->isStop() )
+        return false;
+      process->setCurrentProgression( blockEnd );
+    }
+  }
+
+  return true;
+}
+
+bool ReosHydrographConvolution::convolveFFT( const double *input, int inputCount, const double *kernel, int kernelCount, double *output, ReosProcess *process )
+{
+  const size_t outputCount = static_cast<size_t>( inputCount ) + kernelCount - 1;
+  size_t size = 1;
+  while ( size < outputCount )
+    size <<= 1;
+
+  if ( process )
+    process->setMaxProgression( 3 );
+
+  // input and kernel are real, so they are packed in the same complex array to only need one forward transform
+  std::vector<Complex> packed( size, Complex( 0, 0 ) );
+  for ( int i = 0; i < inputCount; ++i )
+    packed[i].real( input[i] );
+  for ( int i = 0; i < kernelCount; ++i )
+    packed[i].imag( kernel[i] );
+
+  fft( packed, false );
+
+  if ( process )
+  {
+    if ( process->isStop() )
+      return false;
+    process->setCurrentProgression( 1 );
+  }
+
+  std::vector<Complex> product( size );
+  for ( size_t k = 0; k < size; ++k )
+  {
+    const Complex z = packed[k];
+    const Complex zConj = std::conj( packed[( size - k ) & ( size - 1 )] );
+    const Complex inputTransform = ( z + zConj ) * 0.5;
+    const Complex kernelTransform = ( z - zConj ) * Complex( 0, -0.5 );
+    product[k] = inputTransform * kernelTransform;
+  }
+
+  fft( product, true );
+
+  if ( process )
+  {
+    if ( process->isStop() )
+      return false;
+    process->setCurrentProgression( 2 );
+  }
+
+  const double normalization = 1.0 / static_cast<double>( size );
+  for ( size_t i = 0; i < outputCount; ++i )
+    output[i] = product[i].real() * normalization;
+
+  if ( process )
+    process->setCurrentProgression( 3 );
+
+  return true;
+}
+
+QVector<double> ReosHydrographConvolution::resample( const ReosTimeSerieVariableTimeStep *serie, const ReosDuration &timeStep, const ReosDuration &offset )
+{
+  QVector<double> ret;
+  if ( !serie || serie->valueCount() == 0 || timeStep <= ReosDuration() )
+    return ret;
+
+  const int valueCount = serie->valueCount();
+  const ReosDuration lastTime = serie->relativeTimeAt( valueCount - 1 );
+
+  int count = 1;
+  if ( offset < lastTime )
+    count = static_cast<int>( std::ceil( ( lastTime - offset ) / timeStep ) ) + 1;
+  ret.resize( count );
+
+  // times are increasing, so the serie is only walked once with a cursor
+  int cursor = 0;
+  for ( int i = 0; i < count; ++i )
+  {
+    const ReosDuration time = offset + timeStep * i;
+
+    while ( cursor < valueCount && serie->relativeTimeAt( cursor ) <= time )
+      ++cursor;
+    // here, cursor is the index of the first time after time, cursor - 1 is the index of the time at or just before
+
+    const int index = cursor - 1;
+    if ( index >= 0 && serie->relativeTimeAt( index ) == time )
+    {
+      ret[i] = serie->valueAt( index );
+      continue;
+    }
+
+    if ( index < 0 || index >= valueCount - 1 )
+    {
+      ret[i] = 0;
+      continue;
+    }
+
+    const ReosDuration time1 = serie->relativeTimeAt( index );
+    const ReosDuration time2 = serie->relativeTimeAt( index + 1 );
+    const double value1 = serie->valueAt( index );
+    const double value2 = serie->valueAt( index + 1 );
+    const double ratio = ( time - time1 ) / ( time2 - time1 );
+
+    ret[i] = ( value2 - value1 ) * ratio + value1;
+  }
+
+  return ret;
+}
+
+QVector<ReosDuration> ReosHydrographConvolution::constantTimeSteps( const ReosDuration &timeStep, int count, const ReosDuration &offset )
+{
+  QVector<ReosDuration> ret( count );
+  for ( int i = 0; i < count; ++i )
+    ret[i] = offset + timeStep * i;
+
+  return ret;
+}
@@ -0,0 +1,73 @@
+/***************************************************************************
+  reoshydrographconvolution.h - ReosHydrographConvolution
+
+ ---------------------
+ begin                : 15.4.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef REOSHYDROGRAPHCONVOLUTION_H
+#define REOSHYDROGRAPHCONVOLUTION_H
+
+#include <QVector>
+
+#include "reoscore.h"
+#include "reosduration.h"
+
+class ReosProcess;
+class ReosTimeSerieVariableTimeStep;
+
+/**
+ * Class that handles discrete convolution of a serie (for example a runoff) by a kernel (for example a unit hydrograph),
+ * both defined with the same constant time step and stored in contiguous arrays.
+ *
+ * Short kernels are processed with a direct loop that can be vectorized by the compiler,
+ * long kernels applied on long series are processed in the frequency domain (FFT).
+ */
+class REOSCORE_EXPORT ReosHydrographConvolution
+{
+  public:
+    enum Method
+    {
+      Automatic, //!< Direct or FFT depending of the sizes of the arrays
+      Direct,
+      FFT
+    };
+
+    /**
+     * Returns the discrete convolution of \a input by \a kernel. The count of returned values is input.count() + kernel.count() - 1.
+     * If \a process is not null, it is used to report progression and checked to stop the calculation, in this case returned array is empty.
+     */
+    static QVector<double> convolve( const QVector<double> &input,
+                                     const QVector<double> &kernel,
+                                     Method method = Automatic,
+                                     ReosProcess *process = nullptr );
+
+    //! Returns the method that will be used with Automatic for arrays with size \a inputCount and \a kernelCount
+    static Method automaticMethod( int inputCount, int kernelCount );
+
+    /**
+     * Returns the values of the piecewise linear \a serie sampled from \a offset with the constant \a timeStep.
+     * Sampling starts at the reference time of the serie plus \a offset and stops with the first sample that is
+     * at or after the last time of the serie, values outside the serie are null.
+     */
+    static QVector<double> resample( const ReosTimeSerieVariableTimeStep *serie,
+                                     const ReosDuration &timeStep,
+                                     const ReosDuration &offset = ReosDuration() );
+
+    //! Returns the relative times, starting from \a offset with the constant \a timeStep, to associate with \a count values
+    static QVector<ReosDuration> constantTimeSteps( const ReosDuration &timeStep, int count, const ReosDuration &offset = ReosDuration() );
+
+  private:
+    static bool convolveDirect( const double *input, int inputCount, const double *kernel, int kernelCount, double *output, ReosProcess *process );
+    static bool convolveFFT( const double *input, int inputCount, const double *kernel, int kernelCount, double *output, ReosProcess *process );
+};
+
+#endif // REOSHYDROGRAPHCONVOLUTION_H
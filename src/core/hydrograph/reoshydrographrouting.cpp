@@ -17,6 +17,7 @@
 #include "reoshydrograph.h"
 #include "reosstyleregistery.h"
 #include "reoshydraulicscheme.h"
+#include "reoshydraulicnetworkscheduler.h"
 
 
 ReosHydrographRoutingMethodFactories *ReosHydrographRoutingMethodFactories::sInstance = nullptr;
@@ -287,9 +288,34 @@ void ReosHydrographRoutingLink::calculateRouting()
 {
   if ( ! inputHydrographSource() )
     return;
+
+  if ( mNetWork && mNetWork->calculationIsSuspended() )
+    return;
+
   ReosHydrographRoutingMethod *method = mRoutingMethods.value( mCurrentRoutingMethod, nullptr );
   if ( method )
   {
+    // if the output has already been calculated from the same data, whatever the scheme, it is restored from the cache of the network
+    ReosHydrographResultCache *cache = mNetWork ? mNetWork->resultCache() : nullptr;
+    if ( cache )
+    {
+      const QByteArray key = outputKey();
+      if ( !key.isEmpty() && cache->restore( key, mOutputHydrograph ) )
+      {
+        if ( mCalculation )
+          mCalculation->stop( true );
+        mCalculation = nullptr;
+        mCalculationIsInProgress = false;
+        mCurrentOutputKey = key;
+        calculationUpdated();
+        return;
+      }
+    }
+
+    // the key of the calculated hydrograph is built from the input hydrograph actually routed, that can be obsolete
+    const QByteArray calculatedKey = ReosHydrographResultCache::productKey( ReosHydrographResultCache::routingPrefix( method ),
+                                     {inputHydrographSource()->currentOutputKey()} );
+
     ReosCalculationContext context;
 //    method->calculateOutputHydrograph( inputHydrographSource()->outputHydrograph(), mOutputHydrograph, context );
 #ifndef _NDEBUG
@@ -304,7 +330,7 @@ void ReosHydrographRoutingLink::calculateRouting()
 
     ReosHydrographCalculation *calculation = method->calculationProcess( inputHydrographSource()->outputHydrograph(), context );
     mCalculation = calculation;
-    connect( calculation, &ReosProcess::finished, this, [this, calculation]
+    connect( calculation, &ReosProcess::finished, this, [this, calculation, calculatedKey]
     {
       if ( mCalculation == calculation )
       {
@@ -315,6 +341,9 @@ void ReosHydrographRoutingLink::calculateRouting()
         if ( calculation->isSuccessful() )
         {
           mOutputHydrograph->copyFrom( calculation->hydrograph() );
+          mCurrentOutputKey = calculatedKey;
+          if ( mNetWork )
+            mNetWork->resultCache()->store( calculatedKey, mOutputHydrograph );
           calculationUpdated();
         }
       }
@@ -325,6 +354,38 @@ void ReosHydrographRoutingLink::calculateRouting()
   }
 }
 
+void ReosHydrographRoutingLink::setCalculatedOutputHydrograph( ReosHydrograph *hydrograph, const QByteArray &key )
+{
+  if ( mCalculation )
+  {
+    mCalculation->stop( true );
+    mCalculation = nullptr;
+  }
+
+  if ( hydrograph )
+    mOutputHydrograph->copyFrom( hydrograph );
+
+  mCurrentOutputKey = key;
+  mCalculationIsInProgress = false;
+
+  // calculationUpdated() is not called because it would trigger the calculation of the destination node
+  setActualized();
+}
+
+QByteArray ReosHydrographRoutingLink::outputKey() const
+{
+  QList<QByteArray> upstreamKeys;
+  if ( inputHydrographSource() )
+    upstreamKeys.append( inputHydrographSource()->outputKey() );
+
+  return ReosHydrographResultCache::productKey( ReosHydrographResultCache::routingPrefix( currentRoutingMethod() ), upstreamKeys );
+}
+
+QByteArray ReosHydrographRoutingLink::currentOutputKey() const
+{
+  return mCurrentOutputKey;
+}
+
 
 void ReosHydrographRoutingLink::onSourceUpdated()
 {
@@ -663,9 +724,16 @@ void ReosHydrographRoutingMethodMuskingum::calculate( ReosHydrograph *inputHydro
     process->setMaxProgression( inputCount );
   int progressStep = std::max( inputCount / 100, 5 );
 
-  QDateTime refTime = inputHydrograph->referenceTime();
+  // the output is built in columns then set in one operation, as times are increasing, the last value is always the one at t
+  QVector<qint64> outputTimes;
+  QVector<double> outputValues;
+  outputTimes.reserve( inputCount );
+  outputValues.reserve( inputCount );
+  int inputCursor = -1;
+
   ReosDuration t = inputHydrograph->relativeTimeAt( 0 );
-  tempHyd->setValue( t, 0 );
+  outputTimes.append( t.valueMilliSecond() );
+  outputValues.append( 0 );
   ReosDuration lastTimeStep;
   double lastValue = 0;
 
@@ -674,7 +742,7 @@ void ReosHydrographRoutingMethodMuskingum::calculate( ReosHydrograph *inputHydro
 
   bool tooSmallTimeStep = false;
 
-  while ( i < ( inputCount - 1 ) || tempHyd->valueAtTime( t ) > lastValue / 100 )
+  while ( i < ( inputCount - 1 ) || outputValues.last() > lastValue / 100 )
   {
     ReosDuration timeStep;
     if ( i < inputCount - 1 )
@@ -702,12 +770,21 @@ void ReosHydrographRoutingMethodMuskingum::calculate( ReosHydrograph *inputHydro
 
     for ( int it = 0; it < internIteration; ++it )
     {
-      tempHyd->setValue( t + timeStep,
-                         C1 * inputHydrograph->valueAtTime( t + timeStep ) +
-                         C2 * inputHydrograph->valueAtTime( t ) +
-                         C3 * tempHyd->valueAtTime( t ) );
+      const double inputValue = inputHydrograph->valueAtTime( t, inputCursor );
+      const double nextInputValue = inputHydrograph->valueAtTime( t + timeStep, inputCursor );
+      const double value = C1 * nextInputValue + C2 * inputValue + C3 * outputValues.last();
       t = t + timeStep;
 
+      if ( t.valueMilliSecond() > outputTimes.last() )
+      {
+        outputTimes.append( t.valueMilliSecond() );
+        outputValues.append( value );
+      }
+      else
+      {
+        outputValues.last() = value;
+      }
+
       if ( process )
       {
         if ( process->isStop() )
@@ -717,7 +794,7 @@ void ReosHydrographRoutingMethodMuskingum::calculate( ReosHydrograph *inputHydro
     ++i;
 
     if ( i == ( inputCount - 1 ) )
-      lastValue = tempHyd->valueAtTime( t - timeStep );
+      lastValue = outputValues.count() > 1 ? outputValues.at( outputValues.count() - 2 ) : outputValues.last();
 
     if ( process )
     {
@@ -743,6 +820,7 @@ void ReosHydrographRoutingMethodMuskingum::calculate( ReosHydrograph *inputHydro
   if ( process && !message.text.isEmpty() )
     process->notify( message );
 
+  tempHyd->setValues( outputTimes, outputValues );
   outputHydrograph->copyFrom( tempHyd.get() );
 }
 
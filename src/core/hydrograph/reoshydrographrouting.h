@@ -131,6 +131,18 @@ class REOSCORE_EXPORT ReosHydrographRoutingLink : public ReosHydraulicLink
     void updateCalculationContextFromUpstream( const ReosCalculationContext &context, bool upstreamWillChange );
     bool updateCalculationContextFromDownstream( const ReosCalculationContext &context );
 
+    /**
+     * Sets the output hydrograph with \a hydrograph that has been calculated outside this link and identified by \a key,
+     * without triggering any calculation
+     */
+    void setCalculatedOutputHydrograph( ReosHydrograph *hydrograph, const QByteArray &key = QByteArray() );
+
+    //! Returns the key that identifies the output hydrograph in the result cache of the network through the data it has to be calculated from
+    QByteArray outputKey() const;
+
+    //! Returns the key of the data the current output hydrograph has been calculated from, empty if unknown
+    QByteArray currentOutputKey() const;
+
   public slots:
     void calculateRouting();
 
@@ -153,6 +165,7 @@ class REOSCORE_EXPORT ReosHydrographRoutingLink : public ReosHydraulicLink
     bool mCalculationIsInProgress = false;
 
     ReosHydrograph *mOutputHydrograph = nullptr;
+    QByteArray mCurrentOutputKey;
 
     void encodeData( ReosEncodedElement &element,  const ReosHydraulicNetworkContext &context ) const override;
 
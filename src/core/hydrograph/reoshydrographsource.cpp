@@ -20,6 +20,38 @@
 #include "reosstyleregistery.h"
 #include "reosgisengine.h"
 #include "reoshydraulicscheme.h"
+#include "reostransferfunction.h"
+#include "reosrunoffmodel.h"
+#include "reosrunoffbatch.h"
+#include "reoshydraulicnetworkscheduler.h"
+
+#include <QCryptographicHash>
+
+//! Process that calculates the runoff of a watershed from a copy of its inputs, then its hydrograph with the transfer function
+class ReosWatershedRunoffHydrographCalculation : public ReosHydrographCalculation
+{
+  public:
+    ReosWatershedRunoffHydrographCalculation( const ReosRunoffBatch &runoffBatch, ReosTransferFunctionCalculation *transferCalculation )
+      : mRunoffBatch( runoffBatch )
+      , mTransferCalculation( transferCalculation )
+    {}
+
+    void start() override
+    {
+      // the batch contains only one watershed and one rainfall, the results are its runoff
+      if ( mRunoffBatch.calculate() )
+        mTransferCalculation->setRunoffData( mRunoffBatch.results() );
+
+      mTransferCalculation->start();
+      mIsSuccessful = mTransferCalculation->isSuccessful();
+      if ( mIsSuccessful )
+        mHydrograph.reset( mTransferCalculation->getHydrograph() );
+    }
+
+  private:
+    ReosRunoffBatch mRunoffBatch;
+    std::unique_ptr<ReosTransferFunctionCalculation> mTransferCalculation;
+};
 
 ReosHydrographNode::ReosHydrographNode( ReosHydraulicNetwork *parent )
   : ReosHydraulicNode( parent )
@@ -67,6 +99,16 @@ ReosParameterBoolean *ReosHydrographSource::useForceOutputTimeStep() const
   return mUseForceOutputTimeStep;
 }
 
+QByteArray ReosHydrographSource::outputKey()
+{
+  return ReosHydrographResultCache::sourceKey( outputHydrograph() );
+}
+
+QByteArray ReosHydrographSource::currentOutputKey()
+{
+  return ReosHydrographResultCache::sourceKey( outputHydrograph() );
+}
+
 ReosHydrographRoutingLink *ReosHydrographSource::outputHydrographTransfer() const
 {
   if ( mLinksBySide1.isEmpty() )
@@ -284,6 +326,8 @@ void ReosHydrographJunction::updateCalculationContext( const ReosCalculationCont
 
 void ReosHydrographJunction::updateCalculationContextFromUpstream( const ReosCalculationContext &context, ReosHydrographRoutingLink *upstreamRouting, bool upstreamWillChange )
 {
+  mCalculationContext = context;
+
   QList<ReosHydrographRoutingLink *> upstreamLinks = ReosHydraulicNetworkUtils::upstreamLinkOfType<ReosHydrographRoutingLink>( this );
 
   upstreamLinks.removeOne( upstreamRouting );
@@ -329,6 +373,8 @@ void ReosHydrographJunction::updateCalculationContextFromUpstream( const ReosCal
 
 bool ReosHydrographJunction::updateCalculationContextFromDownstream( const ReosCalculationContext &context, ReosHydrographRoutingLink * )
 {
+  mCalculationContext = context;
+
   const QList<ReosHydrographRoutingLink *> upstreamLinks = ReosHydraulicNetworkUtils::upstreamLinkOfType<ReosHydrographRoutingLink>( this );
   for ( ReosHydrographRoutingLink *routing : upstreamLinks )
   {
@@ -379,29 +425,64 @@ void ReosHydrographJunction::calculateOuputHydrograph()
   mCalculationIsInProgress = true;
 
   if ( mSumCalculation )
+  {
     mSumCalculation->stop( true );
+    mSumCalculation = nullptr;
+  }
+
+  // if the output has already been calculated from the same data, whatever the scheme, it is restored from the cache of the network
+  ReosHydrographResultCache *cache = mNetWork ? mNetWork->resultCache() : nullptr;
+  if ( cache && outputIsCalculatedFromUpstream() )
+  {
+    const QByteArray key = outputKey();
+    if ( !key.isEmpty() && cache->restore( key, mOutputHydrograph ) )
+    {
+      mCurrentOutputKey = key;
+      mNeedCalculation = false;
+      mCalculationIsInProgress = false;
+      calculationUpdated();
+      return;
+    }
+  }
 
   HydrographSumCalculation *newCalculation = new HydrographSumCalculation;
   mSumCalculation = newCalculation;
 
+  // the key of the calculated hydrograph is built from the hydrographs actually summed, that can be obsolete
+  QByteArray internalKey;
   if ( !mInternalHydrograph.isNull() )
+  {
     newCalculation->addHydrograph( mInternalHydrograph );
+    if ( !mInternalHydrograph->hydrographIsObsolete() )
+      internalKey = internalHydrographHash( mCalculationContext );
+  }
+  else
+  {
+    internalKey = internalHydrographHash( mCalculationContext );
+  }
 
-  for ( const QPointer<ReosHydraulicLink> &link : std::as_const( mLinksBySide2 ) )
+  QList<QByteArray> upstreamKeys;
+  const QList<ReosHydrographRoutingLink *> upstreamLinks = ReosHydraulicNetworkUtils::upstreamLinkOfType<ReosHydrographRoutingLink>( this );
+  for ( ReosHydrographRoutingLink *routing : upstreamLinks )
   {
-    ReosHydrographRoutingLink *routing = qobject_cast<ReosHydrographRoutingLink *>( link );
-    if ( routing )
-    {
-      ReosHydrograph *transferhydrograph = routing->outputHydrograph();
-      if ( transferhydrograph )
-        newCalculation->addHydrograph( transferhydrograph );
-    }
+    ReosHydrograph *transferhydrograph = routing->outputHydrograph();
+    if ( transferhydrograph )
+      newCalculation->addHydrograph( transferhydrograph );
+    upstreamKeys.append( routing->currentOutputKey() );
   }
 
   if ( mUseForceOutputTimeStep->value() )
     newCalculation->forceOutputTimeStep( mForceOutputTimeStep->value() );
 
-  connect( newCalculation, &ReosProcess::finished, this, [this, newCalculation]
+  QByteArray calculatedKey;
+  if ( outputIsCalculatedFromUpstream() )
+  {
+    calculatedKey = ReosHydrographResultCache::productKey(
+                      ReosHydrographResultCache::junctionPrefix( internalKey, mUseForceOutputTimeStep->value(), mForceOutputTimeStep->value() ),
+                      upstreamKeys );
+  }
+
+  connect( newCalculation, &ReosProcess::finished, this, [this, newCalculation, calculatedKey]
   {
     if ( mSumCalculation == newCalculation )
     {
@@ -409,6 +490,9 @@ void ReosHydrographJunction::calculateOuputHydrograph()
       if ( newCalculation->isSuccessful() )
       {
         mOutputHydrograph->copyFrom( newCalculation->hydrograph() );
+        mCurrentOutputKey = calculatedKey;
+        if ( mNetWork )
+          mNetWork->resultCache()->store( calculatedKey, mOutputHydrograph );
         mNeedCalculation = false;
         calculationUpdated();
       }
@@ -425,6 +509,9 @@ void ReosHydrographJunction::calculateOuputHydrograph()
 
 void ReosHydrographJunction::calculateIfAllReady()
 {
+  if ( mNetWork && mNetWork->calculationIsSuspended() )
+    return;
+
   if ( mWaitingForUpstreamLinksUpdated.isEmpty() && mInternalHydrographUpdated && mNeedCalculation )
     calculateOuputHydrograph();
 }
@@ -451,6 +538,78 @@ QString ReosHydrographJunction::outputPrefixName() const
   return tr( "Output of" );
 }
 
+ReosHydrographCalculation *ReosHydrographJunction::createInternalHydrographCalculation( const ReosCalculationContext & ) const
+{
+  return nullptr;
+}
+
+QByteArray ReosHydrographJunction::internalHydrographHash( const ReosCalculationContext & ) const
+{
+  if ( mInternalHydrograph.isNull() )
+    return QByteArrayLiteral( "no-internal-hydrograph" );
+
+  return mInternalHydrograph->contentHash();
+}
+
+QByteArray ReosHydrographJunction::outputKey()
+{
+  if ( !outputIsCalculatedFromUpstream() )
+    return ReosHydrographSource::outputKey();
+
+  const QByteArray prefix = ReosHydrographResultCache::junctionPrefix( internalHydrographHash( mCalculationContext ),
+                            mUseForceOutputTimeStep->value(),
+                            mForceOutputTimeStep->value() );
+  if ( prefix.isEmpty() )
+    return QByteArray();
+
+  QList<QByteArray> upstreamKeys;
+  const QList<ReosHydrographRoutingLink *> upstreamLinks = ReosHydraulicNetworkUtils::upstreamLinkOfType<ReosHydrographRoutingLink>( this );
+  for ( ReosHydrographRoutingLink *routing : upstreamLinks )
+    upstreamKeys.append( routing->outputKey() );
+
+  return ReosHydrographResultCache::productKey( prefix, upstreamKeys );
+}
+
+QByteArray ReosHydrographJunction::currentOutputKey()
+{
+  if ( !outputIsCalculatedFromUpstream() )
+    return ReosHydrographSource::currentOutputKey();
+
+  return mCurrentOutputKey;
+}
+
+void ReosHydrographJunction::setCalculatedOutputHydrograph( ReosHydrograph *hydrograph,
+    const QByteArray &key,
+    ReosHydrograph *internalHydrograph,
+    const ReosCalculationContext &context )
+{
+  // the internal hydrograph is switched to the one of the context, a calculation launched by this is stopped just after
+  mCalculationContext = context;
+  updateInternalHydrographCalculationContext( context );
+
+  // the internal hydrograph is set before the output to not have it obsolete, that would lead to calculate it again
+  if ( internalHydrograph && !mInternalHydrograph.isNull() && mInternalHydrograph->hydrographIsObsolete() )
+    mInternalHydrograph->copyFrom( internalHydrograph );
+
+  if ( mSumCalculation )
+  {
+    mSumCalculation->stop( true );
+    mSumCalculation = nullptr;
+  }
+
+  if ( hydrograph )
+    mOutputHydrograph->copyFrom( hydrograph );
+  mCurrentOutputKey = key;
+
+  mWaitingForUpstreamLinksUpdated.clear();
+  mInternalHydrographUpdated = true;
+  mNeedCalculation = false;
+  mCalculationIsInProgress = false;
+
+  // calculationUpdated() is not called because it would trigger the calculation of the downstream routing
+  setActualized();
+}
+
 void ReosHydrographJunction::saveConfiguration( ReosHydraulicScheme *scheme ) const
 {
   ReosEncodedElement encodedElement = scheme->restoreElementConfig( id() );
@@ -538,6 +697,13 @@ void ReosHydrographNodeWatershed::init()
     } );
   }
 
+  // runoff hydrographs are kept in the cache of the network, so they are not calculated again when coming back to the same data
+  connect( mRunoffHydrographs, &ReosRunoffHydrographsStore::hydrographReady, this, [this]( ReosHydrograph * hydrograph )
+  {
+    if ( mNetWork && hydrograph && hydrograph == mInternalHydrograph )
+      mNetWork->resultCache()->store( internalHydrographHash( mCalculationContext ), hydrograph );
+  } );
+
   mRunoffHydrographs->setWatershed( mWatershed );
   if ( mHydrographsStore )
     delete mHydrographsStore;
@@ -559,6 +725,7 @@ ReosWatershed *ReosHydrographNodeWatershed::watershed() const
 
 bool ReosHydrographNodeWatershed::updateInternalHydrographCalculationContext( const ReosCalculationContext &context )
 {
+  mCalculationContext = context;
   mLastMeteoModel = context.meteorologicModel();
 
   return updateInternalHydrograph();
@@ -613,7 +780,12 @@ bool ReosHydrographJunction::setCurrentInternalHydrograph( ReosHydrograph *newHy
 
 void ReosHydrographNodeWatershed::calculateInternalHydrograph()
 {
-  if ( mInternalHydrographOrigin == RunoffHydrograph && !mInternalHydrograph.isNull() && mInternalHydrograph->hydrographIsObsolete() )
+  if ( mInternalHydrographOrigin == RunoffHydrograph && restoreInternalHydrographFromCache( mInternalHydrograph ) )
+  {
+    mInternalHydrographUpdated = true;
+    calculateIfAllReady();
+  }
+  else if ( mInternalHydrographOrigin == RunoffHydrograph && !mInternalHydrograph.isNull() && mInternalHydrograph->hydrographIsObsolete() )
   {
     connect( mRunoffHydrographs, &ReosRunoffHydrographsStore::hydrographReady, this, [this]( ReosHydrograph * updatedHydrograph )
     {
@@ -639,6 +811,74 @@ void ReosHydrographNodeWatershed::calculateInternalHydrograph()
   }
 }
 
+ReosHydrographCalculation *ReosHydrographNodeWatershed::createInternalHydrographCalculation( const ReosCalculationContext &context ) const
+{
+  if ( mInternalHydrographOrigin != RunoffHydrograph || mWatershed.isNull() )
+    return nullptr;
+
+  ReosTransferFunction *function = mWatershed->currentTransferFunction();
+  if ( !function )
+    return nullptr;
+
+  QPointer<ReosRunoff> runoff = mRunoffHydrographs->runoff( context.meteorologicModel() );
+  if ( runoff.isNull() )
+    return nullptr;
+
+  // only the inputs of the runoff are read here, the runoff is calculated with the hydrograph when the process is started
+  ReosTimeSerieConstantInterval *rainfall = runoff->rainfall();
+  if ( rainfall && runoff->runoffModelsGroup() )
+  {
+    ReosRunoffBatch runoffBatch;
+    runoffBatch.setRainfalls( rainfall->constData(), rainfall->valueCount(), rainfall->timeStep() );
+    if ( runoffBatch.addRunoffModelsGroup( runoffBatch.addWatershed(), runoff->runoffModelsGroup() ) )
+    {
+      ReosTransferFunctionCalculation *transferCalculation = function->createCalculation( rainfall->timeStep(), rainfall->referenceTime() );
+      if ( !transferCalculation )
+        return nullptr;
+      return new ReosWatershedRunoffHydrographCalculation( runoffBatch, transferCalculation );
+    }
+  }
+
+  // runoff models not handled by the batch are applied now
+  return function->calculationProcess( runoff );
+}
+
+bool ReosHydrographNodeWatershed::restoreInternalHydrographFromCache( ReosHydrograph *hydrograph )
+{
+  if ( !hydrograph || !hydrograph->hydrographIsObsolete() || !mNetWork )
+    return false;
+
+  const QByteArray key = internalHydrographHash( mCalculationContext );
+  return !key.isEmpty() && mNetWork->resultCache()->restore( key, hydrograph );
+}
+
+QByteArray ReosHydrographNodeWatershed::internalHydrographHash( const ReosCalculationContext &context ) const
+{
+  if ( mInternalHydrographOrigin != RunoffHydrograph )
+    return ReosHydrographJunction::internalHydrographHash( context );
+
+  if ( mWatershed.isNull() )
+    return QByteArray();
+
+  ReosTransferFunction *function = mWatershed->currentTransferFunction();
+  QPointer<ReosRunoff> runoff = mRunoffHydrographs->runoff( context.meteorologicModel() );
+  if ( !function || runoff.isNull() )
+    return QByteArray();
+
+  // the hash is built from the data the runoff is calculated from, so the runoff is not calculated to get it
+  const QByteArray runoffHash = runoff->inputHash();
+  if ( runoffHash.isEmpty() )
+    return QByteArray();
+
+  QCryptographicHash hash( QCryptographicHash::Sha1 );
+  hash.addData( runoffHash );
+  hash.addData( function->encode().bytes() );
+  hash.addData( QByteArray::number( function->concentrationTime()->value().valueMilliSecond() ) );
+  hash.addData( QByteArray::number( function->area()->value().valueM2(), 'g', 17 ) );
+
+  return hash.result();
+}
+
 bool ReosHydrographNodeWatershed::updateInternalHydrograph()
 {
   ReosHydrograph *newHydrograph = nullptr;
@@ -647,6 +887,8 @@ bool ReosHydrographNodeWatershed::updateInternalHydrograph()
   {
     case ReosHydrographNodeWatershed::RunoffHydrograph:
       newHydrograph = mRunoffHydrographs->hydrograph( mLastMeteoModel );
+      // if restored, the hydrograph is not obsolete anymore and the runoff hydrographs store will not calculate it
+      restoreInternalHydrographFromCache( newHydrograph );
       break;
     case ReosHydrographNodeWatershed::GaugedHydrograph:
       newHydrograph = mWatershed->gaugedHydrographs()->hydrograph( mGaugedHydrographIndex );
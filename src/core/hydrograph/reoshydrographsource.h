@@ -24,6 +24,7 @@
 #include "reoshydrograph.h"
 #include "reoswatershedmodule.h"
 #include "reosparameter.h"
+#include "reoscalculationcontext.h"
 
 class ReosCalculationContext;
 class ReosHydraulicLink;
@@ -107,6 +108,18 @@ class REOSCORE_EXPORT ReosHydrographSource : public ReosHydrographNode
     ReosParameterBoolean *useForceOutputTimeStep() const;
     ReosParameterDuration *forceOutputTimeStep() const;
 
+    /**
+     * Returns the key that identifies the output hydrograph in the result cache of the network through the data it has to be calculated from,
+     * an empty array if it can't be identified. Default implementation returns a key depending on the content of the output hydrograph.
+     */
+    virtual QByteArray outputKey();
+
+    /**
+     * Returns the key of the data the current output hydrograph has been calculated from, that can differ from outputKey()
+     * if the output hydrograph is obsolete. Default implementation returns a key depending on the content of the output hydrograph.
+     */
+    virtual QByteArray currentOutputKey();
+
   protected:
     ReosHydrographSource( const ReosEncodedElement &encodedElement, ReosHydraulicNetwork *parent = nullptr );
     void encodeData( ReosEncodedElement &element,  const ReosHydraulicNetworkContext & ) const override;
@@ -197,6 +210,60 @@ class REOSCORE_EXPORT ReosHydrographJunction : public ReosHydrographSource
 
     virtual QString outputPrefixName() const;
 
+    /**
+     * Returns a new process that calculates the internal hydrograph for the \a context, nullptr if the internal hydrograph
+     * does not need to be calculated. Caller takes ownership. Default implementation returns nullptr.
+     */
+    virtual ReosHydrographCalculation *createInternalHydrographCalculation( const ReosCalculationContext &context ) const;
+
+    /**
+     * Returns a hash that identifies the internal hydrograph for the \a context through the data it is calculated from,
+     * an empty array if it can't be identified. Default implementation returns the hash of the content of the current internal hydrograph.
+     */
+    virtual QByteArray internalHydrographHash( const ReosCalculationContext &context ) const;
+
+    //! Returns whether the output hydrograph is calculated from the upstream links and the internal hydrograph
+    virtual bool outputIsCalculatedFromUpstream() const {return true;}
+
+    /**
+     * Returns the key of the output hydrograph for the last calculation context, made of the key of the internal hydrograph
+     * and of the keys of the upstream routing links.
+     */
+    QByteArray outputKey() override;
+    QByteArray currentOutputKey() override;
+
+    /**
+     * Sets the output hydrograph with \a hydrograph that has been calculated outside this node for \a context and identified by \a key,
+     * without triggering any calculation. If the internal hydrograph is obsolete, it is set with \a internalHydrograph if not nullptr.
+     */
+    void setCalculatedOutputHydrograph( ReosHydrograph *hydrograph,
+                                        const QByteArray &key,
+                                        ReosHydrograph *internalHydrograph,
+                                        const ReosCalculationContext &context );
+
+    //! Process that sums hydrographs, with optionally a forced output time step
+    class HydrographSumCalculation: public ReosHydrographCalculation
+    {
+      public:
+        //! Constructor
+        HydrographSumCalculation();
+
+        /**
+         *  Adds a hydrograph for the calculation, a deep copy (implicitly shared if \a hydro id a memory provider type) is done
+         *  to ensure the operation is thread safe
+         */
+        void addHydrograph( ReosHydrograph *hydro );
+
+        void forceOutputTimeStep( const ReosDuration &timeStep );
+
+        void start() override;
+
+      private:
+        QList<ReosHydrograph *> mHydrographsToAdd;
+        bool mForceOutputTimeStep = false;
+        ReosDuration mTimeStep;
+    };
+
   signals:
     //! Emitted when the internal hydrograph pointer change
     void internalHydrographPointerChange();
@@ -222,6 +289,7 @@ class REOSCORE_EXPORT ReosHydrographJunction : public ReosHydrographSource
 
     bool mInternalHydrographUpdated = false;
     bool mNeedCalculation = true;
+    ReosCalculationContext mCalculationContext;
 
     ReosHydrographJunction( const ReosEncodedElement &encodedElement, ReosHydraulicNetwork *parent = nullptr );
     void encodeData( ReosEncodedElement &element,  const ReosHydraulicNetworkContext &context ) const override;
@@ -233,28 +301,7 @@ class REOSCORE_EXPORT ReosHydrographJunction : public ReosHydrographSource
     ReosSpatialPosition mPosition;
     QSet<QString> mWaitingForUpstreamLinksUpdated;
     bool mCalculationIsInProgress = false;
-
-    class HydrographSumCalculation: public ReosHydrographCalculation
-    {
-      public:
-        //! Constructor
-        HydrographSumCalculation();
-
-        /**
-         *  Adds a hydrograph for the calculation, a deep copy (implicitly shared if \a hydro id a memory provider type) is done
-         *  to ensure the operation is thread safe
-         */
-        void addHydrograph( ReosHydrograph *hydro );
-
-        void forceOutputTimeStep( const ReosDuration &timeStep );
-
-        void start() override;
-
-      private:
-        QList<ReosHydrograph *> mHydrographsToAdd;
-        bool mForceOutputTimeStep = false;
-        ReosDuration mTimeStep;
-    };
+    QByteArray mCurrentOutputKey;
 
     HydrographSumCalculation *mSumCalculation = nullptr;
 
@@ -292,6 +339,9 @@ class REOSCORE_EXPORT ReosHydrographNodeWatershed : public ReosHydrographJunctio
 
     static ReosHydrographNodeWatershed *decode( const ReosEncodedElement &encodedElement, const ReosHydraulicNetworkContext &context );
 
+    ReosHydrographCalculation *createInternalHydrographCalculation( const ReosCalculationContext &context ) const override;
+    QByteArray internalHydrographHash( const ReosCalculationContext &context ) const override;
+
   public slots:
   protected:
     void encodeData( ReosEncodedElement &element,  const ReosHydraulicNetworkContext &context ) const override;
@@ -309,6 +359,7 @@ class REOSCORE_EXPORT ReosHydrographNodeWatershed : public ReosHydrographJunctio
 
     void calculateInternalHydrograph() override;
     bool updateInternalHydrographCalculationContext( const ReosCalculationContext &context ) override;
+    bool restoreInternalHydrographFromCache( ReosHydrograph *hydrograph );
     bool updateInternalHydrograph() override;
 };
 
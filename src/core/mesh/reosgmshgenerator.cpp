@@ -18,6 +18,7 @@
 #include <gmsh.h>
 
 #include "reospolylinesstructure.h"
+#include "reosmeshsizefield.h"
 
 ReosGmshEngine *ReosGmshEngine::sInstance = nullptr;
 
@@ -135,13 +136,8 @@ ReosMeshFrameData ReosGmshEngine::generateMesh(
   ReosMeshFrameData result;
   try
   {
-    std::unique_ptr<ReosPolygonStructureValues> sizeValues;
-    double defaultSize = 10;
-    if ( resolutionControler )
-    {
-      sizeValues.reset( resolutionControler->resolutionPolygons()->values( destinationCrs ) );
-      defaultSize = resolutionControler->defaultSize()->value();
-    }
+    // the resolution polygons are compiled once in a grid, so the size callback does not need any geometry operation
+    const ReosMeshSizeField sizeField = ReosMeshSizeField::create( resolutionControler, data.extent, destinationCrs );
 
     gmsh::initialize();
     gmsh::model::add( "t1" );
@@ -192,18 +188,15 @@ ReosMeshFrameData ReosGmshEngine::generateMesh(
     gmsh::model::mesh::embed( 1, internalLines, 2, 1 );
 
     gmsh::option::setNumber( "Mesh.Algorithm", alg + 1 );
+    // the size field is read only, so gmsh can query it from several threads
+    gmsh::option::setNumber( "General.NumThreads", QThread::idealThreadCount() );
 
-    auto sizeFallBack = [&sizeValues, defaultSize]( int dim, int, double x, double y, double, double lc )
+    auto sizeFallBack = [&sizeField]( int dim, int, double x, double y, double, double lc )
     {
-      if ( !sizeValues )
+      if ( !sizeField.isValid() )
         return lc;
 
-      double sizeValue = sizeValues->value( x, y, dim == 1 | dim == 0 );
-
-      if ( std::isnan( sizeValue ) )
-        sizeValue = defaultSize;
-
-      return sizeValue;
+      return sizeField.value( x, y, dim == 1 || dim == 0 );
     };
 
     gmsh::model::mesh::setSizeCallback( sizeFallBack );
@@ -219,9 +212,18 @@ ReosMeshFrameData ReosGmshEngine::generateMesh(
     result.vertexCoordinates.resize( coord.size() );
     memcpy( result.vertexCoordinates.data(), coord.data(), coord.size()*sizeof( double ) );
 
-    QHash<size_t, int> tagToVertexIndex;
+    // node tags are contiguous from 1 when the mesh is generated, so a flat array is enough to map tags to vertex indexes
+    size_t maxTag = 0;
+    for ( size_t tag : nodeTags )
+      maxTag = std::max( maxTag, tag );
+    std::vector<int> tagToVertexIndexArray( maxTag + 1, 0 );
     for ( size_t i = 0; i < nodeTags.size(); ++i )
-      tagToVertexIndex.insert( nodeTags.at( i ), int( i ) );
+      tagToVertexIndexArray[nodeTags.at( i )] = int( i );
+
+    auto tagToVertexIndex = [&tagToVertexIndexArray]( size_t tag )
+    {
+      return tag < tagToVertexIndexArray.size() ? tagToVertexIndexArray[tag] : 0;
+    };
 
     std::vector<int> elementTypes;
     std::vector<std::vector<std::size_t> > elementTags;
@@ -229,31 +231,45 @@ ReosMeshFrameData ReosGmshEngine::generateMesh(
 
     gmsh::model::mesh::getElements( elementTypes, elementTags, nodeElemTags, 2, -1 );
 
-    for ( size_t type = 0; type < elementTypes.size(); ++type )
+    auto elementSize = []( int elementType )
     {
-      int elementType = elementTypes[type];
-      int elementSize = 0;
       switch ( elementType )
       {
         case 2:
-          elementSize = 3;
-          break;
+          return 3;
         case 3:
-          elementSize = 4;
-          break;
+          return 4;
         default:
-          break;
+          return 0;
+      }
+    };
+
+    int faceCount = 0;
+    int indexCount = 0;
+    for ( size_t type = 0; type < elementTypes.size(); ++type )
+    {
+      const int size = elementSize( elementTypes[type] );
+      if ( size > 2 )
+      {
+        faceCount += int( nodeElemTags.at( type ).size() / size );
+        indexCount += int( nodeElemTags.at( type ).size() );
       }
+    }
+    result.reserveFaces( faceCount, indexCount );
+
+    int face[4];
+    for ( size_t type = 0; type < elementTypes.size(); ++type )
+    {
+      const int size = elementSize( elementTypes[type] );
       const std::vector<size_t> &elementsNodes = nodeElemTags.at( type );
 
-      if ( elementSize > 2 )
+      if ( size > 2 )
       {
-        for ( size_t i = 0; i < elementsNodes.size() / elementSize; ++i )
+        for ( size_t i = 0; i < elementsNodes.size() / size; ++i )
         {
-          QVector<int> face( elementSize );
-          for ( int j = 0; j < elementSize; ++j )
-            face[j] = tagToVertexIndex.value( elementsNodes.at( static_cast<size_t>( i * elementSize + j ) ) );
-          result.facesIndexes.append( face );
+          for ( int j = 0; j < size; ++j )
+            face[j] = tagToVertexIndex( elementsNodes.at( static_cast<size_t>( i * size + j ) ) );
+          result.appendFace( face, size );
         }
       }
     }
@@ -269,14 +285,14 @@ ReosMeshFrameData ReosGmshEngine::generateMesh(
       //get the first vertex of the line (dim=0)
       gmsh::model::mesh::getNodes( nodeBoundTags, coordBound, parametricCoordBound, 0, boundLineTag, false, true );
       Q_ASSERT( nodeBoundTags.size() == 1 );
-      vertexTagBound.append( tagToVertexIndex.value( nodeBoundTags.at( 0 ) ) );
+      vertexTagBound.append( tagToVertexIndex( nodeBoundTags.at( 0 ) ) );
       // get the other vertex tags on the line
       gmsh::model::mesh::getNodes( nodeBoundTags, coordBound, parametricCoordBound, 1, boundLineTag, false, true );
 
       int iniSize = vertexTagBound.count();
       vertexTagBound.resize( iniSize + nodeBoundTags.size() );
       for ( size_t nt = 0; nt < nodeBoundTags.size(); ++nt )
-        vertexTagBound[iniSize + nt] =  tagToVertexIndex.value( nodeBoundTags.at( nt ) );
+        vertexTagBound[iniSize + nt] =  tagToVertexIndex( nodeBoundTags.at( nt ) );
 
       result.boundaryVertices.append( vertexTagBound );
     }
@@ -292,7 +308,7 @@ ReosMeshFrameData ReosGmshEngine::generateMesh(
 
         QVector<int> lineVertices( nodeBoundTags.size() - 1 );
         for ( size_t nt = 0; nt < nodeBoundTags.size() - 1; ++nt )
-          lineVertices[nt] =  tagToVertexIndex.value( nodeBoundTags.at( nt ) );
+          lineVertices[nt] =  tagToVertexIndex( nodeBoundTags.at( nt ) );
 
         holeVertices.append( lineVertices );
       }
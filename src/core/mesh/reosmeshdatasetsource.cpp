@@ -15,7 +15,42 @@
  ***************************************************************************/
 #include "reosmeshdatasetsource.h"
 
+#include <QVector>
+
 ReosMeshDatasetSource::ReosMeshDatasetSource( QObject *parent )
   : QObject( parent )
 {
 }
+
+bool ReosMeshDatasetSource::datasetValuesOnVertices( int groupIndex, int index, int vertexIndex, int vertexCount, double *values ) const
+{
+  const QVector<double> allValues = datasetValues( groupIndex, index );
+  const int valuesPerVertex = groupIsScalar( groupIndex ) ? 1 : 2;
+  const int start = vertexIndex * valuesPerVertex;
+  const int count = vertexCount * valuesPerVertex;
+
+  if ( vertexIndex < 0 || start + count > allValues.count() )
+    return false;
+
+  std::copy( allValues.constBegin() + start, allValues.constBegin() + start + count, values );
+  return true;
+}
+
+bool ReosMeshDatasetSource::faceIsActive( int index, int faceIndex ) const
+{
+  const QVector<int> active = activeFaces( index );
+  if ( faceIndex < 0 || faceIndex >= active.count() )
+    return false;
+
+  return active.at( faceIndex ) != 0;
+}
+
+QVector<int> ReosMeshDatasetSource::groupActiveFaces( int, int index ) const
+{
+  return activeFaces( index );
+}
+
+bool ReosMeshDatasetSource::groupFaceIsActive( int, int index, int faceIndex ) const
+{
+  return faceIsActive( index, faceIndex );
+}
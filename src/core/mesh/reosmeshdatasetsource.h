@@ -19,9 +19,11 @@
 #include <QString>
 #include <QObject>
 
+#include "reoscore.h"
+
 class ReosDuration;
 
-class ReosMeshDatasetSource : public QObject
+class REOSCORE_EXPORT ReosMeshDatasetSource : public QObject
 {
     Q_OBJECT
   public:
@@ -40,6 +42,36 @@ class ReosMeshDatasetSource : public QObject
     virtual QVector<int> activeFaces( int index ) const = 0;
     virtual int datasetIndexClosestBeforeTime( int groupIndex, const QDateTime &time ) const = 0;
 
+    /**
+     * Copies in \a values the values of the dataset \a index of the group \a groupIndex for the \a vertexCount vertices starting from \a vertexIndex.
+     * For vector group, two values are copied for each vertex, \a values has to be allocated accordingly.
+     * Default implementation extracts the values from datasetValues(), derived classes should override it to avoid reading the whole dataset.
+     * Returns false if the values can't be obtained.
+     */
+    virtual bool datasetValuesOnVertices( int groupIndex, int index, int vertexIndex, int vertexCount, double *values ) const;
+
+    /**
+     * Returns whether the face \a faceIndex is active for the dataset \a index.
+     * Default implementation uses activeFaces(), derived classes should override it to avoid obtaining the whole array.
+     */
+    virtual bool faceIsActive( int index, int faceIndex ) const;
+
+    /**
+     * Returns the active faces of the dataset \a index of the group \a groupIndex.
+     * Default implementation returns activeFaces(), derived classes should override it if some groups have their own active faces.
+     */
+    virtual QVector<int> groupActiveFaces( int groupIndex, int index ) const;
+
+    /**
+     * Returns whether the face \a faceIndex is active for the dataset \a index of the group \a groupIndex.
+     * Default implementation returns faceIsActive(), derived classes should override it if some groups have their own active faces.
+     */
+    virtual bool groupFaceIsActive( int groupIndex, int index, int faceIndex ) const;
+
+  signals:
+    //! Emitted when the minimum and maximum of the groups or of the datasets have been calculated after the source was created, or have changed
+    void minimumMaximumChanged();
+
 };
 
 #endif // REOSMESHDATASETSOURCE_H
@@ -148,6 +148,60 @@ ReosParameterDouble *ReosMeshResolutionController::defaultSize() const
   return mDefaultSize;
 }
 
+int ReosMeshFrameData::faceCount() const
+{
+  if ( facesOffsets.isEmpty() )
+    return facesIndexes.count() / 3;
+
+  return facesOffsets.count() - 1;
+}
+
+int ReosMeshFrameData::faceSize( int faceIndex ) const
+{
+  if ( facesOffsets.isEmpty() )
+    return 3;
+
+  return facesOffsets.at( faceIndex + 1 ) - facesOffsets.at( faceIndex );
+}
+
+const int *ReosMeshFrameData::faceVertices( int faceIndex ) const
+{
+  if ( facesOffsets.isEmpty() )
+    return facesIndexes.constData() + 3 * faceIndex;
+
+  return facesIndexes.constData() + facesOffsets.at( faceIndex );
+}
+
+bool ReosMeshFrameData::onlyTriangles() const
+{
+  return facesOffsets.isEmpty();
+}
+
+void ReosMeshFrameData::reserveFaces( int faceCount, int indexCount )
+{
+  facesIndexes.reserve( indexCount );
+  if ( indexCount != 3 * faceCount )
+    facesOffsets.reserve( faceCount + 1 );
+}
+
+void ReosMeshFrameData::appendFace( const int *vertices, int size )
+{
+  if ( size != 3 && facesOffsets.isEmpty() )
+  {
+    // first face that is not a triangle, we need the offsets of the triangles already there
+    const int triangleCount = facesIndexes.count() / 3;
+    facesOffsets.resize( triangleCount + 1 );
+    for ( int i = 0; i <= triangleCount; ++i )
+      facesOffsets[i] = 3 * i;
+  }
+
+  for ( int i = 0; i < size; ++i )
+    facesIndexes.append( vertices[i] );
+
+  if ( !facesOffsets.isEmpty() )
+    facesOffsets.append( facesIndexes.count() );
+}
+
 ReosMeshGeneratorPoly2TriProcess::ReosMeshGeneratorPoly2TriProcess( const QPolygonF &domain )
   : mDomain( domain )
 {}
@@ -184,19 +238,19 @@ void ReosMeshGeneratorPoly2TriProcess::start()
 
     int triangleCount = triangles.size();
 
-    mResult.facesIndexes.fill( QVector<int>( 3 ), triangleCount );
+    mResult.facesIndexes.resize( triangleCount * 3 );
+    int *reosTriangles = mResult.facesIndexes.data();
 
     for ( int t = 0; t < triangleCount; ++t )
     {
       p2t::Triangle *triangle = triangles.at( t );
 
-      QVector<int> &reosTriangle = mResult.facesIndexes[t];
-
       for ( int s = 0; s < 3; ++s )
       {
-        reosTriangle[s] = mapPoly2TriPointToVertex.value( triangle->GetPoint( s ), -1 );
-        if ( reosTriangle[s] == -1 )
+        const int vertexIndex = mapPoly2TriPointToVertex.value( triangle->GetPoint( s ), -1 );
+        if ( vertexIndex == -1 )
           throw std::exception();
+        reosTriangles[t * 3 + s] = vertexIndex;
       }
     }
 
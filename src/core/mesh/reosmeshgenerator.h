@@ -33,15 +33,40 @@ class ReosParameterDouble;
 class ReosPolygonStructure;
 class ReosTopographyCollection;
 
-//! Structure that contains mesh frame data
-struct ReosMeshFrameData
+/**
+ * Structure that contains mesh frame data
+ *
+ * The vertex indexes of all the faces are stored one after the other in \a facesIndexes.
+ * If all the faces are triangles, \a facesOffsets is empty and the face i is defined by the indexes 3*i to 3*i+2,
+ * otherwise the face i is defined by the indexes from facesOffsets[i] to facesOffsets[i+1] excluded.
+ */
+struct REOSCORE_EXPORT ReosMeshFrameData
 {
   QVector<double> vertexCoordinates;
-  QVector<QVector<int>> facesIndexes;
+  QVector<int> facesIndexes;
+  QVector<int> facesOffsets;
   QRectF extent;
   bool hasZ = false;
   QVector<QVector<int>> boundaryVertices;
   QVector<QVector<QVector<int>>> holesVertices;
+
+  //! Returns the count of faces
+  int faceCount() const;
+
+  //! Returns the count of vertices of the face with index \a faceIndex
+  int faceSize( int faceIndex ) const;
+
+  //! Returns a pointer to the first vertex index of the face with index \a faceIndex
+  const int *faceVertices( int faceIndex ) const;
+
+  //! Returns whether all the faces are triangles
+  bool onlyTriangles() const;
+
+  //! Reserves memory for \a faceCount faces with a total of \a indexCount vertex indexes
+  void reserveFaces( int faceCount, int indexCount );
+
+  //! Appends a face defined by the \a size vertex indexes \a vertices
+  void appendFace( const int *vertices, int size );
 };
 
 
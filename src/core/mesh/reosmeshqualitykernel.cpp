@@ -0,0 +1,588 @@
+/***************************************************************************
+  reosmeshqualitykernel.cpp - ReosMeshQualityKernel
+
+ ---------------------
+ begin                : 25.5.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "reosmeshqualitykernel.h"
+
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include <QtConcurrent>
+
+static const int CHUNK_SIZE = 4096;
+
+// Calls func( chunk, begin, end ) in parallel for each chunk of CHUNK_SIZE elements among count and returns the count of chunks
+template<typename F>
+static int forEachChunk( int count, F func )
+{
+  const int chunkCount = ( count + CHUNK_SIZE - 1 ) / CHUNK_SIZE;
+  QVector<int> chunks( chunkCount );
+  std::iota( chunks.begin(), chunks.end(), 0 );
+  QtConcurrent::blockingMap( chunks, [&]( int chunk )
+  {
+    func( chunk, chunk * CHUNK_SIZE, std::min( count, ( chunk + 1 ) * CHUNK_SIZE ) );
+  } );
+
+  return chunkCount;
+}
+
+// Returns the angle of the vector in degrees, between 0 and 360
+static double vectorAngle( double x, double y )
+{
+  const double angle = std::atan2( y, x ) / M_PI * 180;
+  return angle < 0 ? angle + 360 : angle;
+}
+
+static bool sameValue( double v1, double v2 )
+{
+  return v1 == v2 || ( std::isnan( v1 ) && std::isnan( v2 ) );
+}
+
+ReosMeshQualityKernel::ReosMeshQualityKernel( int maximumVerticesPerFace )
+  : mMaximumVerticesPerFace( maximumVerticesPerFace )
+{
+  mFaceStarts.append( 0 );
+}
+
+void ReosMeshQualityKernel::setUnitFactors( double lengthFactor, double areaFactor )
+{
+  if ( lengthFactor == mLengthFactor && areaFactor == mAreaFactor )
+    return;
+
+  mLengthFactor = lengthFactor;
+  mAreaFactor = areaFactor;
+
+  // forces the calculation of all the faces on next update
+  mFaces.clear();
+  mFaceStarts = QVector<int>( 1, 0 );
+}
+
+int ReosMeshQualityKernel::update( const QVector<double> &verticesX,
+                                   const QVector<double> &verticesY,
+                                   const QVector<double> &verticesZ,
+                                   const QVector<int> &faces,
+                                   const QVector<int> &faceStarts )
+{
+  const int vertexCount = std::min( verticesX.count(), std::min( verticesY.count(), verticesZ.count() ) );
+  const int faceCount = std::max( 0, faceStarts.count() - 1 );
+
+  // old arrays are kept to find what has changed, arrays are implicitly shared, so there is no copy
+  const QVector<double> oldX = mVerticesX;
+  const QVector<double> oldY = mVerticesY;
+  const QVector<double> oldZ = mVerticesZ;
+  const QVector<int> oldFaces = mFaces;
+  const QVector<int> oldFaceStarts = mFaceStarts;
+  const int oldVertexCount = oldX.count();
+  const int oldFaceCount = std::max( 0, oldFaceStarts.count() - 1 );
+
+  mVerticesX = verticesX.mid( 0, vertexCount );
+  mVerticesY = verticesY.mid( 0, vertexCount );
+  mVerticesZ = verticesZ.mid( 0, vertexCount );
+  mFaces = faces;
+  mFaceStarts = faceStarts;
+  if ( mFaceStarts.isEmpty() )
+    mFaceStarts.append( 0 );
+
+  QVector<char> changedVertices( vertexCount, 0 );
+  char *changedVerticesData = changedVertices.data();
+  forEachChunk( vertexCount, [&]( int, int begin, int end )
+  {
+    for ( int v = begin; v < end; ++v )
+      changedVerticesData[v] = v >= oldVertexCount ||
+                               !sameValue( oldX.at( v ), mVerticesX.at( v ) ) ||
+                               !sameValue( oldY.at( v ), mVerticesY.at( v ) ) ||
+                               !sameValue( oldZ.at( v ), mVerticesZ.at( v ) );
+  } );
+
+  mAreas.resize( faceCount );
+  mMinimumAngles.resize( faceCount );
+  mMaximumAngles.resize( faceCount );
+  mAspectRatios.resize( faceCount );
+  mOrientations.resize( faceCount );
+  mFaceErrors.resize( faceCount );
+
+  // writing by index from several threads requires not shared arrays
+  mAreas.detach();
+  mMinimumAngles.detach();
+  mMaximumAngles.detach();
+  mAspectRatios.detach();
+  mOrientations.detach();
+  mFaceErrors.detach();
+
+  QVector<int> calculatedFaces( ( faceCount + CHUNK_SIZE - 1 ) / CHUNK_SIZE, 0 );
+  int *calculatedFacesData = calculatedFaces.data();
+  QVector<char> flippedFaces( calculatedFaces.count(), 0 );
+  char *flippedFacesData = flippedFaces.data();
+  forEachChunk( faceCount, [&]( int chunk, int begin, int end )
+  {
+    for ( int f = begin; f < end; ++f )
+    {
+      const int start = mFaceStarts.at( f );
+      const int size = mFaceStarts.at( f + 1 ) - start;
+      bool changed = f >= oldFaceCount || oldFaceStarts.at( f + 1 ) - oldFaceStarts.at( f ) != size;
+      for ( int k = 0; !changed && k < size; ++k )
+      {
+        const int vertex = mFaces.at( start + k );
+        changed = vertex != oldFaces.at( oldFaceStarts.at( f ) + k ) ||
+                  vertex < 0 || vertex >= vertexCount ||
+                  changedVerticesData[vertex];
+      }
+
+      if ( changed )
+      {
+        const char oldOrientation = f < oldFaceCount ? mOrientations.at( f ) : 0;
+        calculateFace( f );
+        calculatedFacesData[chunk]++;
+        if ( mOrientations.at( f ) != oldOrientation )
+          flippedFacesData[chunk] = 1;
+      }
+    }
+  } );
+
+  mError = Error::NoError;
+  mErrorElement = -1;
+  for ( int f = 0; f < faceCount; ++f )
+  {
+    if ( mFaceErrors.at( f ) != static_cast<char>( Error::NoError ) )
+    {
+      mError = static_cast<Error>( mFaceErrors.at( f ) );
+      mErrorElement = f;
+      break;
+    }
+  }
+
+  // the topology only depends on the faces and their orientation, it is not rebuilt if they have not changed,
+  // but as it is not updated face by face, any change in the faces leads to rebuild it entirely
+  mTopologyRebuilt = false;
+  const bool topologyChanged = !mTopologyIsValid ||
+                               vertexCount != oldVertexCount ||
+                               mFaces != oldFaces ||
+                               mFaceStarts != oldFaceStarts ||
+                               flippedFaces.contains( 1 );
+
+  if ( mError != Error::NoError )
+  {
+    mTopologyIsValid = false;
+  }
+  else if ( topologyChanged )
+  {
+    buildTopology();
+    mTopologyRebuilt = true;
+    mTopologyIsValid = mError == Error::NoError;
+  }
+
+  return std::accumulate( calculatedFaces.constBegin(), calculatedFaces.constEnd(), 0 );
+}
+
+bool ReosMeshQualityKernel::topologyRebuilt() const
+{
+  return mTopologyRebuilt;
+}
+
+ReosMeshQualityKernel::Error ReosMeshQualityKernel::error() const
+{
+  return mError;
+}
+
+int ReosMeshQualityKernel::errorElement() const
+{
+  return mErrorElement;
+}
+
+int ReosMeshQualityKernel::vertexCount() const
+{
+  return mVerticesX.count();
+}
+
+int ReosMeshQualityKernel::faceCount() const
+{
+  return mFaceStarts.count() - 1;
+}
+
+QVector<int> ReosMeshQualityKernel::face( int face ) const
+{
+  QVector<int> ret;
+  if ( face < 0 || face >= faceCount() || mOrientations.at( face ) == 0 )
+    return ret;
+
+  const int size = mFaceStarts.at( face + 1 ) - mFaceStarts.at( face );
+  ret.reserve( size );
+  for ( int k = 0; k < size; ++k )
+    ret.append( ccwVertex( face, k ) );
+
+  return ret;
+}
+
+double ReosMeshQualityKernel::area( int face ) const
+{
+  return mAreas.at( face );
+}
+
+double ReosMeshQualityKernel::minimumAngle( int face ) const
+{
+  return mMinimumAngles.at( face );
+}
+
+double ReosMeshQualityKernel::maximumAngle( int face ) const
+{
+  return mMaximumAngles.at( face );
+}
+
+double ReosMeshQualityKernel::aspectRatio( int face ) const
+{
+  return mAspectRatios.at( face );
+}
+
+int ReosMeshQualityKernel::connectionCount( int vertex ) const
+{
+  if ( mError != Error::NoError )
+    return 0;
+
+  // around an inner vertex, there are as many edges as faces, one more for a boundary vertex
+  const int faceCount = mVertexFaceStarts.at( vertex + 1 ) - mVertexFaceStarts.at( vertex );
+  return faceCount + ( mBoundaryEdgeCounts.at( vertex ) > 0 ? 1 : 0 );
+}
+
+bool ReosMeshQualityKernel::isVertexOnBoundary( int vertex ) const
+{
+  if ( mError != Error::NoError )
+    return false;
+
+  return mBoundaryEdgeCounts.at( vertex ) > 0;
+}
+
+ReosMeshQualityKernel::Results ReosMeshQualityKernel::check( ReosMesh::QualityMeshChecks checks, const Thresholds &thresholds ) const
+{
+  Results results;
+  if ( mError != Error::NoError )
+    return results;
+
+  const int faceCount = this->faceCount();
+  const int vertexCount = this->vertexCount();
+
+  QVector<Results> chunkResults( std::max( ( faceCount + CHUNK_SIZE - 1 ) / CHUNK_SIZE, ( vertexCount + CHUNK_SIZE - 1 ) / CHUNK_SIZE ) );
+  Results *chunkResultsData = chunkResults.data();
+
+  forEachChunk( faceCount, [&]( int chunk, int begin, int end )
+  {
+    Results &res = chunkResultsData[chunk];
+    for ( int f = begin; f < end; ++f )
+    {
+      if ( mOrientations.at( f ) == 0 )
+        continue;
+
+      const double area = mAreas.at( f );
+      if ( checks & ReosMesh::MinimumAngle && mMinimumAngles.at( f ) < thresholds.minimumAngle )
+        res.minimumAngle.append( f );
+      if ( checks & ReosMesh::MaximumAngle && mMaximumAngles.at( f ) > thresholds.maximumAngle )
+        res.maximumAngle.append( f );
+      if ( checks & ReosMesh::MinimumArea && area < thresholds.minimumArea )
+        res.minimumArea.append( f );
+      if ( checks & ReosMesh::MaximumArea && area > thresholds.maximumArea )
+        res.maximumArea.append( f );
+
+      if ( !( checks & ( ReosMesh::MaximumAreaChange | ReosMesh::MaximumSlope ) ) )
+        continue;
+
+      const int start = mFaceStarts.at( f );
+      const int size = mFaceStarts.at( f + 1 ) - start;
+      bool areaChange = false;
+      for ( int k = 0; k < size; ++k )
+      {
+        const int neighbor = mNeighbors.at( start + k );
+
+        // the change is relative to the area of the face with the lowest index, so both faces give the same result
+        if ( checks & ReosMesh::MaximumAreaChange && !areaChange && neighbor != -1 )
+        {
+          const double neighborArea = mAreas.at( neighbor );
+          const double referenceArea = f < neighbor ? area : neighborArea;
+          areaChange = referenceArea > 0 && std::fabs( neighborArea - area ) / referenceArea > thresholds.maximumAreaChange;
+        }
+
+        // an inner edge is checked only by the face with the lowest index
+        if ( checks & ReosMesh::MaximumSlope && ( neighbor == -1 || f < neighbor ) )
+        {
+          const int v1 = ccwVertex( f, k );
+          const int v2 = ccwVertex( f, ( k + 1 ) % size );
+          const double dx = mVerticesX.at( v2 ) - mVerticesX.at( v1 );
+          const double dy = mVerticesY.at( v2 ) - mVerticesY.at( v1 );
+          const double distance = std::sqrt( dx * dx + dy * dy ) * mLengthFactor;
+          if ( distance > 0 && std::fabs( mVerticesZ.at( v1 ) - mVerticesZ.at( v2 ) ) / distance > thresholds.maximumSlope )
+            res.maximumSlope.append( {v1, v2} );
+        }
+      }
+
+      if ( areaChange )
+        res.maximumAreaChange.append( f );
+    }
+  } );
+
+  if ( checks & ( ReosMesh::ConnectionCount | ReosMesh::ConnectionCountBoundary ) )
+  {
+    forEachChunk( vertexCount, [&]( int chunk, int begin, int end )
+    {
+      Results &res = chunkResultsData[chunk];
+      for ( int v = begin; v < end; ++v )
+      {
+        const int count = connectionCount( v );
+        if ( checks & ReosMesh::ConnectionCount && count > thresholds.connectionCount )
+          res.connectionCount.append( v );
+        if ( checks & ReosMesh::ConnectionCountBoundary && isVertexOnBoundary( v ) && count > thresholds.connectionCountBoundary )
+          res.connectionCountBoundary.append( v );
+      }
+    } );
+  }
+
+  for ( const Results &res : std::as_const( chunkResults ) )
+  {
+    results.minimumAngle.append( res.minimumAngle );
+    results.maximumAngle.append( res.maximumAngle );
+    results.connectionCount.append( res.connectionCount );
+    results.connectionCountBoundary.append( res.connectionCountBoundary );
+    results.maximumSlope.append( res.maximumSlope );
+    results.minimumArea.append( res.minimumArea );
+    results.maximumArea.append( res.maximumArea );
+    results.maximumAreaChange.append( res.maximumAreaChange );
+  }
+
+  return results;
+}
+
+int ReosMeshQualityKernel::ccwVertex( int face, int position ) const
+{
+  const int start = mFaceStarts.at( face );
+  if ( mOrientations.at( face ) >= 0 )
+    return mFaces.at( start + position );
+
+  const int size = mFaceStarts.at( face + 1 ) - start;
+  return mFaces.at( start + size - 1 - position );
+}
+
+void ReosMeshQualityKernel::calculateFace( int face )
+{
+  const int start = mFaceStarts.at( face );
+  const int size = mFaceStarts.at( face + 1 ) - start;
+  const int vertexCount = mVerticesX.count();
+
+  mOrientations[face] = 0;
+  mFaceErrors[face] = static_cast<char>( Error::NoError );
+  mAreas[face] = 0;
+  mMinimumAngles[face] = 0;
+  mMaximumAngles[face] = 0;
+  mAspectRatios[face] = 0;
+
+  // face without vertex is a removed face
+  if ( size == 0 )
+    return;
+
+  if ( size < 3 )
+  {
+    mFaceErrors[face] = static_cast<char>( Error::InvalidFace );
+    return;
+  }
+
+  if ( size > mMaximumVerticesPerFace )
+  {
+    mFaceErrors[face] = static_cast<char>( Error::TooManyVerticesInFace );
+    return;
+  }
+
+  for ( int k = 0; k < size; ++k )
+  {
+    const int vertex = mFaces.at( start + k );
+    if ( vertex < 0 || vertex >= vertexCount )
+    {
+      mFaceErrors[face] = static_cast<char>( Error::InvalidVertex );
+      return;
+    }
+  }
+
+  // coordinates relative to the first vertex to keep precision with large coordinates
+  const double x0 = mVerticesX.at( mFaces.at( start ) );
+  const double y0 = mVerticesY.at( mFaces.at( start ) );
+  double doubleArea = 0;
+  double longestEdge2 = 0;
+  for ( int k = 0; k < size; ++k )
+  {
+    const int v1 = mFaces.at( start + k );
+    const int v2 = mFaces.at( start + ( k + 1 ) % size );
+    const double x1 = mVerticesX.at( v1 ) - x0;
+    const double y1 = mVerticesY.at( v1 ) - y0;
+    const double x2 = mVerticesX.at( v2 ) - x0;
+    const double y2 = mVerticesY.at( v2 ) - y0;
+    doubleArea += x1 * y2 - x2 * y1;
+    longestEdge2 = std::max( longestEdge2, ( x2 - x1 ) * ( x2 - x1 ) + ( y2 - y1 ) * ( y2 - y1 ) );
+  }
+
+  if ( longestEdge2 == 0 || std::fabs( doubleArea ) <= longestEdge2 * 1e-12 )
+  {
+    mFaceErrors[face] = static_cast<char>( Error::FlatFace );
+    return;
+  }
+
+  mOrientations[face] = doubleArea > 0 ? 1 : -1;
+
+  double minAngle = std::numeric_limits<double>::max();
+  double maxAngle = std::numeric_limits<double>::lowest();
+  for ( int k = 0; k < size; ++k )
+  {
+    const int iv1 = ccwVertex( face, k );
+    const int iv2 = ccwVertex( face, ( k + 1 ) % size );
+    const int iv3 = ccwVertex( face, ( k + 2 ) % size );
+    const double x2 = mVerticesX.at( iv2 );
+    const double y2 = mVerticesY.at( iv2 );
+
+    // counter clockwise angle from the next edge to the previous one
+    const double angle = std::fmod( vectorAngle( mVerticesX.at( iv1 ) - x2, mVerticesY.at( iv1 ) - y2 ) + 360.0
+                                    - vectorAngle( mVerticesX.at( iv3 ) - x2, mVerticesY.at( iv3 ) - y2 ), 360.0 );
+    minAngle = std::min( minAngle, angle );
+    maxAngle = std::max( maxAngle, angle );
+  }
+
+  const double area = std::fabs( doubleArea ) / 2;
+  const double normalization = size == 3 ? std::sqrt( 3.0 ) / 4 : 1.0;
+
+  mAreas[face] = area * mAreaFactor;
+  mMinimumAngles[face] = minAngle;
+  mMaximumAngles[face] = maxAngle;
+  mAspectRatios[face] = longestEdge2 / area * normalization;
+}
+
+void ReosMeshQualityKernel::buildTopology()
+{
+  const int vertexCount = mVerticesX.count();
+  const int faceCount = this->faceCount();
+
+  mVertexFaceStarts.fill( 0, vertexCount + 1 );
+  for ( int f = 0; f < faceCount; ++f )
+  {
+    if ( mOrientations.at( f ) == 0 )
+      continue;
+    for ( int i = mFaceStarts.at( f ); i < mFaceStarts.at( f + 1 ); ++i )
+      mVertexFaceStarts[mFaces.at( i ) + 1]++;
+  }
+
+  for ( int v = 0; v < vertexCount; ++v )
+    mVertexFaceStarts[v + 1] += mVertexFaceStarts.at( v );
+
+  mVertexFaces.resize( mVertexFaceStarts.last() );
+  QVector<int> positions = mVertexFaceStarts;
+  for ( int f = 0; f < faceCount; ++f )
+  {
+    if ( mOrientations.at( f ) == 0 )
+      continue;
+    for ( int i = mFaceStarts.at( f ); i < mFaceStarts.at( f + 1 ); ++i )
+      mVertexFaces[positions[mFaces.at( i )]++] = f;
+  }
+
+  mNeighbors.fill( -1, mFaces.count() );
+  QVector<int> chunkErrors( ( faceCount + CHUNK_SIZE - 1 ) / CHUNK_SIZE, -1 );
+  int *chunkErrorsData = chunkErrors.data();
+  forEachChunk( faceCount, [&]( int chunk, int begin, int end )
+  {
+    for ( int f = begin; f < end; ++f )
+    {
+      Error error = Error::NoError;
+      findNeighbors( f, error );
+      if ( error != Error::NoError )
+      {
+        chunkErrorsData[chunk] = f;
+        break;
+      }
+    }
+  } );
+
+  for ( int errorFace : std::as_const( chunkErrors ) )
+  {
+    if ( errorFace != -1 )
+    {
+      mError = Error::ManifoldFace;
+      mErrorElement = errorFace;
+      return;
+    }
+  }
+
+  mBoundaryEdgeCounts.fill( 0, vertexCount );
+  for ( int f = 0; f < faceCount; ++f )
+  {
+    const int start = mFaceStarts.at( f );
+    const int size = mFaceStarts.at( f + 1 ) - start;
+    for ( int k = 0; k < size; ++k )
+    {
+      if ( mNeighbors.at( start + k ) != -1 )
+        continue;
+      mBoundaryEdgeCounts[ccwVertex( f, k )]++;
+      mBoundaryEdgeCounts[ccwVertex( f, ( k + 1 ) % size )]++;
+    }
+  }
+
+  // more than two boundary edges means that several parts of the mesh share only this vertex
+  for ( int v = 0; v < vertexCount; ++v )
+  {
+    if ( mBoundaryEdgeCounts.at( v ) > 2 )
+    {
+      mError = Error::UniqueSharedVertex;
+      mErrorElement = v;
+      return;
+    }
+  }
+}
+
+void ReosMeshQualityKernel::findNeighbors( int face, Error &error )
+{
+  if ( mOrientations.at( face ) == 0 )
+    return;
+
+  const int start = mFaceStarts.at( face );
+  const int size = mFaceStarts.at( face + 1 ) - start;
+  for ( int k = 0; k < size; ++k )
+  {
+    const int v1 = ccwVertex( face, k );
+    const int v2 = ccwVertex( face, ( k + 1 ) % size );
+    int neighbor = -1;
+    for ( int i = mVertexFaceStarts.at( v1 ); i < mVertexFaceStarts.at( v1 + 1 ); ++i )
+    {
+      const int other = mVertexFaces.at( i );
+      if ( other == face )
+        continue;
+
+      const int otherSize = mFaceStarts.at( other + 1 ) - mFaceStarts.at( other );
+      for ( int j = 0; j < otherSize; ++j )
+      {
+        if ( ccwVertex( other, j ) != v1 )
+          continue;
+
+        // two faces counter clockwise oriented share an edge in opposite directions, more than two faces can't share an edge
+        if ( ccwVertex( other, ( j + otherSize - 1 ) % otherSize ) == v2 )
+        {
+          if ( neighbor != -1 )
+          {
+            error = Error::ManifoldFace;
+            return;
+          }
+          neighbor = other;
+        }
+        else if ( ccwVertex( other, ( j + 1 ) % otherSize ) == v2 )
+        {
+          error = Error::ManifoldFace;
+          return;
+        }
+        break;
+      }
+    }
+
+    mNeighbors[start + k] = neighbor;
+  }
+}
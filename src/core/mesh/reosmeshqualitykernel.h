@@ -0,0 +1,178 @@
+/***************************************************************************
+  reosmeshqualitykernel.h - ReosMeshQualityKernel
+
+ ---------------------
+ begin                : 25.5.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef REOSMESHQUALITYKERNEL_H
+#define REOSMESHQUALITYKERNEL_H
+
+#include <QVector>
+#include <QPair>
+
+#include "reoscore.h"
+#include "reosmesh.h"
+
+/**
+ * Class that calculates the quality criteria of a mesh directly from the arrays of vertices and faces.
+ *
+ * The vertices are given by three arrays of coordinates, the vertex indexes of all the faces are stored one after the other,
+ * the face i being defined by the indexes faceStarts[i] to faceStarts[i+1]-1. Faces without vertex are considered as removed and are ignored.
+ *
+ * For each face, the area, the minimum and maximum angles and the aspect ratio are stored. The calculation is made in parallel
+ * by chunks of faces, without any heap allocation by face. The whole mesh is given on each update, but only the metrics
+ * of the faces whose vertex indexes or vertex positions have changed since the last update are calculated again, the other values are kept.
+ * The topology (neighbors of faces, connection count of vertices) is not maintained face by face: it is kept if the faces and their
+ * orientation have not changed, for example if vertices are only moved, otherwise it is entirely rebuilt in linear time.
+ *
+ * Lengths and areas are calculated in the plane of the coordinates and converted in meters and square meters with the unit factors.
+ */
+class REOSCORE_EXPORT ReosMeshQualityKernel
+{
+  public:
+    enum class Error
+    {
+      NoError,
+      InvalidFace,
+      TooManyVerticesInFace,
+      FlatFace,
+      UniqueSharedVertex,
+      InvalidVertex,
+      ManifoldFace
+    };
+
+    //! Thresholds of the quality checks, areas in square meters, angles in degrees
+    struct Thresholds
+    {
+      double minimumAngle = 0;
+      double maximumAngle = 180;
+      int connectionCount = 0;
+      int connectionCountBoundary = 0;
+      double maximumSlope = 0;
+      double minimumArea = 0;
+      double maximumArea = 0;
+      double maximumAreaChange = 0;
+    };
+
+    //! Results of the quality checks, the indexes of the faces, vertices and edges that do not satisfy the checks, in order of the faces or the vertices
+    struct Results
+    {
+      QVector<int> minimumAngle;
+      QVector<int> maximumAngle;
+      QVector<int> connectionCount;
+      QVector<int> connectionCountBoundary;
+      QVector<QPair<int, int>> maximumSlope;
+      QVector<int> minimumArea;
+      QVector<int> maximumArea;
+      QVector<int> maximumAreaChange;
+    };
+
+    //! Constructor with the maximum count of vertices by face
+    ReosMeshQualityKernel( int maximumVerticesPerFace = 3 );
+
+    //! Sets the factors to convert the lengths and the areas of the coordinates in meters and square meters, all the faces will be calculated again on next update
+    void setUnitFactors( double lengthFactor, double areaFactor );
+
+    /**
+     * Updates the mesh with the coordinates of the vertices and the faces, see class description.
+     * Returns the count of faces whose metrics have been calculated again.
+     */
+    int update( const QVector<double> &verticesX,
+                const QVector<double> &verticesY,
+                const QVector<double> &verticesZ,
+                const QVector<int> &faces,
+                const QVector<int> &faceStarts );
+
+    //! Returns whether the topology has been rebuilt during the last update
+    bool topologyRebuilt() const;
+
+    //! Returns the error of the mesh found during the last update
+    Error error() const;
+
+    //! Returns the index of the vertex related to the error for UniqueSharedVertex, the index of the face related to the error otherwise
+    int errorElement() const;
+
+    //! Returns the count of vertices
+    int vertexCount() const;
+
+    //! Returns the count of faces
+    int faceCount() const;
+
+    //! Returns the indexes of the vertices of the face at position \a face in counter clockwise order
+    QVector<int> face( int face ) const;
+
+    //! Returns the area in square meters of the face at position \a face
+    double area( int face ) const;
+
+    //! Returns the minimum angle in degrees of the face at position \a face
+    double minimumAngle( int face ) const;
+
+    //! Returns the maximum angle in degrees of the face at position \a face
+    double maximumAngle( int face ) const;
+
+    /**
+     * Returns the aspect ratio of the face at position \a face, that is the square of the longest edge divided by the area,
+     * normalized to be 1 for an equilateral triangle or a square.
+     */
+    double aspectRatio( int face ) const;
+
+    //! Returns the count of vertices linked by an edge to the vertex at position \a vertex
+    int connectionCount( int vertex ) const;
+
+    //! Returns whether the vertex at position \a vertex is on the boundary of the mesh
+    bool isVertexOnBoundary( int vertex ) const;
+
+    //! Returns the results of \a checks with \a thresholds, calculated in parallel from the stored values, empty if the mesh has an error
+    Results check( ReosMesh::QualityMeshChecks checks, const Thresholds &thresholds ) const;
+
+  private:
+    int mMaximumVerticesPerFace = 3;
+    double mLengthFactor = 1;
+    double mAreaFactor = 1;
+
+    QVector<double> mVerticesX;
+    QVector<double> mVerticesY;
+    QVector<double> mVerticesZ;
+    QVector<int> mFaces;
+    QVector<int> mFaceStarts;
+
+    // values by face, orientation is 1 for counter clockwise, -1 for clockwise and 0 for removed or invalid face
+    QVector<double> mAreas;
+    QVector<double> mMinimumAngles;
+    QVector<double> mMaximumAngles;
+    QVector<double> mAspectRatios;
+    QVector<char> mOrientations;
+    QVector<char> mFaceErrors;
+
+    // neighbor of each edge of the faces, stored as the faces, edge k of a face goes from its vertex k to its vertex k+1 in counter clockwise order
+    QVector<int> mNeighbors;
+
+    // faces of vertex i are mVertexFaces[mVertexFaceStarts[i]] to mVertexFaces[mVertexFaceStarts[i+1]-1]
+    QVector<int> mVertexFaceStarts;
+    QVector<int> mVertexFaces;
+    QVector<int> mBoundaryEdgeCounts;
+
+    bool mTopologyIsValid = false;
+    bool mTopologyRebuilt = false;
+
+    Error mError = Error::NoError;
+    int mErrorElement = -1;
+
+    //! Returns the vertex at position \a position in counter clockwise order of the face \a face
+    int ccwVertex( int face, int position ) const;
+
+    void calculateFace( int face );
+    void buildTopology();
+    void findNeighbors( int face, Error &error );
+};
+
+#endif // REOSMESHQUALITYKERNEL_H
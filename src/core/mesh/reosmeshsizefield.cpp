@@ -0,0 +1,240 @@
+/***************************************************************************
+  reosmeshsizefield.cpp - ReosMeshSizeField
+
+ ---------------------
+ begin                : 25.4.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "reosmeshsizefield.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "reosmeshgenerator.h"
+#include "reospolygonstructure.h"
+#include "reosparameter.h"
+
+// Sets the size in the cell if it is smaller than the current one, NaN is no value
+static void setMinimum( QVector<double> &cellValues, int index, double size )
+{
+  if ( !( cellValues.at( index ) <= size ) )
+    cellValues[index] = size;
+}
+
+ReosMeshSizeField::ReosMeshSizeField( const QList<Polygon> &polygons, const QRectF &extent, double cellSize, double defaultSize )
+{
+  if ( !( cellSize > 0 ) )
+    return;
+
+  mXOrigin = extent.left();
+  mYOrigin = extent.top();
+  mCellSize = cellSize;
+  mColumnCount = std::max( 1, static_cast<int>( std::ceil( extent.width() / cellSize ) ) );
+  mRowCount = std::max( 1, static_cast<int>( std::ceil( extent.height() / cellSize ) ) );
+
+  const int cellCount = mColumnCount * mRowCount;
+  QVector<double> cellValues( cellCount, std::numeric_limits<double>::quiet_NaN() );
+
+  for ( const Polygon &polygon : polygons )
+  {
+    if ( polygon.size > 0 )
+      rasterizePolygon( polygon.rings, polygon.size, cellValues );
+  }
+
+  mValues.resize( cellCount );
+  mBoundaryValues.resize( cellCount );
+  for ( int r = 0; r < mRowCount; ++r )
+  {
+    for ( int c = 0; c < mColumnCount; ++c )
+    {
+      const int index = r * mColumnCount + c;
+      const double cellValue = cellValues.at( index );
+      mValues[index] = std::isnan( cellValue ) ? defaultSize : cellValue;
+
+      double boundaryValue = std::numeric_limits<double>::quiet_NaN();
+      for ( int nr = std::max( 0, r - 1 ); nr <= std::min( mRowCount - 1, r + 1 ); ++nr )
+      {
+        for ( int nc = std::max( 0, c - 1 ); nc <= std::min( mColumnCount - 1, c + 1 ); ++nc )
+        {
+          const double neighborValue = cellValues.at( nr * mColumnCount + nc );
+          if ( !std::isnan( neighborValue ) && !( neighborValue >= boundaryValue ) )
+            boundaryValue = neighborValue;
+        }
+      }
+      mBoundaryValues[index] = std::isnan( boundaryValue ) ? defaultSize : boundaryValue;
+    }
+  }
+}
+
+void ReosMeshSizeField::rasterizePolygon( const QList<QPolygonF> &rings, double size, QVector<double> &cellValues ) const
+{
+  // A cell overlaps the polygon if its center is inside the polygon or if the boundary of the polygon crosses the interior of the cell.
+
+  // 1. Cells with the center inside, with a scan line on the center of each row, even-odd rule to take account of the holes
+  QRectF boundingRect;
+  for ( const QPolygonF &ring : rings )
+    boundingRect = boundingRect.united( ring.boundingRect() );
+
+  const int firstRow = std::max( 0, static_cast<int>( std::floor( ( boundingRect.top() - mYOrigin ) / mCellSize ) ) );
+  const int lastRow = std::min( mRowCount - 1, static_cast<int>( std::floor( ( boundingRect.bottom() - mYOrigin ) / mCellSize ) ) );
+  QVector<double> crossings;
+  for ( int r = firstRow; r <= lastRow; ++r )
+  {
+    const double y = mYOrigin + ( r + 0.5 ) * mCellSize;
+    crossings.clear();
+    for ( const QPolygonF &ring : rings )
+    {
+      for ( int i = 0; i < ring.count(); ++i )
+      {
+        const QPointF &p1 = ring.at( i );
+        const QPointF &p2 = ring.at( ( i + 1 ) % ring.count() );
+        if ( ( p1.y() <= y ) != ( p2.y() <= y ) )
+          crossings.append( p1.x() + ( y - p1.y() ) * ( p2.x() - p1.x() ) / ( p2.y() - p1.y() ) );
+      }
+    }
+    std::sort( crossings.begin(), crossings.end() );
+
+    for ( int i = 0; i + 1 < crossings.count(); i += 2 )
+    {
+      // columns with the center in [crossings[i], crossings[i+1][
+      const int firstColumn = std::max( 0, static_cast<int>( std::ceil( ( crossings.at( i ) - mXOrigin ) / mCellSize - 0.5 ) ) );
+      const int lastColumn = std::min( mColumnCount - 1, static_cast<int>( std::ceil( ( crossings.at( i + 1 ) - mXOrigin ) / mCellSize - 0.5 ) ) - 1 );
+      for ( int c = firstColumn; c <= lastColumn; ++c )
+        setMinimum( cellValues, r * mColumnCount + c, size );
+    }
+  }
+
+  // 2. Cells crossed by the boundary, each segment is cut by the lines of the grid and the middle of each part gives a crossed cell
+  QVector<double> cuts;
+  for ( const QPolygonF &ring : rings )
+  {
+    for ( int i = 0; i < ring.count(); ++i )
+    {
+      const QPointF &p1 = ring.at( i );
+      const QPointF &p2 = ring.at( ( i + 1 ) % ring.count() );
+      const double dx = p2.x() - p1.x();
+      const double dy = p2.y() - p1.y();
+
+      cuts.clear();
+      cuts << 0.0 << 1.0;
+      const double x1 = ( p1.x() - mXOrigin ) / mCellSize;
+      const double x2 = ( p2.x() - mXOrigin ) / mCellSize;
+      for ( double k = std::ceil( std::min( x1, x2 ) ); k < std::max( x1, x2 ); ++k )
+        cuts.append( ( k - x1 ) / ( x2 - x1 ) );
+      const double y1 = ( p1.y() - mYOrigin ) / mCellSize;
+      const double y2 = ( p2.y() - mYOrigin ) / mCellSize;
+      for ( double k = std::ceil( std::min( y1, y2 ) ); k < std::max( y1, y2 ); ++k )
+        cuts.append( ( k - y1 ) / ( y2 - y1 ) );
+      std::sort( cuts.begin(), cuts.end() );
+
+      for ( int j = 0; j + 1 < cuts.count(); ++j )
+      {
+        if ( !( cuts.at( j + 1 ) > cuts.at( j ) ) )
+          continue;
+
+        const double t = ( cuts.at( j ) + cuts.at( j + 1 ) ) / 2;
+        const double fColumn = x1 + t * ( x2 - x1 );
+        const double fRow = y1 + t * ( y2 - y1 );
+
+        // a part lying on a line of the grid does not cross the interior of the cells
+        if ( ( dx == 0 && fColumn == std::floor( fColumn ) ) || ( dy == 0 && fRow == std::floor( fRow ) ) )
+          continue;
+
+        const int column = static_cast<int>( std::floor( fColumn ) );
+        const int row = static_cast<int>( std::floor( fRow ) );
+        if ( column >= 0 && column < mColumnCount && row >= 0 && row < mRowCount )
+          setMinimum( cellValues, row * mColumnCount + column, size );
+      }
+    }
+  }
+}
+
+ReosMeshSizeField ReosMeshSizeField::create( const ReosMeshResolutionController *controller, const QRectF &extent, const QString &destinationCrs )
+{
+  if ( !controller )
+    return ReosMeshSizeField();
+
+  const double defaultSize = controller->defaultSize()->value();
+  ReosPolygonStructure *polygonStructure = controller->resolutionPolygons();
+
+  double minSize = std::numeric_limits<double>::max();
+  QList<Polygon> polygons;
+  if ( polygonStructure && polygonStructure->polygonsCount() > 0 )
+  {
+    const QStringList classes = polygonStructure->classes();
+    for ( const QString &classId : classes )
+    {
+      const double size = polygonStructure->value( classId );
+      if ( !( size > 0 ) )
+        continue;
+
+      const QList<QList<QPolygonF>> classPolygons = polygonStructure->polygons( classId, destinationCrs );
+      for ( const QList<QPolygonF> &rings : classPolygons )
+        polygons.append( {rings, size} );
+
+      if ( !classPolygons.isEmpty() && size < minSize )
+        minSize = size;
+    }
+  }
+
+  if ( polygons.isEmpty() )
+    return ReosMeshSizeField( QList<Polygon>(), extent, std::max( extent.width(), extent.height() ) + 1, defaultSize );
+
+  // The cells are smaller than the elements, but their count is limited for large domains.
+  // As the polygons are rasterized by coverage, a polygon smaller than the enlarged cells still refines the cells it overlaps.
+  double cellSize = minSize / 2;
+  auto cellCount = [&extent]( double size )
+  {
+    return ( std::ceil( extent.width() / size ) + 2 ) * ( std::ceil( extent.height() / size ) + 2 );
+  };
+  while ( cellCount( cellSize ) > MAX_CELL_COUNT )
+    cellSize *= 1.25;
+
+  // a margin of one cell to take the polygons close to the boundary of the domain
+  const QRectF fieldExtent = extent.adjusted( -cellSize, -cellSize, cellSize, cellSize );
+
+  return ReosMeshSizeField( polygons, fieldExtent, cellSize, defaultSize );
+}
+
+bool ReosMeshSizeField::isValid() const
+{
+  return !mValues.isEmpty();
+}
+
+double ReosMeshSizeField::value( double x, double y, bool onBoundary ) const
+{
+  if ( mValues.isEmpty() || !std::isfinite( x ) || !std::isfinite( y ) )
+    return std::numeric_limits<double>::quiet_NaN();
+
+  const double fColumn = std::floor( ( x - mXOrigin ) / mCellSize );
+  const double fRow = std::floor( ( y - mYOrigin ) / mCellSize );
+  const int column = static_cast<int>( std::min( double( mColumnCount - 1 ), std::max( 0.0, fColumn ) ) );
+  const int row = static_cast<int>( std::min( double( mRowCount - 1 ), std::max( 0.0, fRow ) ) );
+
+  const int index = row * mColumnCount + column;
+  return onBoundary ? mBoundaryValues.at( index ) : mValues.at( index );
+}
+
+int ReosMeshSizeField::columnCount() const
+{
+  return mColumnCount;
+}
+
+int ReosMeshSizeField::rowCount() const
+{
+  return mRowCount;
+}
+
+double ReosMeshSizeField::cellSize() const
+{
+  return mCellSize;
+}
@@ -0,0 +1,100 @@
+/***************************************************************************
+  reosmeshsizefield.h - ReosMeshSizeField
+
+ ---------------------
+ begin                : 25.4.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef REOSMESHSIZEFIELD_H
+#define REOSMESHSIZEFIELD_H
+
+#include <QList>
+#include <QPolygonF>
+#include <QRectF>
+#include <QVector>
+
+#include "reoscore.h"
+
+class ReosMeshResolutionController;
+
+/**
+ * Class that stores the size of the mesh elements on a regular grid, used as background field by mesh generators.
+ *
+ * The grid is built once from the polygons of a resolution controller, then the size at any position
+ * is returned in constant time without any geometry operation. As the field is not modified after creation,
+ * it can be queried concurrently from several threads.
+ *
+ * The polygons are rasterized by coverage: each cell takes the smallest size of the polygons overlapping it,
+ * so polygons smaller than a cell are not lost when the cells are enlarged to limit their count.
+ * Two values are stored for each cell: the size of the cell and the minimum size of the cell
+ * and its neighbors. The second one is used for positions on boundaries, that take the size of the polygons close to them.
+ */
+class REOSCORE_EXPORT ReosMeshSizeField
+{
+  public:
+    //! A polygon with its rings, the first one is the exterior ring and the following ones are the holes, and the size inside
+    struct Polygon
+    {
+      QList<QPolygonF> rings;
+      double size = 0;
+    };
+
+    //! Constructs an invalid field, that returns always NaN
+    ReosMeshSizeField() = default;
+
+    /**
+     * Constructs a field covering \a extent with square cells of size \a cellSize. The size in each cell is the smallest size
+     * of the \a polygons overlapping the cell, or is \a defaultSize where there is no polygon.
+     */
+    ReosMeshSizeField( const QList<Polygon> &polygons, const QRectF &extent, double cellSize, double defaultSize );
+
+    /**
+     * Creates a field from the \a controller that covers \a extent expressed in \a destinationCrs.
+     * The size of the cells is half of the smallest size of the resolution polygons, but the count of cells is limited.
+     * If the controller does not contain any polygon, the field has only one cell with the default size.
+     */
+    static ReosMeshSizeField create( const ReosMeshResolutionController *controller, const QRectF &extent, const QString &destinationCrs );
+
+    //! Returns whether the field is valid
+    bool isValid() const;
+
+    /**
+     * Returns the size at position ( \a x, \a y ). If \a onBoundary is true, returns the smallest size around the position.
+     * Positions outside the extent take the size of the closest cell.
+     */
+    double value( double x, double y, bool onBoundary = false ) const;
+
+    //! Returns the count of columns of the grid
+    int columnCount() const;
+
+    //! Returns the count of rows of the grid
+    int rowCount() const;
+
+    //! Returns the size of the cells of the grid
+    double cellSize() const;
+
+    //! Maximum count of cells of a field created from a resolution controller
+    static const int MAX_CELL_COUNT = 1 << 20;
+
+  private:
+    double mXOrigin = 0;
+    double mYOrigin = 0;
+    double mCellSize = 0;
+    int mColumnCount = 0;
+    int mRowCount = 0;
+    QVector<double> mValues;
+    QVector<double> mBoundaryValues;
+
+    //! Sets the \a size in \a cellValues for the cells overlapped by the polygon with \a rings, if it is smaller than the current one
+    void rasterizePolygon( const QList<QPolygonF> &rings, double size, QVector<double> &cellValues ) const;
+};
+
+#endif // REOSMESHSIZEFIELD_H
@@ -0,0 +1,376 @@
+/***************************************************************************
+  reosgriddedrainfall.cpp - ReosGriddedRainfall
+
+ ---------------------
+ begin                : 23.5.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "reosgriddedrainfall.h"
+#include "reoscoordinatetransform.h"
+
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include <QtConcurrent>
+
+ReosGriddedRainfall::ReosGriddedRainfall( QObject *parent )
+  : ReosDataObject( parent )
+{}
+
+ReosGriddedRainfall::ReosGriddedRainfall( const ReosRasterExtent &extent, const QDateTime &referenceTime, const ReosDuration &timeStep, QObject *parent )
+  : ReosDataObject( parent )
+  , mExtent( extent )
+  , mReferenceTime( referenceTime )
+  , mTimeStep( timeStep )
+{}
+
+ReosRasterExtent ReosGriddedRainfall::extent() const
+{
+  return mExtent;
+}
+
+QString ReosGriddedRainfall::crs() const
+{
+  return mCrs;
+}
+
+void ReosGriddedRainfall::setCrs( const QString &crs )
+{
+  mCrs = crs;
+}
+
+QDateTime ReosGriddedRainfall::referenceTime() const
+{
+  return mReferenceTime;
+}
+
+ReosDuration ReosGriddedRainfall::timeStep() const
+{
+  return mTimeStep;
+}
+
+int ReosGriddedRainfall::cellCount() const
+{
+  if ( !mExtent.isValid() )
+    return 0;
+
+  return mExtent.xCellCount() * mExtent.yCellCount();
+}
+
+int ReosGriddedRainfall::frameCount() const
+{
+  const int count = cellCount();
+  if ( count == 0 )
+    return 0;
+
+  return mValues.count() / count;
+}
+
+bool ReosGriddedRainfall::appendFrame( const QVector<double> &values )
+{
+  if ( values.isEmpty() || values.count() != cellCount() )
+    return false;
+
+  mValues.append( values );
+  emit dataChanged();
+  return true;
+}
+
+const double *ReosGriddedRainfall::frame( int i ) const
+{
+  if ( i < 0 || i >= frameCount() )
+    return nullptr;
+
+  return mValues.constData() + qint64( i ) * cellCount();
+}
+
+void ReosGriddedRainfall::clearFrames()
+{
+  mValues.clear();
+  emit dataChanged();
+}
+
+ReosEncodedElement ReosGriddedRainfall::encode() const
+{
+  ReosEncodedElement element( QStringLiteral( "gridded-rainfall" ) );
+  ReosDataObject::encode( element );
+
+  element.addEncodedData( QStringLiteral( "extent" ), mExtent.encode() );
+  element.addData( QStringLiteral( "crs" ), mCrs );
+  element.addData( QStringLiteral( "reference-time" ), mReferenceTime );
+  element.addEncodedData( QStringLiteral( "time-step" ), mTimeStep.encode() );
+  element.addData( QStringLiteral( "values" ), mValues );
+
+  return element;
+}
+
+ReosGriddedRainfall *ReosGriddedRainfall::decode( const ReosEncodedElement &element, QObject *parent )
+{
+  if ( element.description() != QStringLiteral( "gridded-rainfall" ) )
+    return nullptr;
+
+  std::unique_ptr<ReosGriddedRainfall> rainfall = std::make_unique<ReosGriddedRainfall>( parent );
+  rainfall->ReosDataObject::decode( element );
+  rainfall->mExtent = ReosRasterExtent::decode( element.getEncodedData( QStringLiteral( "extent" ) ) );
+  element.getData( QStringLiteral( "crs" ), rainfall->mCrs );
+  element.getData( QStringLiteral( "reference-time" ), rainfall->mReferenceTime );
+  rainfall->mTimeStep = ReosDuration::decode( element.getEncodedData( QStringLiteral( "time-step" ) ) );
+  element.getData( QStringLiteral( "values" ), rainfall->mValues );
+
+  const int cellCount = rainfall->cellCount();
+  if ( cellCount == 0 )
+    rainfall->mValues.clear();
+  else
+    rainfall->mValues.resize( rainfall->mValues.count() - rainfall->mValues.count() % cellCount );
+
+  return rainfall.release();
+}
+
+// Returns the part of the polygon where the coordinate of the points along the axis ( x if \a alongX, y otherwise ) is
+// greater ( if \a keepGreater ) or lower than \a limit, the polygon can be concave, in this case the result can have degenerated edges
+// but its area is the one of the clipped polygon
+static QPolygonF clipPolygon( const QPolygonF &polygon, bool alongX, double limit, bool keepGreater )
+{
+  QPolygonF result;
+  const int count = polygon.count();
+  if ( count == 0 )
+    return result;
+
+  result.reserve( count + 4 );
+
+  auto coordinate = [alongX]( const QPointF & pt )
+  {
+    return alongX ? pt.x() : pt.y();
+  };
+
+  auto isInside = [&]( const QPointF & pt )
+  {
+    return keepGreater ? coordinate( pt ) >= limit : coordinate( pt ) <= limit;
+  };
+
+  QPointF previous = polygon.last();
+  bool previousInside = isInside( previous );
+  for ( int i = 0; i < count; ++i )
+  {
+    const QPointF &current = polygon.at( i );
+    const bool currentInside = isInside( current );
+    if ( currentInside != previousInside )
+    {
+      const double t = ( limit - coordinate( previous ) ) / ( coordinate( current ) - coordinate( previous ) );
+      result.append( previous + ( current - previous ) * t );
+    }
+    if ( currentInside )
+      result.append( current );
+
+    previous = current;
+    previousInside = currentInside;
+  }
+
+  return result;
+}
+
+static double polygonArea( const QPolygonF &polygon )
+{
+  double area = 0;
+  const int count = polygon.count();
+  for ( int i = 0; i < count; ++i )
+  {
+    const QPointF &p1 = polygon.at( i );
+    const QPointF &p2 = polygon.at( ( i + 1 ) % count );
+    area += p1.x() * p2.y() - p2.x() * p1.y();
+  }
+
+  return std::fabs( area ) / 2;
+}
+
+struct PolygonCellsCoverage
+{
+  QVector<int> cells;
+  QVector<double> areas;
+  double polygonArea = 0;
+};
+
+static PolygonCellsCoverage cellsCoverage( const ReosRasterExtent &extent, const QPolygonF &polygon )
+{
+  PolygonCellsCoverage coverage;
+  coverage.polygonArea = polygonArea( polygon );
+  if ( coverage.polygonArea <= 0 )
+    return coverage;
+
+  const QRectF bbox = polygon.boundingRect();
+  const double xOrigin = extent.xMapOrigin();
+  const double yOrigin = extent.yMapOrigin();
+  const double xCellSize = extent.xCellSize();
+  const double yCellSize = extent.yCellSize();
+
+  // range of the cells intersecting the bounding box of the polygon, cell sizes can be negative
+  auto cellRange = []( double min, double max, double origin, double cellSize, int cellCount )
+  {
+    const double i1 = ( min - origin ) / cellSize;
+    const double i2 = ( max - origin ) / cellSize;
+    const int first = static_cast<int>( std::max( 0.0, std::floor( std::min( i1, i2 ) ) ) );
+    const int last = static_cast<int>( std::min( cellCount - 1.0, std::floor( std::max( i1, i2 ) ) ) );
+    return QPair<int, int>( first, last );
+  };
+
+  const QPair<int, int> rows = cellRange( bbox.top(), bbox.bottom(), yOrigin, yCellSize, extent.yCellCount() );
+  const QPair<int, int> columns = cellRange( bbox.left(), bbox.right(), xOrigin, xCellSize, extent.xCellCount() );
+
+  for ( int row = rows.first; row <= rows.second; ++row )
+  {
+    // the polygon is clipped by the band of the row first, then the band polygon is clipped by each cell
+    const double y1 = yOrigin + yCellSize * row;
+    const double y2 = yOrigin + yCellSize * ( row + 1 );
+    const QPolygonF band = clipPolygon( clipPolygon( polygon, false, std::min( y1, y2 ), true ), false, std::max( y1, y2 ), false );
+    if ( band.count() < 3 )
+      continue;
+
+    const QRectF bandBox = band.boundingRect();
+    const QPair<int, int> bandColumns = cellRange( bandBox.left(), bandBox.right(), xOrigin, xCellSize, extent.xCellCount() );
+    for ( int column = std::max( bandColumns.first, columns.first ); column <= std::min( bandColumns.second, columns.second ); ++column )
+    {
+      const double x1 = xOrigin + xCellSize * column;
+      const double x2 = xOrigin + xCellSize * ( column + 1 );
+      const QPolygonF cellPart = clipPolygon( clipPolygon( band, true, std::min( x1, x2 ), true ), true, std::max( x1, x2 ), false );
+      if ( cellPart.count() < 3 )
+        continue;
+
+      const double area = polygonArea( cellPart );
+      if ( area > 0 )
+      {
+        coverage.cells.append( row * extent.xCellCount() + column );
+        coverage.areas.append( area );
+      }
+    }
+  }
+
+  return coverage;
+}
+
+ReosGriddedRainfallWeights ReosGriddedRainfallWeights::calculate( const ReosRasterExtent &extent, const QList<QPolygonF> &polygons,
+    const QString &extentCrs, const QString &polygonsCrs )
+{
+  ReosGriddedRainfallWeights weights;
+  weights.mExtent = extent;
+  weights.mRowStarts.append( 0 );
+
+  if ( !extent.isValid() )
+    return weights;
+
+  // polygons are transformed before the parallel calculation, the transform is not shared between threads
+  QList<QPolygonF> gridPolygons = polygons;
+  if ( !extentCrs.isEmpty() && !polygonsCrs.isEmpty() && extentCrs != polygonsCrs )
+  {
+    const ReosCoordinateTransform transform( polygonsCrs, extentCrs );
+    for ( QPolygonF &polygon : gridPolygons )
+      polygon = transform.transform( polygon );
+  }
+
+  QVector<PolygonCellsCoverage> coverages( gridPolygons.count() );
+  QVector<int> indexes( gridPolygons.count() );
+  std::iota( indexes.begin(), indexes.end(), 0 );
+  QtConcurrent::blockingMap( indexes, [&]( int i )
+  {
+    coverages[i] = cellsCoverage( extent, gridPolygons.at( i ) );
+  } );
+
+  for ( const PolygonCellsCoverage &coverage : coverages )
+  {
+    const double coveredArea = std::accumulate( coverage.areas.constBegin(), coverage.areas.constEnd(), 0.0 );
+    weights.mCells.append( coverage.cells );
+    for ( double area : coverage.areas )
+      weights.mWeights.append( area / coveredArea );
+    weights.mRowStarts.append( weights.mCells.count() );
+    weights.mCoverages.append( coverage.polygonArea > 0 ? std::min( 1.0, coveredArea / coverage.polygonArea ) : 0.0 );
+  }
+
+  return weights;
+}
+
+ReosRasterExtent ReosGriddedRainfallWeights::extent() const
+{
+  return mExtent;
+}
+
+int ReosGriddedRainfallWeights::polygonCount() const
+{
+  return mCoverages.count();
+}
+
+int ReosGriddedRainfallWeights::weightCount() const
+{
+  return mCells.count();
+}
+
+double ReosGriddedRainfallWeights::coverage( int polygon ) const
+{
+  if ( polygon < 0 || polygon >= mCoverages.count() )
+    return 0;
+
+  return mCoverages.at( polygon );
+}
+
+ReosGriddedRainfallWeights ReosGriddedRainfallWeights::polygonWeights( int polygon ) const
+{
+  ReosGriddedRainfallWeights weights;
+  weights.mExtent = mExtent;
+  weights.mRowStarts.append( 0 );
+  if ( polygon < 0 || polygon >= mCoverages.count() )
+    return weights;
+
+  const int start = mRowStarts.at( polygon );
+  const int count = mRowStarts.at( polygon + 1 ) - start;
+  weights.mCells = mCells.mid( start, count );
+  weights.mWeights = mWeights.mid( start, count );
+  weights.mRowStarts.append( count );
+  weights.mCoverages.append( mCoverages.at( polygon ) );
+
+  return weights;
+}
+
+QVector<double> ReosGriddedRainfallWeights::arealAverages( const ReosGriddedRainfall *rainfall, int firstFrame ) const
+{
+  if ( !rainfall || rainfall->extent() != mExtent )
+    return QVector<double>();
+
+  firstFrame = std::max( 0, firstFrame );
+  const int frameCount = std::max( 0, rainfall->frameCount() - firstFrame );
+  const int polygonCount = mCoverages.count();
+  QVector<double> averages( polygonCount * qint64( frameCount ), 0.0 );
+  double *averagesData = averages.data();
+
+  QVector<int> frames( frameCount );
+  std::iota( frames.begin(), frames.end(), 0 );
+
+  // one sparse matrix-vector product by frame, each frame writes in its own column of the result
+  QtConcurrent::blockingMap( frames, [&]( int f )
+  {
+    const double *values = rainfall->frame( firstFrame + f );
+    for ( int p = 0; p < polygonCount; ++p )
+    {
+      double sum = 0;
+      double weightSum = 0;
+      for ( int i = mRowStarts.at( p ); i < mRowStarts.at( p + 1 ); ++i )
+      {
+        const double value = values[mCells.at( i )];
+        if ( std::isnan( value ) )
+          continue;
+        sum += mWeights.at( i ) * value;
+        weightSum += mWeights.at( i );
+      }
+
+      averagesData[qint64( p ) * frameCount + f] = weightSum > 0 ? sum / weightSum : std::numeric_limits<double>::quiet_NaN();
+    }
+  } );
+
+  return averages;
+}
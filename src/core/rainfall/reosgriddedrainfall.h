@@ -0,0 +1,144 @@
+/***************************************************************************
+  reosgriddedrainfall.h - ReosGriddedRainfall
+
+ ---------------------
+ begin                : 23.5.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef REOSGRIDDEDRAINFALL_H
+#define REOSGRIDDEDRAINFALL_H
+
+#include <QDateTime>
+#include <QPolygonF>
+#include <QVector>
+
+#include "reoscore.h"
+#include "reosdataobject.h"
+#include "reosduration.h"
+#include "reosmemoryraster.h"
+
+/**
+ * Class that represents a rainfall defined on a grid, for example coming from a radar, as a stack of rasters with a constant time step.
+ *
+ * Each frame contains the rainfall height in mm during the time step for each cell of the grid, row by row, no data being NaN.
+ * The frames are stored contiguously.
+ */
+class REOSCORE_EXPORT ReosGriddedRainfall : public ReosDataObject
+{
+    Q_OBJECT
+  public:
+    //! Constructor of an empty gridded rainfall
+    ReosGriddedRainfall( QObject *parent = nullptr );
+
+    //! Constructor of a gridded rainfall without frame defined on \a extent starting at \a referenceTime with \a timeStep
+    ReosGriddedRainfall( const ReosRasterExtent &extent, const QDateTime &referenceTime, const ReosDuration &timeStep, QObject *parent = nullptr );
+
+    QString type() const override {return staticType();}
+    static QString staticType() {return ReosDataObject::staticType() + ':' + QStringLiteral( "gridded-rainfall" );}
+
+    //! Returns the extent of the grid
+    ReosRasterExtent extent() const;
+
+    //! Returns the coordinate reference system of the grid, as a WKT string, empty if not defined
+    QString crs() const;
+
+    //! Sets the coordinate reference system of the grid, as a WKT string, like the extent, it has to be set before the rainfall is used
+    void setCrs( const QString &crs );
+
+    //! Returns the time of the beginning of the first frame
+    QDateTime referenceTime() const;
+
+    //! Returns the time step between two frames
+    ReosDuration timeStep() const;
+
+    //! Returns the count of cells of each frame
+    int cellCount() const;
+
+    //! Returns the count of frames
+    int frameCount() const;
+
+    /**
+     * Appends a frame with \a values of the cells row by row, returns false if the count of values
+     * is not the count of cells of the grid.
+     */
+    bool appendFrame( const QVector<double> &values );
+
+    //! Returns a pointer to the cellCount() values of the frame at position \a i, nullptr if the frame does not exist
+    const double *frame( int i ) const;
+
+    //! Removes all the frames
+    void clearFrames();
+
+    ReosEncodedElement encode() const;
+
+    //! Creates a new instance from the encoded \a element, returns nullptr if \a element is not a gridded rainfall
+    static ReosGriddedRainfall *decode( const ReosEncodedElement &element, QObject *parent = nullptr );
+
+  private:
+    ReosRasterExtent mExtent;
+    QString mCrs;
+    QDateTime mReferenceTime;
+    ReosDuration mTimeStep;
+    QVector<double> mValues;
+};
+
+/**
+ * Class that contains the areal weights of the cells of a grid for several polygons, for example the watersheds.
+ *
+ * The weight of a cell for a polygon is the area of the cell inside the polygon divided by the area of the polygon inside the grid.
+ * The weights are stored as a sparse matrix, row by row (compressed sparse row), one row by polygon.
+ * Once calculated, the areal averages of all the frames of a gridded rainfall for all the polygons are obtained with a sparse matrix-vector product by frame.
+ */
+class REOSCORE_EXPORT ReosGriddedRainfallWeights
+{
+  public:
+    //! Constructor of empty weights
+    ReosGriddedRainfallWeights() = default;
+
+    /**
+     * Calculates the weights of the cells of the grid with \a extent for each polygon of \a polygons.
+     * If \a extentCrs and \a polygonsCrs are both defined and different, the polygons are transformed in the grid CRS first.
+     */
+    static ReosGriddedRainfallWeights calculate( const ReosRasterExtent &extent, const QList<QPolygonF> &polygons,
+        const QString &extentCrs = QString(), const QString &polygonsCrs = QString() );
+
+    //! Returns the extent of the grid the weights are calculated for
+    ReosRasterExtent extent() const;
+
+    //! Returns the count of polygons
+    int polygonCount() const;
+
+    //! Returns the count of cells with a not null weight for all the polygons
+    int weightCount() const;
+
+    //! Returns the part of the area of the polygon at position \a polygon covered by the grid, between 0 and 1
+    double coverage( int polygon ) const;
+
+    //! Returns the weights of the polygon at position \a polygon only
+    ReosGriddedRainfallWeights polygonWeights( int polygon ) const;
+
+    /**
+     * Returns the areal averages of the frames of \a rainfall from \a firstFrame for each polygon, row by row with
+     * frameCount() - \a firstFrame values for each polygon.
+     * Cells with no data are ignored, the average is NaN if the polygon does not cover any cell with data.
+     * Returns an empty array if \a rainfall is not defined on the same grid.
+     */
+    QVector<double> arealAverages( const ReosGriddedRainfall *rainfall, int firstFrame = 0 ) const;
+
+  private:
+    ReosRasterExtent mExtent;
+    QVector<int> mRowStarts;
+    QVector<int> mCells;
+    QVector<double> mWeights;
+    QVector<double> mCoverages;
+};
+
+#endif // REOSGRIDDEDRAINFALL_H
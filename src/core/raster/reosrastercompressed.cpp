@@ -15,6 +15,10 @@ email                : vcloarec@gmail.com
 
 #include "reosrastercompressed.h"
 
+#include <cstring>
+#include <numeric>
+#include <QtConcurrent>
+
 
 ReosRasterByteCompressed::ReosRasterByteCompressed( const ReosRasterMemory<unsigned char> &raster ):
   mRowCount( raster.rowCount() ), mColumnCount( raster.columnCount() )
@@ -137,3 +141,283 @@ bool ReosRasterByteCompressed::operator!=( const ReosRasterByteCompressed &other
 {
   return !operator==( other );
 }
+
+
+// First byte of a tile, tells how the run-length encoded data are stored
+static const char TILE_RLE = 0;
+static const char TILE_DEFLATE = 1;
+
+static void appendVarInt( QByteArray &data, quint32 value )
+{
+  while ( value >= 0x80 )
+  {
+    data.append( static_cast<char>( ( value & 0x7F ) | 0x80 ) );
+    value >>= 7;
+  }
+  data.append( static_cast<char>( value ) );
+}
+
+// Reads a variable length integer from \a data and moves it after the integer, returns false if \a end is reached before the end of the integer
+static bool readVarInt( const unsigned char *&data, const unsigned char *end, quint32 &value )
+{
+  value = 0;
+  int shift = 0;
+  while ( data < end && shift < 32 )
+  {
+    const unsigned char byte = *data++;
+    value |= static_cast<quint32>( byte & 0x7F ) << shift;
+    if ( ( byte & 0x80 ) == 0 )
+      return true;
+    shift += 7;
+  }
+  return false;
+}
+
+// Returns the run-length encoded \a values, each run is the value followed by the count of values
+static QByteArray runLengthEncode( const unsigned char *values, int count )
+{
+  QByteArray ret;
+  int i = 0;
+  while ( i < count )
+  {
+    const unsigned char value = values[i];
+    int runEnd = i + 1;
+    while ( runEnd < count && values[runEnd] == value )
+      runEnd++;
+    ret.append( static_cast<char>( value ) );
+    appendVarInt( ret, static_cast<quint32>( runEnd - i ) );
+    i = runEnd;
+  }
+
+  return ret;
+}
+
+static bool runLengthDecode( const unsigned char *data, const unsigned char *end, unsigned char *values, int count )
+{
+  int i = 0;
+  while ( data < end )
+  {
+    const unsigned char value = *data++;
+    quint32 runLength = 0;
+    if ( !readVarInt( data, end, runLength ) || runLength > static_cast<quint32>( count - i ) )
+      return false;
+    std::memset( values + i, value, runLength );
+    i += static_cast<int>( runLength );
+  }
+
+  return i == count;
+}
+
+ReosRasterByteTiledCompressed::ReosRasterByteTiledCompressed( const ReosRasterMemory<unsigned char> &raster ):
+  mRowCount( raster.rowCount() ), mColumnCount( raster.columnCount() )
+{
+  const int tileCount = tileRowCount() * tileColumnCount();
+  QVector<QByteArray> tiles( tileCount );
+  QByteArray *tilesData = tiles.data();
+  QVector<int> tileIndexes( tileCount );
+  std::iota( tileIndexes.begin(), tileIndexes.end(), 0 );
+
+  QtConcurrent::blockingMap( tileIndexes, [this, &raster, tilesData]( int tileIndex )
+  {
+    const QRect rect = tileRect( tileIndex );
+    const int count = rect.width() * rect.height();
+    std::vector<unsigned char> values( static_cast<size_t>( count ) );
+    raster.readBlock( rect.top(), rect.left(), rect.height(), rect.width(), values.data() );
+
+    const QByteArray rle = runLengthEncode( values.data(), count );
+    const QByteArray deflated = qCompress( rle );
+
+    QByteArray &tile = tilesData[tileIndex];
+    if ( deflated.size() < rle.size() )
+    {
+      tile.reserve( deflated.size() + 1 );
+      tile.append( TILE_DEFLATE );
+      tile.append( deflated );
+    }
+    else
+    {
+      tile.reserve( rle.size() + 1 );
+      tile.append( TILE_RLE );
+      tile.append( rle );
+    }
+  } );
+
+  mTileOffsets.resize( tileCount + 1 );
+  int offset = 0;
+  for ( int i = 0; i < tileCount; ++i )
+  {
+    mTileOffsets[i] = offset;
+    offset += tiles.at( i ).size();
+  }
+  mTileOffsets[tileCount] = offset;
+
+  mData.reserve( offset );
+  for ( const QByteArray &tile : std::as_const( tiles ) )
+    mData.append( tile );
+}
+
+ReosRasterMemory<unsigned char> ReosRasterByteTiledCompressed::uncompressRaster() const
+{
+  return uncompressBlock( 0, 0, mRowCount, mColumnCount, 0 );
+}
+
+ReosRasterMemory<unsigned char> ReosRasterByteTiledCompressed::uncompressBlock( int row, int column, int blockRowCount, int blockColumnCount, unsigned char outsideValue ) const
+{
+  ReosRasterMemory<unsigned char> block( blockRowCount, blockColumnCount );
+  if ( !block.reserveMemory() )
+    return ReosRasterMemory<unsigned char>();
+
+  unsigned char *blockValues = static_cast<unsigned char *>( block.data() );
+  const QRect blockRect( column, row, blockColumnCount, blockRowCount );
+  const QRect intersection = blockRect.intersected( QRect( 0, 0, mColumnCount, mRowCount ) );
+
+  if ( intersection != blockRect )
+    std::memset( blockValues, outsideValue, static_cast<size_t>( blockRowCount ) * blockColumnCount );
+
+  if ( intersection.isEmpty() || !hasData() )
+    return block;
+
+  QVector<int> tileIndexes;
+  const int tileColumns = tileColumnCount();
+  for ( int tileRow = intersection.top() / TILE_SIZE; tileRow <= intersection.bottom() / TILE_SIZE; ++tileRow )
+    for ( int tileColumn = intersection.left() / TILE_SIZE; tileColumn <= intersection.right() / TILE_SIZE; ++tileColumn )
+      tileIndexes.append( tileRow * tileColumns + tileColumn );
+
+  QtConcurrent::blockingMap( tileIndexes, [this, &blockRect, &intersection, blockValues, outsideValue]( int tileIndex )
+  {
+    const QRect rect = tileRect( tileIndex );
+    const QRect toCopy = rect.intersected( intersection );
+
+    std::vector<unsigned char> tileValues( TILE_SIZE * TILE_SIZE );
+    const bool uncompressed = uncompressTile( tileIndex, tileValues.data() );
+
+    for ( int r = toCopy.top(); r <= toCopy.bottom(); ++r )
+    {
+      unsigned char *destination = blockValues + static_cast<size_t>( r - blockRect.top() ) * blockRect.width() + toCopy.left() - blockRect.left();
+      if ( uncompressed )
+      {
+        const unsigned char *source = tileValues.data() + ( r - rect.top() ) * rect.width() + toCopy.left() - rect.left();
+        std::memcpy( destination, source, toCopy.width() );
+      }
+      else
+      {
+        // corrupted tile, its cells have no data rather than uninitialized values
+        std::memset( destination, outsideValue, toCopy.width() );
+      }
+    }
+  } );
+
+  return block;
+}
+
+unsigned char ReosRasterByteTiledCompressed::value( int row, int column ) const
+{
+  if ( row < 0 || column < 0 || row >= mRowCount || column >= mColumnCount || !hasData() )
+    return 0;
+
+  const int tileIndex = ( row / TILE_SIZE ) * tileColumnCount() + column / TILE_SIZE;
+  std::vector<unsigned char> tileValues( TILE_SIZE * TILE_SIZE );
+  if ( !uncompressTile( tileIndex, tileValues.data() ) )
+    return 0;
+
+  const QRect rect = tileRect( tileIndex );
+  return tileValues.at( ( row - rect.top() ) * rect.width() + column - rect.left() );
+}
+
+bool ReosRasterByteTiledCompressed::hasData() const
+{
+  return !mData.isEmpty();
+}
+
+int ReosRasterByteTiledCompressed::compressedSize() const
+{
+  return mData.size() + mTileOffsets.count() * static_cast<int>( sizeof( int ) );
+}
+
+ReosEncodedElement ReosRasterByteTiledCompressed::encode() const
+{
+  ReosEncodedElement ret( QStringLiteral( "tiled-compress-byte-raster" ) );
+  ret.addData( QStringLiteral( "row-count" ), mRowCount );
+  ret.addData( QStringLiteral( "column-count" ), mColumnCount );
+  ret.addData( QStringLiteral( "tile-offsets" ), mTileOffsets );
+  ret.addData( QStringLiteral( "data" ), mData );
+
+  return ret;
+}
+
+ReosRasterByteTiledCompressed ReosRasterByteTiledCompressed::decode( const ReosEncodedElement &element )
+{
+  if ( element.description() != QStringLiteral( "tiled-compress-byte-raster" ) )
+    return ReosRasterByteTiledCompressed();
+
+  ReosRasterByteTiledCompressed ret;
+  if ( !element.getData( QStringLiteral( "row-count" ), ret.mRowCount ) )
+    return ReosRasterByteTiledCompressed();
+
+  if ( !element.getData( QStringLiteral( "column-count" ), ret.mColumnCount ) )
+    return ReosRasterByteTiledCompressed();
+
+  if ( !element.getData( QStringLiteral( "tile-offsets" ), ret.mTileOffsets ) )
+    return ReosRasterByteTiledCompressed();
+
+  if ( !element.getData( QStringLiteral( "data" ), ret.mData ) )
+    return ReosRasterByteTiledCompressed();
+
+  if ( ret.mTileOffsets.count() != ret.tileRowCount() * ret.tileColumnCount() + 1 ||
+       ret.mTileOffsets.last() != ret.mData.size() )
+    return ReosRasterByteTiledCompressed();
+
+  return ret;
+}
+
+bool ReosRasterByteTiledCompressed::operator==( const ReosRasterByteTiledCompressed &other ) const
+{
+  return mRowCount == other.mRowCount &&
+         mColumnCount == other.mColumnCount &&
+         mTileOffsets == other.mTileOffsets &&
+         mData == other.mData;
+}
+
+bool ReosRasterByteTiledCompressed::operator!=( const ReosRasterByteTiledCompressed &other ) const
+{
+  return !operator==( other );
+}
+
+int ReosRasterByteTiledCompressed::tileRowCount() const
+{
+  return ( mRowCount + TILE_SIZE - 1 ) / TILE_SIZE;
+}
+
+int ReosRasterByteTiledCompressed::tileColumnCount() const
+{
+  return ( mColumnCount + TILE_SIZE - 1 ) / TILE_SIZE;
+}
+
+QRect ReosRasterByteTiledCompressed::tileRect( int tileIndex ) const
+{
+  const int tileColumns = tileColumnCount();
+  const int left = ( tileIndex % tileColumns ) * TILE_SIZE;
+  const int top = ( tileIndex / tileColumns ) * TILE_SIZE;
+  return QRect( left, top, std::min( TILE_SIZE, mColumnCount - left ), std::min( TILE_SIZE, mRowCount - top ) );
+}
+
+bool ReosRasterByteTiledCompressed::uncompressTile( int tileIndex, unsigned char *values ) const
+{
+  const int offset = mTileOffsets.at( tileIndex );
+  const int size = mTileOffsets.at( tileIndex + 1 ) - offset;
+  if ( size < 1 )
+    return false;
+
+  const QRect rect = tileRect( tileIndex );
+  const int count = rect.width() * rect.height();
+  const unsigned char *tileData = reinterpret_cast<const unsigned char *>( mData.constData() ) + offset;
+
+  if ( static_cast<char>( tileData[0] ) == TILE_DEFLATE )
+  {
+    const QByteArray rle = qUncompress( tileData + 1, size - 1 );
+    const unsigned char *rleData = reinterpret_cast<const unsigned char *>( rle.constData() );
+    return runLengthDecode( rleData, rleData + rle.size(), values, count );
+  }
+
+  return runLengthDecode( tileData + 1, tileData + size, values, count );
+}
@@ -16,6 +16,7 @@ email                : vcloarec@gmail.com
 #define REOSRASTERCOMPRESSED_H
 
 #include <QByteArray>
+#include <QVector>
 #include "reosmemoryraster.h"
 
 
@@ -50,5 +51,70 @@ class ReosRasterByteCompressed
     QByteArray mData;
 };
 
+/**
+ * Class used to store unsigned char raster by a compress way, the raster is split in tiles that are compressed independently.
+ *
+ * Each tile is stored with run-length encoding, the length of a run being stored with a variable count of bytes,
+ * so runs are not limited. If it is smaller, the run-length encoded tile is also compressed with zlib.
+ *
+ * As tiles are independent, compression and decompression are made in parallel, and a value or a block
+ * can be read without decompressing the whole raster.
+ */
+class REOSCORE_EXPORT ReosRasterByteTiledCompressed
+{
+  public:
+    ReosRasterByteTiledCompressed() = default;
+    //! Constructor with an existing \a raster
+    explicit ReosRasterByteTiledCompressed( const ReosRasterMemory<unsigned char> &raster );
+
+    //! Returns the row count of the raster
+    int rowCount() const {return mRowCount;}
+    //! Returns the column count of the raster
+    int columnCount() const {return mColumnCount;}
+
+    //! Decompresses the raster and returns it
+    ReosRasterMemory<unsigned char> uncompressRaster() const;
+
+    /**
+     * Decompresses only the tiles that intersect the block starting at \a row and \a column with \a blockRowCount rows
+     * and \a blockColumnCount columns and returns the block. Cells of the block outside the raster or in a tile that can't be
+     * decompressed have \a outsideValue, that is the no data value of the block.
+     */
+    ReosRasterMemory<unsigned char> uncompressBlock( int row, int column, int blockRowCount, int blockColumnCount, unsigned char outsideValue ) const;
+
+    //! Returns the value at \a row and \a column, decompressing only the tile containing the cell
+    unsigned char value( int row, int column ) const;
+
+    //! Return whether the instance of this object contains data
+    bool hasData() const;
+
+    //! Returns the size in bytes of the compressed data
+    int compressedSize() const;
+
+    //! Encodes the instance and returns a encodeded element
+    ReosEncodedElement encode() const;
+    //! Creates a new instance of this class by decoding the \a element
+    static ReosRasterByteTiledCompressed decode( const ReosEncodedElement &element );
+
+    bool operator==( const ReosRasterByteTiledCompressed &other ) const;
+    bool operator!=( const ReosRasterByteTiledCompressed &other ) const;
+
+    //! Size of the side of the tiles
+    static const int TILE_SIZE = 64;
+
+  private:
+    int mRowCount = 0;
+    int mColumnCount = 0;
+    QByteArray mData;
+    QVector<int> mTileOffsets;
+
+    int tileRowCount() const;
+    int tileColumnCount() const;
+    //! Returns the rectangle, in raster cells, of the tile with index \a tileIndex
+    QRect tileRect( int tileIndex ) const;
+    //! Decompresses the tile with index \a tileIndex in \a values that has to contain at least TILE_SIZE*TILE_SIZE values
+    bool uncompressTile( int tileIndex, unsigned char *values ) const;
+};
+
 
 #endif // REOSRASTERCOMPRESSED_H
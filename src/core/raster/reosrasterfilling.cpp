@@ -15,6 +15,10 @@ email                : vcloarec@gmail.com
 
 #include "reosrasterfilling.h"
 
+#include <algorithm>
+#include <limits>
+#include <QtConcurrent>
+
 ReosRasterFilling::ReosRasterFilling( const ReosRasterMemory<float> &dem, double XSize, double YSize, float maxValue ):
   mDem( dem ), mXSize( XSize ), mYSize( YSize )
 {
@@ -58,7 +62,14 @@ bool ReosRasterFillingWangLiu::initialize()
   if ( !( mDem.isValid() ) )
     return false;
 
-  if ( !mRasterChar.reserveMemory( mDem.rowCount(), mDem.columnCount() ) )
+  if ( mDem.isTiled() )
+  {
+    // DEM does not fit in memory, so neither the marks
+    mRasterChar = ReosRasterMemory<bool>( mDem.rowCount(), mDem.columnCount() );
+    if ( !mRasterChar.reserveTiledMemory() )
+      return false;
+  }
+  else if ( !mRasterChar.reserveMemory( mDem.rowCount(), mDem.columnCount() ) )
     return false;
 
   mRasterChar.fill( false );
@@ -222,3 +233,505 @@ void ReosRasterFillingWangLiu::start()
 
 
 
+
+ReosRasterFillingPriorityFlood::ReosRasterFillingPriorityFlood( const ReosRasterMemory<float> &dem, double XSize, double YSize, float maxValue, Mode mode ):
+  ReosRasterFilling( dem, XSize, YSize, maxValue )
+  , mMode( mode )
+{}
+
+bool ReosRasterFillingPriorityFlood::initialize()
+{
+  if ( !( mDem.isValid() ) || mDem.isTiled() )
+    return false;
+
+  const int cellCount = mDem.rowCount() * mDem.columnCount();
+
+  try
+  {
+    mHeap.clear();
+    mNoDataStack.clear();
+    mRaisedQueue.clear();
+    mTiles.clear();
+    mOriginalValues.clear();
+    if ( mMode == Sequential )
+    {
+      mTreated.assign( cellCount, 0 );
+      mHeap.reserve( 2 * ( mDem.rowCount() + mDem.columnCount() ) );
+    }
+    else
+    {
+      mTreated.clear();
+      mOriginalValues.resize( cellCount );
+    }
+  }
+  catch ( std::bad_alloc & )
+  {
+    return false;
+  }
+
+  // same expression than in ReosRasterFillingWangLiu::processCell() to have exactly the same float values
+  for ( int i = 0; i < 3; ++i )
+    for ( int j = 0; j < 3; ++j )
+      mDelta[i][j] = ( sqrt( powf( ( i - 1 ) * float( mXSize ), 2 ) + powf( ( j - 1 ) * float( mYSize ), 2 ) ) ) * mMimimumSlope;
+
+  mOrder = 0;
+  mProgression = 0;
+
+  return true;
+}
+
+void ReosRasterFillingPriorityFlood::start()
+{
+  mIsSuccessful = false;
+
+  if ( !mDem.isValid() )
+    return;
+
+  if ( !initialize() )
+    return;
+
+  // detach the data before working directly on it
+  mValues = static_cast<float *>( mDem.data() );
+
+  bool success = false;
+  switch ( mMode )
+  {
+    case Sequential:
+      success = fillSequential();
+      break;
+    case Tiled:
+      success = fillTiled();
+      break;
+  }
+
+  mHeap = std::vector<HeapCell>();
+  mNoDataStack = std::vector<int>();
+  mRaisedQueue = std::vector<int>();
+  mTreated = std::vector<unsigned char>();
+  mOriginalValues = std::vector<float>();
+  mValues = nullptr;
+
+  if ( !success || isStop() )
+    return;
+
+  mIsSuccessful = true;
+}
+
+ReosRasterFillingPriorityFlood::Mode ReosRasterFillingPriorityFlood::mode() const
+{
+  return mMode;
+}
+
+void ReosRasterFillingPriorityFlood::setMode( Mode mode )
+{
+  mMode = mode;
+}
+
+void ReosRasterFillingPriorityFlood::setUseQueueForRaisedCells( bool useQueue )
+{
+  mUseQueueForRaisedCells = useQueue;
+}
+
+void ReosRasterFillingPriorityFlood::setTileSize( int tileSize )
+{
+  mTileSize = std::max( tileSize, 1 );
+}
+
+// The heap is a min heap ordered by value, then by insertion order to reproduce the order of the std::multiset used by ReosRasterFillingWangLiu
+static bool heapCellIsAfter( float value1, quint32 order1, float value2, quint32 order2 )
+{
+  if ( value2 < value1 )
+    return true;
+  if ( value1 < value2 )
+    return false;
+  return order1 > order2;
+}
+
+void ReosRasterFillingPriorityFlood::pushHeap( float value, int index )
+{
+  mHeap.push_back( {value, mOrder++, index} );
+  std::push_heap( mHeap.begin(), mHeap.end(), []( const HeapCell & c1, const HeapCell & c2 )
+  {
+    return heapCellIsAfter( c1.value, c1.order, c2.value, c2.order );
+  } );
+}
+
+ReosRasterFillingPriorityFlood::HeapCell ReosRasterFillingPriorityFlood::popHeap()
+{
+  std::pop_heap( mHeap.begin(), mHeap.end(), []( const HeapCell & c1, const HeapCell & c2 )
+  {
+    return heapCellIsAfter( c1.value, c1.order, c2.value, c2.order );
+  } );
+  HeapCell cell = mHeap.back();
+  mHeap.pop_back();
+  return cell;
+}
+
+void ReosRasterFillingPriorityFlood::markCell( int index )
+{
+  mTreated[index] = 1;
+  mProgression++;
+  if ( mProgression % 4096 == 0 )
+    setCurrentProgression( mProgression );
+}
+
+void ReosRasterFillingPriorityFlood::makePriorityStack()
+{
+  // Border cells are inserted in a multiset with hint exactly as ReosRasterFillingWangLiu does,
+  // the order of cells with same values in this multiset gives the insertion order in the heap
+  struct BorderCell
+  {
+    float value;
+    int index;
+    bool operator<( const BorderCell &other ) const {return value < other.value;}
+  };
+
+  const float *values = mValues;
+  const int columnCount = mDem.columnCount();
+  const float noData = mDem.noData();
+  std::multiset<BorderCell> border;
+  std::multiset<BorderCell>::iterator insertion = border.begin();
+
+  auto addBorderCell = [&]( int r, int c )
+  {
+    const int index = r * columnCount + c;
+    markCell( index );
+    if ( values[index] == noData )
+      mNoDataStack.push_back( index );
+    else
+      insertion = border.insert( insertion, {values[index], index} );
+  };
+
+  int r = 0;
+  int c = 0;
+
+  while ( r < mDem.rowCount() - 1 )
+  {
+    addBorderCell( r, c );
+    ++r;
+  }
+
+  while ( c < columnCount - 1 )
+  {
+    addBorderCell( r, c );
+    ++c;
+  }
+
+  while ( r > 0 )
+  {
+    addBorderCell( r, c );
+    --r;
+  }
+
+  while ( c > 0 )
+  {
+    addBorderCell( r, c );
+    --c;
+  }
+
+  for ( const BorderCell &cell : border )
+    pushHeap( cell.value, cell.index );
+}
+
+void ReosRasterFillingPriorityFlood::processCell( int index, float zCentral )
+{
+  float *values = mValues;
+  const int rowCount = mDem.rowCount();
+  const int columnCount = mDem.columnCount();
+  const float noData = mDem.noData();
+  const int row = index / columnCount;
+  const int column = index % columnCount;
+  const bool isInside = row > 0 && row < rowCount - 1 && column > 0 && column < columnCount - 1;
+
+  // neighbors are visited in the same order than ReosRasterFillingWangLiu::processCell()
+  for ( int i = 0; i < 3; ++i )
+    for ( int j = 0; j < 3; ++j )
+    {
+      if ( i == 1 && j == 1 )
+        continue;
+
+      const int rowNeigh = row + i - 1;
+      const int colNeigh = column + j - 1;
+      if ( !isInside && ( rowNeigh < 0 || rowNeigh >= rowCount || colNeigh < 0 || colNeigh >= columnCount ) )
+        continue;
+
+      const int neighIndex = rowNeigh * columnCount + colNeigh;
+      if ( mTreated[neighIndex] )
+        continue;
+
+      float &neighValue = values[neighIndex];
+      if ( neighValue == noData )
+        mNoDataStack.push_back( neighIndex );
+      else
+      {
+        const float delta = mDelta[i][j];
+        if ( neighValue <= zCentral + delta )
+        {
+          neighValue = zCentral + delta;
+          if ( mUseQueueForRaisedCells )
+            mRaisedQueue.push_back( neighIndex );
+          else
+            pushHeap( neighValue, neighIndex );
+        }
+        else
+          pushHeap( neighValue, neighIndex );
+      }
+      markCell( neighIndex );
+    }
+}
+
+bool ReosRasterFillingPriorityFlood::fillSequential()
+{
+  setMaxProgression( mDem.rowCount() * mDem.columnCount() );
+  const float *values = mValues;
+
+  makePriorityStack();
+
+  size_t raisedQueueHead = 0;
+  int iteration = 0;
+  while ( true )
+  {
+    if ( ++iteration % 4096 == 0 && isStop() )
+      return false;
+
+    int index;
+    if ( !mNoDataStack.empty() )
+    {
+      index = mNoDataStack.back();
+      mNoDataStack.pop_back();
+    }
+    else if ( raisedQueueHead < mRaisedQueue.size() )
+    {
+      index = mRaisedQueue[raisedQueueHead++];
+      if ( raisedQueueHead == mRaisedQueue.size() )
+      {
+        mRaisedQueue.clear();
+        raisedQueueHead = 0;
+      }
+    }
+    else if ( !mHeap.empty() )
+      index = popHeap().index;
+    else
+      break;
+
+    processCell( index, values[index] );
+  }
+
+  return true;
+}
+
+struct ReosRasterFillingTileJob
+{
+  ReosRasterFillingPriorityFlood *filling;
+  int tileIndex;
+};
+
+bool ReosRasterFillingPriorityFlood::fillTiled()
+{
+  float *values = mValues;
+  const int rowCount = mDem.rowCount();
+  const int columnCount = mDem.columnCount();
+  const float noData = mDem.noData();
+  const float infinity = std::numeric_limits<float>::infinity();
+
+  // cells on the border of the DEM and no data cells are outlets with fixed values, others are unknown
+  for ( int r = 0; r < rowCount; ++r )
+    for ( int c = 0; c < columnCount; ++c )
+    {
+      const int index = r * columnCount + c;
+      mOriginalValues[index] = values[index];
+      const bool isBorder = r == 0 || c == 0 || r == rowCount - 1 || c == columnCount - 1;
+      if ( !isBorder && values[index] != noData )
+        values[index] = infinity;
+    }
+
+  mTileRowCount = ( rowCount + mTileSize - 1 ) / mTileSize;
+  mTileColumnCount = ( columnCount + mTileSize - 1 ) / mTileSize;
+  mTiles.resize( mTileRowCount * mTileColumnCount );
+  for ( int tr = 0; tr < mTileRowCount; ++tr )
+    for ( int tc = 0; tc < mTileColumnCount; ++tc )
+    {
+      Tile &tile = mTiles[tr * mTileColumnCount + tc];
+      tile.rowMin = tr * mTileSize;
+      tile.rowMax = std::min( rowCount, ( tr + 1 ) * mTileSize );
+      tile.colMin = tc * mTileSize;
+      tile.colMax = std::min( columnCount, ( tc + 1 ) * mTileSize );
+    }
+
+  bool hasActiveTile = true;
+  while ( hasActiveTile )
+  {
+    setMaxProgression( static_cast<int>( mTiles.size() ) );
+    setCurrentProgression( 0 );
+    mProgression = 0;
+
+    // tiles are processed by groups of tiles that are not neighbors, so each tile reads stable values around it
+    for ( int group = 0; group < 4; ++group )
+    {
+      QVector<ReosRasterFillingTileJob> jobs;
+      for ( int tr = group / 2; tr < mTileRowCount; tr += 2 )
+        for ( int tc = group % 2; tc < mTileColumnCount; tc += 2 )
+        {
+          const int tileIndex = tr * mTileColumnCount + tc;
+          if ( mTiles[tileIndex].active )
+            jobs.append( {this, tileIndex} );
+        }
+
+      QtConcurrent::blockingMap( jobs, []( ReosRasterFillingTileJob & job )
+      {
+        job.filling->fillTile( job.filling->mTiles[job.tileIndex] );
+      } );
+
+      if ( isStop() )
+        return false;
+    }
+
+    hasActiveTile = false;
+    for ( Tile &tile : mTiles )
+      tile.active = false;
+
+    for ( int tr = 0; tr < mTileRowCount; ++tr )
+      for ( int tc = 0; tc < mTileColumnCount; ++tc )
+      {
+        Tile &tile = mTiles[tr * mTileColumnCount + tc];
+        if ( !tile.perimeterChanged )
+          continue;
+        tile.perimeterChanged = false;
+        for ( int ntr = std::max( tr - 1, 0 ); ntr <= std::min( tr + 1, mTileRowCount - 1 ); ++ntr )
+          for ( int ntc = std::max( tc - 1, 0 ); ntc <= std::min( tc + 1, mTileColumnCount - 1 ); ++ntc )
+          {
+            if ( ntr == tr && ntc == tc )
+              continue;
+            mTiles[ntr * mTileColumnCount + ntc].active = true;
+            hasActiveTile = true;
+          }
+      }
+  }
+
+  return true;
+}
+
+void ReosRasterFillingPriorityFlood::fillTile( Tile &tile )
+{
+  if ( isStop() )
+    return;
+
+  float *values = mValues;
+  const float *originalValues = mOriginalValues.data();
+  const int rowCount = mDem.rowCount();
+  const int columnCount = mDem.columnCount();
+  const float noData = mDem.noData();
+  const float infinity = std::numeric_limits<float>::infinity();
+
+  // local grid is the tile with a ring of one cell around it, cells of the ring are the outlets given by the neighbor tiles
+  const int localRowCount = tile.rowMax - tile.rowMin + 2;
+  const int localColumnCount = tile.colMax - tile.colMin + 2;
+  const int localCellCount = localRowCount * localColumnCount;
+
+  std::vector<float> localValues( localCellCount, infinity );
+  std::vector<unsigned char> fixed( localCellCount, 1 );
+  std::vector<unsigned char> treated( localCellCount, 0 );
+  std::vector<std::pair<float, int>> heap;
+
+  auto globalIndex = [&]( int localIndex )
+  {
+    return ( localIndex / localColumnCount + tile.rowMin - 1 ) * columnCount + localIndex % localColumnCount + tile.colMin - 1;
+  };
+
+  for ( int lr = 0; lr < localRowCount; ++lr )
+  {
+    const int row = lr + tile.rowMin - 1;
+    if ( row < 0 || row >= rowCount )
+      continue;
+    for ( int lc = 0; lc < localColumnCount; ++lc )
+    {
+      const int column = lc + tile.colMin - 1;
+      if ( column < 0 || column >= columnCount )
+        continue;
+
+      const int localIndex = lr * localColumnCount + lc;
+      const int index = row * columnCount + column;
+      const bool isInTile = lr > 0 && lr < localRowCount - 1 && lc > 0 && lc < localColumnCount - 1;
+      const bool isBorder = row == 0 || column == 0 || row == rowCount - 1 || column == columnCount - 1;
+      const bool isOutlet = !isInTile || isBorder || originalValues[index] == noData;
+
+      if ( isOutlet )
+      {
+        if ( values[index] != infinity )
+        {
+          localValues[localIndex] = values[index];
+          heap.emplace_back( values[index], localIndex );
+        }
+      }
+      else
+        fixed[localIndex] = 0;
+    }
+  }
+
+  auto heapCompare = []( const std::pair<float, int> &c1, const std::pair<float, int> &c2 )
+  {
+    return c2.first < c1.first;
+  };
+  std::make_heap( heap.begin(), heap.end(), heapCompare );
+
+  while ( !heap.empty() )
+  {
+    std::pop_heap( heap.begin(), heap.end(), heapCompare );
+    const float zCentral = heap.back().first;
+    const int localIndex = heap.back().second;
+    heap.pop_back();
+
+    if ( treated[localIndex] || zCentral != localValues[localIndex] )
+      continue;
+    treated[localIndex] = 1;
+
+    const int lr = localIndex / localColumnCount;
+    const int lc = localIndex % localColumnCount;
+    for ( int i = 0; i < 3; ++i )
+      for ( int j = 0; j < 3; ++j )
+      {
+        if ( i == 1 && j == 1 )
+          continue;
+        const int nlr = lr + i - 1;
+        const int nlc = lc + j - 1;
+        if ( nlr < 0 || nlr >= localRowCount || nlc < 0 || nlc >= localColumnCount )
+          continue;
+        const int neighIndex = nlr * localColumnCount + nlc;
+        if ( fixed[neighIndex] || treated[neighIndex] )
+          continue;
+
+        // same raising rule than the sequential mode
+        const float originalValue = originalValues[globalIndex( neighIndex )];
+        float newValue = zCentral + mDelta[i][j];
+        if ( !( originalValue <= newValue ) )
+          newValue = originalValue;
+
+        if ( newValue < localValues[neighIndex] )
+        {
+          localValues[neighIndex] = newValue;
+          heap.emplace_back( newValue, neighIndex );
+          std::push_heap( heap.begin(), heap.end(), heapCompare );
+        }
+      }
+  }
+
+  for ( int localIndex = 0; localIndex < localCellCount; ++localIndex )
+  {
+    if ( fixed[localIndex] )
+      continue;
+
+    const int index = globalIndex( localIndex );
+    if ( values[index] == localValues[localIndex] )
+      continue;
+
+    const int lr = localIndex / localColumnCount;
+    const int lc = localIndex % localColumnCount;
+    if ( lr == 1 || lc == 1 || lr == localRowCount - 2 || lc == localColumnCount - 2 )
+      tile.perimeterChanged = true;
+
+    values[index] = localValues[localIndex];
+  }
+
+  std::lock_guard<std::mutex> locker( mProgressionMutex );
+  setCurrentProgression( ++mProgression );
+}
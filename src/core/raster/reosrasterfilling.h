@@ -19,6 +19,7 @@ email                : vcloarec@gmail.com
 #include <set>
 #include <mutex>
 #include <deque>
+#include <vector>
 
 #include "reosmemoryraster.h"
 #include "reosprocess.h"
@@ -83,4 +84,95 @@ class ReosRasterFillingWangLiu: public ReosRasterFilling
     int mProgession = 0;
 };
 
+/**
+ * Filling process that gives the same result as ReosRasterFillingWangLiu (minimum slope and no data propagation)
+ * but works directly on the contiguous array of the DEM, with a flat binary heap as priority queue and a byte array to store treated cells.
+ *
+ * Two other modes are available:
+ *
+ * - with setUseQueueForRaisedCells( true ), cells that are raised by the filling are not put in the priority queue but in a plain FIFO queue
+ *   that is processed first, as in the "Priority-Flood+Epsilon" algorithm of Barnes et al. (2014). This is faster on DEMs with large flat areas
+ *   or depressions, the result is still drainable with the minimum slope but values in filled areas can differ slightly from the default ordering.
+ * - with setMode( Tiled ), the DEM is cut in tiles that are filled in parallel threads, taking as outlet the spill elevations of the tile neighbors.
+ *   Spill elevations are exchanged between tiles until they are stable. As the minimum slope makes the spill elevation not constant on
+ *   a depression, the tiles are filled again instead of using a single graph of labels like in the parallel priority-flood of Barnes (2016).
+ *   Each cell is filled with the lowest elevation that respects the minimum slope to an outlet, so the result can differ slightly from the sequential mode
+ *   where each cell is raised from the first neighbor that reaches it. No data cells are considered as outlets from the beginning.
+ *
+ * This process needs a DEM stored in a contiguous array, it fails with a DEM stored in tiles (see ReosRasterMemory::isTiled()).
+ */
+class REOSCORE_EXPORT ReosRasterFillingPriorityFlood: public ReosRasterFilling
+{
+  public:
+    enum Mode
+    {
+      Sequential, //!< Exactly the same result than ReosRasterFillingWangLiu
+      Tiled, //!< Tiles filled in parallel threads
+    };
+
+    ReosRasterFillingPriorityFlood( const ReosRasterMemory<float> &dem, double XSize, double YSize, float maxValue, Mode mode = Sequential );
+
+    bool initialize() override;
+    void start() override;
+
+    //! Returns the mode used to fill the DEM
+    Mode mode() const;
+    //! Sets the \a mode used to fill the DEM
+    void setMode( Mode mode );
+
+    //! Sets whether cells raised by the filling are processed with a plain FIFO queue instead of the priority queue, only used in the sequential mode
+    void setUseQueueForRaisedCells( bool useQueue );
+
+    //! Sets the size of the tiles (count of rows and columns) used in the tiled mode
+    void setTileSize( int tileSize );
+
+  private:
+    struct HeapCell
+    {
+      float value;
+      quint32 order;
+      int index;
+    };
+
+    struct Tile
+    {
+      int rowMin = 0;
+      int rowMax = 0; //excluded
+      int colMin = 0;
+      int colMax = 0; //excluded
+      bool active = true;
+      bool perimeterChanged = false;
+    };
+
+    Mode mMode = Sequential;
+    bool mUseQueueForRaisedCells = false;
+    int mTileSize = 512;
+
+    std::vector<HeapCell> mHeap;
+    std::vector<int> mNoDataStack;
+    std::vector<int> mRaisedQueue;
+    std::vector<unsigned char> mTreated;
+    float mDelta[3][3];
+    float *mValues = nullptr;
+    quint32 mOrder = 0;
+    int mProgression = 0;
+    std::mutex mProgressionMutex;
+
+    // data used in tiled mode
+    std::vector<float> mOriginalValues;
+    std::vector<Tile> mTiles;
+    int mTileRowCount = 0;
+    int mTileColumnCount = 0;
+
+    bool fillSequential();
+    void makePriorityStack();
+    void pushHeap( float value, int index );
+    HeapCell popHeap();
+    void processCell( int index, float zCentral );
+    void markCell( int index );
+
+    bool fillTiled();
+    void fillTile( Tile &tile );
+};
+
 #endif // REOSRASTERFILLING_H
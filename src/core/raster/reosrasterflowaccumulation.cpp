@@ -0,0 +1,485 @@
+/***************************************************************************
+  reosrasterflowaccumulation.cpp - ReosRasterFlowAccumulation
+
+ ---------------------
+ begin                : 16.5.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "reosrasterflowaccumulation.h"
+
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include <QHash>
+#include <QSet>
+#include <QtConcurrentMap>
+
+// Value of the upstream count of the cells that have no upstream neighbor, never decremented
+static const unsigned char SOURCE_CELL = 0xFF;
+
+// Moves \a row and \a column to the cell pointed by \a direction, returns false if there is no downstream cell in the raster
+static bool downstreamCell( unsigned char direction, int &row, int &column, int rowCount, int columnCount )
+{
+  if ( direction > 8 || direction == 4 )
+    return false;
+
+  row += direction % 3 - 1;
+  column += direction / 3 - 1;
+
+  return row >= 0 && row < rowCount && column >= 0 && column < columnCount;
+}
+
+// Returns the count of neighbors that flow in the cell at \a row and \a column
+static unsigned char upstreamCount( const unsigned char *directions, int row, int column, int rowCount, int columnCount )
+{
+  unsigned char count = 0;
+  for ( int i = 0; i < 3; ++i )
+  {
+    const int r = row + i - 1;
+    if ( r < 0 || r >= rowCount )
+      continue;
+    for ( int j = 0; j < 3; ++j )
+    {
+      const int c = column + j - 1;
+      if ( ( i == 1 && j == 1 ) || c < 0 || c >= columnCount )
+        continue;
+      if ( directions[static_cast<size_t>( r ) * columnCount + c] == 8 - ( i + j * 3 ) )
+        ++count;
+    }
+  }
+
+  return count;
+}
+
+ReosRasterFlowAccumulation::ReosRasterFlowAccumulation( const ReosRasterWatershed::Directions &directions )
+{
+  if ( directions.isTiled() )
+  {
+    mDirections = ReosRasterWatershed::Directions( directions.rowCount(), directions.columnCount() );
+    if ( mDirections.reserveMemory() )
+      directions.readBlock( 0, 0, directions.rowCount(), directions.columnCount(), static_cast<unsigned char *>( mDirections.data() ) );
+  }
+  else
+    mDirections = directions;
+}
+
+void ReosRasterFlowAccumulation::stop( bool b )
+{
+  ReosProcess::stop( b );
+  if ( b )
+    mFuture.cancel();
+}
+
+int ReosRasterFlowAccumulation::currentProgression() const
+{
+  return mFuture.progressValue();
+}
+
+int ReosRasterFlowAccumulation::maxProgression() const
+{
+  return mFuture.progressMaximum();
+}
+
+void ReosRasterFlowAccumulation::start()
+{
+  mIsSuccessful = false;
+  const int rowCount = mDirections.rowCount();
+  const int columnCount = mDirections.columnCount();
+  const unsigned char *directions = mDirections.constData();
+  const size_t cellCount = static_cast<size_t>( rowCount ) * columnCount;
+  if ( !directions || cellCount == 0 )
+    return;
+
+  std::unique_ptr<std::atomic<unsigned char>[]> remainingUpstream( new std::atomic<unsigned char>[cellCount] );
+  std::unique_ptr<std::atomic<int>[]> accumulation( new std::atomic<int>[cellCount] );
+
+  QVector<int> bandStartRows;
+  for ( int startRow = 0; startRow < rowCount; startRow += BAND_ROW_COUNT )
+    bandStartRows.append( startRow );
+
+  // first pass: count of upstream neighbors of each cell, cell by cell without concurrent writing
+  setInformation( tr( "Count upstream cells" ) );
+  mFuture = QtConcurrent::map( bandStartRows, [&]( int startRow )
+  {
+    const int endRow = std::min( startRow + BAND_ROW_COUNT, rowCount );
+    for ( int row = startRow; row < endRow; ++row )
+      for ( int column = 0; column < columnCount; ++column )
+      {
+        const size_t index = static_cast<size_t>( row ) * columnCount + column;
+        if ( directions[index] > 8 )
+        {
+          remainingUpstream[index].store( 0, std::memory_order_relaxed );
+          accumulation[index].store( 0, std::memory_order_relaxed );
+        }
+        else
+        {
+          const unsigned char count = upstreamCount( directions, row, column, rowCount, columnCount );
+          remainingUpstream[index].store( count == 0 ? SOURCE_CELL : count, std::memory_order_relaxed );
+          accumulation[index].store( 1, std::memory_order_relaxed );
+        }
+      }
+  } );
+  mFuture.waitForFinished();
+  if ( mFuture.isCanceled() )
+    return;
+
+  // second pass: from each source, the accumulation goes downstream as long as the current cell is the last treated upstream neighbor
+  // of the downstream cell. The thread that treats the last upstream neighbor of a cell sees all the accumulation added by the others.
+  setInformation( tr( "Accumulate flow" ) );
+  mFuture = QtConcurrent::map( bandStartRows, [&]( int startRow )
+  {
+    const int endRow = std::min( startRow + BAND_ROW_COUNT, rowCount );
+    for ( int sourceRow = startRow; sourceRow < endRow; ++sourceRow )
+      for ( int sourceColumn = 0; sourceColumn < columnCount; ++sourceColumn )
+      {
+        size_t index = static_cast<size_t>( sourceRow ) * columnCount + sourceColumn;
+        if ( remainingUpstream[index].load( std::memory_order_relaxed ) != SOURCE_CELL )
+          continue;
+
+        int row = sourceRow;
+        int column = sourceColumn;
+        int value = accumulation[index].load( std::memory_order_relaxed );
+        while ( downstreamCell( directions[index], row, column, rowCount, columnCount ) )
+        {
+          index = static_cast<size_t>( row ) * columnCount + column;
+          if ( directions[index] > 8 )
+            break;
+          accumulation[index].fetch_add( value, std::memory_order_relaxed );
+          if ( remainingUpstream[index].fetch_sub( 1, std::memory_order_acq_rel ) != 1 )
+            break;
+          value = accumulation[index].load( std::memory_order_relaxed );
+        }
+      }
+  } );
+  mFuture.waitForFinished();
+  if ( mFuture.isCanceled() )
+    return;
+
+  ReosRasterWatershed::Accumulation result( rowCount, columnCount );
+  if ( !result.reserveMemory() )
+    return;
+  result.setNodata( 0 );
+  int *resultData = static_cast<int *>( result.data() );
+  mFuture = QtConcurrent::map( bandStartRows, [&]( int startRow )
+  {
+    const size_t begin = static_cast<size_t>( startRow ) * columnCount;
+    const size_t end = static_cast<size_t>( std::min( startRow + BAND_ROW_COUNT, rowCount ) ) * columnCount;
+    for ( size_t i = begin; i < end; ++i )
+      resultData[i] = accumulation[i].load( std::memory_order_relaxed );
+  } );
+  mFuture.waitForFinished();
+  if ( mFuture.isCanceled() )
+    return;
+
+  mAccumulation = result;
+  setSuccesful( true );
+}
+
+ReosRasterWatershed::Accumulation ReosRasterFlowAccumulation::accumulation() const
+{
+  return mAccumulation;
+}
+
+int ReosRasterFlowAccumulation::accumulation( int row, int column ) const
+{
+  if ( !mAccumulation.isValid() || row < 0 || row >= mAccumulation.rowCount() || column < 0 || column >= mAccumulation.columnCount() )
+    return 0;
+
+  return mAccumulation.value( row, column );
+}
+
+ReosRasterCellPos ReosRasterFlowAccumulation::snapOutlet( const ReosRasterCellPos &cell, int radius ) const
+{
+  if ( !mAccumulation.isValid() )
+    return cell;
+
+  const int rowMin = std::max( cell.row() - radius, 0 );
+  const int rowMax = std::min( cell.row() + radius, mAccumulation.rowCount() - 1 );
+  const int columnMin = std::max( cell.column() - radius, 0 );
+  const int columnMax = std::min( cell.column() + radius, mAccumulation.columnCount() - 1 );
+
+  ReosRasterCellPos snappedCell = cell;
+  int maxAccumulation = 0;
+  int minDistance = std::numeric_limits<int>::max();
+  for ( int row = rowMin; row <= rowMax; ++row )
+    for ( int column = columnMin; column <= columnMax; ++column )
+    {
+      const int value = mAccumulation.value( row, column );
+      const int distance = ( row - cell.row() ) * ( row - cell.row() ) + ( column - cell.column() ) * ( column - cell.column() );
+      if ( value > maxAccumulation || ( value == maxAccumulation && value > 0 && distance < minDistance ) )
+      {
+        maxAccumulation = value;
+        minDistance = distance;
+        snappedCell = ReosRasterCellPos( row, column );
+      }
+    }
+
+  return snappedCell;
+}
+
+QVector<ReosRasterFlowAccumulation::StreamSegment> ReosRasterFlowAccumulation::streamNetwork( int threshold, const ReosRasterExtent &extent ) const
+{
+  QVector<StreamSegment> segments;
+  if ( !mAccumulation.isValid() )
+    return segments;
+
+  threshold = std::max( threshold, 1 );
+  const int rowCount = mDirections.rowCount();
+  const int columnCount = mDirections.columnCount();
+  const unsigned char *directions = mDirections.constData();
+  const int *accumulation = mAccumulation.constData();
+
+  // count of stream cells that flow in each cell, a segment starts on cells that have not exactly one
+  std::vector<unsigned char> upstreamStreamCount( static_cast<size_t>( rowCount ) * columnCount, 0 );
+  for ( int row = 0; row < rowCount; ++row )
+    for ( int column = 0; column < columnCount; ++column )
+    {
+      if ( accumulation[static_cast<size_t>( row ) * columnCount + column] < threshold )
+        continue;
+      int downRow = row;
+      int downColumn = column;
+      if ( downstreamCell( directions[static_cast<size_t>( row ) * columnCount + column], downRow, downColumn, rowCount, columnCount ) )
+        ++upstreamStreamCount[static_cast<size_t>( downRow ) * columnCount + downColumn];
+    }
+
+  QHash<qint64, int> segmentStartingAt;
+  QVector<ReosRasterCellPos> segmentStarts;
+  for ( int row = 0; row < rowCount; ++row )
+    for ( int column = 0; column < columnCount; ++column )
+    {
+      const size_t index = static_cast<size_t>( row ) * columnCount + column;
+      if ( accumulation[index] >= threshold && upstreamStreamCount[index] != 1 )
+      {
+        segmentStartingAt.insert( static_cast<qint64>( index ), segmentStarts.count() );
+        segmentStarts.append( ReosRasterCellPos( row, column ) );
+      }
+    }
+
+  segments.resize( segmentStarts.count() );
+  for ( int i = 0; i < segmentStarts.count(); ++i )
+  {
+    StreamSegment &segment = segments[i];
+    int row = segmentStarts.at( i ).row();
+    int column = segmentStarts.at( i ).column();
+    size_t index = static_cast<size_t>( row ) * columnCount + column;
+    segment.polyline.append( extent.cellCenterToMap( segmentStarts.at( i ) ) );
+    segment.accumulation = accumulation[index];
+
+    while ( downstreamCell( directions[index], row, column, rowCount, columnCount ) )
+    {
+      index = static_cast<size_t>( row ) * columnCount + column;
+      if ( directions[index] > 8 )
+        break;
+      segment.polyline.append( extent.cellCenterToMap( ReosRasterCellPos( row, column ) ) );
+      if ( upstreamStreamCount[index] != 1 )
+      {
+        segment.downstreamSegment = segmentStartingAt.value( static_cast<qint64>( index ), -1 );
+        break;
+      }
+      segment.accumulation = accumulation[index];
+    }
+  }
+
+  return segments;
+}
+
+ReosRasterMemory<int> ReosRasterFlowAccumulation::upstreamLabels( const QVector<ReosRasterLine> &outlets, QVector<ReosRasterCellPos> *endsOfLongerPath ) const
+{
+  const int rowCount = mDirections.rowCount();
+  const int columnCount = mDirections.columnCount();
+  const unsigned char *directions = mDirections.constData();
+
+  ReosRasterMemory<int> labels( rowCount, columnCount );
+  if ( !directions || !labels.reserveMemory() )
+    return labels;
+  labels.setNodata( 0 );
+  labels.fill( 0 );
+  int *labelsData = static_cast<int *>( labels.data() );
+
+  // for each cell of the outlet, the longer path among the cells that meet this cell first when going downstream
+  struct OutletCells
+  {
+    int label;
+    QVector<size_t> cells;
+    QVector<size_t> endsOfLongerPath;
+    QVector<double> longerPathLengths;
+  };
+
+  // the cells of the outlets are labelled first, so the propagation of each outlet stops on the other ones
+  QVector<OutletCells> outletsCells( outlets.count() );
+  for ( int i = 0; i < outlets.count(); ++i )
+  {
+    const ReosRasterLine &outlet = outlets.at( i );
+    outletsCells[i].label = i + 1;
+    for ( unsigned c = 0; c < outlet.cellCount(); ++c )
+    {
+      const ReosRasterCellPos cell = outlet.cellPosition( c );
+      if ( cell.row() < 0 || cell.row() >= rowCount || cell.column() < 0 || cell.column() >= columnCount )
+        continue;
+      const size_t index = static_cast<size_t>( cell.row() ) * columnCount + cell.column();
+      if ( labelsData[index] != 0 )
+        continue;
+      labelsData[index] = i + 1;
+      outletsCells[i].cells.append( index );
+      outletsCells[i].endsOfLongerPath.append( index );
+      outletsCells[i].longerPathLengths.append( 0 );
+    }
+  }
+
+  // a cell has only one downstream path, so the cells labelled by each outlet are different, outlets can be treated in parallel
+  QtConcurrent::blockingMap( outletsCells, [&]( OutletCells &outletCells )
+  {
+    // cells to treat with the length of the path to the first outlet cell met and the position of this cell in the outlet
+    struct CellToTreat
+    {
+      size_t index;
+      double length;
+      int outletCell;
+    };
+    std::vector<CellToTreat> cellsToTreat;
+    cellsToTreat.reserve( static_cast<size_t>( outletCells.cells.count() ) );
+    for ( int i = 0; i < outletCells.cells.count(); ++i )
+      cellsToTreat.push_back( {outletCells.cells.at( i ), 0.0, i} );
+
+    while ( !cellsToTreat.empty() )
+    {
+      const CellToTreat cell = cellsToTreat.back();
+      cellsToTreat.pop_back();
+      if ( cell.length > outletCells.longerPathLengths.at( cell.outletCell ) )
+      {
+        outletCells.longerPathLengths[cell.outletCell] = cell.length;
+        outletCells.endsOfLongerPath[cell.outletCell] = cell.index;
+      }
+      const size_t index = cell.index;
+      const int row = static_cast<int>( index / columnCount );
+      const int column = static_cast<int>( index % columnCount );
+
+      for ( int i = 0; i < 3; ++i )
+      {
+        const int r = row + i - 1;
+        if ( r < 0 || r >= rowCount )
+          continue;
+        for ( int j = 0; j < 3; ++j )
+        {
+          const int c = column + j - 1;
+          if ( ( i == 1 && j == 1 ) || c < 0 || c >= columnCount )
+            continue;
+          const size_t neighborIndex = static_cast<size_t>( r ) * columnCount + c;
+          const int direction = 8 - ( i + j * 3 );
+          if ( directions[neighborIndex] == direction && labelsData[neighborIndex] == 0 )
+          {
+            labelsData[neighborIndex] = outletCells.label;
+            cellsToTreat.push_back( {neighborIndex, cell.length + ( direction % 2 == 0 ? std::sqrt( 2.0 ) : 1.0 ), cell.outletCell} );
+          }
+        }
+      }
+    }
+  } );
+
+  if ( endsOfLongerPath )
+  {
+    // the path from an outlet cell goes downstream to the next outlet cell met, that can belong to an outlet downstream
+    struct OutletCellPos
+    {
+      int outlet;
+      int cell;
+    };
+    QHash<qint64, OutletCellPos> outletCellsPos;
+    for ( int i = 0; i < outletsCells.count(); ++i )
+      for ( int c = 0; c < outletsCells.at( i ).cells.count(); ++c )
+        outletCellsPos.insert( static_cast<qint64>( outletsCells.at( i ).cells.at( c ) ), {i, c} );
+
+    QHash<qint64, std::pair<OutletCellPos, double>> nextOutletCells;
+    for ( auto it = outletCellsPos.constBegin(); it != outletCellsPos.constEnd(); ++it )
+    {
+      size_t index = static_cast<size_t>( it.key() );
+      int row = static_cast<int>( index / columnCount );
+      int column = static_cast<int>( index % columnCount );
+      double length = 0;
+      // labelled cells lead to an outlet cell, the other ones do not flow in any outlet
+      while ( labelsData[index] != 0 )
+      {
+        const unsigned char direction = directions[index];
+        if ( !downstreamCell( direction, row, column, rowCount, columnCount ) )
+          break;
+        length += direction % 2 == 0 ? std::sqrt( 2.0 ) : 1.0;
+        index = static_cast<size_t>( row ) * columnCount + column;
+        auto next = outletCellsPos.constFind( static_cast<qint64>( index ) );
+        if ( next != outletCellsPos.constEnd() )
+        {
+          nextOutletCells.insert( it.key(), {next.value(), length} );
+          break;
+        }
+      }
+    }
+
+    // the longer path of an outlet is searched over the cells of all the outlets nested in it,
+    // so for each outlet cell, the path is followed downstream and proposed to each outlet met for the first time
+    QVector<double> longerPathLengths( outletsCells.count(), -1 );
+    endsOfLongerPath->fill( ReosRasterCellPos(), outletsCells.count() );
+    for ( int i = 0; i < outletsCells.count(); ++i )
+    {
+      const OutletCells &upstreamOutlet = outletsCells.at( i );
+      for ( int c = 0; c < upstreamOutlet.cells.count(); ++c )
+      {
+        const double upstreamLength = upstreamOutlet.longerPathLengths.at( c );
+        const size_t endOfPath = upstreamOutlet.endsOfLongerPath.at( c );
+
+        QSet<int> metOutlets;
+        OutletCellPos current = {i, c};
+        qint64 currentIndex = static_cast<qint64>( upstreamOutlet.cells.at( c ) );
+        double length = 0;
+        int stepCount = 0;
+        while ( true )
+        {
+          if ( !metOutlets.contains( current.outlet ) )
+          {
+            metOutlets.insert( current.outlet );
+            if ( upstreamLength + length > longerPathLengths.at( current.outlet ) )
+            {
+              longerPathLengths[current.outlet] = upstreamLength + length;
+              ( *endsOfLongerPath )[current.outlet] = ReosRasterCellPos( static_cast<int>( endOfPath / columnCount ),
+                                                      static_cast<int>( endOfPath % columnCount ) );
+            }
+          }
+          auto next = nextOutletCells.constFind( currentIndex );
+          // directions can't loop, but the guard avoids an infinite loop if they do
+          if ( next == nextOutletCells.constEnd() || ++stepCount > outletCellsPos.count() )
+            break;
+          current = next.value().first;
+          currentIndex = static_cast<qint64>( outletsCells.at( current.outlet ).cells.at( current.cell ) );
+          length += next.value().second;
+        }
+      }
+    }
+  }
+
+  return labels;
+}
+
+ReosRasterWatershed::Watershed ReosRasterFlowAccumulation::watershed( const ReosRasterLine &outlet ) const
+{
+  const ReosRasterMemory<int> labels = upstreamLabels( QVector<ReosRasterLine>() << outlet );
+
+  ReosRasterWatershed::Watershed watershed( labels.rowCount(), labels.columnCount() );
+  if ( !labels.isValid() || !watershed.reserveMemory() )
+    return watershed;
+
+  const int *labelsData = labels.constData();
+  unsigned char *watershedData = static_cast<unsigned char *>( watershed.data() );
+  const size_t cellCount = static_cast<size_t>( labels.rowCount() ) * labels.columnCount();
+  for ( size_t i = 0; i < cellCount; ++i )
+    watershedData[i] = labelsData[i] == 1 ? 1 : 0;
+
+  return watershed;
+}
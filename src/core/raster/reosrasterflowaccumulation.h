@@ -0,0 +1,113 @@
+/***************************************************************************
+  reosrasterflowaccumulation.h - ReosRasterFlowAccumulation
+
+ ---------------------
+ begin                : 16.5.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef REOSRASTERFLOWACCUMULATION_H
+#define REOSRASTERFLOWACCUMULATION_H
+
+#include <QPolygonF>
+#include <QVector>
+#include <QFuture>
+
+#include "reosprocess.h"
+#include "reosmemoryraster.h"
+#include "reosrasterline.h"
+#include "reosrasterwatershed.h"
+
+/**
+ * Class that calculates the flow accumulation of a direction raster, that is for each cell the count of cells
+ * that flow through it, the cell included.
+ *
+ * The accumulation is calculated once, in parallel, with a topological pass in O(n): the count of upstream neighbors
+ * of each cell is calculated first, then each thread starts from cells without upstream neighbors, adds the accumulation
+ * to the downstream cell and continues downstream only if the current cell was the last upstream neighbor to be treated.
+ *
+ * From the accumulation, the stream network can be extracted and outlets can be snapped on the streams.
+ * Delineating watersheds only needs the directions: the cells of any count of outlets are labelled at once
+ * by propagating upstream the label of each outlet.
+ *
+ * The values are processed in contiguous arrays, if the direction raster is tiled, a contiguous copy is made.
+ */
+class REOSCORE_EXPORT ReosRasterFlowAccumulation : public ReosProcess
+{
+  public:
+    //! A segment of the stream network, between a source or a confluence and the next confluence or the outlet
+    struct StreamSegment
+    {
+      //! Centers of the cells of the segment in map coordinates, the last one is the first one of the downstream segment
+      QPolygonF polyline;
+
+      //! Accumulation of the last cell of the segment
+      int accumulation = 0;
+
+      //! Index of the downstream segment, -1 if the segment ends at an outlet
+      int downstreamSegment = -1;
+    };
+
+    //! Constructor with the \a directions raster
+    explicit ReosRasterFlowAccumulation( const ReosRasterWatershed::Directions &directions );
+
+    void stop( bool b ) override;
+    int currentProgression() const override;
+    int maxProgression() const override;
+
+    //! Calculates the flow accumulation
+    void start() override;
+
+    //! Returns the accumulation raster, cells with no data have 0 that is the no data value
+    ReosRasterWatershed::Accumulation accumulation() const;
+
+    //! Returns the accumulation of the cell at \a row and \a column, 0 if no data or outside the raster
+    int accumulation( int row, int column ) const;
+
+    /**
+     * Returns the cell with the greatest accumulation in the square of \a radius cells around \a cell,
+     * if several cells have the same accumulation, the closest is returned.
+     */
+    ReosRasterCellPos snapOutlet( const ReosRasterCellPos &cell, int radius ) const;
+
+    /**
+     * Returns the stream network made of the cells with accumulation greater or equal than \a threshold,
+     * \a extent is used to convert cell positions to map coordinates.
+     */
+    QVector<StreamSegment> streamNetwork( int threshold, const ReosRasterExtent &extent ) const;
+
+    /**
+     * Returns a raster where each cell has the label of the first outlet met when going downstream from the cell.
+     * The label of the outlet at index i in \a outlets is i+1, cells that do not flow in any outlet have 0.
+     * The cells of the outlets have the label of their outlet, if a cell is shared by several outlets, the first one wins.
+     *
+     * If outlets are nested, the cells upstream of an outlet have the label of this outlet, not the one of the outlets downstream.
+     *
+     * If \a endsOfLongerPath is not nullptr, it is filled with, for each outlet, the cell with the longer flow path to the outlet.
+     * This cell is searched over the whole watershed of the outlet, including the cells labelled by the outlets nested in it,
+     * so it is the same as the one of the delineation of the outlet alone.
+     *
+     * \note does not need the accumulation to be calculated
+     */
+    ReosRasterMemory<int> upstreamLabels( const QVector<ReosRasterLine> &outlets, QVector<ReosRasterCellPos> *endsOfLongerPath = nullptr ) const;
+
+    //! Returns the raster watershed of the \a outlet, cells in the watershed have 1, others have 0
+    ReosRasterWatershed::Watershed watershed( const ReosRasterLine &outlet ) const;
+
+    //! Count of rows of each band processed by a task
+    static const int BAND_ROW_COUNT = 64;
+
+  private:
+    ReosRasterWatershed::Directions mDirections;
+    ReosRasterWatershed::Accumulation mAccumulation;
+    QFuture<void> mFuture;
+};
+
+#endif // REOSRASTERFLOWACCUMULATION_H
@@ -0,0 +1,306 @@
+/***************************************************************************
+                      reosrastertilestore.cpp
+                     --------------------------------------
+Date                 : 18-04-2022
+Copyright            : (C) 2022 by Vincent Cloarec
+email                : vcloarec@gmail.com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "reosrastertilestore.h"
+
+#include <cstring>
+#include <QDir>
+
+qint64 ReosRasterTileStore::sContiguousCellCountLimit = qint64( 1 ) << 29;
+
+ReosRasterTileStore::ReosRasterTileStore( int rowCount, int columnCount, int elementSize, int tileSize, int maxResidentTileCount, const QString &scratchDirectory )
+  : mRowCount( rowCount )
+  , mColumnCount( columnCount )
+  , mElementSize( elementSize )
+  , mTileSize( std::max( tileSize, 1 ) )
+  , mMaxResidentTileCount( std::max( maxResidentTileCount, 1 ) )
+  , mScratchDirectory( scratchDirectory )
+{
+  if ( rowCount <= 0 || columnCount <= 0 || elementSize <= 0 )
+    return;
+
+  mTileColumnCount = ( columnCount + mTileSize - 1 ) / mTileSize;
+  const int tileRowCount = ( rowCount + mTileSize - 1 ) / mTileSize;
+  mTileByteCount = qint64( mTileSize ) * mTileSize * elementSize;
+  mTileCount = tileRowCount * mTileColumnCount;
+  mTiles.reset( new Tile[mTileCount] );
+
+  const QString directory = scratchDirectory.isEmpty() ? QDir::tempPath() : scratchDirectory;
+  mFile.setFileTemplate( QDir( directory ).filePath( QStringLiteral( "reos_raster_XXXXXX.tiles" ) ) );
+  if ( !mFile.open() )
+    return;
+
+  // the file is sparse, the system only allocates the blocks that are written
+  mIsValid = mFile.resize( mTileByteCount * mTileCount );
+}
+
+ReosRasterTileStore::~ReosRasterTileStore()
+{
+  QMutexLocker locker( &mMutex );
+  for ( int tileIndex : mResidentTiles )
+    mFile.unmap( mTiles[tileIndex].data.load() );
+}
+
+bool ReosRasterTileStore::isValid() const
+{
+  return mIsValid;
+}
+
+int ReosRasterTileStore::rowCount() const
+{
+  return mRowCount;
+}
+
+int ReosRasterTileStore::columnCount() const
+{
+  return mColumnCount;
+}
+
+int ReosRasterTileStore::elementSize() const
+{
+  return mElementSize;
+}
+
+int ReosRasterTileStore::tileSize() const
+{
+  return mTileSize;
+}
+
+int ReosRasterTileStore::maxResidentTileCount() const
+{
+  return mMaxResidentTileCount;
+}
+
+int ReosRasterTileStore::residentTileCount() const
+{
+  QMutexLocker locker( &mMutex );
+  return static_cast<int>( mResidentTiles.size() );
+}
+
+void ReosRasterTileStore::read( int row, int column, void *value ) const
+{
+  const int index = tileIndex( row, column );
+  const uchar *data = acquireTile( index );
+  if ( data )
+  {
+    memcpy( value, data + offsetInTile( row, column ), mElementSize );
+    releaseTile( index );
+  }
+  else
+    memset( value, 0, mElementSize );
+}
+
+void ReosRasterTileStore::write( int row, int column, const void *value )
+{
+  const int index = tileIndex( row, column );
+  uchar *data = acquireTile( index );
+  if ( data )
+  {
+    memcpy( data + offsetInTile( row, column ), value, mElementSize );
+    releaseTile( index );
+  }
+}
+
+void ReosRasterTileStore::fill( const void *value )
+{
+  for ( int index = 0; index < mTileCount; ++index )
+  {
+    uchar *data = acquireTile( index );
+    if ( !data )
+      return;
+    for ( qint64 i = 0; i < mTileByteCount; i += mElementSize )
+      memcpy( data + i, value, mElementSize );
+    releaseTile( index );
+  }
+}
+
+void ReosRasterTileStore::readBlock( int row, int column, int blockRowCount, int blockColumnCount, void *buffer ) const
+{
+  uchar *out = static_cast<uchar *>( buffer );
+  for ( int r = 0; r < blockRowCount; ++r )
+  {
+    int c = 0;
+    while ( c < blockColumnCount )
+    {
+      // copy the part of the row that is in the same tile
+      const int tileColumnEnd = ( ( column + c ) / mTileSize + 1 ) * mTileSize;
+      const int count = std::min( blockColumnCount - c, tileColumnEnd - column - c );
+      const int index = tileIndex( row + r, column + c );
+      const uchar *data = acquireTile( index );
+      if ( data )
+      {
+        memcpy( out, data + offsetInTile( row + r, column + c ), static_cast<size_t>( count ) * mElementSize );
+        releaseTile( index );
+      }
+      out += static_cast<size_t>( count ) * mElementSize;
+      c += count;
+    }
+  }
+}
+
+void ReosRasterTileStore::writeBlock( int row, int column, int blockRowCount, int blockColumnCount, const void *buffer )
+{
+  const uchar *in = static_cast<const uchar *>( buffer );
+  for ( int r = 0; r < blockRowCount; ++r )
+  {
+    int c = 0;
+    while ( c < blockColumnCount )
+    {
+      const int tileColumnEnd = ( ( column + c ) / mTileSize + 1 ) * mTileSize;
+      const int count = std::min( blockColumnCount - c, tileColumnEnd - column - c );
+      const int index = tileIndex( row + r, column + c );
+      uchar *data = acquireTile( index );
+      if ( data )
+      {
+        memcpy( data + offsetInTile( row + r, column + c ), in, static_cast<size_t>( count ) * mElementSize );
+        releaseTile( index );
+      }
+      in += static_cast<size_t>( count ) * mElementSize;
+      c += count;
+    }
+  }
+}
+
+std::shared_ptr<ReosRasterTileStore> ReosRasterTileStore::clone() const
+{
+  std::shared_ptr<ReosRasterTileStore> other =
+    std::make_shared<ReosRasterTileStore>( mRowCount, mColumnCount, mElementSize, mTileSize, mMaxResidentTileCount, mScratchDirectory );
+
+  if ( !other->isValid() || !mIsValid )
+    return other;
+
+  for ( int index = 0; index < mTileCount; ++index )
+  {
+    const uchar *source = acquireTile( index );
+    uchar *destination = other->acquireTile( index );
+    if ( source && destination )
+      memcpy( destination, source, mTileByteCount );
+    else
+      other->mIsValid = false;
+
+    if ( source )
+      releaseTile( index );
+    if ( destination )
+      other->releaseTile( index );
+
+    if ( !other->mIsValid )
+      break;
+  }
+
+  return other;
+}
+
+qint64 ReosRasterTileStore::contiguousCellCountLimit()
+{
+  return sContiguousCellCountLimit;
+}
+
+void ReosRasterTileStore::setContiguousCellCountLimit( qint64 cellCount )
+{
+  sContiguousCellCountLimit = cellCount;
+}
+
+int ReosRasterTileStore::tileIndex( int row, int column ) const
+{
+  return ( row / mTileSize ) * mTileColumnCount + column / mTileSize;
+}
+
+qint64 ReosRasterTileStore::offsetInTile( int row, int column ) const
+{
+  return ( qint64( row % mTileSize ) * mTileSize + column % mTileSize ) * mElementSize;
+}
+
+uchar *ReosRasterTileStore::acquireTile( int tileIndex ) const
+{
+  if ( !mIsValid )
+    return nullptr;
+
+  Tile &tile = mTiles[tileIndex];
+
+  // the tile is pinned before reading its data, a tile is unmapped only if its data has been reset and it is not pinned,
+  // so if the data is not null here, it stays mapped until the tile is released
+  tile.pinCount.fetch_add( 1 );
+  uchar *data = tile.data.load();
+  if ( data )
+  {
+    tile.lastUse.store( mLoadCounter.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+    return data;
+  }
+  tile.pinCount.fetch_sub( 1 );
+
+  QMutexLocker locker( &mMutex );
+  return loadTile( tileIndex );
+}
+
+void ReosRasterTileStore::releaseTile( int tileIndex ) const
+{
+  mTiles[tileIndex].pinCount.fetch_sub( 1, std::memory_order_release );
+}
+
+uchar *ReosRasterTileStore::loadTile( int tileIndex ) const
+{
+  Tile &tile = mTiles[tileIndex];
+  const quint64 loadCount = ++mLoadCounter;
+
+  // the tile could have been mapped by another thread while waiting for the mutex
+  tile.pinCount.fetch_add( 1 );
+  if ( uchar *data = tile.data.load() )
+  {
+    tile.lastUse.store( loadCount, std::memory_order_relaxed );
+    return data;
+  }
+
+  while ( static_cast<int>( mResidentTiles.size() ) >= mMaxResidentTileCount )
+  {
+    // unmaps the least recently used tile that is not pinned, its data stays in the scratch file
+    int lruPosition = -1;
+    for ( size_t i = 0; i < mResidentTiles.size(); ++i )
+    {
+      const Tile &candidate = mTiles[mResidentTiles.at( i )];
+      if ( candidate.pinCount.load() > 0 )
+        continue;
+      if ( lruPosition < 0 || candidate.lastUse.load( std::memory_order_relaxed ) < mTiles[mResidentTiles.at( lruPosition )].lastUse.load( std::memory_order_relaxed ) )
+        lruPosition = static_cast<int>( i );
+    }
+
+    // all the tiles are in use by other threads, the count of mapped tiles exceeds temporarily the maximum
+    if ( lruPosition < 0 )
+      break;
+
+    Tile &lruTile = mTiles[mResidentTiles.at( lruPosition )];
+    uchar *lruData = lruTile.data.exchange( nullptr );
+    if ( lruTile.pinCount.load() > 0 )
+    {
+      // pinned between the search and the reset, the data could be in use, the tile stays mapped
+      lruTile.data.store( lruData );
+      continue;
+    }
+
+    mFile.unmap( lruData );
+    mResidentTiles[lruPosition] = mResidentTiles.back();
+    mResidentTiles.pop_back();
+  }
+
+  uchar *data = mFile.map( mTileByteCount * tileIndex, mTileByteCount );
+  if ( !data )
+  {
+    tile.pinCount.fetch_sub( 1 );
+    return nullptr;
+  }
+
+  mResidentTiles.push_back( tileIndex );
+  tile.lastUse.store( loadCount, std::memory_order_relaxed );
+  tile.data.store( data );
+  return data;
+}
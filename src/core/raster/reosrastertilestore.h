@@ -0,0 +1,142 @@
+/***************************************************************************
+                      reosrastertilestore.h
+                     --------------------------------------
+Date                 : 18-04-2022
+Copyright            : (C) 2022 by Vincent Cloarec
+email                : vcloarec@gmail.com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef REOSRASTERTILESTORE_H
+#define REOSRASTERTILESTORE_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <QMutex>
+#include <QTemporaryFile>
+
+#include "reoscore.h"
+
+/**
+ * Class that stores the values of a raster in square tiles written in a scratch file,
+ * only a limited count of tiles are mapped in memory at the same time, the least recently used tile is unmapped when another one is needed.
+ * Tiles are mapped with shared mapping, so unmapped tiles are written back in the scratch file by the system.
+ *
+ * Values are stored as raw bytes of size elementSize, there is no type information in this class.
+ * The store can be read and written from several threads. Accesses to a tile already mapped do not lock any mutex,
+ * the tile is only pinned during the access so that it cannot be unmapped, the mutex is locked only to map a tile.
+ */
+class REOSCORE_EXPORT ReosRasterTileStore
+{
+  public:
+
+    /**
+     * Constructor of a store for \a rowCount x \a columnCount elements of \a elementSize bytes, in square tiles of \a tileSize cells.
+     * At most \a maxResidentTileCount tiles are mapped in memory. The scratch file is created in \a scratchDirectory if not empty,
+     * in the temporary directory of the system otherwise. All values are initialized with null bytes.
+     */
+    ReosRasterTileStore( int rowCount, int columnCount, int elementSize,
+                         int tileSize = defaultTileSize(),
+                         int maxResidentTileCount = defaultMaxResidentTileCount(),
+                         const QString &scratchDirectory = QString() );
+
+    ~ReosRasterTileStore();
+
+    //! Returns whether the scratch file has been created with the necessary size
+    bool isValid() const;
+
+    int rowCount() const;
+    int columnCount() const;
+    int elementSize() const;
+
+    //! Returns the count of rows and columns of a tile
+    int tileSize() const;
+
+    //! Returns the maximum count of tiles mapped in memory at the same time
+    int maxResidentTileCount() const;
+
+    //! Returns the count of tiles currently mapped in memory
+    int residentTileCount() const;
+
+    //! Copies the element at \a row, \a column in \a value, position has to be valid
+    void read( int row, int column, void *value ) const;
+
+    //! Copies \a value in the element at \a row, \a column, position has to be valid
+    void write( int row, int column, const void *value );
+
+    //! Sets all the elements with \a value
+    void fill( const void *value );
+
+    //! Copies the elements of the block starting at \a row, \a column with \a blockRowCount rows and \a blockColumnCount columns in the contiguous \a buffer
+    void readBlock( int row, int column, int blockRowCount, int blockColumnCount, void *buffer ) const;
+
+    //! Copies the contiguous \a buffer in the elements of the block starting at \a row, \a column with \a blockRowCount rows and \a blockColumnCount columns
+    void writeBlock( int row, int column, int blockRowCount, int blockColumnCount, const void *buffer );
+
+    //! Returns a new store with a copy of all the elements, in a new scratch file
+    std::shared_ptr<ReosRasterTileStore> clone() const;
+
+    //! Returns the default count of rows and columns of tiles
+    static int defaultTileSize() {return 256;}
+
+    //! Returns the default maximum count of tiles mapped in memory at the same time
+    static int defaultMaxResidentTileCount() {return 1024;}
+
+    //! Returns the count of cells from which rasters extracted from DEM should be stored in tiles instead of in a contiguous array
+    static qint64 contiguousCellCountLimit();
+
+    //! Sets the count of cells from which rasters extracted from DEM should be stored in tiles instead of in a contiguous array
+    static void setContiguousCellCountLimit( qint64 cellCount );
+
+  private:
+    struct Tile
+    {
+      std::atomic<uchar *> data{nullptr};
+      std::atomic<int> pinCount{0};
+      std::atomic<quint64> lastUse{0};
+    };
+
+    int mRowCount = 0;
+    int mColumnCount = 0;
+    int mElementSize = 0;
+    int mTileSize = 0;
+    int mTileColumnCount = 0;
+    qint64 mTileByteCount = 0;
+    int mMaxResidentTileCount = 0;
+    bool mIsValid = false;
+    QString mScratchDirectory;
+
+    // protects the mapping and the unmapping of the tiles
+    mutable QMutex mMutex;
+    mutable QTemporaryFile mFile;
+    int mTileCount = 0;
+    std::unique_ptr<Tile[]> mTiles;
+    mutable std::vector<int> mResidentTiles;
+    mutable std::atomic<quint64> mLoadCounter{0};
+
+    //! Returns the index of the tile containing \a row and \a column
+    int tileIndex( int row, int column ) const;
+
+    //! Returns the offset in bytes of \a row and \a column in its tile
+    qint64 offsetInTile( int row, int column ) const;
+
+    //! Returns the data of the tile with index \a tileIndex pinned in memory, the tile is mapped if needed. The tile has to be released with releaseTile()
+    uchar *acquireTile( int tileIndex ) const;
+
+    //! Releases the tile with index \a tileIndex acquired with acquireTile()
+    void releaseTile( int tileIndex ) const;
+
+    //! Maps the tile with index \a tileIndex if needed and returns its data pinned in memory. Mutex has to be locked
+    uchar *loadTile( int tileIndex ) const;
+
+    static qint64 sContiguousCellCountLimit;
+};
+
+#endif // REOSRASTERTILESTORE_H
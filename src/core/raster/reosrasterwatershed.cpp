@@ -15,6 +15,9 @@ email                : vcloarec@gmail.com
 
 #include "reosrasterwatershed.h"
 
+#include <cmath>
+#include <vector>
+
 
 ReosRasterWatershedMarkerFromDirection::ReosRasterWatershedMarkerFromDirection( ReosRasterWatershedFromDirectionAndDownStreamLine *parent,
     const ReosRasterWatershed::Climber &initialClimb,
@@ -96,7 +99,10 @@ ReosRasterWatershedFromDirectionAndDownStreamLine::ReosRasterWatershedFromDirect
   mDirections( rasterDirection ), mDownstreamLine( line )
 {
   mWatershed = ReosRasterWatershed::Watershed( mDirections.rowCount(), mDirections.columnCount() );
-  mWatershed.reserveMemory();
+  if ( mDirections.isTiled() )
+    mWatershed.reserveTiledMemory();
+  else
+    mWatershed.reserveMemory();
   mWatershed.fill( 0 );
 
   for ( unsigned i = 0; i < mDownstreamLine.cellCount(); ++i )
@@ -308,7 +314,11 @@ QPolygonF ReosRasterWatershedTraceDownstream::resultPolyline() const
 
 ReosRasterWatershedDirectionCalculation::ReosRasterWatershedDirectionCalculation( const ReosRasterWatershed::Dem &dem ): mDem( dem )
 {
-  mDirections.reserveMemory( dem.rowCount(), dem.columnCount() );
+  mDirections = ReosRasterWatershed::Directions( dem.rowCount(), dem.columnCount() );
+  if ( dem.isTiled() )
+    mDirections.reserveTiledMemory();
+  else
+    mDirections.reserveMemory();
   mDirections.setNodata( 9 );
 }
 
@@ -331,32 +341,20 @@ int ReosRasterWatershedDirectionCalculation::maxProgression() const
 
 void ReosRasterWatershedDirectionCalculation::start()
 {
-  unsigned threadCount = static_cast<int>( maximumThreads() );
-
-  QVector<Job> jobs;
+  QVector<Band> bands;
   int totalRowsCount = mDirections.rowCount();
-  int rowPerJob;
 
-  if ( static_cast<int>( threadCount ) > totalRowsCount )
-    threadCount = totalRowsCount;
+  const float *demData = mDem.constData();
+  unsigned char *directionsData = static_cast<unsigned char *>( mDirections.data() );
 
-  if ( totalRowsCount % threadCount == 0 )
-    rowPerJob = totalRowsCount / threadCount;
-  else
+  bands.reserve( totalRowsCount / BAND_ROW_COUNT + 1 );
+  for ( int start = 0; start < totalRowsCount; start += BAND_ROW_COUNT )
   {
-    rowPerJob = totalRowsCount /  threadCount + 1;
-  }
-
-  for ( int t = 0; t < static_cast<int>( threadCount ); ++t )
-  {
-    int start = t * rowPerJob;
-    int end = std::min( ( t + 1 ) * rowPerJob - 1, totalRowsCount - 1 );
-
-    if ( end >= start )
-      jobs.append( Job( {start, end, &mDem, &mDirections} ) );
+    int end = std::min( start + BAND_ROW_COUNT - 1, totalRowsCount - 1 );
+    bands.append( Band( {start, end, &mDem, &mDirections, demData, directionsData} ) );
   }
 
-  mFuture = QtConcurrent::map( jobs, calculateDirection );
+  mFuture = QtConcurrent::map( bands, calculateBand );
 
   mFuture.waitForFinished();
 
@@ -364,48 +362,84 @@ void ReosRasterWatershedDirectionCalculation::start()
 
 }
 
-void ReosRasterWatershedDirectionCalculation::calculateDirection( ReosRasterWatershedDirectionCalculation::Job job )
+void ReosRasterWatershedDirectionCalculation::calculateBand( const ReosRasterWatershedDirectionCalculation::Band &band )
 {
-  for ( int row = job.startRow; row <= job.endRow; ++row )
+  const int rowCount = band.dem->rowCount();
+  const int columnCount = band.dem->columnCount();
+  const int paddedColumnCount = columnCount + 2;
+  const int bandRowCount = band.endRow - band.startRow + 1;
+
+  // values of the band with one halo row above and below and one halo column on each side, no data outside the raster
+  std::vector<float> paddedValues( static_cast<size_t>( bandRowCount + 2 ) * paddedColumnCount, band.dem->noData() );
+  const int firstRow = std::max( band.startRow - 1, 0 );
+  const int lastRow = std::min( band.endRow + 1, rowCount - 1 );
+
+  std::vector<float> tiledValues;
+  const float *values = band.demData;
+  if ( !values )
   {
-    for ( int column = 0; column < job.dem->columnCount(); ++column )
-    {
-      float centralValue = job.dem->value( row, column );
-      unsigned char retDir = 4;
-
-      if ( centralValue == job.dem->noData() )
-        retDir = 9;
-      else
-      {
-        float dzmin = 0;
-
-        for ( unsigned char i = 0; i < 3; ++i )
-          for ( unsigned char j = 0; j < 3; ++j )
-          {
-            if ( i == 1 && j == 1 )
-              continue;
+    tiledValues.resize( static_cast<size_t>( lastRow - firstRow + 1 ) * columnCount );
+    band.dem->readBlock( firstRow, 0, lastRow - firstRow + 1, columnCount, tiledValues.data() );
+    values = tiledValues.data() - static_cast<size_t>( firstRow ) * columnCount;
+  }
 
-            float z = job.dem->value( row - 1 + i, column - 1 + j );
+  for ( int r = firstRow; r <= lastRow; ++r )
+  {
+    const float *rowValues = values + static_cast<size_t>( r ) * columnCount;
+    std::copy( rowValues, rowValues + columnCount, paddedValues.data() + static_cast<size_t>( r - band.startRow + 1 ) * paddedColumnCount + 1 );
+  }
 
-            if ( z == job.dem->noData() )
-              continue;
+  std::vector<unsigned char> bandDirections;
+  unsigned char *directions = nullptr;
+  if ( band.directionsData )
+    directions = band.directionsData + static_cast<size_t>( band.startRow ) * columnCount;
+  else
+  {
+    bandDirections.resize( static_cast<size_t>( bandRowCount ) * columnCount );
+    directions = bandDirections.data();
+  }
 
-            float dz = ( z - centralValue );
+  for ( int r = 0; r < bandRowCount; ++r )
+  {
+    const float *row = paddedValues.data() + static_cast<size_t>( r + 1 ) * paddedColumnCount;
+    calculateRowDirections( row - paddedColumnCount, row, row + paddedColumnCount, columnCount, band.dem->noData(),
+                            directions + static_cast<size_t>( r ) * columnCount );
+  }
 
-            unsigned char dir = i + 3 * j;
+  if ( !band.directionsData )
+    band.directions->writeBlock( band.startRow, 0, bandRowCount, columnCount, bandDirections.data() );
+}
 
-            if ( dir % 2 == 0 )
-              dz = dz / sqrt( 2 );
+// Keeps the direction \a dir if the slope to the neighbor with value \a z is lower than \a dzMin, without branch
+static inline void keepLowerSlope( float central, float z, float noData, bool diagonal, unsigned char dir, float &dzMin, unsigned char &retDir )
+{
+  static const double SQRT_2 = std::sqrt( 2.0 );
+  const float dz = diagonal ? static_cast<float>( ( z - central ) / SQRT_2 ) : z - central;
+  const bool lower = ( z != noData ) & ( dz < dzMin );
+  dzMin = lower ? dz : dzMin;
+  retDir = lower ? dir : retDir;
+}
 
-            if ( dz < dzmin )
-            {
-              retDir = dir;
-              dzmin = dz;
-            }
-          }
-      }
-      job.directions->setValue( row, column, retDir );
-    }
+void ReosRasterWatershedDirectionCalculation::calculateRowDirections( const float *above, const float *row, const float *below, int columnCount, float noData, unsigned char *directions )
+{
+  // neighbors are treated in the same order than the cell by cell algorithm (direction = row offset + 3 * column offset),
+  // so equal slopes lead to the same direction. The loop has no branch, so the compiler can process several cells at once
+  for ( int c = 0; c < columnCount; ++c )
+  {
+    const float central = row[c + 1];
+    float dzMin = 0;
+    unsigned char retDir = 4;
+
+    keepLowerSlope( central, above[c], noData, true, 0, dzMin, retDir );
+    keepLowerSlope( central, above[c + 1], noData, false, 3, dzMin, retDir );
+    keepLowerSlope( central, above[c + 2], noData, true, 6, dzMin, retDir );
+    keepLowerSlope( central, row[c], noData, false, 1, dzMin, retDir );
+    keepLowerSlope( central, row[c + 2], noData, false, 7, dzMin, retDir );
+    keepLowerSlope( central, below[c], noData, true, 2, dzMin, retDir );
+    keepLowerSlope( central, below[c + 1], noData, false, 5, dzMin, retDir );
+    keepLowerSlope( central, below[c + 2], noData, true, 8, dzMin, retDir );
+
+    directions[c] = central == noData ? 9 : retDir;
   }
 }
 
@@ -34,6 +34,7 @@ namespace ReosRasterWatershed
   typedef ReosRasterMemory<unsigned char> Directions;
   typedef ReosRasterMemory<unsigned char> Watershed;
   typedef ReosRasterMemory<float> Dem;
+  typedef ReosRasterMemory<int> Accumulation;
 
   struct Climber
   {
@@ -60,15 +61,31 @@ class ReosRasterWatershedDirectionCalculation: public ReosProcess
 
     void start() override;
 
-    struct Job
+    /**
+     * Band of rows calculated by one task. The bands are small enough to be distributed dynamically on the threads.
+     * If the rasters are not tiled, the values are accessed directly with \a demData and \a directionsData
+     */
+    struct Band
     {
       int startRow;
       int endRow;
-      ReosRasterWatershed::Dem *dem;
+      const ReosRasterWatershed::Dem *dem;
       ReosRasterWatershed::Directions *directions;
+      const float *demData;
+      unsigned char *directionsData;
     };
 
-    static void calculateDirection( Job job );
+    //! Count of rows of each band
+    static const int BAND_ROW_COUNT = 32;
+
+    //! Calculates the directions of the cells of \a band
+    static void calculateBand( const Band &band );
+
+    /**
+     * Calculates the directions of the \a columnCount cells of a row from the values of the row and of its neighbor rows.
+     * The three arrays of values are padded with one value on each side.
+     */
+    static void calculateRowDirections( const float *above, const float *row, const float *below, int columnCount, float noData, unsigned char *directions );
 
     ReosRasterWatershed::Directions directions() const;
 
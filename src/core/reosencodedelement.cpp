@@ -69,6 +69,24 @@ QList<ReosEncodedElement> ReosEncodedElement::getListEncodedData( const QString
   return list;
 }
 
+ReosEncodedElement ReosEncodedElement::extractData( const QStringList &keys ) const
+{
+  ReosEncodedElement ret( mDescription );
+  for ( const QString &key : keys )
+  {
+    if ( mData.contains( key ) )
+      ret.mData[key] = mData[key];
+  }
+
+  return ret;
+}
+
+void ReosEncodedElement::copyData( const ReosEncodedElement &other )
+{
+  for ( auto it = other.mData.constBegin(); it != other.mData.constEnd(); ++it )
+    mData[it.key()] = it.value();
+}
+
 QByteArray ReosEncodedElement::bytes() const
 {
   QByteArray byteArray;
@@ -94,3 +112,8 @@ void ReosEncodedElement::setSerialisationVersion( QDataStream::Version version )
   sVersion = version;
 }
 
+QDataStream::Version ReosEncodedElement::serialisationVersion()
+{
+  return sVersion;
+}
+
@@ -19,6 +19,7 @@ email                : vcloarec@gmail.com
 #include <QByteArray>
 #include <QMap>
 #include <QString>
+#include <QStringList>
 #include <QDataStream>
 
 #include "reoscore.h"
@@ -75,6 +76,12 @@ class REOSCORE_EXPORT ReosEncodedElement
     void addListEncodedData( const QString &key, const QList<ReosEncodedElement> &list );
     QList<ReosEncodedElement> getListEncodedData( const QString &key ) const;
 
+    //! Returns a new element with the same description that contains only the data of this element with \a keys
+    ReosEncodedElement extractData( const QStringList &keys ) const;
+
+    //! Copies all the data of \a other in this element, data with same keys are replaced
+    void copyData( const ReosEncodedElement &other );
+
     //! Returns byte of the encoded element that can be store in files or in another encoded element
     QByteArray bytes() const;
 
@@ -83,6 +90,9 @@ class REOSCORE_EXPORT ReosEncodedElement
 
     static void setSerialisationVersion( QDataStream::Version version );
 
+    //! Returns the version of the data stream used to serialize data
+    static QDataStream::Version serialisationVersion();
+
 
   private:
     QMap<QString, QByteArray> mData;
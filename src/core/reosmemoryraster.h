@@ -17,6 +17,7 @@ email                : vcloarec@gmail.com
 #define REOSMEMORYRASTER_H
 
 #include <array>
+#include <memory>
 
 #include <QPoint>
 #include <QPointF>
@@ -27,6 +28,7 @@ email                : vcloarec@gmail.com
 #include <ogr_spatialref.h>
 
 #include "reosmapextent.h"
+#include "reosrastertilestore.h"
 
 class ReosRasterCellPos;
 
@@ -183,7 +185,12 @@ class REOSCORE_EXPORT ReosRasterCellPos
 
 
 /**
- * Class that stores a raster of type T in memory
+ * Class that stores a raster of type T in memory.
+ *
+ * By default, values are stored in a contiguous array. With reserveTiledMemory(), values are stored in tiles
+ * written in a scratch file (see ReosRasterTileStore) and only a limited count of tiles are mapped in memory,
+ * that allows to work on rasters that do not fit in memory with the same API, except data() that is not available.
+ * In both cases, copies of the raster share the data until one of them is modified.
  */
 template <typename T>
 class ReosRasterMemory
@@ -193,10 +200,25 @@ class ReosRasterMemory
     ReosRasterMemory() = default;
     //! Constructor with  \a nb_row, and \a nb_col, the row count and the column count, do not reserve memory
     ReosRasterMemory( int nb_row, int nb_col );
+    //! Copy constructor, the data are shared until one of the rasters is modified
+    ReosRasterMemory( const ReosRasterMemory<T> &other );
+    ReosRasterMemory( ReosRasterMemory<T> &&other ) = default;
+    ReosRasterMemory<T> &operator=( const ReosRasterMemory<T> &other );
+    ReosRasterMemory<T> &operator=( ReosRasterMemory<T> &&other ) = default;
     //! Reserves memory with dimension used in constructor, returns true if successful
     bool reserveMemory();
     //! Reserves memory with dimension \a nb_row and \a nb_col, returns true if successful
     bool reserveMemory( int nb_row, int nb_col );
+
+    /**
+     * Reserves memory with dimension used in constructor, values are stored in tiles of \a tileSize x \a tileSize cells in a scratch file,
+     * with at most \a maxResidentTileCount tiles mapped in memory. Returns true if successful
+     */
+    bool reserveTiledMemory( int tileSize = ReosRasterTileStore::defaultTileSize(),
+                             int maxResidentTileCount = ReosRasterTileStore::defaultMaxResidentTileCount() );
+
+    //! Returns whether the values are stored in tiles instead of in a contiguous array
+    bool isTiled() const {return mTileStore != nullptr;}
     //! Clears and frees memory
     bool freeMemory();
     //! Returns the value at position \a i,j
@@ -207,8 +229,14 @@ class ReosRasterMemory
     void setValue( int row, int col, T v );
     //! Sets the value at position \a cellPos
     void setValue( const ReosRasterCellPos &cellPos, T v );
-    //! Returns a void pointer to the data
+    //! Copies the values of the block starting at \a row, \a col with \a blockRowCount rows and \a blockColumnCount columns from the contiguous array \a values
+    void writeBlock( int row, int col, int blockRowCount, int blockColumnCount, const T *values );
+    //! Copies the values of the block starting at \a row, \a col with \a blockRowCount rows and \a blockColumnCount columns in the contiguous array \a values
+    void readBlock( int row, int col, int blockRowCount, int blockColumnCount, T *values ) const;
+    //! Returns a void pointer to the data, returns nullptr if the values are stored in tiles
     void *data();
+    //! Returns a pointer to the values without copying shared data, returns nullptr if the values are stored in tiles
+    const T *constData() const;
     //! Sets the value that is considered as no data
     void setNodata( T nd );
     //! Returns the value that is considered as no data
@@ -244,11 +272,36 @@ class ReosRasterMemory
     int mRowCount = 0;
     int mColumnCount = 0;;
     QVector<T> mValues;
+    // shared between copies until one of them is modified
+    std::shared_ptr<ReosRasterTileStore> mTileStore;
     T mNoData = std::numeric_limits<T>::quiet_NaN();
+
+    //! Makes a copy of the tile store if it is shared with another raster
+    void detachTileStore();
 };
 
 template<typename T>
-void *ReosRasterMemory<T>::data() {return mValues.data();}
+void *ReosRasterMemory<T>::data()
+{
+  if ( mTileStore )
+    return nullptr;
+  return mValues.data();
+}
+
+template<typename T>
+const T *ReosRasterMemory<T>::constData() const
+{
+  if ( mTileStore )
+    return nullptr;
+  return mValues.constData();
+}
+
+template<typename T>
+void ReosRasterMemory<T>::detachTileStore()
+{
+  if ( mTileStore && mTileStore.use_count() > 1 )
+    mTileStore = mTileStore->clone();
+}
 
 template<typename T>
 void ReosRasterMemory<T>::setNodata( T nd ) {mNoData = nd;}
@@ -264,12 +317,37 @@ ReosRasterMemory<T>::ReosRasterMemory( int nb_row, int nb_col ):
 
 }
 
+template<typename T>
+ReosRasterMemory<T>::ReosRasterMemory( const ReosRasterMemory<T> &other )
+  : mRowCount( other.mRowCount )
+  , mColumnCount( other.mColumnCount )
+  , mValues( other.mValues )
+  , mTileStore( other.mTileStore )
+  , mNoData( other.mNoData )
+{
+}
+
+template<typename T>
+ReosRasterMemory<T> &ReosRasterMemory<T>::operator=( const ReosRasterMemory<T> &other )
+{
+  if ( this == &other )
+    return *this;
+
+  mRowCount = other.mRowCount;
+  mColumnCount = other.mColumnCount;
+  mValues = other.mValues;
+  mTileStore = other.mTileStore;
+  mNoData = other.mNoData;
+  return *this;
+}
+
 template<typename T>
 bool ReosRasterMemory<T>::reserveMemory()
 {
   if ( mRowCount * mColumnCount == 0 )
     return false;
 
+  mTileStore.reset();
   mValues.clear();
   try
   {
@@ -290,10 +368,28 @@ bool ReosRasterMemory<T>::reserveMemory( int nb_row, int nb_col )
   return reserveMemory();
 }
 
+template<typename T>
+bool ReosRasterMemory<T>::reserveTiledMemory( int tileSize, int maxResidentTileCount )
+{
+  if ( mRowCount <= 0 || mColumnCount <= 0 )
+    return false;
+
+  mValues.clear();
+  mTileStore = std::make_shared<ReosRasterTileStore>( mRowCount, mColumnCount, int( sizeof( T ) ), tileSize, maxResidentTileCount );
+  if ( !mTileStore->isValid() )
+  {
+    mTileStore.reset();
+    return false;
+  }
+
+  return true;
+}
+
 template<typename T>
 bool ReosRasterMemory<T>::freeMemory()
 {
   mValues.clear();
+  mTileStore.reset();
   return true;
 }
 
@@ -303,6 +399,13 @@ T ReosRasterMemory<T>::value( int row, int col ) const
   if ( ( row < 0 ) || ( row >= mRowCount ) || ( col < 0 ) || ( col >= mColumnCount ) )
     return noData();
 
+  if ( mTileStore )
+  {
+    T v;
+    mTileStore->read( row, col, &v );
+    return v;
+  }
+
   return mValues.at( row * mColumnCount + col );
 }
 
@@ -317,7 +420,15 @@ template<typename T>
 void ReosRasterMemory<T>::setValue( int row, int col, T v )
 {
   if ( ( row < mRowCount ) && ( col < mColumnCount ) && ( row >= 0 ) && ( col >= 0 ) )
-    mValues[row * mColumnCount  + col] = v;
+  {
+    if ( mTileStore )
+    {
+      detachTileStore();
+      mTileStore->write( row, col, &v );
+    }
+    else
+      mValues[row * mColumnCount  + col] = v;
+  }
 }
 
 template<typename T>
@@ -326,9 +437,52 @@ void ReosRasterMemory<T>::setValue( const ReosRasterCellPos &cellPos, T v )
   setValue( cellPos.row(), cellPos.column(), v );
 }
 
+template<typename T>
+void ReosRasterMemory<T>::writeBlock( int row, int col, int blockRowCount, int blockColumnCount, const T *values )
+{
+  if ( row < 0 || col < 0 || row + blockRowCount > mRowCount || col + blockColumnCount > mColumnCount )
+    return;
+
+  if ( mTileStore )
+  {
+    detachTileStore();
+    mTileStore->writeBlock( row, col, blockRowCount, blockColumnCount, values );
+    return;
+  }
+
+  for ( int r = 0; r < blockRowCount; ++r )
+    std::copy( values + r * blockColumnCount, values + ( r + 1 ) * blockColumnCount, mValues.begin() + ( row + r ) * mColumnCount + col );
+}
+
+template<typename T>
+void ReosRasterMemory<T>::readBlock( int row, int col, int blockRowCount, int blockColumnCount, T *values ) const
+{
+  if ( row < 0 || col < 0 || row + blockRowCount > mRowCount || col + blockColumnCount > mColumnCount )
+    return;
+
+  if ( mTileStore )
+  {
+    mTileStore->readBlock( row, col, blockRowCount, blockColumnCount, values );
+    return;
+  }
+
+  for ( int r = 0; r < blockRowCount; ++r )
+  {
+    const T *rowStart = mValues.constData() + ( row + r ) * mColumnCount + col;
+    std::copy( rowStart, rowStart + blockColumnCount, values + r * blockColumnCount );
+  }
+}
+
 template<typename T>
 void ReosRasterMemory<T>::fill( T val )
 {
+  if ( mTileStore )
+  {
+    detachTileStore();
+    mTileStore->fill( &val );
+    return;
+  }
+
   for ( int i = 0; i < mRowCount; ++i )
     for ( int j = 0; j < mColumnCount; ++j )
       setValue( i, j, val );
@@ -370,9 +524,28 @@ bool ReosRasterMemory<T>::createTiffFile( const char *fileName, GDALDataType typ
 
   GDALDataset *dataSet = driver->Create( fileName, mColumnCount, mRowCount, 1, type, nullptr );
 
-  CPLErr err = dataSet->GetRasterBand( 1 )->RasterIO( GF_Write, 0, 0, mColumnCount, mRowCount, mValues.data(), mColumnCount, mRowCount, type, 0, 0 );
-  if ( err )
-    return false;
+  if ( mTileStore )
+  {
+    // written by blocks of tile size to avoid loading all the raster in memory
+    const int blockSize = mTileStore->tileSize();
+    std::vector<T> buffer( static_cast<size_t>( blockSize ) * blockSize );
+    for ( int row = 0; row < mRowCount; row += blockSize )
+      for ( int col = 0; col < mColumnCount; col += blockSize )
+      {
+        const int blockRowCount = std::min( blockSize, mRowCount - row );
+        const int blockColumnCount = std::min( blockSize, mColumnCount - col );
+        mTileStore->readBlock( row, col, blockRowCount, blockColumnCount, buffer.data() );
+        CPLErr err = dataSet->GetRasterBand( 1 )->RasterIO( GF_Write, col, row, blockColumnCount, blockRowCount, buffer.data(), blockColumnCount, blockRowCount, type, 0, 0 );
+        if ( err )
+          return false;
+      }
+  }
+  else
+  {
+    CPLErr err = dataSet->GetRasterBand( 1 )->RasterIO( GF_Write, 0, 0, mColumnCount, mRowCount, mValues.data(), mColumnCount, mRowCount, type, 0, 0 );
+    if ( err )
+      return false;
+  }
 
   dataSet->GetRasterBand( 1 )->SetNoDataValue( mNoData );
 
@@ -410,6 +583,7 @@ bool ReosRasterMemory<T>::copy( ReosRasterMemory<T> *other )
   try
   {
     mValues = other->mValues;
+    mTileStore = other->mTileStore;
     return true;
   }
   catch ( std::bad_alloc &e )
@@ -459,6 +633,9 @@ bool ReosRasterMemory<T>::operator==( const ReosRasterMemory<T> &rhs ) const
 template<typename T>
 bool ReosRasterMemory<T>::isValid() const
 {
+  if ( mTileStore )
+    return true;
+
   return !mValues.empty() && mValues.size() == mRowCount * mColumnCount;
 }
 
@@ -0,0 +1,393 @@
+/***************************************************************************
+  reosprojectcontainer.cpp - ReosProjectContainer
+
+ ---------------------
+ begin                : 19.5.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "reosprojectcontainer.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#define PROJECT_CONTAINER_MAGIC_NUMBER 20220519
+#define PROJECT_CONTAINER_FORMAT_VERSION 1
+
+// the structure of the container is always written with the same version, independently of the data of the sections
+static const QDataStream::Version CONTAINER_STREAM_VERSION = QDataStream::Qt_5_12;
+
+bool ReosProjectContainer::isProjectContainer( const QString &filePath )
+{
+  QFile file( filePath );
+  if ( !file.open( QIODevice::ReadOnly ) )
+    return false;
+
+  QDataStream stream( &file );
+  stream.setVersion( CONTAINER_STREAM_VERSION );
+  qint32 magicNumber = 0;
+  stream >> magicNumber;
+
+  return stream.status() == QDataStream::Ok && magicNumber == PROJECT_CONTAINER_MAGIC_NUMBER;
+}
+
+bool ReosProjectContainer::open( const QString &filePath )
+{
+  clear();
+
+  QFile file( filePath );
+  if ( !file.open( QIODevice::ReadOnly ) )
+    return false;
+
+  QDataStream stream( &file );
+  stream.setVersion( CONTAINER_STREAM_VERSION );
+
+  qint32 magicNumber = 0;
+  qint32 formatVersion = 0;
+  qint32 serialisationVersion = 0;
+  stream >> magicNumber;
+  if ( magicNumber != PROJECT_CONTAINER_MAGIC_NUMBER )
+    return false;
+
+  stream >> formatVersion;
+  if ( formatVersion > PROJECT_CONTAINER_FORMAT_VERSION )
+    return false;
+
+  stream >> serialisationVersion;
+  QByteArray header;
+  stream >> header;
+
+  const qint64 tocPositionOffset = file.pos();
+  qint64 tocOffset = 0;
+  stream >> tocOffset;
+  if ( stream.status() != QDataStream::Ok || tocOffset <= tocPositionOffset || !file.seek( tocOffset ) )
+    return false;
+
+  QMap<QString, Section> sections;
+  qint32 sectionCount = 0;
+  stream >> sectionCount;
+  for ( qint32 i = 0; i < sectionCount && stream.status() == QDataStream::Ok; ++i )
+  {
+    QString key;
+    Section section;
+    stream >> key >> section.offset >> section.size >> section.compressed >> section.hash;
+    sections.insert( key, section );
+  }
+
+  if ( stream.status() != QDataStream::Ok )
+    return false;
+
+  QMutexLocker locker( &mMutex );
+  mFilePath = filePath;
+  mHeader = header;
+  mSerialisationVersion = static_cast<QDataStream::Version>( serialisationVersion );
+  mSections = sections;
+  mTocPositionOffset = tocPositionOffset;
+  mFileSize = file.size();
+
+  return true;
+}
+
+QString ReosProjectContainer::filePath() const
+{
+  QMutexLocker locker( &mMutex );
+  return mFilePath;
+}
+
+QByteArray ReosProjectContainer::header() const
+{
+  QMutexLocker locker( &mMutex );
+  return mHeader;
+}
+
+void ReosProjectContainer::setHeader( const QByteArray &header )
+{
+  QMutexLocker locker( &mMutex );
+  if ( header == mHeader )
+    return;
+  mHeader = header;
+  mHeaderChanged = true;
+}
+
+QDataStream::Version ReosProjectContainer::serialisationVersion() const
+{
+  QMutexLocker locker( &mMutex );
+  return mSerialisationVersion;
+}
+
+void ReosProjectContainer::setSerialisationVersion( QDataStream::Version version )
+{
+  QMutexLocker locker( &mMutex );
+  if ( version == mSerialisationVersion )
+    return;
+  mSerialisationVersion = version;
+  mHeaderChanged = true;
+}
+
+QStringList ReosProjectContainer::sectionKeys() const
+{
+  QMutexLocker locker( &mMutex );
+  return mSections.keys();
+}
+
+bool ReosProjectContainer::hasSection( const QString &key ) const
+{
+  QMutexLocker locker( &mMutex );
+  return mSections.contains( key );
+}
+
+QByteArray ReosProjectContainer::section( const QString &key ) const
+{
+  QMutexLocker locker( &mMutex );
+  auto it = mSections.constFind( key );
+  if ( it == mSections.constEnd() )
+    return QByteArray();
+
+  const QByteArray data = storedData( it.value() );
+  if ( it->compressed )
+    return qUncompress( data );
+
+  return data;
+}
+
+ReosEncodedElement ReosProjectContainer::encodedSection( const QString &key ) const
+{
+  const QByteArray data = section( key );
+  if ( data.isEmpty() )
+    return ReosEncodedElement( QStringLiteral( "invalid" ) );
+
+  return ReosEncodedElement( data );
+}
+
+bool ReosProjectContainer::setSection( const QString &key, const QByteArray &data, bool compress )
+{
+  const QByteArray hash = QCryptographicHash::hash( data, QCryptographicHash::Sha1 );
+
+  QMutexLocker locker( &mMutex );
+  auto it = mSections.find( key );
+  if ( it != mSections.end() && it->hash == hash )
+    return false;
+
+  Section section;
+  section.hash = hash;
+  section.dirty = true;
+  section.pendingData = data;
+  if ( compress )
+  {
+    const QByteArray compressed = qCompress( data );
+    if ( compressed.size() < data.size() )
+    {
+      section.pendingData = compressed;
+      section.compressed = true;
+    }
+  }
+  section.size = section.pendingData.size();
+
+  mSections.insert( key, section );
+  return true;
+}
+
+bool ReosProjectContainer::setEncodedSection( const QString &key, const ReosEncodedElement &element, bool compress )
+{
+  return setSection( key, element.bytes(), compress );
+}
+
+void ReosProjectContainer::removeSection( const QString &key )
+{
+  QMutexLocker locker( &mMutex );
+  if ( mSections.remove( key ) > 0 )
+    mStructureChanged = true;
+}
+
+bool ReosProjectContainer::isDirty() const
+{
+  QMutexLocker locker( &mMutex );
+  return hasChanges();
+}
+
+bool ReosProjectContainer::hasChanges() const
+{
+  if ( mStructureChanged || mHeaderChanged )
+    return true;
+
+  for ( const Section &section : mSections )
+    if ( section.dirty )
+      return true;
+
+  return false;
+}
+
+bool ReosProjectContainer::save( const QString &filePath )
+{
+  QMutexLocker locker( &mMutex );
+  const bool sameFile = !mFilePath.isEmpty() &&
+                        QFileInfo( filePath ).absoluteFilePath() == QFileInfo( mFilePath ).absoluteFilePath() &&
+                        QFileInfo::exists( mFilePath );
+
+  if ( sameFile && !hasChanges() )
+    return true;
+
+  bool incremental = false;
+  if ( sameFile && !mHeaderChanged )
+  {
+    qint64 usedSize = 0;
+    qint64 dirtySize = 0;
+    for ( const Section &section : std::as_const( mSections ) )
+    {
+      usedSize += section.size;
+      if ( section.dirty )
+        dirtySize += section.size;
+    }
+
+    // obsolete sections are not removed by an incremental save, if they take more space than the used one, the file is rewritten
+    const qint64 obsoleteSize = mFileSize + dirtySize - usedSize - mTocPositionOffset;
+    incremental = obsoleteSize <= usedSize;
+  }
+
+  if ( incremental )
+    return saveIncrementally();
+
+  return saveAll( filePath );
+}
+
+void ReosProjectContainer::clear()
+{
+  QMutexLocker locker( &mMutex );
+  mFilePath.clear();
+  mHeader.clear();
+  mHeaderChanged = false;
+  mSerialisationVersion = QDataStream::Qt_DefaultCompiledVersion;
+  mSections.clear();
+  mStructureChanged = false;
+  mTocPositionOffset = 0;
+  mFileSize = 0;
+}
+
+QByteArray ReosProjectContainer::storedData( const ReosProjectContainer::Section &section ) const
+{
+  if ( section.dirty )
+    return section.pendingData;
+
+  QFile file( mFilePath );
+  if ( section.offset < 0 || !file.open( QIODevice::ReadOnly ) || !file.seek( section.offset ) )
+    return QByteArray();
+
+  return file.read( section.size );
+}
+
+bool ReosProjectContainer::saveIncrementally()
+{
+  QFile file( mFilePath );
+  if ( !file.open( QIODevice::ReadWrite ) )
+    return false;
+
+  if ( !file.seek( file.size() ) )
+    return false;
+
+  // changed sections and the new table of contents are written after the existing data,
+  // so the file stays valid with the previous table of contents until its position is updated
+  QMap<QString, Section> sections = mSections;
+  for ( auto it = sections.begin(); it != sections.end(); ++it )
+  {
+    if ( !it->dirty )
+      continue;
+
+    it->offset = file.pos();
+    if ( file.write( it->pendingData ) != it->pendingData.size() )
+      return false;
+    it->pendingData.clear();
+    it->dirty = false;
+  }
+
+  QDataStream stream( &file );
+  stream.setVersion( CONTAINER_STREAM_VERSION );
+
+  const qint64 tocOffset = file.pos();
+  writeTableOfContents( stream, sections );
+  if ( stream.status() != QDataStream::Ok || !file.flush() )
+    return false;
+
+  if ( !file.seek( mTocPositionOffset ) )
+    return false;
+  stream << tocOffset;
+  if ( stream.status() != QDataStream::Ok || !file.flush() )
+    return false;
+
+  mSections = sections;
+  mStructureChanged = false;
+  mFileSize = file.size();
+
+  return true;
+}
+
+bool ReosProjectContainer::saveAll( const QString &filePath )
+{
+  QSaveFile file( filePath );
+  if ( !file.open( QIODevice::WriteOnly ) )
+    return false;
+
+  QDataStream stream( &file );
+  stream.setVersion( CONTAINER_STREAM_VERSION );
+
+  stream << qint32( PROJECT_CONTAINER_MAGIC_NUMBER );
+  stream << qint32( PROJECT_CONTAINER_FORMAT_VERSION );
+  stream << qint32( mSerialisationVersion );
+  stream << mHeader;
+
+  const qint64 tocPositionOffset = file.pos();
+  stream << qint64( 0 );
+
+  QMap<QString, Section> sections = mSections;
+  for ( auto it = sections.begin(); it != sections.end(); ++it )
+  {
+    const QByteArray data = storedData( it.value() );
+    if ( data.size() != it->size )
+    {
+      file.cancelWriting();
+      return false;
+    }
+
+    it->offset = file.pos();
+    if ( file.write( data ) != data.size() )
+    {
+      file.cancelWriting();
+      return false;
+    }
+    it->pendingData.clear();
+    it->dirty = false;
+  }
+
+  const qint64 tocOffset = file.pos();
+  writeTableOfContents( stream, sections );
+
+  file.seek( tocPositionOffset );
+  stream << tocOffset;
+
+  if ( stream.status() != QDataStream::Ok || !file.commit() )
+    return false;
+
+  mFilePath = filePath;
+  mSections = sections;
+  mHeaderChanged = false;
+  mStructureChanged = false;
+  mTocPositionOffset = tocPositionOffset;
+  mFileSize = QFileInfo( filePath ).size();
+
+  return true;
+}
+
+void ReosProjectContainer::writeTableOfContents( QDataStream &stream, const QMap<QString, Section> &sections )
+{
+  stream << qint32( sections.count() );
+  for ( auto it = sections.constBegin(); it != sections.constEnd(); ++it )
+    stream << it.key() << it->offset << it->size << it->compressed << it->hash;
+}
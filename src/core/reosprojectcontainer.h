@@ -0,0 +1,148 @@
+/***************************************************************************
+  reosprojectcontainer.h - ReosProjectContainer
+
+ ---------------------
+ begin                : 19.5.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef REOSPROJECTCONTAINER_H
+#define REOSPROJECTCONTAINER_H
+
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QDataStream>
+
+#include "reoscore.h"
+#include "reosencodedelement.h"
+
+/**
+ * Class that stores a project in a file made of independent sections, each section being a byte array identified by a key.
+ *
+ * The file starts with a header followed by the position of the table of contents, the table of contents contains,
+ * for each section, its position and its size in the file, whether it is compressed and a hash of its content.
+ *
+ * When a file is opened, only the header and the table of contents are read, the sections are read from the file
+ * when they are requested. When the container is saved in the file it was opened from, only the sections that have
+ * changed are written at the end of the file, followed by a new table of contents, and the position of the table of contents
+ * is updated at last. If the space used by obsolete sections becomes too large, the whole file is rewritten.
+ */
+class REOSCORE_EXPORT ReosProjectContainer
+{
+  public:
+    //! Constructor of an empty container
+    ReosProjectContainer() = default;
+
+    //! Returns whether the file with \a filePath is a project container
+    static bool isProjectContainer( const QString &filePath );
+
+    /**
+     * Opens the container stored in \a filePath, reads only the header and the table of contents.
+     * Returns false if the file can't be read or is not a project container.
+     */
+    bool open( const QString &filePath );
+
+    //! Returns the path of the file the container was opened from or saved to, empty if none
+    QString filePath() const;
+
+    //! Returns the header of the container
+    QByteArray header() const;
+
+    //! Sets the \a header of the container
+    void setHeader( const QByteArray &header );
+
+    //! Returns the serialisation version of the data stored in the sections
+    QDataStream::Version serialisationVersion() const;
+
+    //! Sets the serialisation version of the data stored in the sections
+    void setSerialisationVersion( QDataStream::Version version );
+
+    //! Returns the keys of the sections
+    QStringList sectionKeys() const;
+
+    //! Returns whether the container has a section with \a key
+    bool hasSection( const QString &key ) const;
+
+    //! Returns the content of the section with \a key, read from the file if needed, returns an empty array if not present
+    QByteArray section( const QString &key ) const;
+
+    //! Returns the content of the section with \a key as an encoded element
+    ReosEncodedElement encodedSection( const QString &key ) const;
+
+    /**
+     * Sets the content of the section with \a key. If the content is the same as the existing one, the section stays unchanged
+     * and won't be written on next save. If \a compress is true, the content is stored compressed if it makes it smaller.
+     * Returns whether the section has changed.
+     */
+    bool setSection( const QString &key, const QByteArray &data, bool compress = true );
+
+    //! Sets the content of the section with \a key from an encoded \a element, see setSection()
+    bool setEncodedSection( const QString &key, const ReosEncodedElement &element, bool compress = true );
+
+    //! Removes the section with \a key
+    void removeSection( const QString &key );
+
+    //! Returns whether some sections have changed since the container was opened or saved
+    bool isDirty() const;
+
+    /**
+     * Saves the container in \a filePath. If \a filePath is the file the container comes from, only the changed sections are written.
+     * Returns whether the saving is successful.
+     */
+    bool save( const QString &filePath );
+
+    //! Removes all the sections and forgets the file
+    void clear();
+
+  private:
+    struct Section
+    {
+      qint64 offset = -1;
+      qint64 size = 0;
+      bool compressed = false;
+      QByteArray hash;
+
+      //! Stored content of the section not written yet in the file
+      QByteArray pendingData;
+      bool dirty = false;
+    };
+
+    QString mFilePath;
+    QByteArray mHeader;
+    bool mHeaderChanged = false;
+    QDataStream::Version mSerialisationVersion = QDataStream::Qt_DefaultCompiledVersion;
+    QMap<QString, Section> mSections;
+    bool mStructureChanged = false;
+
+    //! Position in the file of the position of the table of contents
+    qint64 mTocPositionOffset = 0;
+    //! Size of the file when it was opened or saved
+    qint64 mFileSize = 0;
+
+    mutable QMutex mMutex;
+
+    //! Returns the stored content, possibly compressed, of \a section. Mutex has to be locked
+    QByteArray storedData( const Section &section ) const;
+
+    //! Returns whether some sections have changed. Mutex has to be locked
+    bool hasChanges() const;
+
+    //! Writes the changed sections at the end of the file. Mutex has to be locked
+    bool saveIncrementally();
+
+    //! Writes the whole container in \a filePath. Mutex has to be locked
+    bool saveAll( const QString &filePath );
+    static void writeTableOfContents( QDataStream &stream, const QMap<QString, Section> &sections );
+};
+
+#endif // REOSPROJECTCONTAINER_H
@@ -0,0 +1,288 @@
+/***************************************************************************
+  reosdirectionrasterstore.cpp - ReosDirectionRasterStore
+
+ ---------------------
+ begin                : 18.5.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "reosdirectionrasterstore.h"
+
+#include <cmath>
+
+ReosDirectionRasterStore::Entry::Entry( const QString &layerId, const ReosRasterExtent &extent, const ReosRasterByteTiledCompressed &directions ):
+  mLayerId( layerId )
+  , mExtent( extent )
+  , mDirections( directions )
+{}
+
+ReosDirectionRasterStore::Entry::Entry( const QString &layerId, const ReosRasterExtent &extent, const std::function<ReosRasterByteTiledCompressed()> &loader ):
+  mLayerId( layerId )
+  , mExtent( extent )
+  , mLoader( loader )
+{}
+
+const ReosRasterByteTiledCompressed &ReosDirectionRasterStore::Entry::directions() const
+{
+  QMutexLocker locker( &mMutex );
+  if ( mLoader )
+  {
+    mDirections = mLoader();
+    mLoader = nullptr;
+  }
+
+  return mDirections;
+}
+
+bool ReosDirectionRasterStore::Entry::isLoaded() const
+{
+  QMutexLocker locker( &mMutex );
+  return !mLoader;
+}
+
+ReosDirectionRasterStore::EntryPtr ReosDirectionRasterStore::createEntry( const QString &layerId, const ReosRasterExtent &extent, const ReosRasterWatershed::Directions &directions )
+{
+  return std::make_shared<const Entry>( layerId, extent, ReosRasterByteTiledCompressed( directions ) );
+}
+
+ReosRasterWatershed::Directions ReosDirectionRasterStore::directions( const ReosDirectionRasterStore::EntryPtr &entry, const ReosRasterExtent &windowExtent )
+{
+  if ( !entry )
+    return ReosRasterWatershed::Directions();
+
+  if ( entry->extent() == windowExtent )
+    return entry->directions().uncompressRaster();
+
+  int rowOffset = 0;
+  int columnOffset = 0;
+  if ( !windowPosition( entry->extent(), windowExtent, rowOffset, columnOffset ) )
+    return ReosRasterWatershed::Directions();
+
+  return entry->directions().uncompressBlock( rowOffset, columnOffset, windowExtent.yCellCount(), windowExtent.xCellCount(), 9 );
+}
+
+ReosDirectionRasterStore::EntryPtr ReosDirectionRasterStore::share( const ReosDirectionRasterStore::EntryPtr &entry )
+{
+  if ( !entry )
+    return entry;
+
+  for ( const EntryPtr &existing : std::as_const( mEntries ) )
+  {
+    if ( existing == entry )
+      return existing;
+  }
+
+  for ( const EntryPtr &existing : std::as_const( mEntries ) )
+  {
+    if ( covers( *existing, *entry ) )
+      return existing;
+  }
+
+  int i = 0;
+  while ( i < mEntries.count() )
+  {
+    if ( covers( *entry, *mEntries.at( i ) ) )
+      mEntries.removeAt( i );
+    else
+      ++i;
+  }
+
+  mEntries.append( entry );
+  mHasChanged = true;
+  return entry;
+}
+
+int ReosDirectionRasterStore::entryCount() const
+{
+  return mEntries.count();
+}
+
+ReosDirectionRasterStore::EntryPtr ReosDirectionRasterStore::entry( int index ) const
+{
+  return mEntries.value( index );
+}
+
+int ReosDirectionRasterStore::indexOf( const ReosDirectionRasterStore::EntryPtr &entry ) const
+{
+  return mEntries.indexOf( entry );
+}
+
+void ReosDirectionRasterStore::purge()
+{
+  int i = 0;
+  while ( i < mEntries.count() )
+  {
+    if ( mEntries.at( i ).use_count() == 1 )
+    {
+      mEntries.removeAt( i );
+      mHasChanged = true;
+    }
+    else
+      ++i;
+  }
+}
+
+void ReosDirectionRasterStore::clear()
+{
+  mEntries.clear();
+  mHasChanged = false;
+}
+
+bool ReosDirectionRasterStore::hasChanged() const
+{
+  return mHasChanged;
+}
+
+ReosEncodedElement ReosDirectionRasterStore::encode( bool withDirections ) const
+{
+  QList<QString> layerIds;
+  QList<QByteArray> extents;
+
+  for ( const EntryPtr &entry : mEntries )
+  {
+    layerIds.append( entry->layerId() );
+    extents.append( entry->extent().encode().bytes() );
+  }
+
+  ReosEncodedElement ret( QStringLiteral( "direction-raster-store" ) );
+  ret.addData( QStringLiteral( "layer-ids" ), layerIds );
+  ret.addData( QStringLiteral( "extents" ), extents );
+
+  if ( withDirections )
+    ret.addEncodedData( QStringLiteral( "directions" ), encodeDirections() );
+
+  return ret;
+}
+
+ReosEncodedElement ReosDirectionRasterStore::encodeDirections() const
+{
+  QList<QByteArray> directions;
+  for ( const EntryPtr &entry : mEntries )
+    directions.append( entry->directions().encode().bytes() );
+
+  ReosEncodedElement ret( QStringLiteral( "direction-raster-store-directions" ) );
+  ret.addData( QStringLiteral( "directions" ), directions );
+
+  return ret;
+}
+
+// Directions of the entries of a store that are decoded only when the directions of one of them is needed
+struct ReosDirectionRasterStoreLazyDirections
+{
+  QMutex mutex;
+  std::function<ReosEncodedElement()> loader;
+  QList<QByteArray> directions;
+
+  ReosRasterByteTiledCompressed directionsAt( int index )
+  {
+    QMutexLocker locker( &mutex );
+    if ( loader )
+    {
+      const ReosEncodedElement element = loader();
+      loader = nullptr;
+      if ( element.description() == QStringLiteral( "direction-raster-store-directions" ) )
+        element.getData( QStringLiteral( "directions" ), directions );
+    }
+
+    if ( index < 0 || index >= directions.count() )
+      return ReosRasterByteTiledCompressed();
+
+    return ReosRasterByteTiledCompressed::decode( ReosEncodedElement( directions.at( index ) ) );
+  }
+};
+
+void ReosDirectionRasterStore::decode( const ReosEncodedElement &element, const std::function<ReosEncodedElement()> &directionsLoader )
+{
+  clear();
+  if ( element.description() != QStringLiteral( "direction-raster-store" ) )
+    return;
+
+  QList<QString> layerIds;
+  QList<QByteArray> extents;
+
+  if ( !element.getData( QStringLiteral( "layer-ids" ), layerIds ) ||
+       !element.getData( QStringLiteral( "extents" ), extents ) ||
+       layerIds.count() != extents.count() )
+    return;
+
+  std::shared_ptr<ReosDirectionRasterStoreLazyDirections> lazyDirections = std::make_shared<ReosDirectionRasterStoreLazyDirections>();
+  if ( element.hasEncodedData( QStringLiteral( "directions" ) ) )
+  {
+    const ReosEncodedElement directionsElement = element.getEncodedData( QStringLiteral( "directions" ) );
+    lazyDirections->loader = [directionsElement] {return directionsElement;};
+  }
+  else if ( directionsLoader )
+  {
+    lazyDirections->loader = directionsLoader;
+  }
+  else
+  {
+    return;
+  }
+
+  for ( int i = 0; i < layerIds.count(); ++i )
+  {
+    mEntries.append( std::make_shared<const Entry>( layerIds.at( i ),
+                     ReosRasterExtent::decode( ReosEncodedElement( extents.at( i ) ) ),
+                     [lazyDirections, i] {return lazyDirections->directionsAt( i );} ) );
+  }
+}
+
+bool ReosDirectionRasterStore::covers( const ReosDirectionRasterStore::Entry &entry, const ReosDirectionRasterStore::Entry &other )
+{
+  if ( entry.layerId() != other.layerId() )
+    return false;
+
+  int rowOffset = 0;
+  int columnOffset = 0;
+  if ( !windowPosition( entry.extent(), other.extent(), rowOffset, columnOffset ) )
+    return false;
+
+  // extents are checked first to avoid loading directions
+  const int rowCount = other.extent().yCellCount();
+  const int columnCount = other.extent().xCellCount();
+  if ( rowOffset < 0 || columnOffset < 0 ||
+       rowOffset + rowCount > entry.extent().yCellCount() ||
+       columnOffset + columnCount > entry.extent().xCellCount() )
+    return false;
+
+  const ReosRasterByteTiledCompressed &entryDirections = entry.directions();
+  const ReosRasterByteTiledCompressed &otherDirections = other.directions();
+
+  if ( rowOffset == 0 && columnOffset == 0 &&
+       rowCount == entry.extent().yCellCount() && columnCount == entry.extent().xCellCount() &&
+       entryDirections == otherDirections )
+    return true;
+
+  return entryDirections.uncompressBlock( rowOffset, columnOffset, rowCount, columnCount, 9 ) == otherDirections.uncompressRaster();
+}
+
+bool ReosDirectionRasterStore::windowPosition( const ReosRasterExtent &extent, const ReosRasterExtent &window, int &rowOffset, int &columnOffset )
+{
+  if ( !extent.isValid() || !window.isValid() )
+    return false;
+
+  const double xCellSize = extent.xCellSize();
+  const double yCellSize = extent.yCellSize();
+  const double tolerance = 1e-6;
+
+  if ( std::fabs( window.xCellSize() - xCellSize ) > tolerance * std::fabs( xCellSize ) ||
+       std::fabs( window.yCellSize() - yCellSize ) > tolerance * std::fabs( yCellSize ) )
+    return false;
+
+  const double columnPosition = ( window.xMapOrigin() - extent.xMapOrigin() ) / xCellSize;
+  const double rowPosition = ( window.yMapOrigin() - extent.yMapOrigin() ) / yCellSize;
+  columnOffset = static_cast<int>( std::round( columnPosition ) );
+  rowOffset = static_cast<int>( std::round( rowPosition ) );
+
+  // cells have to be aligned
+  const double alignmentTolerance = 1e-3;
+  return std::fabs( columnPosition - columnOffset ) < alignmentTolerance && std::fabs( rowPosition - rowOffset ) < alignmentTolerance;
+}
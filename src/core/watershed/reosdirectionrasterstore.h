@@ -0,0 +1,130 @@
+/***************************************************************************
+  reosdirectionrasterstore.h - ReosDirectionRasterStore
+
+ ---------------------
+ begin                : 18.5.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef REOSDIRECTIONRASTERSTORE_H
+#define REOSDIRECTIONRASTERSTORE_H
+
+#include <functional>
+#include <memory>
+#include <QMutex>
+#include <QVector>
+
+#include "reoscore.h"
+#include "reosmemoryraster.h"
+#include "reosrastercompressed.h"
+#include "reosrasterwatershed.h"
+#include "reosencodedelement.h"
+
+/**
+ * Class that stores direction rasters shared by watersheds, each direction raster is associated with a DEM layer and an extent.
+ *
+ * Watersheds reference an entry of the store and a window in it, so nested watersheds delineated from the same
+ * directions share the same compressed data. When an entry is added, it is replaced by an existing entry that covers it
+ * with the same directions, and the entries it covers are removed.
+ *
+ * As entries are compressed by tiles, the directions of a window can be read without decompressing the whole raster.
+ * The directions of the entries can be encoded apart from the store, in this case, they are loaded only when needed.
+ */
+class REOSCORE_EXPORT ReosDirectionRasterStore
+{
+  public:
+    //! Compressed direction raster of a DEM layer on an extent
+    class REOSCORE_EXPORT Entry
+    {
+      public:
+        //! Constructor with the \a directions on the \a extent, associated with the DEM layer \a layerId
+        Entry( const QString &layerId, const ReosRasterExtent &extent, const ReosRasterByteTiledCompressed &directions );
+
+        //! Constructor with directions that will be returned by \a loader when accessed for the first time
+        Entry( const QString &layerId, const ReosRasterExtent &extent, const std::function<ReosRasterByteTiledCompressed()> &loader );
+
+        //! Returns the id of the DEM layer
+        QString layerId() const {return mLayerId;}
+
+        //! Returns the extent of the direction raster
+        ReosRasterExtent extent() const {return mExtent;}
+
+        //! Returns the compressed directions, loads them if needed
+        const ReosRasterByteTiledCompressed &directions() const;
+
+        //! Returns whether the directions are loaded
+        bool isLoaded() const;
+
+      private:
+        QString mLayerId;
+        ReosRasterExtent mExtent;
+        mutable ReosRasterByteTiledCompressed mDirections;
+        mutable std::function<ReosRasterByteTiledCompressed()> mLoader;
+        mutable QMutex mMutex;
+    };
+
+    typedef std::shared_ptr<const Entry> EntryPtr;
+
+    //! Returns a new entry not registered in any store, with \a directions on the \a extent, associated with the DEM layer \a layerId
+    static EntryPtr createEntry( const QString &layerId, const ReosRasterExtent &extent, const ReosRasterWatershed::Directions &directions );
+
+    //! Returns the directions of \a entry on the window \a windowExtent, cells of the window outside the entry have no data
+    static ReosRasterWatershed::Directions directions( const EntryPtr &entry, const ReosRasterExtent &windowExtent );
+
+    /**
+     * Registers \a entry in the store and returns the entry that has to be used instead of \a entry. If the store contains an entry
+     * of the same layer, with aligned cells, that covers the extent of \a entry with the same directions, this entry is returned.
+     * Otherwise \a entry is registered, returned, and the entries that it covers with the same directions are removed from the store.
+     * An entry removed this way can still be held by a previous caller, sharing it again returns the entry that replaced it.
+     */
+    EntryPtr share( const EntryPtr &entry );
+
+    //! Returns the count of entries
+    int entryCount() const;
+
+    //! Returns the entry at \a index
+    EntryPtr entry( int index ) const;
+
+    //! Returns the index of \a entry in the store, -1 if not registered
+    int indexOf( const EntryPtr &entry ) const;
+
+    //! Removes the entries that are not referenced outside the store
+    void purge();
+
+    //! Removes all the entries
+    void clear();
+
+    //! Returns whether entries have been added or removed since the store has been decoded or cleared
+    bool hasChanged() const;
+
+    //! Encodes the store, if \a withDirections is false, the directions are not encoded, see encodeDirections()
+    ReosEncodedElement encode( bool withDirections = true ) const;
+
+    //! Encodes only the directions of the entries, loading them if needed
+    ReosEncodedElement encodeDirections() const;
+
+    /**
+     * Decodes the store from \a element. If the directions are not encoded in \a element, \a directionsLoader
+     * is called the first time the directions of an entry are needed and has to return the element created by encodeDirections().
+     */
+    void decode( const ReosEncodedElement &element, const std::function<ReosEncodedElement()> &directionsLoader = nullptr );
+
+  private:
+    QVector<EntryPtr> mEntries;
+    bool mHasChanged = false;
+
+    //! Returns whether \a entry covers \a other with the same directions
+    static bool covers( const Entry &entry, const Entry &other );
+
+    //! Returns whether the cells of \a window are aligned with the ones of \a extent, if true sets the position of the window in \a extent
+    static bool windowPosition( const ReosRasterExtent &extent, const ReosRasterExtent &window, int &rowOffset, int &columnOffset );
+};
+
+#endif // REOSDIRECTIONRASTERSTORE_H
@@ -53,12 +53,17 @@ ReosMeteorologicModel::ReosMeteorologicModel( const ReosEncodedElement &element,
     if ( ws && rainfall )
       mAssociations.append( {QPointer<ReosWatershed>( ws ), QPointer<ReosRainfallSerieRainfallItem>( rainfall )} );
   }
+
+  if ( element.hasEncodedData( QStringLiteral( "gridded-rainfall" ) ) )
+    setGriddedRainfall( ReosGriddedRainfall::decode( element.getEncodedData( QStringLiteral( "gridded-rainfall" ) ) ) );
 }
 
 ReosMeteorologicModel *ReosMeteorologicModel::duplicate( const QString &dupplicateName )
 {
   std::unique_ptr<ReosMeteorologicModel> duplicate = std::make_unique<ReosMeteorologicModel>( dupplicateName );
   duplicate->mAssociations = mAssociations;
+  if ( mGriddedRainfall )
+    duplicate->setGriddedRainfall( ReosGriddedRainfall::decode( mGriddedRainfall->encode() ) );
   return duplicate.release();
 }
 
@@ -84,6 +89,8 @@ ReosEncodedElement ReosMeteorologicModel::encode( ReosWatershedTree *watershedTr
   element.addData( QStringLiteral( "associations" ), associations );
   element.addEncodedData( QStringLiteral( "name" ), mName->encode() );
   element.addData( QStringLiteral( "color" ), mColor );
+  if ( mGriddedRainfall )
+    element.addEncodedData( QStringLiteral( "gridded-rainfall" ), mGriddedRainfall->encode() );
 
   ReosDataObject::encode( element );
 
@@ -141,6 +148,10 @@ ReosSerieRainfall *ReosMeteorologicModel::associatedRainfall( ReosWatershed *wat
       return rainfallItem->data();
   }
 
+  const int griddedIndex = griddedRainfallSerieIndex( watershed );
+  if ( griddedIndex >= 0 && mGriddedRainfallSeries.at( griddedIndex ).weights.coverage( 0 ) > 0 )
+    return mGriddedRainfallSeries.at( griddedIndex ).rainfall;
+
   return nullptr;
 }
 
@@ -153,7 +164,69 @@ bool ReosMeteorologicModel::hasRainfall( ReosWatershed *watershed ) const
     if ( as.first.data() == watershed && !as.second.isNull() )
       return true;
 
-  return false;
+  const int griddedIndex = griddedRainfallSerieIndex( watershed );
+  return griddedIndex >= 0 && mGriddedRainfallSeries.at( griddedIndex ).weights.coverage( 0 ) > 0;
+}
+
+void ReosMeteorologicModel::setGriddedRainfall( ReosGriddedRainfall *griddedRainfall )
+{
+  if ( mGriddedRainfall )
+    delete mGriddedRainfall;
+
+  for ( const GriddedRainfallSerie &serie : std::as_const( mGriddedRainfallSeries ) )
+    if ( serie.rainfall )
+      serie.rainfall->deleteLater();
+  mGriddedRainfallSeries.clear();
+
+  mGriddedRainfall = griddedRainfall;
+  if ( mGriddedRainfall )
+  {
+    mGriddedRainfall->setParent( this );
+    connect( mGriddedRainfall, &ReosDataObject::dataChanged, this, &ReosMeteorologicModel::onGriddedRainfallChanged );
+  }
+
+  emit dataChanged();
+}
+
+ReosGriddedRainfall *ReosMeteorologicModel::griddedRainfall() const
+{
+  return mGriddedRainfall;
+}
+
+void ReosMeteorologicModel::updateGriddedRainfall( const QList<ReosWatershed *> &watersheds ) const
+{
+  if ( !mGriddedRainfall )
+    return;
+
+  QList<ReosWatershed *> watershedsToCalculate;
+  QList<QPolygonF> polygons;
+  for ( ReosWatershed *ws : watersheds )
+  {
+    if ( !ws || watershedsToCalculate.contains( ws ) )
+      continue;
+
+    bool present = false;
+    for ( const GriddedRainfallSerie &serie : std::as_const( mGriddedRainfallSeries ) )
+      present |= serie.watershed == ws;
+
+    if ( present )
+      continue;
+
+    watershedsToCalculate.append( ws );
+    polygons.append( ws->delineating() );
+  }
+
+  if ( watershedsToCalculate.isEmpty() )
+    return;
+
+  // the watersheds share the CRS of the project
+  const ReosGriddedRainfallWeights weights = ReosGriddedRainfallWeights::calculate( mGriddedRainfall->extent(), polygons,
+      mGriddedRainfall->crs(), watershedsToCalculate.first()->crs() );
+  const QVector<double> averages = weights.arealAverages( mGriddedRainfall );
+  const int frameCount = mGriddedRainfall->frameCount();
+
+  for ( int i = 0; i < watershedsToCalculate.count(); ++i )
+    addGriddedRainfallSerie( watershedsToCalculate.at( i ), weights.polygonWeights( i ), averages.constData() + qint64( i ) * frameCount );
 }
 
 int ReosMeteorologicModel::findWatershed( ReosWatershed *watershed ) const
@@ -167,6 +240,102 @@ int ReosMeteorologicModel::findWatershed( ReosWatershed *watershed ) const
   return -1;
 }
 
+// Sets the values of \a serie with the \a values of the frames of \a griddedRainfall
+static void setGriddedRainfallSerieValues( ReosSerieRainfall *serie, const ReosGriddedRainfall *griddedRainfall, const double *values )
+{
+  serie->blockSignals( true );
+  serie->clear();
+  serie->setReferenceTime( griddedRainfall->referenceTime() );
+  serie->setTimeStep( griddedRainfall->timeStep() );
+  for ( int i = 0; i < griddedRainfall->frameCount(); ++i )
+    serie->appendValue( values[i] );
+  serie->blockSignals( false );
+
+  emit serie->dataChanged();
+}
+
+int ReosMeteorologicModel::griddedRainfallSerieIndex( ReosWatershed *watershed ) const
+{
+  if ( !mGriddedRainfall || !watershed )
+    return -1;
+
+  int i = 0;
+  while ( i < mGriddedRainfallSeries.count() )
+  {
+    const GriddedRainfallSerie &serie = mGriddedRainfallSeries.at( i );
+    if ( serie.watershed.isNull() || serie.rainfall.isNull() )
+    {
+      if ( serie.rainfall )
+        serie.rainfall->deleteLater();
+      mGriddedRainfallSeries.removeAt( i );
+      continue;
+    }
+
+    if ( serie.watershed == watershed )
+      return i;
+    ++i;
+  }
+
+  updateGriddedRainfall( {watershed} );
+
+  if ( !mGriddedRainfallSeries.isEmpty() && mGriddedRainfallSeries.last().watershed == watershed )
+    return mGriddedRainfallSeries.count() - 1;
+
+  return -1;
+}
+
+void ReosMeteorologicModel::addGriddedRainfallSerie( ReosWatershed *watershed, const ReosGriddedRainfallWeights &weights, const double *averages ) const
+{
+  GriddedRainfallSerie serie;
+  serie.watershed = watershed;
+  serie.weights = weights;
+  serie.rainfall = new ReosSerieRainfall( const_cast<ReosMeteorologicModel *>( this ) );
+  setGriddedRainfallSerieValues( serie.rainfall, mGriddedRainfall, averages );
+  mGriddedRainfallSeries.append( serie );
+
+  // weights are calculated again only if the watershed changes
+  ReosSerieRainfall *rainfall = serie.rainfall;
+  connect( watershed, &ReosDataObject::dataChanged, rainfall, [this, watershed, rainfall]
+  {
+    if ( !mGriddedRainfall )
+      return;
+    for ( GriddedRainfallSerie &serie : mGriddedRainfallSeries )
+    {
+      if ( serie.rainfall != rainfall )
+        continue;
+      serie.weights = ReosGriddedRainfallWeights::calculate( mGriddedRainfall->extent(), {watershed->delineating()},
+                      mGriddedRainfall->crs(), watershed->crs() );
+      setGriddedRainfallSerieValues( rainfall, mGriddedRainfall, serie.weights.arealAverages( mGriddedRainfall ).constData() );
+    }
+  } );
+}
+
+void ReosMeteorologicModel::onGriddedRainfallChanged()
+{
+  // the extent of the gridded rainfall does not change, so the weights are still valid
+  const int frameCount = mGriddedRainfall->frameCount();
+  for ( GriddedRainfallSerie &serie : mGriddedRainfallSeries )
+  {
+    if ( serie.watershed.isNull() || serie.rainfall.isNull() )
+      continue;
+
+    // frames can only be appended or all removed, so if the serie has one value less, only the last frame is new
+    if ( frameCount > 0 && serie.rainfall->valueCount() == frameCount - 1 )
+    {
+      const QVector<double> lastAverage = serie.weights.arealAverages( mGriddedRainfall, frameCount - 1 );
+      if ( !lastAverage.isEmpty() )
+      {
+        serie.rainfall->appendValue( lastAverage.first() );
+        continue;
+      }
+    }
+
+    setGriddedRainfallSerieValues( serie.rainfall, mGriddedRainfall, serie.weights.arealAverages( mGriddedRainfall ).constData() );
+  }
+
+  emit dataChanged();
+}
+
 void ReosMeteorologicModel::purge() const
 {
   int i = 0;
@@ -22,6 +22,7 @@
 
 #include "reoswatershed.h"
 #include "reosrainfallitem.h"
+#include "reosgriddedrainfall.h"
 
 class ReosWatershedTree;
 class ReosRainfallRegistery;
@@ -55,12 +56,27 @@ class REOSCORE_EXPORT ReosMeteorologicModel : public ReosDataObject
     //! Returns the associated rainfall item of \a watershed
     ReosRainfallSerieRainfallItem *associatedRainfallItem( ReosWatershed *watershed ) const;
 
-    //! Returns the associated rainfall of \a watershed
+    /**
+     * Returns the associated rainfall of \a watershed, if no rainfall is associated and a gridded rainfall is set,
+     * returns the areal average of the gridded rainfall on the watershed, or nullptr if the grid does not cover the watershed.
+     */
     ReosSerieRainfall *associatedRainfall( ReosWatershed *watershed ) const;
 
-    //! Returns whether the meteomodel has a associated rainfall for the watershed \a watershed
+    //! Returns whether the meteomodel has a associated rainfall for the watershed \a watershed or a gridded rainfall covering it
     bool hasRainfall( ReosWatershed *watershed ) const;
 
+    /**
+     * Sets the gridded rainfall used for the watersheds that have no associated rainfall, takes ownership.
+     * The areal weights of the cells for each watershed are calculated once, when the rainfall of the watershed is requested first.
+     */
+    void setGriddedRainfall( ReosGriddedRainfall *griddedRainfall );
+
+    //! Returns the gridded rainfall, nullptr if not set
+    ReosGriddedRainfall *griddedRainfall() const;
+
+    //! Calculates in one pass the areal weights and the areal averages of the gridded rainfall for all the \a watersheds
+    void updateGriddedRainfall( const QList<ReosWatershed *> &watersheds ) const;
+
     //! Remove all reference with no association
     void purge() const;
 
@@ -83,8 +99,25 @@ class REOSCORE_EXPORT ReosMeteorologicModel : public ReosDataObject
     mutable QList<WatershedRainfallAssociation> mAssociations;
     QColor mColor;
 
+    struct GriddedRainfallSerie
+    {
+      QPointer<ReosWatershed> watershed;
+      ReosGriddedRainfallWeights weights;
+      QPointer<ReosSerieRainfall> rainfall;
+    };
+    QPointer<ReosGriddedRainfall> mGriddedRainfall;
+    mutable QList<GriddedRainfallSerie> mGriddedRainfallSeries;
+
     //! Searchs for \a watershed, if found , return its index, otherwise return -1
     int findWatershed( ReosWatershed *watershed ) const;
+
+    //! Returns the position of the gridded rainfall serie of \a watershed, calculated if not present, -1 if no gridded rainfall
+    int griddedRainfallSerieIndex( ReosWatershed *watershed ) const;
+
+    //! Adds the gridded rainfall serie of \a watershed with \a weights and the \a averages of the gridded rainfall
+    void addGriddedRainfallSerie( ReosWatershed *watershed, const ReosGriddedRainfallWeights &weights, const double *averages ) const;
+
+    void onGriddedRainfallChanged();
 };
 
 //! List model class that represents a collection of meteorologic model
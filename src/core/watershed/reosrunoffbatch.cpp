@@ -0,0 +1,376 @@
+/***************************************************************************
+  reosrunoffbatch.cpp - ReosRunoffBatch
+
+ ---------------------
+ begin                : 21.5.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "reosrunoffbatch.h"
+
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include <QtConcurrent>
+
+#include "reosrunoffmodel.h"
+#include "reosparameter.h"
+
+void ReosRunoffBatch::setRainfalls( const QVector<double> &values, int valueCount, const ReosDuration &timeStep )
+{
+  mValueCount = std::max( valueCount, 0 );
+  mRainfalls = values;
+  if ( mValueCount > 0 )
+    mRainfalls.resize( values.count() - values.count() % mValueCount );
+  else
+    mRainfalls.clear();
+  mTimeStep = timeStep;
+  mResults.clear();
+}
+
+int ReosRunoffBatch::rainfallCount() const
+{
+  if ( mValueCount == 0 )
+    return 0;
+
+  return mRainfalls.count() / mValueCount;
+}
+
+int ReosRunoffBatch::valueCount() const
+{
+  return mValueCount;
+}
+
+ReosDuration ReosRunoffBatch::timeStep() const
+{
+  return mTimeStep;
+}
+
+int ReosRunoffBatch::addWatershed()
+{
+  mResults.clear();
+  return mWatershedCount++;
+}
+
+int ReosRunoffBatch::watershedCount() const
+{
+  return mWatershedCount;
+}
+
+void ReosRunoffBatch::addConstantCoefficient( int watershed, double coefficient, double factor )
+{
+  if ( watershed < 0 || watershed >= mWatershedCount )
+    return;
+
+  mConstantCoefficientWatersheds.append( watershed );
+  mConstantCoefficientFactors.append( factor );
+  mCoefficients.append( coefficient );
+  mResults.clear();
+}
+
+void ReosRunoffBatch::addGreenAmpt( int watershed, const ReosRunoffBatch::GreenAmptParameters &parameters, double factor )
+{
+  if ( watershed < 0 || watershed >= mWatershedCount )
+    return;
+
+  mGreenAmptWatersheds.append( watershed );
+  mGreenAmptFactors.append( factor );
+  mGreenAmptParameters.append( parameters );
+  mResults.clear();
+}
+
+void ReosRunoffBatch::addCurveNumber( int watershed, double curveNumber, double initialRetention, double factor )
+{
+  // a curve number model with a not positive curve number produces no runoff
+  if ( watershed < 0 || watershed >= mWatershedCount || curveNumber <= 0 )
+    return;
+
+  mCurveNumberWatersheds.append( watershed );
+  mCurveNumberFactors.append( factor );
+  mCurveNumberPotentialRetentions.append( curveNumberPotentialRetention( curveNumber ) );
+  mCurveNumberInitialRetentions.append( initialRetention );
+  mResults.clear();
+}
+
+bool ReosRunoffBatch::addRunoffModelsGroup( int watershed, ReosRunoffModelsGroup *group )
+{
+  if ( !group || watershed < 0 || watershed >= mWatershedCount )
+    return false;
+
+  for ( int i = 0; i < group->runoffModelCount(); ++i )
+  {
+    // models deleted elsewhere are ignored, as in ReosRunoff
+    if ( !group->runoffModel( i ) )
+      continue;
+    const QString type = group->runoffModel( i )->runoffType();
+    if ( type != QStringLiteral( "constant-coefficient" ) &&
+         type != QStringLiteral( "green-ampt" ) &&
+         type != QStringLiteral( "curve-number" ) )
+      return false;
+  }
+
+  for ( int i = 0; i < group->runoffModelCount(); ++i )
+  {
+    ReosRunoffModel *model = group->runoffModel( i );
+    const double factor = group->coefficient( i )->value();
+
+    if ( ReosRunoffConstantCoefficientModel *constantCoefficient = qobject_cast<ReosRunoffConstantCoefficientModel *>( model ) )
+    {
+      addConstantCoefficient( watershed, constantCoefficient->coefficient()->value(), factor );
+    }
+    else if ( ReosRunoffGreenAmptModel *greenAmpt = qobject_cast<ReosRunoffGreenAmptModel *>( model ) )
+    {
+      addGreenAmpt( watershed, greenAmpt->greenAmptParameters(), factor );
+    }
+    else if ( ReosRunoffCurveNumberModel *curveNumber = qobject_cast<ReosRunoffCurveNumberModel *>( model ) )
+    {
+      addCurveNumber( watershed, curveNumber->curveNumber()->value(), curveNumber->initialRetentionValue(), factor );
+    }
+  }
+
+  return true;
+}
+
+bool ReosRunoffBatch::calculate()
+{
+  mResults.clear();
+
+  const int rainCount = rainfallCount();
+  if ( rainCount == 0 || mWatershedCount == 0 )
+    return false;
+
+  const int valueCount = mValueCount;
+  const double timeStepHour = mTimeStep.valueHour();
+
+  // cumulative rainfalls are shared by all the curve number models
+  QVector<double> cumulativeRainfalls;
+  if ( !mCurveNumberWatersheds.isEmpty() )
+  {
+    cumulativeRainfalls.resize( mRainfalls.count() );
+    for ( int r = 0; r < rainCount; ++r )
+    {
+      const double *rain = mRainfalls.constData() + qint64( r ) * valueCount;
+      std::partial_sum( rain, rain + valueCount, cumulativeRainfalls.data() + qint64( r ) * valueCount );
+    }
+  }
+
+  QVector<int> firstConstantCoefficient;
+  const QVector<int> constantCoefficientEntries = entriesByWatershed( mConstantCoefficientWatersheds, firstConstantCoefficient );
+  QVector<int> firstGreenAmpt;
+  const QVector<int> greenAmptEntries = entriesByWatershed( mGreenAmptWatersheds, firstGreenAmpt );
+  QVector<int> firstCurveNumber;
+  const QVector<int> curveNumberEntries = entriesByWatershed( mCurveNumberWatersheds, firstCurveNumber );
+
+  QVector<double> results( mWatershedCount * qint64( rainCount ) * valueCount, 0.0 );
+  double *resultData = results.data();
+  const double *rainfallData = mRainfalls.constData();
+  const double *cumulativeData = cumulativeRainfalls.constData();
+
+  QVector<int> watersheds( mWatershedCount );
+  std::iota( watersheds.begin(), watersheds.end(), 0 );
+
+  // each watershed writes in its own rows of the results, no synchronization is needed
+  QtConcurrent::blockingMap( watersheds, [&]( int w )
+  {
+    for ( int r = 0; r < rainCount; ++r )
+    {
+      const double *rain = rainfallData + qint64( r ) * valueCount;
+      double *runoff = resultData + ( qint64( w ) * rainCount + r ) * valueCount;
+
+      for ( int e = firstConstantCoefficient.at( w ); e < firstConstantCoefficient.at( w + 1 ); ++e )
+      {
+        const int entry = constantCoefficientEntries.at( e );
+        addConstantCoefficientRunoff( rain, valueCount, mCoefficients.at( entry ), mConstantCoefficientFactors.at( entry ), runoff );
+      }
+
+      for ( int e = firstGreenAmpt.at( w ); e < firstGreenAmpt.at( w + 1 ); ++e )
+      {
+        const int entry = greenAmptEntries.at( e );
+        addGreenAmptRunoff( rain, valueCount, timeStepHour, mGreenAmptParameters.at( entry ), mGreenAmptFactors.at( entry ), runoff );
+      }
+
+      for ( int e = firstCurveNumber.at( w ); e < firstCurveNumber.at( w + 1 ); ++e )
+      {
+        const int entry = curveNumberEntries.at( e );
+        addCurveNumberRunoff( cumulativeData + qint64( r ) * valueCount, valueCount,
+                              mCurveNumberPotentialRetentions.at( entry ),
+                              mCurveNumberInitialRetentions.at( entry ),
+                              mCurveNumberFactors.at( entry ), runoff );
+      }
+    }
+  } );
+
+  mResults = results;
+  return true;
+}
+
+bool ReosRunoffBatch::hasResults() const
+{
+  return !mResults.isEmpty();
+}
+
+const double *ReosRunoffBatch::runoff( int watershed, int rainfall ) const
+{
+  const int rainCount = rainfallCount();
+  if ( mResults.isEmpty() || watershed < 0 || watershed >= mWatershedCount || rainfall < 0 || rainfall >= rainCount )
+    return nullptr;
+
+  return mResults.constData() + ( qint64( watershed ) * rainCount + rainfall ) * mValueCount;
+}
+
+QVector<double> ReosRunoffBatch::results() const
+{
+  return mResults;
+}
+
+void ReosRunoffBatch::addConstantCoefficientRunoff( const double *rain, int count, double coefficient, double factor, double *runoff )
+{
+  for ( int i = 0; i < count ; ++i )
+    runoff[i] +=  rain[i] * coefficient * factor;
+}
+
+static double resolveFpEquation( double T, double SM, double K )
+{
+  double X1;
+  double X2 = 1;
+  int it = 0;
+  do
+  {
+    X1 = X2;
+    X2 = X1 - ( X1 - log( 1 + X1 ) - K / SM * T ) / ( 1 - 1 / ( 1 + X1 ) );
+    it++;
+  }
+  while ( fabs( ( X2 - X1 ) / X2 ) > 0.001 && it < 100 );
+
+  return X2 * SM;
+}
+
+void ReosRunoffBatch::addGreenAmptRunoff( const double *rain, int count, double timeStepHour, const GreenAmptParameters &parameters, double factor, double *runoff )
+{
+  const double Ia = parameters.initialRetention;
+  const double K = parameters.saturatedPermeability;
+  const double SM = ( parameters.soilPorosity - parameters.initialWaterContent ) * parameters.wettingFrontSuction;
+  const double K_h = K * timeStepHour;
+
+  if ( SM < 0 )
+  {
+    for ( int i = 0; i < count; ++i )
+      if ( rain[i] > K_h )
+        runoff[i] += ( rain[i] - K_h ) * factor;
+    return;
+  }
+
+  double P = 0;
+  double Rprev = 0;
+  double R = 0;
+  double Fp = 0;
+  double I = 0;
+  double KSMIK = std::numeric_limits<double>::max();
+  double cu = -10;
+  double cp = -10;
+  double tp = 0;
+  double Pp;
+  double ts = 0;
+  bool pondingInitial = false;
+  bool pondingTerminal = false;
+
+  for ( int i = 0; i < count ; ++i )
+  {
+    double dP = rain[i];
+    Rprev = R;
+    P += dP;
+    I = dP / timeStepHour;
+    pondingInitial = pondingTerminal;
+
+    if ( I > K )
+    {
+      KSMIK = K * SM / ( I - K );
+      cu = P - R - KSMIK;
+
+      if ( !pondingInitial )
+      {
+        pondingTerminal = cu > 0;
+      }
+      else
+      {
+        pondingTerminal = true;
+      }
+
+      if ( ( !pondingInitial ) && ( pondingTerminal ) )
+      {
+        double dt = ( KSMIK - P + dP + R ) / I;
+        if ( dt < 0 )
+          dt = 0;
+
+        tp = i * timeStepHour + dt;
+
+        Pp = P - dP + I * dt;
+        ts = ( ( Pp - R ) / SM - log( 1 + ( Pp - R ) / SM ) ) * SM / K;
+      }
+
+      if ( pondingTerminal )
+      {
+        Fp = resolveFpEquation( ( i + 1 ) * timeStepHour - tp + ts, SM, K );
+        cp = P - Fp - R;
+
+        pondingTerminal = cp > 0;
+
+        if ( pondingTerminal )
+        {
+          if ( P - Fp - Ia > R )
+          {
+            R = P - Fp - Ia;
+          }
+        }
+      }
+    }
+    else
+    {
+      pondingTerminal = false;
+    }
+
+    runoff[i] += ( R - Rprev ) * factor;
+  }
+}
+
+void ReosRunoffBatch::addCurveNumberRunoff( const double *cumulativeRain, int count, double S, double initialRetention, double factor, double *runoff )
+{
+  // runoff only depends on the cumulative rainfall, so each value can be calculated independently
+  double Rprev = 0;
+  for ( int i = 0; i < count; ++i )
+  {
+    const double excess = cumulativeRain[i] - initialRetention;
+    const double R = excess < 0 ? 0 : excess * excess / ( excess + S );
+    runoff[i] += ( R - Rprev ) * factor;
+    Rprev = R;
+  }
+}
+
+double ReosRunoffBatch::curveNumberPotentialRetention( double curveNumber )
+{
+  return 25400 / curveNumber - 254;
+}
+
+QVector<int> ReosRunoffBatch::entriesByWatershed( const QVector<int> &watersheds, QVector<int> &firstEntries ) const
+{
+  firstEntries.fill( 0, mWatershedCount + 1 );
+  for ( int w : watersheds )
+    firstEntries[w + 1]++;
+  for ( int w = 0; w < mWatershedCount; ++w )
+    firstEntries[w + 1] += firstEntries.at( w );
+
+  QVector<int> entries( watersheds.count() );
+  QVector<int> positions = firstEntries;
+  for ( int e = 0; e < watersheds.count(); ++e )
+    entries[positions[watersheds.at( e )]++] = e;
+
+  return entries;
+}
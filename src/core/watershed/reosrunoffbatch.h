@@ -0,0 +1,148 @@
+/***************************************************************************
+  reosrunoffbatch.h - ReosRunoffBatch
+
+ ---------------------
+ begin                : 21.5.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef REOSRUNOFFBATCH_H
+#define REOSRUNOFFBATCH_H
+
+#include <QVector>
+
+#include "reoscore.h"
+#include "reosduration.h"
+
+class ReosRunoffModelsGroup;
+
+/**
+ * Class that calculates the runoff of many watersheds for many rainfalls at once.
+ *
+ * The rainfalls are given as a matrix with one row per rainfall, all the rainfalls having the same count of values and the same time step.
+ * The runoff models applied on each watershed are stored by type in tables of parameters,
+ * each entry being associated with a watershed and a factor that is the portion of the watershed where the model is applied.
+ *
+ * The calculation is made in parallel over watersheds. For each watershed and each rainfall, all the models of the watershed
+ * are added in a row of the results that are stored contiguously, row of watershed w and rainfall r being at index w * rainfallCount + r.
+ * The cumulative rainfalls are calculated only once for all the watersheds.
+ *
+ * The calculation of each model is the same as the one made by the corresponding ReosRunoffModel.
+ */
+class REOSCORE_EXPORT ReosRunoffBatch
+{
+  public:
+    //! Parameters of the Green Ampt runoff model
+    struct GreenAmptParameters
+    {
+      //! Initial retention in mm
+      double initialRetention = 0;
+      //! Saturated permeability in mm/h
+      double saturatedPermeability = 15;
+      //! Soil porosity (vol/vol)
+      double soilPorosity = 0.35;
+      //! Initial water content (vol/vol)
+      double initialWaterContent = 0.25;
+      //! Wetting front suction in mm
+      double wettingFrontSuction = 600;
+    };
+
+    //! Constructor of an empty batch
+    ReosRunoffBatch() = default;
+
+    /**
+     * Sets the rainfalls, \a values contains the rainfall values in mm by time step, row by row with \a valueCount values for each rainfall.
+     * The count of rainfall is the count of \a values divided by \a valueCount. Results are cleared.
+     */
+    void setRainfalls( const QVector<double> &values, int valueCount, const ReosDuration &timeStep );
+
+    //! Returns the count of rainfalls
+    int rainfallCount() const;
+
+    //! Returns the count of values of each rainfall and each result
+    int valueCount() const;
+
+    //! Returns the time step of the rainfalls
+    ReosDuration timeStep() const;
+
+    //! Adds a new watershed without runoff model and returns its index
+    int addWatershed();
+
+    //! Returns the count of watersheds
+    int watershedCount() const;
+
+    //! Adds a constant coefficient runoff model with \a coefficient applied on the \a factor portion of the watershed at index \a watershed
+    void addConstantCoefficient( int watershed, double coefficient, double factor = 1 );
+
+    //! Adds a Green Ampt runoff model with \a parameters applied on the \a factor portion of the watershed at index \a watershed
+    void addGreenAmpt( int watershed, const GreenAmptParameters &parameters, double factor = 1 );
+
+    //! Adds a curve number runoff model with \a curveNumber and \a initialRetention applied on the \a factor portion of the watershed at index \a watershed
+    void addCurveNumber( int watershed, double curveNumber, double initialRetention, double factor = 1 );
+
+    /**
+     * Adds all the runoff models of \a group to the watershed at index \a watershed with their coefficient as factor.
+     * Returns false if one of the models is not supported, in this case, no model is added.
+     */
+    bool addRunoffModelsGroup( int watershed, ReosRunoffModelsGroup *group );
+
+    //! Calculates the runoff of all the watersheds for all the rainfalls, returns false if there is nothing to calculate
+    bool calculate();
+
+    //! Returns whether results are available
+    bool hasResults() const;
+
+    //! Returns a pointer to the valueCount() runoff values of the watershed at index \a watershed with the rainfall at index \a rainfall
+    const double *runoff( int watershed, int rainfall ) const;
+
+    //! Returns all the results, row by row for each watershed and each rainfall
+    QVector<double> results() const;
+
+    //! Adds to \a runoff the runoff of the constant coefficient model with \a coefficient for the \a count values of \a rain
+    static void addConstantCoefficientRunoff( const double *rain, int count, double coefficient, double factor, double *runoff );
+
+    //! Adds to \a runoff the runoff of the Green Ampt model with \a parameters for the \a count values of \a rain with a time step of \a timeStepHour hours
+    static void addGreenAmptRunoff( const double *rain, int count, double timeStepHour, const GreenAmptParameters &parameters, double factor, double *runoff );
+
+    /**
+     * Adds to \a runoff the runoff of the curve number model with potential retention \a S and \a initialRetention
+     * for the \a count values of \a cumulativeRain, that is the cumulative sum of the rainfall values
+     */
+    static void addCurveNumberRunoff( const double *cumulativeRain, int count, double S, double initialRetention, double factor, double *runoff );
+
+    //! Returns the potential retention of the curve number model corresponding to \a curveNumber
+    static double curveNumberPotentialRetention( double curveNumber );
+
+  private:
+    QVector<double> mRainfalls;
+    int mValueCount = 0;
+    ReosDuration mTimeStep;
+    int mWatershedCount = 0;
+
+    QVector<int> mConstantCoefficientWatersheds;
+    QVector<double> mConstantCoefficientFactors;
+    QVector<double> mCoefficients;
+
+    QVector<int> mGreenAmptWatersheds;
+    QVector<double> mGreenAmptFactors;
+    QVector<GreenAmptParameters> mGreenAmptParameters;
+
+    QVector<int> mCurveNumberWatersheds;
+    QVector<double> mCurveNumberFactors;
+    QVector<double> mCurveNumberPotentialRetentions;
+    QVector<double> mCurveNumberInitialRetentions;
+
+    QVector<double> mResults;
+
+    //! Returns the entries of \a watersheds sorted by watershed, with \a firstEntries filled with the position of the first entry of each watershed
+    QVector<int> entriesByWatershed( const QVector<int> &watersheds, QVector<int> &firstEntries ) const;
+};
+
+#endif // REOSRUNOFFBATCH_H
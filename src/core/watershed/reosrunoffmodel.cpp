@@ -17,11 +17,14 @@
 
 #include <QFile>
 #include <QFileInfo>
+#include <QCryptographicHash>
+#include <numeric>
 
 #include "reosrainfallitem.h"
 #include "reostimeserie.h"
 #include "reosparameter.h"
 #include "reosversion.h"
+#include "reosrunoffbatch.h"
 
 #define  FILE_MAGIC_NUMBER 1909201402
 
@@ -86,6 +89,16 @@ void ReosRunoff::setRainfall( ReosTimeSerieConstantInterval *rainfall )
   registerUpstreamData( mRainfall );
 }
 
+ReosTimeSerieConstantInterval *ReosRunoff::rainfall() const
+{
+  return mRainfall;
+}
+
+ReosRunoffModelsGroup *ReosRunoff::runoffModelsGroup() const
+{
+  return mRunoffModelsGroups;
+}
+
 int ReosRunoff::valueCount() const
 {
   updateValues();
@@ -153,6 +166,27 @@ ReosTimeSerieConstantInterval *ReosRunoff::data() const
   return mData;
 }
 
+QByteArray ReosRunoff::inputHash() const
+{
+  if ( mRainfall.isNull() || mRunoffModelsGroups.isNull() )
+    return QByteArray();
+
+  QCryptographicHash hash( QCryptographicHash::Sha1 );
+  hash.addData( mRainfall->contentHash() );
+  hash.addData( QByteArray::number( mRainfall->timeStep().valueMilliSecond() ) );
+
+  // the encoded group contains the ids of the runoff models and their portions of the watershed
+  hash.addData( mRunoffModelsGroups->encode().bytes() );
+  for ( int i = 0; i < mRunoffModelsGroups->runoffModelCount(); ++i )
+  {
+    ReosRunoffModel *model = mRunoffModelsGroups->runoffModel( i );
+    if ( model )
+      hash.addData( model->encode().bytes() );
+  }
+
+  return hash.result();
+}
+
 ReosRunoffConstantCoefficientModel::ReosRunoffConstantCoefficientModel( const QString &name, QObject *parent ):
   ReosRunoffModel( name, parent ),
   mCoefficient( new ReosParameterDouble( QObject::tr( "Coefficient" ), false, this ) )
@@ -196,13 +230,7 @@ bool ReosRunoffConstantCoefficientModel::addRunoffModel( ReosTimeSerieConstantIn
   if ( runoffResult->valueCount() != rainfall->valueCount() )
     return applyRunoffModel( rainfall, runoffResult, factor );
 
-  double coef = mCoefficient->value();
-
-  double *rain = rainfall->data();
-  double *runoff = runoffResult->data();
-
-  for ( int i = 0; i < rainfall->valueCount() ; ++i )
-    runoff[i] +=  rain[i] * coef * factor;
+  ReosRunoffBatch::addConstantCoefficientRunoff( rainfall->data(), rainfall->valueCount(), mCoefficient->value(), factor, runoffResult->data() );
 
   return true;
 }
@@ -1026,22 +1054,6 @@ QList<ReosParameter *> ReosRunoffGreenAmptModel::parameters() const
   return ret;
 }
 
-double static resolveFpEquation( double T, double SM, double K )
-{
-  double X1;
-  double X2 = 1;
-  int it = 0;
-  do
-  {
-    X1 = X2;
-    X2 = X1 - ( X1 - log( 1 + X1 ) - K / SM * T ) / ( 1 - 1 / ( 1 + X1 ) );
-    it++;
-  }
-  while ( fabs( ( X2 - X1 ) / X2 ) > 0.001 && it < 100 );
-
-  return X2 * SM;
-}
-
 bool ReosRunoffGreenAmptModel::addRunoffModel( ReosTimeSerieConstantInterval *rainfall, ReosTimeSerieConstantInterval *runoffResult, double factor )
 {
   if ( !rainfall || !runoffResult )
@@ -1049,114 +1061,22 @@ bool ReosRunoffGreenAmptModel::addRunoffModel( ReosTimeSerieConstantInterval *ra
   if ( runoffResult->valueCount() != rainfall->valueCount() )
     return applyRunoffModel( rainfall, runoffResult, factor );
 
-  double *rain = rainfall->data();
-  double *runoff = runoffResult->data();
-
-  int n = rainfall->valueCount();
-  double Ia = mInitialRetentionParameter->value();
-  double K = mSaturatedPermeabilityParameter->value();
-  double P = 0;
-  double Rprev = 0;
-  double R = 0;
-//  double rm = 0;
-  double F = 0;
-  double Fp = 0;
-  double I = 0;
-  double KSMIK = std::numeric_limits<double>::max();
-  double SM = ( mSoilPorosityParameter->value() - mInitialWaterContentParameter->value() ) * mWettingFrontSuctionParameter->value();
-  double cu = -10;
-  double cp = -10;
-  double tp = 0;
-  double Pp;
-  double ts = 0;
-  bool pondingInitial = false;
-  bool pondingTerminal = false;
-  ReosDuration timeStep = rainfall->timeStepParameter()->value();
-  double timeStepHour = timeStep.valueHour();
-
-  double K_h = K * timeStepHour;
-
-  if ( SM < 0 )
-  {
-    for ( int i = 0; i < n; ++i )
-      if ( rain[i] > K_h )
-        runoff[i] += ( rain[i] - K_h ) * factor;
-    return true;
-  }
+  ReosRunoffBatch::addGreenAmptRunoff( rainfall->data(), rainfall->valueCount(), rainfall->timeStepParameter()->value().valueHour(),
+                                       greenAmptParameters(), factor, runoffResult->data() );
 
+  return true;
+}
 
-  for ( int i = 0; i < rainfall->valueCount() ; ++i )
-  {
-    double dP = rain[i];
-    Rprev = R;
-    P += dP;
-    I = dP / timeStepHour;
-    pondingInitial = pondingTerminal;
-
-    if ( I > K )
-    {
-      //rm = 0;
-      KSMIK = K * SM / ( I - K );
-      cu = P - R - KSMIK;
-
-
-      if ( !pondingInitial )
-      {
-        pondingTerminal = cu > 0;
-      }
-      else
-      {
-        pondingTerminal = true;
-      }
-
-      if ( ( !pondingInitial ) && ( pondingTerminal ) )
-      {
-        double dt = ( KSMIK - P + dP + R ) / I;;
-        if ( dt < 0 )
-          dt = 0;
-
-        tp = i * timeStepHour + dt;
-
-        Pp = P - dP + I * dt;
-        ts = ( ( Pp - R ) / SM - log( 1 + ( Pp - R ) / SM ) ) * SM / K;
-      }
-
-      if ( pondingTerminal )
-      {
-        Fp = resolveFpEquation( ( i + 1 ) * timeStepHour - tp + ts, SM, K );
-        cp = P - Fp - R;
-
-        pondingTerminal = cp > 0;
-
-        if ( pondingTerminal )
-        {
-          F = Fp;
-          if ( P - Fp - Ia > R )
-          {
-            R = P - Fp - Ia;
-          }
-        }
-//        else
-//        {
-//          F = P - R;
-//        }
-      }
-//      if ( !pondingInitial && !pondingTerminal )
-//      {
-//        F = P - R;
-//      }
-    }
-    else
-    {
-//      F = P - R;
-      pondingTerminal = false;
-    }
-
-    runoff[i] += ( R - Rprev ) * factor;
-  }
-
+ReosRunoffBatch::GreenAmptParameters ReosRunoffGreenAmptModel::greenAmptParameters() const
+{
+  ReosRunoffBatch::GreenAmptParameters parameters;
+  parameters.initialRetention = mInitialRetentionParameter->value();
+  parameters.saturatedPermeability = mSaturatedPermeabilityParameter->value();
+  parameters.soilPorosity = mSoilPorosityParameter->value();
+  parameters.initialWaterContent = mInitialWaterContentParameter->value();
+  parameters.wettingFrontSuction = mWettingFrontSuctionParameter->value();
 
-  return true;
+  return parameters;
 }
 
 ReosEncodedElement ReosRunoffGreenAmptModel::encode() const
@@ -1226,33 +1146,14 @@ bool ReosRunoffCurveNumberModel::addRunoffModel( ReosTimeSerieConstantInterval *
   if ( mCurveNumberParameter->value() <= 0 )
     return true;
 
-  int n = rainfall->valueCount();
+  const int n = rainfall->valueCount();
+  QVector<double> cumulativeRain( n );
+  const double *rain = rainfall->data();
+  std::partial_sum( rain, rain + n, cumulativeRain.data() );
 
-  double P = 0;
-  double R = 0;
-  double S = 25400 / mCurveNumberParameter->value() - 254;
-  double Ia;
-  if ( mInitialRetentionFromS )
-    Ia = 0.2 * S;
-  else
-    Ia = mInitialRetentionParameter->value();
-
-  double *rain = rainfall->data();
-  double *runoff = runoffResult->data();
-
-  for ( int i = 0; i < n; ++i )
-  {
-    double dP = rain[i];
-    double Rprev = R;
-    P += dP;
-    if ( P < Ia )
-      R = 0;
-    else
-    {
-      R = pow( P - Ia, 2 ) / ( P - Ia + S );
-    }
-    runoff[i] += ( R - Rprev ) * factor;
-  }
+  ReosRunoffBatch::addCurveNumberRunoff( cumulativeRain.constData(), n,
+                                         ReosRunoffBatch::curveNumberPotentialRetention( mCurveNumberParameter->value() ),
+                                         initialRetentionValue(), factor, runoffResult->data() );
 
   return true;
 }
@@ -1292,6 +1193,14 @@ ReosParameterDouble *ReosRunoffCurveNumberModel::initialRetention() const
   return mInitialRetentionParameter;
 }
 
+double ReosRunoffCurveNumberModel::initialRetentionValue() const
+{
+  if ( mInitialRetentionFromS->value() )
+    return 0.2 * ReosRunoffBatch::curveNumberPotentialRetention( mCurveNumberParameter->value() );
+
+  return mInitialRetentionParameter->value();
+}
+
 ReosRunoffCurveNumberModel::ReosRunoffCurveNumberModel( const ReosEncodedElement &element, QObject *parent ):
   ReosRunoffModel( element, parent )
 {
@@ -23,6 +23,7 @@
 #include "reosduration.h"
 #include "reosmodule.h"
 #include "reosdataobject.h"
+#include "reosrunoffbatch.h"
 
 class ReosTimeSerieConstantInterval;
 class ReosParameter;
@@ -201,6 +202,12 @@ class REOSCORE_EXPORT ReosRunoff : public ReosDataObject
     //! Sets the rainfall
     void setRainfall( ReosTimeSerieConstantInterval *rainfall );
 
+    //! Returns the rainfall the runoff is calculated from
+    ReosTimeSerieConstantInterval *rainfall() const;
+
+    //! Returns the group of runoff models applied on the rainfall
+    ReosRunoffModelsGroup *runoffModelsGroup() const;
+
     //! Returns the current values count
     int valueCount() const;
 
@@ -219,6 +226,12 @@ class REOSCORE_EXPORT ReosRunoff : public ReosDataObject
     //! Returns a pointer to the time series that represents the result values of the runoff
     ReosTimeSerieConstantInterval *data() const;
 
+    /**
+     * Returns a hash of the data the runoff is calculated from, that is the rainfall values and the runoff models with their parameters.
+     * The runoff is not calculated, an empty array is returned if the rainfall or the runoff models are not set.
+     */
+    QByteArray inputHash() const;
+
   protected:
     QPointer<ReosTimeSerieConstantInterval> mRainfall;
     QPointer<ReosRunoffModelsGroup> mRunoffModelsGroups;
@@ -398,6 +411,9 @@ class REOSCORE_EXPORT ReosRunoffGreenAmptModel: public ReosRunoffModel
     ReosEncodedElement encode() const override;
     static ReosRunoffGreenAmptModel *create( const ReosEncodedElement &element, QObject *parent = nullptr );
 
+    //! Returns the current values of the parameters
+    ReosRunoffBatch::GreenAmptParameters greenAmptParameters() const;
+
   private:
     ReosRunoffGreenAmptModel( const ReosEncodedElement &element, QObject *parent = nullptr );
 
@@ -428,6 +444,9 @@ class REOSCORE_EXPORT ReosRunoffCurveNumberModel: public ReosRunoffModel
     ReosParameterBoolean *initialRetentionFromS() const;
     ReosParameterDouble *initialRetention() const;
 
+    //! Returns the initial retention used by the model, calculated from S or from the initial retention parameter
+    double initialRetentionValue() const;
+
   private:
     ReosRunoffCurveNumberModel( const ReosEncodedElement &element, QObject *parent = nullptr );
 
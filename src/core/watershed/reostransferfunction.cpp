@@ -18,9 +18,23 @@
 #include "reoswatershed.h"
 #include "reosrunoffmodel.h"
 #include "reoshydrograph.h"
+#include "reoshydrographconvolution.h"
 
 #include <cmath>
 
+//! Returns the runoff with time step divided by \a reduceTimeStepFactor, values are divided accordingly
+static QVector<double> runoffWithReducedTimeStep( const QVector<double> &runoffData, int reduceTimeStepFactor )
+{
+  if ( reduceTimeStepFactor <= 1 )
+    return runoffData;
+
+  QVector<double> ret( runoffData.count() * reduceTimeStepFactor );
+  for ( int i = 0; i < ret.count(); ++i )
+    ret[i] = runoffData.at( i / reduceTimeStepFactor ) / reduceTimeStepFactor;
+
+  return ret;
+}
+
 ReosTransferFunction::ReosTransferFunction( ReosWatershed *watershed ):
   ReosDataObject( watershed )
   , mWatershed( watershed )
@@ -50,6 +64,28 @@ ReosParameterArea *ReosTransferFunction::area() const
   return mArea;
 }
 
+ReosHydrographCalculation *ReosTransferFunction::calculationProcess( ReosRunoff *runoff )
+{
+  if ( !runoff || !runoff->data() )
+    return nullptr;
+
+  ReosTimeSerieConstantInterval *runoffTimeSerie = runoff->data();
+  ReosTransferFunctionCalculation *calculation = createCalculation( runoffTimeSerie->timeStepParameter()->value(), runoffTimeSerie->referenceTime() );
+  if ( calculation )
+    calculation->setRunoffData( runoffTimeSerie->constData() );
+
+  return calculation;
+}
+
+ReosTransferFunctionCalculation::ReosTransferFunctionCalculation( const QVector<double> &runoffData )
+  : mRunoffData( runoffData )
+{}
+
+void ReosTransferFunctionCalculation::setRunoffData( const QVector<double> &runoffData )
+{
+  mRunoffData = runoffData;
+}
+
 void ReosTransferFunction::encodeBase( ReosEncodedElement &element ) const
 {
   if ( !mWatershed )
@@ -152,11 +188,8 @@ ReosEncodedElement ReosTransferFunctionLinearReservoir::encode() const
   return element;
 }
 
-ReosHydrographCalculation *ReosTransferFunctionLinearReservoir::calculationProcess( ReosRunoff *runoff )
+ReosTransferFunctionCalculation *ReosTransferFunctionLinearReservoir::createCalculation( const ReosDuration &timeStep, const QDateTime &referenceTime )
 {
-  if ( !runoff )
-    return nullptr;
-
   ReosDuration lagTime;
 
   if ( mUseConcentrationTime->value() )
@@ -167,7 +200,7 @@ ReosHydrographCalculation *ReosTransferFunctionLinearReservoir::calculationProce
   if ( lagTime < ReosDuration( qint64( 0 ) ) )
     return nullptr;
 
-  return new Calculation( runoff->data()->constData(), lagTime, area()->value(), runoff->timeStep(), runoff->data()->referenceTime() );
+  return new Calculation( QVector<double>(), lagTime, area()->value(), timeStep, referenceTime );
 }
 
 ReosTransferFunctionLinearReservoir *ReosTransferFunctionLinearReservoir::decode( const ReosEncodedElement &element, ReosWatershed *watershed )
@@ -253,11 +286,9 @@ ReosEncodedElement ReosTransferFunctionGeneralizedRationalMethod::encode() const
   return element;
 }
 
-ReosHydrographCalculation *ReosTransferFunctionGeneralizedRationalMethod::calculationProcess( ReosRunoff *runoff )
+ReosTransferFunctionCalculation *ReosTransferFunctionGeneralizedRationalMethod::createCalculation( const ReosDuration &timeStep, const QDateTime &referenceTime )
 {
-  if ( !runoff || !runoff->data() )
-    return nullptr;
-  return new Calculation( runoff->data()->constData(), concentrationTime()->value(), area()->value(), runoff->timeStep(), runoff->data()->referenceTime() );
+  return new Calculation( QVector<double>(), concentrationTime()->value(), area()->value(), timeStep, referenceTime );
 }
 
 ReosTransferFunction *ReosTransferFunctionGeneralizedRationalMethod::decode( const ReosEncodedElement &element, ReosWatershed *watershed )
@@ -599,14 +630,9 @@ ReosEncodedElement ReosTransferFunctionSCSUnitHydrograph::encode() const
   return element;
 }
 
-ReosHydrographCalculation *ReosTransferFunctionSCSUnitHydrograph::calculationProcess( ReosRunoff *runoff )
+ReosTransferFunctionCalculation *ReosTransferFunctionSCSUnitHydrograph::createCalculation( const ReosDuration &runoffTimeStep, const QDateTime &referenceTime )
 {
-  if ( !runoff || !runoff->data() )
-    return nullptr;
-
-  ReosTimeSerieConstantInterval *runoffTimeSerie = runoff->data();
-  QDateTime referenceTime = runoffTimeSerie->referenceTime();
-  ReosDuration timeStep = runoffTimeSerie->timeStepParameter()->value();
+  ReosDuration timeStep = runoffTimeStep;
 
   if ( mUseConcentrationTime->value() )
   {
@@ -639,7 +665,7 @@ ReosHydrographCalculation *ReosTransferFunctionSCSUnitHydrograph::calculationPro
   }
   while ( peakTime <=  timeStep * 2 && counter < 100 );
 
-  return new Calculation( runoffTimeSerie->constData(), reduceTimeStepFactor, timeStep, referenceTime, peakTime, mPeakRateFactor->value(), area()->value() );
+  return new Calculation( QVector<double>(), reduceTimeStepFactor, timeStep, referenceTime, peakTime, mPeakRateFactor->value(), area()->value() );
 }
 
 ReosTransferFunction *ReosTransferFunctionSCSUnitHydrograph::decode( const ReosEncodedElement &element, ReosWatershed *watershed )
@@ -919,7 +945,7 @@ QVector<ReosTransferFunctionSCSUnitHydrograph::UH_SCS_dimensionneless> ReosTrans
 };
 
 ReosTransferFunctionSCSUnitHydrograph::Calculation::Calculation( const QVector<double> runoffData, int reduceTimeStepFactor, const ReosDuration &timeStep, const QDateTime &referenceTime, const ReosDuration &peakTime, double peakFactor, const ReosArea &area ):
-  mRunoffData( runoffData )
+  ReosTransferFunctionCalculation( runoffData )
   , mReduceTimeStepFactor( reduceTimeStepFactor )
   , mTimeStep( timeStep )
   , mReferenceTime( referenceTime )
@@ -937,32 +963,26 @@ void ReosTransferFunctionSCSUnitHydrograph::Calculation::start()
 
   mIsSuccessful = false;
 
-  mHydrograph = std::make_unique<ReosHydrograph>();
-
   std::unique_ptr<ReosHydrograph> unitHydrograph = createUnitHydrograph();
 
+  // the unit hydrograph is resampled with the effective time step to be convoluted in one pass with the runoff
+  const QVector<double> kernel = ReosHydrographConvolution::resample( unitHydrograph.get(), mTimeStep );
+  const QVector<double> runoff = runoffWithReducedTimeStep( mRunoffData, mReduceTimeStepFactor );
+  const QVector<double> values = ReosHydrographConvolution::convolve( runoff, kernel, ReosHydrographConvolution::Automatic, this );
+
+  if ( isStop() )
+    return;
+
+  mHydrograph = std::make_unique<ReosHydrograph>();
   mHydrograph->setReferenceTime( mReferenceTime );
-  int stepCount = mRunoffData.count() * mReduceTimeStepFactor;
-  setMaxProgression( stepCount );
-  for ( int i = 0; i < stepCount; ++i )
-  {
-    ReosDuration relativeTime = mTimeStep * i;
-    unitHydrograph->setReferenceTime( mReferenceTime.addMSecs( relativeTime.valueMilliSecond() ) );
-    mHydrograph->addOther( unitHydrograph.get(), mRunoffData.at( i / mReduceTimeStepFactor ) / mReduceTimeStepFactor, false );
-    if ( isStop() )
-    {
-      mHydrograph.reset();
-      break;
-    }
-    setCurrentProgression( i );
-  }
+  mHydrograph->setValues( ReosHydrographConvolution::constantTimeSteps( mTimeStep, values.count() ), values );
 
-  mIsSuccessful = !isStop();
+  mIsSuccessful = true;
 }
 
 
 ReosTransferFunctionLinearReservoir::Calculation::Calculation( const QVector<double> runoffData, ReosDuration lagTime, const ReosArea &area, const ReosDuration &timeStep, const QDateTime &referenceTime ):
-  mRunoffData( runoffData )
+  ReosTransferFunctionCalculation( runoffData )
   , mLagTime( lagTime )
   , mArea( area )
   , mTimeStep( timeStep )
@@ -977,49 +997,42 @@ void ReosTransferFunctionLinearReservoir::Calculation::start()
 
   mIsSuccessful = false;
 
-  mHydrograph = std::make_unique<ReosHydrograph>();
-
   double adt = mTimeStep / mLagTime;
   double wsArea = mArea.valueM2();
   double dt = mTimeStep.valueSecond();
   double qPrev = 0;
 
-  mHydrograph->setReferenceTime( mReferenceTime );
-  mHydrograph->setValue( ReosDuration(), 0 );
+  QVector<double> values;
+  values.reserve( mRunoffData.count() + 1 );
+  values.append( 0 );
   setMaxProgression( mRunoffData.count() );
   for ( int i = 0; i < mRunoffData.count(); ++i )
   {
     double intensity = mRunoffData.at( i ) / dt;
     double q = qPrev * exp( -adt ) + intensity * ( 1 - exp( -adt ) ) / 1000 * wsArea;
-    mHydrograph->setValue( mTimeStep * ( i + 1 ), q );
+    values.append( q );
     qPrev = q;
 
     if ( isStop() )
-    {
-      mHydrograph.reset();
-      break;
-    }
+      return;
+
     setCurrentProgression( i );
   }
 
-  if ( !isStop() )
+  double lastQ = qPrev;
+  while ( qPrev != 0 && qPrev > lastQ / 100 )
   {
-    double lastQ = qPrev;
-    int i = mRunoffData.count() + 1;
-    while ( qPrev != 0 && qPrev > lastQ / 100 )
-    {
-      mHydrograph->setValue( mTimeStep * ( i ),  qPrev * exp( -adt ) );
-      qPrev = qPrev * exp( -adt );
-      ++i;
-      if ( isStop() )
-      {
-        mHydrograph.reset();
-        break;
-      }
-    }
+    values.append( qPrev * exp( -adt ) );
+    qPrev = qPrev * exp( -adt );
+    if ( isStop() )
+      return;
   }
 
-  mIsSuccessful = !isStop();
+  mHydrograph = std::make_unique<ReosHydrograph>();
+  mHydrograph->setReferenceTime( mReferenceTime );
+  mHydrograph->setValues( ReosHydrographConvolution::constantTimeSteps( mTimeStep, values.count() ), values );
+
+  mIsSuccessful = true;
 }
 
 
@@ -1029,7 +1042,7 @@ ReosTransferFunctionGeneralizedRationalMethod::Calculation::Calculation( const Q
     const ReosArea &area,
     const ReosDuration &timeStep,
     const QDateTime &referenceTime ):
-  mRunoffData( runoffData )
+  ReosTransferFunctionCalculation( runoffData )
   , mConcentrationTime( concentrationTime )
   , mArea( area )
   , mTimeStep( timeStep )
@@ -1044,7 +1057,6 @@ void ReosTransferFunctionGeneralizedRationalMethod::Calculation::start()
 
   mIsSuccessful = false;
 
-  mHydrograph = std::make_unique<ReosHydrograph>();
   ReosDuration::Unit timeUnit = ReosDuration::second;
   //! Construct the unit hydrograph
   double peakRatio = ( mArea.valueM2() / ( 1000 * mTimeStep.valueUnit( timeUnit ) ) ) * std::min( 1.0, mTimeStep / mConcentrationTime );
@@ -1057,23 +1069,75 @@ void ReosTransferFunctionGeneralizedRationalMethod::Calculation::start()
   unitHydrograph.setValue( d2, peakRatio );
   unitHydrograph.setValue( d3, 0 );
 
+  const int runoffCount = mRunoffData.count();
+  if ( mTimeStep <= ReosDuration() )
+    return;
 
-  unitHydrograph.setReferenceTime( mReferenceTime );
-  mHydrograph->setReferenceTime( mReferenceTime );
-  setMaxProgression( mRunoffData.count() );
-  for ( int i = 0; i < mRunoffData.count(); ++i )
+  if ( runoffCount == 0 )
   {
-    unitHydrograph.setReferenceTime( mReferenceTime.addMSecs( mTimeStep.valueMilliSecond()*i ) );
-    mHydrograph->addOther( &unitHydrograph, mRunoffData.at( i ) );
-    if ( isStop() )
+    mHydrograph = std::make_unique<ReosHydrograph>();
+    mHydrograph->setReferenceTime( mReferenceTime );
+    mIsSuccessful = true;
+    return;
+  }
+
+  // The unit hydrograph is linear between 0, d1, d2 and d3 and the runoff is shifted by multiples of the time step.
+  // So, the resulting hydrograph is exactly defined by two series with constant time step, one aligned on the time step,
+  // and one aligned on the concentration time. Each one is obtained by a convolution of the runoff by the unit hydrograph
+  // sampled with the same alignment.
+  const qint64 timeStepMs = mTimeStep.valueMilliSecond();
+  const qint64 concentrationTimeMs = mConcentrationTime.valueMilliSecond();
+  const ReosDuration shift( qint64( concentrationTimeMs % timeStepMs ) );
+  const int shiftedFirstIndex = static_cast<int>( concentrationTimeMs / timeStepMs );
+
+  const QVector<double> alignedKernel = ReosHydrographConvolution::resample( &unitHydrograph, mTimeStep );
+  const QVector<double> shiftedKernel = ReosHydrographConvolution::resample( &unitHydrograph, mTimeStep, shift );
+
+  setMaxProgression( 2 );
+  const QVector<double> alignedValues = ReosHydrographConvolution::convolve( mRunoffData, alignedKernel );
+  if ( isStop() )
+    return;
+  setCurrentProgression( 1 );
+  const QVector<double> shiftedValues = ReosHydrographConvolution::convolve( mRunoffData, shiftedKernel );
+  if ( isStop() )
+    return;
+  setCurrentProgression( 2 );
+
+  // merge the two series on the time steps covered by the runoff shifts
+  QVector<ReosDuration> times;
+  QVector<double> values;
+  times.reserve( 2 * ( runoffCount + 1 ) );
+  values.reserve( 2 * ( runoffCount + 1 ) );
+
+  int alignedIndex = 0;
+  int shiftedIndex = shiftedFirstIndex;
+  const int shiftedLastIndex = shiftedFirstIndex + runoffCount;
+  while ( alignedIndex <= runoffCount || shiftedIndex <= shiftedLastIndex )
+  {
+    const ReosDuration alignedTime = mTimeStep * alignedIndex;
+    const ReosDuration shiftedTime = shift + mTimeStep * shiftedIndex;
+
+    if ( shiftedIndex > shiftedLastIndex || ( alignedIndex <= runoffCount && alignedTime <= shiftedTime ) )
     {
-      mHydrograph.reset();
-      break;
+      times.append( alignedTime );
+      values.append( alignedIndex < alignedValues.count() ? alignedValues.at( alignedIndex ) : 0 );
+      if ( shiftedIndex <= shiftedLastIndex && alignedTime == shiftedTime )
+        ++shiftedIndex;
+      ++alignedIndex;
+    }
+    else
+    {
+      times.append( shiftedTime );
+      values.append( shiftedIndex < shiftedValues.count() ? shiftedValues.at( shiftedIndex ) : 0 );
+      ++shiftedIndex;
     }
-    setCurrentProgression( i );
   }
 
-  mIsSuccessful = !isStop();
+  mHydrograph = std::make_unique<ReosHydrograph>();
+  mHydrograph->setReferenceTime( mReferenceTime );
+  mHydrograph->setValues( times, values );
+
+  mIsSuccessful = true;
 }
 
 ReosTransferFunctionNashUnitHydrograph::ReosTransferFunctionNashUnitHydrograph( ReosWatershed *watershed ):
@@ -1154,21 +1218,15 @@ ReosParameterBoolean *ReosTransferFunctionNashUnitHydrograph::useConcentrationTi
   return mUseConcentrationTime;
 }
 
-ReosHydrographCalculation *ReosTransferFunctionNashUnitHydrograph::calculationProcess( ReosRunoff *runoff )
+ReosTransferFunctionCalculation *ReosTransferFunctionNashUnitHydrograph::createCalculation( const ReosDuration &timeStep, const QDateTime &referenceTime )
 {
-  if ( !runoff || !runoff->data() )
-    return nullptr;
-
-  ReosTimeSerieConstantInterval *runoffTimeSerie = runoff->data();
-  QDateTime referenceTime = runoffTimeSerie->referenceTime();
-
   ReosDuration K;
   if ( mUseConcentrationTime->value() )
     K = concentrationTime()->value() / mNParam->value();
   else
     K = mKParam->value();
 
-  return new Calculation( runoffTimeSerie->constData(), runoffTimeSerie->timeStepParameter()->value(), referenceTime, K, mNParam->value(), area()->value() );
+  return new Calculation( QVector<double>(), timeStep, referenceTime, K, mNParam->value(), area()->value() );
 }
 
 
@@ -1192,7 +1250,7 @@ ReosTransferFunctionNashUnitHydrograph::Calculation::Calculation( const QVector<
     const ReosDuration KParam,
     int nParam,
     const ReosArea &area ):
-  mRunoffData( runoffData )
+  ReosTransferFunctionCalculation( runoffData )
   , mKParam( KParam )
   , mNParam( nParam )
   , mReferenceTime( referenceTime )
@@ -1221,38 +1279,30 @@ void ReosTransferFunctionNashUnitHydrograph::Calculation::start()
     return;
   }
 
-  std::unique_ptr<ReosHydrograph> unitHydrograph = createUnitHydrograph( effectiveTimeStep );
+  const QVector<double> unitHydrograph = createUnitHydrograph( effectiveTimeStep );
 
   if ( isStop() )
   {
     return;
   }
 
+  const QVector<double> runoff = runoffWithReducedTimeStep( mRunoffData, timeStepReductionFactor );
+  const QVector<double> values = ReosHydrographConvolution::convolve( runoff, unitHydrograph, ReosHydrographConvolution::Automatic, this );
+
+  if ( isStop() )
+    return;
+
   mHydrograph = std::make_unique<ReosHydrograph>();
   mHydrograph->dataProvider()->setReferenceTime( mReferenceTime );
-  int stepCount = mRunoffData.count() * timeStepReductionFactor;
-  setMaxProgression( stepCount );
-  for ( int i = 0; i < stepCount; ++i )
-  {
-    ReosDuration relativeTime = effectiveTimeStep * i;
-    unitHydrograph->setReferenceTime( mReferenceTime.addMSecs( relativeTime.valueMilliSecond() ) );
-    mHydrograph->addOther( unitHydrograph.get(), mRunoffData.at( i / timeStepReductionFactor ) / timeStepReductionFactor );
-    if ( isStop() )
-    {
-      mHydrograph.reset();
-      break;
-    }
-    setCurrentProgression( i );
-  }
+  mHydrograph->setValues( ReosHydrographConvolution::constantTimeSteps( effectiveTimeStep, values.count() ), values );
 
-  mIsSuccessful = !isStop();
+  mIsSuccessful = true;
 }
 
-std::unique_ptr<ReosHydrograph> ReosTransferFunctionNashUnitHydrograph::Calculation::createUnitHydrograph( const ReosDuration &timeStep ) const
+QVector<double> ReosTransferFunctionNashUnitHydrograph::Calculation::createUnitHydrograph( const ReosDuration &timeStep ) const
 {
-  std::unique_ptr<ReosHydrograph> hydrograph = std::make_unique<ReosHydrograph>();
+  QVector<double> values;
 
-  hydrograph->setReferenceTime( mReferenceTime );
   double Q = -1;
   double peak = -1;
   ReosDuration t;
@@ -1267,12 +1317,12 @@ std::unique_ptr<ReosHydrograph> ReosTransferFunctionNashUnitHydrograph::Calculat
     Q = firstTerm * secondTerme * thirdTerme * mArea.valueInUnit( ReosArea::m2 ) / 1000;
     if ( Q > peak )
       peak = Q;
-    hydrograph->setValue( t, Q );
+    values.append( Q );
     t = t + timeStep;
   }
   while ( ( Q == 0  || Q > 0.005  * peak ) && ! isStop() );
 
-  return hydrograph;
+  return values;
 }
 
 ReosTransferFunction *ReosTransferFunctionNashUnitHydrographFactory::createTransferFunction( ReosWatershed *watershed ) const
@@ -26,6 +26,18 @@ class ReosRunoff;
 class ReosWatershed;
 class ReosHydrograph;
 
+//! Class that represents the calculation of the hydrograph of a transfer function from runoff values
+class REOSCORE_EXPORT ReosTransferFunctionCalculation : public ReosHydrographCalculation
+{
+  public:
+    //! Sets the \a runoffData the hydrograph is calculated from, has to be called before the process is started
+    void setRunoffData( const QVector<double> &runoffData );
+
+  protected:
+    ReosTransferFunctionCalculation( const QVector<double> &runoffData );
+
+    QVector<double> mRunoffData;
+};
 
 //! Class that reprsents a transfer function, that is a tranformation from runoff to hydrograph
 class REOSCORE_EXPORT ReosTransferFunction : public ReosDataObject
@@ -54,7 +66,15 @@ class REOSCORE_EXPORT ReosTransferFunction : public ReosDataObject
     virtual ReosEncodedElement encode() const = 0;
 
     //! Returns a calculaton process for hydrograph calculation, the caller take ownership of the return object and keep the one of \a runoff
-    virtual ReosHydrographCalculation *calculationProcess( ReosRunoff *runoff ) = 0;
+    ReosHydrographCalculation *calculationProcess( ReosRunoff *runoff );
+
+    /**
+     * Returns a calculation process for a runoff with \a timeStep starting at \a referenceTime, without the runoff values.
+     * The runoff values have to be set with ReosTransferFunctionCalculation::setRunoffData() before the process is started,
+     * so the runoff can be calculated in the same thread as the hydrograph. Returns nullptr if the parameters are not valid.
+     * The caller takes ownership of the returned object.
+     */
+    virtual ReosTransferFunctionCalculation *createCalculation( const ReosDuration &timeStep, const QDateTime &referenceTime ) = 0;
 
   protected:
     void encodeBase( ReosEncodedElement &element ) const;
@@ -173,7 +193,7 @@ class REOSCORE_EXPORT ReosTransferFunctionLinearReservoir : public ReosTransferF
     ReosHydrograph *applyFunction( ReosRunoff *runoff, QObject *hydrographParent = nullptr ) const override;
 
     ReosEncodedElement encode() const override;
-    virtual ReosHydrographCalculation *calculationProcess( ReosRunoff *runoff ) override;
+    ReosTransferFunctionCalculation *createCalculation( const ReosDuration &timeStep, const QDateTime &referenceTime ) override;
 
     static ReosTransferFunctionLinearReservoir *decode( const ReosEncodedElement &element, ReosWatershed *watershed = nullptr );
 
@@ -187,7 +207,7 @@ class REOSCORE_EXPORT ReosTransferFunctionLinearReservoir : public ReosTransferF
     ReosParameterBoolean *mUseConcentrationTime = nullptr;
     ReosParameterDouble *mFactorToLagTime = nullptr;
 
-    class Calculation: public ReosHydrographCalculation
+    class Calculation: public ReosTransferFunctionCalculation
     {
       public:
         Calculation( const QVector<double> runoffData,
@@ -199,7 +219,6 @@ class REOSCORE_EXPORT ReosTransferFunctionLinearReservoir : public ReosTransferF
         void start() override;
 
       private:
-        QVector<double> mRunoffData;
         ReosDuration mLagTime;
         ReosArea mArea;
         ReosDuration mTimeStep;
@@ -245,14 +264,14 @@ class REOSCORE_EXPORT ReosTransferFunctionGeneralizedRationalMethod : public Reo
 
     ReosHydrograph *applyFunction( ReosRunoff *runoff, QObject *hydrographParent = nullptr ) const override;
     ReosEncodedElement encode() const override;
-    ReosHydrographCalculation *calculationProcess( ReosRunoff *runoff ) override;
+    ReosTransferFunctionCalculation *createCalculation( const ReosDuration &timeStep, const QDateTime &referenceTime ) override;
 
     static ReosTransferFunction *decode( const ReosEncodedElement &element, ReosWatershed *watershed = nullptr );
 
   private:
     ReosTransferFunctionGeneralizedRationalMethod( const ReosEncodedElement &element, ReosWatershed *watershed = nullptr );
 
-    class Calculation: public ReosHydrographCalculation
+    class Calculation: public ReosTransferFunctionCalculation
     {
       public:
         Calculation( const QVector<double> runoffData,
@@ -264,7 +283,6 @@ class REOSCORE_EXPORT ReosTransferFunctionGeneralizedRationalMethod : public Reo
         void start() override;
 
       private:
-        QVector<double> mRunoffData;
         ReosDuration mConcentrationTime;
         ReosArea mArea;
         ReosDuration mTimeStep;
@@ -300,7 +318,7 @@ class REOSCORE_EXPORT ReosTransferFunctionSCSUnitHydrograph : public ReosTransfe
 
     ReosHydrograph *applyFunction( ReosRunoff *runoff, QObject *parent = nullptr ) const override;
     ReosEncodedElement encode() const override;
-    ReosHydrographCalculation *calculationProcess( ReosRunoff *runoff ) override;
+    ReosTransferFunctionCalculation *createCalculation( const ReosDuration &timeStep, const QDateTime &referenceTime ) override;
 
     static ReosTransferFunction *decode( const ReosEncodedElement &element, ReosWatershed *watershed = nullptr );
 
@@ -319,7 +337,7 @@ class REOSCORE_EXPORT ReosTransferFunctionSCSUnitHydrograph : public ReosTransfe
   private:
     ReosTransferFunctionSCSUnitHydrograph( const ReosEncodedElement &element, ReosWatershed *watershed = nullptr );
 
-    class Calculation: public ReosHydrographCalculation
+    class Calculation: public ReosTransferFunctionCalculation
     {
       public:
         Calculation( const QVector<double> runoffData,
@@ -333,7 +351,6 @@ class REOSCORE_EXPORT ReosTransferFunctionSCSUnitHydrograph : public ReosTransfe
         void start() override;
 
       private:
-        QVector<double> mRunoffData;
         int mReduceTimeStepFactor = 0;
         ReosDuration mTimeStep;
         QDateTime mReferenceTime;
@@ -391,12 +408,12 @@ class REOSCORE_EXPORT ReosTransferFunctionNashUnitHydrograph : public ReosTransf
     ReosParameterInteger *nParam() const;
     ReosParameterBoolean *useConcentrationTime() const;
 
-    ReosHydrographCalculation *calculationProcess( ReosRunoff *runoff ) override;
+    ReosTransferFunctionCalculation *createCalculation( const ReosDuration &timeStep, const QDateTime &referenceTime ) override;
 
   private:
     ReosTransferFunctionNashUnitHydrograph( const ReosEncodedElement &element, ReosWatershed *watershed = nullptr );
 
-    class Calculation: public ReosHydrographCalculation
+    class Calculation: public ReosTransferFunctionCalculation
     {
       public:
         Calculation( const QVector<double> runoffData,
@@ -409,14 +426,14 @@ class REOSCORE_EXPORT ReosTransferFunctionNashUnitHydrograph : public ReosTransf
         void start() override;
 
       private:
-        QVector<double> mRunoffData;
         const ReosDuration mKParam;
         int mNParam;
         QDateTime mReferenceTime;
         ReosArea mArea;
         const ReosDuration mTimeStep;
 
-        std::unique_ptr<ReosHydrograph> createUnitHydrograph( const ReosDuration &timeStep ) const;
+        //! Returns the values of the unit hydrograph with constant \a timeStep
+        QVector<double> createUnitHydrograph( const ReosDuration &timeStep ) const;
     };
 
 
@@ -81,7 +81,7 @@ ReosWatershed::ReosWatershed( const QPolygonF &delineating,
   mStreamPath( streamPath )
 {
   init();
-  DirectionData dir {direction, rasterExtent};
+  DirectionData dir {ReosDirectionRasterStore::createEntry( refLayerId, rasterExtent, direction ), rasterExtent};
   mDirectionData.insert( {refLayerId, dir} );
 
   RasterizedWatershedData rw{rasterizedWatershed, rasterExtent};
@@ -128,7 +128,7 @@ ReosRasterWatershed::Directions ReosWatershed::directions( const QString &layerI
   std::map<QString, DirectionData>::const_iterator it =  mDirectionData.find( layerId );
 
   if ( it != mDirectionData.end() )
-    return it->second.directionRaster.uncompressRaster();
+    return ReosDirectionRasterStore::directions( it->second.directionRaster, it->second.directionExtent );
 
   if ( mDownstreamWatershed )
     return mDownstreamWatershed->directions( layerId );
@@ -158,6 +158,7 @@ void ReosWatershed::setDelineating( const QPolygonF &del )
   if ( mArea->isDerived() )
     calculateArea();
 
+  loadGeometry();
   mRasterizedWatershedData.clear();
   mDelineatingReferenceLayer.clear();
   mAverageElevation->setInvalid();
@@ -403,6 +404,15 @@ void ReosWatershed::removeDirectionData()
     mUpstreamWatersheds.at( i )->removeDirectionData();
 }
 
+void ReosWatershed::shareDirectionData( ReosDirectionRasterStore *store )
+{
+  for ( auto &it : mDirectionData )
+    it.second.directionRaster = store->share( it.second.directionRaster );
+
+  for ( size_t i = 0; i < mUpstreamWatersheds.size(); ++i )
+    mUpstreamWatersheds.at( i )->shareDirectionData( store );
+}
+
 void ReosWatershed::fitIn( const ReosWatershed &other )
 {
   if ( ReosGeometryUtils::polygonIsInsidePolygon( mDelineating, other.mDelineating ) == ReosInclusionType::Partial )
@@ -439,11 +449,13 @@ void ReosWatershed::extentTo( const ReosWatershed &other )
 
 QPolygonF ReosWatershed::streamPath() const
 {
+  loadGeometry();
   return mStreamPath;
 }
 
 void ReosWatershed::setStreamPath( const QPolygonF &streamPath )
 {
+  loadGeometry();
   mStreamPath = streamPath;
   emit dataChanged();
 }
@@ -458,11 +470,13 @@ ReosWatershed *ReosWatershed::residualWatershed() const
 
 QPolygonF ReosWatershed::profile() const
 {
+  loadGeometry();
   return mProfile;
 }
 
 void ReosWatershed::setProfile( const QPolygonF &profile )
 {
+  loadGeometry();
   mProfile = profile;
   mSlope->updateIfNecessary();
   mDrop->updateIfNecessary();
@@ -476,6 +490,15 @@ void ReosWatershed::setGeographicalContext( ReosGisEngine *gisEngine )
   mGisEngine = gisEngine;
 }
 
+QString ReosWatershed::crs() const
+{
+  ReosGisEngine *engine = geographicalContext();
+  if ( engine )
+    return engine->crs();
+
+  return QString();
+}
+
 ReosParameterArea *ReosWatershed::area() const
 {
   return mArea;
@@ -501,7 +524,7 @@ ReosParameterDuration *ReosWatershed::concentrationTime() const
   return mConcentrationTimeValue;
 }
 
-ReosEncodedElement ReosWatershed::encode() const
+ReosEncodedElement ReosWatershed::encode( const ReosDirectionRasterStore *store ) const
 {
   ReosEncodedElement ret( QStringLiteral( "watershed" ) );
 
@@ -510,44 +533,67 @@ ReosEncodedElement ReosWatershed::encode() const
   ret.addData( QStringLiteral( "delineating" ), mDelineating );
   ret.addData( QStringLiteral( "outlet-point" ), mOutletPoint );
   ret.addData( QStringLiteral( "downstream-line" ), mDownstreamLine );
-  ret.addData( QStringLiteral( "stream-path" ), mStreamPath );
-  ret.addData( QStringLiteral( "profile" ), mProfile );
 
   QList<QString> directionKeys;
   QList<QByteArray> directionExtents;
+  QList<int> directionStoreIndexes;
   QList<QByteArray> directionData;
 
-  for ( auto it : mDirectionData )
+  for ( const auto &it : mDirectionData )
   {
     directionKeys.append( it.first );
     directionExtents.append( it.second.directionExtent.encode().bytes() );
-    directionData.append( it.second.directionRaster.encode().bytes() );
+
+    // if the raster is in the store, only the window is encoded with the watershed
+    const int storeIndex = store ? store->indexOf( it.second.directionRaster ) : -1;
+    directionStoreIndexes.append( storeIndex );
+    if ( storeIndex >= 0 )
+      directionData.append( QByteArray() );
+    else
+    {
+      ReosEncodedElement encodedDirections( QStringLiteral( "direction-raster" ) );
+      encodedDirections.addData( QStringLiteral( "extent" ), it.second.directionRaster->extent().encode().bytes() );
+      encodedDirections.addEncodedData( QStringLiteral( "directions" ), it.second.directionRaster->directions().encode() );
+      directionData.append( encodedDirections.bytes() );
+    }
   }
 
   ret.addData( QStringLiteral( "direction-keys" ), directionKeys );
   ret.addData( QStringLiteral( "direction-extents" ), directionExtents );
-  ret.addData( QStringLiteral( "direction-data" ), directionData );
-
-  QList<QString> rasterizedKeys;
-  QList<QByteArray> rasterizedExtents;
-  QList<QByteArray> rasterizedData;
+  ret.addData( QStringLiteral( "direction-store-indexes" ), directionStoreIndexes );
+  ret.addData( QStringLiteral( "direction-rasters" ), directionData );
 
-  for ( auto it : mRasterizedWatershedData )
+  if ( mEncodedGeometry )
   {
-    rasterizedKeys.append( it.first );
-    rasterizedExtents.append( it.second.rasterizedWatershedExtent.encode().bytes() );
-    rasterizedData.append( it.second.rasterizedWatershed.encode().bytes() );
+    // geometry not loaded since decoding, no need to decode it to encode it again
+    ret.copyData( *mEncodedGeometry );
   }
+  else
+  {
+    ret.addData( QStringLiteral( "stream-path" ), mStreamPath );
+    ret.addData( QStringLiteral( "profile" ), mProfile );
+
+    QList<QString> rasterizedKeys;
+    QList<QByteArray> rasterizedExtents;
+    QList<QByteArray> rasterizedData;
+
+    for ( auto it : mRasterizedWatershedData )
+    {
+      rasterizedKeys.append( it.first );
+      rasterizedExtents.append( it.second.rasterizedWatershedExtent.encode().bytes() );
+      rasterizedData.append( it.second.rasterizedWatershed.encode().bytes() );
+    }
 
-  ret.addData( QStringLiteral( "rasterized-keys" ), rasterizedKeys );
-  ret.addData( QStringLiteral( "rasterized-extents" ), rasterizedExtents );
-  ret.addData( QStringLiteral( "rasterized-data" ), rasterizedData );
+    ret.addData( QStringLiteral( "rasterized-keys" ), rasterizedKeys );
+    ret.addData( QStringLiteral( "rasterized-extents" ), rasterizedExtents );
+    ret.addData( QStringLiteral( "rasterized-data" ), rasterizedData );
+  }
 
   ret.addData( QStringLiteral( "delineating-reference-layer" ), mDelineatingReferenceLayer );
 
   QList<QByteArray> upstreamWatersheds;
   for ( const std::unique_ptr<ReosWatershed> &ws : mUpstreamWatersheds )
-    upstreamWatersheds.append( ws->encode().bytes() );
+    upstreamWatersheds.append( ws->encode( store ).bytes() );
 
   ret.addData( QStringLiteral( "upstream-watersheds" ), upstreamWatersheds );
 
@@ -580,7 +626,7 @@ ReosEncodedElement ReosWatershed::encode() const
   return ret;
 }
 
-ReosWatershed *ReosWatershed::decode( const ReosEncodedElement &element )
+ReosWatershed *ReosWatershed::decode( const ReosEncodedElement &element, const ReosDirectionRasterStore *store )
 {
   if ( element.description() != QStringLiteral( "watershed" ) )
     return nullptr;
@@ -599,50 +645,65 @@ ReosWatershed *ReosWatershed::decode( const ReosEncodedElement &element )
     return nullptr;
   if ( !element.getData( QStringLiteral( "downstream-line" ), ws->mDownstreamLine ) )
     return nullptr;
-  if ( !element.getData( QStringLiteral( "stream-path" ), ws->mStreamPath ) )
-    return nullptr;
-  if ( !element.getData( QStringLiteral( "profile" ), ws->mProfile ) )
+  if ( !element.hasEncodedData( QStringLiteral( "stream-path" ) ) || !element.hasEncodedData( QStringLiteral( "profile" ) ) )
     return nullptr;
 
+  // the geometry is only decoded when accessed for the first time, see loadGeometry()
+  ws->mEncodedGeometry = std::make_unique<ReosEncodedElement>( element.extractData( geometryKeys() ) );
+
   QList<QString> directionKeys;
   QList<QByteArray> directionExtents;
   QList<QByteArray> directionData;
   bool directionDataPresent = true;
   directionDataPresent &= element.getData( QStringLiteral( "direction-keys" ), directionKeys );
   directionDataPresent &= element.getData( QStringLiteral( "direction-extents" ), directionExtents );
-  directionDataPresent &= element.getData( QStringLiteral( "direction-data" ), directionData );
-
-  directionDataPresent &= ( directionKeys.count() == directionExtents.count() &&
-                            directionExtents.count() == directionData.count() );
 
-  if ( directionDataPresent )
+  if ( element.hasEncodedData( QStringLiteral( "direction-rasters" ) ) )
   {
-    for ( int i = 0; i < directionKeys.count(); ++i )
+    QList<int> directionStoreIndexes;
+    directionDataPresent &= element.getData( QStringLiteral( "direction-store-indexes" ), directionStoreIndexes );
+    directionDataPresent &= element.getData( QStringLiteral( "direction-rasters" ), directionData );
+    directionDataPresent &= ( directionKeys.count() == directionExtents.count() &&
+                              directionExtents.count() == directionData.count() &&
+                              directionData.count() == directionStoreIndexes.count() );
+
+    for ( int i = 0; directionDataPresent && i < directionKeys.count(); ++i )
     {
-      DirectionData dirData{ReosRasterByteCompressed::decode( ReosEncodedElement( directionData.at( i ) ) ),
-                            ReosRasterExtent::decode( ReosEncodedElement( directionExtents.at( i ) ) )};
-      ws->mDirectionData.insert( {directionKeys.at( i ), dirData} );
+      DirectionData dirData;
+      dirData.directionExtent = ReosRasterExtent::decode( ReosEncodedElement( directionExtents.at( i ) ) );
+      const int storeIndex = directionStoreIndexes.at( i );
+      if ( storeIndex >= 0 )
+      {
+        dirData.directionRaster = store ? store->entry( storeIndex ) : nullptr;
+      }
+      else
+      {
+        const ReosEncodedElement encodedDirections( directionData.at( i ) );
+        QByteArray extent;
+        encodedDirections.getData( QStringLiteral( "extent" ), extent );
+        dirData.directionRaster = std::make_shared<const ReosDirectionRasterStore::Entry>(
+                                    directionKeys.at( i ),
+                                    ReosRasterExtent::decode( ReosEncodedElement( extent ) ),
+                                    ReosRasterByteTiledCompressed::decode( encodedDirections.getEncodedData( QStringLiteral( "directions" ) ) ) );
+      }
+
+      if ( dirData.directionRaster )
+        ws->mDirectionData.insert( {directionKeys.at( i ), dirData} );
     }
   }
-
-  QList<QString> rasterizedKeys;
-  QList<QByteArray> rasterizedExtents;
-  QList<QByteArray> rasterizedData;
-  bool rasterizedDataPresent = true;
-  rasterizedDataPresent &= element.getData( QStringLiteral( "rasterized-keys" ), rasterizedKeys );
-  rasterizedDataPresent &= element.getData( QStringLiteral( "rasterized-extents" ), rasterizedExtents );
-  rasterizedDataPresent &= element.getData( QStringLiteral( "rasterized-data" ), rasterizedData );
-
-  rasterizedDataPresent &= ( rasterizedKeys.count() == rasterizedExtents.count() &&
-                             rasterizedExtents.count() == rasterizedData.count() );
-
-  if ( rasterizedDataPresent )
+  else
   {
-    for ( int i = 0; i < rasterizedKeys.count(); ++i )
+    // direction rasters of older projects, stored in each watershed
+    directionDataPresent &= element.getData( QStringLiteral( "direction-data" ), directionData );
+    directionDataPresent &= ( directionKeys.count() == directionExtents.count() &&
+                              directionExtents.count() == directionData.count() );
+
+    for ( int i = 0; directionDataPresent && i < directionKeys.count(); ++i )
     {
-      RasterizedWatershedData rasterWsData{ReosRasterByteCompressed::decode( ReosEncodedElement( rasterizedData.at( i ) ) ),
-                                           ReosRasterExtent::decode( ReosEncodedElement( rasterizedExtents.at( i ) ) )};
-      ws->mRasterizedWatershedData.insert( {rasterizedKeys.at( i ), rasterWsData} );
+      const ReosRasterExtent extent = ReosRasterExtent::decode( ReosEncodedElement( directionExtents.at( i ) ) );
+      const ReosRasterByteCompressed oldDirections = ReosRasterByteCompressed::decode( ReosEncodedElement( directionData.at( i ) ) );
+      DirectionData dirData{ReosDirectionRasterStore::createEntry( directionKeys.at( i ), extent, oldDirections.uncompressRaster() ), extent};
+      ws->mDirectionData.insert( {directionKeys.at( i ), dirData} );
     }
   }
 
@@ -655,7 +716,7 @@ ReosWatershed *ReosWatershed::decode( const ReosEncodedElement &element )
 
   for ( const QByteArray &ba : upstreamWatersheds )
   {
-    std::unique_ptr<ReosWatershed> uws( ReosWatershed::decode( ReosEncodedElement( ba ) ) );
+    std::unique_ptr<ReosWatershed> uws( ReosWatershed::decode( ReosEncodedElement( ba ), store ) );
     if ( uws )
     {
       uws->mDownstreamWatershed = ws.get();
@@ -762,6 +823,9 @@ bool ReosWatershed::operator==( const ReosWatershed &other ) const
     return false;
   if ( mDownstreamLine != other.mDownstreamLine )
     return false;
+
+  loadGeometry();
+  other.loadGeometry();
   if ( mStreamPath != other.mStreamPath )
     return false;
 
@@ -783,7 +847,9 @@ bool ReosWatershed::operator==( const ReosWatershed &other ) const
     if ( it.second.directionExtent != otherIt->second.directionExtent )
       return false;
 
-    if ( it.second.directionRaster != otherIt->second.directionRaster )
+    if ( it.second.directionRaster != otherIt->second.directionRaster &&
+         !( ReosDirectionRasterStore::directions( it.second.directionRaster, it.second.directionExtent ) ==
+            ReosDirectionRasterStore::directions( otherIt->second.directionRaster, otherIt->second.directionExtent ) ) )
       return false;
   }
 
@@ -888,6 +954,7 @@ void ReosWatershed::calculateArea()
 
 void ReosWatershed::calculateSlope()
 {
+  loadGeometry();
   if ( mProfile.count() < 2 )
   {
     mSlope->setInvalid();
@@ -916,6 +983,7 @@ void ReosWatershed::calculateSlope()
 
 void ReosWatershed::calculateLongerPath()
 {
+  loadGeometry();
   if ( mProfile.count() < 2 )
   {
     mLongestStreamPath->setInvalid();
@@ -938,6 +1006,7 @@ void ReosWatershed::calculateLongerPath()
 
 void ReosWatershed::calculateDrop()
 {
+  loadGeometry();
   if ( mProfile.count() > 1 )
     mDrop->setDerivedValue( std::abs( mProfile.first().y() - mProfile.last().y() ) );
   else
@@ -956,6 +1025,7 @@ void ReosWatershed::calculateConcentrationTime()
   param.drop = mDrop->value();
   param.length = longestPath()->value();
   param.slope = slope()->value();
+  loadGeometry();
   if ( mProfile.isEmpty() )
     param.relativeAverageElevation = averageElevation()->value();
   else
@@ -1005,6 +1075,7 @@ void ReosWatershed::calculateAverageElevation()
 
   if ( mType == Automatic && dem && !mDelineatingReferenceLayer.isEmpty() && mDelineatingReferenceLayer == dem->source() )
   {
+    loadGeometry();
     auto it = mRasterizedWatershedData.find( mDelineatingReferenceLayer );
     if ( it != mRasterizedWatershedData.end() )
     {
@@ -1052,6 +1123,47 @@ ReosHydrograph *ReosWatershed::createHydrograph( ReosSerieRainfall *rainfall, QO
   return hydrograph.release();
 }
 
+QStringList ReosWatershed::geometryKeys()
+{
+  return {QStringLiteral( "stream-path" ),
+          QStringLiteral( "profile" ),
+          QStringLiteral( "rasterized-keys" ),
+          QStringLiteral( "rasterized-extents" ),
+          QStringLiteral( "rasterized-data" )};
+}
+
+void ReosWatershed::loadGeometry() const
+{
+  if ( !mEncodedGeometry )
+    return;
+
+  const std::unique_ptr<ReosEncodedElement> element = std::move( mEncodedGeometry );
+
+  element->getData( QStringLiteral( "stream-path" ), mStreamPath );
+  element->getData( QStringLiteral( "profile" ), mProfile );
+
+  QList<QString> rasterizedKeys;
+  QList<QByteArray> rasterizedExtents;
+  QList<QByteArray> rasterizedData;
+  bool rasterizedDataPresent = true;
+  rasterizedDataPresent &= element->getData( QStringLiteral( "rasterized-keys" ), rasterizedKeys );
+  rasterizedDataPresent &= element->getData( QStringLiteral( "rasterized-extents" ), rasterizedExtents );
+  rasterizedDataPresent &= element->getData( QStringLiteral( "rasterized-data" ), rasterizedData );
+
+  rasterizedDataPresent &= ( rasterizedKeys.count() == rasterizedExtents.count() &&
+                             rasterizedExtents.count() == rasterizedData.count() );
+
+  if ( rasterizedDataPresent )
+  {
+    for ( int i = 0; i < rasterizedKeys.count(); ++i )
+    {
+      RasterizedWatershedData rasterWsData{ReosRasterByteCompressed::decode( ReosEncodedElement( rasterizedData.at( i ) ) ),
+                                           ReosRasterExtent::decode( ReosEncodedElement( rasterizedExtents.at( i ) ) )};
+      mRasterizedWatershedData.insert( {rasterizedKeys.at( i ), rasterWsData} );
+    }
+  }
+}
+
 ReosGisEngine *ReosWatershed::geographicalContext() const
 {
   if ( mGisEngine )
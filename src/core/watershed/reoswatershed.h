@@ -20,6 +20,7 @@ email                : vcloarec at gmail dot com
 #include "reosmapextent.h"
 #include "reosrastercompressed.h"
 #include "reosrasterwatershed.h"
+#include "reosdirectionrasterstore.h"
 #include "reosexception.h"
 #include "memory"
 
@@ -111,6 +112,9 @@ class REOSCORE_EXPORT ReosWatershed: public ReosDataObject
     //! Removes direction data present in the watershed or in its children
     void removeDirectionData();
 
+    //! Replaces the direction data of the watershed and of its children by the entries shared by \a store
+    void shareDirectionData( ReosDirectionRasterStore *store );
+
     /**
      * Returns whether the watershed includes the \a point
      *
@@ -204,6 +208,9 @@ class REOSCORE_EXPORT ReosWatershed: public ReosDataObject
 
     void setGeographicalContext( ReosGisEngine *gisEngine );
 
+    //! Returns the coordinate reference system of the geometries of the watershed, the one of its geographical context, empty if none
+    QString crs() const;
+
     ReosParameterArea *area() const;
     ReosParameterSlope *slope() const;
     ReosParameterDouble *drop() const;
@@ -217,8 +224,14 @@ class REOSCORE_EXPORT ReosWatershed: public ReosDataObject
     //! Creates a hydrograph from the \a rainfall, caller has to take ownership if \a hydrograph parent is not specified
     ReosHydrograph *createHydrograph( ReosSerieRainfall *rainfall, QObject *hydrographParent = nullptr );
 
-    ReosEncodedElement encode() const;
-    static ReosWatershed *decode( const ReosEncodedElement &element );
+    /**
+     * Encodes the watershed, if \a store is not nullptr, direction data registered in \a store are encoded
+     * by their index in the store, otherwise direction data are encoded with the watershed.
+     */
+    ReosEncodedElement encode( const ReosDirectionRasterStore *store = nullptr ) const;
+
+    //! Decodes a watershed from \a element, \a store has to be the one used to encode the watershed, if any
+    static ReosWatershed *decode( const ReosEncodedElement &element, const ReosDirectionRasterStore *store = nullptr );
 
     bool operator==( const ReosWatershed &other ) const;
 
@@ -264,16 +277,17 @@ class REOSCORE_EXPORT ReosWatershed: public ReosDataObject
     QString mDelineatingReferenceLayer;
     QPointF mOutletPoint;
     QPolygonF mDownstreamLine;
-    QPolygonF mStreamPath;
-    QPolygonF mProfile;
+    mutable QPolygonF mStreamPath;
+    mutable QPolygonF mProfile;
     ReosGisEngine *mGisEngine = nullptr;
 
     //! Return mGisEngine or the one of the parent watershed if nullptr
     ReosGisEngine *geographicalContext() const;
 
+    //! Window \a directionExtent in a direction raster, the raster can be shared by several watersheds
     struct DirectionData
     {
-      ReosRasterByteCompressed directionRaster;
+      ReosDirectionRasterStore::EntryPtr directionRaster;
       ReosRasterExtent directionExtent;
     };
     std::map<QString, DirectionData> mDirectionData;
@@ -283,7 +297,16 @@ class REOSCORE_EXPORT ReosWatershed: public ReosDataObject
       ReosRasterByteCompressed rasterizedWatershed;
       ReosRasterExtent rasterizedWatershedExtent;
     };
-    std::map<QString, RasterizedWatershedData> mRasterizedWatershedData;
+    mutable std::map<QString, RasterizedWatershedData> mRasterizedWatershedData;
+
+    //! Encoded stream path, profile and rasterized watersheds, decoded when accessed for the first time, nullptr if loaded
+    mutable std::unique_ptr<ReosEncodedElement> mEncodedGeometry;
+
+    //! Returns the keys of the geometry data in the encoded watershed
+    static QStringList geometryKeys();
+
+    //! Decodes the geometry if not already loaded
+    void loadGeometry() const;
 
     //! Geomorphological characteristic
     ReosParameterArea *mArea = nullptr;
@@ -17,8 +17,11 @@ email                : vcloarec at gmail dot com
 #include "reosdigitalelevationmodel.h"
 #include "reosrasterfilling.h"
 #include "reosrasterwatershed.h"
+#include "reosrasterflowaccumulation.h"
 #include "reoswatershedtree.h"
 
+#include <QtConcurrentMap>
+
 ReosWatershedDelineating::ReosWatershedDelineating( ReosModule *parent, ReosWatershedTree *watershedtree, ReosGisEngine *gisEngine ):
   ReosModule( parent ),
   mWatershedTree( watershedtree ),
@@ -112,6 +115,7 @@ bool ReosWatershedDelineating::prepareDelineating()
     std::unique_ptr<ReosDigitalElevationModel> dem;
     dem.reset( mGisEngine->getDigitalElevationModel( mDEMLayerId ) );
     mProcess = std::make_unique<ReosWatershedDelineatingProcess>( dem.release(), mExtent, mDownstreamLine, mBurningLines, mCalculateAverageElevation );
+    mProcess->setFillingAlgorithm( mFillingAlgorithm );
   }
 
   connect( mProcess.get(), &ReosProcess::finished, this, &ReosWatershedDelineating::onDelineatingFinished );
@@ -125,6 +129,54 @@ ReosProcess *ReosWatershedDelineating::delineatingProcess()
   return mProcess.get();
 }
 
+bool ReosWatershedDelineating::prepareBatchDelineating( const QList<QPolygonF> &downstreamLines, const ReosMapExtent &extent )
+{
+  if ( mCurrentState == NoDigitalElevationModel || mCurrentState == Delineating || downstreamLines.isEmpty() )
+    return false;
+
+  // if all the lines are in the same master watershed that has direction data, these directions are used
+  ReosWatershed *masterWatershed = nullptr;
+  bool sameMasterWatershed = true;
+  for ( int i = 0; i < downstreamLines.count(); ++i )
+  {
+    if ( downstreamLines.at( i ).count() < 2 )
+      return false;
+
+    bool ok;
+    ReosWatershed *master = mWatershedTree->downstreamWatershed( downstreamLines.at( i ), ok );
+    if ( !ok )
+      return false;
+    while ( master && master->downstreamWatershed() )
+      master = master->downstreamWatershed();
+
+    if ( i == 0 )
+      masterWatershed = master;
+    sameMasterWatershed &= master && master == masterWatershed;
+  }
+
+  if ( sameMasterWatershed && masterWatershed->hasDirectiondata( mDEMLayerId ) && mIsBurningLineUpToDate )
+    mBatchProcess = std::make_unique<ReosWatershedBatchDelineatingProcess>( masterWatershed, downstreamLines, mDEMLayerId );
+  else
+  {
+    for ( const QPolygonF &line : downstreamLines )
+      if ( !extent.containsPartialy( line ) )
+        return false;
+
+    std::unique_ptr<ReosDigitalElevationModel> dem;
+    dem.reset( mGisEngine->getDigitalElevationModel( mDEMLayerId ) );
+    mBatchProcess = std::make_unique<ReosWatershedBatchDelineatingProcess>( dem.release(), extent, downstreamLines, mBurningLines, mCalculateAverageElevation );
+    mBatchProcess->setFillingAlgorithm( mFillingAlgorithm );
+  }
+
+  sendMessage( tr( "Start delineating of %n watersheds", nullptr, downstreamLines.count() ), ReosModule::Simple );
+  return true;
+}
+
+ReosProcess *ReosWatershedDelineating::batchDelineatingProcess()
+{
+  return mBatchProcess.get();
+}
+
 bool ReosWatershedDelineating::isDelineatingFinished() const
 {
   return ( mProcess && mProcess->isSuccessful() );
@@ -209,6 +261,66 @@ ReosWatershed *ReosWatershedDelineating::storeWatershed( bool adjustIfNeeded )
   return newWatershed;
 }
 
+QList<ReosWatershed *> ReosWatershedDelineating::storeBatchWatersheds( bool adjustIfNeeded )
+{
+  if ( !mBatchProcess || !mBatchProcess->isSuccessful() )
+    return QList<ReosWatershed *>();
+
+  std::unique_ptr<ReosDigitalElevationModel> dem;
+  if ( mCalculateAverageElevation && !mBatchProcess->calculateAverageElevation() )
+    dem.reset( mGisEngine->getDigitalElevationModel( mDEMLayerId ) );
+
+  QList<ReosWatershed *> watersheds;
+  QVector<int> downstreamIndexes;
+  for ( int i = 0; i < mBatchProcess->watershedCount(); ++i )
+  {
+    downstreamIndexes.append( mBatchProcess->downstreamIndex( i ) );
+    if ( !mBatchProcess->isWatershedValid( i ) )
+    {
+      watersheds.append( nullptr );
+      continue;
+    }
+
+    const QPolygonF streamLine = mBatchProcess->streamLine( i );
+    const ReosRasterWatershed::Directions directions = mBatchProcess->directions( i );
+    ReosWatershed *watershed = nullptr;
+    if ( directions.isValid() )
+      watershed = new ReosWatershed( mBatchProcess->watershedPolygon( i ),
+                                     streamLine.last(),
+                                     ReosWatershed::Automatic,
+                                     mBatchProcess->downstreamLine( i ),
+                                     streamLine,
+                                     directions,
+                                     mBatchProcess->rasterizedWatershed( i ),
+                                     mBatchProcess->outputRasterExtent( i ),
+                                     mDEMLayerId );
+    else
+      watershed = new ReosWatershed( mBatchProcess->watershedPolygon( i ),
+                                     streamLine.last(),
+                                     ReosWatershed::Automatic,
+                                     mBatchProcess->downstreamLine( i ),
+                                     streamLine,
+                                     mBatchProcess->rasterizedWatershed( i ),
+                                     mBatchProcess->outputRasterExtent( i ),
+                                     mDEMLayerId );
+
+    if ( mBatchProcess->calculateAverageElevation() && mCalculateAverageElevation )
+      watershed->averageElevation()->setDerivedValue( mBatchProcess->averageElevation( i ) );
+    else if ( dem )
+      watershed->averageElevation()->setDerivedValue( dem->averageElevationOnGrid( mBatchProcess->rasterizedWatershed( i ), mBatchProcess->outputRasterExtent( i ) ) );
+
+    watersheds.append( watershed );
+  }
+
+  const QList<ReosWatershed *> newWatersheds = mWatershedTree->addWatersheds( watersheds, downstreamIndexes, adjustIfNeeded );
+  mIsBurningLineUpToDate = true;
+  mBatchProcess.reset();
+
+  sendMessage( tr( "%n watersheds validated", nullptr, watersheds.count() - watersheds.count( nullptr ) ), ReosModule::Simple );
+
+  return newWatersheds;
+}
+
 ReosEncodedElement ReosWatershedDelineating::encode() const
 {
   ReosEncodedElement element( QStringLiteral( "watershed-delineating" ) );
@@ -347,6 +459,11 @@ void ReosWatershedDelineating::setCalculateAverageElevation( bool calculate )
   mCalculateAverageElevation = calculate;
 }
 
+void ReosWatershedDelineating::setFillingAlgorithm( ReosWatershedDelineatingProcess::FillingAlgorithm algorithm )
+{
+  mFillingAlgorithm = algorithm;
+}
+
 
 ReosWatershedDelineatingProcess::ReosWatershedDelineatingProcess( ReosDigitalElevationModel *dem,
     const ReosMapExtent &mapExtent,
@@ -370,69 +487,76 @@ ReosWatershedDelineatingProcess::ReosWatershedDelineatingProcess( ReosWatershed
 
 }
 
-void ReosWatershedDelineatingProcess::start()
+bool ReosWatershedDelineatingProcess::calculateDirections()
 {
-  mIsSuccessful = false;
+  if ( !mEntryDem )
+    return false;
 
-  bool needNewDirection = !mDirections.isValid();
-  if ( needNewDirection )
-  {
-    if ( !mEntryDem )
-    {
-      finish();
-      return;
-    }
+  //--------------------------
+  //Extract dem and fill it (burn it if needed)
+  setCurrentProgression( 0 );
+  setInformation( tr( "Extract digital elevation model" ) );
+  float maxValue;
+  ReosRasterMemory<float> dem( mEntryDem->extractMemoryRasterSimplePrecision( mExtent, mPredefinedRasterExtent, maxValue, QString(), this ) );
+  if ( isStop() )
+    return false;
 
-    //--------------------------
-    //Extract dem and fill it (burn it if needed)
-    setCurrentProgression( 0 );
-    setInformation( tr( "Extract digital elevation model" ) );
-    float maxValue;
-    ReosRasterMemory<float> dem( mEntryDem->extractMemoryRasterSimplePrecision( mExtent, mPredefinedRasterExtent, maxValue, QString(), this ) );
-    if ( isStop() )
-    {
-      finish();
-      return;
-    }
+  burnRasterDem( dem, mBurningLines, mPredefinedRasterExtent );
+  setCurrentProgression( 0 );
+  const double xCellSize = fabs( mPredefinedRasterExtent.xCellSize() );
+  const double yCellSize = fabs( mPredefinedRasterExtent.yCellSize() );
+  std::unique_ptr<ReosRasterFilling> fillDemProcess;
+  // priority flood works only with contiguous DEM
+  const FillingAlgorithm fillingAlgorithm = dem.isTiled() ? WangLiu : mFillingAlgorithm;
+  switch ( fillingAlgorithm )
+  {
+    case WangLiu:
+      fillDemProcess.reset( new ReosRasterFillingWangLiu( dem, xCellSize, yCellSize, maxValue ) );
+      break;
+    case PriorityFlood:
+      fillDemProcess.reset( new ReosRasterFillingPriorityFlood( dem, xCellSize, yCellSize, maxValue ) );
+      break;
+    case PriorityFloodTiled:
+      fillDemProcess.reset( new ReosRasterFillingPriorityFlood( dem, xCellSize, yCellSize, maxValue, ReosRasterFillingPriorityFlood::Tiled ) );
+      break;
+  }
+  setSubProcess( fillDemProcess.get() );
 
-    burnRasterDem( dem, mBurningLines, mPredefinedRasterExtent );
-    setCurrentProgression( 0 );
-    std::unique_ptr<ReosRasterFillingWangLiu> fillDemProcess( new ReosRasterFillingWangLiu( dem, fabs( mPredefinedRasterExtent.xCellSize() ), fabs( mPredefinedRasterExtent.yCellSize() ), maxValue ) );
-    setSubProcess( fillDemProcess.get() );
+  setInformation( tr( "Filling digital elevation model" ) );
+  fillDemProcess->start();
 
-    setInformation( tr( "Filling digital elevation model" ) );
-    fillDemProcess->start();
+  if ( isStop() || !fillDemProcess->isSuccessful() )
+    return false;
 
-    if ( isStop() || !fillDemProcess->isSuccessful() )
-    {
-      finish();
-      return;
-    }
+  setCurrentProgression( 0 );
+  std::unique_ptr<ReosRasterWatershedDirectionCalculation> directionProcess( new ReosRasterWatershedDirectionCalculation( fillDemProcess->filledDEM() ) );
+  setSubProcess( directionProcess.get() );
 
-    ReosRasterMemory<float> filledDem = fillDemProcess->filledDEM();
-    filledDem.createTiffFile( "/home/vincent/filledDem.tif", GDT_Float32, ReosRasterExtent( mExtent, filledDem.columnCount(), filledDem.rowCount() ) );
+  setInformation( tr( "Calculating direction" ) );
+  directionProcess->start();
 
-    setCurrentProgression( 0 );
-    std::unique_ptr<ReosRasterWatershedDirectionCalculation> directionProcess( new ReosRasterWatershedDirectionCalculation( fillDemProcess->filledDEM() ) );
-    setSubProcess( directionProcess.get() );
+  if ( isStop() || !directionProcess->isSuccessful() )
+    return false;
 
-    setInformation( tr( "Calculating direction" ) );
-    directionProcess->start();
+  mDirections = directionProcess->directions();
 
-    if ( isStop() || !directionProcess->isSuccessful() )
-    {
-      finish();
-      return;
-    }
+  setSubProcess( nullptr );
 
-    mDirections = directionProcess->directions();
+  fillDemProcess.reset();
+  directionProcess.reset();
 
-    mDirections.createTiffFile( "/home/vincent/dir.tif", GDT_Byte, ReosRasterExtent( mExtent, mDirections.columnCount(), mDirections.rowCount() ) );
+  return true;
+}
 
-    setSubProcess( nullptr );
+void ReosWatershedDelineatingProcess::start()
+{
+  mIsSuccessful = false;
 
-    fillDemProcess.reset();
-    directionProcess.reset();
+  bool needNewDirection = !mDirections.isValid();
+  if ( needNewDirection && !calculateDirections() )
+  {
+    finish();
+    return;
   }
 
   //--------------------------
@@ -642,6 +766,11 @@ bool ReosWatershedDelineatingProcess::calculateAverageElevation() const
   return mCalculateAverageElevation;
 }
 
+void ReosWatershedDelineatingProcess::setFillingAlgorithm( FillingAlgorithm algorithm )
+{
+  mFillingAlgorithm = algorithm;
+}
+
 void ReosWatershedDelineatingProcess::burnRasterDem( ReosRasterMemory<float> &rasterDem, const QList<QPolygonF> &burningLines, const ReosRasterExtent &rasterExtent )
 {
   for ( const QPolygonF &burningLine : burningLines )
@@ -675,3 +804,259 @@ void ReosWatershedDelineatingProcess::burnRasterDem( ReosRasterMemory<float> &ra
     }
   }
 }
+
+ReosWatershedBatchDelineatingProcess::ReosWatershedBatchDelineatingProcess( ReosDigitalElevationModel *dem,
+    const ReosMapExtent &mapExtent,
+    const QList<QPolygonF> &downstreamLines,
+    const QList<QPolygonF> &burningLines,
+    bool calculateAverageElevation ):
+  ReosWatershedDelineatingProcess( dem, mapExtent, QPolygonF(), burningLines, calculateAverageElevation ),
+  mDownstreamLines( downstreamLines )
+{}
+
+ReosWatershedBatchDelineatingProcess::ReosWatershedBatchDelineatingProcess( ReosWatershed *downstreamWatershed,
+    const QList<QPolygonF> &downstreamLines,
+    const QString &layerId ):
+  ReosWatershedDelineatingProcess( downstreamWatershed, QPolygonF(), layerId ),
+  mDownstreamLines( downstreamLines )
+{}
+
+void ReosWatershedBatchDelineatingProcess::start()
+{
+  mIsSuccessful = false;
+  mResults.clear();
+
+  bool needNewDirection = !mDirections.isValid();
+  if ( needNewDirection && !calculateDirections() )
+  {
+    finish();
+    return;
+  }
+
+  //--------------------------
+  //rasterize the dowstream lines
+  QVector<ReosRasterLine> rasterDownstreamLines;
+  rasterDownstreamLines.reserve( mDownstreamLines.count() );
+  for ( const QPolygonF &downstreamLine : mDownstreamLines )
+  {
+    ReosRasterLine rasterDownstreamLine;
+    for ( const QPointF &point : downstreamLine )
+    {
+      ReosRasterCellPos cell = mPredefinedRasterExtent.mapToCellPos( point );
+      rasterDownstreamLine.addPoint( cell.row(), cell.column() );
+    }
+    rasterDownstreamLines.append( rasterDownstreamLine );
+  }
+
+  //--------------------------
+  // Label the cells of all the watersheds in one pass
+  setCurrentProgression( 0 );
+  setInformation( tr( "Delineate watersheds" ) );
+  QVector<ReosRasterCellPos> endsOfLongerPath;
+  const ReosRasterMemory<int> labels = ReosRasterFlowAccumulation( mDirections ).upstreamLabels( rasterDownstreamLines, &endsOfLongerPath );
+
+  if ( isStop() || !labels.isValid() )
+  {
+    finish();
+    return;
+  }
+
+  const int watershedCount = rasterDownstreamLines.count();
+  const int rowCount = labels.rowCount();
+  const int columnCount = labels.columnCount();
+  auto isInRaster = [rowCount, columnCount]( const ReosRasterCellPos & cell )
+  {
+    return cell.row() >= 0 && cell.row() < rowCount && cell.column() >= 0 && cell.column() < columnCount;
+  };
+  mResults.resize( watershedCount );
+  Result *results = mResults.data();
+
+  //--------------------------
+  // Resolve the nesting, the downstream watershed is the one of the first cell out of the watershed when going downstream from the outlet
+  for ( int i = 0; i < watershedCount; ++i )
+  {
+    const ReosRasterLine &rasterDownstreamLine = rasterDownstreamLines.at( i );
+    if ( rasterDownstreamLine.cellCount() == 0 )
+      continue;
+    Result &result = mResults[i];
+    result.outletCell = rasterDownstreamLine.cellPosition( rasterDownstreamLine.cellCount() / 2 );
+    if ( !isInRaster( result.outletCell ) || labels.value( result.outletCell ) != i + 1 )
+      continue;
+    result.isValid = true;
+
+    ReosRasterCellPos cell = result.outletCell;
+    unsigned char direction = mDirections.value( cell );
+    while ( direction != 4 && direction < 9 )
+    {
+      cell.goInDirection( direction );
+      if ( !isInRaster( cell ) )
+        break;
+      const int label = labels.value( cell );
+      if ( label != i + 1 )
+      {
+        result.downstreamIndex = label - 1;
+        break;
+      }
+      direction = mDirections.value( cell );
+    }
+  }
+
+  // returns whether the cells with \a label are in the watershed at \a index, that is in it or in a nested one
+  auto isInWatershed = [results, watershedCount]( int label, int index )
+  {
+    int watershedIndex = label - 1;
+    for ( int depth = 0; watershedIndex >= 0 && depth <= watershedCount; ++depth )
+    {
+      if ( watershedIndex == index )
+        return true;
+      watershedIndex = results[watershedIndex].downstreamIndex;
+    }
+    return false;
+  };
+
+  //--------------------------
+  // Extent of each watershed, including the nested ones
+  QVector<QRect> cellRects( watershedCount );
+  for ( int r = 0; r < rowCount; ++r )
+    for ( int c = 0; c < columnCount; ++c )
+    {
+      const int label = labels.value( r, c );
+      if ( label > 0 )
+        cellRects[label - 1] |= QRect( c, r, 1, 1 );
+    }
+
+  QVector<int> validIndexes;
+  for ( int i = 0; i < watershedCount; ++i )
+  {
+    if ( !mResults.at( i ).isValid )
+      continue;
+    validIndexes.append( i );
+    int downstream = mResults.at( i ).downstreamIndex;
+    for ( int depth = 0; downstream >= 0 && depth < watershedCount; ++depth )
+    {
+      cellRects[downstream] |= cellRects.at( i );
+      downstream = mResults.at( downstream ).downstreamIndex;
+    }
+  }
+
+  //--------------------------
+  // Polygonize the watersheds and trace the stream lines
+  setInformation( tr( "Polygonize watersheds" ) );
+  QtConcurrent::blockingMap( validIndexes, [&]( int index )
+  {
+    Result &result = results[index];
+
+    //get a 2 cells marge
+    const QRect &cellRect = cellRects.at( index );
+    const int rowMin = std::max( 0, cellRect.top() - 2 );
+    const int rowMax = std::min( rowCount - 1, cellRect.bottom() + 2 );
+    const int colMin = std::max( 0, cellRect.left() - 2 );
+    const int colMax = std::min( columnCount - 1, cellRect.right() + 2 );
+
+    ReosRasterWatershed::Watershed rasterizedWatershed( rowMax - rowMin + 1, colMax - colMin + 1 );
+    if ( !rasterizedWatershed.reserveMemory() )
+    {
+      result.isValid = false;
+      return;
+    }
+    unsigned char *watershedData = static_cast<unsigned char *>( rasterizedWatershed.data() );
+    for ( int r = rowMin; r <= rowMax; ++r )
+      for ( int c = colMin; c <= colMax; ++c )
+        *watershedData++ = isInWatershed( labels.value( r, c ), index ) ? 1 : 0;
+
+    double xOrigin = mPredefinedRasterExtent.xMapOrigin() + colMin * mPredefinedRasterExtent.xCellSize();
+    double yOrigin = mPredefinedRasterExtent.yMapOrigin() + rowMin * mPredefinedRasterExtent.yCellSize();
+    result.outputRasterExtent = ReosRasterExtent( xOrigin, yOrigin, colMax - colMin + 1, rowMax - rowMin + 1, mPredefinedRasterExtent.xCellSize(), mPredefinedRasterExtent.yCellSize() );
+    result.outputRasterExtent.setCrs( mExtent.crs() );
+    result.rasterizedWatershed = rasterizedWatershed;
+
+    ReosRasterWatershedToVector watershedToPolygon( rasterizedWatershed, result.outputRasterExtent, result.outletCell - ReosRasterCellPos( rowMin, colMin ) );
+    watershedToPolygon.start();
+    result.watershedPolygon = watershedToPolygon.watershed();
+
+    ReosRasterWatershedTraceDownstream traceDownstream( mDirections, rasterDownstreamLines.at( index ), mPredefinedRasterExtent, endsOfLongerPath.at( index ) );
+    traceDownstream.start();
+    result.streamLine = traceDownstream.resultPolyline();
+
+    result.isValid = watershedToPolygon.isSuccessful() && traceDownstream.isSuccessful() && !result.streamLine.isEmpty();
+  } );
+
+  if ( isStop() )
+  {
+    finish();
+    return;
+  }
+
+  for ( int index : std::as_const( validIndexes ) )
+  {
+    Result &result = mResults[index];
+    if ( !result.isValid )
+      continue;
+
+    if ( needNewDirection && result.downstreamIndex < 0 )
+    {
+      const QRect &cellRect = cellRects.at( index );
+      result.directions = mDirections.reduceRaster( std::max( 0, cellRect.top() - 2 ), std::min( rowCount - 1, cellRect.bottom() + 2 ),
+                          std::max( 0, cellRect.left() - 2 ), std::min( columnCount - 1, cellRect.right() + 2 ) );
+    }
+
+    // Calculate average elevation
+    if ( mCalculateAverageElevation && mEntryDem )
+      result.averageElevation = mEntryDem->averageElevationOnGrid( result.rasterizedWatershed, result.outputRasterExtent, this );
+  }
+
+  mEntryDem.reset();
+
+  mIsSuccessful = true;
+  finish();
+}
+
+int ReosWatershedBatchDelineatingProcess::watershedCount() const
+{
+  return mResults.count();
+}
+
+bool ReosWatershedBatchDelineatingProcess::isWatershedValid( int index ) const
+{
+  return mResults.at( index ).isValid;
+}
+
+QPolygonF ReosWatershedBatchDelineatingProcess::downstreamLine( int index ) const
+{
+  return mDownstreamLines.at( index );
+}
+
+QPolygonF ReosWatershedBatchDelineatingProcess::watershedPolygon( int index ) const
+{
+  return mResults.at( index ).watershedPolygon;
+}
+
+QPolygonF ReosWatershedBatchDelineatingProcess::streamLine( int index ) const
+{
+  return mResults.at( index ).streamLine;
+}
+
+ReosRasterWatershed::Watershed ReosWatershedBatchDelineatingProcess::rasterizedWatershed( int index ) const
+{
+  return mResults.at( index ).rasterizedWatershed;
+}
+
+ReosRasterExtent ReosWatershedBatchDelineatingProcess::outputRasterExtent( int index ) const
+{
+  return mResults.at( index ).outputRasterExtent;
+}
+
+double ReosWatershedBatchDelineatingProcess::averageElevation( int index ) const
+{
+  return mResults.at( index ).averageElevation;
+}
+
+ReosRasterWatershed::Directions ReosWatershedBatchDelineatingProcess::directions( int index ) const
+{
+  return mResults.at( index ).directions;
+}
+
+int ReosWatershedBatchDelineatingProcess::downstreamIndex( int index ) const
+{
+  return mResults.at( index ).downstreamIndex;
+}
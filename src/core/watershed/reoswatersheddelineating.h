@@ -26,12 +26,20 @@ email                : vcloarec at gmail dot com
 #include "reosrasterwatershed.h"
 #include "reosdigitalelevationmodel.h"
 
-class ReosRasterFillingWangLiu;
+class ReosRasterFilling;
 class ReosWatershedTree;
 
 class ReosWatershedDelineatingProcess: public ReosProcess
 {
   public:
+    //! Algorithms that can be used to fill the digital elevation model
+    enum FillingAlgorithm
+    {
+      WangLiu, //!< ReosRasterFillingWangLiu
+      PriorityFlood, //!< ReosRasterFillingPriorityFlood, sequential mode, same result as WangLiu
+      PriorityFloodTiled, //!< ReosRasterFillingPriorityFlood, tiled mode filled with several threads
+    };
+
     ReosWatershedDelineatingProcess( ReosDigitalElevationModel *dem,
                                      const ReosMapExtent &mapExtent,
                                      const QPolygonF &downtreamLine,
@@ -57,7 +65,10 @@ class ReosWatershedDelineatingProcess: public ReosProcess
 
     bool calculateAverageElevation() const;
 
-  private:
+    //! Sets the \a algorithm used to fill the digital elevation model
+    void setFillingAlgorithm( FillingAlgorithm algorithm );
+
+  protected:
     ReosMapExtent mExtent;
     std::unique_ptr<ReosDigitalElevationModel> mEntryDem;
     const QPolygonF mDownstreamLine;
@@ -71,10 +82,80 @@ class ReosWatershedDelineatingProcess: public ReosProcess
     ReosRasterExtent mOutputRasterExtent;
     bool mCalculateAverageElevation = false;
     double mAverageElevation = 0;
+    FillingAlgorithm mFillingAlgorithm = PriorityFlood;
+
+    //! Extracts, burns and fills the DEM, then calculates the directions, returns false if failed or stopped
+    bool calculateDirections();
 
+  private:
     static void burnRasterDem( ReosRasterMemory<float> &rasterDem, const QList<QPolygonF> &burningLines, const ReosRasterExtent &rasterExtent );
 };
 
+/**
+ * Process that delineates the watersheds of several downstream lines at once.
+ *
+ * The directions are calculated once, then all the cells are labelled with the first downstream line met when going downstream
+ * in one parallel pass (see ReosRasterFlowAccumulation::upstreamLabels()) and all the watersheds are polygonized in parallel.
+ * The downstream watershed of each watershed is the one that contains the cell downstream its outlet,
+ * so the nesting is resolved without any geometric test.
+ */
+class ReosWatershedBatchDelineatingProcess: public ReosWatershedDelineatingProcess
+{
+  public:
+    ReosWatershedBatchDelineatingProcess( ReosDigitalElevationModel *dem,
+                                          const ReosMapExtent &mapExtent,
+                                          const QList<QPolygonF> &downstreamLines,
+                                          const QList<QPolygonF> &burningLines,
+                                          bool calculateAverageElevation = false );
+
+    ReosWatershedBatchDelineatingProcess( ReosWatershed *downstreamWatershed,
+                                          const QList<QPolygonF> &downstreamLines,
+                                          const QString &layerId );
+
+    void start() override;
+
+    //! Returns the count of watersheds, that is the count of downstream lines
+    int watershedCount() const;
+
+    //! Returns whether the watershed at \a index has been delineated
+    bool isWatershedValid( int index ) const;
+
+    //! Returns the downstream line of the watershed at \a index
+    QPolygonF downstreamLine( int index ) const;
+
+    QPolygonF watershedPolygon( int index ) const;
+    QPolygonF streamLine( int index ) const;
+    ReosRasterWatershed::Watershed rasterizedWatershed( int index ) const;
+    ReosRasterExtent outputRasterExtent( int index ) const;
+    double averageElevation( int index ) const;
+
+    /**
+     * Returns the directions reduced to the extent of the watershed at \a index,
+     * only valid for new directions and watersheds that have no downstream watershed
+     */
+    ReosRasterWatershed::Directions directions( int index ) const;
+
+    //! Returns the index of the watershed directly downstream the watershed at \a index, -1 if none
+    int downstreamIndex( int index ) const;
+
+  private:
+    struct Result
+    {
+      bool isValid = false;
+      ReosRasterCellPos outletCell;
+      int downstreamIndex = -1;
+      QPolygonF watershedPolygon;
+      QPolygonF streamLine;
+      ReosRasterWatershed::Directions directions;
+      ReosRasterWatershed::Watershed rasterizedWatershed;
+      ReosRasterExtent outputRasterExtent;
+      double averageElevation = 0;
+    };
+
+    const QList<QPolygonF> mDownstreamLines;
+    QVector<Result> mResults;
+};
+
 
 class REOSCORE_EXPORT ReosWatershedDelineating : public ReosModule
 {
@@ -118,6 +199,9 @@ class REOSCORE_EXPORT ReosWatershedDelineating : public ReosModule
     //! Sets whether the average elevation of the watershed is calculated after delineating
     void setCalculateAverageElevation( bool calculate );
 
+    //! Sets the \a algorithm used to fill the digital elevation model during delineating
+    void setFillingAlgorithm( ReosWatershedDelineatingProcess::FillingAlgorithm algorithm );
+
     //! Returns whether the module has direction data ready for proceed
     bool hasDirectionData() const;
 
@@ -130,6 +214,16 @@ class REOSCORE_EXPORT ReosWatershedDelineating : public ReosModule
 
     ReosProcess *delineatingProcess();
 
+    /**
+     * Prepares the delineating of the watersheds of all the \a downstreamLines at once, return true if sucessful.
+     * The directions are calculated in \a extent, except if all the lines are in a watershed that have direction data.
+     * Does not change the state of the single watershed delineating.
+     */
+    bool prepareBatchDelineating( const QList<QPolygonF> &downstreamLines, const ReosMapExtent &extent );
+
+    //! Returns the process of the last prepared batch delineating
+    ReosProcess *batchDelineatingProcess();
+
     //! Returns if the delineating process is finished
     bool isDelineatingFinished() const;
 
@@ -148,6 +242,9 @@ class REOSCORE_EXPORT ReosWatershedDelineating : public ReosModule
     //! Store the wahtershed in the tree, returns pointer to the new watershed
     ReosWatershed *storeWatershed( bool adjustIfNeeded );
 
+    //! Stores the watersheds of the finished batch delineating in the tree with their nesting, returns pointers to the new watersheds
+    QList<ReosWatershed *> storeBatchWatersheds( bool adjustIfNeeded );
+
     ReosEncodedElement encode() const;
     void decode( const ReosEncodedElement &element );
 
@@ -176,8 +273,10 @@ class REOSCORE_EXPORT ReosWatershedDelineating : public ReosModule
     QList<QPolygonF> mBurningLines;
     bool mIsBurningLineUpToDate = false;
     bool mCalculateAverageElevation = true;
+    ReosWatershedDelineatingProcess::FillingAlgorithm mFillingAlgorithm = ReosWatershedDelineatingProcess::PriorityFlood;
 
     std::unique_ptr<ReosWatershedDelineatingProcess> mProcess;
+    std::unique_ptr<ReosWatershedBatchDelineatingProcess> mBatchProcess;
 
     std::unique_ptr<ReosWatershed> mCurrentWatershed;
 
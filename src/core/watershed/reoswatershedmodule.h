@@ -23,8 +23,17 @@ class REOSCORE_EXPORT ReosWatershedModule : public ReosModule
     //! Removes all the watersheds
     void reset();
 
-    void decode( const ReosEncodedElement &element );
-    ReosEncodedElement encode() const;
+    /**
+     * Decodes the module from \a element. If the direction rasters were not encoded with the module,
+     * \a directionRastersLoader is called when they are needed, see ReosWatershedTree::decode()
+     */
+    void decode( const ReosEncodedElement &element, const std::function<ReosEncodedElement()> &directionRastersLoader = nullptr );
+
+    //! Encodes the module, if \a withDirectionRasters is false, direction rasters have to be encoded with encodeDirectionRasters()
+    ReosEncodedElement encode( bool withDirectionRasters = true ) const;
+
+    //! Encodes only the direction rasters of the watersheds
+    ReosEncodedElement encodeDirectionRasters() const;
 
   signals:
     void hasBeenReset();
@@ -13,6 +13,7 @@ email                : vcloarec at gmail dot com
  *                                                                         *
  ***************************************************************************/
 
+#include <numeric>
 #include <QStack>
 #include "reoswatershedtree.h"
 #include "reoswatershed.h"
@@ -76,6 +77,7 @@ ReosWatershed *ReosWatershedTree::addWatershed( ReosWatershed *watershedToAdd, b
   if ( includingWatershed ) // There is a watershed that contains the new one, deal with it
   {
     ReosWatershed *addedWatersehd = includingWatershed->addUpstreamWatershed( ws.release(), adaptDelineating );
+    shareDirectionData();
     emit watershedAdded( addedWatersehd );
     return addedWatersehd;
   }
@@ -105,11 +107,66 @@ ReosWatershed *ReosWatershedTree::addWatershed( ReosWatershed *watershedToAdd, b
     }
 
     mWatersheds.emplace_back( ws.release() );
+    shareDirectionData();
     emit watershedAdded( mWatersheds.back().get() );
     return mWatersheds.back().get();
   }
 }
 
+QList<ReosWatershed *> ReosWatershedTree::addWatersheds( const QList<ReosWatershed *> &watersheds, const QVector<int> &downstreamIndexes, bool adaptDelineating )
+{
+  const int count = watersheds.count();
+
+  // downstream watersheds have to be added before the upstream ones
+  QVector<int> depths( count, 0 );
+  for ( int i = 0; i < count; ++i )
+  {
+    int downstream = downstreamIndexes.value( i, -1 );
+    while ( downstream >= 0 && depths[i] < count )
+    {
+      depths[i]++;
+      downstream = downstreamIndexes.value( downstream, -1 );
+    }
+  }
+
+  QVector<int> order( count );
+  std::iota( order.begin(), order.end(), 0 );
+  std::stable_sort( order.begin(), order.end(), [&depths]( int i1, int i2 ) {return depths.at( i1 ) < depths.at( i2 );} );
+
+  QVector<ReosWatershed *> addedWatersheds( count, nullptr );
+  for ( int i : std::as_const( order ) )
+  {
+    std::unique_ptr<ReosWatershed> ws( watersheds.at( i ) );
+    if ( !ws )
+      continue;
+
+    // the downstream watershed is the closest one that has been added
+    ReosWatershed *downstreamWatershed = nullptr;
+    int downstream = downstreamIndexes.value( i, -1 );
+    for ( int depth = 0; !downstreamWatershed && downstream >= 0 && depth < count; ++depth )
+    {
+      downstreamWatershed = addedWatersheds.at( downstream );
+      downstream = downstreamIndexes.value( downstream, -1 );
+    }
+
+    if ( !downstreamWatershed )
+    {
+      addedWatersheds[i] = addWatershed( ws.release(), adaptDelineating );
+      continue;
+    }
+
+    connect( ws.get(), &ReosDataObject::dataChanged, this, &ReosWatershedTree::watershedChanged );
+    emit watershedWillBeAdded();
+    ws->setGeographicalContext( mGisEngine );
+    ws->calculateArea();
+    addedWatersheds[i] = downstreamWatershed->addUpstreamWatershed( ws.release(), adaptDelineating );
+    shareDirectionData();
+    emit watershedAdded( addedWatersheds.at( i ) );
+  }
+
+  return addedWatersheds.toList();
+}
+
 ReosWatershed *ReosWatershedTree::downstreamWatershed( const QPolygonF &line, bool &ok ) const
 {
   for ( const std::unique_ptr<ReosWatershed> &watershed : mWatersheds )
@@ -221,6 +278,8 @@ void ReosWatershedTree::removeDirectionData()
 {
   for ( size_t i = 0; i < mWatersheds.size(); ++i )
     mWatersheds.at( i )->removeDirectionData();
+
+  mDirectionStore.purge();
 }
 
 ReosWatershed *ReosWatershedTree::extractWatershed( ReosWatershed *ws )
@@ -252,31 +311,47 @@ ReosWatershed *ReosWatershedTree::extractWatershed( ReosWatershed *ws )
   return nullptr;
 }
 
-ReosEncodedElement ReosWatershedTree::encode() const
+void ReosWatershedTree::purgeDirectionRasters()
 {
+  mDirectionStore.purge();
+}
+
+ReosEncodedElement ReosWatershedTree::encode( bool withDirectionRasters ) const
+{
+  // direction rasters shared by several watersheds are encoded once in the store
   QList<QByteArray> watersheds;
   for ( const std::unique_ptr<ReosWatershed> &ws : mWatersheds )
-    watersheds.append( ws->encode().bytes() );
+    watersheds.append( ws->encode( &mDirectionStore ).bytes() );
 
   ReosEncodedElement ret( QStringLiteral( "watershed-tree" ) );
   ret.addData( QStringLiteral( "watersheds" ), watersheds );
+  ret.addEncodedData( QStringLiteral( "direction-store" ), mDirectionStore.encode( withDirectionRasters ) );
 
   return ret;
 }
 
-void ReosWatershedTree::decode( const ReosEncodedElement &elem )
+ReosEncodedElement ReosWatershedTree::encodeDirectionRasters() const
+{
+  return mDirectionStore.encodeDirections();
+}
+
+void ReosWatershedTree::decode( const ReosEncodedElement &elem, const std::function<ReosEncodedElement()> &directionRastersLoader )
 {
   emit treeWillBeReset();
   mWatersheds.clear();
+  mDirectionStore.clear();
   if ( elem.description() == QStringLiteral( "watershed-tree" ) )
   {
+    if ( elem.hasEncodedData( QStringLiteral( "direction-store" ) ) )
+      mDirectionStore.decode( elem.getEncodedData( QStringLiteral( "direction-store" ) ), directionRastersLoader );
+
     QList<QByteArray> watershedsList;
     if ( elem.getData( QStringLiteral( "watersheds" ), watershedsList ) )
     {
       std::vector<std::unique_ptr<ReosWatershed>> watersheds;
       for ( const QByteArray &wsba : watershedsList )
       {
-        std::unique_ptr<ReosWatershed> uws( ReosWatershed::decode( ReosEncodedElement( wsba ) ) );
+        std::unique_ptr<ReosWatershed> uws( ReosWatershed::decode( ReosEncodedElement( wsba ), &mDirectionStore ) );
         if ( uws )
         {
           uws->setGeographicalContext( mGisEngine );
@@ -288,6 +363,9 @@ void ReosWatershedTree::decode( const ReosEncodedElement &elem )
     }
   }
 
+  // direction rasters of older projects are stored in each watershed
+  shareDirectionData();
+
   QList<ReosWatershed *> allWs = allWatershedsFromUSToDS();
   for ( ReosWatershed *ws : std::as_const( allWs ) )
     connect( ws, &ReosDataObject::dataChanged, this, &ReosWatershedTree::watershedChanged );
@@ -466,7 +544,8 @@ void ReosWatershedItemModel::removeWatershed( const QModelIndex &index )
   if ( !ws )
     return;
   std::unique_ptr<ReosWatershed> removed( mWatershedTree->extractWatershed( ws ) );
-
+  removed.reset();
+  mWatershedTree->purgeDirectionRasters();
 }
 
 ReosWatershed *ReosWatershedItemModel::uriToWatershed( const QString &uri ) const
@@ -519,9 +598,29 @@ void ReosWatershedTree::clearWatersheds()
 {
   emit treeWillBeReset();
   mWatersheds.clear();
+  mDirectionStore.clear();
   emit treeReset();
 }
 
+const ReosDirectionRasterStore &ReosWatershedTree::directionRasterStore() const
+{
+  return mDirectionStore;
+}
+
+void ReosWatershedTree::shareDirectionData()
+{
+  // An entry shared first can be replaced in the store by an entry shared later that covers it.
+  // The second pass gives to the watersheds holding a replaced entry the one that stays in the store,
+  // so no watershed keeps an entry outside the store, whatever the order of the watersheds.
+  for ( int pass = 0; pass < 2; ++pass )
+  {
+    for ( const std::unique_ptr<ReosWatershed> &ws : mWatersheds )
+      ws->shareDirectionData( &mDirectionStore );
+  }
+
+  mDirectionStore.purge();
+}
+
 QString ReosWatershedItemModel::watershedUri( ReosWatershed *watershed ) const
 {
   return mWatershedTree->watershedUri( watershed );
@@ -42,6 +42,15 @@ class REOSCORE_EXPORT ReosWatershedTree: public QObject
      */
     ReosWatershed *addWatershed( ReosWatershed *watershed, bool adaptDelineating = false );
 
+    /**
+     * Adds \a watersheds to the tree with a nesting already known: \a downstreamIndexes contains, for each watershed,
+     * the index in \a watersheds of the watershed directly downstream, -1 if none. Watersheds without downstream watershed
+     * in the list are added as with addWatershed(), the others are directly added in their downstream watershed.
+     * \a watersheds can contain nullptr that are ignored.
+     * Takes ownership and returns pointers to the added watersheds, in the same order.
+     */
+    QList<ReosWatershed *> addWatersheds( const QList<ReosWatershed *> &watersheds, const QVector<int> &downstreamIndexes, bool adaptDelineating = false );
+
     //! Returns the smallest watershed that is downstream the line, if the line is partially included by any watershed, ok is false
     //! If there is no watershed downstrean, return nullptr
     ReosWatershed *downstreamWatershed( const QPolygonF &line, bool &ok ) const;
@@ -73,18 +82,37 @@ class REOSCORE_EXPORT ReosWatershedTree: public QObject
     /**
      * Removes (if present) the watershed from the watershed \a ws, but do not delete it, returns a pointer to it
      * Do not maintained sub watershed but move them to downstream.
+     * The direction rasters of the extracted watershed stay in the store until purgeDirectionRasters() is called.
      */
     ReosWatershed *extractWatershed( ReosWatershed *ws );
 
+    //! Removes from the store the direction rasters that are not used anymore by any watershed
+    void purgeDirectionRasters();
+
     ReosWatershed *uriToWatershed( const QString &uri ) const;
     QString watershedUri( ReosWatershed *watershed ) const;
 
     //! Removes all the watersheds of the tree
     void clearWatersheds();
 
-    ReosEncodedElement encode() const;
-    void decode( const ReosEncodedElement &elem );
+    /**
+     * Encodes the tree, if \a withDirectionRasters is false, the direction rasters shared by the watersheds
+     * are not encoded and have to be encoded apart with encodeDirectionRasters().
+     * The store is not purged here, operations that release direction rasters have to purge it.
+     */
+    ReosEncodedElement encode( bool withDirectionRasters = true ) const;
+
+    //! Encodes only the direction rasters shared by the watersheds
+    ReosEncodedElement encodeDirectionRasters() const;
+
+    /**
+     * Decodes the tree from \a elem. If the direction rasters were not encoded with the tree, \a directionRastersLoader
+     * is called the first time direction rasters are needed and has to return the element created by encodeDirectionRasters().
+     */
+    void decode( const ReosEncodedElement &elem, const std::function<ReosEncodedElement()> &directionRastersLoader = nullptr );
 
+    //! Returns the store of the direction rasters shared by the watersheds of the tree
+    const ReosDirectionRasterStore &directionRasterStore() const;
 
   signals:
     void treeWillBeReset();
@@ -99,6 +127,12 @@ class REOSCORE_EXPORT ReosWatershedTree: public QObject
   private:
     std::vector<std::unique_ptr<ReosWatershed>> mWatersheds;
     ReosGisEngine *mGisEngine = nullptr;
+
+    //! Direction rasters referenced by the watersheds, entries not used anymore are purged when watersheds release them
+    ReosDirectionRasterStore mDirectionStore;
+
+    //! Makes the watersheds sharing their direction rasters through the store, whatever the order of the watersheds
+    void shareDirectionData();
 };
 
 
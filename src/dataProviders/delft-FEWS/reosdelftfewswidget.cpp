@@ -17,12 +17,12 @@
 #include "ui_reosdelftfewswidget.h"
 
 #include <QFileDialog>
-#include <QDomDocument>
 
 #include "reoscore.h"
 #include "reossettings.h"
 #include "reosgisengine.h"
 #include "reosdelftfewsxmlprovider.h"
+#include "reosdelftfewsxmlindex.h"
 #include "reosplottimeconstantinterval.h"
 #include "reosmaptool.h"
 #include "reosapplication.h"
@@ -250,48 +250,26 @@ void ReosDelftFewsWidget::populateTextBrowser()
 
 bool ReosDelftFewsWidget::parseFile( const QString &fileName )
 {
-  QDomDocument xmlDoc( "delft-document" );
-  QFile file( fileName );
-  if ( !file.open( QIODevice::ReadOnly ) )
+  const std::shared_ptr<const ReosDelftFewsXMLIndex> index = ReosDelftFewsXMLIndex::indexForFile( fileName );
+  if ( !index->isValid() )
     return false;
-  if ( !xmlDoc.setContent( &file ) )
-  {
-    file.close();
-    return false;
-  }
-  file.close();
-
-  QDomElement rooElement = xmlDoc.firstChildElement( QStringLiteral( "TimeSeries" ) );
 
   QList<ReosDelftFewsStation> stations;
 
   mStationsMarker.clear();
 
-  QDomElement serieElement = rooElement.firstChildElement( QStringLiteral( "series" ) );
-  if ( serieElement.isNull() )
-    return false;
-
-  do
+  const QVector<ReosDelftFewsXMLIndex::Series> &allSeries = index->series();
+  for ( const ReosDelftFewsXMLIndex::Series &series : allSeries )
   {
-    QDomElement headerElement = serieElement.firstChildElement( QStringLiteral( "header" ) );
-    if ( headerElement.isNull() )
-      continue;
-
     ReosDelftFewsStation station;
 
-    if ( !headerElement.firstChildElement( QStringLiteral( "parameterId" ) ).isNull() )
-    {
-      const QString paramater = ReosDelftFewsXMLProviderInterface::valueStringFromElement( headerElement.firstChildElement( QStringLiteral( "parameterId" ) ) );
-      if ( paramater.isEmpty() )
-        continue;
-      const QString prefix = paramater.split( QString( '.' ) ).at( 0 );
-      if ( prefix == QString( 'P' ) )
-        station.meta[QStringLiteral( "data-type" )] = ReosDelftFewsXMLRainfallProvider::dataType();
-      else if ( prefix == QString( 'Q' ) )
-        station.meta[QStringLiteral( "data-type" )] = ReosDelftFewsXMLHydrographProvider::dataType();
-      else
-        continue;
-    }
+    if ( series.parameterId.isEmpty() )
+      continue;
+    const QString prefix = series.parameterId.split( QString( '.' ) ).at( 0 );
+    if ( prefix == QString( 'P' ) )
+      station.meta[QStringLiteral( "data-type" )] = ReosDelftFewsXMLRainfallProvider::dataType();
+    else if ( prefix == QString( 'Q' ) )
+      station.meta[QStringLiteral( "data-type" )] = ReosDelftFewsXMLHydrographProvider::dataType();
     else
       continue;
 
@@ -299,39 +277,35 @@ bool ReosDelftFewsWidget::parseFile( const QString &fileName )
     double longitude = 0;
     double latitude = 0;
 
-    if ( !headerElement.firstChildElement( QStringLiteral( "stationName" ) ).isNull() )
-      station.meta[QStringLiteral( "name" )] = ReosDelftFewsXMLProviderInterface::valueStringFromElement( headerElement.firstChildElement( QStringLiteral( "stationName" ) ) );
+    if ( !series.stationName.isNull() )
+      station.meta[QStringLiteral( "name" )] = series.stationName;
 
-    if ( !headerElement.firstChildElement( QStringLiteral( "lat" ) ).isNull() )
+    if ( !series.latitude.isNull() )
     {
-      QDomElement element = headerElement.firstChildElement( QStringLiteral( "lat" ) );
-      QString latStr = element.firstChild().nodeValue();
       bool ok = false;
-      latitude = latStr.toDouble( &ok );
+      latitude = series.latitude.toDouble( &ok );
       isSpatial &= ok;
       if ( isSpatial )
         station.meta[QStringLiteral( "latitude" )] = latitude;
     }
 
-    if ( !headerElement.firstChildElement( QStringLiteral( "lon" ) ).isNull() )
+    if ( !series.longitude.isNull() )
     {
-      QDomElement element = headerElement.firstChildElement( QStringLiteral( "lon" ) );
-      QString lonStr = element.firstChild().nodeValue();
       bool ok = false;
-      longitude = lonStr.toDouble( &ok );
+      longitude = series.longitude.toDouble( &ok );
       isSpatial &= ok;
       if ( isSpatial )
         station.meta[QStringLiteral( "longitude" )] = longitude;
     }
 
-    if ( !headerElement.firstChildElement( QStringLiteral( "locationId" ) ).isNull() )
-      station.meta[QStringLiteral( "location-id" )] = ReosDelftFewsXMLProviderInterface::valueStringFromElement( headerElement.firstChildElement( QStringLiteral( "locationId" ) ) );
+    if ( !series.locationId.isNull() )
+      station.meta[QStringLiteral( "location-id" )] = series.locationId;
 
-    if ( !headerElement.firstChildElement( QStringLiteral( "startDate" ) ).isNull() )
-      station.meta[QStringLiteral( "start-time" )] = ReosDelftFewsXMLProviderInterface::timefromElement( headerElement.firstChildElement( QStringLiteral( "startDate" ) ) );
+    if ( series.startTime.isValid() )
+      station.meta[QStringLiteral( "start-time" )] = series.startTime;
 
-    if ( !headerElement.firstChildElement( QStringLiteral( "endDate" ) ).isNull() )
-      station.meta[QStringLiteral( "end-time" )] = ReosDelftFewsXMLProviderInterface::timefromElement( headerElement.firstChildElement( QStringLiteral( "endDate" ) ) );
+    if ( series.endTime.isValid() )
+      station.meta[QStringLiteral( "end-time" )] = series.endTime;
 
     if ( isSpatial )
     {
@@ -345,10 +319,10 @@ bool ReosDelftFewsWidget::parseFile( const QString &fileName )
       mStationsMarker.push_back( nullptr );
 
     stations.append( station );
-
-    serieElement = serieElement.nextSiblingElement( QStringLiteral( "series" ) );
   }
-  while ( !serieElement .isNull() );
+
+  if ( stations.isEmpty() )
+    return false;
 
   mStationsModel->setStationsList( stations );
 
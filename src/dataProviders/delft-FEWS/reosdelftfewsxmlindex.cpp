@@ -0,0 +1,432 @@
+/***************************************************************************
+  reosdelftfewsxmlindex.cpp - ReosDelftFewsXMLIndex
+
+ ---------------------
+ begin                : 23.4.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "reosdelftfewsxmlindex.h"
+
+#include <limits>
+#include <string_view>
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QXmlStreamReader>
+
+// identifies the files of index and their format, to change if the format changes
+#define DELFT_FEWS_INDEX_MAGIC 0x44465849
+#define DELFT_FEWS_INDEX_VERSION 2
+
+// Julian day of 1970-01-01
+#define JULIAN_DAY_OF_EPOCH 2440588
+
+static bool readNumber( const QStringRef &string, int position, int length, int &number )
+{
+  if ( string.size() < position + length )
+    return false;
+
+  number = 0;
+  for ( int i = 0; i < length; ++i )
+  {
+    const ushort c = string.at( position + i ).unicode();
+    if ( c < '0' || c > '9' )
+      return false;
+    number = number * 10 + ( c - '0' );
+  }
+  return true;
+}
+
+// Reads the attributes "date" (yyyy-MM-dd) and "time" (hh:mm:ss) of an element, as they are written by Delft-FEWS,
+// without going through QDate/QTime::fromString() that are too slow to be called for each event
+static bool msecsSinceEpochFromAttributes( const QXmlStreamAttributes &attributes, qint64 &msecs )
+{
+  const QStringRef date = attributes.value( QStringLiteral( "date" ) );
+  const QStringRef time = attributes.value( QStringLiteral( "time" ) );
+
+  int year, month, day, hour, minute, second;
+  if ( !readNumber( date, 0, 4, year ) || !readNumber( date, 5, 2, month ) || !readNumber( date, 8, 2, day ) )
+    return false;
+  if ( !readNumber( time, 0, 2, hour ) || !readNumber( time, 3, 2, minute ) || !readNumber( time, 6, 2, second ) )
+    return false;
+
+  const QDate qdate( year, month, day );
+  if ( !qdate.isValid() || hour > 23 || minute > 59 || second > 59 )
+    return false;
+
+  msecs = ( qdate.toJulianDay() - JULIAN_DAY_OF_EPOCH ) * 86400000 + qint64( hour * 3600 + minute * 60 + second ) * 1000;
+  return true;
+}
+
+static QDateTime timeFromAttributes( const QXmlStreamAttributes &attributes )
+{
+  qint64 msecs = 0;
+  if ( msecsSinceEpochFromAttributes( attributes, msecs ) )
+    return QDateTime::fromMSecsSinceEpoch( msecs, Qt::UTC );
+
+  return QDateTime();
+}
+
+// Reads the header of the series the reader is positioned on, returns false if there is no header
+static bool readHeader( QXmlStreamReader &reader, ReosDelftFewsXMLIndex::Series &series )
+{
+  if ( !reader.readNextStartElement() || reader.name() != QLatin1String( "series" ) )
+    return false;
+
+  while ( reader.readNextStartElement() )
+  {
+    if ( reader.name() != QLatin1String( "header" ) )
+    {
+      reader.skipCurrentElement();
+      continue;
+    }
+
+    while ( reader.readNextStartElement() )
+    {
+      const QStringRef name = reader.name();
+      if ( name == QLatin1String( "locationId" ) )
+        series.locationId = reader.readElementText();
+      else if ( name == QLatin1String( "stationName" ) )
+        series.stationName = reader.readElementText();
+      else if ( name == QLatin1String( "parameterId" ) )
+        series.parameterId = reader.readElementText();
+      else if ( name == QLatin1String( "type" ) )
+        series.type = reader.readElementText();
+      else if ( name == QLatin1String( "missVal" ) )
+        series.missVal = reader.readElementText();
+      else if ( name == QLatin1String( "lat" ) )
+        series.latitude = reader.readElementText();
+      else if ( name == QLatin1String( "lon" ) )
+        series.longitude = reader.readElementText();
+      else
+      {
+        if ( name == QLatin1String( "startDate" ) )
+          series.startTime = timeFromAttributes( reader.attributes() );
+        else if ( name == QLatin1String( "endDate" ) )
+          series.endTime = timeFromAttributes( reader.attributes() );
+        else if ( name == QLatin1String( "timeStep" ) )
+        {
+          series.timeStepUnit = reader.attributes().value( QStringLiteral( "unit" ) ).toString();
+          series.timeStepMultiplier = reader.attributes().value( QStringLiteral( "multiplier" ) ).toString();
+        }
+        reader.skipCurrentElement();
+      }
+    }
+
+    return !reader.hasError();
+  }
+
+  return false;
+}
+
+// Returns the encoding declared at the beginning of the document, UTF-8 if there is no declaration
+static QString documentEncoding( QFile &file )
+{
+  QXmlStreamReader reader( file.peek( 1024 ) );
+  while ( !reader.atEnd() )
+  {
+    const QXmlStreamReader::TokenType token = reader.readNext();
+    if ( token == QXmlStreamReader::StartDocument )
+    {
+      const QString encoding = reader.documentEncoding().toString();
+      if ( !encoding.isEmpty() )
+        return encoding;
+      break;
+    }
+    if ( token == QXmlStreamReader::StartElement || token == QXmlStreamReader::Invalid )
+      break;
+  }
+
+  return QStringLiteral( "UTF-8" );
+}
+
+static QByteArray xmlDeclaration( const QString &encoding )
+{
+  return QByteArrayLiteral( "<?xml version=\"1.0\" encoding=\"" ) + encoding.toLatin1() + QByteArrayLiteral( "\"?>\n" );
+}
+
+static QDataStream &operator<<( QDataStream &stream, const ReosDelftFewsXMLIndex::Series &series )
+{
+  stream << series.locationId << series.stationName << series.parameterId << series.type << series.missVal
+         << series.timeStepUnit << series.timeStepMultiplier << series.latitude << series.longitude
+         << series.startTime << series.endTime << series.offset << series.size;
+  return stream;
+}
+
+static QDataStream &operator>>( QDataStream &stream, ReosDelftFewsXMLIndex::Series &series )
+{
+  stream >> series.locationId >> series.stationName >> series.parameterId >> series.type >> series.missVal
+         >> series.timeStepUnit >> series.timeStepMultiplier >> series.latitude >> series.longitude
+         >> series.startTime >> series.endTime >> series.offset >> series.size;
+  return stream;
+}
+
+ReosDelftFewsXMLIndex::ReosDelftFewsXMLIndex( const QString &filePath )
+  : mFilePath( filePath )
+{
+  const QFileInfo fileInfo( mFilePath );
+  if ( !fileInfo.exists() )
+    return;
+
+  mFileSize = fileInfo.size();
+  mLastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+
+  if ( readFromDisk() )
+    mIsValid = true;
+  else if ( build() )
+  {
+    mIsValid = true;
+    writeOnDisk();
+  }
+
+  updateLocations();
+}
+
+std::shared_ptr<const ReosDelftFewsXMLIndex> ReosDelftFewsXMLIndex::indexForFile( const QString &filePath )
+{
+  static QMutex sMutex;
+  static QHash<QString, std::shared_ptr<const ReosDelftFewsXMLIndex>> sIndexes;
+
+  const QFileInfo fileInfo( filePath );
+  const QString absolutePath = fileInfo.absoluteFilePath();
+
+  // the lock is kept while building to not build the same index several times
+  QMutexLocker locker( &sMutex );
+  auto it = sIndexes.find( absolutePath );
+  if ( it != sIndexes.end() &&
+       it.value()->mFileSize == fileInfo.size() &&
+       it.value()->mLastModified == fileInfo.lastModified().toMSecsSinceEpoch() )
+    return it.value();
+
+  std::shared_ptr<const ReosDelftFewsXMLIndex> index( new ReosDelftFewsXMLIndex( absolutePath ) );
+  sIndexes.insert( absolutePath, index );
+  return index;
+}
+
+bool ReosDelftFewsXMLIndex::isValid() const
+{
+  return mIsValid;
+}
+
+const QVector<ReosDelftFewsXMLIndex::Series> &ReosDelftFewsXMLIndex::series() const
+{
+  return mSeries;
+}
+
+const ReosDelftFewsXMLIndex::Series *ReosDelftFewsXMLIndex::findSeries( const QString &locationId, const QDateTime &startTime, const QDateTime &endTime ) const
+{
+  auto it = mLocationIdToSeries.constFind( locationId );
+  while ( it != mLocationIdToSeries.constEnd() && it.key() == locationId )
+  {
+    const Series &series = mSeries.at( it.value() );
+    if ( series.startTime == startTime && series.endTime == endTime )
+      return &series;
+    ++it;
+  }
+
+  return nullptr;
+}
+
+bool ReosDelftFewsXMLIndex::readEvents( const Series &series, const std::function<void( qint64, double )> &function ) const
+{
+  QFile file( mFilePath );
+  if ( !file.open( QIODevice::ReadOnly ) || !file.seek( series.offset ) )
+    return false;
+
+  const QByteArray bytes = file.read( series.size );
+  if ( bytes.size() != series.size )
+    return false;
+
+  QXmlStreamReader reader;
+  reader.addData( xmlDeclaration( mEncoding ) );
+  reader.addData( bytes );
+  if ( !reader.readNextStartElement() || reader.name() != QLatin1String( "series" ) )
+    return false;
+
+  while ( reader.readNextStartElement() )
+  {
+    if ( reader.name() == QLatin1String( "event" ) )
+    {
+      const QXmlStreamAttributes attributes = reader.attributes();
+      qint64 msecs = 0;
+      if ( !msecsSinceEpochFromAttributes( attributes, msecs ) )
+        return false;
+
+      double value = std::numeric_limits<double>::quiet_NaN();
+      const QStringRef valueString = attributes.value( QStringLiteral( "value" ) );
+      if ( !valueString.isEmpty() && valueString != series.missVal )
+      {
+        bool ok = false;
+        const double readValue = valueString.toDouble( &ok );
+        if ( ok )
+          value = readValue;
+      }
+
+      function( msecs, value );
+    }
+
+    reader.skipCurrentElement();
+  }
+
+  return !reader.hasError();
+}
+
+bool ReosDelftFewsXMLIndex::build()
+{
+  QFile file( mFilePath );
+  if ( !file.open( QIODevice::ReadOnly ) )
+    return false;
+
+  mEncoding = documentEncoding( file );
+  const QByteArray declaration = xmlDeclaration( mEncoding );
+
+  // The file is mapped to not be limited by the size of a QByteArray, positions are 64 bits.
+  // If the file can't be mapped (for example on a 32 bits platform), it is read in memory if it can be.
+  QByteArray content;
+  const char *data = reinterpret_cast<const char *>( file.map( 0, mFileSize ) );
+  if ( !data )
+  {
+    if ( mFileSize > std::numeric_limits<int>::max() )
+      return false;
+    content = file.readAll();
+    if ( content.size() != mFileSize )
+      return false;
+    data = content.constData();
+  }
+
+  // The markup is ASCII, so the tags can be searched directly in the bytes whatever the encoding (UTF-8 or a single byte encoding).
+  // Only the headers are parsed, the events will be parsed when the series will be loaded.
+  const std::string_view raw( data, static_cast<size_t>( mFileSize ) );
+  const std::string_view startTag( "<series" );
+  const std::string_view endTag( "</series>" );
+  const std::string_view headerEndTag( "</header>" );
+
+  mSeries.clear();
+  size_t position = raw.find( startTag );
+  while ( position != std::string_view::npos )
+  {
+    const size_t afterTag = position + startTag.size();
+    const char nextChar = afterTag < raw.size() ? raw.at( afterTag ) : '>';
+    if ( nextChar != '>' && nextChar != ' ' && nextChar != '\t' && nextChar != '\n' && nextChar != '\r' )
+    {
+      // other tag beginning with the same letters
+      position = raw.find( startTag, afterTag );
+      continue;
+    }
+
+    const size_t end = raw.find( endTag, afterTag );
+    if ( end == std::string_view::npos )
+      break;
+
+    Series series;
+    series.offset = static_cast<qint64>( position );
+    series.size = static_cast<qint64>( end + endTag.size() - position );
+
+    // a series is read in one block when loaded, so it has to fit in a QByteArray
+    if ( series.size <= std::numeric_limits<int>::max() - declaration.size() )
+    {
+      // only the bytes until the end of the header are given to the reader, the events are not needed here
+      size_t headerSize = static_cast<size_t>( series.size );
+      const size_t headerEnd = raw.substr( 0, end ).find( headerEndTag, afterTag );
+      if ( headerEnd != std::string_view::npos )
+        headerSize = headerEnd + headerEndTag.size() - position;
+
+      // the part of the file has no XML declaration, the one of the document is added to decode it with the right encoding
+      QXmlStreamReader reader;
+      reader.addData( declaration );
+      reader.addData( QByteArray::fromRawData( data + position, static_cast<int>( headerSize ) ) );
+      if ( readHeader( reader, series ) )
+        mSeries.append( series );
+    }
+
+    position = raw.find( startTag, end + endTag.size() );
+  }
+
+  return !mSeries.isEmpty();
+}
+
+bool ReosDelftFewsXMLIndex::readFromDisk()
+{
+  QFile file( indexFilePath() );
+  if ( !file.open( QIODevice::ReadOnly ) )
+    return false;
+
+  QDataStream stream( &file );
+  stream.setVersion( QDataStream::Qt_5_6 );
+
+  quint32 magic = 0;
+  qint32 version = 0;
+  QString filePath;
+  qint64 fileSize = -1;
+  qint64 lastModified = 0;
+  stream >> magic >> version >> filePath >> fileSize >> lastModified;
+
+  if ( magic != DELFT_FEWS_INDEX_MAGIC ||
+       version != DELFT_FEWS_INDEX_VERSION ||
+       filePath != mFilePath ||
+       fileSize != mFileSize ||
+       lastModified != mLastModified )
+    return false;
+
+  QString encoding;
+  QVector<Series> series;
+  stream >> encoding >> series;
+  if ( stream.status() != QDataStream::Ok )
+    return false;
+
+  mEncoding = encoding;
+  mSeries = series;
+  return true;
+}
+
+void ReosDelftFewsXMLIndex::writeOnDisk() const
+{
+  // the index is only there to speed up the next openings, so failing to write it is not an error
+  QSaveFile file( indexFilePath() );
+  if ( !file.open( QIODevice::WriteOnly ) )
+    return;
+
+  QDataStream stream( &file );
+  stream.setVersion( QDataStream::Qt_5_6 );
+  stream << quint32( DELFT_FEWS_INDEX_MAGIC ) << qint32( DELFT_FEWS_INDEX_VERSION ) << mFilePath << mFileSize << mLastModified;
+  stream << mEncoding << mSeries;
+
+  if ( stream.status() == QDataStream::Ok )
+    file.commit();
+  else
+    file.cancelWriting();
+}
+
+QString ReosDelftFewsXMLIndex::indexFilePath() const
+{
+  QDir dir( QStandardPaths::writableLocation( QStandardPaths::CacheLocation ) );
+  const QString indexFolder = QStringLiteral( "delft-fews-index" );
+  if ( !dir.exists( indexFolder ) )
+    dir.mkpath( indexFolder );
+  dir.cd( indexFolder );
+
+  const QByteArray hash = QCryptographicHash::hash( mFilePath.toUtf8(), QCryptographicHash::Sha1 ).toHex();
+  return dir.filePath( QString::fromLatin1( hash ) + QStringLiteral( ".idx" ) );
+}
+
+void ReosDelftFewsXMLIndex::updateLocations()
+{
+  mLocationIdToSeries.clear();
+  for ( int i = 0; i < mSeries.count(); ++i )
+    mLocationIdToSeries.insert( mSeries.at( i ).locationId, i );
+}
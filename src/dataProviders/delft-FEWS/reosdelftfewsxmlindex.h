@@ -0,0 +1,98 @@
+/***************************************************************************
+  reosdelftfewsxmlindex.h - ReosDelftFewsXMLIndex
+
+ ---------------------
+ begin                : 23.4.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef REOSDELFTFEWSXMLINDEX_H
+#define REOSDELFTFEWSXMLINDEX_H
+
+#include <functional>
+#include <memory>
+
+#include <QDateTime>
+#include <QMultiHash>
+#include <QString>
+#include <QVector>
+
+/**
+ * Class that indexes the series contained in a Delft-FEWS PI-XML file.
+ *
+ * The index contains the header of each series and the position in bytes of the series in the file.
+ * It is built once per file with a light pass that only parses the headers,
+ * then stored on disk in the cache location of the application and reused as long as the file is not modified.
+ * The events of a series are read by parsing only the part of the file containing the series,
+ * decoded with the encoding declared by the document.
+ */
+class ReosDelftFewsXMLIndex
+{
+  public:
+    //! Header and position of a series in the file
+    struct Series
+    {
+      QString locationId;
+      QString stationName;
+      QString parameterId;
+      QString type;
+      QString missVal;
+      QString timeStepUnit;
+      QString timeStepMultiplier;
+      QString latitude;
+      QString longitude;
+      QDateTime startTime;
+      QDateTime endTime;
+
+      qint64 offset = 0;
+      qint64 size = 0;
+    };
+
+    /**
+     * Returns the index of the file \a filePath. The index is taken from memory or from the disk if it is still valid,
+     * otherwise it is built and stored. Can be called from any thread.
+     */
+    static std::shared_ptr<const ReosDelftFewsXMLIndex> indexForFile( const QString &filePath );
+
+    //! Returns whether the index has been built successfully
+    bool isValid() const;
+
+    //! Returns all the series of the file, in the order of the file
+    const QVector<Series> &series() const;
+
+    //! Returns the series with \a locationId, \a startTime and \a endTime, nullptr if not found
+    const Series *findSeries( const QString &locationId, const QDateTime &startTime, const QDateTime &endTime ) const;
+
+    /**
+     * Reads the events of \a series and calls \a function for each one with the time in milliseconds since epoch (UTC)
+     * and the value, NaN if the value is the missing value of the series or is not a number.
+     * Returns false if the series can't be read or if an event has no valid time.
+     */
+    bool readEvents( const Series &series, const std::function<void( qint64, double )> &function ) const;
+
+  private:
+    explicit ReosDelftFewsXMLIndex( const QString &filePath );
+
+    QString mFilePath;
+    qint64 mFileSize = -1;
+    qint64 mLastModified = 0;
+    QString mEncoding;
+    bool mIsValid = false;
+    QVector<Series> mSeries;
+    QMultiHash<QString, int> mLocationIdToSeries;
+
+    bool build();
+    bool readFromDisk();
+    void writeOnDisk() const;
+    QString indexFilePath() const;
+    void updateLocations();
+};
+
+#endif // REOSDELFTFEWSXMLINDEX_H
@@ -93,62 +93,14 @@ QString ReosDelftFewsXMLProviderInterface::htmlDescriptionFromMetada( const QVar
   return htmlText;
 }
 
-QDomElement ReosDelftFewsXMLProviderInterface::seriesElement( const QString &uri, QDomDocument &xmlDoc ) const
+std::shared_ptr<const ReosDelftFewsXMLIndex> ReosDelftFewsXMLProviderInterface::seriesFromUri( const QString &uri, const ReosDelftFewsXMLIndex::Series *&series )
 {
-  const QString filePath = fileNameFromUri( uri );
-  const QString stationId = stationIdFromUri( uri );
-  const QDateTime startTime = startTimeFromUri( uri );
-  const QDateTime endTime = endTimeFromUri( uri );
-
-  QFile file( filePath );
-  if ( !file.open( QIODevice::ReadOnly ) )
-    return QDomElement();
-  if ( !xmlDoc.setContent( &file ) )
-  {
-    file.close();
-    return QDomElement();
-  }
-  file.close();
-
-  const QDomElement rootNode = xmlDoc.firstChildElement( QStringLiteral( "TimeSeries" ) );
-  if ( rootNode.isNull() )
-    return QDomElement();
-
-  QString noDataValue;
-
-  QDomElement serieElement = rootNode.firstChildElement( QStringLiteral( "series" ) );
-  bool found = false;
-  while ( !serieElement.isNull() )
-  {
-    const QDomElement header = serieElement.firstChildElement( QStringLiteral( "header" ) );
-    if ( !header.isNull() )
-    {
-      const QDomElement locationIdElement = header.firstChildElement( QStringLiteral( "locationId" ) );
-      const QDomElement startTimeElement = header.firstChildElement( QStringLiteral( "startDate" ) );
-      const QDomElement endTimeElement = header.firstChildElement( QStringLiteral( "endDate" ) );
-
-      if ( !locationIdElement.isNull() && !startTimeElement.isNull() && !endTimeElement.isNull() )
-      {
-
-        const QString locationId = valueStringFromElement( locationIdElement );
-        const QDateTime canditateStartTime = timefromElement( startTimeElement );
-        const QDateTime candidateEndTime = timefromElement( endTimeElement );
-
-        if ( stationId == locationId && canditateStartTime == startTime && candidateEndTime == endTime )
-        {
-          found = true;
-          noDataValue = valueStringFromElement( header.firstChildElement( QStringLiteral( "missVal" ) ) );
-          break;
-        }
-      }
-    }
-    serieElement = serieElement.nextSiblingElement( QStringLiteral( "series" ) );
-  }
+  series = nullptr;
+  std::shared_ptr<const ReosDelftFewsXMLIndex> index = ReosDelftFewsXMLIndex::indexForFile( fileNameFromUri( uri ) );
+  if ( index->isValid() )
+    series = index->findSeries( stationIdFromUri( uri ), startTimeFromUri( uri ), endTimeFromUri( uri ) );
 
-  if ( !found )
-    return QDomElement();
-  else
-    return serieElement;
+  return index;
 }
 
 QVariantMap ReosDelftFewsXMLProviderInterface::metadata() const
@@ -170,37 +122,29 @@ QString ReosDelftFewsXMLHydrographProvider::htmlDescription() const
 
 void ReosDelftFewsXMLHydrographProvider::load()
 {
-  const QString uri = dataSource();
-
-  QDomDocument xmlDoc( "delft-document" );
-  QString noDataValue;
-
-  QDomElement serieElement = seriesElement( uri, xmlDoc );
+  const ReosDelftFewsXMLIndex::Series *series = nullptr;
+  const std::shared_ptr<const ReosDelftFewsXMLIndex> index = seriesFromUri( dataSource(), series );
+  if ( !series )
+    return;
 
-  QDomElement valueElement = serieElement.firstChildElement( QStringLiteral( "event" ) );
-  while ( !valueElement.isNull() )
+  qint64 referenceMSecs = 0;
+  const bool isRead = index->readEvents( *series, [this, &referenceMSecs]( qint64 msecs, double value )
   {
-    double value = doubleValueFromElement( valueElement, noDataValue );
-    if ( !std::isnan( value ) )
-    {
-      const QDateTime dateTime = timefromElement( valueElement );
-      if ( !dateTime.isValid() )
-        return;
-      ReosDuration relativetime;
-      if ( mReferenceTime.isValid() )
-      {
-        relativetime = ReosDuration( mReferenceTime.msecsTo( dateTime ), ReosDuration::millisecond );
-      }
-      else
-      {
-        mReferenceTime = dateTime;
-      }
+    if ( std::isnan( value ) )
+      return;
 
-      mCacheTimeValues.append( relativetime );
-      mCacheValues.append( value );
+    if ( !mReferenceTime.isValid() )
+    {
+      mReferenceTime = QDateTime::fromMSecsSinceEpoch( msecs, Qt::UTC );
+      referenceMSecs = msecs;
     }
-    valueElement = valueElement.nextSiblingElement( QStringLiteral( "event" ) );
-  }
+
+    mCacheTimeValues.append( msecs - referenceMSecs );
+    mCacheValues.append( value );
+  } );
+
+  if ( !isRead )
+    return;
 
   emit dataChanged();
 }
@@ -221,7 +165,7 @@ double *ReosDelftFewsXMLHydrographProvider::data() {return mCacheValues.data();}
 
 const QVector<double> &ReosDelftFewsXMLHydrographProvider::constData() const {return mCacheValues;}
 
-const QVector<ReosDuration> &ReosDelftFewsXMLHydrographProvider::constTimeData() const
+const QVector<qint64> &ReosDelftFewsXMLHydrographProvider::constTimeData() const
 {
   return mCacheTimeValues;
 }
@@ -235,31 +179,19 @@ QString ReosDelftFewsXMLRainfallProvider::htmlDescription() const
 
 void ReosDelftFewsXMLRainfallProvider::load()
 {
-  const QString uri = dataSource();
-
-  QDomDocument xmlDoc( "delft-document" );
-  QString noDataValue;
-
-  QDomElement serieElement = seriesElement( uri, xmlDoc );
-
-  bool isIntensity = false;
-
-  const QDomElement headerElement = serieElement.firstChildElement( QStringLiteral( "header" ) );
-  const QDomElement typeElement = headerElement.firstChildElement( QStringLiteral( "type" ) );
-  QString type = ReosDelftFewsXMLProviderInterface::valueStringFromElement( typeElement );
-  isIntensity = type == QStringLiteral( "instantaneous" );
-
-  QDomElement timeStepElement = headerElement.firstChildElement( QStringLiteral( "timeStep" ) );
-  if ( timeStepElement.isNull() )
+  const ReosDelftFewsXMLIndex::Series *series = nullptr;
+  const std::shared_ptr<const ReosDelftFewsXMLIndex> index = seriesFromUri( dataSource(), series );
+  if ( !series )
     return;
 
-  QString timeStepUnitString = timeStepElement.attribute( QStringLiteral( "unit" ) );
-  QString timeStepStringValue = timeStepElement.attribute( QStringLiteral( "multiplier" ) );
+  const bool isIntensity = series->type == QStringLiteral( "instantaneous" );
+
   bool ok = false;
-  double timeStepValue = timeStepStringValue.toDouble( &ok );
+  double timeStepValue = series->timeStepMultiplier.toDouble( &ok );
   if ( !ok )
     return;
 
+  const QString &timeStepUnitString = series->timeStepUnit;
   ReosDuration::Unit timeStepUnit;
   if ( timeStepUnitString == QStringLiteral( "second" ) )
     timeStepUnit = ReosDuration::second;
@@ -273,23 +205,17 @@ void ReosDelftFewsXMLRainfallProvider::load()
     return;
 
   mTimeStep = ReosDuration( timeStepValue, timeStepUnit );
+  const double intensityFactor = mTimeStep.valueHour();
 
-  QDomElement valueElement = serieElement.firstChildElement( QStringLiteral( "event" ) );
-
-  QDateTime prevTime;
-
-  while ( !valueElement.isNull() )
+  qint64 prevMSecs = 0;
+  const bool isRead = index->readEvents( *series, [this, &prevMSecs, isIntensity, intensityFactor]( qint64 msecs, double value )
   {
-    const QDateTime dateTime = timefromElement( valueElement );
-    if ( !dateTime.isValid() )
-      return;
-
     ReosDuration step;
     if ( !mReferenceTime.isValid() )
-      mReferenceTime = dateTime;
+      mReferenceTime = QDateTime::fromMSecsSinceEpoch( msecs, Qt::UTC );
     else
-      step = ReosDuration( prevTime.msecsTo( dateTime ), ReosDuration::millisecond );
-    prevTime = dateTime;
+      step = ReosDuration( msecs - prevMSecs );
+    prevMSecs = msecs;
 
     if ( step > mTimeStep )
     {
@@ -298,19 +224,19 @@ void ReosDelftFewsXMLRainfallProvider::load()
         mCacheValues.append( 0 );
     }
 
-    double value = doubleValueFromElement( valueElement, noDataValue );
     if ( !std::isnan( value ) )
     {
       if ( isIntensity )
-        mCacheValues.append( value * mTimeStep.valueHour() );
+        mCacheValues.append( value * intensityFactor );
       else
         mCacheValues.append( value );
     }
     else
       mCacheValues.append( 0 );
+  } );
 
-    valueElement = valueElement.nextSiblingElement( QStringLiteral( "event" ) );
-  }
+  if ( !isRead )
+    return;
 
   emit dataChanged();
 }
@@ -383,9 +309,9 @@ void ReosDelftFewsXMLHydrographProvider::decode( const ReosEncodedElement &eleme
   setMetadata( meta );
 }
 
-ReosDuration ReosDelftFewsXMLHydrographProvider::relativeTimeAt( int i ) const {return mCacheTimeValues.at( i );}
+ReosDuration ReosDelftFewsXMLHydrographProvider::relativeTimeAt( int i ) const {return ReosDuration( mCacheTimeValues.at( i ) );}
 
-ReosDuration ReosDelftFewsXMLHydrographProvider::lastRelativeTime() const {return mCacheTimeValues.last();}
+ReosDuration ReosDelftFewsXMLHydrographProvider::lastRelativeTime() const {return ReosDuration( mCacheTimeValues.last() );}
 
 QString ReosDelftFewsXMLHydrographProvider::dataType() {return ReosHydrograph::staticType();}
 
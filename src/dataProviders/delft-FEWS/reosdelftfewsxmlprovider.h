@@ -17,9 +17,9 @@
 #define REOSDELFTFEWSXMLPROVIDER_H
 
 #include "reostimeserieprovider.h"
+#include "reosdelftfewsxmlindex.h"
 
 class QDomElement;
-class QDomDocument;
 
 class ReosDelftFewsXMLProviderInterface
 {
@@ -41,7 +41,11 @@ class ReosDelftFewsXMLProviderInterface
     static QDateTime endTimeFromUri( const QString &uri );
     static QDateTime startTimeFromUri( const QString &uri );
 
-    QDomElement seriesElement( const QString &uri, QDomDocument &document ) const;
+    /**
+     * Returns the index of the file of \a uri and sets \a series with the series of the \a uri in this index,
+     * \a series is nullptr if the series is not found. The returned index has to be kept as long as \a series is used.
+     */
+    static std::shared_ptr<const ReosDelftFewsXMLIndex> seriesFromUri( const QString &uri, const ReosDelftFewsXMLIndex::Series *&series );
 
   private:
     QVariantMap mMeta;
@@ -95,7 +99,7 @@ class ReosDelftFewsXMLHydrographProvider: public ReosTimeSerieVariableTimeStepPr
     double lastValue() const override;
     double *data() override;
     const QVector<double> &constData() const override;
-    const QVector<ReosDuration> &constTimeData() const override;
+    const QVector<qint64> &constTimeData() const override;
     ReosEncodedElement encode() const override;
     void decode( const ReosEncodedElement &element ) override;
 
@@ -107,7 +111,7 @@ class ReosDelftFewsXMLHydrographProvider: public ReosTimeSerieVariableTimeStepPr
 
   private:
     QDateTime mReferenceTime;
-    QVector<ReosDuration> mCacheTimeValues;
+    QVector<qint64> mCacheTimeValues;
     QVector<double> mCacheValues;
 };
 
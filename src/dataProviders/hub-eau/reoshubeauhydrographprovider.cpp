@@ -53,7 +53,7 @@ void ReosHubEauHydrographProvider::load()
 
 double *ReosHubEauHydrographProvider::data() {return mCachedValues.data();}
 
-const QVector<ReosDuration> &ReosHubEauHydrographProvider::constTimeData() const
+const QVector<qint64> &ReosHubEauHydrographProvider::constTimeData() const
 {
   return mCachedTimeValues;
 }
@@ -87,9 +87,9 @@ void ReosHubEauHydrographProvider::decode( const ReosEncodedElement &element )
   mMetadataRequestControler->request( QStringLiteral( "referentiel/stations?code_entite=%1&fields=code_station,libelle_station,type_station,longitude_station,latitude_station,en_service,date_ouverture_station,date_fermeture_station,influence_locale_station,commentaire_influence_locale_station,commentaire_station&format=json&pretty&page=1&size=1" ).arg( source ) );
 }
 
-ReosDuration ReosHubEauHydrographProvider::relativeTimeAt( int i ) const {return mCachedTimeValues.at( i );}
+ReosDuration ReosHubEauHydrographProvider::relativeTimeAt( int i ) const {return ReosDuration( mCachedTimeValues.at( i ) );}
 
-ReosDuration ReosHubEauHydrographProvider::lastRelativeTime() const {return mCachedTimeValues.last();}
+ReosDuration ReosHubEauHydrographProvider::lastRelativeTime() const {return ReosDuration( mCachedTimeValues.last() );}
 
 void ReosHubEauHydrographProvider::onResultReady( const QVariantMap &result )
 {
@@ -120,7 +120,7 @@ void ReosHubEauHydrographProvider::onResultReady( const QVariantMap &result )
   {
     QVariantMap mapVar = varDat.toMap();
     const QDateTime time = QDateTime::fromString( mapVar.value( QStringLiteral( "date_obs" ) ).toString(), Qt::ISODate );
-    const ReosDuration relativeTime = ReosDuration( mReferenceTime.msecsTo( time ), ReosDuration::millisecond );
+    const qint64 relativeTime = mReferenceTime.msecsTo( time );
     double value = mapVar.value( QStringLiteral( "resultat_obs" ) ).toDouble() / 1000.0; // server gives valu in l/s
     mCachedValues.append( value );
     mCachedTimeValues.append( relativeTime );
@@ -43,7 +43,7 @@ class ReosHubEauHydrographProvider : public ReosTimeSerieVariableTimeStepProvide
     double lastValue() const override;
     void load() override;
     double *data() override;
-    const QVector<ReosDuration> &constTimeData() const override;
+    const QVector<qint64> &constTimeData() const override;
     const QVector<double> &constData() const override;
     ReosEncodedElement encode() const override;
     void decode( const ReosEncodedElement &element ) override;
@@ -83,7 +83,7 @@ class ReosHubEauHydrographProvider : public ReosTimeSerieVariableTimeStepProvide
     ReosHubEauConnectionControler *mMetadataRequestControler = nullptr;
     QVariantMap mMetadata;
     QVector<double> mCachedValues;
-    QVector<ReosDuration> mCachedTimeValues;
+    QVector<qint64> mCachedTimeValues;
     Status mStatus = Status::Loaded;
     ReosModule::Message mLastMessage;
 
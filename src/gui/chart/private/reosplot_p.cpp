@@ -15,6 +15,8 @@
  ***************************************************************************/
 #include "reosplot_p.h"
 
+#include <cmath>
+
 #include <QWheelEvent>
 
 #include "qwt_plot_grid.h"
@@ -27,6 +29,54 @@
 #include "reosplotwidget.h"
 #include "reostimeserie.h"
 
+// count of samples used when the width of the canvas is not known
+#define DEFAULT_PIXEL_WIDTH 2000
+
+// Returns the width in pixels of the canvas where the \a item is drawn
+static int canvasPixelWidth( const QwtPlotItem *item )
+{
+  if ( item && item->plot() && item->plot()->canvas() )
+    return std::max( 1, item->plot()->canvas()->width() );
+
+  return DEFAULT_PIXEL_WIDTH;
+}
+
+// Returns the range of positions of \a timeSerie that covers [xMin, xMax], with the positions just outside the interval
+static QPair<int, int> positionRange( const ReosTimeSerie *timeSerie, const QRectF &rectOfInterest )
+{
+  const int count = timeSerie->valueCount();
+  const QRectF rect = rectOfInterest.normalized();
+  if ( rect.width() <= 0 || count == 0 )
+    return {0, count - 1};
+
+  auto xAt = [timeSerie]( int i ) {return QwtDate::toDouble( timeSerie->timeAt( i ) );};
+
+  int lower = 0;
+  int upper = count;
+  while ( lower < upper )
+  {
+    const int middle = ( lower + upper ) / 2;
+    if ( xAt( middle ) < rect.left() )
+      lower = middle + 1;
+    else
+      upper = middle;
+  }
+  const int from = std::max( 0, lower - 1 );
+
+  upper = count;
+  while ( lower < upper )
+  {
+    const int middle = ( lower + upper ) / 2;
+    if ( xAt( middle ) <= rect.right() )
+      lower = middle + 1;
+    else
+      upper = middle;
+  }
+  const int to = std::min( count - 1, lower );
+
+  return {from, to};
+}
+
 
 ReosPlot_p::ReosPlot_p( QWidget *parent ): QwtPlot( parent )
 {
@@ -252,31 +302,62 @@ void ReosPositiveMagnifier::rescale( double factor )
 }
 
 
-ReosPlotConstantIntervalTimeIntervalSerie::ReosPlotConstantIntervalTimeIntervalSerie( ReosTimeSerieConstantInterval *timeSerie ):
+ReosPlotConstantIntervalTimeIntervalSerie::ReosPlotConstantIntervalTimeIntervalSerie( ReosTimeSerieConstantInterval *timeSerie, const QwtPlotItem *plotItem ):
   QwtSeriesData<QwtIntervalSample>()
   , mTimeSerie( timeSerie )
+  , mPlotItem( plotItem )
 {}
 
 size_t ReosPlotConstantIntervalTimeIntervalSerie::size() const
 {
-  if ( mTimeSerie )
-    return mTimeSerie->valueCount();
-  else
+  mSampleStarts.clear();
+  if ( !mTimeSerie || mTimeSerie->valueCount() == 0 )
     return 0;
+
+  const QPair<int, int> range = positionRange( mTimeSerie, mRectOfInterest );
+  const int rangeCount = range.second - range.first + 1;
+  const int sampleCount = std::min( rangeCount, canvasPixelWidth( mPlotItem ) );
+
+  mSampleStarts.resize( sampleCount + 1 );
+  for ( int i = 0; i <= sampleCount; ++i )
+    mSampleStarts[i] = range.first + static_cast<int>( qint64( rangeCount ) * i / sampleCount );
+
+  return sampleCount;
 }
 
 QwtIntervalSample ReosPlotConstantIntervalTimeIntervalSerie::sample( size_t i ) const
 {
-  if ( !mTimeSerie )
+  if ( !mTimeSerie || static_cast<int>( i ) + 1 >= mSampleStarts.count() )
     return QwtIntervalSample();
 
-  double y = mTimeSerie->valueAt( i );
-  double x1 = QwtDate::toDouble( mTimeSerie->timeAt( i ) );
-  double x2 = QwtDate::toDouble( mTimeSerie->timeAt( i ).addMSecs( mTimeSerie->timeStepParameter()->value().valueMilliSecond() ) );
+  const int first = mSampleStarts.at( static_cast<int>( i ) );
+  const int last = mSampleStarts.at( static_cast<int>( i ) + 1 ) - 1;
+
+  double y = 0;
+  if ( first == last )
+    y = mTimeSerie->valueAt( first );
+  else
+  {
+    const QPair<int, int> extent = mTimeSerie->extentIndexes( first, last );
+    if ( extent.first >= 0 )
+    {
+      const double min = mTimeSerie->valueAt( extent.first );
+      const double max = mTimeSerie->valueAt( extent.second );
+      y = std::fabs( min ) > std::fabs( max ) ? min : max;
+    }
+  }
+
+  double x1 = QwtDate::toDouble( mTimeSerie->timeAt( first ) );
+  double x2 = QwtDate::toDouble( mTimeSerie->timeAt( last ).addMSecs( mTimeSerie->timeStepParameter()->value().valueMilliSecond() ) );
 
   return QwtIntervalSample( y, x1, x2 );
 }
 
+void ReosPlotConstantIntervalTimeIntervalSerie::setRectOfInterest( const QRectF &rect )
+{
+  mRectOfInterest = rect;
+}
+
 QRectF ReosPlotConstantIntervalTimeIntervalSerie::boundingRect() const
 {
   if ( !mTimeSerie )
@@ -412,26 +493,42 @@ QwtGraphic ReosPlotHistogramItem_p::legendIcon( int, const QSizeF &size ) const
   return icon;
 }
 
-ReosPlotVariableStepTimeSerie::ReosPlotVariableStepTimeSerie( ReosTimeSerieVariableTimeStep *timeSerie ):
+ReosPlotVariableStepTimeSerie::ReosPlotVariableStepTimeSerie( ReosTimeSerieVariableTimeStep *timeSerie, const QwtPlotItem *plotItem ):
   mTimeSerie( timeSerie )
+  , mPlotItem( plotItem )
 {}
 
 size_t ReosPlotVariableStepTimeSerie::size() const
 {
-  if ( mTimeSerie )
-    return mTimeSerie->valueCount();
-  else
+  if ( !mTimeSerie || mTimeSerie->valueCount() == 0 )
+  {
+    mSampleIndexes.clear();
     return 0;
+  }
+
+  const QPair<int, int> range = positionRange( mTimeSerie, mRectOfInterest );
+  mSampleIndexes = mTimeSerie->decimatedIndexes( range.first, range.second, canvasPixelWidth( mPlotItem ) );
+
+  return mSampleIndexes.count();
 }
 
 QPointF ReosPlotVariableStepTimeSerie::sample( size_t i ) const
 {
-  double x = QwtDate::toDouble( mTimeSerie->timeAt( i ) );
-  double y = mTimeSerie->valueAt( i );
+  if ( !mTimeSerie || static_cast<int>( i ) >= mSampleIndexes.count() )
+    return QPointF();
+
+  const int index = mSampleIndexes.at( static_cast<int>( i ) );
+  double x = QwtDate::toDouble( mTimeSerie->timeAt( index ) );
+  double y = mTimeSerie->valueAt( index );
 
   return QPointF( x, y );
 }
 
+void ReosPlotVariableStepTimeSerie::setRectOfInterest( const QRectF &rect )
+{
+  mRectOfInterest = rect;
+}
+
 QRectF ReosPlotVariableStepTimeSerie::boundingRect() const
 {
   if ( mTimeSerie &&  mTimeSerie->valueCount() != 0 )
@@ -130,19 +130,31 @@ class ReosPlot_p: public QwtPlot
 };
 
 
+/**
+ * Series data of the intervals of a time serie with constant time step.
+ *
+ * Only the intervals in the rect of interest are returned. If there are more intervals than pixels in the canvas of \a plotItem,
+ * consecutive intervals are merged in one interval with the value of greatest magnitude.
+ */
 class ReosPlotConstantIntervalTimeIntervalSerie: public QwtSeriesData<QwtIntervalSample>
 {
   public:
-    ReosPlotConstantIntervalTimeIntervalSerie( ReosTimeSerieConstantInterval *timeSerie );
+    ReosPlotConstantIntervalTimeIntervalSerie( ReosTimeSerieConstantInterval *timeSerie, const QwtPlotItem *plotItem = nullptr );
 
     size_t size() const override;
     QwtIntervalSample sample( size_t i ) const override;
     QRectF boundingRect() const override;
+    void setRectOfInterest( const QRectF &rect ) override;
 
     ReosTimeSerieConstantInterval *data() const;
 
   private:
     QPointer<ReosTimeSerieConstantInterval> mTimeSerie;
+    const QwtPlotItem *mPlotItem = nullptr;
+    QRectF mRectOfInterest;
+
+    // first position of each sample, followed by the position after the last sample, updated each time the size is requested
+    mutable QVector<int> mSampleStarts;
 };
 
 
@@ -164,19 +176,31 @@ class ReosPlotConstantIntervalTimePointSerie: public QwtSeriesData<QPointF>
     ReosTimeSerieConstantInterval::ValueMode mValueMode = ReosTimeSerieConstantInterval::Value ;
 };
 
+/**
+ * Series data of the points of a time serie with variable time step.
+ *
+ * Only the points in the rect of interest are returned. If there are more points than pixels in the canvas of \a plotItem,
+ * the points are decimated keeping the minimum and the maximum for each pixel.
+ */
 class ReosPlotVariableStepTimeSerie: public  QwtSeriesData<QPointF>
 {
   public:
-    ReosPlotVariableStepTimeSerie( ReosTimeSerieVariableTimeStep *timeSerie );
+    ReosPlotVariableStepTimeSerie( ReosTimeSerieVariableTimeStep *timeSerie, const QwtPlotItem *plotItem = nullptr );
 
     size_t size() const override;
     QPointF sample( size_t i ) const override;
     QRectF boundingRect() const override;
+    void setRectOfInterest( const QRectF &rect ) override;
 
     ReosTimeSerieVariableTimeStep *data() const;
 
   private:
     QPointer<ReosTimeSerieVariableTimeStep> mTimeSerie;
+    const QwtPlotItem *mPlotItem = nullptr;
+    QRectF mRectOfInterest;
+
+    // positions of the returned samples, updated each time the size is requested
+    mutable QVector<int> mSampleIndexes;
 };
 
 
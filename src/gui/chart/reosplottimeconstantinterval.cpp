@@ -62,7 +62,7 @@ void ReosPlotTimeHistogram::setTimeSerie( ReosTimeSerieConstantInterval *timeSer
   if ( mTimeSerie && mTimeSerie->data() )
     disconnect( mTimeSerie->data(), &ReosDataObject::dataChanged, this, &ReosPlotItem::itemChanged );
 
-  mTimeSerie = new ReosPlotConstantIntervalTimeIntervalSerie( timeSerie );
+  mTimeSerie = new ReosPlotConstantIntervalTimeIntervalSerie( timeSerie, mPlotItem );
   histogram()->setSamples( mTimeSerie );
 
   if ( timeSerie )
@@ -159,7 +159,7 @@ void ReosPlotTimeSerieVariableStep::setTimeSerie( ReosTimeSerieVariableTimeStep
 
   mTimeSerie = nullptr;
   if ( timeSerie )
-    mTimeSerie = new ReosPlotVariableStepTimeSerie( timeSerie );
+    mTimeSerie = new ReosPlotVariableStepTimeSerie( timeSerie, mPlotItem );
   curve()->setSamples( mTimeSerie );
 
   if ( applysettings )
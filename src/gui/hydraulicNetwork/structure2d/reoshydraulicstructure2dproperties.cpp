@@ -293,6 +293,14 @@ void ReosHydraulicStructure2DProperties::onLaunchCalculation()
     std::unique_ptr<ReosProcess> preparationProcess( mStructure2D->getPreparationProcessSimulation( mCalculationContext ) );
     ReosProcessControler *controler = new ReosProcessControler( preparationProcess.get(), this );
     controler->exec();
+    controler->deleteLater();
+
+    if ( !preparationProcess->isSuccessful() )
+    {
+      QMessageBox::warning( this, tr( "Run Simulation" ), preparationProcess->message().text );
+      mActionEditStructure->setEnabled( true );
+      return;
+    }
 
     setCurrentSimulationProcess( mStructure2D->startSimulation( mCalculationContext ), mCalculationContext );
   }
@@ -313,6 +321,9 @@ void ReosHydraulicStructure2DProperties::onExportSimulation()
   controler->exec();
 
   controler->deleteLater();
+
+  if ( !preparationProcess->isSuccessful() )
+    QMessageBox::warning( this, tr( "Export Simulation" ), preparationProcess->message().text );
 }
 
 void ReosHydraulicStructure2DProperties::updateDatasetMenu()
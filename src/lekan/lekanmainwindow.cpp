@@ -39,6 +39,7 @@ email                : vcloarec@gmail.com projetreos@gmail.com
 #include "reosrunoffmodel.h"
 #include "reoshydraulicnetwork.h"
 #include "reoshydraulicnetworkwidget.h"
+#include "reosprojectcontainer.h"
 
 #define PROJECT_FILE_MAGIC_NUMBER 19092014
 
@@ -109,6 +110,36 @@ bool LekanMainWindow::openProject()
   QString path = currentProjectPath();
   QString baseName = currentProjectBaseName();
 
+  if ( !ReosProjectContainer::isProjectContainer( filePath ) )
+    return openLegacyProject( filePath, path, baseName );
+
+  clearProject();
+
+  // only the table of contents is read here, the sections are read when decoded
+  std::shared_ptr<ReosProjectContainer> container = std::make_shared<ReosProjectContainer>();
+  if ( !container->open( filePath ) )
+    return false;
+
+  ReosEncodedElement::setSerialisationVersion( container->serialisationVersion() );
+
+  if ( !mGisEngine->decode( container->encodedSection( QStringLiteral( "GIS-engine" ) ), path, baseName ) )
+    return false;
+
+  // direction rasters are the largest part of the watershed data and are only needed for delineating, they are read on demand
+  mWatershedModule->decode( container->encodedSection( QStringLiteral( "watershed-module" ) ), [container]
+  {
+    return container->encodedSection( QStringLiteral( "watershed-direction-rasters" ) );
+  } );
+
+  mHydraulicNetwork->decode( container->encodedSection( QStringLiteral( "hydaulic-network" ) ), path, baseName );
+
+  mProjectContainer = container;
+
+  return true;
+}
+
+bool LekanMainWindow::openLegacyProject( const QString &filePath, const QString &path, const QString &baseName )
+{
   QFile file( filePath );
   if ( !file.open( QIODevice::ReadOnly ) )
     return false;
@@ -171,39 +202,36 @@ bool LekanMainWindow::saveProject()
   mRainFallManagerWidget->saveRainfallFile();
   mRunoffManagerWidget->save();
 
-  ReosEncodedElement lekanProject( QStringLiteral( "Lekan-project" ) );
-  ReosEncodedElement encodedGisEngine = mGisEngine->encode( path, baseName );
-  lekanProject.addEncodedData( QStringLiteral( "GIS-engine" ), encodedGisEngine );
-  lekanProject.addEncodedData( QStringLiteral( "watershed-module" ), mWatershedModule->encode() );
-  lekanProject.addEncodedData( QStringLiteral( "hydaulic-network" ), mHydraulicNetwork->encode( path, baseName ) );
-
   QFileInfo fileInfo( filePath );
   if ( fileInfo.suffix().isEmpty() )
     filePath.append( QStringLiteral( ".lkn" ) );
 
-  QFile file( filePath );
-  if ( !file.open( QIODevice::WriteOnly ) )
-    return false;
+  if ( !mProjectContainer )
+    mProjectContainer = std::make_shared<ReosProjectContainer>();
 
-  QDataStream stream( &file );
+  // sections whose bytes have not changed are not written again if the project is saved in the same file
+  ReosProjectContainer &container = *mProjectContainer;
+  container.setHeader( lekanVersion.bytesVersion() );
+  container.setSerialisationVersion( ReosEncodedElement::serialisationVersion() );
 
-  //**** header
-  qint32 magicNumber = PROJECT_FILE_MAGIC_NUMBER;
-  qint32 serialisationVersion = stream.version();
+  // the GIS engine is always encoded because it also writes the QGIS project file
+  container.setEncodedSection( QStringLiteral( "GIS-engine" ), mGisEngine->encode( path, baseName ) );
 
-  QByteArray versionBytes = lekanVersion.bytesVersion();
+  // modules are always encoded, not all their changes dirty them, and encoding the hydraulic network also writes the meshes.
+  // Watershed data that have not been accessed since loading are encoded as they were read.
+  container.setEncodedSection( QStringLiteral( "watershed-module" ), mWatershedModule->encode( false ) );
 
-  Q_ASSERT( versionBytes.size() == 21 );
-
-  stream << magicNumber;
-  stream << serialisationVersion;
-  stream << versionBytes;
-  //*****
-
-  stream << lekanProject.bytes();
+  // encoding the direction rasters needs to load them, so they are encoded only if they have changed
+  if ( !container.hasSection( QStringLiteral( "watershed-direction-rasters" ) ) ||
+       mWatershedModule->watershedTree()->directionRasterStore().hasChanged() )
+  {
+    // direction rasters are already compressed
+    container.setEncodedSection( QStringLiteral( "watershed-direction-rasters" ), mWatershedModule->encodeDirectionRasters(), false );
+  }
 
+  container.setEncodedSection( QStringLiteral( "hydaulic-network" ), mHydraulicNetwork->encode( path, baseName ) );
 
-  return true;
+  return container.save( filePath );
 }
 
 void LekanMainWindow::clearProject()
@@ -221,6 +249,8 @@ void LekanMainWindow::clearProject()
 
   if ( mHydraulicNetwork )
     mHydraulicNetwork->clear();
+
+  mProjectContainer.reset();
 }
 
 void LekanMainWindow::checkExtraProjectToSave()
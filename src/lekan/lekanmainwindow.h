@@ -17,6 +17,7 @@ email                : vcloarec at gmail dot com
 #define LEKANMAINWINDOW_H
 
 #include <QMainWindow>
+#include <memory>
 #include <QActionGroup>
 #include <QUndoStack>
 
@@ -29,6 +30,7 @@ email                : vcloarec at gmail dot com
 #include "reoswatershedtree.h"
 
 class ReosModule;
+class ReosProjectContainer;
 class ReosMap;
 class ReosGisEngine;
 class ReosWatershedModule;
@@ -62,6 +64,12 @@ class LekanMainWindow : public ReosMainWindow
 
     QFileInfo gisFileInfo() const;
 
+    //! Opens project files written before the project container, with all the project in one encoded element
+    bool openLegacyProject( const QString &filePath, const QString &path, const QString &baseName );
+
+    //! Container of the current project, shared with the data that are loaded on demand
+    std::shared_ptr<ReosProjectContainer> mProjectContainer;
+
     ReosGisEngine *mGisEngine = nullptr;
     ReosMap *mMap = nullptr;
     ReosWatershedModule *mWatershedModule = nullptr;
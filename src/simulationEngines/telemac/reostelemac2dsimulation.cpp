@@ -19,17 +19,26 @@
 #include <QProcess>
 
 #include <qgsmeshlayer.h>
-#include <qgsmeshtriangulation.h>
-
-#include <mdal.h>
 
 #include "reoshydraulicstructure2d.h"
 #include "reossimulationinitialcondition.h"
 #include "reoshydraulicstructureboundarycondition.h"
 #include "reoscalculationcontext.h"
 #include "reostelemac2dsimulationresults.h"
+#include "reostelemacselafinwriter.h"
 #include "reossettings.h"
 
+#if QT_VERSION < QT_VERSION_CHECK(5, 15, 0)
+#define skipEmptyPart QString::SkipEmptyParts
+#else
+#define skipEmptyPart Qt::SplitBehaviorFlags::SkipEmptyParts
+#endif
+
+//! Minimum interval in milliseconds between two sendings of boundary flows and progression
+static const int FLOW_BATCH_INTERVAL = 500;
+//! Maximum count of characters of the output kept to be sent when the process is finished
+static const int MAX_OUTPUT_BUFFER_SIZE = 1 << 20;
+
 
 
 ReosTelemac2DSimulation::ReosTelemac2DSimulation( QObject *parent )
@@ -181,10 +190,10 @@ ReosParameterInteger *ReosTelemac2DSimulation::outputPeriodResultHydrograph() co
   return mOutputPeriodResultHyd;
 }
 
-void ReosTelemac2DSimulation::prepareInput( ReosHydraulicStructure2D *hydraulicStructure, const ReosCalculationContext &calculationContext )
+bool ReosTelemac2DSimulation::prepareInput( ReosHydraulicStructure2D *hydraulicStructure, const ReosCalculationContext &calculationContext )
 {
   const QDir dir = simulationDir( hydraulicStructure, calculationContext.schemeId() );
-  prepareInput( hydraulicStructure, calculationContext, dir );
+  const bool success = prepareInput( hydraulicStructure, calculationContext, dir );
 
   const QFileInfo fileInfo( dir.filePath( mResultFileName ) );
 
@@ -193,15 +202,19 @@ void ReosTelemac2DSimulation::prepareInput( ReosHydraulicStructure2D *hydraulicS
     QFile::remove( dir.filePath( mResultFileName ) );
     QFile::remove( dir.filePath( QStringLiteral( "outputHydrographs" ) ) );
   }
+
+  return success;
 }
 
-void ReosTelemac2DSimulation::prepareInput( ReosHydraulicStructure2D *hydraulicStructure, const ReosCalculationContext &calculationContext, const QDir &directory )
+bool ReosTelemac2DSimulation::prepareInput( ReosHydraulicStructure2D *hydraulicStructure, const ReosCalculationContext &calculationContext, const QDir &directory )
 {
   QVector<int> verticesPosInBoundary;
   QList<ReosHydraulicStructureBoundaryCondition *> boundaryCondition = createBoundaryFiles( hydraulicStructure, verticesPosInBoundary, directory );
-  createSelafinInputGeometry( hydraulicStructure, verticesPosInBoundary, directory );
+  if ( !createSelafinInputGeometry( hydraulicStructure, verticesPosInBoundary, directory ) )
+    return false;
   mBoundaries = createBoundaryConditionFiles( boundaryCondition, calculationContext, directory );
   createSteeringFile( hydraulicStructure, boundaryCondition, calculationContext, directory );
+  return true;
 }
 
 ReosSimulationProcess *ReosTelemac2DSimulation::getProcess( ReosHydraulicStructure2D *hydraulicStructure, const ReosCalculationContext &calculationContext ) const
@@ -442,60 +455,14 @@ QList<ReosHydraulicStructureBoundaryCondition *> ReosTelemac2DSimulation::create
   return ret;
 }
 
-template<typename T>
-void writeValue( T &value, QDataStream &out, bool changeEndianness = false )
-{
-  T v = value;
-  char *const p = reinterpret_cast<char *>( &v );
-
-  if ( changeEndianness )
-    std::reverse( p, p + sizeof( T ) );
-
-  out.writeRawData( p, sizeof( T ) );
-}
-
-static bool isNativeLittleEndian()
-{
-  int n = 1;
-  return ( *( char * )&n == 1 );
-}
-
-template<typename T>
-static void writeValue( QDataStream &stream, T value )
-{
-  writeValue( value, stream, isNativeLittleEndian() );
-}
-
-static void writeInt( QDataStream &stream, int i )
-{
-  writeValue( i, stream, isNativeLittleEndian() );
-}
-
-template<typename T>
-static void writeValueArrayRecord( QDataStream &stream, const QVector<T> &array )
-{
-  writeValue( stream, int( array.size()*sizeof( T ) ) );
-  for ( const T value : array )
-    writeValue( stream, value );
-  writeValue( stream, int( array.size()*sizeof( T ) ) );
-}
-
-static void writeStringRecord( QDataStream &stream, const QString &str )
-{
-  writeInt( stream,  str.count() );
-  stream.writeRawData( str.toStdString().c_str(), str.count() );
-  writeInt( stream, str.count() );
-}
-
-
-static void setCounterClockwise( QVector<int> &triangle, const QPointF &v0, const QPointF &v1, const QPointF &v2 )
+static void setCounterClockwise( int *triangle, const QVector<double> &x, const QVector<double> &y )
 {
   //To have consistent clock wise orientation of triangles which is necessary for 3D rendering
   //Check the clock wise, and if it is not counter clock wise, swap indexes to make the oientation counter clock wise
-  double ux = v1.x() - v0.x();
-  double uy = v1.y() - v0.y();
-  double vx = v2.x() - v0.x();
-  double vy = v2.y() - v0.y();
+  double ux = x.at( triangle[1] ) - x.at( triangle[0] );
+  double uy = y.at( triangle[1] ) - y.at( triangle[0] );
+  double vx = x.at( triangle[2] ) - x.at( triangle[0] );
+  double vy = y.at( triangle[2] ) - y.at( triangle[0] );
 
   double crossProduct = ux * vy - uy * vx;
   if ( crossProduct < 0 ) //CW -->change the orientation
@@ -504,139 +471,79 @@ static void setCounterClockwise( QVector<int> &triangle, const QPointF &v0, cons
   }
 }
 
-
-void ReosTelemac2DSimulation::createSelafinMeshFrame( ReosHydraulicStructure2D *hydraulicStructure,
-    const QVector<int> &verticesPosInBoundary,
-    const QDir &directory )
-{
-  // MDAL does not handle the boundaries. As the parrallel calculation in Telemac need to now about the boundaies vertices,
-  // wa can't iuse MDAL to create the mesh frame file. Here we use the same logic as MDAL but we add the boundaries vertices indexes
-
-  ReosMesh *rmesh = hydraulicStructure->mesh();
-  QString path = directory.filePath( mGeomFileName );
-
-  QFile file( path );
-  file.open( QIODevice::WriteOnly );
-  QDataStream stream( &file );
-
-  QString header( "Selafin file created by Lekan" );
-  int remainingSpace = 72 - header.size();
-  QString remainingString;
-  remainingString.fill( ' ', remainingSpace );
-  header.append( remainingString );
-  header.append( "SERAFIND" );
-  Q_ASSERT( header.size() == 80 );
-  writeStringRecord( stream, header );
-
-  // NBV(1) NBV(2) size
-  QVector<int> nbvSize( 2 );
-  nbvSize[0] = 0;
-  nbvSize[1] = 0;
-  writeValueArrayRecord( stream, nbvSize );
-
-  //don't write variable name
-
-  //parameter table, all values are 0
-  QVector<int> param( 10, 0 );
-  writeValueArrayRecord( stream, param );
-
-  //NELEM,NPOIN,NDP,1
-  int verticesPerFace = 3;
-  int verticesCount = rmesh->vertexCount();
-  int facesCount = rmesh->faceCount();
-  QVector<int> elem( 4 );
-  elem[0] = facesCount;
-  elem[1] = verticesCount;
-  elem[2] = verticesPerFace ;
-  elem[3] = 1;
-  writeValueArrayRecord( stream, elem );
-
-  //connectivity table
-  writeInt( stream, facesCount * verticesPerFace * 4 );
-
-  for ( int i = 0; i < facesCount; ++i )
-  {
-    QVector<int> face = rmesh->face( i );
-    setCounterClockwise( face, rmesh->vertexPosition( face.at( 0 ) ), rmesh->vertexPosition( face.at( 1 ) ), rmesh->vertexPosition( face.at( 2 ) ) );
-    for ( int f : std::as_const( face ) )
-      writeInt( stream, f + 1 );
-
-  }
-  writeInt( stream, facesCount * verticesPerFace * 4 );
-
-  writeValueArrayRecord( stream, verticesPosInBoundary );
-
-  //Vertices
-  QVector<double> xValues( verticesCount );
-  QVector<double>  yValues( verticesCount );
-  for ( int i = 0; i < verticesCount; ++i )
-  {
-    const QPointF vert = rmesh->vertexPosition( i );
-    xValues[i] = vert.x();
-    yValues[i] = vert.y();
-  }
-
-  writeValueArrayRecord( stream, xValues );
-  writeValueArrayRecord( stream, yValues );
-
-  file.close();
-}
-
-void ReosTelemac2DSimulation::createSelafinInputGeometry(
+bool ReosTelemac2DSimulation::createSelafinInputGeometry(
   ReosHydraulicStructure2D *hydraulicStructure,
   const QVector<int> &verticesPosInBoundary,
   const QDir &directory )
 {
-  createSelafinMeshFrame( hydraulicStructure, verticesPosInBoundary, directory );
-
-  // TODO :: replace below by  writing directly on the file without MDAL or QGIS. Indeed, no so much to do more than the method aboce
+  // MDAL does not handle the boundaries that are needed by the parallel calculation in Telemac,
+  // so the mesh frame and the variables are written directly in the file from contiguous arrays
   QgsMeshLayer *meshLayer = qobject_cast<QgsMeshLayer *> ( hydraulicStructure->mesh()->data() );
   if ( !meshLayer )
-    return;
+    return false;
 
   const QgsMesh &mesh = *meshLayer->nativeMesh();
+  const int verticesCount = mesh.vertexCount();
+  const int facesCount = mesh.faceCount();
 
-  QString path = directory.filePath( mGeomFileName );
-
-  std::unique_ptr<QgsMeshLayer> ouputMesh = std::make_unique < QgsMeshLayer>(
-        path,
-        QStringLiteral( "temp" ),
-        QStringLiteral( "mdal" ) );
-
-  //! Terrain elevation
-  QgsMeshZValueDatasetGroup *zValueDatasetGroup = new QgsMeshZValueDatasetGroup( "BOTTOM", mesh );
-  ouputMesh->addDatasets( zValueDatasetGroup );
+  //! Vertices and terrain elevation
+  QVector<double> xValues( verticesCount );
+  QVector<double> yValues( verticesCount );
+  QVector<double> bottom( verticesCount );
+  for ( int i = 0; i < verticesCount; ++i )
+  {
+    const QgsMeshVertex &vert = mesh.vertices.at( i );
+    xValues[i] = vert.x();
+    yValues[i] = vert.y();
+    bottom[i] = vert.z();
+  }
 
-  ouputMesh->saveDataset( path, 0, QStringLiteral( "SELAFIN" ) );
+  //! Connectivity
+  QVector<int> connectivity( facesCount * 3 );
+  for ( int i = 0; i < facesCount; ++i )
+  {
+    const QgsMeshFace &face = mesh.faces.at( i );
+    int *triangle = connectivity.data() + 3 * i;
+    for ( int j = 0; j < 3; ++j )
+      triangle[j] = face.at( j );
+    setCounterClockwise( triangle, xValues, yValues );
+  }
 
   //! Roughness
   std::unique_ptr<ReosPolygonStructureValues> roughness(
     hydraulicStructure->roughnessStructure()->structure()->values( meshLayer->crs().toWkt( QgsCoordinateReferenceSystem::WKT2_2019_SIMPLIFIED ) ) );
 
-
-  std::shared_ptr<QgsMeshMemoryDataset> roughnessDataset( new QgsMeshMemoryDataset );
-  roughnessDataset->values.resize( mesh.vertexCount() );
-
-  int size = mesh.vertexCount();
+  QVector<double> friction( verticesCount );
   double defaultVal = hydraulicStructure->roughnessStructure()->defaultRoughness()->value();
-  for ( int i = 0; i < size; ++i )
+  for ( int i = 0; i < verticesCount; ++i )
   {
-    const QgsMeshVertex &vert = mesh.vertices.at( i );
-    double val = roughness->value( vert.x(), vert.y(), false );
+    double val = roughness->value( xValues.at( i ), yValues.at( i ), false );
     if ( std::isnan( val ) )
       val = defaultVal;
-    roughnessDataset->values[i] = 1 / val;
+    friction[i] = 1 / val;
   }
 
-  roughnessDataset->valid = true;
-  roughnessDataset->time = 0;
-
-  std::unique_ptr<QgsMeshMemoryDatasetGroup> roughnessGroup( new QgsMeshMemoryDatasetGroup( "BOTTOM FRICTION", QgsMeshDatasetGroupMetadata::DataOnVertices ) );
-  roughnessGroup->addDataset( roughnessDataset );
-  roughnessGroup->initialize();
+  const QString fileName = directory.filePath( mGeomFileName );
+  ReosTelemacSelafinWriter writer( fileName );
+  bool success = writer.writeHeader( QStringLiteral( "Selafin file created by Lekan" ),
+                                     QStringList( {QStringLiteral( "BOTTOM" ), QStringLiteral( "BOTTOM FRICTION" )} ),
+                                     QStringList( {QStringLiteral( "M" ), QString()} ),
+                                     connectivity,
+                                     verticesPosInBoundary,
+                                     xValues,
+                                     yValues );
+
+  success = success &&
+            writer.writeFrameTime( 0 ) &&
+            writer.writeVariableValues( bottom ) &&
+            writer.writeVariableValues( friction );
+
+  // the writer has to be closed even if a write failed, before removing an incomplete file
+  success = writer.close() && success;
+  if ( !success )
+    QFile::remove( fileName );
 
-  ouputMesh->addDatasets( roughnessGroup.release() );
-  ouputMesh->saveDataset( path, 1, QStringLiteral( "SELAFIN" ) );
+  return success;
 }
 
 
@@ -893,11 +800,14 @@ void ReosTelemac2DSimulationProcess::start()
             <<  QStringLiteral( "--ncsize=%1" ).arg( settings.value( QStringLiteral( "/engine/telemac/cpu-usage-count" ) ).toInt() );
 
 
-  mBlockRegEx = QRegularExpression( QStringLiteral( "(?s).*?((ITERATION.*?)\\n.*?=====)" ) );
-  mBoundaryFlowRegEx = QRegularExpression( QStringLiteral( "(?s).*?FLUX BOUNDARY +([0-9])+: +([\\-0-9.E]+)" ) );
-
-  mTimeRegEx = QRegularExpression( QStringLiteral( "(ITERATION +[a-zA-Z0-9]+ +TIME:[\\ 0-9a-zA-Z.()]+)" ) );
-  QStringLiteral( "(?s)(ITERATION +[a-zA-Z0-9]+ +TIME:[ 0-9a-zA-Z.()]+).*?FLUX BOUNDARY +1: +([\\-0-9.E]+)" );
+  mStandartOutputBuffer.clear();
+  mPendingLine.clear();
+  mInIterationBlock = false;
+  mIterationFlows.clear();
+  mFlowBatch = FlowBatch();
+  mPendingInformation.clear();
+  mCurrentTime = 0;
+  mBatchTimer.start();
 
   mIsPreparation = true;
   setMaxProgression( 100 );
@@ -917,6 +827,14 @@ void ReosTelemac2DSimulationProcess::start()
   if ( resultStart )
   {
     finished = mProcess->waitForFinished( -1 );
+
+    addToOutput( mProcess->readAll() );
+    if ( !mPendingLine.isEmpty() )
+      processLine( mPendingLine );
+    mPendingLine.clear();
+    closeIterationBlock();
+    sendFlowBatch();
+
     setCurrentProgression( 100 );
 
     if ( isStop() )
@@ -952,77 +870,135 @@ void ReosTelemac2DSimulationProcess::onStopAsked()
 
 void ReosTelemac2DSimulationProcess::addToOutput( const QString &txt )
 {
-  mStandartOutputBuffer.append( txt );
-  QRegularExpressionMatch blockMatch = mBlockRegEx.match( mStandartOutputBuffer );
-  QString message;
+  if ( txt.isEmpty() )
+    return;
 
   if ( mIsPreparation )
     emit sendInformation( txt );
 
-  while ( blockMatch.hasMatch() )
+  // only complete lines are processed, the end of the chunk is kept until the next one
+  int lineStart = 0;
+  int lineEnd = txt.indexOf( '\n' );
+  while ( lineEnd >= 0 )
   {
-    if ( mIsPreparation )
+    if ( mPendingLine.isEmpty() )
     {
-      mIsPreparation = false;
+      processLine( txt.mid( lineStart, lineEnd - lineStart ) );
     }
     else
     {
-      extractInformation( blockMatch );
+      mPendingLine.append( txt.midRef( lineStart, lineEnd - lineStart ) );
+      processLine( mPendingLine );
+      mPendingLine.clear();
     }
+    lineStart = lineEnd + 1;
+    lineEnd = txt.indexOf( '\n', lineStart );
+  }
+  mPendingLine.append( txt.midRef( lineStart ) );
 
-    mStandartOutputBuffer = mStandartOutputBuffer.mid( blockMatch.capturedEnd() );
-    blockMatch = mTimeRegEx.match( mStandartOutputBuffer );
+  if ( mBatchTimer.elapsed() >= FLOW_BATCH_INTERVAL )
+    sendFlowBatch();
+}
+
+void ReosTelemac2DSimulationProcess::processLine( const QString &line )
+{
+  const QString trimmedLine = line.trimmed();
+
+  if ( trimmedLine.startsWith( QStringLiteral( "ITERATION" ) ) && trimmedLine.contains( QStringLiteral( "TIME" ) ) )
+  {
+    closeIterationBlock();
+    mIsPreparation = false;
+    mStandartOutputBuffer.clear();
+
+    // the line looks like "ITERATION    10    TIME:   0 D  0 H  1 MN  40.0000 S   (   100.0000 S)"
+    const QStringList splited = trimmedLine.split( ' ', skipEmptyPart );
+    mIterationTime = 0;
+    if ( splited.count() > 1 && splited.last().contains( 'S' ) )
+      mIterationTime = splited.at( splited.count() - 2 ).toDouble();
+
+    mIterationHeader = trimmedLine;
+    mIterationFlows.clear();
+    mInIterationBlock = true;
+  }
+  else if ( mInIterationBlock && trimmedLine.startsWith( QStringLiteral( "FLUX BOUNDARY" ) ) )
+  {
+    // the line looks like "FLUX BOUNDARY    1:    -0.1234567E+01 M3/S  ( >0 : ENTERING  <0 : EXITING )"
+    const int prefixLength = QStringLiteral( "FLUX BOUNDARY" ).size();
+    const int colonPos = trimmedLine.indexOf( ':', prefixLength );
+    if ( colonPos >= 0 )
+    {
+      bool ok = false;
+      const int boundRank = trimmedLine.midRef( prefixLength, colonPos - prefixLength ).trimmed().toInt( &ok );
+      if ( ok )
+      {
+        const QStringRef valueString = trimmedLine.midRef( colonPos + 1 ).trimmed();
+        const double value = valueString.left( valueString.indexOf( ' ' ) ).toDouble( &ok );
+        if ( ok )
+          mIterationFlows.append( {boundRank, value} );
+      }
+    }
   }
+
+  // only the end of the output is kept to be sent when the process is finished
+  mStandartOutputBuffer.append( line );
+  mStandartOutputBuffer.append( '\n' );
+  if ( mStandartOutputBuffer.size() > MAX_OUTPUT_BUFFER_SIZE )
+    mStandartOutputBuffer.remove( 0, mStandartOutputBuffer.size() - MAX_OUTPUT_BUFFER_SIZE / 2 );
 }
 
-void ReosTelemac2DSimulationProcess::extractInformation( const  QRegularExpressionMatch &blockMatch )
+void ReosTelemac2DSimulationProcess::closeIterationBlock()
 {
-  QString timeString = blockMatch.captured( 2 );
-  QStringList splited = timeString.split( ' ' );
-  double time = 0;
-  if ( splited.count() > 1 && splited.last().contains( 'S' ) )
-    time = splited.at( splited.count() - 2 ).toDouble();
+  if ( !mInIterationBlock )
+    return;
+  mInIterationBlock = false;
+
+  if ( mIterationTime - mCurrentTime <= mTimeStep.valueSecond() )
+    return;
 
-  if ( time - mCurrentTime > mTimeStep.valueSecond() )
+  const qint64 relativeTime = qint64( mIterationTime * 1000 );
+  for ( const QPair<int, double> &flow : std::as_const( mIterationFlows ) )
   {
-    const QString &blockString = blockMatch.captured( 1 );
-    QRegularExpressionMatchIterator it = mBoundaryFlowRegEx.globalMatch( blockString );
+    const BoundaryCondition bc = mBoundaries.value( flow.first );
+    if ( bc.boundaryId.isEmpty() )
+      continue;
 
-    QStringList ids;
-    QList<double> flows;
-    while ( it.hasNext() )
+    double value = flow.second;
+    switch ( bc.type )
     {
-      const QRegularExpressionMatch match = it.next();
-      if ( match.lastCapturedIndex() != 2 )
-        continue;
-      bool ok;
-      int boundRank = match.captured( 1 ).toInt( &ok );
-      if ( !ok )
-        continue;
+      case ReosHydraulicStructureBoundaryCondition::Type::NotDefined:
+      case ReosHydraulicStructureBoundaryCondition::Type::InputFlow:
+        break;
+      case ReosHydraulicStructureBoundaryCondition::Type::OutputLevel:
+        value = -value;
+        break;
+    }
 
-      double value = match.captured( 2 ).toDouble( &ok );
-      if ( !ok )
-        continue;
+    int index = mFlowBatch.boundaryIds.indexOf( bc.boundaryId );
+    if ( index < 0 )
+    {
+      index = mFlowBatch.boundaryIds.count();
+      mFlowBatch.boundaryIds.append( bc.boundaryId );
+      mFlowBatch.relativeTimes.append( QVector<qint64>() );
+      mFlowBatch.values.append( QVector<double>() );
+    }
+    mFlowBatch.relativeTimes[index].append( relativeTime );
+    mFlowBatch.values[index].append( value );
+  }
 
-      BoundaryCondition bc = mBoundaries.value( boundRank );
-      ids.append( bc.boundaryId );
+  mPendingInformation = mIterationHeader;
+  setCurrentProgression( int( mIterationTime * 100.0 / mTotalTime ) );
+  mCurrentTime = mCurrentTime + mTimeStep.valueSecond();
+}
 
-      switch ( bc.type )
-      {
-        case ReosHydraulicStructureBoundaryCondition::Type::NotDefined:
-        case ReosHydraulicStructureBoundaryCondition::Type::InputFlow:
-          break;
-        case ReosHydraulicStructureBoundaryCondition::Type::OutputLevel:
-          value = -value;
-          break;
-      }
-      flows.append( value );
-    }
+void ReosTelemac2DSimulationProcess::sendFlowBatch()
+{
+  if ( !mFlowBatch.boundaryIds.isEmpty() )
+    emit sendBoundaryFlows( mFlowBatch.boundaryIds, mFlowBatch.relativeTimes, mFlowBatch.values );
+  mFlowBatch = FlowBatch();
 
-    emit sendBoundaryFlow( mStartTime.addMSecs( qint64( time * 1000 ) ), ids, flows );
+  if ( !mPendingInformation.isEmpty() )
+    emit sendInformation( mPendingInformation );
+  mPendingInformation.clear();
 
-    setCurrentProgression( int( time * 100.0 / mTotalTime ) );
-    emit sendInformation( timeString );
-    mCurrentTime = mCurrentTime + mTimeStep.valueSecond();
-  }
+  mBatchTimer.restart();
 }
@@ -16,7 +16,7 @@
 #ifndef REOSTELEMAC2DSIMULATION_H
 #define REOSTELEMAC2DSIMULATION_H
 
-#include <QRegularExpression>
+#include <QElapsedTimer>
 
 #include "reoshydraulicsimulation.h"
 #include "reoshydraulicstructureboundarycondition.h"
@@ -53,8 +53,8 @@ class ReosTelemac2DSimulation : public ReosHydraulicSimulation
 
     QString key() const override {return ReosTelemac2DSimulation::staticKey();}
     QString directoryName() const override {return  QStringLiteral( "TELEMAC" );}
-    void prepareInput( ReosHydraulicStructure2D *hydraulicStructure, const ReosCalculationContext &calculationContext ) override;
-    void prepareInput( ReosHydraulicStructure2D *hydraulicStructure, const ReosCalculationContext &calculationContext, const QDir &directory ) override;
+    bool prepareInput( ReosHydraulicStructure2D *hydraulicStructure, const ReosCalculationContext &calculationContext ) override;
+    bool prepareInput( ReosHydraulicStructure2D *hydraulicStructure, const ReosCalculationContext &calculationContext, const QDir &directory ) override;
     virtual ReosSimulationProcess *getProcess( ReosHydraulicStructure2D *hydraulicStructure, const ReosCalculationContext &calculationContext ) const override;
     ReosEncodedElement encode() const override;
 
@@ -92,11 +92,8 @@ class ReosTelemac2DSimulation : public ReosHydraulicSimulation
       QVector<int> &verticesPosInBoundary,
       const QDir &directory );
 
-    void createSelafinMeshFrame( ReosHydraulicStructure2D *hydraulicStructure,
-                                 const QVector<int> &verticesPosInBoundary,
-                                 const QDir &directory );
-
-    void createSelafinInputGeometry( ReosHydraulicStructure2D *hydraulicStructure,
+    //! Writes the geometry file with the mesh, the bottom and the friction, returns false and removes the file if it can't be written
+    bool createSelafinInputGeometry( ReosHydraulicStructure2D *hydraulicStructure,
                                      const QVector<int> &verticesPosInBoundary,
                                      const QDir &directory );
 
@@ -135,12 +132,22 @@ class ReosTelemac2DSimulationProcess : public ReosSimulationProcess
     void onStopAsked();
 
   private:
+    //! Flows of the boundaries not sent yet
+    struct FlowBatch
+    {
+      QStringList boundaryIds;
+      QList<QVector<qint64>> relativeTimes;
+      QList<QVector<double>> values;
+    };
+
     QString mSimulationFilePath;
     QProcess *mProcess = nullptr;
+
+    //! Output since the beginning of the last iteration block, sent when the process is finished
     QString mStandartOutputBuffer;
-    QRegularExpression mTimeRegEx;
-    QRegularExpression mBlockRegEx;
-    QRegularExpression mBoundaryFlowRegEx;
+    //! Last line of the output not terminated yet
+    QString mPendingLine;
+
     bool mIsPreparation = false;
     double mCurrentTime = 0;
     double mTotalTime = 0;
@@ -148,8 +155,20 @@ class ReosTelemac2DSimulationProcess : public ReosSimulationProcess
     ReosDuration mTimeStep;
     const QMap<int, BoundaryCondition> mBoundaries;
 
+    // current iteration block
+    bool mInIterationBlock = false;
+    double mIterationTime = 0;
+    QString mIterationHeader;
+    QList<QPair<int, double>> mIterationFlows;
+
+    FlowBatch mFlowBatch;
+    QString mPendingInformation;
+    QElapsedTimer mBatchTimer;
+
     void addToOutput( const QString &txt );
-    void extractInformation( const QRegularExpressionMatch &blockMatch );
+    void processLine( const QString &line );
+    void closeIterationBlock();
+    void sendFlowBatch();
 };
 
 class ReosTelemac2DSimulationEngineFactory : public ReosSimulationEngineFactory
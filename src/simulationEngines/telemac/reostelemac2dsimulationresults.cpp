@@ -20,36 +20,86 @@
 #include <QDateTime>
 #include <QFileInfo>
 #include <QDir>
+#include <QDataStream>
 
 #include "reosduration.h"
 #include "reostelemac2dsimulation.h"
 #include "reosmesh.h"
+#include "reostelemacselafinreader.h"
+#include "reosprocess.h"
+
+// size in bytes of the cache of active faces
+#define ACTIVE_FACES_CACHE_BUDGET (64 << 20)
+
+//! Process that calculates the minimum and maximum of all the frames of the results, with only one pass on the file
+class ReosTelemacMinMaxProcess : public ReosProcess
+{
+  public:
+    ReosTelemacMinMaxProcess( const std::shared_ptr<ReosTelemacSelafinReader> &reader, const QList<QPair<int, int>> &vectors )
+      : mReader( reader )
+      , mVectors( vectors )
+    {}
+
+    void start() override
+    {
+      mReader->calculateMinMax( mVectors );
+      mIsSuccessful = true;
+    }
+
+  private:
+    // shared with the results, so the process can finish if the results are deleted before
+    std::shared_ptr<ReosTelemacSelafinReader> mReader;
+    QList<QPair<int, int>> mVectors;
+};
 
 ReosTelemac2DSimulationResults::ReosTelemac2DSimulationResults( const ReosTelemac2DSimulation *simulation, const ReosMesh *mesh, const QString &fileName, QObject *parent )
   : ReosHydraulicSimulationResults( simulation, parent )
   , mFileName( fileName )
+  , mReader( new ReosTelemacSelafinReader( fileName ) )
 {
-  QByteArray curi = fileName.toUtf8();
-  mMeshH = MDAL_LoadMesh( curi.constData() );
+  mActiveFacesCache.setMaxCost( ACTIVE_FACES_CACHE_BUDGET );
 
-  if ( !mMeshH )
+  if ( !mReader->isValid() )
     return;
 
-  int groupCount = MDAL_M_datasetGroupCount( mMeshH );
+  const int velocityIndex = mReader->variableIndex( {QStringLiteral( "VELOCITY U" ), QStringLiteral( "VITESSE U" )} );
+  mVelocityYIndex = mReader->variableIndex( {QStringLiteral( "VELOCITY V" ), QStringLiteral( "VITESSE V" )} );
+  if ( velocityIndex >= 0 && mVelocityYIndex >= 0 )
+    mTypeToTelemacVariableIndex[DatasetType::Velocity] = velocityIndex;
+
+  const int waterDepthIndex = mReader->variableIndex( {QStringLiteral( "WATER DEPTH" ), QStringLiteral( "HAUTEUR D'EAU" )} );
+  if ( waterDepthIndex >= 0 )
+    mTypeToTelemacVariableIndex[DatasetType::WaterDepth] = waterDepthIndex;
+
+  const int waterLevelIndex = mReader->variableIndex( {QStringLiteral( "FREE SURFACE" ), QStringLiteral( "SURFACE LIBRE" )} );
+  if ( waterLevelIndex >= 0 )
+    mTypeToTelemacVariableIndex[DatasetType::WaterLevel] = waterLevelIndex;
 
-  for ( int i = 0; i < groupCount; ++i )
+  // derived datasets do not have variable in the file, they are read from the cache file or calculated on first request
+  if ( waterDepthIndex >= 0 )
   {
-    MDAL_DatasetGroupH group = MDAL_M_datasetGroup( mMeshH, i );
-    QString groupName( MDAL_G_name( group ) );
-    if ( groupName == QStringLiteral( "velocity      ms" ) )
-      mTypeToTelemacGroupIndex[DatasetType::Velocity] = i;
-    else if ( groupName == QStringLiteral( "water depth     m" ) )
-      mTypeToTelemacGroupIndex[DatasetType::WaterDepth] = i;
-    else if ( groupName == QStringLiteral( "free surface    m" ) )
-      mTypeToTelemacGroupIndex[DatasetType::WaterLevel] = i;
+    mTypeToTelemacVariableIndex[DatasetType::MaximumWaterDepth] = -1;
+    mTypeToTelemacVariableIndex[DatasetType::TimeOfArrival] = -1;
+    mTypeToTelemacVariableIndex[DatasetType::InundationDuration] = -1;
+    if ( mTypeToTelemacVariableIndex.contains( DatasetType::Velocity ) )
+    {
+      mTypeToTelemacVariableIndex[DatasetType::MaximumVelocity] = -1;
+      mTypeToTelemacVariableIndex[DatasetType::MaximumHazard] = -1;
+    }
   }
 
-  mCache.resize( datasetCount( mTypeToTelemacGroupIndex.value( DatasetType::WaterDepth ) ) );
+  // minimum and maximum of all datasets are calculated once for all, with only one pass on the file on another thread
+  QList<QPair<int, int>> vectors;
+  if ( mTypeToTelemacVariableIndex.contains( DatasetType::Velocity ) )
+    vectors.append( QPair<int, int>( velocityIndex, mVelocityYIndex ) );
+  ReosProcess *minMaxProcess = new ReosTelemacMinMaxProcess( mReader, vectors );
+  connect( minMaxProcess, &ReosProcess::finished, minMaxProcess, &QObject::deleteLater );
+  connect( minMaxProcess, &ReosProcess::finished, this, [this]
+  {
+    mMinMaxCalculated = true;
+    emit minimumMaximumChanged();
+  } );
+  minMaxProcess->startOnOtherThread();
 
   QgsMeshLayer *meshLayer = qobject_cast<QgsMeshLayer *>( mesh->data() );
   if ( meshLayer )
@@ -73,15 +123,11 @@ ReosTelemac2DSimulationResults::ReosTelemac2DSimulationResults( const ReosTelema
   }
 }
 
-ReosTelemac2DSimulationResults::~ReosTelemac2DSimulationResults()
-{
-  if ( mMeshH )
-    MDAL_CloseMesh( mMeshH );
-}
+ReosTelemac2DSimulationResults::~ReosTelemac2DSimulationResults() = default;
 
 int ReosTelemac2DSimulationResults::groupCount() const
 {
-  return mTypeToTelemacGroupIndex.count();
+  return mTypeToTelemacVariableIndex.count();
 }
 
 int ReosTelemac2DSimulationResults::datasetCount( int groupIndex ) const
@@ -89,14 +135,10 @@ int ReosTelemac2DSimulationResults::datasetCount( int groupIndex ) const
   if ( groupIndex < 0 || groupIndex >= groupCount() )
     return 0;
 
-  DatasetType dt = datasetType( groupIndex );
-
-  MDAL_DatasetGroupH group = MDAL_M_datasetGroup( mMeshH, mTypeToTelemacGroupIndex.value( dt ) );
+  if ( isDerived( datasetType( groupIndex ) ) )
+    return 1;
 
-  if ( group )
-    return MDAL_G_datasetCount( group );
-  else
-    return 0;
+  return mReader->frameCount();
 }
 
 ReosHydraulicSimulationResults::DatasetType ReosTelemac2DSimulationResults::datasetType( int groupIndex ) const
@@ -104,25 +146,28 @@ ReosHydraulicSimulationResults::DatasetType ReosTelemac2DSimulationResults::data
   if ( groupIndex < 0 || groupIndex >= groupCount() )
     return DatasetType::WaterLevel;
 
-  return mTypeToTelemacGroupIndex.keys().at( groupIndex );
+  return mTypeToTelemacVariableIndex.keys().at( groupIndex );
 }
 
 void ReosTelemac2DSimulationResults::groupMinMax( int groupIndex, double &minimum, double &maximum ) const
 {
-  if ( groupIndex < 0 || groupIndex >= groupCount() )
-    return;
-
-  DatasetType dt = datasetType( groupIndex );
-  int telemacIndex = mTypeToTelemacGroupIndex.value( dt );
   minimum = std::numeric_limits<double>::quiet_NaN();
   maximum = std::numeric_limits<double>::quiet_NaN();
 
-  MDAL_DatasetGroupH group = MDAL_M_datasetGroup( mMeshH, telemacIndex );
-
-  if ( !group )
+  if ( groupIndex < 0 || groupIndex >= groupCount() )
     return;
 
-  MDAL_G_minimumMaximum( group, &minimum, &maximum );
+  const int count = datasetCount( groupIndex );
+  for ( int i = 0; i < count; ++i )
+  {
+    double datasetMinimum = 0;
+    double datasetMaximum = 0;
+    datasetMinMax( groupIndex, i, datasetMinimum, datasetMaximum );
+    if ( std::isnan( minimum ) || datasetMinimum < minimum )
+      minimum = datasetMinimum;
+    if ( std::isnan( maximum ) || datasetMaximum > maximum )
+      maximum = datasetMaximum;
+  }
 }
 
 QDateTime ReosTelemac2DSimulationResults::groupReferenceTime( int groupIndex ) const
@@ -130,23 +175,7 @@ QDateTime ReosTelemac2DSimulationResults::groupReferenceTime( int groupIndex ) c
   if ( groupIndex < 0 || groupIndex >= groupCount() )
     return QDateTime();
 
-  if ( mReferenceTime.isValid() )
-    return mReferenceTime;
-
-  DatasetType dt = datasetType( groupIndex );
-  int telemacIndex = mTypeToTelemacGroupIndex.value( dt );
-
-  MDAL_DatasetGroupH group = MDAL_M_datasetGroup( mMeshH, telemacIndex );
-
-  if ( !group )
-    return QDateTime();
-
-  QString referenceTimeString( MDAL_G_referenceTime( group ) );
-  if ( !referenceTimeString.isEmpty() )
-    referenceTimeString.append( 'Z' );//For now provider doesn't support time zone and return always in local time, force UTC
-
-  mReferenceTime = QDateTime::fromString( referenceTimeString, Qt::ISODate );
-  return mReferenceTime;
+  return mReader->referenceTime();
 }
 
 ReosDuration ReosTelemac2DSimulationResults::datasetRelativeTime( int groupIndex, int datasetIndex ) const
@@ -154,6 +183,9 @@ ReosDuration ReosTelemac2DSimulationResults::datasetRelativeTime( int groupIndex
   if ( groupIndex < 0 || groupIndex >= groupCount() )
     return ReosDuration();
 
+  if ( isDerived( datasetType( groupIndex ) ) )
+    return ReosDuration();
+
   if ( mTimeToTimeStep.isEmpty() )
     populateTimeStep();
 
@@ -165,41 +197,40 @@ bool ReosTelemac2DSimulationResults::datasetIsValid( int groupIndex, int dataset
   if ( groupIndex < 0 || groupIndex >= groupCount() )
     return false;
 
-  DatasetType dt = datasetType( groupIndex );
-  int telemacIndex = mTypeToTelemacGroupIndex.value( dt );
-
-  MDAL_DatasetGroupH group = MDAL_M_datasetGroup( mMeshH, telemacIndex );
-
-  if ( !group )
-    return false;
-
-  MDAL_DatasetH dataset = MDAL_G_dataset( group, datasetIndex );
-  if ( !dataset )
-    return false;
-
-  return MDAL_D_isValid( dataset );
+  return datasetIndex >= 0 && datasetIndex < datasetCount( groupIndex );
 }
 
 void ReosTelemac2DSimulationResults::datasetMinMax( int groupIndex, int datasetIndex, double &min, double &max ) const
 {
-  if ( groupIndex < 0 || groupIndex >= groupCount() )
-    return;
-
-  DatasetType dt = datasetType( groupIndex );
-  int telemacIndex = mTypeToTelemacGroupIndex.value( dt );
   min = std::numeric_limits<double>::quiet_NaN();
   max = std::numeric_limits<double>::quiet_NaN();
 
-  MDAL_DatasetGroupH group = MDAL_M_datasetGroup( mMeshH, telemacIndex );
+  if ( groupIndex < 0 || groupIndex >= groupCount() )
+    return;
 
-  if ( !group )
+  DatasetType dt = datasetType( groupIndex );
+  if ( isDerived( dt ) )
+  {
+    // derived datasets are calculated on the first request of their values, unknown before
+    if ( datasetIndex != 0 || !mDerivedDatasetsCalculated )
+      return;
+    const QPair<double, double> derivedMinMax = mDerivedMinMax.value( dt, QPair<double, double>( min, max ) );
+    min = derivedMinMax.first;
+    max = derivedMinMax.second;
     return;
+  }
 
-  MDAL_DatasetH dataset = MDAL_G_dataset( group, datasetIndex );
-  if ( !dataset )
+  if ( !mMinMaxCalculated )
     return;
 
-  MDAL_D_minimumMaximum( dataset, &min, &max );
+  ReosTelemacSelafinReader::MinMax minMax;
+  if ( dt == DatasetType::Velocity )
+    minMax = mReader->vectorMinMax( 0, datasetIndex );
+  else
+    minMax = mReader->minMax( mTypeToTelemacVariableIndex.value( dt ), datasetIndex );
+
+  min = minMax.minimum;
+  max = minMax.maximum;
 }
 
 QVector<double> ReosTelemac2DSimulationResults::datasetValues( int groupIndex, int index ) const
@@ -208,53 +239,30 @@ QVector<double> ReosTelemac2DSimulationResults::datasetValues( int groupIndex, i
     return QVector<double>();
 
   DatasetType dt = datasetType( groupIndex );
-
-  switch ( dt )
+  if ( isDerived( dt ) )
   {
-    case ReosHydraulicSimulationResults::DatasetType::WaterLevel:
-      break;
-    case ReosHydraulicSimulationResults::DatasetType::WaterDepth:
-      if ( !mCache.at( index ).waterDepth.isEmpty() )
-        return mCache.at( index ).waterDepth;
-      break;
-    case ReosHydraulicSimulationResults::DatasetType::Velocity:
-      break;
+    if ( index != 0 )
+      return QVector<double>();
+    loadDerivedDatasets();
+    return mDerivedValues.value( dt );
   }
 
-  int telemacIndex = mTypeToTelemacGroupIndex.value( dt );
+  int variableIndex = mTypeToTelemacVariableIndex.value( dt );
 
-  MDAL_DatasetGroupH group = MDAL_M_datasetGroup( mMeshH, telemacIndex );
+  if ( dt != DatasetType::Velocity )
+    return mReader->values( variableIndex, index );
 
-  if ( !group )
+  // components are cached separately by the reader, only the interleaving is done here
+  const QVector<double> valuesX = mReader->values( variableIndex, index );
+  const QVector<double> valuesY = mReader->values( mVelocityYIndex, index );
+  if ( valuesX.count() != valuesY.count() )
     return QVector<double>();
 
-  if ( index >= MDAL_G_datasetCount( group ) )
-    return QVector<double>();
-
-  MDAL_DatasetH dataset = MDAL_G_dataset( group, index );
-  bool isScalar = MDAL_G_hasScalarData( group );
-  int valueCount = MDAL_D_valueCount( dataset );
-
-  QVector<double> ret;
-  ret.resize( valueCount * ( isScalar ? 1 : 2 ) );
-
-  int effectiveValueCount = MDAL_D_data( dataset,
-                                         0,
-                                         valueCount,
-                                         isScalar ? MDAL_DataType::SCALAR_DOUBLE : MDAL_DataType::VECTOR_2D_DOUBLE,
-                                         ret.data() );
-
-  Q_ASSERT( valueCount == effectiveValueCount );
-
-  switch ( dt )
+  QVector<double> ret( valuesX.count() * 2 );
+  for ( int i = 0; i < valuesX.count(); ++i )
   {
-    case ReosHydraulicSimulationResults::DatasetType::WaterLevel:
-      break;
-    case ReosHydraulicSimulationResults::DatasetType::WaterDepth:
-      mCache[index].waterDepth = ret;
-      break;
-    case ReosHydraulicSimulationResults::DatasetType::Velocity:
-      break;
+    ret[2 * i] = valuesX.at( i );
+    ret[2 * i + 1] = valuesY.at( i );
   }
 
   return ret;
@@ -262,36 +270,99 @@ QVector<double> ReosTelemac2DSimulationResults::datasetValues( int groupIndex, i
 
 QVector<int> ReosTelemac2DSimulationResults::activeFaces( int index ) const
 {
-  if ( index >= mCache.count() )
+  if ( index < 0 || index >= mReader->frameCount() )
     return QVector<int>();
 
-  if ( mCache.at( index ).activeFaces.isEmpty() )
   {
-    if ( mCache.at( index ).waterDepth.isEmpty() )
-    {
-      mCache[index].waterDepth = datasetValues( mTypeToTelemacGroupIndex.value( DatasetType::WaterDepth ), index );
-    }
+    QMutexLocker locker( &mActiveFacesMutex );
+    if ( const QVector<int> *cached = mActiveFacesCache.object( index ) )
+      return *cached;
+  }
 
-    const QVector<double> &waterDepth = mCache.at( index ).waterDepth;
-    QVector<int> &active = mCache[index].activeFaces;
-    active.resize( mFaces.count() );
+  const QVector<double> waterDepth = datasetValues( groupIndex( DatasetType::WaterDepth ), index );
+  if ( waterDepth.isEmpty() )
+    return QVector<int>();
 
-    for ( int i = 0; i < active.count(); ++i )
+  QVector<int> active( mFaces.count() );
+  for ( int i = 0; i < active.count(); ++i )
+  {
+    const QVector<int> &face = mFaces.at( i );
+    active[i] = 0;
+    for ( int f : face )
     {
-      const QVector<int> &face = mFaces.at( i );
-      active[i] = 0;
-      for ( int f : face )
+      if ( waterDepth.at( f ) > mDryDepthValue )
       {
-        if ( waterDepth.at( f ) > mDryDepthValue )
-        {
-          active[i] = 1;
-          break;
-        }
+        active[i] = 1;
+        break;
       }
     }
   }
 
-  return mCache.at( index ).activeFaces;
+  QMutexLocker locker( &mActiveFacesMutex );
+  mActiveFacesCache.insert( index, new QVector<int>( active ), active.count() * sizeof( int ) );
+
+  return active;
+}
+
+bool ReosTelemac2DSimulationResults::datasetValuesOnVertices( int groupIndex, int index, int vertexIndex, int vertexCount, double *values ) const
+{
+  if ( groupIndex < 0 || groupIndex >= groupCount() || vertexIndex < 0 )
+    return false;
+
+  DatasetType dt = datasetType( groupIndex );
+  if ( isDerived( dt ) )
+  {
+    if ( index != 0 )
+      return false;
+    loadDerivedDatasets();
+    const QVector<double> derivedValues = mDerivedValues.value( dt );
+    if ( vertexIndex + vertexCount > derivedValues.count() )
+      return false;
+    std::copy( derivedValues.constBegin() + vertexIndex, derivedValues.constBegin() + vertexIndex + vertexCount, values );
+    return true;
+  }
+
+  int variableIndex = mTypeToTelemacVariableIndex.value( dt );
+
+  if ( dt != DatasetType::Velocity )
+    return mReader->readValues( variableIndex, index, vertexIndex, vertexCount, values );
+
+  QVector<double> valuesX( vertexCount );
+  QVector<double> valuesY( vertexCount );
+  if ( !mReader->readValues( variableIndex, index, vertexIndex, vertexCount, valuesX.data() ) ||
+       !mReader->readValues( mVelocityYIndex, index, vertexIndex, vertexCount, valuesY.data() ) )
+    return false;
+
+  for ( int i = 0; i < vertexCount; ++i )
+  {
+    values[2 * i] = valuesX.at( i );
+    values[2 * i + 1] = valuesY.at( i );
+  }
+
+  return true;
+}
+
+bool ReosTelemac2DSimulationResults::faceIsActive( int index, int faceIndex ) const
+{
+  if ( index < 0 || index >= mReader->frameCount() || faceIndex < 0 || faceIndex >= mFaces.count() )
+    return false;
+
+  {
+    QMutexLocker locker( &mActiveFacesMutex );
+    if ( const QVector<int> *cached = mActiveFacesCache.object( index ) )
+      return cached->at( faceIndex ) != 0;
+  }
+
+  const int depthVariableIndex = mTypeToTelemacVariableIndex.value( DatasetType::WaterDepth, -1 );
+  const QVector<int> &face = mFaces.at( faceIndex );
+  for ( int f : face )
+  {
+    double depth = 0;
+    if ( mReader->readValues( depthVariableIndex, index, f, 1, &depth ) && depth > mDryDepthValue )
+      return true;
+  }
+
+  return false;
 }
 
 QDateTime ReosTelemac2DSimulationResults::runDateTime() const
@@ -307,6 +378,9 @@ QMap<QString, ReosHydrograph *> ReosTelemac2DSimulationResults::outputHydrograph
 
 int ReosTelemac2DSimulationResults::datasetIndexClosestBeforeTime( int groupIndex, const QDateTime &time ) const
 {
+  if ( isDerived( datasetType( groupIndex ) ) )
+    return 0;
+
   ReosDuration relativeTime( groupReferenceTime( groupIndex ).msecsTo( time ) );
 
   if ( mTimeToTimeStep.isEmpty() )
@@ -338,6 +412,21 @@ QString ReosTelemac2DSimulationResults::unitString( ReosHydraulicSimulationResul
     case ReosHydraulicSimulationResults::DatasetType::Velocity:
       return tr( " m/s" );
       break;
+    case ReosHydraulicSimulationResults::DatasetType::MaximumWaterDepth:
+      return tr( "m" );
+      break;
+    case ReosHydraulicSimulationResults::DatasetType::MaximumVelocity:
+      return tr( " m/s" );
+      break;
+    case ReosHydraulicSimulationResults::DatasetType::MaximumHazard:
+      return tr( "m²/s" );
+      break;
+    case ReosHydraulicSimulationResults::DatasetType::TimeOfArrival:
+      return tr( "h" );
+      break;
+    case ReosHydraulicSimulationResults::DatasetType::InundationDuration:
+      return tr( "h" );
+      break;
   }
 
   return QString();
@@ -345,22 +434,11 @@ QString ReosTelemac2DSimulationResults::unitString( ReosHydraulicSimulationResul
 
 void ReosTelemac2DSimulationResults::populateTimeStep() const
 {
-  DatasetType dt = DatasetType::WaterLevel;
-  int telemacIndex = mTypeToTelemacGroupIndex.value( dt );
-
-  MDAL_DatasetGroupH group = MDAL_M_datasetGroup( mMeshH, telemacIndex );
-
-  if ( !group )
-    return;
-
-  int dsCount = mCache.count();
+  int dsCount = mReader->frameCount();
   mTimeSteps.resize( dsCount );
   for ( int i = 0; i < dsCount; ++i )
   {
-    MDAL_DatasetH dataset = MDAL_G_dataset( group, i );
-    if ( !dataset )
-      continue;
-    ReosDuration relativeTime = ReosDuration( MDAL_D_time( dataset ), ReosDuration::hour );
+    ReosDuration relativeTime = ReosDuration( mReader->frameTime( i ), ReosDuration::second );
     mTimeToTimeStep.insert( relativeTime, i );
     mTimeSteps[i] = relativeTime;
   }
@@ -368,6 +446,126 @@ void ReosTelemac2DSimulationResults::populateTimeStep() const
 
 int ReosTelemac2DSimulationResults::groupIndex( ReosHydraulicSimulationResults::DatasetType type ) const
 {
-  const QList<DatasetType> &types = mTypeToTelemacGroupIndex.keys();
+  const QList<DatasetType> &types = mTypeToTelemacVariableIndex.keys();
   return  types.indexOf( type );
 }
+
+QVector<int> ReosTelemac2DSimulationResults::groupActiveFaces( int groupIndex, int index ) const
+{
+  if ( !isDerived( datasetType( groupIndex ) ) )
+    return activeFaces( index );
+
+  if ( index != 0 )
+    return QVector<int>();
+
+  loadDerivedDatasets();
+  return mDerivedActiveFaces;
+}
+
+bool ReosTelemac2DSimulationResults::groupFaceIsActive( int groupIndex, int index, int faceIndex ) const
+{
+  if ( !isDerived( datasetType( groupIndex ) ) )
+    return faceIsActive( index, faceIndex );
+
+  if ( index != 0 || faceIndex < 0 )
+    return false;
+
+  loadDerivedDatasets();
+  return faceIndex < mDerivedActiveFaces.count() && mDerivedActiveFaces.at( faceIndex ) != 0;
+}
+
+bool ReosTelemac2DSimulationResults::isDerived( ReosHydraulicSimulationResults::DatasetType type )
+{
+  switch ( type )
+  {
+    case DatasetType::MaximumWaterDepth:
+    case DatasetType::MaximumVelocity:
+    case DatasetType::MaximumHazard:
+    case DatasetType::TimeOfArrival:
+    case DatasetType::InundationDuration:
+      return true;
+    default:
+      return false;
+  }
+}
+
+QString ReosTelemac2DSimulationResults::derivedDatasetsFilePath() const
+{
+  // named after the results file, so results of different runs in the same directory have their own envelopes
+  const QFileInfo fileInfo( mFileName );
+  return fileInfo.dir().filePath( fileInfo.completeBaseName() + QStringLiteral( ".envelopes" ) );
+}
+
+void ReosTelemac2DSimulationResults::loadDerivedDatasets() const
+{
+  {
+    QMutexLocker locker( &mDerivedDatasetsMutex );
+    if ( mDerivedDatasetsLoaded )
+      return;
+
+    mDerivedDatasetsLoaded = true;
+
+    const QString envelopesFilePath = derivedDatasetsFilePath();
+    ReosTelemacSelafinReader::Envelopes envelopes;
+    if ( !mReader->readEnvelopes( envelopesFilePath, mDryDepthValue, envelopes ) )
+    {
+      const int depthIndex = mTypeToTelemacVariableIndex.value( DatasetType::WaterDepth, -1 );
+      const int velocityIndex = mTypeToTelemacVariableIndex.value( DatasetType::Velocity, -1 );
+      envelopes = mReader->calculateEnvelopes( depthIndex, velocityIndex, velocityIndex >= 0 ? mVelocityYIndex : -1, mDryDepthValue );
+      mReader->writeEnvelopes( envelopesFilePath, envelopes, mDryDepthValue );
+    }
+
+    // times are stored in hours
+    for ( double &time : envelopes.arrivalTime )
+      time /= 3600;
+    for ( double &duration : envelopes.inundationDuration )
+      duration /= 3600;
+
+    mDerivedValues.insert( DatasetType::MaximumWaterDepth, envelopes.maximumDepth );
+    mDerivedValues.insert( DatasetType::TimeOfArrival, envelopes.arrivalTime );
+    mDerivedValues.insert( DatasetType::InundationDuration, envelopes.inundationDuration );
+    if ( mTypeToTelemacVariableIndex.contains( DatasetType::MaximumVelocity ) )
+    {
+      mDerivedValues.insert( DatasetType::MaximumVelocity, envelopes.maximumVelocity );
+      mDerivedValues.insert( DatasetType::MaximumHazard, envelopes.maximumHazard );
+    }
+
+    for ( auto it = mDerivedValues.constBegin(); it != mDerivedValues.constEnd(); ++it )
+    {
+      double minimum = std::numeric_limits<double>::quiet_NaN();
+      double maximum = std::numeric_limits<double>::quiet_NaN();
+      for ( double value : it.value() )
+      {
+        if ( std::isnan( value ) )
+          continue;
+        if ( std::isnan( minimum ) || value < minimum )
+          minimum = value;
+        if ( std::isnan( maximum ) || value > maximum )
+          maximum = value;
+      }
+      mDerivedMinMax.insert( it.key(), QPair<double, double>( minimum, maximum ) );
+    }
+
+    // a face is active for the derived datasets if it has been wet at least once
+    const QVector<double> maximumDepth = mDerivedValues.value( DatasetType::MaximumWaterDepth );
+    mDerivedActiveFaces.resize( maximumDepth.isEmpty() ? 0 : mFaces.count() );
+    for ( int i = 0; i < mDerivedActiveFaces.count(); ++i )
+    {
+      const QVector<int> &face = mFaces.at( i );
+      mDerivedActiveFaces[i] = 0;
+      for ( int f : face )
+      {
+        if ( f < maximumDepth.count() && maximumDepth.at( f ) > mDryDepthValue )
+        {
+          mDerivedActiveFaces[i] = 1;
+          break;
+        }
+      }
+    }
+
+    mDerivedDatasetsCalculated = true;
+  }
+
+  // the values can be loaded from the rendering thread, the signal is then queued to the receivers
+  emit const_cast<ReosTelemac2DSimulationResults *>( this )->minimumMaximumChanged();
+}
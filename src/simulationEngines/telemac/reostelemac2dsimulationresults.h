@@ -16,21 +16,19 @@
 #ifndef REOSTELEMAC2DSIMULATIONRESULTS_H
 #define REOSTELEMAC2DSIMULATIONRESULTS_H
 
-#include <mdal.h>
+#include <atomic>
+#include <memory>
 #include <QMap>
 #include <QDateTime>
+#include <QCache>
+#include <QMutex>
 
 #include "reoshydraulicsimulationresults.h"
 
 class ReosTelemac2DSimulation;
+class ReosTelemacSelafinReader;
 class ReosMesh;
 
-struct CacheDataset
-{
-  QVector<int> activeFaces;
-  QVector<double> waterDepth;
-};
-
 class ReosTelemac2DSimulationResults : public ReosHydraulicSimulationResults
 {
   public:
@@ -48,25 +46,45 @@ class ReosTelemac2DSimulationResults : public ReosHydraulicSimulationResults
     void datasetMinMax( int groupIndex, int datasetIndex, double &min, double &max ) const override;
     QVector<double> datasetValues( int groupIndex, int index ) const override;
     QVector<int> activeFaces( int index ) const override;
+    bool datasetValuesOnVertices( int groupIndex, int index, int vertexIndex, int vertexCount, double *values ) const override;
+    bool faceIsActive( int index, int faceIndex ) const override;
     QDateTime runDateTime() const override;
     QMap<QString, ReosHydrograph *> outputHydrographs() const override;
     int datasetIndexClosestBeforeTime( int groupIndex, const QDateTime &time ) const override;
     QString unitString( DatasetType dataType ) const;
+    QVector<int> groupActiveFaces( int groupIndex, int index ) const override;
+    bool groupFaceIsActive( int groupIndex, int index, int faceIndex ) const override;
 
   private:
     QString mFileName;
-    MDAL_MeshH mMeshH = nullptr;
-    mutable QDateTime mReferenceTime;
-    QMap<DatasetType, int> mTypeToTelemacGroupIndex;
+    std::shared_ptr<ReosTelemacSelafinReader> mReader;
+    // minimum and maximum of the frames are calculated in a process on another thread, unknown before
+    std::atomic<bool> mMinMaxCalculated{false};
+    QMap<DatasetType, int> mTypeToTelemacVariableIndex; //for velocity, index of the first component
+    int mVelocityYIndex = -1;
     double mDryDepthValue = 0.015;
     QVector<QVector<int>> mFaces;
-    mutable QVector<CacheDataset> mCache;
+    mutable QMutex mActiveFacesMutex;
+    mutable QCache<int, QVector<int>> mActiveFacesCache;
     QMap<QString, ReosHydrograph *> mOutputHydrographs;
     mutable QMap<ReosDuration, int> mTimeToTimeStep;
     mutable QVector<ReosDuration> mTimeSteps;
 
+    // datasets derived from all the time steps, with only one dataset, read from a file next to the results or calculated on first request
+    mutable QMutex mDerivedDatasetsMutex;
+    mutable bool mDerivedDatasetsLoaded = false;
+    // minimum and maximum of the derived datasets are unknown until their values are requested
+    mutable std::atomic<bool> mDerivedDatasetsCalculated{false};
+    mutable QMap<DatasetType, QVector<double>> mDerivedValues;
+    mutable QMap<DatasetType, QPair<double, double>> mDerivedMinMax;
+    mutable QVector<int> mDerivedActiveFaces;
+
     void populateTimeStep() const;
 
+    static bool isDerived( DatasetType type );
+    QString derivedDatasetsFilePath() const;
+    void loadDerivedDatasets() const;
+
 };
 
 #endif // REOSTELEMAC2DSIMULATIONRESULTS_H
@@ -0,0 +1,633 @@
+/***************************************************************************
+  reostelemacselafinreader.cpp - ReosTelemacSelafinReader
+
+ ---------------------
+ begin                : 20.4.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "reostelemacselafinreader.h"
+
+#include <cstring>
+#include <cmath>
+#include <numeric>
+
+#include <QtEndian>
+#include <QtConcurrent>
+#include <QDataStream>
+#include <QFileInfo>
+
+#define ENVELOPES_FILE_HEADER QStringLiteral( "reos-telemac-envelopes" )
+#define ENVELOPES_FILE_VERSION 2
+
+static quint32 decodeUInt32( const uchar *data, bool bigEndian )
+{
+  return bigEndian ? qFromBigEndian<quint32>( data ) : qFromLittleEndian<quint32>( data );
+}
+
+static double decodeReal( const uchar *data, int precision, bool bigEndian )
+{
+  if ( precision == 8 )
+  {
+    const quint64 bits = bigEndian ? qFromBigEndian<quint64>( data ) : qFromLittleEndian<quint64>( data );
+    double value;
+    memcpy( &value, &bits, sizeof( double ) );
+    return value;
+  }
+
+  const quint32 bits = decodeUInt32( data, bigEndian );
+  float value;
+  memcpy( &value, &bits, sizeof( float ) );
+  return value;
+}
+
+ReosTelemacSelafinReader::ReosTelemacSelafinReader( const QString &fileName, qint64 cacheBudget )
+  : mFile( fileName )
+{
+  mCache.setMaxCost( static_cast<int>( std::min( cacheBudget, qint64( std::numeric_limits<int>::max() ) ) ) );
+
+  if ( !mFile.open( QIODevice::ReadOnly ) )
+    return;
+
+  mFileSize = mFile.size();
+
+  // if the file can't be mapped (address space too small), values are read with the file
+  mData = mFile.map( 0, mFileSize );
+
+  parseHeader();
+}
+
+ReosTelemacSelafinReader::~ReosTelemacSelafinReader()
+{
+  if ( mData )
+    mFile.unmap( const_cast<uchar *>( mData ) );
+}
+
+bool ReosTelemacSelafinReader::isValid() const
+{
+  return mIsValid;
+}
+
+bool ReosTelemacSelafinReader::isDoublePrecision() const
+{
+  return mPrecision == 8;
+}
+
+int ReosTelemacSelafinReader::vertexCount() const
+{
+  return mVertexCount;
+}
+
+int ReosTelemacSelafinReader::faceCount() const
+{
+  return mFaceCount;
+}
+
+int ReosTelemacSelafinReader::verticesPerFace() const
+{
+  return mVerticesPerFace;
+}
+
+QVector<int> ReosTelemacSelafinReader::connectivity() const
+{
+  QVector<int> ret( mFaceCount * mVerticesPerFace );
+  for ( int i = 0; i < ret.count(); ++i )
+    ret[i] = readInt( mConnectivityOffset + 4 * qint64( i ) ) - 1;
+
+  return ret;
+}
+
+int ReosTelemacSelafinReader::variableCount() const
+{
+  return mVariableNames.count();
+}
+
+QString ReosTelemacSelafinReader::variableName( int variableIndex ) const
+{
+  return mVariableNames.value( variableIndex );
+}
+
+QString ReosTelemacSelafinReader::variableUnit( int variableIndex ) const
+{
+  return mVariableUnits.value( variableIndex );
+}
+
+int ReosTelemacSelafinReader::variableIndex( const QStringList &names ) const
+{
+  for ( int i = 0; i < mVariableNames.count(); ++i )
+    for ( const QString &name : names )
+      if ( mVariableNames.at( i ).compare( name, Qt::CaseInsensitive ) == 0 )
+        return i;
+
+  return -1;
+}
+
+int ReosTelemacSelafinReader::frameCount() const
+{
+  return mFrameOffsets.count();
+}
+
+double ReosTelemacSelafinReader::frameTime( int frameIndex ) const
+{
+  return mFrameTimes.value( frameIndex, std::numeric_limits<double>::quiet_NaN() );
+}
+
+QDateTime ReosTelemacSelafinReader::referenceTime() const
+{
+  return mReferenceTime;
+}
+
+QVector<double> ReosTelemacSelafinReader::values( int variableIndex, int frameIndex ) const
+{
+  const qint64 key = cacheKey( variableIndex, frameIndex );
+  {
+    QMutexLocker locker( &mMutex );
+    if ( const QVector<double> *cached = mCache.object( key ) )
+      return *cached;
+  }
+
+  QVector<double> ret( mVertexCount );
+  if ( !decodeValues( variableIndex, frameIndex, 0, mVertexCount, ret.data() ) )
+    return QVector<double>();
+
+  const qint64 cost = qint64( mVertexCount ) * sizeof( double );
+  QMutexLocker locker( &mMutex );
+  if ( cost <= mCache.maxCost() )
+    mCache.insert( key, new QVector<double>( ret ), static_cast<int>( cost ) );
+
+  return ret;
+}
+
+bool ReosTelemacSelafinReader::readValues( int variableIndex, int frameIndex, int vertexIndex, int count, double *values ) const
+{
+  if ( vertexIndex < 0 || count < 0 || vertexIndex + count > mVertexCount )
+    return false;
+
+  {
+    QMutexLocker locker( &mMutex );
+    if ( const QVector<double> *cached = mCache.object( cacheKey( variableIndex, frameIndex ) ) )
+    {
+      std::copy( cached->constBegin() + vertexIndex, cached->constBegin() + vertexIndex + count, values );
+      return true;
+    }
+  }
+
+  return decodeValues( variableIndex, frameIndex, vertexIndex, count, values );
+}
+
+bool ReosTelemacSelafinReader::readValues( int variableIndex, int frameIndex, int vertexIndex, int count, float *values ) const
+{
+  return decodeValues( variableIndex, frameIndex, vertexIndex, count, values );
+}
+
+void ReosTelemacSelafinReader::calculateMinMax( const QList<QPair<int, int>> &vectors )
+{
+  const int variableCount = mVariableNames.count();
+  const int frameCount = mFrameOffsets.count();
+  mVectorCount = vectors.count();
+  mMinMax.fill( MinMax(), frameCount * variableCount );
+  mVectorMinMax.fill( MinMax(), frameCount * mVectorCount );
+
+  // frames are walked in the order of the file, values are decoded without being stored
+  QByteArray buffer;
+  QByteArray otherBuffer;
+  for ( int f = 0; f < frameCount; ++f )
+  {
+    for ( int v = 0; v < variableCount; ++v )
+    {
+      const uchar *data = encodedValues( v, f, 0, mVertexCount, buffer );
+      if ( !data )
+        continue;
+
+      double minimum = std::numeric_limits<double>::max();
+      double maximum = -std::numeric_limits<double>::max();
+      for ( int i = 0; i < mVertexCount; ++i )
+      {
+        const double value = decodeReal( data + qint64( i ) * mPrecision, mPrecision, mBigEndian );
+        if ( std::isnan( value ) )
+          continue;
+        minimum = std::min( minimum, value );
+        maximum = std::max( maximum, value );
+      }
+
+      if ( minimum <= maximum )
+        mMinMax[f * variableCount + v] = {minimum, maximum};
+    }
+
+    for ( int vi = 0; vi < mVectorCount; ++vi )
+    {
+      const uchar *dataX = encodedValues( vectors.at( vi ).first, f, 0, mVertexCount, buffer );
+      const uchar *dataY = encodedValues( vectors.at( vi ).second, f, 0, mVertexCount, otherBuffer );
+      if ( !dataX || !dataY )
+        continue;
+
+      double minimum = std::numeric_limits<double>::max();
+      double maximum = -std::numeric_limits<double>::max();
+      for ( int i = 0; i < mVertexCount; ++i )
+      {
+        const double x = decodeReal( dataX + qint64( i ) * mPrecision, mPrecision, mBigEndian );
+        const double y = decodeReal( dataY + qint64( i ) * mPrecision, mPrecision, mBigEndian );
+        const double magnitude = std::sqrt( x * x + y * y );
+        if ( std::isnan( magnitude ) )
+          continue;
+        minimum = std::min( minimum, magnitude );
+        maximum = std::max( maximum, magnitude );
+      }
+
+      if ( minimum <= maximum )
+        mVectorMinMax[f * mVectorCount + vi] = {minimum, maximum};
+    }
+  }
+}
+
+ReosTelemacSelafinReader::Envelopes ReosTelemacSelafinReader::calculateEnvelopes( int depthIndex, int velocityXIndex, int velocityYIndex, double wetDepth ) const
+{
+  Envelopes envelopes;
+  const int variableCount = mVariableNames.count();
+  const int frameCount = mFrameOffsets.count();
+  if ( depthIndex < 0 || depthIndex >= variableCount )
+    return envelopes;
+
+  const bool hasVelocity = velocityXIndex >= 0 && velocityXIndex < variableCount && velocityYIndex >= 0 && velocityYIndex < variableCount;
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+
+  envelopes.maximumDepth.fill( nan, mVertexCount );
+  envelopes.arrivalTime.fill( nan, mVertexCount );
+  envelopes.inundationDuration.fill( 0, mVertexCount );
+  if ( hasVelocity )
+  {
+    envelopes.maximumVelocity.fill( nan, mVertexCount );
+    envelopes.maximumHazard.fill( nan, mVertexCount );
+  }
+
+  double *maximumDepth = envelopes.maximumDepth.data();
+  double *arrivalTime = envelopes.arrivalTime.data();
+  double *inundationDuration = envelopes.inundationDuration.data();
+  double *maximumVelocity = envelopes.maximumVelocity.data();
+  double *maximumHazard = envelopes.maximumHazard.data();
+
+  const int chunkSize = 16384;
+  QVector<int> chunks( ( mVertexCount + chunkSize - 1 ) / chunkSize );
+  std::iota( chunks.begin(), chunks.end(), 0 );
+
+  // frames are walked in the order of the file, each chunk of vertices writes only its own values
+  QByteArray depthBuffer;
+  QByteArray xBuffer;
+  QByteArray yBuffer;
+  for ( int f = 0; f < frameCount; ++f )
+  {
+    const uchar *depthData = encodedValues( depthIndex, f, 0, mVertexCount, depthBuffer );
+    if ( !depthData )
+      continue;
+
+    const uchar *xData = hasVelocity ? encodedValues( velocityXIndex, f, 0, mVertexCount, xBuffer ) : nullptr;
+    const uchar *yData = hasVelocity ? encodedValues( velocityYIndex, f, 0, mVertexCount, yBuffer ) : nullptr;
+    const bool withVelocity = xData && yData;
+    const double time = mFrameTimes.at( f );
+    const double duration = f + 1 < frameCount ? mFrameTimes.at( f + 1 ) - time : 0;
+
+    QtConcurrent::blockingMap( chunks, [&]( int chunk )
+    {
+      const int end = std::min( mVertexCount, ( chunk + 1 ) * chunkSize );
+      for ( int i = chunk * chunkSize; i < end; ++i )
+      {
+        const double depth = decodeReal( depthData + qint64( i ) * mPrecision, mPrecision, mBigEndian );
+        if ( std::isnan( depth ) )
+          continue;
+
+        if ( std::isnan( maximumDepth[i] ) || depth > maximumDepth[i] )
+          maximumDepth[i] = depth;
+
+        if ( depth > wetDepth )
+        {
+          if ( std::isnan( arrivalTime[i] ) )
+            arrivalTime[i] = time;
+          inundationDuration[i] += duration;
+        }
+
+        if ( !withVelocity )
+          continue;
+
+        const double x = decodeReal( xData + qint64( i ) * mPrecision, mPrecision, mBigEndian );
+        const double y = decodeReal( yData + qint64( i ) * mPrecision, mPrecision, mBigEndian );
+        const double magnitude = std::sqrt( x * x + y * y );
+        if ( std::isnan( magnitude ) )
+          continue;
+
+        if ( std::isnan( maximumVelocity[i] ) || magnitude > maximumVelocity[i] )
+          maximumVelocity[i] = magnitude;
+
+        const double hazard = depth * magnitude;
+        if ( std::isnan( maximumHazard[i] ) || hazard > maximumHazard[i] )
+          maximumHazard[i] = hazard;
+      }
+    } );
+  }
+
+  return envelopes;
+}
+
+bool ReosTelemacSelafinReader::writeEnvelopes( const QString &fileName, const Envelopes &envelopes, double wetDepth ) const
+{
+  QFile file( fileName );
+  if ( !file.open( QIODevice::WriteOnly ) )
+    return false;
+
+  const QFileInfo resultsInfo( mFile.fileName() );
+  QDataStream stream( &file );
+  stream << ENVELOPES_FILE_HEADER
+         << qint32( ENVELOPES_FILE_VERSION )
+         << qint64( resultsInfo.size() )
+         << qint64( resultsInfo.lastModified().toMSecsSinceEpoch() )
+         << wetDepth
+         << qint32( mVertexCount )
+         << qint32( mFrameOffsets.count() )
+         << envelopes.maximumDepth
+         << envelopes.maximumVelocity
+         << envelopes.maximumHazard
+         << envelopes.arrivalTime
+         << envelopes.inundationDuration;
+
+  return stream.status() == QDataStream::Ok;
+}
+
+bool ReosTelemacSelafinReader::readEnvelopes( const QString &fileName, double wetDepth, Envelopes &envelopes ) const
+{
+  QFile file( fileName );
+  if ( !file.open( QIODevice::ReadOnly ) )
+    return false;
+
+  // the envelopes are used only if they have been calculated from the same results with the same wet depth
+  const QFileInfo resultsInfo( mFile.fileName() );
+  QDataStream stream( &file );
+  QString header;
+  qint32 version = 0;
+  qint64 resultsSize = 0;
+  qint64 resultsLastModified = 0;
+  double envelopesWetDepth = 0;
+  qint32 vertexCount = 0;
+  qint32 frameCount = 0;
+  stream >> header >> version >> resultsSize >> resultsLastModified >> envelopesWetDepth >> vertexCount >> frameCount;
+  if ( stream.status() != QDataStream::Ok ||
+       header != ENVELOPES_FILE_HEADER ||
+       version != ENVELOPES_FILE_VERSION ||
+       resultsSize != resultsInfo.size() ||
+       resultsLastModified != resultsInfo.lastModified().toMSecsSinceEpoch() ||
+       envelopesWetDepth != wetDepth ||
+       vertexCount != mVertexCount ||
+       frameCount != mFrameOffsets.count() )
+    return false;
+
+  Envelopes readEnvelopes;
+  stream >> readEnvelopes.maximumDepth
+         >> readEnvelopes.maximumVelocity
+         >> readEnvelopes.maximumHazard
+         >> readEnvelopes.arrivalTime
+         >> readEnvelopes.inundationDuration;
+  if ( stream.status() != QDataStream::Ok ||
+       readEnvelopes.maximumDepth.count() != mVertexCount ||
+       readEnvelopes.arrivalTime.count() != mVertexCount ||
+       readEnvelopes.inundationDuration.count() != mVertexCount ||
+       readEnvelopes.maximumVelocity.count() != readEnvelopes.maximumHazard.count() ||
+       ( !readEnvelopes.maximumVelocity.isEmpty() && readEnvelopes.maximumVelocity.count() != mVertexCount ) )
+    return false;
+
+  envelopes = readEnvelopes;
+  return true;
+}
+
+ReosTelemacSelafinReader::MinMax ReosTelemacSelafinReader::minMax( int variableIndex, int frameIndex ) const
+{
+  if ( variableIndex < 0 || variableIndex >= mVariableNames.count() )
+    return MinMax();
+
+  return mMinMax.value( frameIndex * mVariableNames.count() + variableIndex );
+}
+
+ReosTelemacSelafinReader::MinMax ReosTelemacSelafinReader::vectorMinMax( int vectorIndex, int frameIndex ) const
+{
+  if ( vectorIndex < 0 || vectorIndex >= mVectorCount )
+    return MinMax();
+
+  return mVectorMinMax.value( frameIndex * mVectorCount + vectorIndex );
+}
+
+void ReosTelemacSelafinReader::parseHeader()
+{
+  if ( mFileSize < 4 )
+    return;
+
+  // the first record is the title with 80 characters, that gives the endianness of the file
+  uchar firstBytes[4];
+  if ( !readBytes( 0, 4, reinterpret_cast<char *>( firstBytes ) ) )
+    return;
+  if ( qFromBigEndian<quint32>( firstBytes ) == 80 )
+    mBigEndian = true;
+  else if ( qFromLittleEndian<quint32>( firstBytes ) == 80 )
+    mBigEndian = false;
+  else
+    return;
+
+  qint32 length = 0;
+  qint64 offset = 0;
+
+  // title
+  qint64 data = readRecord( offset, length );
+  if ( data < 0 )
+    return;
+  offset = data + length + 4;
+
+  // NBV(1) and NBV(2)
+  data = readRecord( offset, length );
+  if ( data < 0 || length != 8 )
+    return;
+  const int variableCount = readInt( data ) + readInt( data + 4 );
+  offset = data + length + 4;
+
+  for ( int i = 0; i < variableCount; ++i )
+  {
+    data = readRecord( offset, length );
+    if ( data < 0 )
+      return;
+    QByteArray nameAndUnit( length, ' ' );
+    readBytes( data, length, nameAndUnit.data() );
+    mVariableNames.append( QString::fromLatin1( nameAndUnit.left( 16 ) ).trimmed() );
+    mVariableUnits.append( QString::fromLatin1( nameAndUnit.mid( 16 ) ).trimmed() );
+    offset = data + length + 4;
+  }
+
+  // IPARAM, the last one tells if there is a date
+  data = readRecord( offset, length );
+  if ( data < 0 || length != 40 )
+    return;
+  const bool hasDate = readInt( data + 36 ) == 1;
+  offset = data + length + 4;
+
+  if ( hasDate )
+  {
+    data = readRecord( offset, length );
+    if ( data < 0 || length != 24 )
+      return;
+    mReferenceTime = QDateTime( QDate( readInt( data ), readInt( data + 4 ), readInt( data + 8 ) ),
+                                QTime( readInt( data + 12 ), readInt( data + 16 ), readInt( data + 20 ) ), Qt::UTC );
+    offset = data + length + 4;
+  }
+
+  // NELEM, NPOIN, NDP, 1
+  data = readRecord( offset, length );
+  if ( data < 0 || length != 16 )
+    return;
+  mFaceCount = readInt( data );
+  mVertexCount = readInt( data + 4 );
+  mVerticesPerFace = readInt( data + 8 );
+  offset = data + length + 4;
+
+  // IKLE
+  data = readRecord( offset, length );
+  if ( data < 0 || length != 4 * qint64( mFaceCount ) * mVerticesPerFace )
+    return;
+  mConnectivityOffset = data;
+  offset = data + length + 4;
+
+  // IPOBO
+  data = readRecord( offset, length );
+  if ( data < 0 )
+    return;
+  offset = data + length + 4;
+
+  // X and Y, the size of the record gives the precision
+  for ( int i = 0; i < 2; ++i )
+  {
+    data = readRecord( offset, length );
+    if ( data < 0 || mVertexCount <= 0 || length % mVertexCount != 0 )
+      return;
+    mPrecision = length / mVertexCount;
+    if ( mPrecision != 4 && mPrecision != 8 )
+      return;
+    offset = data + length + 4;
+  }
+
+  // frames have all the same size, the last one can be incomplete if the simulation is running
+  const qint64 variableRecordSize = 8 + qint64( mVertexCount ) * mPrecision;
+  const qint64 frameSize = 8 + mPrecision + variableCount * variableRecordSize;
+  while ( offset + frameSize <= mFileSize )
+  {
+    data = readRecord( offset, length );
+    if ( data < 0 || length != mPrecision )
+      break;
+
+    if ( variableCount > 0 )
+    {
+      qint32 valuesLength = 0;
+      if ( readRecord( data + length + 4, valuesLength ) < 0 || valuesLength != variableRecordSize - 8 )
+        break;
+    }
+
+    mFrameOffsets.append( offset );
+    mFrameTimes.append( readReal( data ) );
+    offset += frameSize;
+  }
+
+  mIsValid = true;
+}
+
+bool ReosTelemacSelafinReader::readBytes( qint64 offset, qint64 size, char *buffer ) const
+{
+  if ( offset < 0 || size < 0 || offset + size > mFileSize )
+    return false;
+
+  if ( mData )
+  {
+    memcpy( buffer, mData + offset, static_cast<size_t>( size ) );
+    return true;
+  }
+
+  QMutexLocker locker( &mMutex );
+  if ( !mFile.seek( offset ) )
+    return false;
+  return mFile.read( buffer, size ) == size;
+}
+
+qint64 ReosTelemacSelafinReader::readRecord( qint64 offset, qint32 &length ) const
+{
+  length = readInt( offset );
+  if ( length < 0 || offset + 8 + length > mFileSize )
+    return -1;
+
+  if ( readInt( offset + 4 + length ) != length )
+    return -1;
+
+  return offset + 4;
+}
+
+qint32 ReosTelemacSelafinReader::readInt( qint64 offset ) const
+{
+  uchar bytes[4];
+  if ( !readBytes( offset, 4, reinterpret_cast<char *>( bytes ) ) )
+    return -1;
+
+  return static_cast<qint32>( decodeUInt32( bytes, mBigEndian ) );
+}
+
+double ReosTelemacSelafinReader::readReal( qint64 offset ) const
+{
+  uchar bytes[8];
+  if ( !readBytes( offset, mPrecision, reinterpret_cast<char *>( bytes ) ) )
+    return std::numeric_limits<double>::quiet_NaN();
+
+  return decodeReal( bytes, mPrecision, mBigEndian );
+}
+
+qint64 ReosTelemacSelafinReader::valuesOffset( int variableIndex, int frameIndex ) const
+{
+  if ( frameIndex < 0 || frameIndex >= mFrameOffsets.count() || variableIndex < 0 || variableIndex >= mVariableNames.count() )
+    return -1;
+
+  const qint64 variableRecordSize = 8 + qint64( mVertexCount ) * mPrecision;
+  return mFrameOffsets.at( frameIndex ) + 8 + mPrecision + variableIndex * variableRecordSize + 4;
+}
+
+const uchar *ReosTelemacSelafinReader::encodedValues( int variableIndex, int frameIndex, int vertexIndex, int count, QByteArray &buffer ) const
+{
+  const qint64 offset = valuesOffset( variableIndex, frameIndex );
+  if ( offset < 0 || vertexIndex < 0 || count < 0 || vertexIndex + count > mVertexCount )
+    return nullptr;
+
+  const qint64 start = offset + qint64( vertexIndex ) * mPrecision;
+  const qint64 size = qint64( count ) * mPrecision;
+
+  if ( mData )
+    return mData + start;
+
+  buffer.resize( static_cast<int>( size ) );
+  if ( !readBytes( start, size, buffer.data() ) )
+    return nullptr;
+
+  return reinterpret_cast<const uchar *>( buffer.constData() );
+}
+
+template<typename T>
+bool ReosTelemacSelafinReader::decodeValues( int variableIndex, int frameIndex, int vertexIndex, int count, T *values ) const
+{
+  QByteArray buffer;
+  const uchar *data = encodedValues( variableIndex, frameIndex, vertexIndex, count, buffer );
+  if ( !data )
+    return false;
+
+  for ( int i = 0; i < count; ++i )
+    values[i] = static_cast<T>( decodeReal( data + qint64( i ) * mPrecision, mPrecision, mBigEndian ) );
+
+  return true;
+}
+
+qint64 ReosTelemacSelafinReader::cacheKey( int variableIndex, int frameIndex ) const
+{
+  return qint64( frameIndex ) * mVariableNames.count() + variableIndex;
+}
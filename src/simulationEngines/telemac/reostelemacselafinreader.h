@@ -0,0 +1,199 @@
+/***************************************************************************
+  reostelemacselafinreader.h - ReosTelemacSelafinReader
+
+ ---------------------
+ begin                : 20.4.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef REOSTELEMACSELAFINREADER_H
+#define REOSTELEMACSELAFINREADER_H
+
+#include <limits>
+
+#include <QFile>
+#include <QCache>
+#include <QMutex>
+#include <QVector>
+#include <QStringList>
+#include <QDateTime>
+
+/**
+ * Class that reads a Selafin result file of Telemac.
+ *
+ * The file is memory mapped and the header is parsed once, offsets of all the frames are indexed when the file is opened.
+ * Values of a variable at a frame are decoded on demand, in single or double precision.
+ * Decoded slices are cached in a LRU cache limited in bytes, shared by all the variables.
+ * The cache is protected by a mutex, so values can be read from several threads.
+ */
+class ReosTelemacSelafinReader
+{
+  public:
+    struct MinMax
+    {
+      double minimum = std::numeric_limits<double>::quiet_NaN();
+      double maximum = std::numeric_limits<double>::quiet_NaN();
+    };
+
+    //! Values by vertex derived from all the frames of the water depth and the velocity
+    struct Envelopes
+    {
+      QVector<double> maximumDepth;
+      //! Maximum of the magnitude of the velocity, empty if there is no velocity
+      QVector<double> maximumVelocity;
+      //! Maximum of the product of the depth by the magnitude of the velocity, empty if there is no velocity
+      QVector<double> maximumHazard;
+      //! Time in seconds of the first frame where the depth is above the wet depth, NaN if never wet
+      QVector<double> arrivalTime;
+      //! Duration in seconds where the depth is above the wet depth, each frame lasting until the next one
+      QVector<double> inundationDuration;
+    };
+
+    //! Constructor with the \a fileName of the Selafin file, decoded values are cached until \a cacheBudget bytes
+    explicit ReosTelemacSelafinReader( const QString &fileName, qint64 cacheBudget = defaultCacheBudget() );
+    ~ReosTelemacSelafinReader();
+
+    //! Returns whether the header of the file has been read successfully
+    bool isValid() const;
+
+    //! Returns whether the values are stored in double precision in the file
+    bool isDoublePrecision() const;
+
+    int vertexCount() const;
+    int faceCount() const;
+    int verticesPerFace() const;
+
+    //! Returns the indexes (starting from 0) of the vertices of all the faces, verticesPerFace() indexes per face
+    QVector<int> connectivity() const;
+
+    int variableCount() const;
+
+    //! Returns the name of the variable with index \a variableIndex, without the unit and trailing spaces
+    QString variableName( int variableIndex ) const;
+
+    //! Returns the unit of the variable with index \a variableIndex
+    QString variableUnit( int variableIndex ) const;
+
+    //! Returns the index of the first variable with a name in \a names (case insensitive), -1 if not found
+    int variableIndex( const QStringList &names ) const;
+
+    //! Returns the count of complete frames in the file
+    int frameCount() const;
+
+    //! Returns the time of the frame \a frameIndex in seconds from the reference time
+    double frameTime( int frameIndex ) const;
+
+    //! Returns the reference time stored in the file, invalid if the file does not contain it
+    QDateTime referenceTime() const;
+
+    /**
+     * Returns all the values of the variable \a variableIndex at the frame \a frameIndex.
+     * Values are decoded once and kept in the cache while there is enough place.
+     */
+    QVector<double> values( int variableIndex, int frameIndex ) const;
+
+    /**
+     * Decodes in \a values the \a count values of the variable \a variableIndex at frame \a frameIndex starting from vertex \a vertexIndex.
+     * Cached values are used if present, but decoded values are not put in the cache.
+     */
+    bool readValues( int variableIndex, int frameIndex, int vertexIndex, int count, double *values ) const;
+
+    //! Same as above but with values decoded in single precision
+    bool readValues( int variableIndex, int frameIndex, int vertexIndex, int count, float *values ) const;
+
+    /**
+     * Calculates in one pass on the file the minimum and maximum of each variable at each frame,
+     * and of the magnitude of vectors defined by pairs of variable indexes in \a vectors.
+     */
+    void calculateMinMax( const QList<QPair<int, int>> &vectors = QList<QPair<int, int>>() );
+
+    /**
+     * Calculates in one pass on the file the envelopes of the water depth of variable \a depthIndex and of the velocity
+     * with components \a velocityXIndex and \a velocityYIndex (-1 if no velocity), a vertex being wet if the depth is above \a wetDepth.
+     * Frames are read in the order of the file and the values of each frame are processed in parallel by chunks of vertices.
+     */
+    Envelopes calculateEnvelopes( int depthIndex, int velocityXIndex, int velocityYIndex, double wetDepth ) const;
+
+    /**
+     * Writes the \a envelopes calculated with \a wetDepth in the file \a fileName, with the size and the modification time of the results,
+     * so that readEnvelopes() can check the envelopes are still up to date. Returns false if the file can't be written.
+     */
+    bool writeEnvelopes( const QString &fileName, const Envelopes &envelopes, double wetDepth ) const;
+
+    /**
+     * Reads in \a envelopes the envelopes written with writeEnvelopes() in the file \a fileName.
+     * Returns false if the file can't be read, or if it has not been written for the same results with the same \a wetDepth.
+     */
+    bool readEnvelopes( const QString &fileName, double wetDepth, Envelopes &envelopes ) const;
+
+    //! Returns the minimum and maximum of the variable \a variableIndex at frame \a frameIndex, calculateMinMax() has to be called before
+    MinMax minMax( int variableIndex, int frameIndex ) const;
+
+    //! Returns the minimum and maximum of the magnitude of the vector \a vectorIndex at frame \a frameIndex, calculateMinMax() has to be called before
+    MinMax vectorMinMax( int vectorIndex, int frameIndex ) const;
+
+    //! Returns the default size in bytes of the cache of decoded values
+    static qint64 defaultCacheBudget() {return qint64( 256 ) << 20;}
+
+  private:
+    mutable QFile mFile;
+    const uchar *mData = nullptr;
+    qint64 mFileSize = 0;
+    bool mIsValid = false;
+    bool mBigEndian = true;
+    int mPrecision = 4;
+
+    QStringList mVariableNames;
+    QStringList mVariableUnits;
+    int mVertexCount = 0;
+    int mFaceCount = 0;
+    int mVerticesPerFace = 0;
+    qint64 mConnectivityOffset = 0;
+    QDateTime mReferenceTime;
+
+    QVector<qint64> mFrameOffsets;
+    QVector<double> mFrameTimes;
+
+    // indexed by frameIndex * variableCount + variableIndex
+    QVector<MinMax> mMinMax;
+    // indexed by frameIndex * vectorCount + vectorIndex
+    QVector<MinMax> mVectorMinMax;
+    int mVectorCount = 0;
+
+    mutable QMutex mMutex;
+    mutable QCache<qint64, QVector<double>> mCache;
+
+    void parseHeader();
+
+    //! Copies \a size bytes from \a offset in \a buffer, returns false if out of the file
+    bool readBytes( qint64 offset, qint64 size, char *buffer ) const;
+
+    //! Reads the record at \a offset, returns the offset of the data and set \a length, -1 if the record is not valid
+    qint64 readRecord( qint64 offset, qint32 &length ) const;
+
+    qint32 readInt( qint64 offset ) const;
+    double readReal( qint64 offset ) const;
+
+    //! Returns the offset of the first value of the variable \a variableIndex at frame \a frameIndex
+    qint64 valuesOffset( int variableIndex, int frameIndex ) const;
+
+    /**
+     * Returns a pointer to the encoded values of the variable \a variableIndex at frame \a frameIndex from vertex \a vertexIndex,
+     * in the mapped file if it is mapped, or read in \a buffer otherwise. Returns nullptr if out of the file.
+     */
+    const uchar *encodedValues( int variableIndex, int frameIndex, int vertexIndex, int count, QByteArray &buffer ) const;
+
+    template<typename T>
+    bool decodeValues( int variableIndex, int frameIndex, int vertexIndex, int count, T *values ) const;
+
+    qint64 cacheKey( int variableIndex, int frameIndex ) const;
+};
+
+#endif // REOSTELEMACSELAFINREADER_H
@@ -0,0 +1,203 @@
+/***************************************************************************
+  reostelemacselafinwriter.cpp - ReosTelemacSelafinWriter
+
+ ---------------------
+ begin                : 21.4.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "reostelemacselafinwriter.h"
+
+#include <cstring>
+#include <QtEndian>
+
+// size in bytes of the buffer written in one time in the file
+#define SELAFIN_WRITER_BUFFER_SIZE (4 << 20)
+
+ReosTelemacSelafinWriter::ReosTelemacSelafinWriter( const QString &fileName )
+  : mFile( fileName )
+  , mBuffer( SELAFIN_WRITER_BUFFER_SIZE, Qt::Uninitialized )
+{
+  mError = !mFile.open( QIODevice::WriteOnly | QIODevice::Truncate );
+}
+
+ReosTelemacSelafinWriter::~ReosTelemacSelafinWriter()
+{
+  close();
+}
+
+bool ReosTelemacSelafinWriter::writeHeader( const QString &title,
+    const QStringList &variableNames,
+    const QStringList &variableUnits,
+    const QVector<int> &connectivity,
+    const QVector<int> &boundaryPositions,
+    const QVector<double> &x,
+    const QVector<double> &y )
+{
+  mVertexCount = x.count();
+  if ( y.count() != mVertexCount || boundaryPositions.count() != mVertexCount || connectivity.count() % 3 != 0 )
+    return false;
+
+  // title on 72 characters then the format, double precision
+  QByteArray header = title.toLatin1().left( 72 ).leftJustified( 72, ' ' );
+  header.append( "SERAFIND" );
+  appendRecordMarker( header.size() );
+  appendBytes( header.constData(), header.size() );
+  appendRecordMarker( header.size() );
+
+  // NBV(1) NBV(2)
+  const int nbv[2] = {static_cast<int>( variableNames.count() ), 0};
+  appendIntRecord( nbv, 2 );
+
+  // variable names and units on 16 characters each
+  for ( int i = 0; i < variableNames.count(); ++i )
+  {
+    QByteArray nameAndUnit = variableNames.at( i ).toLatin1().left( 16 ).leftJustified( 16, ' ' );
+    nameAndUnit.append( variableUnits.value( i ).toLatin1().left( 16 ).leftJustified( 16, ' ' ) );
+    appendRecordMarker( nameAndUnit.size() );
+    appendBytes( nameAndUnit.constData(), nameAndUnit.size() );
+    appendRecordMarker( nameAndUnit.size() );
+  }
+
+  // parameter table, all values are 0
+  const int param[10] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+  appendIntRecord( param, 10 );
+
+  // NELEM, NPOIN, NDP, 1
+  const int elem[4] = {static_cast<int>( connectivity.count() / 3 ), mVertexCount, 3, 1};
+  appendIntRecord( elem, 4 );
+
+  // connectivity, indexes start from 1 in the file
+  appendIntRecord( connectivity.constData(), connectivity.count(), 1 );
+
+  appendIntRecord( boundaryPositions.constData(), boundaryPositions.count() );
+
+  appendDoubleRecord( x.constData(), x.count() );
+  appendDoubleRecord( y.constData(), y.count() );
+
+  return !mError;
+}
+
+bool ReosTelemacSelafinWriter::writeFrameTime( double time )
+{
+  appendDoubleRecord( &time, 1 );
+  return !mError;
+}
+
+bool ReosTelemacSelafinWriter::writeVariableValues( const QVector<double> &values )
+{
+  if ( values.count() != mVertexCount )
+    return false;
+
+  appendDoubleRecord( values.constData(), values.count() );
+  return !mError;
+}
+
+bool ReosTelemacSelafinWriter::close()
+{
+  if ( mFile.isOpen() )
+  {
+    flush();
+    mFile.close();
+  }
+
+  return !mError;
+}
+
+void ReosTelemacSelafinWriter::appendInt( qint32 value )
+{
+  ensureSpace( 4 );
+  qToBigEndian<qint32>( value, mBuffer.data() + mBufferUsed );
+  mBufferUsed += 4;
+}
+
+void ReosTelemacSelafinWriter::appendDouble( double value )
+{
+  ensureSpace( 8 );
+  quint64 bits;
+  memcpy( &bits, &value, sizeof( double ) );
+  qToBigEndian<quint64>( bits, mBuffer.data() + mBufferUsed );
+  mBufferUsed += 8;
+}
+
+void ReosTelemacSelafinWriter::appendRecordMarker( qint64 byteCount )
+{
+  appendInt( static_cast<qint32>( byteCount ) );
+}
+
+void ReosTelemacSelafinWriter::appendBytes( const char *data, int size )
+{
+  ensureSpace( size );
+  memcpy( mBuffer.data() + mBufferUsed, data, static_cast<size_t>( size ) );
+  mBufferUsed += size;
+}
+
+void ReosTelemacSelafinWriter::appendIntRecord( const int *values, int count, int offset )
+{
+  appendRecordMarker( qint64( count ) * 4 );
+
+  // values are encoded by blocks that fill the buffer
+  int done = 0;
+  while ( done < count )
+  {
+    ensureSpace( 4 );
+    const int blockCount = std::min( count - done, ( mBuffer.size() - mBufferUsed ) / 4 );
+    char *out = mBuffer.data() + mBufferUsed;
+    for ( int i = 0; i < blockCount; ++i )
+      qToBigEndian<qint32>( values[done + i] + offset, out + 4 * i );
+    mBufferUsed += 4 * blockCount;
+    done += blockCount;
+  }
+
+  appendRecordMarker( qint64( count ) * 4 );
+}
+
+void ReosTelemacSelafinWriter::appendDoubleRecord( const double *values, int count )
+{
+  appendRecordMarker( qint64( count ) * 8 );
+
+  int done = 0;
+  while ( done < count )
+  {
+    ensureSpace( 8 );
+    const int blockCount = std::min( count - done, ( mBuffer.size() - mBufferUsed ) / 8 );
+    char *out = mBuffer.data() + mBufferUsed;
+    for ( int i = 0; i < blockCount; ++i )
+    {
+      quint64 bits;
+      memcpy( &bits, values + done + i, sizeof( double ) );
+      qToBigEndian<quint64>( bits, out + 8 * i );
+    }
+    mBufferUsed += 8 * blockCount;
+    done += blockCount;
+  }
+
+  appendRecordMarker( qint64( count ) * 8 );
+}
+
+void ReosTelemacSelafinWriter::ensureSpace( int size )
+{
+  if ( mBufferUsed + size > mBuffer.size() )
+    flush();
+
+  if ( size > mBuffer.size() )
+    mBuffer.resize( size );
+}
+
+void ReosTelemacSelafinWriter::flush()
+{
+  if ( mBufferUsed == 0 )
+    return;
+
+  if ( !mError && mFile.write( mBuffer.constData(), mBufferUsed ) != mBufferUsed )
+    mError = true;
+
+  mBufferUsed = 0;
+}
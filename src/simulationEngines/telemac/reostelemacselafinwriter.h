@@ -0,0 +1,89 @@
+/***************************************************************************
+  reostelemacselafinwriter.h - ReosTelemacSelafinWriter
+
+ ---------------------
+ begin                : 21.4.2022
+ copyright            : (C) 2022 by Vincent Cloarec
+ email                : vcloarec at gmail dot com
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef REOSTELEMACSELAFINWRITER_H
+#define REOSTELEMACSELAFINWRITER_H
+
+#include <QFile>
+#include <QByteArray>
+#include <QVector>
+#include <QStringList>
+
+/**
+ * Class that writes a Selafin file in double precision and big endian, as expected by Telemac.
+ *
+ * Arrays are encoded by blocks in a buffer that is written in the file when full,
+ * so the file is written with a few large writes whatever the size of the mesh.
+ *
+ * The header has to be written first with writeHeader(), then each frame with writeFrameTime() followed by
+ * writeVariableValues() for each variable, in the order of the header.
+ */
+class ReosTelemacSelafinWriter
+{
+  public:
+    //! Constructor, the file \a fileName is created or truncated
+    explicit ReosTelemacSelafinWriter( const QString &fileName );
+
+    //! Destructor, remaining data in the buffer is written
+    ~ReosTelemacSelafinWriter();
+
+    /**
+     * Writes the header of the file:
+     * - the \a title, truncated or completed to 72 characters,
+     * - the names of the variables \a variableNames with the units \a variableUnits,
+     * - the \a connectivity of triangles, three vertex indexes starting from 0 for each face,
+     * - the positions of the vertices in the boundary \a boundaryPositions, one per vertex, 0 if not on boundary,
+     * - the coordinates \a x and \a y of the vertices.
+     */
+    bool writeHeader( const QString &title,
+                      const QStringList &variableNames,
+                      const QStringList &variableUnits,
+                      const QVector<int> &connectivity,
+                      const QVector<int> &boundaryPositions,
+                      const QVector<double> &x,
+                      const QVector<double> &y );
+
+    //! Starts a new frame at \a time in seconds
+    bool writeFrameTime( double time );
+
+    //! Writes the \a values of the next variable of the current frame, \a values has to contain one value per vertex
+    bool writeVariableValues( const QVector<double> &values );
+
+    //! Writes remaining data and closes the file, returns false if an error occurred while writing
+    bool close();
+
+  private:
+    QFile mFile;
+    QByteArray mBuffer;
+    int mBufferUsed = 0;
+    bool mError = false;
+    int mVertexCount = 0;
+
+    void appendInt( qint32 value );
+    void appendDouble( double value );
+    void appendRecordMarker( qint64 byteCount );
+    void appendBytes( const char *data, int size );
+
+    //! Appends a record with the \a count integers of \a values, \a offset is added to each value
+    void appendIntRecord( const int *values, int count, int offset = 0 );
+
+    //! Appends a record with the \a count doubles of \a values
+    void appendDoubleRecord( const double *values, int count );
+
+    void ensureSpace( int size );
+    void flush();
+};
+
+#endif // REOSTELEMACSELAFINWRITER_H